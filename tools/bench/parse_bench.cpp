@@ -0,0 +1,72 @@
+// Declaration-extractor scaling over the whole corpus.
+//
+//     MOBY_CORPUS=/path/to/corpus ./parse_bench
+//
+// BM_ParseSections/N is extract_corpus_symbols on N threads, one task per
+// header section. BM_ParseFiles/N schedules one task per corpus file instead,
+// the split the section-level scheduler replaces; with a few very large
+// frameworks it stops scaling long before the core count.
+#include "moby/corpus.h"
+#include "moby/symbol_db.h"
+#include "moby/work_pool.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <numeric>
+
+namespace {
+
+std::unique_ptr<moby::Corpus> g_corpus;
+
+void BM_ParseSections(benchmark::State& state) {
+    std::size_t count = 0;
+    for (auto _ : state) {
+        std::vector<moby::Symbol> symbols =
+            moby::extract_corpus_symbols(*g_corpus, static_cast<unsigned>(state.range(0)));
+        count = symbols.size();
+        benchmark::DoNotOptimize(symbols.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * g_corpus->total_bytes()));
+    state.counters["symbols"] = static_cast<double>(count);
+}
+
+void BM_ParseFiles(benchmark::State& state) {
+    const auto& sections = g_corpus->sections();
+    std::vector<std::uint32_t> files(g_corpus->files().size());
+    std::iota(files.begin(), files.end(), 0);
+    for (auto _ : state) {
+        std::vector<std::vector<moby::Symbol>> parts(files.size());
+        moby::run_stealing(files, static_cast<unsigned>(state.range(0)), [&](std::uint32_t f) {
+            for (std::uint32_t i = 0; i < sections.size(); ++i)
+                if (sections[i].file == f)
+                    moby::extract_symbols(sections[i].text, sections[i].offset, i, parts[f]);
+        });
+        benchmark::DoNotOptimize(parts.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * g_corpus->total_bytes()));
+}
+
+void thread_counts(benchmark::internal::Benchmark* b) {
+    unsigned max = std::max(moby::default_thread_count(), 1u);
+    for (unsigned n = 1; n < max; n *= 2)
+        b->Arg(n);
+    b->Arg(max);
+}
+
+} // namespace
+
+BENCHMARK(BM_ParseSections)->Apply(thread_counts)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_ParseFiles)->Apply(thread_counts)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+int main(int argc, char** argv) {
+    const char* dir = std::getenv("MOBY_CORPUS");
+    g_corpus = std::make_unique<moby::Corpus>(dir && *dir ? dir : MOBY_SOURCE_CORPUS);
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
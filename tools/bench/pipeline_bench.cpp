@@ -0,0 +1,239 @@
+// Per-stage cost of the index pipeline on fixed inputs.
+//
+//     MOBY_CORPUS=/path/to/corpus ./pipeline_bench --benchmark_out=pipeline.json
+//
+// Every stage runs on three inputs: the full corpus, its three largest files
+// and its files under 64 KiB. The inputs are built as directories of links to
+// the corpus files, so each stage sees an ordinary Corpus. Stages whose API
+// takes a thread count run on one thread; parse_bench covers scaling.
+//
+// Besides bytes_per_second (corpus bytes of the input), each run reports
+// allocs and alloc_bytes, counted by the global operator new of this binary,
+// per iteration, and peak_rss_mb, the high-water mark of the resident set
+// while the stage ran (reset through /proc/self/clear_refs; without it, the
+// process peak so far). The JSON context records the corpus hash and the size
+// of each input, so results from different nights are comparable.
+#include "moby/corpus.h"
+#include "moby/enum_table.h"
+#include "moby/include_graph.h"
+#include "moby/lexer.h"
+#include "moby/scanner.h"
+#include "moby/section_index.h"
+#include "moby/symbol_db.h"
+#include "moby/trigram_index.h"
+
+#include <benchmark/benchmark.h>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::atomic<std::uint64_t> g_allocs{0};
+std::atomic<std::uint64_t> g_alloc_bytes{0};
+
+} // namespace
+
+void* operator new(std::size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(n, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(n, std::memory_order_relaxed);
+    return std::malloc(n ? n : 1);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+namespace {
+
+struct Input {
+    std::string name;
+    std::unique_ptr<moby::Corpus> corpus;
+    std::vector<moby::Symbol> symbols;  // for the stages that consume extraction
+};
+
+std::vector<Input> g_inputs;
+fs::path g_scratch;
+
+// Resets the resident-set high-water mark; false where the kernel does not
+// support it.
+bool reset_peak_rss() {
+    std::ofstream f("/proc/self/clear_refs");
+    return f && (f << "5").flush().good();
+}
+
+double peak_rss_mb() {
+    std::ifstream f("/proc/self/status");
+    for (std::string line; std::getline(f, line);)
+        if (line.rfind("VmHWM:", 0) == 0)
+            return std::strtod(line.c_str() + 6, nullptr) / 1024.0;
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+// Runs `stage` as the benchmark body and attaches the throughput, allocation
+// and RSS counters.
+template <class Stage>
+void run_stage(benchmark::State& state, const Input& input, Stage stage) {
+    reset_peak_rss();
+    std::uint64_t allocs = g_allocs.load(), bytes = g_alloc_bytes.load();
+    for (auto _ : state)
+        stage();
+    allocs = g_allocs.load() - allocs;
+    bytes = g_alloc_bytes.load() - bytes;
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * input.corpus->total_bytes()));
+    state.counters["allocs"] = benchmark::Counter(static_cast<double>(allocs), benchmark::Counter::kAvgIterations);
+    state.counters["alloc_bytes"] =
+        benchmark::Counter(static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+    state.counters["peak_rss_mb"] = peak_rss_mb();
+}
+
+std::string scratch_file(const Input& input, const char* name) {
+    return (g_scratch / (input.name + "." + name)).string();
+}
+
+void BM_Scan(benchmark::State& state, const Input* input) {
+    std::vector<moby::ScanHit> hits;
+    run_stage(state, *input, [&] {
+        hits.clear();
+        for (const moby::CorpusFile& f : input->corpus->files())
+            moby::scan(f.map.view(), hits);
+        benchmark::DoNotOptimize(hits.data());
+    });
+}
+
+void BM_Tokenize(benchmark::State& state, const Input* input) {
+    run_stage(state, *input, [&] {
+        std::size_t tokens = 0;
+        for (const moby::Section& s : input->corpus->sections())
+            tokens += moby::tokenize(s.text).size();
+        benchmark::DoNotOptimize(tokens);
+    });
+}
+
+void BM_ExtractSymbols(benchmark::State& state, const Input* input) {
+    run_stage(state, *input, [&] {
+        std::vector<moby::Symbol> symbols = moby::extract_corpus_symbols(*input->corpus, 1);
+        benchmark::DoNotOptimize(symbols.data());
+    });
+}
+
+void BM_FoldEnums(benchmark::State& state, const Input* input) {
+    std::string path = scratch_file(*input, "enums");
+    run_stage(state, *input, [&] { moby::EnumTable::build(*input->corpus, input->symbols, path); });
+}
+
+void BM_SectionIndex(benchmark::State& state, const Input* input) {
+    std::string path = scratch_file(*input, "sections");
+    run_stage(state, *input, [&] { moby::SectionIndex::build(*input->corpus, path); });
+}
+
+void BM_SymbolDb(benchmark::State& state, const Input* input) {
+    std::string path = scratch_file(*input, "symbols");
+    run_stage(state, *input, [&] { moby::SymbolDb::build(*input->corpus, input->symbols, path); });
+}
+
+void BM_TrigramIndex(benchmark::State& state, const Input* input) {
+    std::string path = scratch_file(*input, "trigrams");
+    run_stage(state, *input, [&] { moby::TrigramIndex::build(*input->corpus, path, 1); });
+}
+
+void BM_IncludeGraph(benchmark::State& state, const Input* input) {
+    std::string path = scratch_file(*input, "includes");
+    run_stage(state, *input, [&] { moby::IncludeGraph::build(*input->corpus, path); });
+}
+
+// A directory of links to `files` of the corpus in `dir`.
+std::string link_input(const std::string& dir, const std::string& name, const std::vector<std::string>& files) {
+    fs::path out = g_scratch / name;
+    fs::create_directories(out);
+    for (const std::string& f : files)
+        fs::create_symlink(fs::absolute(fs::path(dir) / f), out / f);
+    return out.string();
+}
+
+void add_input(const std::string& name, const std::string& dir) {
+    Input input;
+    input.name = name;
+    input.corpus = std::make_unique<moby::Corpus>(dir);
+    input.symbols = moby::extract_corpus_symbols(*input.corpus);
+    benchmark::AddCustomContext("input_" + name, std::to_string(input.corpus->files().size()) + " files, " +
+                                                     std::to_string(input.corpus->total_bytes()) + " bytes");
+    g_inputs.push_back(std::move(input));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* env = std::getenv("MOBY_CORPUS");
+    std::string dir = env && *env ? env : MOBY_SOURCE_CORPUS;
+    g_scratch = fs::temp_directory_path() / ("moby-pipeline-bench." + std::to_string(getpid()));
+    fs::remove_all(g_scratch);
+    fs::create_directories(g_scratch);
+
+    moby::Corpus full(dir);
+    std::vector<const moby::CorpusFile*> by_size;
+    for (const moby::CorpusFile& f : full.files())
+        by_size.push_back(&f);
+    std::stable_sort(by_size.begin(), by_size.end(),
+                     [](const auto* a, const auto* b) { return a->map.size() > b->map.size(); });
+    std::vector<std::string> largest, small;
+    for (std::size_t i = 0; i < by_size.size(); ++i) {
+        if (i < 3)
+            largest.push_back(by_size[i]->name);
+        else if (by_size[i]->map.size() < 64 * 1024)
+            small.push_back(by_size[i]->name);
+    }
+    benchmark::AddCustomContext("corpus", dir);
+    benchmark::AddCustomContext("corpus_hash", std::to_string(moby::corpus_hash(full)));
+    add_input("full", dir);
+    add_input("largest3", link_input(dir, "largest3", largest));
+    add_input("small", link_input(dir, "small", small));
+
+    struct Stage {
+        const char* name;
+        void (*fn)(benchmark::State&, const Input*);
+    };
+    const Stage stages[] = {
+        {"Scan", BM_Scan},
+        {"Tokenize", BM_Tokenize},
+        {"ExtractSymbols", BM_ExtractSymbols},
+        {"FoldEnums", BM_FoldEnums},
+        {"SectionIndex", BM_SectionIndex},
+        {"SymbolDb", BM_SymbolDb},
+        {"TrigramIndex", BM_TrigramIndex},
+        {"IncludeGraph", BM_IncludeGraph},
+    };
+    for (const Stage& stage : stages)
+        for (const Input& input : g_inputs)
+            benchmark::RegisterBenchmark((std::string("BM_") + stage.name + "/" + input.name).c_str(), stage.fn,
+                                         &input)
+                ->Unit(benchmark::kMillisecond)
+                ->UseRealTime();
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    fs::remove_all(g_scratch);
+    return 0;
+}
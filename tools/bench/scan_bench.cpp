@@ -0,0 +1,66 @@
+// Scanner throughput over the whole corpus, one benchmark per ISA level.
+//
+//     MOBY_CORPUS=/path/to/corpus ./scan_bench
+//
+// bytes_per_second in the output is the scan rate; BM_MemoryRead is the same
+// data read with a trivial word-sum loop, as a memory-bandwidth reference.
+#include "moby/corpus.h"
+#include "moby/scanner.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+std::unique_ptr<moby::Corpus> g_corpus;
+
+void BM_Scan(benchmark::State& state, moby::Isa isa) {
+    std::vector<moby::ScanHit> hits;
+    hits.reserve(1 << 20);
+    for (auto _ : state) {
+        hits.clear();
+        for (const moby::CorpusFile& f : g_corpus->files())
+            moby::scan(f.map.view(), hits, 0, isa);
+        benchmark::DoNotOptimize(hits.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * g_corpus->total_bytes()));
+    state.counters["hits"] = static_cast<double>(hits.size());
+}
+
+void BM_MemoryRead(benchmark::State& state) {
+    for (auto _ : state) {
+        std::uint64_t sum = 0;
+        for (const moby::CorpusFile& f : g_corpus->files()) {
+            const char* p = f.map.data();
+            std::size_t n = f.map.size() / 8;
+            for (std::size_t i = 0; i < n; ++i) {
+                std::uint64_t w;
+                std::memcpy(&w, p + i * 8, 8);
+                sum += w;
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * g_corpus->total_bytes()));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* dir = std::getenv("MOBY_CORPUS");
+    g_corpus = std::make_unique<moby::Corpus>(dir && *dir ? dir : MOBY_SOURCE_CORPUS);
+
+    for (moby::Isa isa : {moby::Isa::Scalar, moby::Isa::Sse42, moby::Isa::Avx2})
+        if (moby::isa_supported(isa))
+            benchmark::RegisterBenchmark((std::string("BM_Scan/") + moby::isa_name(isa)).c_str(), BM_Scan, isa)
+                ->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("BM_MemoryRead", BM_MemoryRead)->Unit(benchmark::kMillisecond);
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
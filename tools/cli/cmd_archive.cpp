@@ -0,0 +1,200 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/archive.h"
+#include "moby/section_index.h"
+#include "moby/work_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby archive build [--corpus DIR] [--out FILE] [--level N] [--dictionary BYTES] [--jobs N]\n"
+                 "       moby archive get [--archive FILE] [--time] PATH...\n"
+                 "       moby archive extract [--archive FILE] [--framework NAME] [--dest DIR]\n"
+                 "       moby archive bench [--archive FILE] [--framework NAME]\n"
+                 "       moby archive stats [--archive FILE]\n";
+    return 2;
+}
+
+std::string archive_path(const Options& opts) {
+    return opts.get("archive", CorpusArchive::default_path(default_corpus_dir()));
+}
+
+// Index of the file holding framework `name`.
+std::size_t find_file(const CorpusArchive& archive, const std::string& name) {
+    std::string file = name + ".framework.h";
+    for (std::size_t i = 0; i < archive.file_count(); ++i)
+        if (archive.file_name(i) == file)
+            return i;
+    throw Error("no framework " + name + " in the archive");
+}
+
+int build(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string out = opts.get("out", CorpusArchive::default_path(dir));
+    ArchiveOptions options;
+    options.level = static_cast<int>(opts.get_size("level", static_cast<std::size_t>(options.level)));
+    options.dictionary_size = opts.get_size("dictionary", options.dictionary_size);
+    options.threads = static_cast<unsigned>(opts.get_size("jobs", default_thread_count()));
+    if (options.level < 1 || options.level > 9)
+        throw Error("--level must be between 1 and 9");
+
+    auto start = Clock::now();
+    Corpus corpus(dir);
+    CorpusArchive::build(corpus, out, options);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    CorpusArchive archive(out);
+    std::fprintf(stderr, "archived %zu frames from %zu files: %.1f MB -> %.2f MB (%.2fx, %zu-byte dictionary) in %.1f ms -> %s\n",
+                 archive.frame_count(), archive.file_count(), archive.original_bytes() / 1e6,
+                 archive.archive_bytes() / 1e6, double(archive.original_bytes()) / archive.archive_bytes(),
+                 archive.dictionary().size(), ms, out.c_str());
+    return 0;
+}
+
+int get(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    auto start = Clock::now();
+    CorpusArchive archive(archive_path(opts));
+    std::string text;
+    int status = 0;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        const ArchiveFrame* f = archive.find(opts.positional()[i]);
+        if (!f) {
+            std::cerr << "moby archive: no section " << opts.positional()[i] << '\n';
+            status = 1;
+            continue;
+        }
+        archive.read_text(*f, text);
+        std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+    if (opts.has("time"))
+        std::fprintf(stderr, "open + decompress: %.1f us\n",
+                     std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    return status;
+}
+
+// Restores the *.framework.h files byte for byte; a full extraction is
+// checked against the archived corpus fingerprint.
+int extract(const Options& opts) {
+    CorpusArchive archive(archive_path(opts));
+    fs::path dest = opts.get("dest", ".");
+    fs::create_directories(dest);
+    std::size_t first = 0, last = archive.file_count();
+    if (opts.has("framework")) {
+        first = find_file(archive, opts.get("framework"));
+        last = first + 1;
+    }
+
+    auto start = Clock::now();
+    std::string frame;
+    std::uint64_t bytes = 0;
+    for (std::size_t i = first; i < last; ++i) {
+        const ArchiveFile& file = archive.file(i);
+        fs::path path = dest / std::string(archive.file_name(i));
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw Error("cannot create " + path.string());
+        for (std::uint32_t k = 0; k < file.frame_count; ++k) {
+            archive.read(archive.frame(file.first_frame + k), frame);
+            out.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+        }
+        if (!out)
+            throw Error("cannot write " + path.string());
+        bytes += file.size;
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::fprintf(stderr, "extracted %zu files (%.1f MB) in %.1f ms to %s\n", last - first, bytes / 1e6, ms,
+                 dest.string().c_str());
+    if (!opts.has("framework") && moby::corpus_hash(Corpus(dest.string())) != archive.corpus_hash())
+        throw Error("extracted corpus does not match the archive fingerprint");
+    return 0;
+}
+
+// Decompresses every section of one framework (or of all of them), one at
+// a time as a reader looking up headers would, and reports per-section cost.
+int bench(const Options& opts) {
+    CorpusArchive archive(archive_path(opts));
+    std::size_t first = 0, last = archive.file_count();
+    if (opts.has("framework")) {
+        first = find_file(archive, opts.get("framework"));
+        last = first + 1;
+    }
+    std::string text;
+    std::vector<double> samples;
+    std::uint64_t raw = 0, stored = 0;
+    auto start = Clock::now();
+    for (std::size_t i = first; i < last; ++i) {
+        const ArchiveFile& file = archive.file(i);
+        for (std::uint32_t k = 0; k < file.frame_count; ++k) {
+            const ArchiveFrame& f = archive.frame(file.first_frame + k);
+            auto t = Clock::now();
+            archive.read(f, text);
+            samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t).count());
+            raw += f.length;
+            stored += f.stored;
+        }
+    }
+    double total = std::chrono::duration<double>(Clock::now() - start).count();
+    if (samples.empty())
+        return 1;
+    std::sort(samples.begin(), samples.end());
+    auto pct = [&](double p) { return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * samples.size()))]; };
+    std::printf("%zu frames, %.2f MB -> %.2f MB (%.2fx): %.0f MB/s, per frame p50 %.1f us, p99 %.1f us, max %.1f us\n",
+                samples.size(), stored / 1e6, raw / 1e6, double(raw) / stored, raw / 1e6 / total, pct(0.5),
+                pct(0.99), samples.back());
+    return 0;
+}
+
+int stats(const Options& opts) {
+    CorpusArchive archive(archive_path(opts));
+    std::printf("%-32s %8s %10s %10s %7s\n", "file", "frames", "bytes", "stored", "ratio");
+    for (std::size_t i = 0; i < archive.file_count(); ++i) {
+        const ArchiveFile& file = archive.file(i);
+        std::uint64_t stored = 0;
+        for (std::uint32_t k = 0; k < file.frame_count; ++k)
+            stored += archive.frame(file.first_frame + k).stored;
+        std::string_view name = archive.file_name(i);
+        std::printf("%-32.*s %8u %10llu %10llu %6.2fx\n", static_cast<int>(name.size()), name.data(),
+                    file.frame_count, static_cast<unsigned long long>(file.size),
+                    static_cast<unsigned long long>(stored), stored ? double(file.size) / stored : 0.0);
+    }
+    std::printf("total: %.2f MB -> %.2f MB (%.2fx), dictionary %zu bytes\n", archive.original_bytes() / 1e6,
+                archive.archive_bytes() / 1e6, double(archive.original_bytes()) / archive.archive_bytes(),
+                archive.dictionary().size());
+    return 0;
+}
+
+} // namespace
+
+int cmd_archive(const Args& args) {
+    Options opts(args, {"corpus", "out", "level", "dictionary", "jobs", "archive", "framework", "dest"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "build")
+        return build(opts);
+    if (sub == "get")
+        return get(opts);
+    if (sub == "extract")
+        return extract(opts);
+    if (sub == "bench")
+        return bench(opts);
+    if (sub == "stats")
+        return stats(opts);
+    return usage();
+}
+
+} // namespace moby::cli
@@ -0,0 +1,155 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/availability.h"
+#include "moby/section_index.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby availability build [--corpus DIR] [--out FILE]\n"
+                 "       moby availability show [--corpus DIR] NAME...\n"
+                 "       moby availability query [--corpus DIR] [--available PLATFORM:VERSION,...]\n"
+                 "                               [--unavailable PLATFORM,...] [--deprecated PLATFORM:VERSION,...]\n"
+                 "                               [--kind KIND] [--count] [--time]\n";
+    return 2;
+}
+
+Platform platform_arg(const std::string& s) {
+    Platform p;
+    if (!parse_platform(s, p))
+        throw Error("unknown platform " + s);
+    return p;
+}
+
+// "ios:11.0" -> (ios, 11.0); the version defaults to "any".
+std::pair<Platform, std::uint32_t> platform_version_arg(const std::string& s) {
+    std::size_t colon = s.find(':');
+    Platform p = platform_arg(s.substr(0, colon));
+    std::uint32_t v = kVersionFuture - 1;
+    if (colon != std::string::npos && !(v = parse_version(s.substr(colon + 1))))
+        throw Error("bad version in " + s);
+    return {p, v};
+}
+
+int build(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string out = opts.get("out", AvailabilityMatrix::default_path(dir));
+    auto start = Clock::now();
+    Corpus corpus(dir);
+    SymbolDb db(opts.get("db", SymbolDb::default_path(dir)));
+    if (db.corpus_hash() != corpus_hash(corpus))
+        throw Error("symbols.db is out of date; run 'moby symbols build'");
+    AvailabilityMatrix::build(corpus, db, out);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::fprintf(stderr, "availability for %zu symbols in %.1f ms -> %s\n", db.size(), ms, out.c_str());
+    return 0;
+}
+
+void print_symbol(const SymbolDb& db, std::size_t id) {
+    const SymbolRecord& r = db.at(id);
+    std::string_view name = db.name(r), parent = db.parent(r), path = db.section_path(r);
+    std::printf("%s\t%.*s\t%.*s\t%.*s\n", kind_name(r.kind), static_cast<int>(name.size()), name.data(),
+                static_cast<int>(parent.size()), parent.data(), static_cast<int>(path.size()), path.data());
+}
+
+int show(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    SymbolDb db(opts.get("db", SymbolDb::default_path(dir)));
+    AvailabilityMatrix matrix(opts.get("matrix", AvailabilityMatrix::default_path(dir)));
+    if (matrix.corpus_hash() != db.corpus_hash())
+        throw Error("availability matrix is out of date; run 'moby availability build'");
+    int status = 0;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        SymbolDb::Range range = db.find(opts.positional()[i]);
+        if (range.count == 0) {
+            std::cerr << "moby availability: no symbol " << opts.positional()[i] << '\n';
+            status = 1;
+        }
+        for (const SymbolRecord& r : range) {
+            std::size_t id = db.id_of(r);
+            print_symbol(db, id);
+            for (int p = 0; p < kPlatformCount; ++p) {
+                PlatformAvailability pa = matrix.get(id, static_cast<Platform>(p));
+                if (!pa.annotated())
+                    continue;
+                std::printf("    %-12s", platform_name(static_cast<Platform>(p)));
+                if (pa.unavailable)
+                    std::printf(" unavailable");
+                if (pa.introduced)
+                    std::printf(" introduced=%s", format_version(pa.introduced).c_str());
+                if (pa.deprecated)
+                    std::printf(" deprecated=%s", format_version(pa.deprecated).c_str());
+                if (pa.obsoleted)
+                    std::printf(" obsoleted=%s", format_version(pa.obsoleted).c_str());
+                std::printf("\n");
+            }
+        }
+    }
+    return status;
+}
+
+int query(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    SymbolDb db(opts.get("db", SymbolDb::default_path(dir)));
+    AvailabilityMatrix matrix(opts.get("matrix", AvailabilityMatrix::default_path(dir)));
+    if (matrix.corpus_hash() != db.corpus_hash())
+        throw Error("availability matrix is out of date; run 'moby availability build'");
+
+    auto start = Clock::now();
+    Bitset result(matrix.size(), true);
+    for (const std::string& arg : split_list(opts.get("available"))) {
+        auto [p, v] = platform_version_arg(arg);
+        result &= matrix.available(p, v);
+    }
+    for (const std::string& arg : split_list(opts.get("unavailable")))
+        result &= matrix.unavailable(platform_arg(arg));
+    for (const std::string& arg : split_list(opts.get("deprecated"))) {
+        auto [p, v] = platform_version_arg(arg);
+        result &= matrix.deprecated(p, v);
+    }
+    if (opts.has("kind")) {
+        SymbolKind kind;
+        if (!parse_kind(opts.get("kind"), kind))
+            throw Error("unknown kind " + opts.get("kind"));
+        Bitset of_kind(matrix.size());
+        for (std::size_t id = 0; id < db.size(); ++id)
+            if (db.at(id).kind == kind)
+                of_kind.set(id);
+        result &= of_kind;
+    }
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+    if (opts.has("count"))
+        std::printf("%zu\n", result.count());
+    else
+        result.for_each([&](std::size_t id) { print_symbol(db, id); });
+    if (opts.has("time"))
+        std::fprintf(stderr, "query: %.1f us over %zu symbols\n", us, matrix.size());
+    return 0;
+}
+
+} // namespace
+
+int cmd_availability(const Args& args) {
+    Options opts(args, {"corpus", "out", "db", "matrix", "available", "unavailable", "deprecated", "kind"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "build")
+        return build(opts);
+    if (sub == "show")
+        return show(opts);
+    if (sub == "query")
+        return query(opts);
+    return usage();
+}
+
+} // namespace moby::cli
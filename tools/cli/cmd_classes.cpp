@@ -0,0 +1,305 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/class_graph.h"
+#include "moby/symbol_db.h"
+#include "moby/work_pool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby classes build [--corpus DIR] [--out FILE] [--jobs N]\n"
+                 "       moby classes show [--corpus DIR] [--graph FILE] [--protocol] NAME...\n"
+                 "       moby classes methods [--corpus DIR] [--graph FILE] [--protocol] [--own] NAME\n"
+                 "       moby classes responds [--corpus DIR] [--graph FILE] CLASS [+|-]SELECTOR...\n"
+                 "       moby classes selector [--corpus DIR] [--graph FILE] SELECTOR...\n"
+                 "       moby classes subclasses [--corpus DIR] [--graph FILE] [--all] CLASS\n"
+                 "       moby classes conformers [--corpus DIR] [--graph FILE] PROTOCOL\n"
+                 "       moby classes stats [--corpus DIR] [--graph FILE]\n"
+                 "       moby classes bench [--corpus DIR] [--graph FILE] [--lookups N]\n";
+    return 2;
+}
+
+std::string graph_path(const Options& opts) {
+    return opts.get("graph", ClassGraph::default_path(opts.get("corpus", default_corpus_dir())));
+}
+
+std::string str(std::string_view s) { return std::string(s); }
+
+const ClassNode& find(const ClassGraph& graph, const std::string& name, bool protocol) {
+    const ClassNode* n = protocol ? graph.find_protocol(name) : graph.find_class(name);
+    if (!n)
+        throw Error(std::string(protocol ? "no protocol " : "no class ") + name);
+    return *n;
+}
+
+// "-count\tNSArray"; protocol methods add " (protocol)" and "\toptional" where marked.
+void print_method(const ClassGraph& graph, const MethodRecord& m) {
+    std::string line = m.kind == SymbolKind::ClassMethod ? "+" : "-";
+    line += graph.name(graph.selector(m.selector).name);
+    line += '\t';
+    line += graph.name(graph.unit(m.unit).name);
+    if (graph.node(graph.unit(m.unit).node).flags & ClassNode::kProtocol)
+        line += " (protocol)";
+    if (m.flags & MethodRecord::kOptional)
+        line += "\toptional";
+    if (m.flags & MethodRecord::kProperty)
+        line += "\tproperty";
+    std::printf("%s\n", line.c_str());
+}
+
+int build(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string out = opts.get("out", ClassGraph::default_path(dir));
+    auto start = Clock::now();
+    Corpus corpus(dir);
+    unsigned jobs = static_cast<unsigned>(opts.get_size("jobs", default_thread_count()));
+    std::vector<Symbol> symbols = extract_corpus_symbols(corpus, jobs);
+    auto graph_start = Clock::now();
+    ClassGraphStats stats = ClassGraph::build(corpus, symbols, out, jobs);
+    double graph_ms = std::chrono::duration<double, std::milli>(Clock::now() - graph_start).count();
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::fprintf(stderr,
+                 "%zu classes, %zu protocols, %zu external, %zu categories; %zu methods (%zu accessors), "
+                 "%zu selectors, %zu flattened entries; %.1f ms (graph %.1f ms) -> %s\n",
+                 stats.classes, stats.protocols, stats.external, stats.categories, stats.methods, stats.accessors,
+                 stats.selectors, stats.responders, ms, graph_ms, out.c_str());
+    return 0;
+}
+
+int show(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    ClassGraph graph(graph_path(opts));
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        const ClassNode& n = find(graph, opts.positional()[i], opts.has("protocol"));
+        std::string chain = str(graph.name(n.name));
+        for (const ClassNode* s = &n; s->super != ClassNode::kNone;) {
+            s = &graph.node(s->super);
+            chain += " : " + str(graph.name(s->name));
+        }
+        std::printf("%s%s\n", chain.c_str(), n.flags & ClassNode::kExternal ? " (external)" : "");
+        std::string protocols;
+        for (std::uint32_t p : graph.protocols(n))
+            protocols += (protocols.empty() ? "" : ", ") + str(graph.name(graph.node(p).name));
+        if (!protocols.empty())
+            std::printf("  conforms to %s\n", protocols.c_str());
+        for (std::uint32_t u = n.first_unit; u < n.first_unit + n.unit_count; ++u) {
+            const UnitRecord& unit = graph.unit(u);
+            std::string adopted;
+            for (std::uint32_t p : graph.adopted(unit))
+                adopted += (adopted.empty() ? " <" : ", ") + str(graph.name(graph.node(p).name));
+            if (!adopted.empty())
+                adopted += ">";
+            std::printf("  %s%s: %u methods\n", str(graph.name(unit.name)).c_str(), adopted.c_str(),
+                        unit.method_count);
+        }
+        std::printf("  responds to %u selectors\n", n.responder_count);
+    }
+    return 0;
+}
+
+int methods(const Options& opts) {
+    if (opts.positional().size() != 2)
+        return usage();
+    ClassGraph graph(graph_path(opts));
+    const ClassNode& n = find(graph, opts.positional()[1], opts.has("protocol"));
+    if (opts.has("own")) {
+        for (std::uint32_t u = n.first_unit; u < n.first_unit + n.unit_count; ++u)
+            for (std::uint32_t m = 0; m < graph.unit(u).method_count; ++m)
+                print_method(graph, graph.method(graph.unit(u).first_method + m));
+        return 0;
+    }
+    for (std::uint32_t m : graph.responders(n))
+        print_method(graph, graph.method(m));
+    return 0;
+}
+
+int responds(const Options& opts) {
+    if (opts.positional().size() < 3)
+        return usage();
+    ClassGraph graph(graph_path(opts));
+    const ClassNode& n = find(graph, opts.positional()[1], false);
+    int status = 0;
+    for (std::size_t i = 2; i < opts.positional().size(); ++i) {
+        std::string sel = opts.positional()[i];
+        bool class_side = !sel.empty() && sel[0] == '+';
+        if (!sel.empty() && (sel[0] == '+' || sel[0] == '-'))
+            sel.erase(0, 1);
+        const MethodRecord* m = graph.responds(n, graph.find_selector(sel), class_side);
+        if (m) {
+            print_method(graph, *m);
+        } else {
+            std::cerr << "moby classes: " << opts.positional()[1] << " does not respond to "
+                      << opts.positional()[i] << '\n';
+            status = 1;
+        }
+    }
+    return status;
+}
+
+int selector(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    ClassGraph graph(graph_path(opts));
+    int status = 0;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        std::uint32_t sel = graph.find_selector(opts.positional()[i]);
+        if (sel == ClassNode::kNone) {
+            std::cerr << "moby classes: no selector " << opts.positional()[i] << '\n';
+            status = 1;
+            continue;
+        }
+        for (std::uint32_t m : graph.declarers(sel))
+            print_method(graph, graph.method(m));
+    }
+    return status;
+}
+
+int subclasses(const Options& opts) {
+    if (opts.positional().size() != 2)
+        return usage();
+    ClassGraph graph(graph_path(opts));
+    std::uint32_t root = graph.index_of(find(graph, opts.positional()[1], false));
+    bool all = opts.has("all");
+    for (std::uint32_t i = 0; i < graph.node_count(); ++i) {
+        const ClassNode* n = &graph.node(i);
+        if (n->super == ClassNode::kNone || i == root)
+            continue;
+        std::uint32_t s = n->super;
+        while (all && s != root && graph.node(s).super != ClassNode::kNone)
+            s = graph.node(s).super;
+        if (s == root)
+            std::printf("%s\n", str(graph.name(n->name)).c_str());
+    }
+    return 0;
+}
+
+int conformers(const Options& opts) {
+    if (opts.positional().size() != 2)
+        return usage();
+    ClassGraph graph(graph_path(opts));
+    const ClassNode& protocol = find(graph, opts.positional()[1], true);
+    for (std::uint32_t i = 0; i < graph.node_count(); ++i) {
+        const ClassNode& n = graph.node(i);
+        if (!(n.flags & ClassNode::kProtocol) && graph.conforms(n, protocol))
+            std::printf("%s\n", str(graph.name(n.name)).c_str());
+    }
+    return 0;
+}
+
+int stats(const Options& opts) {
+    ClassGraph graph(graph_path(opts));
+    std::size_t classes = 0, protocols = 0, external = 0, responders = 0, optional = 0, accessors = 0;
+    std::uint32_t widest = 0, deepest = 0;
+    for (std::uint32_t i = 0; i < graph.node_count(); ++i) {
+        const ClassNode& n = graph.node(i);
+        external += (n.flags & ClassNode::kExternal) != 0;
+        if (n.flags & ClassNode::kExternal)
+            continue;
+        (n.flags & ClassNode::kProtocol ? protocols : classes) += 1;
+        responders += n.responder_count;
+        if (n.responder_count > graph.node(widest).responder_count)
+            widest = i;
+        if (n.depth > graph.node(deepest).depth)
+            deepest = i;
+    }
+    for (std::uint32_t i = 0; i < graph.method_count(); ++i) {
+        optional += (graph.method(i).flags & MethodRecord::kOptional) != 0;
+        accessors += (graph.method(i).flags & MethodRecord::kProperty) != 0;
+    }
+    std::printf("%-12s %zu\n%-12s %zu\n%-12s %zu\n%-12s %zu\n%-12s %zu (%zu optional, %zu accessors)\n"
+                "%-12s %zu\n%-12s %zu\n",
+                "classes", classes, "protocols", protocols, "external", external, "units", graph.unit_count(),
+                "methods", graph.method_count(), optional, accessors, "selectors", graph.selector_count(),
+                "flattened", responders);
+    std::printf("%-12s %s (%u)\n%-12s %s (%u)\n", "widest", str(graph.name(graph.node(widest).name)).c_str(),
+                graph.node(widest).responder_count, "deepest", str(graph.name(graph.node(deepest).name)).c_str(),
+                graph.node(deepest).depth);
+    return 0;
+}
+
+// Full-responder queries for random (class, selector) pairs, half of them
+// selectors the class responds to, as a completion or lint pass would issue.
+int bench(const Options& opts) {
+    auto open_start = Clock::now();
+    ClassGraph graph(graph_path(opts));
+    double open_us = std::chrono::duration<double, std::micro>(Clock::now() - open_start).count();
+    std::size_t lookups = opts.get_size("lookups", 1000000);
+    std::vector<std::uint32_t> classes;
+    for (std::uint32_t i = 0; i < graph.node_count(); ++i)
+        if (!(graph.node(i).flags & ClassNode::kProtocol) && graph.node(i).responder_count)
+            classes.push_back(i);
+    if (classes.empty() || graph.selector_count() == 0)
+        throw Error("no classes with methods");
+    std::mt19937_64 rng(42);
+    struct Query {
+        const ClassNode* node;
+        std::string_view selector;
+        bool class_side;
+    };
+    std::vector<Query> queries(lookups);
+    for (Query& q : queries) {
+        q.node = &graph.node(classes[rng() % classes.size()]);
+        std::uint32_t sel = static_cast<std::uint32_t>(rng() % graph.selector_count());
+        q.class_side = false;
+        if (rng() & 1) {
+            const MethodRecord& m = graph.method(graph.responders(*q.node).first[rng() % q.node->responder_count]);
+            sel = m.selector;
+            q.class_side = m.kind == SymbolKind::ClassMethod;
+        }
+        q.selector = graph.name(graph.selector(sel).name);
+    }
+
+    std::vector<std::uint32_t> ids(lookups);
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < lookups; ++i)
+        ids[i] = graph.find_selector(queries[i].selector);
+    double intern_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / lookups;
+    std::size_t hits = 0;
+    start = Clock::now();
+    for (std::size_t i = 0; i < lookups; ++i)
+        hits += graph.responds(*queries[i].node, ids[i], queries[i].class_side) != nullptr;
+    double responds_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / lookups;
+    std::printf("open %.1f us; %zu responder queries: selector %.1f ns + table %.1f ns (%zu hits)\n", open_us,
+                lookups, intern_ns, responds_ns, hits);
+    return 0;
+}
+
+} // namespace
+
+int cmd_classes(const Args& args) {
+    Options opts(args, {"corpus", "out", "graph", "jobs", "lookups"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "build")
+        return build(opts);
+    if (sub == "show")
+        return show(opts);
+    if (sub == "methods")
+        return methods(opts);
+    if (sub == "responds")
+        return responds(opts);
+    if (sub == "selector")
+        return selector(opts);
+    if (sub == "subclasses")
+        return subclasses(opts);
+    if (sub == "conformers")
+        return conformers(opts);
+    if (sub == "stats")
+        return stats(opts);
+    if (sub == "bench")
+        return bench(opts);
+    return usage();
+}
+
+} // namespace moby::cli
@@ -0,0 +1,119 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/conditionals.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby cond stats [--corpus DIR] [TARGET OPTIONS]\n"
+                 "       moby cond show [--corpus DIR] [TARGET OPTIONS] PATH...\n"
+                 "target options: [--platform ios] [--bits 64] [--lang objc] [--min VERSION] [--no-arc]\n"
+                 "                [--define NAME=VALUE,...]\n";
+    return 2;
+}
+
+TargetConfig target_config(const Options& opts) {
+    TargetConfig c;
+    if (opts.has("platform") && !parse_platform(opts.get("platform"), c.platform))
+        throw Error("unknown platform " + opts.get("platform"));
+    c.pointer_bits = static_cast<unsigned>(opts.get_size("bits", c.pointer_bits));
+    if (c.pointer_bits != 32 && c.pointer_bits != 64)
+        throw Error("--bits must be 32 or 64");
+    if (opts.has("lang") && !parse_language(opts.get("lang"), c.language))
+        throw Error("unknown language " + opts.get("lang"));
+    if (opts.has("min") && !(c.min_version = parse_version(opts.get("min"))))
+        throw Error("bad version " + opts.get("min"));
+    c.arc = !opts.has("no-arc");
+    for (const std::string& d : split_list(opts.get("define"))) {
+        std::size_t eq = d.find('=');
+        c.defines.emplace_back(d.substr(0, eq), eq == std::string::npos ? "1" : d.substr(eq + 1));
+    }
+    return c;
+}
+
+double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Evaluates every section for the target, then again from the cache.
+int stats(const Options& opts) {
+    auto start = Clock::now();
+    Corpus corpus(opts.get("corpus", default_corpus_dir()));
+    ConditionalViews views(corpus);
+    double open_ms = ms_since(start);
+
+    start = Clock::now();
+    std::size_t conditionals = views.conditional_count();
+    double skeleton_ms = ms_since(start);
+
+    start = Clock::now();
+    const TargetView& view = views.view(target_config(opts));
+    std::size_t live = 0;
+    for (std::uint32_t i = 0; i < corpus.sections().size(); ++i)
+        live += view.live_bytes(i);
+    double evaluate_ms = ms_since(start);
+
+    start = Clock::now();
+    const TargetView& again = views.view(target_config(opts));
+    std::size_t cached = 0;
+    for (std::uint32_t i = 0; i < corpus.sections().size(); ++i)
+        cached += again.live_bytes(i);
+    double cached_ms = ms_since(start);
+
+    std::size_t total = 0;
+    for (const Section& s : corpus.sections())
+        total += s.text.size();
+    std::printf("%s: %zu conditionals, %zu unparsable; %.2f of %.2f MB live (%.1f%%)\n",
+                view.config().name().c_str(), conditionals, view.stats().errors, live / 1e6, total / 1e6,
+                100.0 * live / total);
+    std::printf("open %.1f ms, directive scan %.1f ms, evaluation %.1f ms, cached %.3f ms%s\n", open_ms,
+                skeleton_ms, evaluate_ms, cached_ms, cached == live ? "" : " (MISMATCH)");
+    return 0;
+}
+
+int show(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    Corpus corpus(opts.get("corpus", default_corpus_dir()));
+    ConditionalViews views(corpus);
+    const TargetView& view = views.view(target_config(opts));
+    int status = 0;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        const std::string& path = opts.positional()[i];
+        std::uint32_t found = 0;
+        while (found < corpus.sections().size() && corpus.sections()[found].path != path)
+            ++found;
+        if (found == corpus.sections().size()) {
+            std::cerr << "moby cond: no section " << path << '\n';
+            status = 1;
+            continue;
+        }
+        std::string_view text = view.text(found);
+        std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+    return status;
+}
+
+} // namespace
+
+int cmd_cond(const Args& args) {
+    Options opts(args, {"corpus", "platform", "bits", "lang", "min", "define"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "stats")
+        return stats(opts);
+    if (sub == "show")
+        return show(opts);
+    return usage();
+}
+
+} // namespace moby::cli
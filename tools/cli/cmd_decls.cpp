@@ -0,0 +1,202 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/decl_cache.h"
+#include "moby/error.h"
+#include "moby/section_index.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <random>
+
+namespace fs = std::filesystem;
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int usage() {
+    std::cerr << "usage: moby decls build [--corpus DIR] [--out FILE] [--jobs N]\n"
+                 "       moby decls show [--corpus DIR] [--cache FILE] [--verify] NAME...\n"
+                 "       moby decls stats [--corpus DIR] [--cache FILE]\n"
+                 "       moby decls bench [--corpus DIR] [--rounds N] [--queries N]\n";
+    return 2;
+}
+
+std::string cache_path(const Options& opts) {
+    return opts.get("cache", DeclCache::default_path(opts.get("corpus", default_corpus_dir())));
+}
+
+int build(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string out = opts.get("out", DeclCache::default_path(dir));
+    auto start = Clock::now();
+    Corpus corpus(dir);
+    DeclCacheStats stats = DeclCache::build(corpus, out, static_cast<unsigned>(opts.get_size("jobs", 0)));
+    std::fprintf(stderr, "%zu declarations, %zu parts, %zu distinct availabilities; %.1f MB; parsed in %.1f ms, "
+                         "%.1f ms total -> %s\n",
+                 stats.decls, stats.parts, stats.availabilities, stats.bytes / 1e6, stats.parse_ms, ms_since(start),
+                 out.c_str());
+    return 0;
+}
+
+// Opens the cache and refuses one older than the corpus: by file stamps, or
+// with --verify by the content hash.
+DeclCache open_current(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    DeclCache cache(cache_path(opts));
+    bool current = opts.has("verify") ? cache.corpus_hash() == corpus_hash(Corpus(dir)) : cache.is_current(dir);
+    if (!current)
+        throw Error("decls.cache is out of date; run 'moby decls build'");
+    return cache;
+}
+
+void print_availability(const Availability& a) {
+    for (int p = 0; p < kPlatformCount; ++p) {
+        const PlatformAvailability& pa = a.platforms[p];
+        if (!pa.annotated())
+            continue;
+        std::printf(" %s", platform_name(static_cast<Platform>(p)));
+        if (pa.unavailable)
+            std::printf("(unavailable)");
+        else if (pa.deprecated)
+            std::printf("(%s-%s)", format_version(pa.introduced).c_str(), format_version(pa.deprecated).c_str());
+        else if (pa.introduced)
+            std::printf("(%s)", format_version(pa.introduced).c_str());
+    }
+}
+
+void print_decl(const DeclCache& cache, const DeclRecord& d, const char* indent) {
+    std::printf("%s%s\t%s", indent, cache.signature(d).c_str(), kind_name(d.kind));
+    print_availability(cache.availability(d));
+    std::printf("\n");
+}
+
+int show(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    DeclCache cache = open_current(opts);
+    int status = 0;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        DeclCache::Ids ids = cache.find(opts.positional()[i]);
+        if (ids.count == 0) {
+            std::fprintf(stderr, "%s: not declared\n", opts.positional()[i].c_str());
+            status = 1;
+        }
+        for (std::uint32_t id : ids) {
+            const DeclRecord& d = cache.at(id);
+            std::string_view path = cache.section_path(d);
+            std::printf("%.*s\n", static_cast<int>(path.size()), path.data());
+            print_decl(cache, d, "  ");
+            // Members are the records up to `end`; each skips its own.
+            for (std::uint32_t m = id + 1; m < d.end; m = cache.at(m).end)
+                print_decl(cache, cache.at(m), "    ");
+        }
+    }
+    return status;
+}
+
+int stats(const Options& opts) {
+    DeclCache cache(cache_path(opts));
+    std::size_t by_kind[kSymbolKindCount] = {}, parts = 0, variadic = 0;
+    for (std::size_t id = 0; id < cache.size(); ++id) {
+        const DeclRecord& d = cache.at(id);
+        ++by_kind[static_cast<int>(d.kind)];
+        parts += d.part_count;
+        variadic += (d.flags & DeclRecord::kVariadic) != 0;
+    }
+    for (int k = 0; k < kSymbolKindCount; ++k)
+        std::printf("%-16s %zu\n", kind_name(static_cast<SymbolKind>(k)), by_kind[k]);
+    std::printf("%-16s %zu\n%-16s %zu\n%-16s %zu\n%-16s %s\n", "declarations", cache.size(), "parts", parts,
+                "variadic", variadic, "current", cache.is_current(opts.get("corpus", default_corpus_dir())) ? "yes" : "no");
+    return 0;
+}
+
+// Startup as a tool sees it: parsing the corpus into the declaration model,
+// against opening the cache, checking its stamps and answering a first
+// query (NSFileManager with its members and their availability). Then random
+// lookups by name.
+int bench(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::size_t rounds = opts.get_size("rounds", 5);
+    std::size_t queries = opts.get_size("queries", 1000000);
+    std::string path = (fs::temp_directory_path() / "moby-decls-bench.cache").string();
+
+    double parse_best = 1e300;
+    DeclCacheStats built;
+    for (std::size_t round = 0; round < rounds; ++round) {
+        auto start = Clock::now();
+        Corpus corpus(dir);
+        double open_ms = ms_since(start);
+        built = DeclCache::build(corpus, path);
+        parse_best = std::min(parse_best, open_ms + built.parse_ms);
+    }
+
+    double cached_best = 1e300;
+    std::size_t members = 0, annotated = 0;
+    for (std::size_t round = 0; round < rounds; ++round) {
+        auto start = Clock::now();
+        DeclCache cache(path);
+        if (!cache.is_current(dir))
+            throw Error("decls bench: cache not current");
+        members = annotated = 0;
+        for (std::uint32_t id : cache.find("NSFileManager")) {
+            const DeclRecord& d = cache.at(id);
+            for (std::uint32_t m = id + 1; m < d.end; m = cache.at(m).end, ++members)
+                annotated += cache.availability(cache.at(m))[Platform::IOS].annotated();
+        }
+        cached_best = std::min(cached_best, ms_since(start));
+    }
+
+    DeclCache cache(path);
+    std::mt19937_64 rng(42);
+    std::vector<std::string> names(queries);
+    for (std::string& n : names)
+        n = std::string(cache.str(cache.at(rng() % cache.size()).name));
+    auto start = Clock::now();
+    std::size_t found = 0, signature_bytes = 0;
+    for (const std::string& n : names)
+        found += cache.find(n).count;
+    double find_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / queries;
+    start = Clock::now();
+    for (const std::string& n : names)
+        signature_bytes += cache.signature(cache.at(*cache.find(n).begin())).size();
+    double signature_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / queries;
+    fs::remove(path);
+
+    std::printf("%zu declarations, %zu parts, %.1f MB cache (best of %zu)\n", built.decls, built.parts,
+                built.bytes / 1e6, rounds);
+    std::printf("%-28s %8.2f ms\n", "parse corpus", parse_best);
+    std::printf("%-28s %8.2f ms  (%zu NSFileManager members, %zu annotated for iOS)  %.0fx\n", "open cache + first query",
+                cached_best, members, annotated, parse_best / cached_best);
+    std::printf("%-28s %8.0f ns  (%zu found)\n%-28s %8.0f ns  (%zu bytes)\n", "find by name", find_ns, found,
+                "find + signature", signature_ns, signature_bytes);
+    return members ? 0 : 1;
+}
+
+} // namespace
+
+int cmd_decls(const Args& args) {
+    Options opts(args, {"corpus", "out", "jobs", "cache", "rounds", "queries"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "build")
+        return build(opts);
+    if (sub == "show")
+        return show(opts);
+    if (sub == "stats")
+        return stats(opts);
+    if (sub == "bench")
+        return bench(opts);
+    return usage();
+}
+
+} // namespace moby::cli
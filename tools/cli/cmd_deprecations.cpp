@@ -0,0 +1,245 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/deprecations.h"
+#include "moby/mapped_file.h"
+#include "moby/section_index.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby deprecations build [--corpus DIR] [--db FILE] [--out FILE]\n"
+                 "       moby deprecations show [--corpus DIR] [--table FILE] NAME...\n"
+                 "       moby deprecations scan [--corpus DIR] [--table FILE] PATH...\n"
+                 "       moby deprecations stats [--corpus DIR] [--table FILE]\n"
+                 "       moby deprecations bench [--corpus DIR] [--table FILE] [--rounds N]\n";
+    return 2;
+}
+
+std::string table_path(const Options& opts) {
+    return opts.get("table", DeprecationTable::default_path(opts.get("corpus", default_corpus_dir())));
+}
+
+// "NSFoo.bar", or just the name for top-level declarations.
+std::string qualified(const DeprecationTable& table, const DeprecationRecord& r) {
+    std::string out(table.str(r.parent));
+    if (!out.empty())
+        out += ' ';
+    return out += table.str(r.name);
+}
+
+std::string versions(const DeprecationRecord& r) {
+    std::string out;
+    for (int p = 0; p < kPlatformCount; ++p) {
+        if (!r.deprecated[p])
+            continue;
+        if (!out.empty())
+            out += ", ";
+        out += platform_name(static_cast<Platform>(p));
+        out += ' ';
+        out += format_version(r.deprecated[p]);
+    }
+    return out;
+}
+
+int build(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string out = opts.get("out", DeprecationTable::default_path(dir));
+    auto start = Clock::now();
+    Corpus corpus(dir);
+    SymbolDb db(opts.get("db", SymbolDb::default_path(dir)));
+    if (db.corpus_hash() != corpus_hash(corpus))
+        throw Error("symbols.db is out of date; run 'moby symbols build'");
+    DeprecationStats stats = DeprecationTable::build(corpus, db, out);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::fprintf(stderr,
+                 "%zu deprecated declarations; replacements: %zu from macros, %zu from messages, %zu inferred; "
+                 "%zu patterns (%zu shared), %zu states in %zu slots; %.1f ms -> %s\n",
+                 stats.deprecated, stats.by_macro, stats.by_message, stats.inferred, stats.patterns, stats.shared,
+                 stats.states, stats.slots, ms, out.c_str());
+    return 0;
+}
+
+int show(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    DeprecationTable table(table_path(opts));
+    int status = 0;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        std::vector<std::uint32_t> ids = table.find(opts.positional()[i]);
+        if (ids.empty()) {
+            std::cerr << "moby deprecations: " << opts.positional()[i] << " is not deprecated\n";
+            status = 1;
+        }
+        for (std::uint32_t id : ids) {
+            const DeprecationRecord& r = table.record(id);
+            std::printf("%s\t%s\t%s\n", kind_name(r.kind), qualified(table, r).c_str(), versions(r).c_str());
+            if (!table.str(r.replacement).empty())
+                std::printf("    replacement %.*s (%s)\n", static_cast<int>(table.str(r.replacement).size()),
+                            table.str(r.replacement).data(), replacement_source_name(r.source));
+            if (!table.str(r.message).empty())
+                std::printf("    message     %.*s\n", static_cast<int>(table.str(r.message).size()),
+                            table.str(r.message).data());
+        }
+    }
+    return status;
+}
+
+bool is_source(const fs::path& p) {
+    static constexpr std::string_view kExtensions[] = {".h", ".m", ".mm", ".c", ".cc", ".cpp", ".hpp"};
+    std::string ext = p.extension().string();
+    return std::find(std::begin(kExtensions), std::end(kExtensions), ext) != std::end(kExtensions);
+}
+
+// Prints "path:line:col: name -> replacement (Parent)" for every use, with up
+// to three candidates when several declarations share the spelling (only
+// those of the receiver's class, when the hit names one).
+std::size_t report(const DeprecationTable& table, const std::string& path, std::string_view text,
+                   const std::vector<DeprecationHit>& hits) {
+    std::size_t line = 1, line_start = 0, pos = 0;
+    for (const DeprecationHit& h : hits) {
+        for (; pos < h.offset; ++pos)
+            if (text[pos] == '\n') {
+                ++line;
+                line_start = pos + 1;
+            }
+        std::string_view spelled = text.substr(h.offset, h.length);
+        std::printf("%s:%zu:%zu: %.*s", path.c_str(), line, static_cast<std::size_t>(h.offset - line_start + 1),
+                    static_cast<int>(spelled.size()), spelled.data());
+        std::string_view receiver = text.substr(h.receiver, h.receiver_length);
+        std::vector<std::uint32_t> records;
+        for (std::uint32_t id : table.records(h.pattern))
+            if (receiver.empty() || table.str(table.record(id).parent) == receiver)
+                records.push_back(id);
+        std::size_t shown = 0;
+        for (std::uint32_t id : records) {
+            if (shown == 3) {
+                std::printf(" (+%zu more)", records.size() - shown);
+                break;
+            }
+            const DeprecationRecord& r = table.record(id);
+            std::string_view replacement = table.str(r.replacement);
+            if (replacement.empty())
+                replacement = "?";
+            std::printf("%s %.*s", shown ? ";" : " ->", static_cast<int>(replacement.size()), replacement.data());
+            if (!table.str(r.parent).empty())
+                std::printf(" (%.*s)", static_cast<int>(table.str(r.parent).size()), table.str(r.parent).data());
+            ++shown;
+        }
+        std::printf("\n");
+    }
+    return hits.size();
+}
+
+int scan(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    DeprecationTable table(table_path(opts));
+    std::vector<std::string> files;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        fs::path root = opts.positional()[i];
+        if (!fs::is_directory(root)) {
+            files.push_back(root.string());
+            continue;
+        }
+        for (const auto& entry : fs::recursive_directory_iterator(root))
+            if (entry.is_regular_file() && is_source(entry.path()))
+                files.push_back(entry.path().string());
+    }
+    std::sort(files.begin(), files.end());
+    auto start = Clock::now();
+    std::size_t bytes = 0, uses = 0;
+    std::vector<DeprecationHit> hits;
+    for (const std::string& path : files) {
+        MappedFile map(path);
+        std::string_view text(map.data(), map.size());
+        hits.clear();
+        table.scan(text, hits);
+        uses += report(table, path, text, hits);
+        bytes += text.size();
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::fprintf(stderr, "%zu uses in %zu files (%.1f MB); %.1f ms\n", uses, files.size(), bytes / 1e6, ms);
+    return uses ? 1 : 0;
+}
+
+int stats(const Options& opts) {
+    DeprecationTable table(table_path(opts));
+    std::size_t by_source[4] = {}, by_kind[32] = {};
+    for (std::size_t i = 0; i < table.size(); ++i) {
+        ++by_source[static_cast<int>(table.record(i).source)];
+        ++by_kind[static_cast<int>(table.record(i).kind) & 31];
+    }
+    std::printf("%-16s %zu\n", "deprecated", table.size());
+    for (int s = 0; s < 4; ++s)
+        std::printf("  %-14s %zu\n", replacement_source_name(static_cast<ReplacementSource>(s)), by_source[s]);
+    for (int k = 0; k < 32; ++k)
+        if (by_kind[k])
+            std::printf("  %-14s %zu\n", kind_name(static_cast<SymbolKind>(k)), by_kind[k]);
+    std::size_t shared = 0;
+    for (std::size_t p = 0; p < table.pattern_count(); ++p)
+        shared += (table.pattern(p).flags & DeprecationPattern::kShared) != 0;
+    std::printf("%-16s %zu\n  %-14s %zu\n%-16s %zu (%.1f KB)\n", "patterns", table.pattern_count(), "shared", shared,
+                "slots", table.slot_count(), table.slot_count() * 12 / 1024.0);
+    return 0;
+}
+
+// The corpus itself as client text: one pass over every file, repeated.
+int bench(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    auto open_start = Clock::now();
+    DeprecationTable table(table_path(opts));
+    double open_us = std::chrono::duration<double, std::micro>(Clock::now() - open_start).count();
+    Corpus corpus(dir);
+    std::size_t rounds = opts.get_size("rounds", 5);
+    std::vector<DeprecationHit> hits;
+    std::size_t bytes = 0, uses = 0;
+    double best = 1e300;
+    for (std::size_t round = 0; round < rounds; ++round) {
+        auto start = Clock::now();
+        bytes = uses = 0;
+        for (const auto& file : corpus.files()) {
+            hits.clear();
+            table.scan(file.map.view(), hits);
+            uses += hits.size();
+            bytes += file.map.size();
+        }
+        best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    std::printf("open %.1f us; %zu patterns; %.1f MB scanned in %.1f ms (best of %zu): %.0f MB/s, %zu uses\n",
+                open_us, table.pattern_count(), bytes / 1e6, best * 1e3, rounds, bytes / 1e6 / best, uses);
+    return 0;
+}
+
+} // namespace
+
+int cmd_deprecations(const Args& args) {
+    Options opts(args, {"corpus", "db", "out", "table", "rounds"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "build")
+        return build(opts);
+    if (sub == "show")
+        return show(opts);
+    if (sub == "scan")
+        return scan(opts);
+    if (sub == "stats")
+        return stats(opts);
+    if (sub == "bench")
+        return bench(opts);
+    return usage();
+}
+
+} // namespace moby::cli
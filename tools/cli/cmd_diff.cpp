@@ -0,0 +1,107 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/sdk_diff.h"
+#include "moby/work_pool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <map>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby diff [--framework NAME] [--summary] [--verbose] [--jobs N] OLD_DIR NEW_DIR\n";
+    return 2;
+}
+
+std::string display_name(const Symbol& s) {
+    switch (s.kind) {
+    case SymbolKind::ClassMethod:
+        return "+[" + s.parent + " " + s.name + "]";
+    case SymbolKind::InstanceMethod:
+        return "-[" + s.parent + " " + s.name + "]";
+    case SymbolKind::Property:
+    case SymbolKind::EnumConstant:
+        return s.parent.empty() ? s.name : s.parent + "." + s.name;
+    default:
+        return s.name;
+    }
+}
+
+struct Counts {
+    std::size_t added = 0, removed = 0, changed = 0;
+};
+
+} // namespace
+
+// Prints what changed per framework, like a symbol-level `diff -r`; exits
+// with 1 when the snapshots differ.
+int cmd_diff(const Args& args) {
+    Options opts(args, {"framework", "jobs"});
+    if (opts.positional().size() != 2)
+        return usage();
+    unsigned jobs = static_cast<unsigned>(opts.get_size("jobs", default_thread_count()));
+    std::string only = opts.get("framework");
+    bool summary = opts.has("summary"), verbose = opts.has("verbose");
+
+    auto start = Clock::now();
+    ApiSnapshot before(opts.positional()[0], jobs);
+    ApiSnapshot after(opts.positional()[1], jobs);
+    auto parsed = Clock::now();
+    std::vector<ApiDiff> diffs = diff_apis(before, after);
+    auto compared = Clock::now();
+
+    std::map<std::string, Counts> counts;
+    std::string_view current;
+    for (const ApiDiff& d : diffs) {
+        const ApiSnapshot& snap = d.after ? after : before;
+        const ApiFingerprint& api = d.after ? *d.after : *d.before;
+        std::string_view framework = snap.framework(api);
+        if (!only.empty() && framework != only)
+            continue;
+        Counts& c = counts[std::string(framework)];
+        (d.changes & kApiAdded ? c.added : d.changes & kApiRemoved ? c.removed : c.changed)++;
+        if (summary)
+            continue;
+        if (framework != current) {
+            std::printf("%s%.*s\n", current.empty() ? "" : "\n", static_cast<int>(framework.size()), framework.data());
+            current = framework;
+        }
+        const Symbol& s = snap.symbols()[api.symbol];
+        char mark = d.changes & kApiAdded ? '+' : d.changes & kApiRemoved ? '-' : '~';
+        std::printf("  %c %-16s %s", mark, kind_name(s.kind), display_name(s).c_str());
+        if (d.changes & kApiDeclarationChanged)
+            std::printf("  declaration");
+        if (d.changes & kApiAvailabilityChanged)
+            std::printf("  availability: %s -> %s", describe_availability(before.availability(*d.before)).c_str(),
+                        describe_availability(after.availability(*d.after)).c_str());
+        std::printf("\n");
+        if (verbose && (d.changes & kApiDeclarationChanged)) {
+            std::printf("      - %s\n", normalized_declaration(s.kind, before.declaration_text(*d.before)).c_str());
+            std::printf("      + %s\n", normalized_declaration(s.kind, after.declaration_text(*d.after)).c_str());
+        }
+    }
+    if (summary) {
+        std::printf("%-32s %8s %8s %8s\n", "framework", "added", "removed", "changed");
+        for (const auto& [name, c] : counts)
+            std::printf("%-32s %8zu %8zu %8zu\n", name.c_str(), c.added, c.removed, c.changed);
+    }
+
+    double parse_s = std::chrono::duration<double>(parsed - start).count();
+    double diff_ms = std::chrono::duration<double, std::milli>(compared - parsed).count();
+    double total_s = std::chrono::duration<double>(Clock::now() - start).count();
+    std::uint64_t bytes = before.corpus().total_bytes() + after.corpus().total_bytes();
+    std::fprintf(stderr,
+                 "%zu vs %zu APIs, %zu differences; %.1f MB parsed and fingerprinted in %.2f s (%.0f MB/s), "
+                 "compared in %.1f ms, %.2f s in all\n",
+                 before.apis().size(), after.apis().size(), diffs.size(), bytes / 1e6, parse_s,
+                 bytes / 1e6 / parse_s, diff_ms, total_s);
+    return counts.empty() ? 0 : 1;
+}
+
+} // namespace moby::cli
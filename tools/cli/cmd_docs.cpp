@@ -0,0 +1,244 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/doc_store.h"
+#include "moby/error.h"
+#include "moby/section_index.h"
+#include "moby/symbol_db.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <random>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby docs build [--corpus DIR] [--db FILE] [--out FILE] [--block-size N] [--level N]\n"
+                 "                       [--dictionary BYTES] [--jobs N]\n"
+                 "       moby docs show [--corpus DIR] [--store FILE] NAME...\n"
+                 "       moby docs stats [--corpus DIR] [--store FILE]\n"
+                 "       moby docs bench [--corpus DIR] [--store FILE] [--queries N]\n";
+    return 2;
+}
+
+std::string store_path(const Options& opts) {
+    return opts.get("store", DocStore::default_path(opts.get("corpus", default_corpus_dir())));
+}
+
+SymbolDb open_db(const Options& opts, const DocStore& store) {
+    SymbolDb db(opts.get("db", SymbolDb::default_path(opts.get("corpus", default_corpus_dir()))));
+    if (store.corpus_hash() != db.corpus_hash() || store.symbol_count() != db.size())
+        throw Error("docs.store is out of date; run 'moby docs build'");
+    return db;
+}
+
+int build(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string out = opts.get("out", DocStore::default_path(dir));
+    DocStoreOptions options;
+    options.block_size = opts.get_size("block-size", options.block_size);
+    options.level = static_cast<int>(opts.get_size("level", options.level));
+    options.dictionary_size = opts.get_size("dictionary", options.dictionary_size);
+    options.threads = static_cast<unsigned>(opts.get_size("jobs", 0));
+    auto start = Clock::now();
+    Corpus corpus(dir);
+    SymbolDb db(opts.get("db", SymbolDb::default_path(dir)));
+    if (db.corpus_hash() != corpus_hash(corpus))
+        throw Error("symbols.db is out of date; run 'moby symbols build'");
+    DocStoreStats stats = DocStore::build(corpus, db, out, options);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::fprintf(stderr,
+                 "%zu doc comments, %zu attached; %zu symbols documented (%zu from their container); "
+                 "%zu blocks, %.1f KB -> %.1f KB; %.1f ms -> %s\n",
+                 stats.comments, stats.attached, stats.documented, stats.inherited, stats.blocks,
+                 stats.raw_bytes / 1e3, stats.stored_bytes / 1e3, ms, out.c_str());
+    return 0;
+}
+
+// Text indented by `indent` on every line.
+void print_text(const std::string& text, const char* indent) {
+    std::size_t begin = 0;
+    while (begin <= text.size()) {
+        std::size_t end = text.find('\n', begin);
+        if (end == std::string::npos)
+            end = text.size();
+        if (end > begin)
+            std::printf("%s%.*s", indent, static_cast<int>(end - begin), text.data() + begin);
+        std::printf("\n");
+        begin = end + 1;
+    }
+}
+
+void print_doc(const DocComment& doc) {
+    for (const DocTag& t : doc.tags) {
+        if (t.tag == "abstract" || t.tag == "discussion") {
+            print_text(t.text, "    ");
+        } else if (!t.name.empty()) {
+            std::printf("    @%s %s\n", t.tag.c_str(), t.name.c_str());
+            if (!t.text.empty())
+                print_text(t.text, "        ");
+        } else {
+            std::printf("    @%s\n", t.tag.c_str());
+            if (!t.text.empty())
+                print_text(t.text, "        ");
+        }
+    }
+}
+
+int show(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    DocStore store(store_path(opts));
+    SymbolDb db = open_db(opts, store);
+    int status = 0;
+    DocComment doc;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        SymbolDb::Range range = db.find(opts.positional()[i]);
+        if (range.count == 0) {
+            std::cerr << "moby docs: no symbol " << opts.positional()[i] << '\n';
+            status = 1;
+        }
+        for (const SymbolRecord& r : range) {
+            std::string_view name = db.name(r), parent = db.parent(r), path = db.section_path(r);
+            std::printf("%s %.*s%s%.*s\t%.*s\n", kind_name(r.kind), static_cast<int>(name.size()), name.data(),
+                        parent.empty() ? "" : " in ", static_cast<int>(parent.size()), parent.data(),
+                        static_cast<int>(path.size()), path.data());
+            if (store.read(static_cast<std::uint32_t>(db.id_of(r)), doc))
+                print_doc(doc);
+            else
+                std::printf("    (undocumented)\n");
+        }
+    }
+    return status;
+}
+
+int stats(const Options& opts) {
+    DocStore store(store_path(opts));
+    SymbolDb db = open_db(opts, store);
+    std::size_t total[kSymbolKindCount] = {}, documented[kSymbolKindCount] = {};
+    for (std::size_t id = 0; id < db.size(); ++id)
+        ++total[static_cast<int>(db.at(id).kind)];
+    std::map<std::string, std::size_t> tags;
+    std::size_t raw = 0, stored = 0;
+    DocComment doc;
+    for (std::size_t i = 0; i < store.size(); ++i) {
+        const DocEntry& e = store.entry(i);
+        ++documented[static_cast<int>(db.at(e.symbol).kind)];
+        store.read(e, doc);
+        for (const DocTag& t : doc.tags)
+            ++tags[t.tag];
+    }
+    for (std::size_t b = 0; b < store.block_count(); ++b) {
+        raw += store.block(b).length;
+        stored += store.block(b).stored;
+    }
+    for (int k = 0; k < kSymbolKindCount; ++k)
+        std::printf("%-16s %6zu of %6zu documented\n", kind_name(static_cast<SymbolKind>(k)), documented[k], total[k]);
+    std::vector<std::pair<std::size_t, std::string>> by_count;
+    for (const auto& [tag, n] : tags)
+        by_count.emplace_back(n, tag);
+    std::sort(by_count.rbegin(), by_count.rend());
+    std::printf("\ntags (symbols carrying them):\n");
+    for (std::size_t i = 0; i < by_count.size() && i < 12; ++i)
+        std::printf("  %-14s %zu\n", by_count[i].second.c_str(), by_count[i].first);
+    std::printf("\n%zu documented symbols in %zu blocks: %.1f KB -> %.1f KB stored, %.1f KB average block\n",
+                store.size(), store.block_count(), raw / 1e3, stored / 1e3,
+                store.block_count() ? raw / 1e3 / store.block_count() : 0.0);
+    return 0;
+}
+
+// Hover documentation for random documented symbols: read from the store
+// (one block inflated per lookup, as the symbols are spread over the corpus)
+// against what a tool without it does, finding the last doc comment ahead of
+// the declaration and parsing it. That scan runs over the amalgamated file up
+// to the declaration, or over just its header section when the tool has
+// split the corpus already.
+int bench(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::size_t queries = opts.get_size("queries", 100000);
+    Corpus corpus(dir);
+    DocStore store(store_path(opts));
+    SymbolDb db = open_db(opts, store);
+    if (store.size() == 0)
+        throw Error("docs bench: no documented symbols");
+
+    std::mt19937_64 rng(42);
+    std::vector<std::uint32_t> picks(queries);
+    for (std::uint32_t& p : picks)
+        p = store.entry(rng() % store.size()).symbol;
+
+    DocComment doc;
+    std::size_t tags = 0, inflated = 0;
+    std::uint32_t last_block = ~0u;
+    auto start = Clock::now();
+    for (std::uint32_t id : picks) {
+        const DocEntry* e = store.find(id);
+        inflated += e->block != last_block;
+        last_block = e->block;
+        store.read(*e, doc);
+        tags += doc.tags.size();
+    }
+    double store_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / queries;
+
+    // The scans are slow enough that a sample of the lookups does.
+    std::size_t scan_queries = std::min<std::size_t>(queries, 1000);
+    auto scan = [&](bool whole_file, std::size_t& scanned) {
+        scanned = 0;
+        auto begin_scan = Clock::now();
+        for (std::size_t q = 0; q < scan_queries; ++q) {
+            const SymbolRecord& r = db.at(picks[q]);
+            const Section& s = corpus.sections()[r.section];
+            std::string_view text = whole_file ? corpus.files()[s.file].map.view() : s.text;
+            std::size_t limit = r.offset - (whole_file ? 0 : s.offset), found_begin = 0, found_end = 0;
+            for_each_doc_comment(text.substr(0, limit), [&](std::size_t begin, std::size_t end) {
+                found_begin = begin;
+                found_end = end;
+            });
+            scanned += limit;
+            parse_doc_comment(text.substr(found_begin, found_end - found_begin), doc);
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - begin_scan).count() / scan_queries;
+    };
+    std::size_t section_bytes = 0, file_bytes = 0;
+    double section_ns = scan(false, section_bytes);
+    double file_ns = scan(true, file_bytes);
+
+    std::size_t stored = 0;
+    for (std::size_t b = 0; b < store.block_count(); ++b)
+        stored += store.block(b).stored;
+    std::printf("%zu documented symbols in %zu blocks, %.1f KB stored per block on average\n", store.size(),
+                store.block_count(), stored / 1e3 / store.block_count());
+    std::printf("%-20s %10.1f us  (%zu tags, %.1f%% of lookups inflated a block)\n", "doc store", store_ns / 1e3,
+                tags, 100.0 * inflated / queries);
+    std::printf("%-20s %10.1f us  (%.1f KB scanned per lookup)  %.0fx\n", "scan header section", section_ns / 1e3,
+                section_bytes / 1e3 / scan_queries, section_ns / store_ns);
+    std::printf("%-20s %10.1f us  (%.1f KB scanned per lookup)  %.0fx\n", "scan corpus file", file_ns / 1e3,
+                file_bytes / 1e3 / scan_queries, file_ns / store_ns);
+    return 0;
+}
+
+} // namespace
+
+int cmd_docs(const Args& args) {
+    Options opts(args, {"corpus", "db", "out", "store", "block-size", "level", "dictionary", "jobs", "queries"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "build")
+        return build(opts);
+    if (sub == "show")
+        return show(opts);
+    if (sub == "stats")
+        return stats(opts);
+    if (sub == "bench")
+        return bench(opts);
+    return usage();
+}
+
+} // namespace moby::cli
@@ -0,0 +1,233 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/enum_table.h"
+#include "moby/symbol_db.h"
+#include "moby/work_pool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby enums build [--corpus DIR] [--out FILE] [--jobs N]\n"
+                 "       moby enums get [--corpus DIR] [--table FILE] NAME...\n"
+                 "       moby enums value [--corpus DIR] [--table FILE] [--enum ENUM] VALUE...\n"
+                 "       moby enums show [--corpus DIR] [--table FILE] ENUM...\n"
+                 "       moby enums stats [--corpus DIR] [--table FILE] [--unresolved]\n"
+                 "       moby enums bench [--corpus DIR] [--table FILE] [--lookups N]\n";
+    return 2;
+}
+
+std::string table_path(const Options& opts) {
+    return opts.get("table", EnumTable::default_path(opts.get("corpus", default_corpus_dir())));
+}
+
+// Decimal, 0x hex, negative, or a four-character code such as 'wav '.
+bool parse_value(const std::string& s, std::int64_t& v) {
+    if (s.size() == 6 && s.front() == '\'' && s.back() == '\'') {
+        v = 0;
+        for (std::size_t i = 1; i < 5; ++i)
+            v = v << 8 | static_cast<unsigned char>(s[i]);
+        return true;
+    }
+    char* end = nullptr;
+    v = s[0] == '-' ? std::strtoll(s.c_str(), &end, 0)
+                    : static_cast<std::int64_t>(std::strtoull(s.c_str(), &end, 0));
+    return !s.empty() && *end == 0;
+}
+
+void print_constant(const EnumTable& table, std::uint32_t id) {
+    const ConstantRecord& c = table.constant(id);
+    const EnumRecord& e = table.enum_of(c);
+    std::string_view name = table.name(c.name), owner = table.name(e.name);
+    const char* inactive = c.flags & ConstantRecord::kInactive ? "\tinactive" : "";
+    if (c.flags & ConstantRecord::kResolved)
+        std::printf("%.*s\t%.*s\t%lld\t0x%llx%s\n", static_cast<int>(name.size()), name.data(),
+                    static_cast<int>(owner.size()), owner.data(), static_cast<long long>(c.value),
+                    static_cast<unsigned long long>(c.value), inactive);
+    else
+        std::printf("%.*s\t%.*s\t?%s\n", static_cast<int>(name.size()), name.data(), static_cast<int>(owner.size()),
+                    owner.data(), inactive);
+}
+
+int build(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string out = opts.get("out", EnumTable::default_path(dir));
+    auto start = Clock::now();
+    Corpus corpus(dir);
+    unsigned jobs = static_cast<unsigned>(opts.get_size("jobs", default_thread_count()));
+    std::vector<Symbol> symbols = extract_corpus_symbols(corpus, jobs);
+    auto fold_start = Clock::now();
+    TargetConfig target;
+    EnumBuildStats stats = EnumTable::build(corpus, symbols, out, target);
+    double fold_ms = std::chrono::duration<double, std::milli>(Clock::now() - fold_start).count();
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::fprintf(stderr,
+                 "%zu enums (%zu option sets), %zu of %zu constants resolved in %zu passes, %zu inactive for %s; "
+                 "%.1f ms (folding %.1f ms) -> %s\n",
+                 stats.enums, stats.options, stats.resolved, stats.constants, stats.passes, stats.inactive,
+                 target.name().c_str(), ms, fold_ms, out.c_str());
+    return 0;
+}
+
+int get(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    EnumTable table(table_path(opts));
+    int status = 0;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        EnumTable::Ids ids = table.find(opts.positional()[i]);
+        if (ids.empty()) {
+            std::cerr << "moby enums: no enumerator " << opts.positional()[i] << '\n';
+            status = 1;
+        }
+        for (std::uint32_t id : ids)
+            print_constant(table, id);
+    }
+    return status;
+}
+
+int value(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    EnumTable table(table_path(opts));
+    const EnumRecord* e = nullptr;
+    if (opts.has("enum") && !(e = table.find_enum(opts.get("enum"))))
+        throw Error("no enum " + opts.get("enum"));
+    int status = 0;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        std::int64_t v;
+        if (!parse_value(opts.positional()[i], v))
+            throw Error("bad value " + opts.positional()[i]);
+        if (e) {
+            std::printf("%s\n", table.decode(*e, v).c_str());
+            continue;
+        }
+        EnumTable::Ids ids = table.with_value(v);
+        if (ids.empty()) {
+            std::cerr << "moby enums: no enumerator has value " << opts.positional()[i] << '\n';
+            status = 1;
+        }
+        for (std::uint32_t id : ids)
+            print_constant(table, id);
+    }
+    return status;
+}
+
+int show(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    EnumTable table(table_path(opts));
+    int status = 0;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        const EnumRecord* e = table.find_enum(opts.positional()[i]);
+        if (!e) {
+            std::cerr << "moby enums: no enum " << opts.positional()[i] << '\n';
+            status = 1;
+            continue;
+        }
+        std::string_view name = table.name(e->name), type = table.name(e->type);
+        std::printf("%.*s : %.*s (%u-bit %s%s)\n", static_cast<int>(name.size()), name.data(),
+                    static_cast<int>(type.size()), type.data(), e->width, e->is_signed ? "signed" : "unsigned",
+                    e->flags & EnumRecord::kOptions ? ", options" : "");
+        for (std::uint32_t id = e->first; id < e->first + e->count; ++id)
+            print_constant(table, id);
+    }
+    return status;
+}
+
+int stats(const Options& opts) {
+    EnumTable table(table_path(opts));
+    std::size_t options = 0, resolved = 0, implicit = 0, inactive = 0;
+    for (std::size_t i = 0; i < table.enum_count(); ++i)
+        options += (table.enum_at(i).flags & EnumRecord::kOptions) != 0;
+    for (std::size_t i = 0; i < table.constant_count(); ++i) {
+        resolved += (table.constant(i).flags & ConstantRecord::kResolved) != 0;
+        implicit += (table.constant(i).flags & ConstantRecord::kImplicit) != 0;
+        inactive += (table.constant(i).flags & ConstantRecord::kInactive) != 0;
+    }
+    std::string_view target = table.target();
+    std::printf("%-12s %.*s\n", "target", static_cast<int>(target.size()), target.data());
+    std::printf("%-12s %zu\n%-12s %zu\n%-12s %zu\n%-12s %zu\n%-12s %zu\n%-12s %zu\n", "enums", table.enum_count(),
+                "options", options, "constants", table.constant_count(), "resolved", resolved, "implicit", implicit,
+                "inactive", inactive);
+    if (opts.has("unresolved"))
+        for (std::uint32_t i = 0; i < table.constant_count(); ++i)
+            if (!(table.constant(i).flags & ConstantRecord::kResolved))
+                print_constant(table, i);
+    return 0;
+}
+
+// Name -> value and value -> name for random enumerators, as a symbolizer
+// decoding register or argument values would issue them.
+int bench(const Options& opts) {
+    auto open_start = Clock::now();
+    EnumTable table(table_path(opts));
+    double open_us = std::chrono::duration<double, std::micro>(Clock::now() - open_start).count();
+    std::size_t lookups = opts.get_size("lookups", 1000000);
+    std::vector<std::uint32_t> ids;
+    for (std::uint32_t i = 0; i < table.constant_count(); ++i)
+        if (table.constant(i).flags & ConstantRecord::kResolved)
+            ids.push_back(i);
+    if (ids.empty())
+        throw Error("no resolved enumerators");
+    std::mt19937_64 rng(42);
+    std::vector<std::uint32_t> sample(lookups);
+    for (std::uint32_t& id : sample)
+        id = ids[rng() % ids.size()];
+    std::vector<std::string_view> names;
+    for (std::uint32_t id : sample)
+        names.push_back(table.name(table.constant(id).name));
+
+    std::size_t sink = 0;
+    auto start = Clock::now();
+    for (std::string_view name : names)
+        sink += table.find(name).count;
+    double by_name_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / lookups;
+    start = Clock::now();
+    for (std::uint32_t id : sample)
+        sink += table.with_value(table.constant(id).value).count;
+    double by_value_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / lookups;
+    start = Clock::now();
+    std::size_t decoded = 0;
+    for (std::size_t i = 0; i < sample.size() && i < 100000; ++i, ++decoded) {
+        const ConstantRecord& c = table.constant(sample[i]);
+        sink += table.decode(table.enum_of(c), c.value).size();
+    }
+    double decode_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / decoded;
+    std::printf("open %.1f us; %zu lookups: name -> value %.1f ns, value -> names %.1f ns, decode %.1f ns (%zu)\n",
+                open_us, lookups, by_name_ns, by_value_ns, decode_ns, sink);
+    return 0;
+}
+
+} // namespace
+
+int cmd_enums(const Args& args) {
+    Options opts(args, {"corpus", "out", "table", "jobs", "enum", "lookups"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "build")
+        return build(opts);
+    if (sub == "get")
+        return get(opts);
+    if (sub == "value")
+        return value(opts);
+    if (sub == "show")
+        return show(opts);
+    if (sub == "stats")
+        return stats(opts);
+    if (sub == "bench")
+        return bench(opts);
+    return usage();
+}
+
+} // namespace moby::cli
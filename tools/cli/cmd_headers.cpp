@@ -0,0 +1,118 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/error.h"
+#include "moby/header_tree.h"
+#include "moby/work_pool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby headers extract [--corpus DIR] [--dest DIR] [--framework NAME] [--jobs N] [--naive]\n"
+                 "       moby headers bench [--corpus DIR] [--dest DIR] [--rounds N]\n";
+    return 2;
+}
+
+HeaderTreeOptions tree_options(const Options& opts) {
+    HeaderTreeOptions options;
+    options.threads = static_cast<unsigned>(opts.get_size("jobs", 0));
+    options.framework = opts.get("framework", "");
+    options.naive = opts.has("naive");
+    return options;
+}
+
+int extract(const Options& opts) {
+    Corpus corpus(opts.get("corpus", default_corpus_dir()));
+    std::string dest = opts.get("dest", "Headers");
+    auto start = Clock::now();
+    HeaderTreeStats stats = extract_header_tree(corpus, dest, tree_options(opts));
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (stats.files == 0)
+        throw Error("no sections under " + opts.get("framework") + ".framework/");
+    std::fprintf(stderr,
+                 "extracted %zu files (%.1f MB, %zu new directories; %zu by copy_file_range, %zu written) "
+                 "in %.1f ms to %s\n",
+                 stats.files, stats.bytes / 1e6, stats.directories, stats.copied, stats.written, ms, dest.c_str());
+    return 0;
+}
+
+// Every extracted file against its section, byte for byte.
+std::size_t mismatches(const Corpus& corpus, const fs::path& dest) {
+    std::size_t bad = 0;
+    for (const Section& s : corpus.sections()) {
+        fs::path path = dest / std::string(s.path);
+        std::error_code ec;
+        if (fs::file_size(path, ec) != s.length || ec) {
+            ++bad;
+            continue;
+        }
+        if (s.length && MappedFile(path.string()).view() != s.text)
+            ++bad;
+    }
+    return bad;
+}
+
+// Extracts the whole corpus into an empty directory, naively and with the
+// fast path on one thread and on all, and checks the trees it writes.
+int bench(const Options& opts) {
+    Corpus corpus(opts.get("corpus", default_corpus_dir()));
+    fs::path dest = opts.get("dest", (fs::temp_directory_path() / "moby-headers-bench").string());
+    std::size_t rounds = opts.get_size("rounds", 5);
+
+    struct Variant {
+        const char* name;
+        bool naive;
+        unsigned threads;
+    };
+    const Variant variants[] = {
+        {"naive", true, 1}, {"fast, 1 thread", false, 1}, {"fast, all threads", false, default_thread_count()}};
+    std::printf("%zu files, %.1f MB (best of %zu, into %s)\n", corpus.sections().size(), corpus.total_bytes() / 1e6,
+                rounds, dest.string().c_str());
+    int status = 0;
+    for (const Variant& v : variants) {
+        HeaderTreeOptions options;
+        options.naive = v.naive;
+        options.threads = v.threads;
+        double best = 1e300;
+        HeaderTreeStats stats;
+        for (std::size_t round = 0; round < rounds; ++round) {
+            fs::remove_all(dest);
+            auto start = Clock::now();
+            stats = extract_header_tree(corpus, dest.string(), options);
+            best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+        std::size_t bad = mismatches(corpus, dest);
+        std::printf("%-18s %7.1f ms  %6.0f files/ms  %zu copied, %zu written%s\n", v.name, best, stats.files / best,
+                    stats.copied, stats.written, bad ? "  MISMATCH" : "");
+        if (bad)
+            status = 1;
+    }
+    fs::remove_all(dest);
+    return status;
+}
+
+} // namespace
+
+int cmd_headers(const Args& args) {
+    Options opts(args, {"corpus", "dest", "framework", "jobs", "rounds"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "extract")
+        return extract(opts);
+    if (sub == "bench")
+        return bench(opts);
+    return usage();
+}
+
+} // namespace moby::cli
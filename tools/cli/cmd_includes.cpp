@@ -0,0 +1,146 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/include_graph.h"
+#include "moby/section_index.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby includes build [--corpus DIR] [--out FILE]\n"
+                 "       moby includes deps [--corpus DIR] [--graph FILE] [--direct] [--count] [--time] HEADER\n"
+                 "       moby includes rdeps [--corpus DIR] [--graph FILE] [--direct] [--count] [--time] HEADER\n"
+                 "       moby includes order [--corpus DIR] [--graph FILE]\n"
+                 "       moby includes cycles [--corpus DIR] [--graph FILE]\n"
+                 "       moby includes stats [--corpus DIR] [--graph FILE]\n";
+    return 2;
+}
+
+void print_node(const IncludeGraph& graph, std::uint32_t id) {
+    std::string_view name = graph.name(id);
+    std::printf("%.*s%s\n", static_cast<int>(name.size()), name.data(), graph.external(id) ? "\t(external)" : "");
+}
+
+int build(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string out = opts.get("out", IncludeGraph::default_path(dir));
+    auto start = Clock::now();
+    Corpus corpus(dir);
+    IncludeGraph::build(corpus, out);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    IncludeGraph graph(out);
+    std::fprintf(stderr, "include graph of %zu headers in %.1f ms -> %s\n", graph.size(), ms, out.c_str());
+    return 0;
+}
+
+// deps and rdeps: the stored closure row, or the direct edges.
+int walk(const Options& opts, bool reverse) {
+    if (opts.positional().size() != 2)
+        return usage();
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    IncludeGraph graph(opts.get("graph", IncludeGraph::default_path(dir)));
+    std::uint32_t id;
+    if (!graph.find(opts.positional()[1], id))
+        throw Error("no header " + opts.positional()[1]);
+
+    auto start = Clock::now();
+    std::size_t count;
+    if (opts.has("direct")) {
+        IncludeGraph::Range edges = reverse ? graph.included_by(id) : graph.includes(id);
+        count = edges.size();
+        if (!opts.has("count"))
+            for (std::uint32_t other : edges)
+                print_node(graph, other);
+    } else if (opts.has("count")) {
+        count = reverse ? graph.dependent_count(id) : graph.dependency_count(id);
+    } else {
+        Bitset row = reverse ? graph.dependents(id) : graph.dependencies(id);
+        count = row.count();
+        row.for_each([&](std::size_t other) { print_node(graph, static_cast<std::uint32_t>(other)); });
+    }
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    if (opts.has("count"))
+        std::printf("%zu\n", count);
+    if (opts.has("time"))
+        std::fprintf(stderr, "%zu headers in %.1f us\n", count, us);
+    return 0;
+}
+
+int order(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    IncludeGraph graph(opts.get("graph", IncludeGraph::default_path(dir)));
+    for (std::uint32_t id : graph.topological_order())
+        print_node(graph, id);
+    return 0;
+}
+
+int cycles(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    IncludeGraph graph(opts.get("graph", IncludeGraph::default_path(dir)));
+    std::vector<std::vector<std::uint32_t>> found = graph.cycles();
+    for (std::size_t i = 0; i < found.size(); ++i) {
+        std::printf("cycle %zu (%zu headers):\n", i + 1, found[i].size());
+        for (std::uint32_t id : found[i]) {
+            std::printf("    ");
+            print_node(graph, id);
+        }
+    }
+    if (found.empty())
+        std::printf("no cycles\n");
+    return 0;
+}
+
+int stats(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    IncludeGraph graph(opts.get("graph", IncludeGraph::default_path(dir)));
+    std::size_t external = 0, edges = 0, widest = 0, widest_id = 0, deepest = 0, deepest_id = 0;
+    for (std::uint32_t id = 0; id < graph.size(); ++id) {
+        external += graph.external(id);
+        edges += graph.includes(id).size();
+        std::size_t reach = graph.dependency_count(id);
+        if (reach > widest)
+            widest = reach, widest_id = id;
+        std::size_t fan_in = graph.dependent_count(id);
+        if (fan_in > deepest)
+            deepest = fan_in, deepest_id = id;
+    }
+    std::string_view w = graph.name(static_cast<std::uint32_t>(widest_id));
+    std::string_view d = graph.name(static_cast<std::uint32_t>(deepest_id));
+    std::printf("headers        %zu (%zu external)\n", graph.size(), external);
+    std::printf("edges          %zu\n", edges);
+    std::printf("cycles         %zu\n", graph.cycles().size());
+    std::printf("largest reach  %zu (%.*s)\n", widest, static_cast<int>(w.size()), w.data());
+    std::printf("most depended  %zu (%.*s)\n", deepest, static_cast<int>(d.size()), d.data());
+    return 0;
+}
+
+} // namespace
+
+int cmd_includes(const Args& args) {
+    Options opts(args, {"corpus", "out", "graph"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "build")
+        return build(opts);
+    if (sub == "deps")
+        return walk(opts, false);
+    if (sub == "rdeps")
+        return walk(opts, true);
+    if (sub == "order")
+        return order(opts);
+    if (sub == "cycles")
+        return cycles(opts);
+    if (sub == "stats")
+        return stats(opts);
+    return usage();
+}
+
+} // namespace moby::cli
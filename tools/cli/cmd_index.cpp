@@ -0,0 +1,95 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/section_index.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <iostream>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby index build [--corpus DIR] [--out FILE]\n"
+                 "       moby index get [--corpus DIR] [--index FILE] [--time] PATH...\n"
+                 "       moby index list [--corpus DIR] [--index FILE]\n";
+    return 2;
+}
+
+int build(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string out = opts.get("out", SectionIndex::default_path(dir));
+    auto start = Clock::now();
+    Corpus corpus(dir);
+    SectionIndex::build(corpus, out);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::fprintf(stderr, "indexed %zu sections from %zu files (%.1f MB) in %.1f ms -> %s\n",
+                 corpus.sections().size(), corpus.files().size(), corpus.total_bytes() / 1e6, ms,
+                 out.c_str());
+    return 0;
+}
+
+int get(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string path = opts.get("index", SectionIndex::default_path(dir));
+    if (opts.positional().size() < 2)
+        return usage();
+
+    auto start = Clock::now();
+    SectionIndex index(path, dir);
+    const SectionRecord* first = index.find(opts.positional()[1]);
+    std::string_view first_text = first ? index.text(*first) : std::string_view();
+    auto elapsed = Clock::now() - start;
+
+    int status = 0;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        const SectionRecord* r = i == 1 ? first : index.find(opts.positional()[i]);
+        if (!r) {
+            std::cerr << "moby index: no section " << opts.positional()[i] << '\n';
+            status = 1;
+            continue;
+        }
+        std::string_view text = i == 1 ? first_text : index.text(*r);
+        std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+    if (opts.has("time"))
+        std::fprintf(stderr, "open + first lookup: %.1f us\n",
+                     std::chrono::duration<double, std::micro>(elapsed).count());
+    return status;
+}
+
+int list(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    SectionIndex index(opts.get("index", SectionIndex::default_path(dir)), dir);
+    for (std::size_t i = 0; i < index.size(); ++i) {
+        const SectionRecord& r = index.at(i);
+        std::string_view path = index.path(r);
+        std::string_view file = index.file_name(r.file);
+        std::printf("%.*s\t%.*s\t%" PRIu64 "\t%" PRIu64 "\t%016" PRIx64 "\n", static_cast<int>(path.size()),
+                    path.data(), static_cast<int>(file.size()), file.data(), r.offset, r.length,
+                    r.content_hash);
+    }
+    return 0;
+}
+
+} // namespace
+
+int cmd_index(const Args& args) {
+    Options opts(args, {"corpus", "out", "index"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "build")
+        return build(opts);
+    if (sub == "get")
+        return get(opts);
+    if (sub == "list")
+        return list(opts);
+    return usage();
+}
+
+} // namespace moby::cli
@@ -0,0 +1,339 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/enum_table.h"
+#include "moby/mapped_file.h"
+#include "moby/section_index.h"
+#include "moby/struct_layout.h"
+#include "moby/work_pool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <memory>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby layout build [--corpus DIR] [--out FILE] [--jobs N] [--verbose]\n"
+                 "       moby layout show [--corpus DIR] [--table FILE] [--target lp64|ilp32] NAME...\n"
+                 "       moby layout decode [--corpus DIR] [--table FILE] [--target lp64|ilp32] NAME DUMP\n"
+                 "       moby layout stats [--corpus DIR] [--table FILE] [--unresolved]\n"
+                 "       moby layout bench [--corpus DIR] [--table FILE] [--target lp64|ilp32] NAME [--records N]\n";
+    return 2;
+}
+
+std::string table_path(const Options& opts) {
+    return opts.get("table", StructLayouts::default_path(opts.get("corpus", default_corpus_dir())));
+}
+
+LayoutTarget layout_target(const Options& opts) {
+    LayoutTarget t = LayoutTarget::LP64;
+    if (opts.has("target") && !parse_layout_target(opts.get("target"), t))
+        throw Error("unknown target " + opts.get("target"));
+    return t;
+}
+
+const StructRecord& lookup(const StructLayouts& table, const std::string& name, LayoutTarget target) {
+    const StructRecord* r = table.find(name, target);
+    if (!r)
+        throw Error("no struct " + name + " for " + layout_target_name(target));
+    if (!(r->flags & StructRecord::kResolved))
+        throw Error(name + " has a field of unknown type for " + layout_target_name(target));
+    return *r;
+}
+
+// The enum table at `path` if it is current and folded for `config`, else null.
+std::unique_ptr<EnumTable> open_enums(const std::string& path, const TargetConfig& config, std::uint64_t hash) {
+    if (!std::filesystem::exists(path))
+        return nullptr;
+    try {
+        auto table = std::make_unique<EnumTable>(path);
+        if (table->corpus_hash() == hash && table->target() == config.name())
+            return table;
+    } catch (const Error&) {
+        // An older format: fold again.
+    }
+    return nullptr;
+}
+
+int build(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string out = opts.get("out", StructLayouts::default_path(dir));
+    auto start = Clock::now();
+    Corpus corpus(dir);
+    unsigned jobs = static_cast<unsigned>(opts.get_size("jobs", default_thread_count()));
+    // Enumerators size arrays such as kMIDIThruConnection_MaxEndpoints, and
+    // each target needs them folded for its own pointer width. enums.tbl
+    // serves the target it was folded for while it is current; the others
+    // get a table of their own next to the layouts.
+    std::uint64_t hash = corpus_hash(corpus);
+    std::vector<Symbol> symbols;
+    std::unique_ptr<EnumTable> tables[kLayoutTargetCount];
+    LayoutEnums enums{};
+    std::size_t folded = 0;
+    for (int t = 0; t < kLayoutTargetCount; ++t) {
+        TargetConfig config = layout_target_config(static_cast<LayoutTarget>(t));
+        tables[t] = open_enums(EnumTable::default_path(dir), config, hash);
+        std::string path = (std::filesystem::path(out).parent_path() / ("enums-" + config.name() + ".tbl")).string();
+        if (!tables[t])
+            tables[t] = open_enums(path, config, hash);
+        if (!tables[t]) {
+            if (symbols.empty())
+                symbols = extract_corpus_symbols(corpus, jobs);
+            EnumTable::build(corpus, symbols, path, config);
+            tables[t] = std::make_unique<EnumTable>(path);
+            ++folded;
+        }
+        enums[t] = tables[t].get();
+    }
+    LayoutBuildStats stats = StructLayouts::build(corpus, enums, out, jobs);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    for (int t = 0; t < kLayoutTargetCount; ++t)
+        std::fprintf(stderr, "%s: %zu of %zu records resolved, %zu fields (%zu bitfields)\n",
+                     layout_target_name(static_cast<LayoutTarget>(t)), stats.resolved[t], stats.records[t],
+                     stats.fields[t], stats.bitfields[t]);
+    if (opts.has("verbose"))
+        for (const std::string& type : stats.unknown_types)
+            std::fprintf(stderr, "unknown type: %s\n", type.c_str());
+    std::fprintf(stderr, "%.1f ms (%zu enum tables folded) -> %s\n", ms, folded, out.c_str());
+    return 0;
+}
+
+void print_record(const StructLayouts& table, const StructRecord& r, int indent, std::uint64_t base_bits) {
+    for (std::uint32_t i = r.first_field; i < r.first_field + r.field_count; ++i) {
+        const FieldRecord& f = table.field(i);
+        std::string_view name = table.name(f.name), type = table.name(f.type);
+        std::uint64_t bits = base_bits + f.bit_offset;
+        std::printf("%*s%6llu", indent, "", static_cast<unsigned long long>(bits / 8));
+        if (f.flags & FieldRecord::kBitfield)
+            std::printf(".%llu  %-28.*s %.*s : %u\n", static_cast<unsigned long long>(bits % 8),
+                        static_cast<int>(type.size()), type.data(), static_cast<int>(name.size()), name.data(),
+                        f.bit_width);
+        else if (f.count != 1)
+            std::printf("    %-28.*s %.*s[%u]  (%u x %u)\n", static_cast<int>(type.size()), type.data(),
+                        static_cast<int>(name.size()), name.data(), f.count, f.count, f.size);
+        else
+            std::printf("    %-28.*s %.*s  (%u)\n", static_cast<int>(type.size()), type.data(),
+                        static_cast<int>(name.size()), name.data(), f.size);
+        // Anonymous members are expanded in place.
+        if (name.empty() && f.record != FieldRecord::kNoRecord)
+            print_record(table, table.at(f.record), indent + 2, bits);
+    }
+}
+
+int show(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    StructLayouts table(table_path(opts));
+    LayoutTarget target = layout_target(opts);
+    int status = 0;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        const StructRecord* r = table.find(opts.positional()[i], target);
+        if (!r) {
+            std::cerr << "moby layout: no struct " << opts.positional()[i] << '\n';
+            status = 1;
+            continue;
+        }
+        std::string_view name = table.name(r->name);
+        if (!(r->flags & StructRecord::kResolved)) {
+            std::printf("%.*s: unresolved for %s\n", static_cast<int>(name.size()), name.data(),
+                        layout_target_name(target));
+            status = 1;
+            continue;
+        }
+        std::printf("%s %.*s: size %u, align %u (%s%s%s)\n", r->flags & StructRecord::kUnion ? "union" : "struct",
+                    static_cast<int>(name.size()), name.data(), r->size, r->align, layout_target_name(target),
+                    r->pack ? (", pack " + std::to_string(r->pack)).c_str() : "",
+                    r->flags & StructRecord::kPacked ? ", packed" : "");
+        print_record(table, *r, 0, 0);
+    }
+    return status;
+}
+
+void print_value(const StructLayouts& table, const FieldRecord& f, const unsigned char* record, std::uint32_t index) {
+    if (f.kind == FieldKind::Float && !(f.flags & FieldRecord::kBitfield) && (f.size == 4 || f.size == 8)) {
+        const unsigned char* at = record + f.bit_offset / 8 + std::uint64_t(index) * f.size;
+        double v;
+        if (f.size == 4) {
+            float x;
+            std::memcpy(&x, at, 4);
+            v = x;
+        } else {
+            std::memcpy(&v, at, 8);
+        }
+        std::printf("%g", v);
+    } else if (f.kind == FieldKind::Pointer) {
+        std::printf("0x%llx", static_cast<unsigned long long>(read_field(f, record, index)));
+    } else if (f.kind == FieldKind::Int && f.size <= 8) {
+        std::uint64_t v = read_field(f, record, index);
+        if (f.flags & FieldRecord::kSigned)
+            std::printf("%lld", static_cast<long long>(v));
+        else
+            std::printf("%llu", static_cast<unsigned long long>(v));
+    } else {
+        std::printf("<%u bytes>", f.size);
+    }
+    (void)table;
+}
+
+void decode_record(const StructLayouts& table, const StructRecord& r, const unsigned char* record,
+                   const std::string& prefix) {
+    for (std::uint32_t i = r.first_field; i < r.first_field + r.field_count; ++i) {
+        const FieldRecord& f = table.field(i);
+        std::string name = prefix + std::string(table.name(f.name));
+        if (f.record != FieldRecord::kNoRecord) {
+            std::uint32_t count = f.count ? f.count : 0;
+            for (std::uint32_t k = 0; k < count; ++k) {
+                std::string sub = name.empty() || table.name(f.name).empty() ? prefix : name;
+                if (count > 1)
+                    sub += "[" + std::to_string(k) + "]";
+                decode_record(table, table.at(f.record), record + f.bit_offset / 8 + std::uint64_t(k) * f.size,
+                              sub.empty() || sub == prefix ? sub : sub + ".");
+            }
+            continue;
+        }
+        std::printf("%s = ", name.c_str());
+        std::uint32_t shown = std::min<std::uint32_t>(f.count, 16);
+        if (f.count != 1)
+            std::printf("{");
+        for (std::uint32_t k = 0; k < shown; ++k) {
+            if (k)
+                std::printf(", ");
+            print_value(table, f, record, k);
+        }
+        if (f.count != 1)
+            std::printf("%s}", f.count > shown ? ", ..." : "");
+        std::printf("\n");
+    }
+}
+
+// Prints every record of a raw little-endian dump of NAME records.
+int decode(const Options& opts) {
+    if (opts.positional().size() != 3)
+        return usage();
+    StructLayouts table(table_path(opts));
+    const StructRecord& r = lookup(table, opts.positional()[1], layout_target(opts));
+    if (r.size == 0)
+        throw Error(opts.positional()[1] + " is empty");
+    MappedFile dump(opts.positional()[2]);
+    std::size_t n = dump.size() / r.size;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (n > 1)
+            std::printf("[%zu]\n", i);
+        decode_record(table, r, reinterpret_cast<const unsigned char*>(dump.data()) + i * r.size, "");
+    }
+    if (dump.size() % r.size)
+        std::cerr << "moby layout: " << dump.size() % r.size << " trailing bytes\n";
+    return 0;
+}
+
+int stats(const Options& opts) {
+    StructLayouts table(table_path(opts));
+    for (int t = 0; t < kLayoutTargetCount; ++t) {
+        std::size_t records = 0, resolved = 0, unions = 0, packed = 0, bitfields = 0, differ = 0;
+        for (std::size_t i = 0; i < table.size(); ++i) {
+            const StructRecord& r = table.at(i);
+            if (static_cast<int>(r.target) != t)
+                continue;
+            ++records;
+            resolved += (r.flags & StructRecord::kResolved) != 0;
+            unions += (r.flags & StructRecord::kUnion) != 0;
+            packed += r.pack != 0 || (r.flags & StructRecord::kPacked);
+            bitfields += (r.flags & StructRecord::kBitfields) != 0;
+            // Named records whose size differs between the two targets.
+            std::string_view name = table.name(r.name);
+            if (t == 0 && !name.empty() && (r.flags & StructRecord::kResolved)) {
+                const StructRecord* other = table.find(name, LayoutTarget::ILP32);
+                differ += other && (other->flags & StructRecord::kResolved) && other->size != r.size;
+            }
+        }
+        std::printf("%-6s %zu records, %zu resolved, %zu unions, %zu packed, %zu with bitfields",
+                    layout_target_name(static_cast<LayoutTarget>(t)), records, resolved, unions, packed, bitfields);
+        if (t == 0)
+            std::printf(", %zu sized differently on ilp32", differ);
+        std::printf("\n");
+    }
+    if (opts.has("unresolved"))
+        for (std::size_t i = 0; i < table.size(); ++i) {
+            const StructRecord& r = table.at(i);
+            std::string_view name = table.name(r.name);
+            if (!(r.flags & StructRecord::kResolved) && !name.empty())
+                std::printf("%s\t%.*s\n", layout_target_name(r.target), static_cast<int>(name.size()), name.data());
+        }
+    return 0;
+}
+
+// Field extraction over a synthetic dump, as a log decoder would run it.
+int bench(const Options& opts) {
+    if (opts.positional().size() != 2)
+        return usage();
+    StructLayouts table(table_path(opts));
+    const StructRecord& r = lookup(table, opts.positional()[1], layout_target(opts));
+    std::size_t n = opts.get_size("records", 1000000);
+    std::vector<unsigned char> dump(n * r.size);
+    for (std::size_t i = 0; i < dump.size(); ++i)
+        dump[i] = static_cast<unsigned char>(i * 131 + 7);
+
+    // Flatten nested records once, as a decoder would cache its plan.
+    std::vector<FieldRecord> plan;
+    std::function<void(const StructRecord&, std::uint64_t)> flatten = [&](const StructRecord& s, std::uint64_t base) {
+        for (std::uint32_t i = s.first_field; i < s.first_field + s.field_count; ++i) {
+            FieldRecord f = table.field(i);
+            f.bit_offset += base;
+            if (f.record != FieldRecord::kNoRecord) {
+                for (std::uint32_t k = 0; k < f.count; ++k)
+                    flatten(table.at(f.record), f.bit_offset + std::uint64_t(k) * f.size * 8);
+            } else if (f.kind != FieldKind::Vector) {
+                for (std::uint32_t k = 0; k < f.count; ++k) {
+                    FieldRecord e = f;
+                    if (!(f.flags & FieldRecord::kBitfield))
+                        e.bit_offset += std::uint64_t(k) * f.size * 8;
+                    e.count = 1;
+                    plan.push_back(e);
+                }
+            }
+        }
+    };
+    flatten(r, 0);
+
+    std::uint64_t sink = 0;
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < n; ++i) {
+        const unsigned char* rec = dump.data() + i * r.size;
+        for (const FieldRecord& f : plan)
+            sink += read_field(f, rec);
+    }
+    double s = std::chrono::duration<double>(Clock::now() - start).count();
+    std::printf("%zu records of %u bytes, %zu scalar fields each: %.1f M records/s, %.0f MB/s (%llx)\n", n, r.size,
+                plan.size(), n / s / 1e6, n * r.size / s / 1e6, static_cast<unsigned long long>(sink));
+    return 0;
+}
+
+} // namespace
+
+int cmd_layout(const Args& args) {
+    Options opts(args, {"corpus", "out", "table", "jobs", "target", "records"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "build")
+        return build(opts);
+    if (sub == "show")
+        return show(opts);
+    if (sub == "decode")
+        return decode(opts);
+    if (sub == "stats")
+        return stats(opts);
+    if (sub == "bench")
+        return bench(opts);
+    return usage();
+}
+
+} // namespace moby::cli
@@ -0,0 +1,144 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/lsp.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby lsp [serve] [--corpus DIR]\n"
+                 "       moby lsp bench [--corpus DIR] [--requests N]\n";
+    return 2;
+}
+
+// One message of the base protocol: "Content-Length: N" and other headers, a
+// blank line, then N bytes. False at end of input.
+bool read_message(std::FILE* in, std::string& body) {
+    std::size_t length = 0;
+    bool have_length = false;
+    char line[256];
+    for (;;) {
+        if (!std::fgets(line, sizeof line, in))
+            return false;
+        std::string_view h(line);
+        while (!h.empty() && (h.back() == '\n' || h.back() == '\r'))
+            h.remove_suffix(1);
+        if (h.empty()) {
+            if (have_length)
+                break;
+            continue;
+        }
+        constexpr std::string_view kLength = "Content-Length:";
+        if (h.substr(0, kLength.size()) == kLength) {
+            length = std::strtoull(std::string(h.substr(kLength.size())).c_str(), nullptr, 10);
+            have_length = true;
+        }
+    }
+    body.resize(length);
+    return std::fread(body.data(), 1, length, in) == length;
+}
+
+void write_message(std::FILE* out, const std::string& body) {
+    std::fprintf(out, "Content-Length: %zu\r\n\r\n", body.size());
+    std::fwrite(body.data(), 1, body.size(), out);
+    std::fflush(out);
+}
+
+int serve(const Options& opts) {
+    auto start = Clock::now();
+    LspServer server(opts.get("corpus", default_corpus_dir()));
+    std::fprintf(stderr, "moby lsp: serving %zu symbols from %zu files (started in %.1f ms)\n",
+                 server.symbols().size(), server.corpus().files().size(),
+                 std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    std::string body;
+    while (read_message(stdin, body)) {
+        std::string response = server.handle(body);
+        if (!response.empty())
+            write_message(stdout, response);
+        if (server.exit_requested())
+            return server.exit_status();
+    }
+    return 1;  // the client went away without `exit`
+}
+
+std::string position_request(int id, const char* method, const std::string& uri, std::size_t line,
+                             std::size_t character) {
+    return "{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string(id) + ",\"method\":\"" + method +
+           "\",\"params\":{\"textDocument\":{\"uri\":\"" + uri + "\"},\"position\":{\"line\":" +
+           std::to_string(line) + ",\"character\":" + std::to_string(character) + "}}}";
+}
+
+// Hover, definition and workspace-symbol requests on random declarations,
+// through the same JSON path the editor uses; latencies include parsing the
+// request and writing the response.
+int bench(const Options& opts) {
+    auto open_start = Clock::now();
+    LspServer server(opts.get("corpus", default_corpus_dir()));
+    double open_ms = std::chrono::duration<double, std::milli>(Clock::now() - open_start).count();
+    const SymbolDb& db = server.symbols();
+    std::size_t requests = opts.get_size("requests", 20000);
+    std::mt19937_64 rng(42);
+    std::vector<std::string> kinds[3];
+    for (std::size_t i = 0; i < requests; ++i) {
+        const SymbolRecord& r = db.at(rng() % db.size());
+        std::string_view name = db.name(r);
+        std::string_view decl(server.corpus().files()[db.section(r).file].map.data() + r.offset, r.length);
+        std::string_view piece = name.substr(0, name.find(':'));
+        std::size_t at = decl.find(piece);
+        if (at == std::string_view::npos)
+            at = 0;
+        // The line and column of the name, counted from the declaration start.
+        std::string_view head(server.corpus().files()[db.section(r).file].map.data(), r.offset + at);
+        std::size_t line = std::count(head.begin(), head.end(), '\n');
+        std::size_t column = head.size() - (head.rfind('\n') + 1);
+        std::string uri = server.file_uri(db.section(r).file);
+        kinds[0].push_back(position_request(static_cast<int>(i), "textDocument/hover", uri, line, column));
+        kinds[1].push_back(position_request(static_cast<int>(i), "textDocument/definition", uri, line, column));
+        std::string prefix(name.substr(0, 1 + rng() % std::min<std::size_t>(name.size(), 8)));
+        kinds[2].push_back("{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string(i) +
+                           ",\"method\":\"workspace/symbol\",\"params\":{\"query\":\"" + prefix + "\"}}");
+    }
+    std::printf("open %.1f ms\n", open_ms);
+    const char* names[] = {"hover", "definition", "workspace/symbol"};
+    for (int k = 0; k < 3; ++k) {
+        std::vector<double> us;
+        us.reserve(requests);
+        std::size_t bytes = 0;
+        for (const std::string& request : kinds[k]) {
+            auto start = Clock::now();
+            bytes += server.handle(request).size();
+            us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        }
+        std::sort(us.begin(), us.end());
+        double mean = 0;
+        for (double u : us)
+            mean += u;
+        std::printf("%-17s %zu requests: mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us (%.0f bytes/response)\n",
+                    names[k], requests, mean / requests, us[requests / 2], us[requests * 99 / 100], us.back(),
+                    static_cast<double>(bytes) / requests);
+    }
+    return 0;
+}
+
+} // namespace
+
+int cmd_lsp(const Args& args) {
+    Options opts(args, {"corpus", "requests"});
+    if (opts.positional().empty() || opts.positional()[0] == "serve")
+        return serve(opts);
+    if (opts.positional()[0] == "bench")
+        return bench(opts);
+    return usage();
+}
+
+} // namespace moby::cli
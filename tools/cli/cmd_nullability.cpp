@@ -0,0 +1,196 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/nullability.h"
+#include "moby/section_index.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby nullability build [--corpus DIR] [--db FILE] [--out FILE]\n"
+                 "       moby nullability show [--corpus DIR] [--db FILE] [--index FILE] NAME...\n"
+                 "       moby nullability at [--corpus DIR] [--index FILE] FILE:OFFSET...\n"
+                 "       moby nullability stats [--corpus DIR] [--db FILE] [--index FILE] [--unspecified]\n"
+                 "       moby nullability bench [--corpus DIR] [--index FILE] [--lookups N]\n";
+    return 2;
+}
+
+std::string index_path(const Options& opts) {
+    return opts.get("index", NullabilityIndex::default_path(opts.get("corpus", default_corpus_dir())));
+}
+
+SymbolDb open_db(const Options& opts, const NullabilityIndex& index) {
+    SymbolDb db(opts.get("db", SymbolDb::default_path(opts.get("corpus", default_corpus_dir()))));
+    if (index.corpus_hash() != db.corpus_hash())
+        throw Error("nullability index is out of date; run 'moby nullability build'");
+    return db;
+}
+
+void print_symbol(const SymbolDb& db, const SymbolRecord& r) {
+    std::string_view name = db.name(r), parent = db.parent(r), path = db.section_path(r);
+    std::printf("%s\t%.*s\t%.*s\t%.*s\n", kind_name(r.kind), static_cast<int>(name.size()), name.data(),
+                static_cast<int>(parent.size()), parent.data(), static_cast<int>(path.size()), path.data());
+}
+
+// "return nonnull (inferred)", "param 2 nullable", ...
+void print_slots(const NullabilityIndex& index, std::size_t id) {
+    std::size_t k = 0;
+    for (NullabilitySlot slot : index.slots(id)) {
+        if (k == 0)
+            std::printf("    %-8s", "type");
+        else
+            std::printf("    param %-2zu", k);
+        std::printf(" %s%s\n", nullability_name(slot.value()), slot.inferred() ? " (inferred)" : "");
+        ++k;
+    }
+}
+
+int build(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string out = opts.get("out", NullabilityIndex::default_path(dir));
+    auto start = Clock::now();
+    Corpus corpus(dir);
+    SymbolDb db(opts.get("db", SymbolDb::default_path(dir)));
+    if (db.corpus_hash() != corpus_hash(corpus))
+        throw Error("symbols.db is out of date; run 'moby symbols build'");
+    NullabilityStats stats = NullabilityIndex::build(corpus, db, out);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::fprintf(stderr,
+                 "%zu regions; %zu declarations with %zu pointer positions: %zu written, %zu inferred, "
+                 "%zu unspecified; %.1f ms -> %s\n",
+                 stats.regions, stats.declarations, stats.slots, stats.explicit_slots, stats.inferred_slots,
+                 stats.unspecified, ms, out.c_str());
+    return 0;
+}
+
+int show(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    NullabilityIndex index(index_path(opts));
+    SymbolDb db = open_db(opts, index);
+    int status = 0;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        SymbolDb::Range range = db.find(opts.positional()[i]);
+        if (range.count == 0) {
+            std::cerr << "moby nullability: no symbol " << opts.positional()[i] << '\n';
+            status = 1;
+        }
+        for (const SymbolRecord& r : range) {
+            print_symbol(db, r);
+            std::size_t id = db.id_of(r);
+            std::printf("    %s\n", index.region_at(db.section(r).file, r.offset) ? "assume-nonnull region"
+                                                                                   : "outside any region");
+            print_slots(index, id);
+        }
+    }
+    return status;
+}
+
+int at(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    NullabilityIndex index(index_path(opts));
+    Corpus corpus(opts.get("corpus", default_corpus_dir()));
+    int status = 0;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        const std::string& arg = opts.positional()[i];
+        std::size_t colon = arg.rfind(':');
+        std::uint32_t file = 0;
+        while (colon != std::string::npos && file < corpus.files().size() &&
+               corpus.files()[file].name != arg.substr(0, colon))
+            ++file;
+        if (colon == std::string::npos || file == corpus.files().size())
+            throw Error("expected FILE:OFFSET with FILE a corpus file, got " + arg);
+        std::uint64_t offset = std::strtoull(arg.c_str() + colon + 1, nullptr, 0);
+        const NullabilityRegion* r = index.region_at(file, offset);
+        if (!r) {
+            std::printf("%s\toutside\n", arg.c_str());
+            status = 1;
+            continue;
+        }
+        std::printf("%s\tnonnull\t%.*s\t%llu-%llu\n", arg.c_str(),
+                    static_cast<int>(corpus.sections()[r->section].path.size()),
+                    corpus.sections()[r->section].path.data(), static_cast<unsigned long long>(r->begin),
+                    static_cast<unsigned long long>(r->end));
+    }
+    return status;
+}
+
+int stats(const Options& opts) {
+    NullabilityIndex index(index_path(opts));
+    SymbolDb db = open_db(opts, index);
+    std::size_t counts[5][2] = {}, declarations = 0, unspecified_decls = 0;
+    for (std::size_t id = 0; id < index.size(); ++id) {
+        bool pointer = false, unspecified = false;
+        for (NullabilitySlot slot : index.slots(id)) {
+            ++counts[static_cast<int>(slot.value())][slot.inferred()];
+            pointer |= slot.value() != Nullability::None;
+            unspecified |= slot.value() == Nullability::Unspecified;
+        }
+        declarations += pointer;
+        unspecified_decls += unspecified;
+        if (unspecified && opts.has("unspecified"))
+            print_symbol(db, db.at(id));
+    }
+    std::printf("%-16s %zu\n%-16s %zu (%zu with an unspecified pointer)\n", "regions", index.region_count(),
+                "declarations", declarations, unspecified_decls);
+    for (int n = 1; n < 5; ++n)
+        std::printf("%-16s %zu written, %zu inferred\n", nullability_name(static_cast<Nullability>(n)),
+                    counts[n][0], counts[n][1]);
+    return 0;
+}
+
+// Offset -> region lookups at random positions of random files, as an editor
+// or generator asking for the context of arbitrary declarations would issue.
+int bench(const Options& opts) {
+    auto open_start = Clock::now();
+    NullabilityIndex index(index_path(opts));
+    double open_us = std::chrono::duration<double, std::micro>(Clock::now() - open_start).count();
+    Corpus corpus(opts.get("corpus", default_corpus_dir()));
+    std::size_t lookups = opts.get_size("lookups", 1000000);
+    std::mt19937_64 rng(42);
+    std::vector<std::pair<std::uint32_t, std::uint64_t>> points(lookups);
+    for (auto& p : points) {
+        p.first = static_cast<std::uint32_t>(rng() % corpus.files().size());
+        p.second = rng() % corpus.files()[p.first].map.size();
+    }
+    std::size_t inside = 0;
+    auto start = Clock::now();
+    for (const auto& p : points)
+        inside += index.region_at(p.first, p.second) != nullptr;
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / lookups;
+    std::printf("open %.1f us; %zu offset lookups over %zu regions: %.1f ns each (%.1f%% inside)\n", open_us,
+                lookups, index.region_count(), ns, 100.0 * inside / lookups);
+    return 0;
+}
+
+} // namespace
+
+int cmd_nullability(const Args& args) {
+    Options opts(args, {"corpus", "db", "out", "index", "lookups"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "build")
+        return build(opts);
+    if (sub == "show")
+        return show(opts);
+    if (sub == "at")
+        return at(opts);
+    if (sub == "stats")
+        return stats(opts);
+    if (sub == "bench")
+        return bench(opts);
+    return usage();
+}
+
+} // namespace moby::cli
@@ -0,0 +1,160 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/api_oracle.h"
+#include "moby/section_index.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby oracle build [--corpus DIR] [--db FILE] [--out FILE] [--bits-per-key N]\n"
+                 "       moby oracle query [--corpus DIR] [--oracle FILE] NAME...\n"
+                 "       moby oracle stats [--corpus DIR] [--oracle FILE]\n"
+                 "       moby oracle bench [--corpus DIR] [--oracle FILE] [--queries N]\n";
+    return 2;
+}
+
+std::string oracle_path(const Options& opts) {
+    return opts.get("oracle", ApiOracle::default_path(opts.get("corpus", default_corpus_dir())));
+}
+
+int build(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string out = opts.get("out", ApiOracle::default_path(dir));
+    auto start = Clock::now();
+    Corpus corpus(dir);
+    SymbolDb db(opts.get("db", SymbolDb::default_path(dir)));
+    if (db.corpus_hash() != corpus_hash(corpus))
+        throw Error("symbols.db is out of date; run 'moby symbols build'");
+    auto bits = static_cast<std::uint32_t>(opts.get_size("bits-per-key", ApiOracle::kDefaultBitsPerKey));
+    ApiOracleStats stats = ApiOracle::build(corpus, db, out, bits);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::fprintf(stderr,
+                 "%zu names in %zu frameworks (%zu framework sets); filter %.1f KB, exact set %.1f KB; %.1f ms -> %s\n",
+                 stats.names, stats.frameworks, stats.framework_sets, stats.filter_bytes / 1024.0,
+                 stats.set_bytes / 1024.0, ms, out.c_str());
+    return 0;
+}
+
+int query(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    ApiOracle oracle(oracle_path(opts));
+    int status = 0;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        const std::string& name = opts.positional()[i];
+        std::int64_t index = oracle.may_contain(name) ? oracle.find(name) : -1;
+        if (index < 0) {
+            std::printf("%s\tabsent\n", name.c_str());
+            status = 1;
+            continue;
+        }
+        std::printf("%s\t", name.c_str());
+        const char* sep = "";
+        for (std::uint16_t f : oracle.frameworks(static_cast<std::size_t>(index))) {
+            std::printf("%s%.*s", sep, static_cast<int>(oracle.framework(f).size()), oracle.framework(f).data());
+            sep = ",";
+        }
+        std::printf("\n");
+    }
+    return status;
+}
+
+int stats(const Options& opts) {
+    ApiOracle oracle(oracle_path(opts));
+    std::printf("%-12s %zu\n%-12s %zu\n%-12s %.1f KB (%.1f bits per name)\n", "names", oracle.size(), "frameworks",
+                oracle.framework_count(), "filter", oracle.filter_bytes() / 1024.0,
+                oracle.filter_bytes() * 8.0 / oracle.size());
+    return 0;
+}
+
+// Identifiers from random stretches of the corpus stand in for a client
+// codebase; invented names that no SDK declares measure the negative path and
+// the filter's false-positive rate.
+int bench(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    auto open_start = Clock::now();
+    ApiOracle oracle(oracle_path(opts));
+    double open_us = std::chrono::duration<double, std::micro>(Clock::now() - open_start).count();
+    Corpus corpus(dir);
+    std::size_t n = opts.get_size("queries", 1000000);
+    std::mt19937_64 rng(42);
+
+    auto is_ident = [](char c) { return c == '_' || std::isalnum(static_cast<unsigned char>(c)); };
+    std::vector<std::string> client;
+    while (client.size() < n) {
+        // Up to 64 consecutive identifiers from a random position.
+        std::string_view text = corpus.files()[rng() % corpus.files().size()].map.view();
+        std::size_t i = rng() % text.size();
+        for (int taken = 0; taken < 64 && client.size() < n && i < text.size(); ++taken) {
+            while (i < text.size() && !is_ident(text[i]))
+                ++i;
+            std::size_t start = i;
+            while (i < text.size() && is_ident(text[i]))
+                ++i;
+            if (i > start && !std::isdigit(static_cast<unsigned char>(text[start])))
+                client.emplace_back(text.substr(start, i - start));
+        }
+    }
+    std::vector<std::string> invented(n);
+    for (auto& s : invented) {
+        s = "zz";
+        for (std::size_t len = 4 + rng() % 20; s.size() < len;)
+            s += static_cast<char>('a' + rng() % 26);
+    }
+
+    auto run = [&](const std::vector<std::string>& names, auto&& fn) {
+        std::size_t hits = 0;
+        auto start = Clock::now();
+        for (const std::string& name : names)
+            hits += fn(name);
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / names.size();
+        return std::pair<double, std::size_t>(ns, hits);
+    };
+    auto filtered = [&](const std::string& s) { return oracle.contains(s); };
+    auto exact = [&](const std::string& s) { return oracle.find(s) >= 0; };
+    auto filter = [&](const std::string& s) { return oracle.may_contain(s); };
+
+    auto [client_ns, client_hits] = run(client, filtered);
+    auto [client_exact_ns, _] = run(client, exact);
+    auto [invented_ns, invented_hits] = run(invented, filtered);
+    auto [invented_exact_ns, __] = run(invented, exact);
+    auto [filter_ns, false_positives] = run(invented, filter);
+    std::printf("open %.1f us; %zu names, filter %.1f KB\n", open_us, oracle.size(), oracle.filter_bytes() / 1024.0);
+    std::printf("client identifiers: %.1f ns each (exact set alone %.1f ns), %.1f%% in the SDK\n", client_ns,
+                client_exact_ns, 100.0 * client_hits / client.size());
+    std::printf("invented names:     %.1f ns each (exact set alone %.1f ns, filter alone %.1f ns), "
+                "%.2f%% false positives, %zu found\n",
+                invented_ns, invented_exact_ns, filter_ns, 100.0 * false_positives / invented.size(),
+                invented_hits);
+    return 0;
+}
+
+} // namespace
+
+int cmd_oracle(const Args& args) {
+    Options opts(args, {"corpus", "db", "out", "oracle", "bits-per-key", "queries"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "build")
+        return build(opts);
+    if (sub == "query")
+        return query(opts);
+    if (sub == "stats")
+        return stats(opts);
+    if (sub == "bench")
+        return bench(opts);
+    return usage();
+}
+
+} // namespace moby::cli
@@ -0,0 +1,76 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/corpus.h"
+#include "moby/error.h"
+#include "moby/scanner.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby scan [--corpus DIR] [--isa scalar|sse4.2|avx2] [--count] [FILE...]\n";
+    return 2;
+}
+
+} // namespace
+
+int cmd_scan(const Args& args) {
+    Options opts(args, {"corpus", "isa"});
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    Isa isa = best_isa();
+    if (opts.has("isa")) {
+        std::string name = opts.get("isa");
+        if (name == "scalar")
+            isa = Isa::Scalar;
+        else if (name == "sse4.2")
+            isa = Isa::Sse42;
+        else if (name == "avx2")
+            isa = Isa::Avx2;
+        else
+            return usage();
+        if (!isa_supported(isa))
+            throw Error(name + " is not supported on this CPU");
+    }
+
+    std::vector<std::string> files = opts.positional();
+    if (files.empty())
+        for (const std::string& name : list_corpus_files(dir))
+            files.push_back((std::filesystem::path(dir) / name).string());
+
+    std::size_t counts[kScanKindCount] = {};
+    std::uint64_t bytes = 0;
+    Clock::duration elapsed{};
+    std::vector<ScanHit> hits;
+    for (const std::string& path : files) {
+        MappedFile map(path);
+        hits.clear();
+        auto start = Clock::now();
+        scan(map.view(), hits, 0, isa);
+        elapsed += Clock::now() - start;
+        bytes += map.size();
+        for (const ScanHit& h : hits) {
+            ++counts[static_cast<int>(h.kind)];
+            if (!opts.has("count"))
+                std::printf("%s\t%" PRIu64 "\t%s\n", path.c_str(), h.offset, scan_kind_name(h.kind));
+        }
+    }
+
+    if (opts.has("count"))
+        for (int k = 0; k < kScanKindCount; ++k)
+            std::printf("%-16s %zu\n", scan_kind_name(static_cast<ScanKind>(k)), counts[k]);
+    double s = std::chrono::duration<double>(elapsed).count();
+    std::fprintf(stderr, "%s: %.1f MB in %.2f ms (%.2f GB/s)\n", isa_name(isa), bytes / 1e6, s * 1e3,
+                 s > 0 ? bytes / s / 1e9 : 0.0);
+    return 0;
+}
+
+} // namespace moby::cli
@@ -0,0 +1,123 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/search.h"
+#include "moby/work_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby search build [--corpus DIR] [--out FILE] [--jobs N]\n"
+                 "       moby search query [--corpus DIR] [--ignore-case] [--fixed] [--framework NAME]\n"
+                 "                         [--max N] [--count] [--time] PATTERN\n"
+                 "       moby search bench [--corpus DIR] [--ignore-case] [--fixed] [--repeat N] FILE\n";
+    return 2;
+}
+
+SearchOptions search_options(const Options& opts) {
+    SearchOptions so;
+    so.ignore_case = opts.has("ignore-case");
+    so.fixed = opts.has("fixed");
+    so.framework = opts.get("framework");
+    so.max_hits = opts.get_size("max", so.max_hits);
+    return so;
+}
+
+int build(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string out = opts.get("out", TrigramIndex::default_path(dir));
+    auto start = Clock::now();
+    Corpus corpus(dir);
+    TrigramIndex::build(corpus, out, static_cast<unsigned>(opts.get_size("jobs", default_thread_count())));
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    TrigramIndex index(out);
+    std::fprintf(stderr, "%zu trigrams, %.1f MB of postings over %zu sections in %.1f ms -> %s\n",
+                 index.trigram_count(), index.posting_bytes() / 1e6, index.section_count(), ms, out.c_str());
+    return 0;
+}
+
+int query(const Options& opts) {
+    if (opts.positional().size() != 2)
+        return usage();
+    Searcher searcher(opts.get("corpus", default_corpus_dir()));
+    auto start = Clock::now();
+    bool count_only = opts.has("count");
+    SearchStats stats = searcher.search(opts.positional()[1], search_options(opts), [&](const SearchHit& hit) {
+        if (count_only)
+            return;
+        std::string_view path = searcher.sections().path(*hit.section);
+        std::printf("%.*s:%u: %.*s\n", static_cast<int>(path.size()), path.data(), hit.line,
+                    static_cast<int>(hit.text.size()), hit.text.data());
+    });
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (count_only)
+        std::printf("%zu\n", stats.hits);
+    if (opts.has("time"))
+        std::fprintf(stderr, "%zu matches in %zu candidate sections (%.1f MB) in %.2f ms\n", stats.hits,
+                     stats.candidates, stats.scanned / 1e6, ms);
+    return stats.hits ? 0 : 1;
+}
+
+// Runs every pattern in FILE (one per line) and reports latency percentiles.
+int bench(const Options& opts) {
+    if (opts.positional().size() != 2)
+        return usage();
+    std::ifstream in(opts.positional()[1]);
+    if (!in)
+        throw Error("cannot read " + opts.positional()[1]);
+    std::vector<std::string> patterns;
+    for (std::string line; std::getline(in, line);)
+        if (!line.empty() && line[0] != '#')
+            patterns.push_back(line);
+    if (patterns.empty())
+        throw Error("no patterns in " + opts.positional()[1]);
+
+    Searcher searcher(opts.get("corpus", default_corpus_dir()));
+    SearchOptions so = search_options(opts);
+    std::size_t repeat = std::max<std::size_t>(opts.get_size("repeat", 5), 1);
+    std::vector<double> samples;
+    std::size_t hits = 0;
+    for (std::size_t r = 0; r < repeat; ++r) {
+        for (const std::string& pattern : patterns) {
+            auto start = Clock::now();
+            SearchStats stats = searcher.search(pattern, so, [](const SearchHit&) {});
+            samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            if (r == 0) {
+                std::printf("%8zu  %8.3f ms  %s\n", stats.hits, samples.back(), pattern.c_str());
+                hits += stats.hits;
+            }
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+    auto pct = [&](double p) { return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * samples.size()))]; };
+    std::printf("%zu patterns x %zu, %zu matches: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+                patterns.size(), repeat, hits, pct(0.5), pct(0.9), pct(0.99), samples.back());
+    return 0;
+}
+
+} // namespace
+
+int cmd_search(const Args& args) {
+    Options opts(args, {"corpus", "out", "jobs", "framework", "max", "repeat"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "build")
+        return build(opts);
+    if (sub == "query")
+        return query(opts);
+    if (sub == "bench")
+        return bench(opts);
+    return usage();
+}
+
+} // namespace moby::cli
@@ -0,0 +1,196 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/corpus.h"
+#include "moby/error.h"
+#include "moby/section_stream.h"
+#include "moby/symbols.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby stream split [--capacity BYTES] [--symbols] [--quiet] [FILE|-...]\n"
+                 "       moby stream bench [--corpus DIR] [--capacity BYTES] [--rounds N]\n";
+    return 2;
+}
+
+// VmHWM of this process in KiB.
+std::size_t peak_rss_kb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, 6, "VmHWM:") == 0)
+            return std::strtoull(line.c_str() + 6, nullptr, 10);
+    return 0;
+}
+
+// Splits stdin (or each FILE: plain, tar, or gzipped) and prints every
+// section as it completes, optionally with its symbol count.
+int split(const Options& opts) {
+    std::vector<std::string> inputs(opts.positional().begin() + 1, opts.positional().end());
+    if (inputs.empty())
+        inputs.push_back("-");
+    std::size_t capacity = opts.get_size("capacity", SectionStream::kDefaultCapacity);
+    bool symbols = opts.has("symbols"), quiet = opts.has("quiet");
+    auto start = Clock::now();
+    SectionStreamStats total;
+    std::size_t symbol_count = 0;
+    std::vector<Symbol> out;
+    for (const std::string& input : inputs) {
+        int fd = input == "-" ? 0 : ::open(input.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw Error("cannot open " + input + ": " + std::strerror(errno));
+        SectionStream stream(fd, capacity);
+        StreamSection s;
+        while (stream.next(s)) {
+            if (symbols) {
+                out.clear();
+                extract_symbols(s.text, s.offset, 0, out);
+                symbol_count += out.size();
+            }
+            if (quiet)
+                continue;
+            std::printf("%.*s%s%.*s\t%zu", static_cast<int>(s.source.size()), s.source.data(),
+                        s.source.empty() ? "" : ":", static_cast<int>(s.path.size()), s.path.data(), s.text.size());
+            if (symbols)
+                std::printf("\t%zu", out.size());
+            std::printf("\n");
+        }
+        const SectionStreamStats& st = stream.stats();
+        total.input_bytes += st.input_bytes;
+        total.bytes += st.bytes;
+        total.sections += st.sections;
+        total.members += st.members;
+        total.capacity = std::max(total.capacity, st.capacity);
+        total.peak_section = std::max(total.peak_section, st.peak_section);
+        if (fd != 0)
+            ::close(fd);
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::fprintf(stderr, "%llu sections", static_cast<unsigned long long>(total.sections));
+    if (total.members)
+        std::fprintf(stderr, " in %llu tar members", static_cast<unsigned long long>(total.members));
+    if (symbols)
+        std::fprintf(stderr, ", %zu symbols", symbol_count);
+    std::fprintf(stderr, "; %.1f MB (%.1f MB read) in %.1f ms; ring %zu KB, largest section %zu KB, peak RSS %zu KB\n",
+                 total.bytes / 1e6, total.input_bytes / 1e6, ms, total.capacity >> 10, total.peak_section >> 10,
+                 peak_rss_kb());
+    return 0;
+}
+
+// Feeds the corpus through a pipe from a writer thread, as `cat
+// *.framework.h | moby ...` would, and extracts symbols per section: once
+// with the stream, once buffering the whole input first.
+int bench(const Options& opts) {
+    Corpus corpus(opts.get("corpus", default_corpus_dir()));
+    std::size_t capacity = opts.get_size("capacity", SectionStream::kDefaultCapacity);
+    std::size_t rounds = opts.get_size("rounds", 5);
+
+    auto feed = [&](int fd) {
+        for (const auto& file : corpus.files()) {
+            std::string_view text = file.map.view();
+            while (!text.empty()) {
+                ssize_t n = ::write(fd, text.data(), std::min<std::size_t>(text.size(), 64 << 10));
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    throw Error(std::string("stream bench: write: ") + std::strerror(errno));
+                text.remove_prefix(static_cast<std::size_t>(n));
+            }
+        }
+        ::close(fd);
+    };
+    struct Run {
+        double first_ms = 1e300, total_ms = 1e300;
+        std::size_t sections = 0, symbols = 0, held = 0;
+    };
+    auto run = [&](bool streaming) {
+        Run best;
+        for (std::size_t round = 0; round < rounds; ++round) {
+            int fds[2];
+            if (::pipe(fds) != 0)
+                throw Error(std::string("stream bench: pipe: ") + std::strerror(errno));
+            auto start = Clock::now();
+            std::thread writer(feed, fds[1]);
+            Run r;
+            std::vector<Symbol> symbols;
+            auto section = [&](std::string_view text, std::uint64_t offset) {
+                if (r.sections++ == 0)
+                    r.first_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                symbols.clear();
+                extract_symbols(text, offset, 0, symbols);
+                r.symbols += symbols.size();
+            };
+            if (streaming) {
+                SectionStream stream(fds[0], capacity);
+                StreamSection s;
+                while (stream.next(s))
+                    section(s.text, s.offset);
+                r.held = stream.stats().capacity;
+            } else {
+                std::string all;
+                char buf[64 << 10];
+                for (ssize_t n; (n = ::read(fds[0], buf, sizeof buf)) != 0;) {
+                    if (n < 0 && errno == EINTR)
+                        continue;
+                    if (n < 0)
+                        throw Error(std::string("stream bench: read: ") + std::strerror(errno));
+                    all.append(buf, static_cast<std::size_t>(n));
+                }
+                split_sections(all, [&](const SectionSpan& span) {
+                    section(std::string_view(all).substr(span.offset, span.length), span.offset);
+                });
+                r.held = all.capacity();
+            }
+            writer.join();
+            ::close(fds[0]);
+            r.total_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            best.first_ms = std::min(best.first_ms, r.first_ms);
+            best.total_ms = std::min(best.total_ms, r.total_ms);
+            best.sections = r.sections;
+            best.symbols = r.symbols;
+            best.held = r.held;
+        }
+        return best;
+    };
+
+    Run streamed = run(true), buffered = run(false);
+    std::printf("%.1f MB, %zu sections in the corpus (best of %zu)\n", corpus.total_bytes() / 1e6,
+                corpus.sections().size(), rounds);
+    for (const auto& [name, r] : {std::pair<const char*, Run>("streamed", streamed), {"buffered", buffered}})
+        std::printf("%-9s first section %7.2f ms, all %6.1f ms (%4.0f MB/s); %zu sections, %zu symbols; "
+                    "holds %6zu KB\n",
+                    name, r.first_ms, r.total_ms, corpus.total_bytes() / 1e3 / r.total_ms, r.sections, r.symbols,
+                    r.held >> 10);
+    return streamed.sections == corpus.sections().size() && streamed.symbols == buffered.symbols ? 0 : 1;
+}
+
+} // namespace
+
+int cmd_stream(const Args& args) {
+    Options opts(args, {"corpus", "capacity", "rounds"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "split")
+        return split(opts);
+    if (sub == "bench")
+        return bench(opts);
+    return usage();
+}
+
+} // namespace moby::cli
@@ -0,0 +1,207 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/section_index.h"
+#include "moby/swift_names.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby swift build [--corpus DIR] [--db FILE] [--out FILE]\n"
+                 "       moby swift to-objc [--corpus DIR] [--table FILE] SWIFT_NAME...\n"
+                 "       moby swift to-swift [--corpus DIR] [--table FILE] NAME...\n"
+                 "       moby swift complete [--corpus DIR] [--table FILE] [--limit N] PREFIX...\n"
+                 "       moby swift stats [--corpus DIR] [--table FILE]\n"
+                 "       moby swift bench [--corpus DIR] [--table FILE] [--queries N] [--limit N]\n";
+    return 2;
+}
+
+std::string table_path(const Options& opts) {
+    return opts.get("table", SwiftNameTable::default_path(opts.get("corpus", default_corpus_dir())));
+}
+
+const char* side_name(SwiftKeySide side) {
+    switch (side) {
+    case SwiftKeySide::ObjC:
+        return "objc";
+    case SwiftKeySide::Swift:
+        return "swift";
+    case SwiftKeySide::Member:
+        return "member";
+    }
+    return "?";
+}
+
+std::string flag_names(std::uint8_t flags) {
+    std::string out;
+    if (flags & SwiftNameRecord::kRenamed)
+        out += "renamed";
+    if (flags & SwiftNameRecord::kRefined)
+        out += out.empty() ? "refined" : ",refined";
+    return out;
+}
+
+// kind, C/ObjC name, Swift name, parent, flags
+void print_record(const SwiftNameTable& table, const SwiftNameRecord& r) {
+    std::string_view name = table.str(r.name), swift = table.str(r.swift), parent = table.str(r.parent);
+    std::printf("%s\t%.*s\t%.*s\t%.*s\t%s\n", kind_name(r.kind), static_cast<int>(name.size()), name.data(),
+                static_cast<int>(swift.size()), swift.data(), static_cast<int>(parent.size()), parent.data(),
+                flag_names(r.flags).c_str());
+}
+
+int build(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string out = opts.get("out", SwiftNameTable::default_path(dir));
+    auto start = Clock::now();
+    Corpus corpus(dir);
+    SymbolDb db(opts.get("db", SymbolDb::default_path(dir)));
+    if (db.corpus_hash() != corpus_hash(corpus))
+        throw Error("symbols.db is out of date; run 'moby symbols build'");
+    SwiftNameStats stats = SwiftNameTable::build(corpus, db, out);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::fprintf(stderr,
+                 "%zu annotations (%zu unattached) on %zu declarations: %zu renamed, %zu refined; %zu keys; "
+                 "%.1f ms -> %s\n",
+                 stats.annotations, stats.unattached, stats.records, stats.renamed, stats.refined, stats.keys, ms,
+                 out.c_str());
+    return 0;
+}
+
+// Exact lookups of one spelling; `swift` picks the Swift and member keys.
+int lookup(const Options& opts, bool swift) {
+    if (opts.positional().size() < 2)
+        return usage();
+    SwiftNameTable table(table_path(opts));
+    int status = 0;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        bool found = false;
+        for (const SwiftNameKey& k : table.find(opts.positional()[i])) {
+            if ((k.side == SwiftKeySide::ObjC) == swift)
+                continue;
+            print_record(table, table.record(k));
+            found = true;
+        }
+        if (!found) {
+            std::cerr << "moby swift: no " << (swift ? "Swift name " : "renamed declaration ")
+                      << opts.positional()[i] << '\n';
+            status = 1;
+        }
+    }
+    return status;
+}
+
+int complete(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    SwiftNameTable table(table_path(opts));
+    std::size_t limit = opts.get_size("limit", 20);
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        SwiftNameTable::Keys keys = table.complete(opts.positional()[i]);
+        std::size_t shown = 0;
+        for (const SwiftNameKey& k : keys) {
+            if (shown++ == limit)
+                break;
+            std::string_view text = table.str(k.text);
+            std::printf("%.*s\t%s\t", static_cast<int>(text.size()), text.data(), side_name(k.side));
+            print_record(table, table.record(k));
+        }
+        if (keys.count > limit)
+            std::printf("... %zu more\n", keys.count - limit);
+    }
+    return 0;
+}
+
+int stats(const Options& opts) {
+    SwiftNameTable table(table_path(opts));
+    std::size_t by_kind[kSymbolKindCount] = {}, renamed = 0, refined = 0, sides[3] = {};
+    for (std::size_t i = 0; i < table.size(); ++i) {
+        const SwiftNameRecord& r = table.record(i);
+        ++by_kind[static_cast<int>(r.kind)];
+        renamed += (r.flags & SwiftNameRecord::kRenamed) != 0;
+        refined += (r.flags & SwiftNameRecord::kRefined) != 0;
+    }
+    SwiftNameTable::Keys all = table.complete("");
+    for (const SwiftNameKey& k : all)
+        ++sides[static_cast<int>(k.side)];
+    std::printf("%-16s %zu (%zu renamed, %zu refined)\n", "declarations", table.size(), renamed, refined);
+    for (int k = 0; k < kSymbolKindCount; ++k)
+        if (by_kind[k])
+            std::printf("  %-14s %zu\n", kind_name(static_cast<SymbolKind>(k)), by_kind[k]);
+    std::printf("%-16s %zu (%zu objc, %zu swift, %zu member)\n", "keys", table.key_count(), sides[0], sides[1],
+                sides[2]);
+    return 0;
+}
+
+// Autocomplete as a frontend issues it: prefixes of random keys, each query
+// reading the spellings of up to --limit matches.
+int bench(const Options& opts) {
+    auto open_start = Clock::now();
+    SwiftNameTable table(table_path(opts));
+    double open_us = std::chrono::duration<double, std::micro>(Clock::now() - open_start).count();
+    if (table.key_count() == 0)
+        throw Error("swift name table is empty");
+    std::size_t queries = opts.get_size("queries", 200000), limit = opts.get_size("limit", 20);
+    SwiftNameTable::Keys all = table.complete("");
+    std::mt19937_64 rng(42);
+    std::vector<std::string> prefixes(queries);
+    for (std::string& p : prefixes) {
+        std::string_view text = table.str(all.first[rng() % all.count].text);
+        p = std::string(text.substr(0, 1 + rng() % text.size()));
+    }
+    std::size_t matches = 0, bytes = 0;
+    std::vector<double> latency;
+    latency.reserve(queries);
+    auto start = Clock::now();
+    for (const std::string& p : prefixes) {
+        auto q = Clock::now();
+        SwiftNameTable::Keys keys = table.complete(p);
+        matches += keys.count;
+        std::size_t n = 0;
+        for (const SwiftNameKey& k : keys) {
+            if (n++ == limit)
+                break;
+            bytes += table.str(k.text).size() + table.str(table.record(k).swift).size();
+        }
+        latency.push_back(std::chrono::duration<double, std::micro>(Clock::now() - q).count());
+    }
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / queries;
+    std::sort(latency.begin(), latency.end());
+    std::printf("open %.1f us; %zu prefix queries over %zu keys: %.2f us each, p99 %.2f us "
+                "(%.1f matches on average, %zu bytes read)\n",
+                open_us, queries, table.key_count(), us, latency[latency.size() * 99 / 100],
+                static_cast<double>(matches) / queries, bytes);
+    return 0;
+}
+
+} // namespace
+
+int cmd_swift(const Args& args) {
+    Options opts(args, {"corpus", "db", "out", "table", "limit", "queries"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "build")
+        return build(opts);
+    if (sub == "to-objc")
+        return lookup(opts, true);
+    if (sub == "to-swift")
+        return lookup(opts, false);
+    if (sub == "complete")
+        return complete(opts);
+    if (sub == "stats")
+        return stats(opts);
+    if (sub == "bench")
+        return bench(opts);
+    return usage();
+}
+
+} // namespace moby::cli
@@ -0,0 +1,132 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/symbol_db.h"
+#include "moby/work_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby symbols build [--corpus DIR] [--out FILE] [--jobs N]\n"
+                 "       moby symbols find [--corpus DIR] [--db FILE] [--kind KIND] [--time] NAME...\n"
+                 "       moby symbols stats [--corpus DIR] [--db FILE]\n";
+    return 2;
+}
+
+int build(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string out = opts.get("out", SymbolDb::default_path(dir));
+    auto start = Clock::now();
+    Corpus corpus(dir);
+    unsigned jobs = static_cast<unsigned>(opts.get_size("jobs", default_thread_count()));
+    auto parse_start = Clock::now();
+    std::vector<Symbol> symbols = extract_corpus_symbols(corpus, jobs);
+    double parse_ms = std::chrono::duration<double, std::milli>(Clock::now() - parse_start).count();
+    SymbolDb::build(corpus, symbols, out);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::fprintf(stderr, "extracted %zu symbols from %zu sections in %.1f ms (parse %.1f ms on %u threads) -> %s\n",
+                 symbols.size(), corpus.sections().size(), ms, parse_ms, jobs ? jobs : 1, out.c_str());
+    return 0;
+}
+
+// Header line of a record, counted from its section start in the corpus file.
+class LineFinder {
+public:
+    LineFinder(const SymbolDb& db, std::string dir) : db_(db), dir_(std::move(dir)) {}
+
+    std::size_t line(const SymbolRecord& r) {
+        auto& map = maps_[db_.section(r).file];
+        if (!map)
+            map = std::make_unique<MappedFile>(
+                (std::filesystem::path(dir_) / std::string(db_.file_name(db_.section(r).file))).string());
+        std::string_view text = map->view();
+        std::size_t begin = std::min<std::size_t>(db_.section(r).offset, text.size());
+        std::size_t end = std::min<std::size_t>(r.offset, text.size());
+        return 1 + std::count(text.begin() + begin, text.begin() + end, '\n');
+    }
+
+private:
+    const SymbolDb& db_;
+    std::string dir_;
+    std::map<std::uint32_t, std::unique_ptr<MappedFile>> maps_;
+};
+
+int find(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    if (opts.positional().size() < 2)
+        return usage();
+    SymbolKind kind{};
+    bool filter = opts.has("kind");
+    if (filter && !parse_kind(opts.get("kind"), kind))
+        throw Error("unknown kind " + opts.get("kind"));
+
+    auto start = Clock::now();
+    SymbolDb db(opts.get("db", SymbolDb::default_path(dir)));
+    double open_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+    LineFinder lines(db, dir);
+    int status = 0;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        auto lookup = Clock::now();
+        SymbolDb::Range range = db.find(opts.positional()[i]);
+        double lookup_us = std::chrono::duration<double, std::micro>(Clock::now() - lookup).count();
+        std::size_t shown = 0;
+        for (const SymbolRecord& r : range) {
+            if (filter && r.kind != kind)
+                continue;
+            std::string_view name = db.name(r), parent = db.parent(r), path = db.section_path(r);
+            std::printf("%s\t%.*s\t%.*s\t%.*s:%zu\n", kind_name(r.kind), static_cast<int>(name.size()),
+                        name.data(), static_cast<int>(parent.size()), parent.data(),
+                        static_cast<int>(path.size()), path.data(), lines.line(r));
+            ++shown;
+        }
+        if (shown == 0) {
+            std::cerr << "moby symbols: no symbol " << opts.positional()[i] << '\n';
+            status = 1;
+        }
+        if (opts.has("time"))
+            std::fprintf(stderr, "open: %.1f us, lookup: %.2f us\n", open_us, lookup_us);
+    }
+    return status;
+}
+
+int stats(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    SymbolDb db(opts.get("db", SymbolDb::default_path(dir)));
+    std::size_t counts[kSymbolKindCount] = {};
+    for (std::size_t i = 0; i < db.size(); ++i)
+        ++counts[static_cast<int>(db.at(i).kind)];
+    for (int k = 0; k < kSymbolKindCount; ++k)
+        std::printf("%-16s %zu\n", kind_name(static_cast<SymbolKind>(k)), counts[k]);
+    std::printf("%-16s %zu\n", "total", db.size());
+    return 0;
+}
+
+} // namespace
+
+int cmd_symbols(const Args& args) {
+    Options opts(args, {"corpus", "out", "db", "kind", "jobs"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "build")
+        return build(opts);
+    if (sub == "find")
+        return find(opts);
+    if (sub == "stats")
+        return stats(opts);
+    return usage();
+}
+
+} // namespace moby::cli
@@ -0,0 +1,303 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/decl_cache.h"
+#include "moby/error.h"
+#include "moby/type_graph.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+
+namespace moby::cli {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int usage() {
+    std::cerr << "usage: moby types build [--corpus DIR] [--cache FILE] [--out FILE]\n"
+                 "       moby types users [--corpus DIR] [--aliases] [--consumes|--produces] [--framework NAME] TYPE...\n"
+                 "       moby types frameworks [--corpus DIR] [--aliases] TYPE...\n"
+                 "       moby types of [--corpus DIR] NAME...\n"
+                 "       moby types stats [--corpus DIR] [--graph FILE]\n"
+                 "       moby types bench [--corpus DIR] [--queries N]\n";
+    return 2;
+}
+
+std::string graph_path(const Options& opts) {
+    return opts.get("graph", TypeGraph::default_path(opts.get("corpus", default_corpus_dir())));
+}
+
+// The declaration cache the graph refers to, refused when out of date.
+DeclCache open_decls(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    DeclCache decls(opts.get("cache", DeclCache::default_path(dir)));
+    if (!decls.is_current(dir))
+        throw Error("decls.cache is out of date; run 'moby decls build'");
+    return decls;
+}
+
+TypeGraph open_graph(const Options& opts, const DeclCache& decls) {
+    TypeGraph graph(graph_path(opts));
+    if (graph.corpus_hash() != decls.corpus_hash() || graph.decl_count() != decls.size())
+        throw Error("types.graph is out of date; run 'moby types build'");
+    return graph;
+}
+
+const char* role_text(std::uint8_t roles) {
+    switch (roles) {
+    case TypeUse::kConsumes:
+        return "consumes";
+    case TypeUse::kProduces:
+        return "produces";
+    default:
+        return "both";
+    }
+}
+
+std::uint32_t find_type(const TypeGraph& graph, const std::string& name) {
+    std::uint32_t t = graph.find_type(name);
+    if (t == TypeGraph::kNone)
+        std::fprintf(stderr, "%s: not a declared type\n", name.c_str());
+    return t;
+}
+
+// Declarations using type `t` and, with --aliases, the types it is a typedef
+// of or that are typedefs of it; one entry per declaration.
+void type_users(const Options& opts, const TypeGraph& graph, std::uint32_t t, std::vector<TypeUse>& uses) {
+    uses.clear();
+    if (!opts.has("aliases")) {
+        graph.users(t, uses);
+        return;
+    }
+    std::vector<std::uint32_t> types;
+    graph.aliases(t, types);
+    for (std::uint32_t a : types)
+        graph.users(a, uses);
+    std::sort(uses.begin(), uses.end(), [](const TypeUse& a, const TypeUse& b) { return a.id < b.id; });
+    std::size_t kept = 0;
+    for (const TypeUse& u : uses) {
+        if (kept && uses[kept - 1].id == u.id)
+            uses[kept - 1].roles |= u.roles;
+        else
+            uses[kept++] = u;
+    }
+    uses.resize(kept);
+    if (types.size() > 1) {
+        std::fprintf(stderr, "%s with aliases", std::string(graph.name(graph.type(t).name)).c_str());
+        for (std::size_t k = 1; k < types.size(); ++k)
+            std::fprintf(stderr, "%s%s", k == 1 ? " " : ", ", std::string(graph.name(graph.type(types[k]).name)).c_str());
+        std::fprintf(stderr, "\n");
+    }
+}
+
+int build(const Options& opts) {
+    std::string dir = opts.get("corpus", default_corpus_dir());
+    std::string out = opts.get("out", TypeGraph::default_path(dir));
+    auto start = Clock::now();
+    DeclCache decls = open_decls(opts);
+    TypeGraphStats stats = TypeGraph::build(decls, out);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::fprintf(stderr,
+                 "%zu types used by %zu declarations, %zu edges; lists %.1f KB (%.1f KB as pairs); %.1f ms -> %s\n",
+                 stats.types, stats.declarations, stats.edges, stats.list_bytes / 1024.0, stats.raw_bytes / 1024.0, ms,
+                 out.c_str());
+    return 0;
+}
+
+// Declarations using each TYPE, grouped by framework.
+int users(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    DeclCache decls = open_decls(opts);
+    TypeGraph graph = open_graph(opts, decls);
+    std::uint8_t want = opts.has("consumes") ? TypeUse::kConsumes : opts.has("produces") ? TypeUse::kProduces : 3;
+    std::string framework = opts.get("framework", "");
+    int status = 0;
+    std::vector<TypeUse> uses;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        std::uint32_t t = find_type(graph, opts.positional()[i]);
+        if (t == TypeGraph::kNone) {
+            status = 1;
+            continue;
+        }
+        type_users(opts, graph, t, uses);
+        std::stable_sort(uses.begin(), uses.end(), [&](const TypeUse& a, const TypeUse& b) {
+            return graph.framework_name(graph.framework(a.id)) < graph.framework_name(graph.framework(b.id));
+        });
+        std::string_view current;
+        for (const TypeUse& u : uses) {
+            std::string_view f = graph.framework_name(graph.framework(u.id));
+            if (!(u.roles & want) || (!framework.empty() && f != framework))
+                continue;
+            if (f != current)
+                std::printf("%.*s\n", static_cast<int>(f.size()), f.data());
+            current = f;
+            std::printf("  %-8s %s\n", role_text(u.roles), decls.signature(decls.at(u.id)).c_str());
+        }
+    }
+    return status;
+}
+
+// Per framework, how many declarations consume and produce each TYPE.
+int frameworks(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    DeclCache decls = open_decls(opts);
+    TypeGraph graph = open_graph(opts, decls);
+    int status = 0;
+    std::vector<TypeUse> uses;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        std::uint32_t t = find_type(graph, opts.positional()[i]);
+        if (t == TypeGraph::kNone) {
+            status = 1;
+            continue;
+        }
+        type_users(opts, graph, t, uses);
+        std::vector<std::pair<std::size_t, std::size_t>> counts(graph.framework_count());
+        std::size_t consumers = 0, producers = 0;
+        for (const TypeUse& u : uses) {
+            counts[graph.framework(u.id)].first += (u.roles & TypeUse::kConsumes) != 0;
+            counts[graph.framework(u.id)].second += (u.roles & TypeUse::kProduces) != 0;
+            consumers += (u.roles & TypeUse::kConsumes) != 0;
+            producers += (u.roles & TypeUse::kProduces) != 0;
+        }
+        std::printf("%s: %zu consumers, %zu producers\n", opts.positional()[i].c_str(), consumers, producers);
+        for (std::uint16_t f = 0; f < counts.size(); ++f)
+            if (counts[f].first || counts[f].second)
+                std::printf("  %-28.*s %6zu consume %6zu produce\n", static_cast<int>(graph.framework_name(f).size()),
+                            graph.framework_name(f).data(), counts[f].first, counts[f].second);
+    }
+    return status;
+}
+
+// Types each declaration named NAME uses.
+int of(const Options& opts) {
+    if (opts.positional().size() < 2)
+        return usage();
+    DeclCache decls = open_decls(opts);
+    TypeGraph graph = open_graph(opts, decls);
+    int status = 0;
+    std::vector<TypeUse> uses;
+    for (std::size_t i = 1; i < opts.positional().size(); ++i) {
+        DeclCache::Ids ids = decls.find(opts.positional()[i]);
+        if (ids.count == 0) {
+            std::fprintf(stderr, "%s: not declared\n", opts.positional()[i].c_str());
+            status = 1;
+        }
+        for (std::uint32_t id : ids) {
+            std::printf("%s\n", decls.signature(decls.at(id)).c_str());
+            uses.clear();
+            graph.types_of(id, uses);
+            for (const TypeUse& u : uses) {
+                std::string_view name = graph.name(graph.type(u.id).name);
+                std::printf("  %-8s %.*s\n", role_text(u.roles), static_cast<int>(name.size()), name.data());
+            }
+        }
+    }
+    return status;
+}
+
+int stats(const Options& opts) {
+    TypeGraph graph(graph_path(opts));
+    std::size_t used = 0, edges = 0;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> top;
+    for (std::uint32_t t = 0; t < graph.type_count(); ++t) {
+        used += graph.type(t).count != 0;
+        edges += graph.type(t).count;
+        top.emplace_back(graph.type(t).count, t);
+    }
+    std::partial_sort(top.begin(), top.begin() + std::min<std::size_t>(10, top.size()), top.end(),
+                      std::greater<>());
+    std::printf("%-12s %zu (%zu used)\n%-12s %zu\n%-12s %zu\n%-12s %zu\nmost used:\n", "types", graph.type_count(),
+                used, "decls", graph.decl_count(), "edges", edges, "frameworks", graph.framework_count());
+    for (std::size_t k = 0; k < std::min<std::size_t>(10, top.size()); ++k) {
+        std::string_view name = graph.name(graph.type(top[k].second).name);
+        std::printf("  %-24.*s %u\n", static_cast<int>(name.size()), name.data(), top[k].first);
+    }
+    return 0;
+}
+
+// Reverse lookups of random used types: the graph against scanning every
+// declaration's types in the cache for the name.
+int bench(const Options& opts) {
+    DeclCache decls = open_decls(opts);
+    TypeGraph graph = open_graph(opts, decls);
+    std::size_t n = opts.get_size("queries", 100000);
+    std::mt19937_64 rng(42);
+    std::vector<std::uint32_t> used;
+    for (std::uint32_t t = 0; t < graph.type_count(); ++t)
+        if (graph.type(t).count)
+            used.push_back(t);
+    std::vector<std::string> names(n);
+    for (std::string& name : names)
+        name = std::string(graph.name(graph.type(used[rng() % used.size()]).name));
+
+    std::vector<TypeUse> uses;
+    std::size_t edges = 0;
+    auto start = Clock::now();
+    for (const std::string& name : names) {
+        uses.clear();
+        graph.users(graph.find_type(name), uses);
+        edges += uses.size();
+    }
+    double graph_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / n;
+
+    // The scan is slow; a few hundred queries are enough.
+    std::size_t scanned = std::min<std::size_t>(n, 200), hits = 0;
+    auto mentions = [](std::string_view type, std::string_view name) {
+        for (std::size_t at = type.find(name); at != std::string_view::npos; at = type.find(name, at + 1)) {
+            auto ident = [](char c) { return c == '_' || std::isalnum(static_cast<unsigned char>(c)); };
+            bool before = at == 0 || !ident(type[at - 1]);
+            bool after = at + name.size() == type.size() || !ident(type[at + name.size()]);
+            if (before && after)
+                return true;
+        }
+        return false;
+    };
+    start = Clock::now();
+    for (std::size_t q = 0; q < scanned; ++q) {
+        for (std::size_t id = 0; id < decls.size(); ++id) {
+            const DeclRecord& d = decls.at(id);
+            bool hit = mentions(decls.str(d.type), names[q]);
+            for (const DeclPart& part : decls.parts(d))
+                hit = hit || mentions(decls.str(part.type), names[q]);
+            hits += hit;
+        }
+    }
+    double scan_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / scanned;
+
+    std::printf("%zu types used, %zu declarations (%zu queries)\n", used.size(), graph.decl_count(), n);
+    std::printf("%-14s %10.0f ns per lookup  (%.1f uses on average)\n", "graph", graph_ns,
+                static_cast<double>(edges) / n);
+    std::printf("%-14s %10.0f ns per lookup  (%.1f mentions on average)  %.0fx\n", "scan cache", scan_ns,
+                static_cast<double>(hits) / scanned, scan_ns / graph_ns);
+    return 0;
+}
+
+} // namespace
+
+int cmd_types(const Args& args) {
+    Options opts(args, {"corpus", "cache", "graph", "out", "framework", "queries"});
+    if (opts.positional().empty())
+        return usage();
+    const std::string& sub = opts.positional()[0];
+    if (sub == "build")
+        return build(opts);
+    if (sub == "users")
+        return users(opts);
+    if (sub == "frameworks")
+        return frameworks(opts);
+    if (sub == "of")
+        return of(opts);
+    if (sub == "stats")
+        return stats(opts);
+    if (sub == "bench")
+        return bench(opts);
+    return usage();
+}
+
+} // namespace moby::cli
@@ -0,0 +1,31 @@
+#include "commands.h"
+#include "options.h"
+
+#include "moby/section_cache.h"
+#include "moby/work_pool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+namespace moby::cli {
+
+int cmd_update(const Args& args) {
+    Options opts(args, {"corpus", "jobs"});
+    if (!opts.positional().empty()) {
+        std::cerr << "usage: moby update [--corpus DIR] [--jobs N] [--full]\n";
+        return 2;
+    }
+    auto start = std::chrono::steady_clock::now();
+    Corpus corpus(opts.get("corpus", default_corpus_dir()));
+    unsigned jobs = static_cast<unsigned>(opts.get_size("jobs", default_thread_count()));
+    RebuildStats stats = rebuild_indexes(corpus, jobs, opts.has("full"));
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr,
+                 "%zu sections: %zu reused, %zu parsed\n"
+                 "hash %.1f ms, parse %.1f ms, write %.1f ms, total %.1f ms\n",
+                 stats.sections, stats.reused, stats.parsed, stats.hash_ms, stats.parse_ms, stats.write_ms, ms);
+    return 0;
+}
+
+} // namespace moby::cli
@@ -0,0 +1,35 @@
+// Subcommands of the `moby` tool. Each returns the process exit status.
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace moby::cli {
+
+using Args = std::vector<std::string>;
+
+int cmd_archive(const Args& args);
+int cmd_availability(const Args& args);
+int cmd_classes(const Args& args);
+int cmd_cond(const Args& args);
+int cmd_decls(const Args& args);
+int cmd_deprecations(const Args& args);
+int cmd_diff(const Args& args);
+int cmd_docs(const Args& args);
+int cmd_enums(const Args& args);
+int cmd_headers(const Args& args);
+int cmd_includes(const Args& args);
+int cmd_index(const Args& args);
+int cmd_layout(const Args& args);
+int cmd_lsp(const Args& args);
+int cmd_nullability(const Args& args);
+int cmd_oracle(const Args& args);
+int cmd_scan(const Args& args);
+int cmd_search(const Args& args);
+int cmd_stream(const Args& args);
+int cmd_swift(const Args& args);
+int cmd_symbols(const Args& args);
+int cmd_types(const Args& args);
+int cmd_update(const Args& args);
+
+} // namespace moby::cli
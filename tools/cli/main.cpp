@@ -0,0 +1,68 @@
+#include "commands.h"
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+namespace {
+
+struct Command {
+    const char* name;
+    int (*run)(const moby::cli::Args&);
+    const char* summary;
+};
+
+const Command kCommands[] = {
+    {"archive", moby::cli::cmd_archive, "seekable compressed archive of the corpus"},
+    {"availability", moby::cli::cmd_availability, "build and query the availability matrix"},
+    {"classes", moby::cli::cmd_classes, "Objective-C class graph and flattened method tables"},
+    {"cond", moby::cli::cmd_cond, "evaluate #if conditionals for a target configuration"},
+    {"decls", moby::cli::cmd_decls, "cached declaration model: signatures, members and availability"},
+    {"deprecations", moby::cli::cmd_deprecations, "deprecated APIs, their replacements, and uses in client code"},
+    {"diff", moby::cli::cmd_diff, "added, removed and changed APIs between two corpora"},
+    {"docs", moby::cli::cmd_docs, "HeaderDoc comments by symbol, parsed once and stored compressed"},
+    {"enums", moby::cli::cmd_enums, "constant-folded enum values, by name and by value"},
+    {"headers", moby::cli::cmd_headers, "rebuild the Headers/ tree of every framework from the corpus"},
+    {"includes", moby::cli::cmd_includes, "build and query the #import/#include graph"},
+    {"index", moby::cli::cmd_index, "build and query the section index"},
+    {"layout", moby::cli::cmd_layout, "struct and union layouts for LP64 and ILP32"},
+    {"lsp", moby::cli::cmd_lsp, "language server: hover, definition and workspace symbols"},
+    {"nullability", moby::cli::cmd_nullability, "assume-nonnull regions and per-declaration nullability"},
+    {"oracle", moby::cli::cmd_oracle, "does an identifier exist in the SDK, and in which frameworks"},
+    {"scan", moby::cli::cmd_scan, "find separators, keywords and availability macros"},
+    {"search", moby::cli::cmd_search, "trigram-indexed regex search with header locations"},
+    {"stream", moby::cli::cmd_stream, "split a corpus stream, tarball or pipe into sections as it arrives"},
+    {"swift", moby::cli::cmd_swift, "NS_SWIFT_NAME mapping and autocomplete over both spellings"},
+    {"symbols", moby::cli::cmd_symbols, "build and query the symbol database"},
+    {"types", moby::cli::cmd_types, "cross-framework type usage: which APIs consume or produce a type"},
+    {"update", moby::cli::cmd_update, "rebuild every index, reparsing only changed sections"},
+};
+
+void usage() {
+    std::cerr << "usage: moby <command> [options]\n\ncommands:\n";
+    for (const Command& c : kCommands)
+        std::cerr << "  " << c.name << std::string(14 - std::strlen(c.name), ' ') << c.summary << '\n';
+    std::cerr << "\nThe corpus directory defaults to $MOBY_CORPUS or the current directory.\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2 || !std::strcmp(argv[1], "-h") || !std::strcmp(argv[1], "--help")) {
+        usage();
+        return argc < 2 ? 2 : 0;
+    }
+    for (const Command& c : kCommands) {
+        if (std::strcmp(argv[1], c.name) != 0)
+            continue;
+        try {
+            return c.run(moby::cli::Args(argv + 2, argv + argc));
+        } catch (const std::exception& e) {
+            std::cerr << "moby " << c.name << ": " << e.what() << '\n';
+            return 1;
+        }
+    }
+    std::cerr << "moby: unknown command '" << argv[1] << "'\n";
+    usage();
+    return 2;
+}
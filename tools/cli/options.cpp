@@ -0,0 +1,59 @@
+#include "options.h"
+
+#include "moby/error.h"
+
+namespace moby::cli {
+
+Options::Options(const std::vector<std::string>& args, std::initializer_list<std::string_view> valued) {
+    std::set<std::string_view> takes_value(valued);
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        if (arg.size() < 3 || arg.compare(0, 2, "--") != 0) {
+            positional_.push_back(arg);
+            continue;
+        }
+        std::string name = arg.substr(2);
+        std::size_t eq = name.find('=');
+        if (eq != std::string::npos) {
+            values_[name.substr(0, eq)] = name.substr(eq + 1);
+        } else if (takes_value.count(name)) {
+            if (i + 1 >= args.size())
+                throw Error("option --" + name + " needs a value");
+            values_[name] = args[++i];
+        } else {
+            values_[name] = "";
+        }
+    }
+}
+
+std::string Options::get(std::string_view name, const std::string& fallback) const {
+    auto it = values_.find(std::string(name));
+    return it == values_.end() ? fallback : it->second;
+}
+
+std::size_t Options::get_size(std::string_view name, std::size_t fallback) const {
+    auto it = values_.find(std::string(name));
+    if (it == values_.end())
+        return fallback;
+    try {
+        return static_cast<std::size_t>(std::stoull(it->second));
+    } catch (const std::exception&) {
+        throw Error("option --" + std::string(name) + " needs a number");
+    }
+}
+
+std::vector<std::string> split_list(const std::string& s) {
+    std::vector<std::string> out;
+    std::size_t begin = 0;
+    while (begin <= s.size()) {
+        std::size_t comma = s.find(',', begin);
+        if (comma == std::string::npos)
+            comma = s.size();
+        if (comma > begin)
+            out.push_back(s.substr(begin, comma - begin));
+        begin = comma + 1;
+    }
+    return out;
+}
+
+} // namespace moby::cli
@@ -0,0 +1,31 @@
+// Minimal `--name value` / `--name=value` / `--flag` argument parsing.
+#pragma once
+
+#include <initializer_list>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby::cli {
+
+class Options {
+public:
+    // `valued` lists the long option names that take a value.
+    Options(const std::vector<std::string>& args, std::initializer_list<std::string_view> valued);
+
+    bool has(std::string_view name) const { return values_.count(std::string(name)) != 0; }
+    std::string get(std::string_view name, const std::string& fallback = {}) const;
+    std::size_t get_size(std::string_view name, std::size_t fallback) const;
+    const std::vector<std::string>& positional() const { return positional_; }
+
+private:
+    std::map<std::string, std::string> values_;
+    std::vector<std::string> positional_;
+};
+
+// "a,b,,c" -> {"a", "b", "c"}.
+std::vector<std::string> split_list(const std::string& s);
+
+} // namespace moby::cli
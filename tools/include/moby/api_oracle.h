@@ -0,0 +1,88 @@
+// Existence oracle for linters: "is this identifier an SDK API, and in which
+// frameworks?" without the corpus or symbols.db at hand.
+//
+// Every symbol name goes in, plus the first piece of each selector without
+// its colon ("openURL" for openURL:options:completionHandler:), which is what
+// a tokenizer sees in a message send. A split-block Bloom filter answers
+// first: the name picks one 64-byte block and must find one bit set in each of
+// its eight words, so a negative costs one cache line. Names that pass are
+// confirmed against the exact set: the sorted names front-coded in buckets of
+// 16, found by a binary search over bucket heads and a scan of one bucket.
+// Each name carries a bit-packed ID of its set of frameworks.
+//
+// The file is self-contained (about 1 MB for the reference corpus) and does
+// not need to match the corpus it was built from.
+#pragma once
+
+#include "moby/binary.h"
+#include "moby/corpus.h"
+#include "moby/symbol_db.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace moby {
+
+struct ApiOracleStats {
+    std::size_t names = 0;
+    std::size_t frameworks = 0;
+    std::size_t framework_sets = 0;
+    std::size_t filter_bytes = 0;
+    std::size_t set_bytes = 0;  // front-coded names and framework IDs
+};
+
+class ApiOracle {
+public:
+    static constexpr std::string_view kMagic = "MOBYORCL";
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::uint32_t kDefaultBitsPerKey = 12;
+
+    static std::string default_path(const std::string& corpus_dir);
+
+    static ApiOracleStats build(const Corpus& corpus, const SymbolDb& db, const std::string& path,
+                                std::uint32_t bits_per_key = kDefaultBitsPerKey);
+
+    explicit ApiOracle(const std::string& path);
+
+    std::uint64_t corpus_hash() const { return reader_.header().corpus_hash; }
+    std::size_t size() const { return name_count_; }
+    std::size_t framework_count() const { return framework_count_; }
+    std::size_t filter_bytes() const { return block_count_ * 64; }
+    std::string_view framework(std::uint32_t i) const { return reader_.str(strings_, frameworks_[i]); }
+
+    // Filter only: false means absent; true is wrong for about 1% of absent names.
+    bool may_contain(std::string_view name) const;
+
+    // Index of `name` in the exact set, or -1.
+    std::int64_t find(std::string_view name) const;
+    bool contains(std::string_view name) const { return may_contain(name) && find(name) >= 0; }
+
+    // Frameworks declaring name `index`, as framework() indexes.
+    struct Frameworks {
+        const std::uint16_t* first;
+        std::size_t count;
+        const std::uint16_t* begin() const { return first; }
+        const std::uint16_t* end() const { return first + count; }
+    };
+    Frameworks frameworks(std::size_t index) const;
+
+private:
+    BlobReader reader_;
+    const std::uint64_t* blocks_ = nullptr;       // 8 words per block
+    const std::uint32_t* buckets_ = nullptr;      // offset of each bucket in names_
+    const unsigned char* names_ = nullptr;
+    const std::uint64_t* set_ids_ = nullptr;      // framework set of each name, set_bits_ wide
+    const std::uint32_t* set_first_ = nullptr;    // framework set -> first in set_members_, plus an end
+    const std::uint16_t* set_members_ = nullptr;
+    const StrRef* frameworks_ = nullptr;
+    std::uint64_t block_count_ = 0;
+    std::uint64_t name_count_ = 0;
+    std::uint64_t bucket_count_ = 0;
+    std::uint64_t names_size_ = 0;
+    std::uint64_t framework_count_ = 0;
+    std::uint32_t set_bits_ = 0;
+    std::uint64_t strings_ = 0;
+};
+
+} // namespace moby
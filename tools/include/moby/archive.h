@@ -0,0 +1,106 @@
+// Seekable compressed archive of the corpus.
+//
+// Every header section is deflated on its own, primed with a dictionary
+// trained on the whole corpus, so a single header decompresses without
+// touching any other and still benefits from the boilerplate all headers
+// share. A frame holds the section's raw bytes from its separator up to the
+// next one; text ahead of a file's first separator is a frame of its own, so
+// concatenating a file's frames restores it byte for byte. An offset table
+// and a path table sorted by name locate any section with one binary search.
+#pragma once
+
+#include "moby/binary.h"
+#include "moby/corpus.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+struct ArchiveOptions {
+    int level = 9;                          // zlib compression level
+    std::size_t dictionary_size = 32 << 10; // 0 disables the dictionary
+    unsigned threads = 0;
+};
+
+struct ArchiveFrame {
+    std::uint64_t offset;   // of the compressed bytes within the archive
+    std::uint32_t stored;   // compressed size, or `length` when kept raw
+    std::uint32_t length;   // uncompressed size
+    std::uint32_t content;  // offset of the section text within the frame
+    std::uint32_t file;
+    std::uint32_t flags;
+    std::uint32_t reserved;
+    StrRef path;            // empty for a file's preamble
+};
+static_assert(sizeof(ArchiveFrame) == 40);
+
+struct ArchiveFile {
+    StrRef name;
+    std::uint32_t first_frame;
+    std::uint32_t frame_count;
+    std::uint64_t size;
+};
+
+class CorpusArchive {
+public:
+    static constexpr std::string_view kMagic = "MOBYARCH";
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::uint32_t kStored = 1;  // ArchiveFrame::flags: not compressed
+
+    static std::string default_path(const std::string& corpus_dir);
+
+    // Most common lines across sections, best last, up to `size` bytes.
+    static std::string train_dictionary(const Corpus& corpus, std::size_t size);
+
+    static void build(const Corpus& corpus, const std::string& path, const ArchiveOptions& options = {});
+
+    explicit CorpusArchive(const std::string& path);
+    ~CorpusArchive();
+    CorpusArchive(CorpusArchive&&) noexcept;
+    CorpusArchive& operator=(CorpusArchive&&) noexcept;
+
+    std::uint64_t corpus_hash() const { return reader_.header().corpus_hash; }
+    std::size_t archive_bytes() const { return reader_.size(); }
+    std::uint64_t original_bytes() const { return original_bytes_; }
+    std::string_view dictionary() const { return dictionary_; }
+
+    std::size_t file_count() const { return file_count_; }
+    const ArchiveFile& file(std::size_t i) const { return files_[i]; }
+    std::string_view file_name(std::size_t i) const { return reader_.str(strings_, files_[i].name); }
+
+    std::size_t frame_count() const { return frame_count_; }
+    const ArchiveFrame& frame(std::size_t i) const { return frames_[i]; }
+    std::string_view path(const ArchiveFrame& f) const { return reader_.str(strings_, f.path); }
+
+    // First frame with this header path, or nullptr.
+    const ArchiveFrame* find(std::string_view path) const;
+
+    // Decompresses a frame, separator line included, into `out` (replacing
+    // its contents). Not thread-safe: the inflate state is reused between
+    // calls, so use one archive object per thread.
+    void read(const ArchiveFrame& f, std::string& out) const;
+
+    // Just the section text of a frame.
+    void read_text(const ArchiveFrame& f, std::string& out) const;
+
+private:
+    struct Inflater;
+
+    BlobReader reader_;
+    const ArchiveFile* files_ = nullptr;
+    const ArchiveFrame* frames_ = nullptr;
+    const std::uint32_t* by_path_ = nullptr;  // frame ids with a path, sorted by it
+    std::uint64_t file_count_ = 0;
+    std::uint64_t frame_count_ = 0;
+    std::uint64_t path_count_ = 0;
+    std::uint64_t strings_ = 0;
+    std::uint64_t original_bytes_ = 0;
+    std::string_view dictionary_;
+    mutable std::unique_ptr<Inflater> inflater_;
+};
+
+} // namespace moby
@@ -0,0 +1,120 @@
+// Availability annotations: parsing and the columnar availability matrix.
+//
+// The parser understands API_AVAILABLE / API_UNAVAILABLE / API_DEPRECATED and
+// their *_WITH_REPLACEMENT forms, the older positional macros
+// (NS_AVAILABLE(10_5, 2_0), NS_DEPRECATED(10.11,10.13,9.0,11.0),
+// __OSX_AVAILABLE_STARTING(__MAC_10_5, __IPHONE_2_0), __IOS_AVAILABLE(8.0),
+// __TVOS_PROHIBITED, ...) and framework wrappers that follow either shape
+// (MPS_CLASS_AVAILABLE_STARTING(macos(10.13), ios(11.0)), CG_AVAILABLE_STARTING(10.0, 2.0)).
+//
+// The matrix stores one column per platform and field, indexed by symbol ID
+// in symbols.db, plus bitsets for "unavailable" and "annotated", so a query
+// such as "available on ios 11.0 but unavailable on watchos" is a column scan
+// and a bitset intersection.
+#pragma once
+
+#include "moby/binary.h"
+#include "moby/bitset.h"
+#include "moby/corpus.h"
+#include "moby/symbol_db.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+enum class Platform : std::uint8_t { MacOS, IOS, TvOS, WatchOS, MacCatalyst };
+inline constexpr int kPlatformCount = 5;
+
+const char* platform_name(Platform p);
+// Accepts the spellings used in the headers: macos, macosx, OSX, MAC, ios,
+// iphoneos, IPHONE, tvos, watchos, macCatalyst, uikitformac.
+bool parse_platform(std::string_view name, Platform& p);
+
+// Versions are packed as major << 16 | minor << 8 | patch; 0 means none.
+// API_TO_BE_DEPRECATED is kVersionFuture.
+inline constexpr std::uint32_t kVersionFuture = 0xFFFFFF;
+std::uint32_t parse_version(std::string_view text);
+std::string format_version(std::uint32_t v);
+
+struct PlatformAvailability {
+    std::uint32_t introduced = 0;
+    std::uint32_t deprecated = 0;
+    std::uint32_t obsoleted = 0;
+    bool unavailable = false;
+
+    bool annotated() const { return introduced || deprecated || obsoleted || unavailable; }
+};
+
+struct Availability {
+    PlatformAvailability platforms[kPlatformCount];
+
+    PlatformAvailability& operator[](Platform p) { return platforms[static_cast<int>(p)]; }
+    const PlatformAvailability& operator[](Platform p) const { return platforms[static_cast<int>(p)]; }
+
+    // Fills platforms this declaration says nothing about from its container.
+    void inherit(const Availability& outer);
+};
+
+// Adds every availability macro in `decl` to `out`. Brace groups (enum and
+// struct bodies, inline function bodies) are skipped.
+void parse_availability(std::string_view decl, Availability& out);
+
+// The part of a declaration that carries its own annotations: for an
+// @interface or @protocol, the text through the end of the keyword's line
+// rather than the whole block with its members.
+std::string_view annotation_text(SymbolKind kind, std::string_view decl);
+
+// Appends to `out`, in the order of `symbols`, the effective availability of
+// every symbol extracted from `section`: what each declares, filled in from
+// API_AVAILABLE_BEGIN regions and then from the innermost enclosing class,
+// protocol, enum or struct. Only the kind, offset and length of each symbol
+// are used.
+void section_availability(const Section& section, const std::vector<Symbol>& symbols, std::vector<Availability>& out);
+
+class AvailabilityMatrix {
+public:
+    static constexpr std::string_view kMagic = "MOBYAVAL";
+    static constexpr std::uint32_t kVersion = 1;
+
+    static std::string default_path(const std::string& corpus_dir);
+
+    // Computes effective availability for every symbol in `db`; members
+    // inherit what their class, protocol or enum declares.
+    static void build(const Corpus& corpus, const SymbolDb& db, const std::string& path);
+    // Writes a matrix from availability already indexed by symbol ID.
+    static void write(std::uint64_t corpus_hash, const std::vector<Availability>& avail, const std::string& path);
+
+    explicit AvailabilityMatrix(const std::string& path);
+
+    std::uint64_t corpus_hash() const { return reader_.header().corpus_hash; }
+    std::size_t size() const { return size_; }
+
+    PlatformAvailability get(std::size_t id, Platform p) const;
+
+    // Symbols introduced on `p` at or before `version` and not unavailable there.
+    Bitset available(Platform p, std::uint32_t version) const;
+    // Symbols marked unavailable on `p`.
+    Bitset unavailable(Platform p) const;
+    // Symbols deprecated on `p` at or before `version`.
+    Bitset deprecated(Platform p, std::uint32_t version) const;
+    // Symbols with any annotation for `p`.
+    Bitset annotated(Platform p) const;
+
+private:
+    struct Columns {
+        const std::uint32_t* introduced;
+        const std::uint32_t* deprecated;
+        const std::uint32_t* obsoleted;
+        const std::uint64_t* unavailable;
+        const std::uint64_t* annotated;
+    };
+
+    BlobReader reader_;
+    std::size_t size_ = 0;
+    Columns columns_[kPlatformCount] = {};
+};
+
+} // namespace moby
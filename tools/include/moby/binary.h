@@ -0,0 +1,142 @@
+// Helpers for the position-independent binary files the tools write and mmap.
+//
+// Every file starts with a BlobHeader followed by fixed-width little-endian
+// records. Records refer to each other and to strings by byte offset from the
+// start of the file, never by pointer, so a mapped file is usable as is.
+#pragma once
+
+#include "moby/error.h"
+#include "moby/mapped_file.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace moby {
+
+struct BlobHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t flags;
+    std::uint64_t corpus_hash;  // fingerprint of the corpus the file was built from
+    std::uint64_t size;         // total file size, for truncation checks
+};
+static_assert(sizeof(BlobHeader) == 32);
+
+// A string stored in a blob's string area.
+struct StrRef {
+    std::uint32_t offset;
+    std::uint32_t length;
+};
+
+class BlobWriter {
+public:
+    BlobWriter(std::string_view magic, std::uint32_t version, std::uint64_t corpus_hash);
+
+    std::size_t size() const { return buf_.size(); }
+
+    template <class T>
+    std::size_t put(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        return put_bytes(&value, sizeof value);
+    }
+
+    template <class T>
+    std::size_t put_array(const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        align(alignof(T) < 8 ? 8 : alignof(T));
+        return put_bytes(values.data(), values.size() * sizeof(T));
+    }
+
+    std::size_t put_bytes(const void* data, std::size_t n);
+    void align(std::size_t n);
+
+    template <class T>
+    void patch(std::size_t offset, const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        std::memcpy(&buf_[offset], &value, sizeof value);
+    }
+
+    // Finalizes the header and writes the file atomically via rename.
+    void write_file(const std::string& path);
+    std::string finish();
+
+private:
+    std::string buf_;
+};
+
+// Deduplicating string area builder; offsets are relative to the area start.
+class StringPool {
+public:
+    StrRef add(std::string_view s);
+    const std::string& data() const { return data_; }
+
+private:
+    struct Slot {
+        std::uint64_t hash;
+        StrRef ref;  // length ~0u marks an empty slot
+    };
+    void grow();
+
+    std::string data_;
+    std::vector<Slot> slots_;  // open addressing on the string hash
+    std::size_t used_ = 0;
+};
+
+class BlobReader {
+public:
+    BlobReader() = default;
+    BlobReader(const std::string& path, std::string_view magic, std::uint32_t version);
+
+    const BlobHeader& header() const { return *reinterpret_cast<const BlobHeader*>(map_.data()); }
+    const char* base() const { return map_.data(); }
+    std::size_t size() const { return map_.size(); }
+
+    template <class T>
+    const T* array(std::uint64_t offset, std::uint64_t count) const {
+        check(offset, count * sizeof(T));
+        return reinterpret_cast<const T*>(map_.data() + offset);
+    }
+
+    std::string_view bytes(std::uint64_t offset, std::uint64_t n) const {
+        check(offset, n);
+        return {map_.data() + offset, static_cast<std::size_t>(n)};
+    }
+
+    std::string_view str(std::uint64_t area, StrRef ref) const {
+        return {map_.data() + area + ref.offset, ref.length};
+    }
+
+private:
+    void check(std::uint64_t offset, std::uint64_t n) const {
+        if (offset > map_.size() || n > map_.size() - offset)
+            throw Error(map_.path() + ": record out of bounds");
+    }
+
+    MappedFile map_;
+};
+
+// LEB128 varints, used by the compressed posting and adjacency lists.
+inline void put_varint(std::string& out, std::uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+inline std::uint64_t get_varint(const unsigned char*& p) {
+    std::uint64_t v = 0;
+    int shift = 0;
+    while (*p & 0x80) {
+        v |= static_cast<std::uint64_t>(*p++ & 0x7f) << shift;
+        shift += 7;
+    }
+    v |= static_cast<std::uint64_t>(*p++) << shift;
+    return v;
+}
+
+} // namespace moby
@@ -0,0 +1,85 @@
+// Dense bitset over symbol or header IDs.
+//
+// The word loops are written so the compiler vectorizes them; intersecting
+// two sets over every corpus symbol touches about 8 KB.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace moby {
+
+class Bitset {
+public:
+    Bitset() = default;
+    explicit Bitset(std::size_t size, bool value = false)
+        : size_(size), words_((size + 63) / 64, value ? ~std::uint64_t(0) : 0) {
+        trim();
+    }
+    Bitset(const std::uint64_t* words, std::size_t size) : size_(size), words_(words, words + (size + 63) / 64) {}
+
+    std::size_t size() const { return size_; }
+    std::size_t word_count() const { return words_.size(); }
+    const std::uint64_t* words() const { return words_.data(); }
+    std::uint64_t* words() { return words_.data(); }
+
+    bool test(std::size_t i) const { return words_[i >> 6] >> (i & 63) & 1; }
+    void set(std::size_t i) { words_[i >> 6] |= std::uint64_t(1) << (i & 63); }
+    void reset(std::size_t i) { words_[i >> 6] &= ~(std::uint64_t(1) << (i & 63)); }
+
+    Bitset& operator&=(const Bitset& o) {
+        std::uint64_t* a = words_.data();
+        const std::uint64_t* b = o.words_.data();
+        for (std::size_t i = 0, n = words_.size(); i < n; ++i)
+            a[i] &= b[i];
+        return *this;
+    }
+
+    Bitset& operator|=(const Bitset& o) {
+        std::uint64_t* a = words_.data();
+        const std::uint64_t* b = o.words_.data();
+        for (std::size_t i = 0, n = words_.size(); i < n; ++i)
+            a[i] |= b[i];
+        return *this;
+    }
+
+    // this &= ~o
+    Bitset& subtract(const Bitset& o) {
+        std::uint64_t* a = words_.data();
+        const std::uint64_t* b = o.words_.data();
+        for (std::size_t i = 0, n = words_.size(); i < n; ++i)
+            a[i] &= ~b[i];
+        return *this;
+    }
+
+    std::size_t count() const {
+        std::size_t n = 0;
+        for (std::uint64_t w : words_)
+            n += static_cast<std::size_t>(__builtin_popcountll(w));
+        return n;
+    }
+
+    // Calls fn(i) for every set bit, in increasing order.
+    template <class Fn>
+    void for_each(Fn&& fn) const {
+        for (std::size_t w = 0; w < words_.size(); ++w) {
+            std::uint64_t bits = words_[w];
+            while (bits) {
+                fn(w * 64 + static_cast<std::size_t>(__builtin_ctzll(bits)));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+private:
+    void trim() {
+        if (size_ % 64 && !words_.empty())
+            words_.back() &= (std::uint64_t(1) << (size_ % 64)) - 1;
+    }
+
+    std::size_t size_ = 0;
+    std::vector<std::uint64_t> words_;
+};
+
+} // namespace moby
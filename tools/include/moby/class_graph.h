@@ -0,0 +1,161 @@
+// Objective-C class graph with flattened, inheritance-aware method tables.
+//
+// Every class and protocol the corpus names is a node: classes link to their
+// superclass, and both carry the protocols they adopt. A node's declaring
+// units (its @interface, each category, or its @protocol) list the methods
+// they declare, with @property accessors expanded to their getter and setter
+// selectors and protocol methods marked @optional where they are.
+//
+// Each node also gets its full responder table, flattened at build time: the
+// methods of its own units first, then of the protocols it adopts, then of its
+// superclass, keeping only the nearest declaration of each selector. Selectors
+// are interned once behind a perfect hash, so "does AVAssetWriterInput respond
+// to -appendSampleBuffer:" is one hash lookup and one search of a sorted table,
+// with no walk up the hierarchy.
+#pragma once
+
+#include "moby/binary.h"
+#include "moby/corpus.h"
+#include "moby/symbols.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+struct ClassNode {
+    StrRef name;
+    std::uint32_t super;            // superclass node, or kNone
+    std::uint32_t first_unit;       // declaring units, in corpus order
+    std::uint32_t unit_count;
+    std::uint32_t first_protocol;   // every protocol conformed to, directly or inherited
+    std::uint32_t protocol_count;
+    std::uint32_t first_responder;  // flattened method table
+    std::uint32_t responder_count;
+    std::uint8_t flags;             // ClassNode::kProtocol | kExternal
+    std::uint8_t depth;             // superclass links to the root
+    std::uint16_t reserved;
+    static constexpr std::uint32_t kNone = ~0u;
+    static constexpr std::uint8_t kProtocol = 1;
+    static constexpr std::uint8_t kExternal = 2;  // named but not declared in the corpus
+};
+static_assert(sizeof(ClassNode) == 40);
+
+// One @interface, category or @protocol block.
+struct UnitRecord {
+    StrRef name;                  // "NSArray", "NSArray(NSPredicateSupport)", "NSCopying"
+    std::uint32_t node;
+    std::uint32_t section;
+    std::uint32_t first_method;   // methods declared in this unit, in order
+    std::uint32_t method_count;
+    std::uint32_t first_adopted;  // protocols listed in its <...>, as nodes
+    std::uint32_t adopted_count;
+};
+static_assert(sizeof(UnitRecord) == 32);
+
+struct MethodRecord {
+    std::uint32_t selector;
+    std::uint32_t unit;
+    std::uint64_t offset;         // declaration start within the corpus file
+    std::uint32_t length;
+    SymbolKind kind;              // ClassMethod or InstanceMethod
+    std::uint8_t flags;           // MethodRecord::kOptional | kProperty
+    std::uint16_t reserved;
+    static constexpr std::uint8_t kOptional = 1;  // after @optional in a protocol
+    static constexpr std::uint8_t kProperty = 2;  // accessor of an @property
+};
+static_assert(sizeof(MethodRecord) == 24);
+
+struct SelectorRecord {
+    StrRef name;
+    std::uint32_t first;  // into the declarers list
+    std::uint32_t count;
+};
+
+struct ClassGraphStats {
+    std::size_t classes = 0;
+    std::size_t external = 0;   // superclasses and protocols referenced but not declared
+    std::size_t protocols = 0;
+    std::size_t categories = 0;
+    std::size_t methods = 0;
+    std::size_t accessors = 0;  // of those, synthesized from @property
+    std::size_t selectors = 0;
+    std::size_t responders = 0; // entries across all flattened tables
+};
+
+class ClassGraph {
+public:
+    static constexpr std::string_view kMagic = "MOBYOBJC";
+    static constexpr std::uint32_t kVersion = 1;
+
+    static std::string default_path(const std::string& corpus_dir);
+
+    // `symbols` as produced by extract_corpus_symbols for `corpus`.
+    static ClassGraphStats build(const Corpus& corpus, const std::vector<Symbol>& symbols, const std::string& path,
+                                 unsigned threads = 0);
+
+    explicit ClassGraph(const std::string& path);
+
+    std::uint64_t corpus_hash() const { return reader_.header().corpus_hash; }
+    std::size_t node_count() const { return node_count_; }
+    std::size_t unit_count() const { return unit_count_; }
+    std::size_t method_count() const { return method_count_; }
+    std::size_t selector_count() const { return selector_count_; }
+
+    const ClassNode& node(std::size_t i) const { return nodes_[i]; }
+    const UnitRecord& unit(std::size_t i) const { return units_[i]; }
+    const MethodRecord& method(std::size_t i) const { return methods_[i]; }
+    const SelectorRecord& selector(std::size_t i) const { return selectors_[i]; }
+    std::string_view name(StrRef ref) const { return reader_.str(strings_, ref); }
+    std::uint32_t index_of(const ClassNode& n) const { return static_cast<std::uint32_t>(&n - nodes_); }
+
+    struct Ids {
+        const std::uint32_t* first;
+        std::size_t count;
+        const std::uint32_t* begin() const { return first; }
+        const std::uint32_t* end() const { return first + count; }
+        bool empty() const { return count == 0; }
+    };
+    Ids adopted(const UnitRecord& u) const { return {adopted_ + u.first_adopted, u.adopted_count}; }
+    Ids protocols(const ClassNode& n) const { return {conformances_ + n.first_protocol, n.protocol_count}; }
+    // Method IDs of the flattened table, ordered by selector, instance side first.
+    Ids responders(const ClassNode& n) const { return {responders_ + n.first_responder, n.responder_count}; }
+    // Methods declaring selector `sel`, in unit order.
+    Ids declarers(std::uint32_t sel) const { return {declarers_ + selectors_[sel].first, selectors_[sel].count}; }
+
+    const ClassNode* find_class(std::string_view name) const;
+    const ClassNode* find_protocol(std::string_view name) const;
+    // Selector ID, or ClassNode::kNone.
+    std::uint32_t find_selector(std::string_view name) const;
+
+    // The nearest declaration of `sel` on the instance or class side of `n`,
+    // or null when neither `n`, its protocols nor its superclasses declare it.
+    const MethodRecord* responds(const ClassNode& n, std::uint32_t sel, bool class_side = false) const;
+    bool conforms(const ClassNode& n, const ClassNode& protocol) const;
+
+private:
+    const ClassNode* find_node(std::string_view name, std::uint8_t kind) const;
+
+    BlobReader reader_;
+    const ClassNode* nodes_ = nullptr;
+    const UnitRecord* units_ = nullptr;
+    const MethodRecord* methods_ = nullptr;
+    const SelectorRecord* selectors_ = nullptr;
+    const std::uint32_t* adopted_ = nullptr;
+    const std::uint32_t* conformances_ = nullptr;
+    const std::uint32_t* responders_ = nullptr;
+    const std::uint32_t* responder_keys_ = nullptr;  // parallel to responders_: selector << 1 | class side
+    const std::uint32_t* declarers_ = nullptr;
+    const std::uint32_t* node_displacements_ = nullptr;
+    const std::uint32_t* node_slots_ = nullptr;
+    const std::uint32_t* selector_displacements_ = nullptr;
+    const std::uint32_t* selector_slots_ = nullptr;
+    std::uint64_t node_count_ = 0, unit_count_ = 0, method_count_ = 0, selector_count_ = 0;
+    std::uint64_t node_buckets_ = 0, node_slot_count_ = 0;
+    std::uint64_t selector_buckets_ = 0, selector_slot_count_ = 0;
+    std::uint64_t strings_ = 0;
+};
+
+} // namespace moby
@@ -0,0 +1,122 @@
+// Evaluation of #if / #ifdef / #elif / #else / #endif for a target.
+//
+// The corpus is never preprocessed as a whole, so every other tool sees both
+// arms of each conditional. A TargetConfig (platform, pointer width, language,
+// deployment version) predefines what the compiler and TargetConditionals.h
+// would: TARGET_OS_*, __LP64__, __OBJC__, __cplusplus, __ARM_NEON__,
+// __IPHONE_OS_VERSION_MIN_REQUIRED, ... Evaluating a section's conditionals
+// against it yields the byte ranges a compiler for that target would read.
+//
+// The directive skeleton of a section is found once and shared by every
+// configuration; a TargetView evaluates a section on first access and keeps
+// the result, and ConditionalViews keeps one view per configuration. Object-
+// like #defines earlier in the same section are honoured; definitions from
+// other headers are not, except those the configuration predefines.
+#pragma once
+
+#include "moby/availability.h"
+#include "moby/corpus.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace moby {
+
+enum class Language : std::uint8_t { C, ObjC, Cxx, ObjCxx };
+
+const char* language_name(Language l);
+// c, objc, c++ (or cxx), objc++ (or objcxx).
+bool parse_language(std::string_view name, Language& l);
+
+struct TargetConfig {
+    Platform platform = Platform::IOS;
+    unsigned pointer_bits = 64;          // 64 or 32
+    Language language = Language::ObjC;
+    std::uint32_t min_version = 0;       // packed as by parse_version; 0 means the oldest
+    bool arc = true;                     // __has_feature(objc_arc)
+    std::vector<std::pair<std::string, std::string>> defines;  // extra NAME=VALUE
+
+    // Canonical spelling, e.g. "ios-64-objc-13.0-arc"; equal configurations
+    // have equal names.
+    std::string name() const;
+};
+
+// Section-relative, half-open.
+struct LiveRange {
+    std::uint32_t begin;
+    std::uint32_t end;
+};
+
+struct ConditionalStats {
+    std::size_t conditionals = 0;  // #if / #ifdef / #ifndef evaluated or skipped
+    std::size_t errors = 0;        // unparsable expressions (taken as false) and stray #else/#endif
+};
+
+class ConditionalViews;
+
+class TargetView {
+public:
+    const TargetConfig& config() const { return config_; }
+
+    // Ranges of section `section` live for this target, ascending and
+    // disjoint. Conditional directive lines themselves are never live.
+    const std::vector<LiveRange>& live(std::uint32_t section) const;
+
+    // The section text with every byte outside live() blanked to a space
+    // (newlines are kept), so offsets and line numbers match the original.
+    std::string_view text(std::uint32_t section) const;
+
+    std::size_t live_bytes(std::uint32_t section) const;
+    // Totals over the sections evaluated so far.
+    const ConditionalStats& stats() const { return stats_; }
+
+private:
+    friend class ConditionalViews;
+    TargetView(const ConditionalViews& owner, TargetConfig config);
+
+    struct Evaluated {
+        std::vector<LiveRange> live;
+        std::unique_ptr<std::string> text;
+    };
+    const Evaluated& evaluate(std::uint32_t section) const;
+
+    const ConditionalViews& owner_;
+    TargetConfig config_;
+    std::map<std::string, std::string, std::less<>> macros_;  // predefined for config_
+    mutable std::vector<std::unique_ptr<Evaluated>> sections_;
+    mutable ConditionalStats stats_;
+};
+
+class ConditionalViews {
+public:
+    explicit ConditionalViews(const Corpus& corpus);
+    ~ConditionalViews();
+
+    const Corpus& corpus() const { return corpus_; }
+
+    // The view for `config`, created on first request. Views are not
+    // thread-safe; use one ConditionalViews per thread.
+    const TargetView& view(const TargetConfig& config);
+
+    // #if-family directives in the whole corpus; scans every section.
+    std::size_t conditional_count() const;
+
+private:
+    friend class TargetView;
+    struct Directive;
+    struct Skeleton;
+    const Skeleton& skeleton(std::uint32_t section) const;
+    bool has_include(std::string_view header) const;
+
+    const Corpus& corpus_;
+    mutable std::vector<std::unique_ptr<Skeleton>> skeletons_;
+    mutable std::vector<std::string> headers_;  // sorted include names, built on first __has_include
+    std::map<std::string, std::unique_ptr<TargetView>, std::less<>> views_;
+};
+
+} // namespace moby
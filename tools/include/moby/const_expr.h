@@ -0,0 +1,84 @@
+// Integer constant expressions, evaluated the way C evaluates them.
+//
+// Every value is an intmax_t or a uintmax_t, as in an #if. A literal is
+// unsigned with a u suffix or when it does not fit an intmax_t, and a binary
+// operator converts both operands to unsigned when either is; a shift keeps
+// the type of its left operand. Arithmetic wraps, and a division by zero
+// fails the expression rather than trapping.
+//
+// ConstExpr parses the operators with C precedence over a range of tokens and
+// leaves identifiers to a subclass: the #if evaluator resolves macros and
+// defined(), the enum folder enumerators and casts, struct layout sizeof.
+#pragma once
+
+#include "moby/lexer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+struct ConstValue {
+    std::uint64_t bits = 0;
+    bool is_unsigned = false;
+
+    static ConstValue of(std::int64_t v) { return {static_cast<std::uint64_t>(v), false}; }
+    std::int64_t as_signed() const { return static_cast<std::int64_t>(bits); }
+};
+
+// Value of an integer literal such as 0x1FULL; false when malformed.
+bool parse_integer(std::string_view literal, ConstValue& out);
+
+// Value of a character constant. Multi-character constants pack big-endian:
+// 'wav ' is 0x77617620.
+ConstValue parse_char_constant(std::string_view literal);
+
+// `v` converted to an integer type `width` bits wide: truncated, then sign-
+// or zero-extended. Types narrower than 64 bits promote to intmax_t, which
+// holds all their values; width 0 (an unknown type) keeps `v` as it is.
+ConstValue convert_value(ConstValue v, unsigned width, bool is_signed);
+
+class ConstExpr {
+public:
+    // Evaluates toks[first, last) of `text`.
+    ConstExpr(std::string_view text, const std::vector<Token>& toks, std::size_t first, std::size_t last)
+        : text_(text), toks_(toks), i_(first), last_(last) {}
+    virtual ~ConstExpr() = default;
+
+    // Reads one conditional expression, leaving position() just past it.
+    // False on a syntax error, a division by zero or an identifier the
+    // subclass has no value for.
+    bool evaluate(ConstValue& out);
+    // The same, but the expression must take every token.
+    bool evaluate_all(ConstValue& out) { return evaluate(out) && i_ == last_; }
+    std::size_t position() const { return i_; }
+
+protected:
+    // Value of the identifier at toks[i_]; consumes it along with whatever
+    // it applies to, such as an argument list. False when it has none.
+    virtual bool identifier(ConstValue& out) = 0;
+    // Consumes a "(type)" cast at toks[i_] and reports the type (width 0 when
+    // unknown); false, consuming nothing, when there is none.
+    virtual bool cast(unsigned& width, bool& is_signed);
+
+    std::string_view str(std::size_t i) const { return token_text(text_, toks_[i]); }
+    bool punct(std::string_view op) const { return i_ < last_ && toks_[i_].kind == Tok::Punct && str(i_) == op; }
+    bool accept(std::string_view op);
+    ConstValue conditional();
+
+    std::string_view text_;
+    const std::vector<Token>& toks_;
+    std::size_t i_, last_;
+
+private:
+    ConstValue fail();
+    ConstValue binary(int min_prec);
+    ConstValue unary();
+    ConstValue primary();
+
+    bool ok_ = true;
+};
+
+} // namespace moby
@@ -0,0 +1,68 @@
+// The amalgamated *.framework.h corpus and its `// ==========  <path>` sections.
+#pragma once
+
+#include "moby/mapped_file.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+// Marker that starts every header section; the header path follows it up to
+// the end of the line. It is not always at the start of a line: a header that
+// lacks a trailing newline runs straight into the next marker.
+inline constexpr std::string_view kSeparator = "// ==========  ";
+
+struct SectionSpan {
+    std::uint64_t marker;   // offset of the separator within the file
+    std::uint64_t offset;   // offset of the first content byte
+    std::uint64_t length;   // content bytes, up to the next marker or EOF
+    std::string_view path;  // e.g. "Foundation.framework/Headers/NSPredicate.h"
+};
+
+// Calls `fn` for every section in `text`, in order. Text ahead of the first
+// separator does not belong to any section and is skipped.
+void split_sections(std::string_view text, const std::function<void(const SectionSpan&)>& fn);
+
+struct CorpusFile {
+    std::string name;       // "Foundation.framework.h"
+    std::string framework;  // "Foundation"
+    MappedFile map;
+};
+
+struct Section {
+    std::uint32_t file;     // index into Corpus::files()
+    std::uint64_t marker;
+    std::uint64_t offset;
+    std::uint64_t length;
+    std::string_view path;
+    std::string_view text;
+};
+
+class Corpus {
+public:
+    // Maps every *.framework.h file in `dir`, sorted by file name.
+    explicit Corpus(const std::string& dir);
+
+    const std::string& dir() const { return dir_; }
+    const std::vector<CorpusFile>& files() const { return files_; }
+    const std::vector<Section>& sections() const { return sections_; }
+    std::uint64_t total_bytes() const { return total_bytes_; }
+
+private:
+    std::string dir_;
+    std::vector<CorpusFile> files_;
+    std::vector<Section> sections_;
+    std::uint64_t total_bytes_ = 0;
+};
+
+// Sorted *.framework.h file names in `dir`.
+std::vector<std::string> list_corpus_files(const std::string& dir);
+
+// Corpus directory to use when none is given: $MOBY_CORPUS, else ".".
+std::string default_corpus_dir();
+
+} // namespace moby
@@ -0,0 +1,135 @@
+// Parsed declaration model of the whole corpus, mapped and used in place.
+//
+// Every declaration symbols.db knows about is a DeclRecord, stored in corpus
+// order as a nested-set tree: a class, protocol, category or enum is followed
+// by everything declared inside it, and `end` is one past its last
+// descendant, so members are a contiguous run and the next sibling of any
+// record is at its `end`. Records carry their signature split into parts
+// (selector pieces or C parameters with their types, struct fields, adopted
+// protocols, property attributes) and an index into a deduplicated table of
+// effective availability. All references are indexes or offsets into
+// the file: nothing is rebuilt at load time.
+//
+// The header's corpus hash versions the file against the content it was
+// parsed from. Checking it means hashing the corpus, so the file also keeps
+// the size and modification time of every corpus file; is_current() compares
+// those with a stat() per file and is what tools call at startup.
+#pragma once
+
+#include "moby/availability.h"
+#include "moby/binary.h"
+#include "moby/corpus.h"
+#include "moby/symbols.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace moby {
+
+inline constexpr std::uint32_t kNoDecl = 0xFFFFFFFF;
+
+struct DeclRecord {
+    StrRef name;
+    // Return type of a method or function; type of a property, variable or
+    // typedef; underlying type of an enum; initializer of an enum constant;
+    // superclass of an interface; class of a category.
+    StrRef type;
+    std::uint32_t parent;        // enclosing record, or kNoDecl
+    std::uint32_t end;           // one past the last record inside this one
+    std::uint32_t first_part;
+    std::uint32_t part_count;
+    std::uint32_t availability;  // into the availability table
+    std::uint32_t section;
+    std::uint64_t offset;        // declaration start within the corpus file
+    std::uint32_t length;
+    SymbolKind kind;
+    std::uint8_t flags;          // DeclRecord::kVariadic
+    std::uint16_t reserved;
+    std::uint64_t reserved2;
+
+    static constexpr std::uint8_t kVariadic = 1;
+};
+static_assert(sizeof(DeclRecord) == 64);
+
+// One piece of a signature:
+//   method:      label "initWithString:", type "NSString *", name "aString"
+//   function:    type "const char *", name "path" (name may be empty)
+//   struct:      type "CGFloat", name "x"
+//   interface,
+//   protocol:    label = an adopted protocol
+//   property:    label = an attribute, e.g. "nonatomic" or "getter=isEnabled"
+struct DeclPart {
+    StrRef label;
+    StrRef type;
+    StrRef name;
+};
+static_assert(sizeof(DeclPart) == 24);
+
+struct DeclCacheStats {
+    std::size_t decls = 0;
+    std::size_t parts = 0;
+    std::size_t availabilities = 0;  // distinct
+    std::size_t bytes = 0;
+    double parse_ms = 0;
+};
+
+class DeclCache {
+public:
+    static constexpr std::string_view kMagic = "MOBYDECL";
+    static constexpr std::uint32_t kVersion = 1;
+
+    static std::string default_path(const std::string& corpus_dir);
+
+    static DeclCacheStats build(const Corpus& corpus, const std::string& path, unsigned threads = 0);
+
+    explicit DeclCache(const std::string& path);
+
+    // True when the corpus files in `corpus_dir` have the names, sizes and
+    // modification times they had at build time. Costs a stat() per file.
+    bool is_current(const std::string& corpus_dir) const;
+
+    std::uint64_t corpus_hash() const { return reader_.header().corpus_hash; }
+    std::size_t size() const { return decl_count_; }
+    const DeclRecord& at(std::size_t id) const { return decls_[id]; }
+    std::string_view str(StrRef ref) const { return reader_.str(strings_, ref); }
+    const Availability& availability(const DeclRecord& d) const { return availability_[d.availability]; }
+    std::string_view section_path(const DeclRecord& d) const { return str(section_paths_[d.section]); }
+
+    struct Parts {
+        const DeclPart* first;
+        std::size_t count;
+        const DeclPart* begin() const { return first; }
+        const DeclPart* end() const { return first + count; }
+    };
+    Parts parts(const DeclRecord& d) const { return {parts_ + d.first_part, d.part_count}; }
+
+    // IDs of the records named `name`, in corpus order.
+    struct Ids {
+        const std::uint32_t* first;
+        std::size_t count;
+        const std::uint32_t* begin() const { return first; }
+        const std::uint32_t* end() const { return first + count; }
+    };
+    Ids find(std::string_view name) const;
+
+    // The declaration as an Objective-C or C signature, rebuilt from its
+    // parts: "- (instancetype)initWithString:(NSString *)aString".
+    std::string signature(const DeclRecord& d) const;
+
+private:
+    struct FileStamp;
+
+    BlobReader reader_;
+    const DeclRecord* decls_ = nullptr;
+    const DeclPart* parts_ = nullptr;
+    const Availability* availability_ = nullptr;
+    const std::uint32_t* by_name_ = nullptr;
+    const StrRef* section_paths_ = nullptr;
+    const FileStamp* stamps_ = nullptr;
+    std::uint64_t decl_count_ = 0;
+    std::uint64_t stamp_count_ = 0;
+    std::uint64_t strings_ = 0;
+};
+
+} // namespace moby
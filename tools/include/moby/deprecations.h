@@ -0,0 +1,148 @@
+// Deprecated declarations, their replacements, and a scanner that finds uses
+// of them in client code.
+//
+// A declaration is deprecated when its own annotations say so: API_DEPRECATED,
+// API_DEPRECATED_WITH_REPLACEMENT, NS_DEPRECATED and the per-platform forms,
+// DEPRECATED_ATTRIBUTE, __deprecated_msg, or __attribute__((deprecated)). The
+// replacement comes from, in order of trust:
+//
+//   - the first argument of a *_WITH_REPLACEMENT macro;
+//   - the message: "Use X instead", "replaced by X", "renamed to X", with
+//     "Class's member" written as Class.member;
+//   - for a method with neither, the shortest member of the same class that
+//     extends its name: makeVerticesUnique -> makeVerticesUniqueAndReturnError:.
+//
+// Uses are found in one pass over the client text. Every deprecated name is a
+// pattern: the identifier, or for selectors with arguments the first piece
+// with its colon (what a message send spells), plus the setter of a property.
+// A unary member name matches only after a receiver, so that a deprecated
+// `size` property does not flag every `size` argument. A member spelling that
+// other declarations use without deprecating it (init, delegate, setDelegate:)
+// matches only when the message's receiver names a class that deprecates it,
+// as in `[[NSFoo alloc] init]`; `[view delegate]` says nothing of its class.
+// The patterns form an Aho-Corasick automaton whose matches must start at an
+// identifier boundary, so every failure transition leads to a dead state until
+// the next boundary: the automaton is the pattern trie, stored as a double
+// array (base/check), and costs one table lookup per input byte.
+#pragma once
+
+#include "moby/availability.h"
+#include "moby/binary.h"
+#include "moby/corpus.h"
+#include "moby/symbol_db.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+enum class ReplacementSource : std::uint8_t { None, Macro, Message, Inferred };
+
+struct DeprecationRecord {
+    StrRef name;
+    StrRef parent;       // class, protocol or enum of a member, else empty
+    StrRef replacement;  // empty when none is known
+    StrRef message;      // the deprecation message, if any
+    std::uint32_t symbol;
+    SymbolKind kind;
+    ReplacementSource source;
+    std::uint16_t reserved;
+    std::uint32_t deprecated[kPlatformCount];  // version per platform, 0 when not given
+    std::uint32_t reserved2;
+};
+static_assert(sizeof(DeprecationRecord) == 64);
+
+// One scanner pattern and the records it stands for.
+struct DeprecationPattern {
+    enum : std::uint32_t {
+        // Unary selector or property only: matches after a receiver (". x",
+        // "[obj x"), not where an argument or a local of that name would be.
+        kMember = 1,
+        // Also declared, not deprecated, by some member: matches only when the
+        // receiver is a class one of the records belongs to ("[NSFoo x",
+        // "[[NSFoo alloc] x").
+        kShared = 2,
+    };
+    StrRef text;
+    std::uint32_t first;  // into the pattern -> record list
+    std::uint32_t count;
+    std::uint32_t flags;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(DeprecationPattern) == 24);
+
+struct DeprecationHit {
+    std::uint64_t offset;  // start of the matched identifier
+    std::uint32_t pattern;
+    std::uint32_t length;
+    std::uint64_t receiver = 0;          // class named by the receiver, for kShared patterns
+    std::uint32_t receiver_length = 0;   // 0 when the hit stands for all the pattern's records
+};
+
+struct DeprecationStats {
+    std::size_t deprecated = 0;
+    std::size_t by_macro = 0;
+    std::size_t by_message = 0;
+    std::size_t inferred = 0;
+    std::size_t patterns = 0;
+    std::size_t shared = 0;  // of those, kShared
+    std::size_t states = 0;  // trie nodes
+    std::size_t slots = 0;   // double-array size
+};
+
+const char* replacement_source_name(ReplacementSource s);
+
+class DeprecationTable {
+public:
+    static constexpr std::string_view kMagic = "MOBYDEPR";
+    static constexpr std::uint32_t kVersion = 2;
+
+    static std::string default_path(const std::string& corpus_dir);
+
+    static DeprecationStats build(const Corpus& corpus, const SymbolDb& db, const std::string& path);
+
+    explicit DeprecationTable(const std::string& path);
+
+    std::uint64_t corpus_hash() const { return reader_.header().corpus_hash; }
+    std::size_t size() const { return record_count_; }
+    std::size_t pattern_count() const { return pattern_count_; }
+    std::size_t slot_count() const { return slot_count_; }
+    const DeprecationRecord& record(std::size_t i) const { return records_[i]; }
+    const DeprecationPattern& pattern(std::size_t i) const { return patterns_[i]; }
+    std::string_view str(StrRef ref) const { return reader_.str(strings_, ref); }
+
+    // Records of pattern `p`.
+    struct Records {
+        const std::uint32_t* first;
+        std::size_t count;
+        const std::uint32_t* begin() const { return first; }
+        const std::uint32_t* end() const { return first + count; }
+    };
+    Records records(std::size_t p) const { return {pattern_records_ + patterns_[p].first, patterns_[p].count}; }
+
+    // Records named `name`, for lookups by full name or selector.
+    std::vector<std::uint32_t> find(std::string_view name) const;
+
+    // Whether a record of pattern `p` is a member of `parent`.
+    bool declares(std::size_t p, std::string_view parent) const;
+
+    // Appends every use of a deprecated name in `text`, in order.
+    void scan(std::string_view text, std::vector<DeprecationHit>& out) const;
+
+private:
+    BlobReader reader_;
+    const DeprecationRecord* records_ = nullptr;
+    const DeprecationPattern* patterns_ = nullptr;
+    const std::uint32_t* pattern_records_ = nullptr;
+    const std::int32_t* base_ = nullptr;
+    const std::int32_t* check_ = nullptr;
+    const std::uint32_t* terminal_ = nullptr;  // pattern + 1 per slot, 0 for none
+    std::uint64_t record_count_ = 0;
+    std::uint64_t pattern_count_ = 0;
+    std::uint64_t slot_count_ = 0;
+    std::uint64_t strings_ = 0;
+};
+
+} // namespace moby
@@ -0,0 +1,136 @@
+// HeaderDoc comments of the corpus, attached to the symbols they describe.
+//
+// A `/*!` (or `/**`) block documents the declaration that follows it, as
+// HeaderDoc and clang read it: only whitespace, plain comments, preprocessor
+// conditionals and attribute macros may come between them. When several
+// symbols start at that declaration (typedef struct {...} CGPoint), they share
+// the comment. The @constant, @field and @var entries of a documented enum or
+// struct also become the documentation of the members they name, so hovering
+// an enum constant shows its line without reading the enum's comment.
+//
+// Comments are parsed once at build time into tags and stored in corpus
+// order, deflated in blocks of about 1 KB with a dictionary of phrases common
+// across the corpus. An entry table sorted by symbol ID (as in symbols.db)
+// gives each documented symbol its block and the record's place in it, so a
+// lookup inflates one small block and nothing else.
+#pragma once
+
+#include "moby/binary.h"
+#include "moby/corpus.h"
+#include "moby/symbol_db.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+struct DocTag {
+    std::string tag;   // "abstract", "param", ...; text ahead of any tag is "discussion"
+    std::string name;  // of the parameter, constant or declaration the tag is about
+    std::string text;  // lines joined; blank lines, list items and code keep their breaks
+};
+
+struct DocComment {
+    std::vector<DocTag> tags;
+
+    // First tag called `tag`, or nullptr.
+    const DocTag* find(std::string_view tag) const;
+};
+
+// Parses the text of a `/*! ... */` block, delimiters included. Synonyms are
+// folded: @brief is "abstract", @return(s) "result", @const "constant",
+// @seealso "see".
+void parse_doc_comment(std::string_view comment, DocComment& out);
+
+// Calls `fn(begin, end)` for every doc comment in `text`, as offsets into it,
+// skipping string and character literals and ordinary comments.
+void for_each_doc_comment(std::string_view text, const std::function<void(std::size_t, std::size_t)>& fn);
+
+struct DocStoreOptions {
+    std::size_t block_size = 1024;         // uncompressed bytes per block, about
+    int level = 9;                          // zlib compression level
+    std::size_t dictionary_size = 16 << 10; // 0 disables the dictionary
+    unsigned threads = 0;
+};
+
+struct DocEntry {
+    std::uint32_t symbol;
+    std::uint32_t block;
+    std::uint32_t offset;  // of the record within the inflated block
+    std::uint32_t length;
+};
+static_assert(sizeof(DocEntry) == 16);
+
+struct DocBlock {
+    std::uint64_t offset;  // of the stored bytes within the file
+    std::uint32_t stored;  // compressed size; equal to `length` when kept raw
+    std::uint32_t length;
+};
+static_assert(sizeof(DocBlock) == 16);
+
+struct DocStoreStats {
+    std::size_t comments = 0;    // doc comments in the corpus
+    std::size_t attached = 0;    // of those, followed by a declaration
+    std::size_t documented = 0;  // symbols with documentation
+    std::size_t inherited = 0;   // of those, documented by their container's tags
+    std::size_t blocks = 0;
+    std::size_t raw_bytes = 0;   // records, uncompressed
+    std::size_t stored_bytes = 0;
+    std::size_t bytes = 0;       // the whole file
+};
+
+class DocStore {
+public:
+    static constexpr std::string_view kMagic = "MOBYDOCS";
+    static constexpr std::uint32_t kVersion = 1;
+
+    static std::string default_path(const std::string& corpus_dir);
+
+    // Symbol IDs in the store are those of `symbols`, which must have been
+    // built from `corpus`.
+    static DocStoreStats build(const Corpus& corpus, const SymbolDb& symbols, const std::string& path,
+                               const DocStoreOptions& options = {});
+
+    explicit DocStore(const std::string& path);
+    ~DocStore();
+    DocStore(DocStore&&) noexcept;
+    DocStore& operator=(DocStore&&) noexcept;
+
+    std::uint64_t corpus_hash() const { return reader_.header().corpus_hash; }
+    std::size_t symbol_count() const { return symbol_count_; }
+    std::size_t size() const { return entry_count_; }
+    const DocEntry& entry(std::size_t i) const { return entries_[i]; }
+    std::size_t block_count() const { return block_count_; }
+    const DocBlock& block(std::size_t i) const { return blocks_[i]; }
+
+    // Entry for `symbol`, or nullptr when it has no documentation.
+    const DocEntry* find(std::uint32_t symbol) const;
+
+    // Documentation of `symbol` into `out`; false when it has none. Inflates
+    // the entry's block up to the end of its record, or continues from where
+    // the last read of the same block stopped. Not thread-safe: use one store
+    // object per thread.
+    bool read(std::uint32_t symbol, DocComment& out) const;
+    void read(const DocEntry& e, DocComment& out) const;
+
+private:
+    struct Inflater;
+
+    BlobReader reader_;
+    const DocEntry* entries_ = nullptr;
+    const DocBlock* blocks_ = nullptr;
+    std::uint64_t symbol_count_ = 0;
+    std::uint64_t entry_count_ = 0;
+    std::uint64_t block_count_ = 0;
+    std::string_view dictionary_;
+    mutable std::unique_ptr<Inflater> inflater_;
+    mutable std::string block_text_;
+    mutable std::uint32_t block_id_ = ~0u;  // block the inflate state is in
+    mutable std::uint32_t block_ready_ = 0;  // bytes of it in block_text_
+};
+
+} // namespace moby
@@ -0,0 +1,137 @@
+// Constant-folded enum and option-set values.
+//
+// Every enumerator's initializer is evaluated as a C integer constant
+// expression: literals (including four-character codes such as 'wav '),
+// shifts and bitwise operators, casts, references to enumerators of the same
+// or any other enum, and the usual limits (NSIntegerMax, UINT32_MAX, ...).
+// Values are normalized to the enum's underlying type: truncated to its
+// width, then sign- or zero-extended to 64 bits. NSInteger, long, size_t and
+// their kin are as wide as the target's pointers.
+//
+// The table is folded for one target configuration (64-bit iOS by default),
+// read through its conditional view: an enumerator in an #if arm the target
+// does not compile is kept for name lookups but flagged inactive, and never
+// stands for its name in other initializers, in reverse lookups or in
+// decoding. `#define`s count only from live arms.
+//
+// The file answers both directions through perfect hashes: an enumerator name
+// to its records, and a value to every enumerator that has it. Option sets
+// (NS_OPTIONS, CF_OPTIONS, and plain enums built from shifted bits) can also
+// be decomposed into the flags a value is made of.
+#pragma once
+
+#include "moby/binary.h"
+#include "moby/conditionals.h"
+#include "moby/corpus.h"
+#include "moby/symbols.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+struct EnumRecord {
+    StrRef name;            // empty for an anonymous enum
+    StrRef type;            // underlying type as written, e.g. "NSUInteger"
+    std::uint32_t first;    // first constant
+    std::uint32_t count;
+    std::uint32_t section;
+    std::uint8_t width;     // bits of the underlying type, 0 when unknown
+    std::uint8_t is_signed;
+    std::uint8_t flags;     // EnumRecord::kOptions
+    std::uint8_t reserved;
+    static constexpr std::uint8_t kOptions = 1;
+};
+static_assert(sizeof(EnumRecord) == 32);
+
+struct ConstantRecord {
+    StrRef name;
+    std::uint32_t enum_index;
+    std::uint32_t flags;    // ConstantRecord::kResolved | kImplicit | kInactive
+    std::int64_t value;     // meaningful only when resolved
+    static constexpr std::uint32_t kResolved = 1;
+    static constexpr std::uint32_t kImplicit = 2;  // no initializer; previous + 1
+    static constexpr std::uint32_t kInactive = 4;  // in an #if arm the target does not compile
+};
+static_assert(sizeof(ConstantRecord) == 24);
+
+struct EnumBuildStats {
+    std::size_t enums = 0;
+    std::size_t options = 0;
+    std::size_t constants = 0;
+    std::size_t resolved = 0;
+    std::size_t inactive = 0;
+    std::size_t passes = 0;  // evaluation rounds until no forward reference was left to settle
+};
+
+class EnumTable {
+public:
+    static constexpr std::string_view kMagic = "MOBYENUM";
+    static constexpr std::uint32_t kVersion = 2;
+
+    static std::string default_path(const std::string& corpus_dir);
+
+    // `symbols` as produced by extract_corpus_symbols for `corpus`.
+    static EnumBuildStats build(const Corpus& corpus, const std::vector<Symbol>& symbols, const std::string& path,
+                                const TargetConfig& target = {});
+
+    explicit EnumTable(const std::string& path);
+
+    std::uint64_t corpus_hash() const { return reader_.header().corpus_hash; }
+    std::size_t enum_count() const { return enum_count_; }
+    std::size_t constant_count() const { return constant_count_; }
+    // TargetConfig::name() of the configuration folded for.
+    std::string_view target() const { return name(target_); }
+
+    const EnumRecord& enum_at(std::size_t i) const { return enums_[i]; }
+    const ConstantRecord& constant(std::size_t i) const { return constants_[i]; }
+    std::string_view name(StrRef ref) const { return reader_.str(strings_, ref); }
+    const EnumRecord& enum_of(const ConstantRecord& c) const { return enums_[c.enum_index]; }
+
+    // Constant IDs, ascending.
+    struct Ids {
+        const std::uint32_t* first;
+        std::size_t count;
+        const std::uint32_t* begin() const { return first; }
+        const std::uint32_t* end() const { return first + count; }
+        bool empty() const { return count == 0; }
+    };
+    // Enumerators named `name` (more than one when both arms of an #if declare it).
+    Ids find(std::string_view name) const;
+    // Resolved active enumerators whose value is `value`.
+    Ids with_value(std::int64_t value) const;
+    // Named enum, or null.
+    const EnumRecord* find_enum(std::string_view name) const;
+
+    // Names for `value` as a member of `e`: the enumerators equal to it, or
+    // for an option set the flags it is made of, largest first, with any bits
+    // no flag accounts for in hex ("A | B | 0x40").
+    std::string decode(const EnumRecord& e, std::int64_t value) const;
+
+private:
+    struct Run;
+
+    BlobReader reader_;
+    const EnumRecord* enums_ = nullptr;
+    const ConstantRecord* constants_ = nullptr;
+    const std::uint32_t* enums_by_name_ = nullptr;
+    const std::uint32_t* by_name_ = nullptr;
+    const std::uint32_t* by_value_ = nullptr;
+    const Run* name_runs_ = nullptr;
+    const Run* value_runs_ = nullptr;
+    const std::uint32_t* name_displacements_ = nullptr;
+    const std::uint32_t* name_slots_ = nullptr;
+    const std::uint32_t* value_displacements_ = nullptr;
+    const std::uint32_t* value_slots_ = nullptr;
+    std::uint64_t enum_count_ = 0;
+    std::uint64_t named_enum_count_ = 0;
+    std::uint64_t constant_count_ = 0;
+    std::uint64_t name_buckets_ = 0, name_slot_count_ = 0;
+    std::uint64_t value_buckets_ = 0, value_slot_count_ = 0;
+    std::uint64_t strings_ = 0;
+    StrRef target_{};
+};
+
+} // namespace moby
@@ -0,0 +1,14 @@
+// Exception type thrown by every moby component.
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+namespace moby {
+
+class Error : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+} // namespace moby
@@ -0,0 +1,27 @@
+// Non-cryptographic hashing used for section fingerprints and hash tables.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace moby {
+
+// XXH64 of `size` bytes at `data`.
+std::uint64_t hash64(const void* data, std::size_t size, std::uint64_t seed = 0);
+
+inline std::uint64_t hash64(std::string_view s, std::uint64_t seed = 0) {
+    return hash64(s.data(), s.size(), seed);
+}
+
+// Cheap 64-bit finalizer for integer keys.
+inline std::uint64_t mix64(std::uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+} // namespace moby
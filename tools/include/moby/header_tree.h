@@ -0,0 +1,43 @@
+// Rebuilds the original Headers/ directory tree from the amalgamated files:
+// Foundation.framework/Headers/NSPredicate.h and so on, one file per section.
+//
+// The fast path never copies header text through user space. Every directory
+// the sections need is created up front, parents first, with mkdirat against
+// an already open parent; each file is then created with openat against its
+// directory and filled with copy_file_range straight from the corpus file,
+// which lets filesystems that support it (btrfs, XFS, NFS 4.2) share or
+// offload the extents. Frameworks are extracted in parallel, largest first.
+// Where copy_file_range is unavailable or refused (older kernels, different
+// filesystems), the section is written from the mapped corpus with pwrite.
+//
+// Reflinks proper (FICLONERANGE) need block-aligned offsets in the source,
+// which sections almost never have, so they are left to copy_file_range.
+#pragma once
+
+#include "moby/corpus.h"
+
+#include <cstdint>
+#include <string>
+
+namespace moby {
+
+struct HeaderTreeOptions {
+    unsigned threads = 0;   // 0: default_thread_count()
+    std::string framework;  // only sections under <framework>.framework/, when set
+    bool naive = false;     // one thread, create_directories and ofstream per file
+};
+
+struct HeaderTreeStats {
+    std::size_t files = 0;
+    std::size_t directories = 0;  // created by the fast path, 0 for naive
+    std::uint64_t bytes = 0;
+    std::size_t copied = 0;       // files filled by copy_file_range
+    std::size_t written = 0;      // files filled by write
+};
+
+// Writes every section of `corpus` (or of one framework) under `dest`,
+// replacing files that exist. Throws Error on the first failure.
+HeaderTreeStats extract_header_tree(const Corpus& corpus, const std::string& dest,
+                                    const HeaderTreeOptions& options = {});
+
+} // namespace moby
@@ -0,0 +1,118 @@
+// Header-level #import / #include dependency graph with a stored closure.
+//
+// Every corpus section is a node, named the way it is imported
+// ("Foundation/NSArray.h"); headers referenced but not in the corpus
+// (<stdint.h>, <os/object.h>) become external nodes. Node IDs of corpus
+// headers equal their section ordinals. Next to the direct edges the file
+// holds one bitset row per node for everything it transitively includes and
+// one for everything that transitively includes it, so "what does UIKit.h
+// pull in" and "who depends on CMSampleBuffer.h" are a row read, and "does A
+// reach B" is a single bit test.
+//
+// Both arms of conditional blocks count, as in the rest of the tools.
+#pragma once
+
+#include "moby/binary.h"
+#include "moby/bitset.h"
+#include "moby/corpus.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+inline constexpr std::uint32_t kExternalHeader = 0xFFFFFFFF;
+
+struct HeaderNode {
+    StrRef name;            // import spelling, "Framework/Header.h" for corpus headers
+    StrRef path;            // section path; empty for external headers
+    std::uint32_t section;  // section ordinal, or kExternalHeader
+    std::uint32_t scc;      // strongly connected component, numbered dependencies first
+};
+
+// "A.framework/Headers/B.h" and "X.framework/Frameworks/A.framework/Headers/B.h"
+// are both imported as "A/B.h".
+std::string include_name(std::string_view section_path);
+
+struct IncludeDirective {
+    std::string target;  // text between the <> or quotes
+    bool quoted;
+};
+
+// Appends the #import and #include directives of one section, in order.
+void section_includes(std::string_view text, std::vector<IncludeDirective>& out);
+
+class IncludeGraph {
+public:
+    static constexpr std::string_view kMagic = "MOBYINCL";
+    static constexpr std::uint32_t kVersion = 1;
+
+    static std::string default_path(const std::string& corpus_dir);
+
+    static void build(const Corpus& corpus, const std::string& path);
+    // Same, from the directives of every section already extracted.
+    static void build(const Corpus& corpus, const std::vector<std::vector<IncludeDirective>>& includes,
+                      const std::string& path);
+
+    explicit IncludeGraph(const std::string& path);
+
+    std::uint64_t corpus_hash() const { return reader_.header().corpus_hash; }
+    std::size_t size() const { return node_count_; }
+    const HeaderNode& at(std::uint32_t id) const { return nodes_[id]; }
+    std::string_view name(std::uint32_t id) const { return reader_.str(strings_, nodes_[id].name); }
+    std::string_view path(std::uint32_t id) const { return reader_.str(strings_, nodes_[id].path); }
+    bool external(std::uint32_t id) const { return nodes_[id].section == kExternalHeader; }
+
+    // Accepts an import spelling or a section path; false when unknown.
+    bool find(std::string_view name, std::uint32_t& id) const;
+
+    struct Range {
+        const std::uint32_t* first;
+        std::size_t count;
+        const std::uint32_t* begin() const { return first; }
+        const std::uint32_t* end() const { return first + count; }
+        std::size_t size() const { return count; }
+    };
+    // Direct edges.
+    Range includes(std::uint32_t id) const;
+    Range included_by(std::uint32_t id) const;
+
+    // Transitive closure rows; a node is in its own row only when it is on a cycle.
+    Bitset dependencies(std::uint32_t id) const { return {row(closure_, id), node_count_}; }
+    Bitset dependents(std::uint32_t id) const { return {row(reverse_, id), node_count_}; }
+    bool depends_on(std::uint32_t from, std::uint32_t to) const { return row(closure_, from)[to >> 6] >> (to & 63) & 1; }
+    std::size_t dependency_count(std::uint32_t id) const { return row_count(row(closure_, id)); }
+    std::size_t dependent_count(std::uint32_t id) const { return row_count(row(reverse_, id)); }
+
+    // Every node, each after all the headers it includes; members of a
+    // cycle are adjacent.
+    Range topological_order() const { return {order_, node_count_}; }
+
+    // Strongly connected components of more than one header, in topological order.
+    std::vector<std::vector<std::uint32_t>> cycles() const;
+
+private:
+    const std::uint64_t* row(const std::uint64_t* matrix, std::uint32_t id) const { return matrix + id * row_words_; }
+    std::size_t row_count(const std::uint64_t* words) const;
+
+    BlobReader reader_;
+    const HeaderNode* nodes_ = nullptr;
+    const std::uint32_t* out_offsets_ = nullptr;
+    const std::uint32_t* out_edges_ = nullptr;
+    const std::uint32_t* in_offsets_ = nullptr;
+    const std::uint32_t* in_edges_ = nullptr;
+    const std::uint32_t* order_ = nullptr;
+    const std::uint64_t* closure_ = nullptr;
+    const std::uint64_t* reverse_ = nullptr;
+    const std::uint32_t* displacements_ = nullptr;
+    const std::uint32_t* slots_ = nullptr;
+    std::uint64_t node_count_ = 0;
+    std::uint64_t row_words_ = 0;
+    std::uint64_t bucket_count_ = 0;
+    std::uint64_t slot_count_ = 0;
+    std::uint64_t strings_ = 0;
+};
+
+} // namespace moby
@@ -0,0 +1,37 @@
+// Minimal JSON for the language server: a tree parser for incoming messages
+// and a writer for the values echoed back (request IDs). Responses are
+// otherwise assembled directly as text.
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace moby {
+
+struct Json {
+    enum class Type : std::uint8_t { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<Json> items;                            // Array
+    std::vector<std::pair<std::string, Json>> members;  // Object, in document order
+
+    bool is_null() const { return type == Type::Null; }
+    // The member named `key`, or a null value when absent or not an object.
+    const Json& operator[](std::string_view key) const;
+};
+
+// Parses one JSON text; throws Error on malformed input.
+Json parse_json(std::string_view text);
+
+// Appends `s` as a quoted JSON string.
+void append_json_string(std::string& out, std::string_view s);
+// Appends `v` as JSON text.
+void append_json(std::string& out, const Json& v);
+
+} // namespace moby
@@ -0,0 +1,63 @@
+// Tokenizer for the C / Objective-C subset found in the SDK headers.
+//
+// Preprocessor directives come out as one token spanning the whole logical
+// line (continuations included); comments are dropped unless requested.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+enum class Tok : std::uint8_t {
+    Ident,      // identifiers and keywords, including "@interface" etc.
+    Number,
+    String,     // "..." and @"..."
+    Char,       // '...', including four-character codes
+    Punct,      // one operator or punctuator, e.g. "(" or "<<"
+    Directive,  // "#..." through the end of the logical line
+    Comment,
+};
+
+struct Token {
+    Tok kind;
+    std::uint32_t offset;  // relative to the tokenized text
+    std::uint32_t length;
+};
+
+std::vector<Token> tokenize(std::string_view text, bool keep_comments = false);
+
+inline std::string_view token_text(std::string_view text, const Token& t) {
+    return text.substr(t.offset, t.length);
+}
+
+inline bool is_punct(std::string_view text, const Token& t, char c) {
+    return t.kind == Tok::Punct && t.length == 1 && text[t.offset] == c;
+}
+
+// Directive name without '#' and whitespace, e.g. "import" or "ifdef".
+std::string_view directive_name(std::string_view directive);
+
+// ASCII identifier characters; the headers use no others.
+inline bool is_ident_start(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+inline bool is_ident_char(char c) { return is_ident_start(c) || (c >= '0' && c <= '9'); }
+
+inline bool ends_with(std::string_view s, std::string_view suffix) {
+    return s.size() >= suffix.size() && s.substr(s.size() - suffix.size()) == suffix;
+}
+
+// Index just past the (), [] or {} group opening at toks[i], or `last` when
+// it is not closed before toks[last].
+std::size_t skip_group(std::string_view text, const std::vector<Token>& toks, std::size_t i, std::size_t last);
+
+// Index just past the <...> group opening at toks[i]; ">>" closes two levels.
+// Stops at a ';', '{' or Objective-C keyword (the group was a comparison or
+// unterminated) and returns its index.
+std::size_t skip_angles(std::string_view text, const std::vector<Token>& toks, std::size_t i, std::size_t last);
+
+// Index of the first token at or after text offset `offset`, or toks.size().
+std::size_t token_at(const std::vector<Token>& toks, std::uint64_t offset);
+
+} // namespace moby
@@ -0,0 +1,88 @@
+// Language server over the corpus: hover, go-to-definition and workspace
+// symbols for editors on machines without the SDK.
+//
+// The server answers from the mapped symbols.db and, when it is current, the
+// availability matrix; declaration text is read straight from the mapped
+// corpus files. Startup maps the files and indexes and counts the corpus
+// lines once, so that no request pays for it. Positions are
+// byte columns, which equal UTF-16 columns on the ASCII headers.
+//
+// Definitions point into the corpus files themselves (file://<corpus>/X.h
+// with the line of the declaration), so an editor opens the amalgamated
+// header at the right place. Hover shows the declaration as written, with its
+// API_AVAILABLE line, the effective availability from the matrix and, when
+// docs.store is current, the HeaderDoc comment (one small block inflated).
+#pragma once
+
+#include "moby/corpus.h"
+#include "moby/json.h"
+#include "moby/symbol_db.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace moby {
+
+class AvailabilityMatrix;
+class DocStore;
+
+class LspServer {
+public:
+    // Maps the corpus in `corpus_dir` and its .moby/symbols.db, which must be
+    // current; the availability matrix and the doc store are used when
+    // present and current.
+    explicit LspServer(const std::string& corpus_dir);
+    ~LspServer();
+
+    // Handles one JSON-RPC message and returns the response body, or an empty
+    // string for notifications.
+    std::string handle(std::string_view message);
+
+    bool exit_requested() const { return exit_; }
+    // Exit status the client's `exit` asks for: 0 after `shutdown`, else 1.
+    int exit_status() const { return shutdown_ ? 0 : 1; }
+
+    // file:// URI of corpus file `file`.
+    std::string file_uri(std::uint32_t file) const;
+    const Corpus& corpus() const { return corpus_; }
+    const SymbolDb& symbols() const { return db_; }
+
+private:
+    // Text of a document and the start offset of each of its lines.
+    struct Text {
+        std::string_view text;
+        const std::vector<std::uint64_t>* lines = nullptr;
+    };
+    struct Document {
+        std::string text;
+        std::vector<std::uint64_t> lines;
+    };
+
+    std::string result(const Json& id, std::string_view value) const;
+    std::string error(const Json& id, int code, std::string_view message) const;
+
+    // Opened documents by URI; corpus files are always available, from the map.
+    bool text_of(const std::string& uri, Text& out);
+    std::vector<const SymbolRecord*> resolve(const Json& params);
+
+    std::string hover(const Json& params);
+    std::string definition(const Json& params);
+    std::string workspace_symbol(const Json& params);
+    void append_location(std::string& out, const SymbolRecord& r);
+
+    Corpus corpus_;
+    SymbolDb db_;
+    std::unique_ptr<AvailabilityMatrix> availability_;
+    std::unique_ptr<DocStore> docs_;
+    std::string root_;                                      // absolute corpus directory
+    std::unordered_map<std::string, std::uint32_t> paths_;  // absolute path -> corpus file
+    std::vector<std::vector<std::uint64_t>> file_lines_;    // line starts of each corpus file
+    std::unordered_map<std::string, Document> documents_;
+    bool shutdown_ = false;
+    bool exit_ = false;
+};
+
+} // namespace moby
@@ -0,0 +1,99 @@
+// Nullability: assume-nonnull regions and per-declaration effective
+// nullability.
+//
+// Regions are the spans between NS_ASSUME_NONNULL_BEGIN and _END and their
+// framework spellings (CF_, CM_, NW_, SEC_), `#pragma clang assume_nonnull`
+// and `_Pragma("clang assume_nonnull begin")`. They are stored sorted per
+// corpus file, so the context of any byte offset is one binary search.
+//
+// For every method, property, function and variable in symbols.db the index
+// holds one slot per type position, the return (or property, or variable) type
+// first and then each parameter, with the nullability a compiler would give
+// it. An explicit annotation (nullable, _Nonnull, __null_unspecified,
+// null_resettable, ...) wins, as does a macro the corpus #defines as one
+// (CM_NULLABLE). Otherwise, inside a region, a single-level pointer is
+// nonnull and `NSError **` or `CFErrorRef *` is nullable; anything else is
+// unspecified. Slots are indexed by symbol ID, like the availability matrix.
+#pragma once
+
+#include "moby/binary.h"
+#include "moby/corpus.h"
+#include "moby/symbol_db.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace moby {
+
+enum class Nullability : std::uint8_t { None, Unspecified, Nonnull, Nullable, NullResettable };
+
+// "-" for a position that is not a pointer, else "unspecified", "nonnull", ...
+const char* nullability_name(Nullability n);
+
+// One pointer position of a declaration.
+struct NullabilitySlot {
+    std::uint8_t bits;  // Nullability | NullabilitySlot::kInferred
+    static constexpr std::uint8_t kInferred = 0x80;  // not written: from a region, the NSError ** rule or the default
+
+    Nullability value() const { return static_cast<Nullability>(bits & 0x7f); }
+    bool inferred() const { return bits & kInferred; }
+};
+
+struct NullabilityRegion {
+    std::uint64_t begin;  // the BEGIN marker, within the corpus file
+    std::uint64_t end;    // the END marker, or the end of its section when unclosed
+    std::uint32_t file;
+    std::uint32_t section;
+};
+
+struct NullabilityStats {
+    std::size_t regions = 0;
+    std::size_t declarations = 0;  // with at least one pointer position
+    std::size_t slots = 0;
+    std::size_t explicit_slots = 0;  // written in the declaration
+    std::size_t inferred_slots = 0;  // nonnull or nullable from a region
+    std::size_t unspecified = 0;     // pointer positions left without nullability
+};
+
+class NullabilityIndex {
+public:
+    static constexpr std::string_view kMagic = "MOBYNULL";
+    static constexpr std::uint32_t kVersion = 1;
+
+    static std::string default_path(const std::string& corpus_dir);
+
+    static NullabilityStats build(const Corpus& corpus, const SymbolDb& db, const std::string& path);
+
+    explicit NullabilityIndex(const std::string& path);
+
+    std::uint64_t corpus_hash() const { return reader_.header().corpus_hash; }
+    std::size_t size() const { return symbol_count_; }
+    std::size_t region_count() const { return region_count_; }
+    const NullabilityRegion& region(std::size_t i) const { return regions_[i]; }
+
+    // The region containing `offset` of corpus file `file`, or null.
+    const NullabilityRegion* region_at(std::uint32_t file, std::uint64_t offset) const;
+
+    // Slots of symbol `id`: return or value type first, then parameters in
+    // order, Nullability::None where the type is not a pointer. Empty for
+    // symbols other than methods, properties, functions and variables.
+    struct Slots {
+        const NullabilitySlot* first;
+        std::size_t count;
+        const NullabilitySlot* begin() const { return first; }
+        const NullabilitySlot* end() const { return first + count; }
+        bool empty() const { return count == 0; }
+    };
+    Slots slots(std::size_t id) const { return {slots_ + firsts_[id], firsts_[id + 1] - firsts_[id]}; }
+
+private:
+    BlobReader reader_;
+    const NullabilityRegion* regions_ = nullptr;
+    const std::uint32_t* firsts_ = nullptr;  // symbol_count + 1 slot offsets
+    const NullabilitySlot* slots_ = nullptr;
+    std::uint64_t region_count_ = 0;
+    std::uint64_t symbol_count_ = 0;
+};
+
+} // namespace moby
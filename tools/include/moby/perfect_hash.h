@@ -0,0 +1,39 @@
+// Hash-and-displace perfect hashing over 64-bit key hashes.
+//
+// Keys are split into buckets of about four; each bucket gets a displacement
+// value chosen so that all its keys land in distinct free slots. A lookup
+// costs one bucket read and one slot read, and the caller compares the key
+// stored behind the slot to reject absent keys. The displacement and slot
+// arrays are plain uint32 arrays so they can live in a mapped file.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace moby {
+
+struct PerfectHash {
+    std::vector<std::uint32_t> displacements;  // one per bucket
+    std::vector<std::uint32_t> slots;          // key index + 1, 0 when empty
+
+    // Throws if two keys share a 64-bit hash.
+    static PerfectHash build(const std::vector<std::uint64_t>& hashes);
+};
+
+inline std::uint64_t perfect_hash_slot(std::uint64_t hash, std::uint32_t displacement, std::uint64_t slot_count) {
+    std::uint64_t h = (hash ^ (displacement * 0x9E3779B97F4A7C15ULL)) * 0xD6E8FEB86659FD93ULL;
+    h ^= h >> 32;
+    return h % slot_count;
+}
+
+// Key index + 1 for `hash`, or 0. The caller must still verify the key.
+inline std::uint32_t perfect_hash_lookup(std::uint64_t hash, const std::uint32_t* displacements,
+                                         std::uint64_t bucket_count, const std::uint32_t* slots,
+                                         std::uint64_t slot_count) {
+    if (bucket_count == 0)
+        return 0;
+    std::uint32_t d = displacements[hash % bucket_count];
+    return slots[perfect_hash_slot(hash, d, slot_count)];
+}
+
+} // namespace moby
@@ -0,0 +1,58 @@
+// Single-pass multi-pattern scanner for corpus landmarks.
+//
+// Finds section separators, Objective-C container keywords, typedef,
+// #import/#include, the #if family and the API_* availability macros in one
+// pass and reports each hit as (offset, kind). Keywords only match as whole
+// words. Candidate positions are found 32 (AVX2) or 16 (SSE4.2) bytes at a
+// time by comparing the first two bytes of every pattern against the block,
+// plus a third byte where those two are common in ordinary text (@property,
+// type, comments); candidates are then verified with a short compare. The
+// implementation is picked at run time from what the CPU supports.
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+enum class ScanKind : std::uint8_t {
+    Separator,       // "// ==========  "
+    Interface,       // @interface
+    Protocol,        // @protocol
+    End,             // @end
+    Typedef,
+    Import,          // #import
+    Include,         // #include
+    If,              // #if
+    Ifdef,           // #ifdef
+    Ifndef,          // #ifndef
+    Elif,            // #elif
+    Else,            // #else
+    Endif,           // #endif
+    ApiAvailable,    // API_AVAILABLE
+    ApiUnavailable,  // API_UNAVAILABLE
+    ApiDeprecated,   // API_DEPRECATED and API_DEPRECATED_WITH_REPLACEMENT
+};
+inline constexpr int kScanKindCount = 16;
+
+const char* scan_kind_name(ScanKind kind);
+
+struct ScanHit {
+    std::uint64_t offset;
+    ScanKind kind;
+};
+
+enum class Isa : std::uint8_t { Scalar, Sse42, Avx2 };
+
+const char* isa_name(Isa isa);
+// Best implementation this CPU supports.
+Isa best_isa();
+bool isa_supported(Isa isa);
+
+// Appends every hit in `text`, in offset order, with offsets relative to
+// `text` plus `base`.
+void scan(std::string_view text, std::vector<ScanHit>& out, std::uint64_t base = 0);
+void scan(std::string_view text, std::vector<ScanHit>& out, std::uint64_t base, Isa isa);
+
+} // namespace moby
@@ -0,0 +1,82 @@
+// Symbol-level comparison of two corpus snapshots.
+//
+// Declarations are matched by identity, not by position: framework, kind,
+// container and name, so -[NSString length] in Foundation is the same API in
+// both snapshots whichever header or line it sits on. Each API carries two
+// fingerprints: a hash of its declaration with comments, whitespace,
+// preprocessor lines and availability macros removed, and a hash of the
+// availability it declares itself. Comparing two snapshots is a merge of
+// identity-sorted fingerprint tables; the declarations are only rebuilt as
+// text for the APIs that differ.
+#pragma once
+
+#include "moby/availability.h"
+#include "moby/corpus.h"
+#include "moby/symbols.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+struct ApiFingerprint {
+    std::uint64_t identity;     // hash of framework, kind, parent and name
+    std::uint64_t declaration;  // 0 when every occurrence normalizes to nothing
+    std::uint64_t availability;
+    std::uint32_t symbol;       // first occurrence, index into ApiSnapshot::symbols()
+    std::uint32_t count;        // occurrences folded into this API (e.g. both arms of an #if)
+};
+
+// Declaration text as compared: tokens joined by single spaces, without
+// comments, directives or availability macros; an @interface or @protocol is
+// cut to its header line and an enum to what precedes its body, since their
+// members are APIs of their own.
+std::string normalized_declaration(SymbolKind kind, std::string_view decl);
+
+// Availability macros: API_AVAILABLE, NS_DEPRECATED, __IOS_PROHIBITED, ...
+bool is_availability_macro(std::string_view ident);
+
+// "macos 10.13, ios 11.0 deprecated 13.0, watchos unavailable", or "none".
+std::string describe_availability(const Availability& a);
+
+class ApiSnapshot {
+public:
+    // Maps and parses the corpus in `dir` on `threads` threads (0 means one per core).
+    explicit ApiSnapshot(const std::string& dir, unsigned threads = 0);
+
+    const Corpus& corpus() const { return *corpus_; }
+    const std::vector<Symbol>& symbols() const { return symbols_; }
+    // One entry per distinct identity, sorted by it.
+    const std::vector<ApiFingerprint>& apis() const { return apis_; }
+
+    std::string_view framework(const ApiFingerprint& api) const;
+    std::string_view declaration_text(const ApiFingerprint& api) const;
+    Availability availability(const ApiFingerprint& api) const;
+
+private:
+    std::unique_ptr<Corpus> corpus_;
+    std::vector<Symbol> symbols_;
+    std::vector<ApiFingerprint> apis_;
+};
+
+enum ApiChange : std::uint8_t {
+    kApiAdded = 1,
+    kApiRemoved = 2,
+    kApiDeclarationChanged = 4,
+    kApiAvailabilityChanged = 8,
+};
+
+struct ApiDiff {
+    const ApiFingerprint* before;  // null when added
+    const ApiFingerprint* after;   // null when removed
+    std::uint8_t changes;          // ApiChange bits
+};
+
+// Every API added, removed or changed from `before` to `after`, ordered by
+// framework, then kind, then container and name.
+std::vector<ApiDiff> diff_apis(const ApiSnapshot& before, const ApiSnapshot& after);
+
+} // namespace moby
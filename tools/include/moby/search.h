@@ -0,0 +1,57 @@
+// Line-oriented regex search over the corpus, filtered by the trigram index.
+//
+// Matches are whole lines, as with grep, and come back in corpus order with
+// the header they belong to. Within a candidate section the longest literal
+// the pattern requires is located with a plain substring search and the regex
+// only runs on lines containing it; a pattern without regex operators never
+// runs the regex engine at all.
+#pragma once
+
+#include "moby/section_index.h"
+#include "moby/trigram_index.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace moby {
+
+struct SearchOptions {
+    bool ignore_case = false;
+    bool fixed = false;          // pattern is a plain string
+    std::string framework;       // only sections of this framework, when set
+    std::size_t max_hits = ~std::size_t(0);
+};
+
+struct SearchHit {
+    const SectionRecord* section;
+    std::uint32_t line;          // 1-based, counted from the section start
+    std::string_view text;       // the matching line, without its newline
+};
+
+struct SearchStats {
+    std::size_t candidates = 0;  // sections left after trigram filtering
+    std::size_t scanned = 0;     // bytes of those sections
+    std::size_t hits = 0;
+};
+
+class Searcher {
+public:
+    // Opens sections.idx and trigrams.idx of `corpus_dir`; both must have
+    // been built from the same corpus.
+    explicit Searcher(const std::string& corpus_dir);
+
+    const SectionIndex& sections() const { return sections_; }
+    const TrigramIndex& trigrams() const { return trigrams_; }
+
+    // Throws Error for a malformed pattern.
+    SearchStats search(std::string_view pattern, const SearchOptions& options,
+                       const std::function<void(const SearchHit&)>& fn) const;
+
+private:
+    SectionIndex sections_;
+    TrigramIndex trigrams_;
+};
+
+} // namespace moby
@@ -0,0 +1,86 @@
+// Incremental rebuild of the derived files, driven by section content hashes.
+//
+// `.moby/sections.cache` keeps, for every section content seen by the last
+// build, what that section contributes to the other files: its symbols (with
+// offsets relative to the section), their effective availability, and its
+// #import/#include directives. None of these depends on anything outside the
+// section, so a section whose content hash is in the cache is not parsed
+// again, even if it moved to another offset or file. The steps that span
+// sections (sorting and hashing symbol names, resolving includes, the include
+// closure) run in full every time; they are a small part of a full build.
+#pragma once
+
+#include "moby/availability.h"
+#include "moby/binary.h"
+#include "moby/corpus.h"
+#include "moby/include_graph.h"
+#include "moby/symbols.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+// Everything derived from one section alone.
+struct SectionResult {
+    std::vector<Symbol> symbols;             // offsets relative to the corpus file
+    std::vector<Availability> availability;  // parallel to `symbols`
+    std::vector<IncludeDirective> includes;
+};
+
+// Parses one section from scratch.
+void analyze_section(const Section& section, std::uint32_t ordinal, SectionResult& out);
+
+class SectionCache {
+public:
+    static constexpr std::string_view kMagic = "MOBYSCAC";
+    // Bump whenever extraction changes what a section produces.
+    static constexpr std::uint32_t kVersion = 1;
+
+    static std::string default_path(const std::string& corpus_dir);
+
+    // `hashes[i]` is the content hash of section i.
+    static void write(const Corpus& corpus, const std::vector<std::uint64_t>& hashes,
+                      const std::vector<SectionResult>& results, const std::string& path);
+
+    explicit SectionCache(const std::string& path);
+
+    std::size_t size() const { return entry_count_; }
+
+    // Fills `out` for section `ordinal` of `corpus` if content with this hash
+    // and length is cached.
+    bool load(const Corpus& corpus, std::uint32_t ordinal, std::uint64_t content_hash, SectionResult& out) const;
+
+private:
+    struct Entry;
+    struct CachedSymbol;
+    struct CachedAvailability;
+    struct CachedInclude;
+
+    BlobReader reader_;
+    const Entry* entries_ = nullptr;
+    const CachedSymbol* symbols_ = nullptr;
+    const CachedAvailability* availability_ = nullptr;
+    const CachedInclude* includes_ = nullptr;
+    std::uint64_t entry_count_ = 0;
+    std::uint64_t strings_ = 0;
+};
+
+struct RebuildStats {
+    std::size_t sections = 0;
+    std::size_t reused = 0;  // taken from the cache
+    std::size_t parsed = 0;
+    double hash_ms = 0;
+    double parse_ms = 0;
+    double write_ms = 0;
+};
+
+// Rebuilds sections.idx, symbols.db, availability.mat, includes.graph and the
+// cache itself under `<corpus>/.moby`, parsing only sections whose content is
+// not cached (all of them when `full`). The files are the same as the ones
+// the individual build commands write.
+RebuildStats rebuild_indexes(const Corpus& corpus, unsigned threads, bool full);
+
+} // namespace moby
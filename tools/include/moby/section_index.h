@@ -0,0 +1,80 @@
+// Persistent index of every header section in the corpus.
+//
+// Built once from a Corpus, the index maps a header path such as
+// "Foundation.framework/Headers/NSPredicate.h" to its file, byte offset,
+// length and content hash through an open-addressing table stored in the file
+// itself. Opening is a single mmap; a lookup hashes the path and probes the
+// table, and the section text is returned as a slice of the mapped corpus file.
+#pragma once
+
+#include "moby/binary.h"
+#include "moby/corpus.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+struct SectionRecord {
+    std::uint64_t path_hash;
+    std::uint64_t content_hash;
+    std::uint64_t marker;
+    std::uint64_t offset;
+    std::uint64_t length;
+    std::uint32_t file;
+    std::uint32_t reserved;
+    StrRef path;
+};
+static_assert(sizeof(SectionRecord) == 56);
+
+struct FileRecord {
+    StrRef name;
+    std::uint64_t size;
+};
+
+// Fingerprint of a corpus: hash over every section path and text, in order.
+std::uint64_t corpus_hash(const Corpus& corpus);
+
+class SectionIndex {
+public:
+    static constexpr std::string_view kMagic = "MOBYSIDX";
+    static constexpr std::uint32_t kVersion = 1;
+
+    // Default location of the index inside a corpus directory.
+    static std::string default_path(const std::string& corpus_dir);
+
+    static void build(const Corpus& corpus, const std::string& path);
+
+    // Maps the index; corpus files are mapped lazily on first access.
+    SectionIndex(const std::string& index_path, const std::string& corpus_dir);
+    ~SectionIndex();
+
+    std::uint64_t corpus_hash() const { return reader_.header().corpus_hash; }
+    std::size_t size() const { return section_count_; }
+    const SectionRecord& at(std::size_t i) const { return sections_[i]; }
+    std::string_view path(const SectionRecord& r) const { return reader_.str(strings_, r.path); }
+    std::string_view file_name(std::uint32_t file) const { return reader_.str(strings_, files_[file].name); }
+
+    const SectionRecord* find(std::string_view path) const;
+
+    // Section content as a view into the mapped corpus file.
+    std::string_view text(const SectionRecord& r) const;
+
+private:
+    BlobReader reader_;
+    std::string corpus_dir_;
+    const FileRecord* files_ = nullptr;
+    const SectionRecord* sections_ = nullptr;
+    const std::uint32_t* slots_ = nullptr;
+    std::uint64_t file_count_ = 0;
+    std::uint64_t section_count_ = 0;
+    std::uint64_t slot_mask_ = 0;
+    std::uint64_t strings_ = 0;
+    mutable std::vector<std::unique_ptr<MappedFile>> maps_;
+};
+
+} // namespace moby
@@ -0,0 +1,64 @@
+// Incremental section splitter over a byte stream: a pipe, a socket, a file,
+// or a tar archive of *.framework.h files, optionally gzip-compressed.
+//
+// Input is read into a ring buffer whose storage is mapped twice, back to
+// back, so any window of the ring is contiguous in memory and a section is
+// handed out as one string_view without copying. A section is complete when
+// the next `// ==========  ` separator, the end of its tar member, or the end
+// of the stream arrives; it is handed out then, while the rest of the input is
+// still being written, and its bytes are reclaimed on the next call. The ring
+// grows (doubling) only when one section does not fit, so peak memory follows
+// the largest header rather than the whole corpus.
+//
+// Sections split exactly as split_sections() splits a file: text ahead of the
+// first separator of the stream or of a tar member is skipped.
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace moby {
+
+struct StreamSection {
+    std::string_view source;  // tar member name, or empty for a plain stream
+    std::string_view path;    // e.g. "Foundation.framework/Headers/NSPredicate.h"
+    std::string_view text;    // content up to the next separator
+    std::uint64_t marker;     // offset of the separator within the source
+    std::uint64_t offset;     // offset of the first content byte within the source
+};
+
+struct SectionStreamStats {
+    std::uint64_t input_bytes = 0;   // read from the descriptor, before gunzip
+    std::uint64_t bytes = 0;         // corpus bytes after gunzip and tar framing
+    std::uint64_t sections = 0;
+    std::uint64_t members = 0;       // tar members read, 0 for a plain stream
+    std::size_t capacity = 0;        // current ring size
+    std::size_t peak_section = 0;    // longest section text handed out
+};
+
+class SectionStream {
+public:
+    static constexpr std::size_t kDefaultCapacity = 1 << 20;
+
+    // Reads from `fd`, which stays owned by the caller. The format (plain,
+    // tar, either gzipped) is detected from the first bytes. `capacity` is
+    // rounded up to whole pages.
+    explicit SectionStream(int fd, std::size_t capacity = kDefaultCapacity);
+    ~SectionStream();
+    SectionStream(const SectionStream&) = delete;
+    SectionStream& operator=(const SectionStream&) = delete;
+
+    // Fills `out` with the next complete section and returns true, or returns
+    // false at the end of the input. The views stay valid until the next call.
+    bool next(StreamSection& out);
+
+    const SectionStreamStats& stats() const;
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
+
+} // namespace moby
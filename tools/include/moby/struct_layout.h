@@ -0,0 +1,133 @@
+// Struct and union layouts for LP64 (arm64) and ILP32 (armv7), computed
+// without a compiler.
+//
+// Each target reads the corpus through its own ConditionalViews, so
+// `#if __LP64__` arms and `#define CGFLOAT_TYPE double` apply as they would
+// for that target. Field types are resolved through typedef chains, struct
+// and union tags, NS_ENUM underlying types and object-like #defines; C types
+// from outside the corpus (stdint.h, sys/types.h, objc.h) are built in.
+// Layout follows the Itanium C ABI as Apple's ARM targets use it: natural
+// alignment (64-bit scalars 4-aligned on ILP32), bitfields packed into their
+// declared type without straddling its alignment, `#pragma pack` and
+// `__attribute__((packed, aligned(N)))`.
+//
+// The table file holds one record per struct or union per target, with the
+// fields of each in declaration order, so a decoder can walk a raw struct dump
+// with no parsing of its own.
+#pragma once
+
+#include "moby/binary.h"
+#include "moby/conditionals.h"
+#include "moby/corpus.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+class EnumTable;
+
+enum class LayoutTarget : std::uint8_t { LP64, ILP32 };
+inline constexpr int kLayoutTargetCount = 2;
+
+const char* layout_target_name(LayoutTarget t);  // "lp64", "ilp32"
+bool parse_layout_target(std::string_view name, LayoutTarget& t);
+
+// The configuration a layout target reads the corpus as: iOS with its
+// pointer width.
+TargetConfig layout_target_config(LayoutTarget t);
+
+using LayoutEnums = std::array<const EnumTable*, kLayoutTargetCount>;
+
+enum class FieldKind : std::uint8_t { Int, Float, Pointer, Record, Vector };
+
+const char* field_kind_name(FieldKind k);
+
+struct FieldRecord {
+    StrRef name;                // empty for an anonymous struct or union member
+    StrRef type;                // as written, e.g. "CMTimeValue" or "struct _predicateFlags"
+    std::uint64_t bit_offset;   // from the start of the enclosing record
+    std::uint32_t size;         // bytes per element; for a bitfield, of its declared type
+    std::uint32_t count;        // array elements: 1 for a scalar, 0 for a flexible array member
+    std::uint32_t record;       // StructRecord of a Record field, else kNoRecord
+    std::uint16_t bit_width;    // bitfields only
+    FieldKind kind;
+    std::uint8_t flags;         // FieldRecord::kSigned | kBitfield
+    static constexpr std::uint32_t kNoRecord = ~0u;
+    static constexpr std::uint8_t kSigned = 1;
+    static constexpr std::uint8_t kBitfield = 2;
+};
+static_assert(sizeof(FieldRecord) == 40);
+
+struct StructRecord {
+    StrRef name;                // first typedef name, else the tag; empty when anonymous
+    StrRef tag;
+    std::uint32_t first_field;
+    std::uint32_t field_count;
+    std::uint32_t size;
+    std::uint32_t align;
+    std::uint32_t section;
+    LayoutTarget target;
+    std::uint8_t flags;         // StructRecord::kUnion | kResolved | kPacked | kBitfields
+    std::uint8_t pack;          // #pragma pack in effect, 0 for none
+    std::uint8_t reserved;
+    static constexpr std::uint8_t kUnion = 1;
+    static constexpr std::uint8_t kResolved = 2;   // every field type was found; otherwise no fields
+    static constexpr std::uint8_t kPacked = 4;     // __attribute__((packed))
+    static constexpr std::uint8_t kBitfields = 8;
+};
+static_assert(sizeof(StructRecord) == 40);
+
+struct LayoutBuildStats {
+    std::size_t records[kLayoutTargetCount] = {};
+    std::size_t resolved[kLayoutTargetCount] = {};
+    std::size_t fields[kLayoutTargetCount] = {};
+    std::size_t bitfields[kLayoutTargetCount] = {};
+    std::vector<std::string> unknown_types;  // distinct field types no record could resolve, LP64
+};
+
+// Element `index` of the integer, pointer or bitfield field `f`, read from a
+// little-endian dump of its record and sign-extended when the field is signed.
+std::uint64_t read_field(const FieldRecord& f, const void* record, std::uint32_t index = 0);
+
+class StructLayouts {
+public:
+    static constexpr std::string_view kMagic = "MOBYLAYT";
+    static constexpr std::uint32_t kVersion = 1;
+
+    static std::string default_path(const std::string& corpus_dir);
+
+    // `enums[t]`, when given, resolves enumerators used as array bounds for
+    // target t; it should be folded for layout_target_config(t).
+    static LayoutBuildStats build(const Corpus& corpus, const LayoutEnums& enums, const std::string& path,
+                                  unsigned threads = 0);
+
+    explicit StructLayouts(const std::string& path);
+
+    std::uint64_t corpus_hash() const { return reader_.header().corpus_hash; }
+    std::size_t size() const { return record_count_; }
+    const StructRecord& at(std::size_t i) const { return records_[i]; }
+    const FieldRecord& field(std::size_t i) const { return fields_[i]; }
+    std::string_view name(StrRef ref) const { return reader_.str(strings_, ref); }
+
+    // The record a typedef name or tag denotes for `target`, or null.
+    const StructRecord* find(std::string_view name, LayoutTarget target) const;
+
+private:
+    struct Name;
+
+    BlobReader reader_;
+    const StructRecord* records_ = nullptr;
+    const FieldRecord* fields_ = nullptr;
+    const Name* names_ = nullptr;
+    const std::uint32_t* displacements_ = nullptr;
+    const std::uint32_t* slots_ = nullptr;
+    std::uint64_t record_count_ = 0;
+    std::uint64_t bucket_count_ = 0, slot_count_ = 0;
+    std::uint64_t strings_ = 0;
+};
+
+} // namespace moby
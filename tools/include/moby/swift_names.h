@@ -0,0 +1,103 @@
+// Swift-name mapping: the Swift spelling of every declaration the headers
+// rename with NS_SWIFT_NAME (or CF_SWIFT_NAME, swift_name(...)) or hide with
+// NS_REFINED_FOR_SWIFT (CF_REFINED_FOR_SWIFT, swift_private).
+//
+// Each annotation is attached to the declaration that carries it: the
+// innermost method, property, function, variable or enumerator around it, the
+// enum or struct it follows (`} NS_SWIFT_NAME(...)`), or the class or protocol
+// it precedes. A refined declaration without an explicit name keeps its
+// imported name behind `__`; for methods that name is derived from the
+// selector (`initWithCoordinate:title:` -> `__init(coordinate:title:)`)
+// without the importer's word pruning.
+//
+// Both spellings, and the last component of a dotted Swift name, are keys of
+// one sorted array, so a prefix of either spelling is a contiguous run found
+// with two binary searches over the mapped file.
+#pragma once
+
+#include "moby/binary.h"
+#include "moby/corpus.h"
+#include "moby/symbol_db.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace moby {
+
+struct SwiftNameRecord {
+    StrRef name;            // C or Objective-C spelling: selector, function, type, ...
+    StrRef swift;           // Swift spelling, e.g. "run(_:options:)" or "ARFrame.SegmentationClass"
+    StrRef parent;          // class or protocol of a method or property, enum of an enumerator
+    std::uint32_t symbol;   // symbols.db ID
+    SymbolKind kind;
+    std::uint8_t flags;     // SwiftNameRecord::kRenamed | kRefined
+    std::uint16_t reserved;
+    static constexpr std::uint8_t kRenamed = 1;  // an explicit Swift name
+    static constexpr std::uint8_t kRefined = 2;  // NS_REFINED_FOR_SWIFT
+};
+static_assert(sizeof(SwiftNameRecord) == 32);
+
+enum class SwiftKeySide : std::uint32_t {
+    ObjC,    // the C or Objective-C spelling
+    Swift,   // the full Swift spelling
+    Member,  // the part of a dotted Swift name after the last '.'
+};
+
+struct SwiftNameKey {
+    StrRef text;
+    std::uint32_t record;
+    SwiftKeySide side;
+};
+static_assert(sizeof(SwiftNameKey) == 16);
+
+struct SwiftNameStats {
+    std::size_t annotations = 0;  // NS_SWIFT_NAME and NS_REFINED_FOR_SWIFT sites
+    std::size_t unattached = 0;   // sites with no declaration to attach to
+    std::size_t records = 0;
+    std::size_t renamed = 0;
+    std::size_t refined = 0;
+    std::size_t keys = 0;
+};
+
+class SwiftNameTable {
+public:
+    static constexpr std::string_view kMagic = "MOBYSWFT";
+    static constexpr std::uint32_t kVersion = 1;
+
+    static std::string default_path(const std::string& corpus_dir);
+
+    static SwiftNameStats build(const Corpus& corpus, const SymbolDb& db, const std::string& path);
+
+    explicit SwiftNameTable(const std::string& path);
+
+    std::uint64_t corpus_hash() const { return reader_.header().corpus_hash; }
+    std::size_t size() const { return record_count_; }
+    std::size_t key_count() const { return key_count_; }
+    const SwiftNameRecord& record(std::size_t i) const { return records_[i]; }
+    const SwiftNameRecord& record(const SwiftNameKey& k) const { return records_[k.record]; }
+    std::string_view str(StrRef ref) const { return reader_.str(strings_, ref); }
+
+    // Keys in byte order of their text.
+    struct Keys {
+        const SwiftNameKey* first;
+        std::size_t count;
+        const SwiftNameKey* begin() const { return first; }
+        const SwiftNameKey* end() const { return first + count; }
+        bool empty() const { return count == 0; }
+    };
+    // Keys spelled exactly `text`, on any side.
+    Keys find(std::string_view text) const;
+    // Keys starting with `prefix`, on any side.
+    Keys complete(std::string_view prefix) const;
+
+private:
+    BlobReader reader_;
+    const SwiftNameRecord* records_ = nullptr;
+    const SwiftNameKey* keys_ = nullptr;
+    std::uint64_t record_count_ = 0;
+    std::uint64_t key_count_ = 0;
+    std::uint64_t strings_ = 0;
+};
+
+} // namespace moby
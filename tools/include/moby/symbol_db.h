@@ -0,0 +1,101 @@
+// On-disk symbol table for the corpus.
+//
+// Records are sorted by name, so every name owns a contiguous run; a perfect
+// hash over the distinct names leads straight to that run. A symbol's ID is
+// its position in the table and is stable for a given corpus hash.
+#pragma once
+
+#include "moby/binary.h"
+#include "moby/corpus.h"
+#include "moby/symbols.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+struct SymbolRecord {
+    StrRef name;
+    StrRef parent;
+    std::uint64_t offset;   // declaration start within the corpus file
+    std::uint32_t length;
+    std::uint32_t section;
+    SymbolKind kind;
+    std::uint8_t flags;
+    std::uint16_t reserved;
+    std::uint32_t reserved2;
+};
+static_assert(sizeof(SymbolRecord) == 40);
+
+struct SymbolName {
+    StrRef name;
+    std::uint32_t first;  // first record with this name
+    std::uint32_t count;
+};
+
+struct SymbolSection {
+    StrRef path;
+    std::uint32_t file;
+    std::uint32_t reserved;
+    std::uint64_t offset;  // section content start within the corpus file
+};
+
+// Extracts the symbols of every section, in corpus order. Sections are parsed
+// on `threads` threads (0 means one per core); the result does not depend on
+// the thread count.
+std::vector<Symbol> extract_corpus_symbols(const Corpus& corpus, unsigned threads = 0);
+
+class SymbolDb {
+public:
+    static constexpr std::string_view kMagic = "MOBYSYMS";
+    static constexpr std::uint32_t kVersion = 1;
+
+    static std::string default_path(const std::string& corpus_dir);
+
+    // Returns the ID assigned to each of `symbols`.
+    static std::vector<std::uint32_t> build(const Corpus& corpus, const std::vector<Symbol>& symbols,
+                                            const std::string& path);
+
+    explicit SymbolDb(const std::string& path);
+
+    std::uint64_t corpus_hash() const { return reader_.header().corpus_hash; }
+    std::size_t size() const { return symbol_count_; }
+    const SymbolRecord& at(std::size_t id) const { return symbols_[id]; }
+
+    // Records named `name`; empty when there are none.
+    struct Range {
+        const SymbolRecord* first;
+        std::size_t count;
+        const SymbolRecord* begin() const { return first; }
+        const SymbolRecord* end() const { return first + count; }
+    };
+    Range find(std::string_view name) const;
+    // Records whose name starts with `prefix`, in name order.
+    Range with_prefix(std::string_view prefix) const;
+
+    std::size_t id_of(const SymbolRecord& r) const { return &r - symbols_; }
+    std::string_view name(const SymbolRecord& r) const { return reader_.str(strings_, r.name); }
+    std::string_view parent(const SymbolRecord& r) const { return reader_.str(strings_, r.parent); }
+    const SymbolSection& section(const SymbolRecord& r) const { return sections_[r.section]; }
+    std::string_view section_path(const SymbolRecord& r) const { return reader_.str(strings_, sections_[r.section].path); }
+    std::string_view file_name(std::uint32_t file) const { return reader_.str(strings_, files_[file]); }
+    std::size_t section_count() const { return section_count_; }
+
+private:
+    BlobReader reader_;
+    const SymbolRecord* symbols_ = nullptr;
+    const SymbolName* names_ = nullptr;
+    const std::uint32_t* displacements_ = nullptr;
+    const std::uint32_t* slots_ = nullptr;
+    const SymbolSection* sections_ = nullptr;
+    const StrRef* files_ = nullptr;
+    std::uint64_t symbol_count_ = 0;
+    std::uint64_t bucket_count_ = 0;
+    std::uint64_t slot_count_ = 0;
+    std::uint64_t section_count_ = 0;
+    std::uint64_t strings_ = 0;
+};
+
+} // namespace moby
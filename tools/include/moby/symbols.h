@@ -0,0 +1,68 @@
+// Declaration extractor: finds the Objective-C and C symbols a header declares.
+//
+// The extractor is a heuristic, single-pass reader over the token stream of
+// one section. It does not preprocess: both arms of an #if are seen, and
+// macros are recognized by name (NS_ENUM, API_AVAILABLE, *_EXPORT, ...).
+#pragma once
+
+#include "moby/lexer.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+enum class SymbolKind : std::uint8_t {
+    Interface,       // name: class, parent: superclass
+    Category,        // name: "Class(Category)", parent: class
+    Protocol,
+    ClassMethod,     // name: selector, parent: class or protocol
+    InstanceMethod,
+    Property,
+    Function,
+    Enum,
+    EnumConstant,    // parent: enum, empty for anonymous enums
+    Struct,
+    Union,
+    Typedef,
+    Variable,
+};
+
+inline constexpr int kSymbolKindCount = 13;
+
+const char* kind_name(SymbolKind kind);
+bool parse_kind(std::string_view name, SymbolKind& kind);
+
+struct Symbol {
+    std::string name;
+    std::string parent;
+    SymbolKind kind;
+    std::uint32_t section;  // corpus section ordinal
+    std::uint64_t offset;   // declaration start, relative to the corpus file
+    std::uint32_t length;   // declaration bytes, through its ';', '}' or @end
+};
+
+// Appends the symbols declared in `text`, the content of corpus section
+// `section` starting at file offset `base`.
+void extract_symbols(std::string_view text, std::uint64_t base, std::uint32_t section,
+                     std::vector<Symbol>& out);
+
+// True for all-caps identifiers with an underscore (API_AVAILABLE, CF_EXPORT,
+// __attribute__, ...), which the headers use as attribute and export macros.
+bool is_macro_name(std::string_view ident);
+
+// What an @interface, category or @protocol header names besides the unit.
+struct UnitHeader {
+    std::string super;                   // superclass; empty for a root class, category or protocol
+    std::vector<std::string> protocols;  // adopted, in order, without repeats
+};
+
+// Reads the header of the first @interface or @protocol in toks[i, last):
+// @interface Name<Params> : Super<Args> <Protocols>, @interface Class
+// (Category) <Protocols> or @protocol Name <Protocols>. The first <...> after
+// a class name holds generic parameters, except on a root class.
+UnitHeader read_unit_header(std::string_view text, const std::vector<Token>& toks, std::size_t i, std::size_t last);
+
+} // namespace moby
@@ -0,0 +1,90 @@
+// Trigram inverted index over corpus sections.
+//
+// For every three-byte sequence (ASCII letters folded to lower case) the file
+// lists the sections containing it, as delta-encoded varints. A query is
+// turned into a boolean formula over trigrams that every match must satisfy
+// (`trigram_query`), and evaluating the formula against the posting lists
+// yields the candidate sections; only those are searched. Folding makes one
+// index serve both case-sensitive and case-insensitive searches, the former
+// being verified exactly afterwards.
+#pragma once
+
+#include "moby/binary.h"
+#include "moby/bitset.h"
+#include "moby/corpus.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+inline constexpr unsigned char fold_ascii(unsigned char c) { return c >= 'A' && c <= 'Z' ? c + 32 : c; }
+
+inline constexpr std::uint32_t trigram_key(unsigned char a, unsigned char b, unsigned char c) {
+    return std::uint32_t(fold_ascii(a)) << 16 | std::uint32_t(fold_ascii(b)) << 8 | fold_ascii(c);
+}
+
+// A condition on the trigrams of a section: All matches everything, And
+// requires every trigram and child, Or requires any child.
+struct TrigramQuery {
+    enum class Op : std::uint8_t { All, And, Or };
+    Op op = Op::All;
+    std::vector<std::uint32_t> trigrams;  // And only
+    std::vector<TrigramQuery> children;
+};
+
+struct RegexAnalysis {
+    TrigramQuery query;
+    // Literals every match contains, longest first, for locating and
+    // screening candidate lines without the regex engine.
+    std::vector<std::string> required;
+    // The pattern is a plain string with no regex operators.
+    bool literal = false;
+};
+
+// Analyzes an ECMAScript regex (or, with `fixed`, a plain string). Unknown
+// constructs only weaken the filter, never make it reject a match.
+RegexAnalysis analyze_regex(std::string_view pattern, bool fixed);
+
+class TrigramIndex {
+public:
+    static constexpr std::string_view kMagic = "MOBYTRIG";
+    static constexpr std::uint32_t kVersion = 1;
+
+    static std::string default_path(const std::string& corpus_dir);
+
+    static void build(const Corpus& corpus, const std::string& path, unsigned threads = 0);
+
+    explicit TrigramIndex(const std::string& path);
+
+    std::uint64_t corpus_hash() const { return reader_.header().corpus_hash; }
+    std::size_t section_count() const { return section_count_; }
+    std::size_t trigram_count() const { return trigram_count_; }
+    std::size_t posting_bytes() const { return posting_bytes_; }
+
+    // Sections containing `key`.
+    Bitset postings(std::uint32_t key) const;
+    std::size_t posting_count(std::uint32_t key) const;
+
+    // Sections that may match `query`.
+    Bitset candidates(const TrigramQuery& query) const;
+
+private:
+    struct Entry {
+        std::uint32_t key;
+        std::uint32_t count;
+        std::uint64_t offset;  // into the posting area
+    };
+    const Entry* lookup(std::uint32_t key) const;
+
+    BlobReader reader_;
+    const Entry* entries_ = nullptr;
+    const unsigned char* postings_ = nullptr;
+    std::uint64_t trigram_count_ = 0;
+    std::uint64_t section_count_ = 0;
+    std::uint64_t posting_bytes_ = 0;
+};
+
+} // namespace moby
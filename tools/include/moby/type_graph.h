@@ -0,0 +1,111 @@
+// Which declarations take and give which types, across frameworks.
+//
+// Built from the declaration cache: every method, function, property and
+// variable links to the types named in its return, parameter and property
+// types, as seen from the API's side. A parameter is consumed, a return value
+// or variable is produced, and a property is produced and, unless readonly,
+// consumed. Roles flip inside a block's parameter list (the API hands those
+// values to the caller), and an out-parameter (NSError **, CVPixelBufferRef *)
+// is produced. A non-const pointer to a struct or scalar may be either, so it
+// counts as both. Only names the corpus declares as a class, protocol,
+// struct, union, enum or typedef become type nodes.
+//
+// Edges are stored twice, as delta-encoded varint adjacency lists: per type,
+// the declarations using it (the reverse lookup this file exists for); per
+// declaration, the types it uses. Type names are found through a perfect
+// hash, and each declaration carries its framework, so "which frameworks
+// accept a CVPixelBufferRef" decodes one list and touches nothing else.
+// Plain typedefs (typedef CVImageBufferRef CVPixelBufferRef) are recorded as
+// aliases, so a query can take in the types a declaration spells differently.
+#pragma once
+
+#include "moby/binary.h"
+#include "moby/decl_cache.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moby {
+
+struct TypeUse {
+    std::uint32_t id;     // a declaration (reverse lists) or a type (forward lists)
+    std::uint8_t roles;   // TypeUse::kConsumes | kProduces
+
+    static constexpr std::uint8_t kConsumes = 1;
+    static constexpr std::uint8_t kProduces = 2;
+};
+
+struct TypeNode {
+    StrRef name;
+    std::uint32_t consumers;  // declarations consuming the type
+    std::uint32_t producers;
+    std::uint32_t count;      // declarations using it either way
+    std::uint32_t alias;      // the type this is a plain typedef of, or TypeGraph::kNone
+    std::uint64_t offset;     // of its list in the reverse area
+};
+static_assert(sizeof(TypeNode) == 32);
+
+struct TypeGraphStats {
+    std::size_t types = 0;       // with at least one use
+    std::size_t declarations = 0;  // with at least one type
+    std::size_t edges = 0;
+    std::size_t list_bytes = 0;  // both directions, compressed
+    std::size_t raw_bytes = 0;   // both directions as (uint32 id, uint8 roles) pairs
+};
+
+class TypeGraph {
+public:
+    static constexpr std::string_view kMagic = "MOBYTYPE";
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::uint32_t kNone = ~0u;
+
+    static std::string default_path(const std::string& corpus_dir);
+
+    // Declaration IDs in the graph are those of `decls`.
+    static TypeGraphStats build(const DeclCache& decls, const std::string& path);
+
+    explicit TypeGraph(const std::string& path);
+
+    std::uint64_t corpus_hash() const { return reader_.header().corpus_hash; }
+    std::size_t type_count() const { return type_count_; }
+    std::size_t decl_count() const { return decl_count_; }
+    const TypeNode& type(std::uint32_t t) const { return types_[t]; }
+    std::string_view name(StrRef ref) const { return reader_.str(strings_, ref); }
+
+    // Type node named `name`, or kNone.
+    std::uint32_t find_type(std::string_view name) const;
+
+    // `t`, the types it is a typedef of, and the types that are typedefs of
+    // it: CVPixelBufferRef, CVImageBufferRef, CVBufferRef. Scans the type table.
+    void aliases(std::uint32_t t, std::vector<std::uint32_t>& out) const;
+
+    // Declarations using type `t`, in declaration ID order.
+    void users(std::uint32_t t, std::vector<TypeUse>& out) const;
+    // Types declaration `decl` uses, in type ID order.
+    void types_of(std::uint32_t decl, std::vector<TypeUse>& out) const;
+
+    std::uint16_t framework(std::uint32_t decl) const { return frameworks_[decl]; }
+    std::string_view framework_name(std::uint16_t f) const { return name(framework_names_[f]); }
+    std::size_t framework_count() const { return framework_count_; }
+
+private:
+    BlobReader reader_;
+    const TypeNode* types_ = nullptr;
+    const std::uint32_t* decl_offsets_ = nullptr;  // decl_count + 1, into the forward area
+    const std::uint16_t* frameworks_ = nullptr;
+    const StrRef* framework_names_ = nullptr;
+    const std::uint32_t* displacements_ = nullptr;
+    const std::uint32_t* slots_ = nullptr;
+    const unsigned char* reverse_ = nullptr;
+    const unsigned char* forward_ = nullptr;
+    std::uint64_t type_count_ = 0;
+    std::uint64_t decl_count_ = 0;
+    std::uint64_t framework_count_ = 0;
+    std::uint64_t buckets_ = 0;
+    std::uint64_t slot_count_ = 0;
+    std::uint64_t strings_ = 0;
+};
+
+} // namespace moby
@@ -0,0 +1,24 @@
+// Work-stealing execution of a batch of independent tasks.
+//
+// Tasks are dealt round-robin, in the caller's order, onto one deque per
+// worker. A worker takes from the front of its own deque and, when that runs
+// dry, steals from the back of another's. Dealing the most expensive tasks
+// first keeps the long ones from landing at the end of the run.
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace moby {
+
+// std::thread::hardware_concurrency(), or 1 when unknown.
+unsigned default_thread_count();
+
+// Calls fn(task) for every entry of `tasks` on `threads` threads (0 means
+// default_thread_count()) and returns when all have finished. The first
+// exception thrown by a task is rethrown here once the workers have stopped.
+void run_stealing(const std::vector<std::uint32_t>& tasks, unsigned threads,
+                  const std::function<void(std::uint32_t)>& fn);
+
+} // namespace moby
@@ -0,0 +1,287 @@
+#include "moby/api_oracle.h"
+
+#include "moby/hash.h"
+#include "moby/section_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <map>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+namespace {
+
+struct ApiOracleLayout {
+    std::uint64_t block_count;
+    std::uint64_t name_count;
+    std::uint64_t bucket_count;
+    std::uint64_t names_size;
+    std::uint64_t framework_count;
+    std::uint64_t set_count;
+    std::uint64_t set_member_count;
+    std::uint64_t set_bits;
+    std::uint64_t blocks;
+    std::uint64_t buckets;
+    std::uint64_t names;
+    std::uint64_t set_ids;
+    std::uint64_t set_first;
+    std::uint64_t set_members;
+    std::uint64_t frameworks;
+    std::uint64_t strings;
+    std::uint64_t strings_size;
+};
+
+constexpr std::size_t kBucket = 16;
+constexpr std::uint64_t kFilterSeed = 0x6f7261636c65;  // "oracle"
+
+// Block from the high half of the hash, then one bit in each of the block's
+// eight words from six bits apiece of a remix.
+struct Probe {
+    std::uint64_t block;
+    std::uint64_t bits;
+};
+
+Probe probe(std::string_view name, std::uint64_t block_count) {
+    std::uint64_t h = hash64(name, kFilterSeed);
+    std::uint64_t block = static_cast<std::uint64_t>((static_cast<unsigned __int128>(h) * block_count) >> 64);
+    std::uint64_t bits = (h ^ h >> 31) * 0x9E3779B97F4A7C15ULL;
+    return {block, bits};
+}
+
+// "UIKit.framework/Headers/UIApplication.h" -> "UIKit"; paths outside a
+// framework keep their first component.
+std::string_view framework_of(std::string_view path) {
+    std::string_view first = path.substr(0, path.find('/'));
+    std::size_t dot = first.find(".framework");
+    return dot == std::string_view::npos ? first : first.substr(0, dot);
+}
+
+std::string_view head(const unsigned char* names, std::uint32_t offset) {
+    const unsigned char* p = names + offset;
+    std::size_t length = get_varint(p);
+    return {reinterpret_cast<const char*>(p), length};
+}
+
+} // namespace
+
+std::string ApiOracle::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "api.oracle").string();
+}
+
+ApiOracleStats ApiOracle::build(const Corpus& corpus, const SymbolDb& db, const std::string& path,
+                                std::uint32_t bits_per_key) {
+    // Name -> frameworks, both sorted.
+    std::map<std::string_view, std::vector<std::uint16_t>> names;
+    std::map<std::string_view, std::uint16_t> framework_ids;
+    std::vector<std::string_view> framework_names;
+    for (std::uint32_t id = 0; id < db.size(); ++id) {
+        const SymbolRecord& r = db.at(id);
+        std::string_view framework = framework_of(db.section_path(r));
+        auto [it, added] = framework_ids.emplace(framework, static_cast<std::uint16_t>(framework_names.size()));
+        if (added)
+            framework_names.push_back(framework);
+        std::string_view name = db.name(r);
+        for (std::string_view key : {name, name.substr(0, name.find(':'))}) {
+            if (key.empty())
+                continue;
+            auto& list = names[key];
+            if (std::find(list.begin(), list.end(), it->second) == list.end())
+                list.push_back(it->second);
+        }
+    }
+    if (framework_names.size() > 0xffff)
+        throw Error("too many frameworks for the API oracle");
+
+    // Framework sets, deduplicated; most names have exactly one framework.
+    std::map<std::vector<std::uint16_t>, std::uint32_t> set_index;
+    std::vector<std::uint32_t> set_first{0};
+    std::vector<std::uint16_t> set_members;
+    std::vector<std::uint32_t> name_sets;
+    for (auto& [name, list] : names) {
+        std::sort(list.begin(), list.end());
+        auto [it, added] = set_index.emplace(list, static_cast<std::uint32_t>(set_first.size() - 1));
+        if (added) {
+            set_members.insert(set_members.end(), list.begin(), list.end());
+            set_first.push_back(static_cast<std::uint32_t>(set_members.size()));
+        }
+        name_sets.push_back(it->second);
+    }
+    std::uint32_t set_bits = 1;
+    while ((std::uint64_t(1) << set_bits) < set_index.size())
+        ++set_bits;
+    std::vector<std::uint64_t> set_ids((name_sets.size() * set_bits + 63) / 64 + 1, 0);
+    for (std::size_t i = 0; i < name_sets.size(); ++i) {
+        std::size_t bit = i * set_bits;
+        set_ids[bit / 64] |= std::uint64_t(name_sets[i]) << (bit % 64);
+        if (bit % 64 + set_bits > 64)
+            set_ids[bit / 64 + 1] |= std::uint64_t(name_sets[i]) >> (64 - bit % 64);
+    }
+
+    // Front-coded names: each bucket starts with a full name, the rest are
+    // (shared prefix, suffix length, suffix) against their predecessor.
+    std::string coded;
+    std::vector<std::uint32_t> buckets;
+    std::string_view previous;
+    std::size_t i = 0;
+    for (const auto& [name, _] : names) {
+        if (i++ % kBucket == 0) {
+            buckets.push_back(static_cast<std::uint32_t>(coded.size()));
+            put_varint(coded, name.size());
+        } else {
+            std::size_t shared = 0;
+            while (shared < name.size() && shared < previous.size() && name[shared] == previous[shared])
+                ++shared;
+            put_varint(coded, shared);
+            put_varint(coded, name.size() - shared);
+            coded.append(name.substr(shared));
+            previous = name;
+            continue;
+        }
+        coded.append(name);
+        previous = name;
+    }
+
+    std::uint64_t block_count = std::max<std::uint64_t>(1, (names.size() * bits_per_key + 511) / 512);
+    std::vector<std::uint64_t> blocks(block_count * 8, 0);
+    for (const auto& [name, _] : names) {
+        Probe p = probe(name, block_count);
+        for (int w = 0; w < 8; ++w)
+            blocks[p.block * 8 + w] |= std::uint64_t(1) << (p.bits >> (6 * w) & 63);
+    }
+
+    StringPool strings;
+    std::vector<StrRef> frameworks;
+    for (std::string_view f : framework_names)
+        frameworks.push_back(strings.add(f));
+
+    BlobWriter w(kMagic, kVersion, moby::corpus_hash(corpus));
+    std::size_t layout_at = w.put(ApiOracleLayout{});
+    ApiOracleLayout layout{};
+    layout.block_count = block_count;
+    layout.name_count = names.size();
+    layout.bucket_count = buckets.size();
+    layout.names_size = coded.size();
+    layout.framework_count = frameworks.size();
+    layout.set_count = set_index.size();
+    layout.set_member_count = set_members.size();
+    layout.set_bits = set_bits;
+    w.align(64);  // one block per cache line
+    layout.blocks = w.put_array(blocks);
+    layout.buckets = w.put_array(buckets);
+    layout.names = w.put_bytes(coded.data(), coded.size());
+    layout.set_ids = w.put_array(set_ids);
+    layout.set_first = w.put_array(set_first);
+    layout.set_members = w.put_array(set_members);
+    layout.frameworks = w.put_array(frameworks);
+    layout.strings = w.put_bytes(strings.data().data(), strings.data().size());
+    layout.strings_size = strings.data().size();
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+
+    ApiOracleStats stats;
+    stats.names = names.size();
+    stats.frameworks = frameworks.size();
+    stats.framework_sets = set_index.size();
+    stats.filter_bytes = blocks.size() * 8;
+    stats.set_bytes = buckets.size() * 4 + coded.size() + set_ids.size() * 8 + set_first.size() * 4 +
+                      set_members.size() * 2;
+    return stats;
+}
+
+ApiOracle::ApiOracle(const std::string& path) : reader_(path, kMagic, kVersion) {
+    const ApiOracleLayout& l = *reader_.array<ApiOracleLayout>(sizeof(BlobHeader), 1);
+    block_count_ = l.block_count;
+    name_count_ = l.name_count;
+    bucket_count_ = l.bucket_count;
+    names_size_ = l.names_size;
+    framework_count_ = l.framework_count;
+    set_bits_ = static_cast<std::uint32_t>(l.set_bits);
+    if (block_count_ == 0 || set_bits_ == 0 || set_bits_ > 32 ||
+        bucket_count_ != (name_count_ + kBucket - 1) / kBucket)
+        throw Error(path + ": malformed API oracle");
+    blocks_ = reader_.array<std::uint64_t>(l.blocks, block_count_ * 8);
+    buckets_ = reader_.array<std::uint32_t>(l.buckets, bucket_count_);
+    names_ = reinterpret_cast<const unsigned char*>(reader_.bytes(l.names, names_size_).data());
+    set_ids_ = reader_.array<std::uint64_t>(l.set_ids, (name_count_ * set_bits_ + 63) / 64 + 1);
+    set_first_ = reader_.array<std::uint32_t>(l.set_first, l.set_count + 1);
+    set_members_ = reader_.array<std::uint16_t>(l.set_members, l.set_member_count);
+    frameworks_ = reader_.array<StrRef>(l.frameworks, framework_count_);
+    reader_.bytes(l.strings, l.strings_size);
+    strings_ = l.strings;
+    for (std::uint64_t b = 0; b < bucket_count_; ++b)
+        if (buckets_[b] >= names_size_)
+            throw Error(path + ": malformed API oracle");
+}
+
+bool ApiOracle::may_contain(std::string_view name) const {
+    Probe p = probe(name, block_count_);
+    const std::uint64_t* block = blocks_ + p.block * 8;
+    std::uint64_t missing = 0;
+    for (int w = 0; w < 8; ++w)
+        missing |= ~block[w] & std::uint64_t(1) << (p.bits >> (6 * w) & 63);
+    return missing == 0;
+}
+
+std::int64_t ApiOracle::find(std::string_view name) const {
+    // Last bucket whose head is <= name.
+    std::uint64_t lo = 0, hi = bucket_count_;
+    while (lo < hi) {
+        std::uint64_t mid = (lo + hi) / 2;
+        if (head(names_, buckets_[mid]) <= name)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return -1;
+    std::uint64_t bucket = lo - 1;
+    const unsigned char* p = names_ + buckets_[bucket];
+    std::size_t length = get_varint(p);
+    // `matched` is how much of `name` the current entry agrees with; the
+    // entries rise, so once one passes `name` the rest do too.
+    const char* s = reinterpret_cast<const char*>(p);
+    std::size_t matched = 0;
+    while (matched < length && matched < name.size() && s[matched] == name[matched])
+        ++matched;
+    p += length;
+    std::uint64_t index = bucket * kBucket;
+    std::uint64_t end = std::min<std::uint64_t>(name_count_, index + kBucket);
+    for (;;) {
+        if (matched == name.size() && matched == length)
+            return static_cast<std::int64_t>(index);
+        if (++index == end)
+            return -1;
+        std::size_t shared = get_varint(p);
+        std::size_t suffix = get_varint(p);
+        s = reinterpret_cast<const char*>(p);
+        p += suffix;
+        if (shared < matched)
+            return -1;  // differs from `name` where the previous entry matched: past it
+        if (shared > matched)
+            continue;  // still below `name`, where the previous entry diverged
+        length = shared + suffix;
+        std::size_t k = 0;
+        while (k < suffix && matched < name.size() && s[k] == name[matched]) {
+            ++k;
+            ++matched;
+        }
+        if (k < suffix &&
+            (matched == name.size() || static_cast<unsigned char>(s[k]) > static_cast<unsigned char>(name[matched])))
+            return -1;
+    }
+}
+
+ApiOracle::Frameworks ApiOracle::frameworks(std::size_t index) const {
+    std::size_t bit = index * set_bits_;
+    std::uint64_t v = set_ids_[bit / 64] >> (bit % 64);
+    if (bit % 64 + set_bits_ > 64)
+        v |= set_ids_[bit / 64 + 1] << (64 - bit % 64);
+    std::uint32_t set = static_cast<std::uint32_t>(v & ((std::uint64_t(1) << set_bits_) - 1));
+    return {set_members_ + set_first_[set], set_first_[set + 1] - set_first_[set]};
+}
+
+} // namespace moby
@@ -0,0 +1,290 @@
+#include "moby/archive.h"
+
+#include "moby/hash.h"
+#include "moby/section_index.h"
+#include "moby/work_pool.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <numeric>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+namespace {
+
+struct ArchiveLayout {
+    std::uint64_t file_count;
+    std::uint64_t frame_count;
+    std::uint64_t path_count;
+    std::uint64_t original_bytes;
+    std::uint64_t files;
+    std::uint64_t frames;
+    std::uint64_t by_path;
+    std::uint64_t strings;
+    std::uint64_t strings_size;
+    std::uint64_t dictionary;
+    std::uint64_t dictionary_size;
+};
+
+// Lines shorter than this cost about as much to reference as to spell out.
+constexpr std::size_t kMinDictionaryLine = 8;
+
+// Raw deflate (no zlib header or checksum): frames are small, and the
+// uncompressed length is checked on the way out instead.
+constexpr int kWindowBits = -15;
+
+struct Piece {
+    std::string_view raw;     // marker to next marker, or the file preamble
+    std::uint32_t content;
+    std::uint32_t file;
+    std::string_view path;
+};
+
+std::string deflate_piece(std::string_view raw, std::string_view dictionary, int level) {
+    z_stream z{};
+    if (deflateInit2(&z, level, Z_DEFLATED, kWindowBits, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+        throw Error("deflateInit2 failed");
+    if (!dictionary.empty())
+        deflateSetDictionary(&z, reinterpret_cast<const Bytef*>(dictionary.data()),
+                             static_cast<uInt>(dictionary.size()));
+    std::string out(deflateBound(&z, static_cast<uLong>(raw.size())), '\0');
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(raw.data()));
+    z.avail_in = static_cast<uInt>(raw.size());
+    z.next_out = reinterpret_cast<Bytef*>(out.data());
+    z.avail_out = static_cast<uInt>(out.size());
+    int rc = deflate(&z, Z_FINISH);
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    if (rc != Z_STREAM_END)
+        throw Error("deflate failed");
+    return out;
+}
+
+} // namespace
+
+struct CorpusArchive::Inflater {
+    z_stream z{};
+
+    Inflater() {
+        if (inflateInit2(&z, kWindowBits) != Z_OK)
+            throw Error("inflateInit2 failed");
+    }
+    ~Inflater() { inflateEnd(&z); }
+};
+
+std::string CorpusArchive::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "corpus.marc").string();
+}
+
+// Every distinct line is scored by the bytes it would save if each section
+// containing it could refer to the dictionary instead of spelling it out
+// once: (sections containing it - 1) x length. Lines found in a single
+// section are left to the section's own window.
+std::string CorpusArchive::train_dictionary(const Corpus& corpus, std::size_t size) {
+    struct Line {
+        std::uint32_t sections = 0;
+        std::uint32_t last = ~0u;
+    };
+    std::unordered_map<std::string_view, Line> lines;
+    const auto& sections = corpus.sections();
+    for (std::uint32_t s = 0; s < sections.size(); ++s) {
+        std::string_view text = sections[s].text;
+        for (std::size_t begin = 0; begin < text.size();) {
+            std::size_t end = text.find('\n', begin);
+            end = end == std::string_view::npos ? text.size() : end + 1;
+            std::string_view line = text.substr(begin, end - begin);
+            begin = end;
+            if (line.size() < kMinDictionaryLine)
+                continue;
+            Line& l = lines[line];
+            if (l.last != s) {
+                l.last = s;
+                ++l.sections;
+            }
+        }
+    }
+
+    std::vector<std::pair<std::uint64_t, std::string_view>> scored;
+    for (const auto& [line, l] : lines)
+        if (l.sections > 1)
+            scored.emplace_back(std::uint64_t(l.sections - 1) * line.size(), line);
+    // Ties broken by text so the dictionary does not depend on hash order.
+    std::sort(scored.begin(), scored.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+
+    std::vector<std::string_view> chosen;
+    std::size_t total = 0;
+    for (const auto& [score, line] : scored) {
+        if (total + line.size() > size)
+            continue;
+        chosen.push_back(line);
+        total += line.size();
+    }
+    // Deflate reaches the end of the dictionary with the shortest distances.
+    std::string dictionary;
+    dictionary.reserve(total);
+    for (auto it = chosen.rbegin(); it != chosen.rend(); ++it)
+        dictionary.append(*it);
+    return dictionary;
+}
+
+void CorpusArchive::build(const Corpus& corpus, const std::string& path, const ArchiveOptions& options) {
+    std::string dictionary = options.dictionary_size ? train_dictionary(corpus, options.dictionary_size)
+                                                     : std::string();
+
+    // Cut each file at its separators; pieces of a file are consecutive.
+    std::vector<Piece> pieces;
+    std::vector<ArchiveFile> files;
+    StringPool strings;
+    const auto& sections = corpus.sections();
+    std::size_t next_section = 0;
+    for (std::uint32_t f = 0; f < corpus.files().size(); ++f) {
+        std::string_view text = corpus.files()[f].map.view();
+        ArchiveFile file{strings.add(corpus.files()[f].name), static_cast<std::uint32_t>(pieces.size()), 0,
+                         text.size()};
+        std::uint64_t first_marker = next_section < sections.size() && sections[next_section].file == f
+                                         ? sections[next_section].marker
+                                         : text.size();
+        if (first_marker > 0)
+            pieces.push_back({text.substr(0, first_marker), 0, f, {}});
+        for (; next_section < sections.size() && sections[next_section].file == f; ++next_section) {
+            const Section& s = sections[next_section];
+            std::uint64_t end = s.offset + s.length;
+            pieces.push_back({text.substr(s.marker, end - s.marker), static_cast<std::uint32_t>(s.offset - s.marker),
+                              f, s.path});
+        }
+        file.frame_count = static_cast<std::uint32_t>(pieces.size() - file.first_frame);
+        files.push_back(file);
+    }
+    for (const Piece& p : pieces)
+        if (p.raw.size() > 0xFFFFFFFFu)
+            throw Error("section too large to archive: " + std::string(p.path));
+
+    std::vector<std::string> compressed(pieces.size());
+    std::vector<std::uint32_t> tasks(pieces.size());
+    std::iota(tasks.begin(), tasks.end(), 0);
+    std::stable_sort(tasks.begin(), tasks.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return pieces[a].raw.size() > pieces[b].raw.size(); });
+    run_stealing(tasks, options.threads,
+                 [&](std::uint32_t i) { compressed[i] = deflate_piece(pieces[i].raw, dictionary, options.level); });
+
+    std::vector<ArchiveFrame> frames;
+    frames.reserve(pieces.size());
+    std::vector<std::uint32_t> by_path;
+    for (std::uint32_t i = 0; i < pieces.size(); ++i) {
+        const Piece& p = pieces[i];
+        ArchiveFrame frame{};
+        frame.length = static_cast<std::uint32_t>(p.raw.size());
+        frame.content = p.content;
+        frame.file = p.file;
+        frame.path = strings.add(p.path);
+        if (compressed[i].size() >= p.raw.size()) {
+            frame.flags = kStored;
+            compressed[i].assign(p.raw);
+        }
+        frame.stored = static_cast<std::uint32_t>(compressed[i].size());
+        frames.push_back(frame);
+        if (!p.path.empty())
+            by_path.push_back(i);
+    }
+    std::stable_sort(by_path.begin(), by_path.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return pieces[a].path < pieces[b].path; });
+
+    BlobWriter w(kMagic, kVersion, moby::corpus_hash(corpus));
+    std::size_t layout_at = w.put(ArchiveLayout{});
+    std::size_t frames_at = w.put_array(frames);
+    ArchiveLayout layout{};
+    layout.file_count = files.size();
+    layout.frame_count = frames.size();
+    layout.path_count = by_path.size();
+    layout.original_bytes = corpus.total_bytes();
+    layout.files = w.put_array(files);
+    layout.by_path = w.put_array(by_path);
+    layout.strings = w.put_bytes(strings.data().data(), strings.data().size());
+    layout.strings_size = strings.data().size();
+    layout.dictionary = w.put_bytes(dictionary.data(), dictionary.size());
+    layout.dictionary_size = dictionary.size();
+    layout.frames = frames_at;
+    // The frame table sits ahead of the data; offsets are filled in as the
+    // data is appended.
+    for (std::size_t i = 0; i < frames.size(); ++i) {
+        frames[i].offset = w.put_bytes(compressed[i].data(), compressed[i].size());
+        w.patch(frames_at + i * sizeof(ArchiveFrame), frames[i]);
+    }
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+}
+
+CorpusArchive::CorpusArchive(const std::string& path) : reader_(path, kMagic, kVersion) {
+    const ArchiveLayout& l = *reader_.array<ArchiveLayout>(sizeof(BlobHeader), 1);
+    file_count_ = l.file_count;
+    frame_count_ = l.frame_count;
+    path_count_ = l.path_count;
+    original_bytes_ = l.original_bytes;
+    files_ = reader_.array<ArchiveFile>(l.files, l.file_count);
+    frames_ = reader_.array<ArchiveFrame>(l.frames, l.frame_count);
+    by_path_ = reader_.array<std::uint32_t>(l.by_path, l.path_count);
+    reader_.bytes(l.strings, l.strings_size);
+    strings_ = l.strings;
+    dictionary_ = reader_.bytes(l.dictionary, l.dictionary_size);
+    for (std::uint64_t i = 0; i < frame_count_; ++i) {
+        reader_.bytes(frames_[i].offset, frames_[i].stored);
+        if (frames_[i].content > frames_[i].length)
+            throw Error(path + ": frame content out of bounds");
+    }
+    for (std::uint64_t i = 0; i < file_count_; ++i)
+        if (std::uint64_t(files_[i].first_frame) + files_[i].frame_count > frame_count_)
+            throw Error(path + ": file frames out of bounds");
+    for (std::uint64_t i = 0; i < path_count_; ++i)
+        if (by_path_[i] >= frame_count_)
+            throw Error(path + ": path table out of bounds");
+}
+
+CorpusArchive::~CorpusArchive() = default;
+CorpusArchive::CorpusArchive(CorpusArchive&&) noexcept = default;
+CorpusArchive& CorpusArchive::operator=(CorpusArchive&&) noexcept = default;
+
+const ArchiveFrame* CorpusArchive::find(std::string_view path) const {
+    const std::uint32_t* it = std::lower_bound(by_path_, by_path_ + path_count_, path,
+                                               [&](std::uint32_t id, std::string_view p) {
+                                                   return this->path(frames_[id]) < p;
+                                               });
+    return it != by_path_ + path_count_ && this->path(frames_[*it]) == path ? &frames_[*it] : nullptr;
+}
+
+void CorpusArchive::read(const ArchiveFrame& f, std::string& out) const {
+    std::string_view stored = reader_.bytes(f.offset, f.stored);
+    if (f.flags & kStored) {
+        out.assign(stored);
+        return;
+    }
+    if (!inflater_)
+        inflater_ = std::make_unique<Inflater>();
+    z_stream& z = inflater_->z;
+    inflateReset(&z);
+    if (!dictionary_.empty())
+        inflateSetDictionary(&z, reinterpret_cast<const Bytef*>(dictionary_.data()),
+                             static_cast<uInt>(dictionary_.size()));
+    out.resize(f.length);
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(stored.data()));
+    z.avail_in = f.stored;
+    z.next_out = reinterpret_cast<Bytef*>(out.data());
+    z.avail_out = f.length;
+    int rc = inflate(&z, Z_FINISH);
+    if (rc != Z_STREAM_END || z.avail_out != 0)
+        throw Error("corrupt archive frame for " + std::string(path(f)));
+}
+
+void CorpusArchive::read_text(const ArchiveFrame& f, std::string& out) const {
+    read(f, out);
+    out.erase(0, f.content);
+}
+
+} // namespace moby
@@ -0,0 +1,502 @@
+#include "moby/availability.h"
+
+#include "moby/lexer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <numeric>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+namespace {
+
+constexpr const char* kPlatformNames[kPlatformCount] = {"macos", "ios", "tvos", "watchos", "maccatalyst"};
+
+struct Alias {
+    std::string_view name;
+    Platform platform;
+};
+
+constexpr Alias kAliases[] = {
+    {"macos", Platform::MacOS},         {"macosx", Platform::MacOS},          {"osx", Platform::MacOS},
+    {"mac", Platform::MacOS},           {"ios", Platform::IOS},               {"iphoneos", Platform::IOS},
+    {"iphone", Platform::IOS},          {"tvos", Platform::TvOS},             {"watchos", Platform::WatchOS},
+    {"maccatalyst", Platform::MacCatalyst}, {"uikitformac", Platform::MacCatalyst},
+};
+
+// Prefixes of the <Availability.h> version constants, e.g. __MAC_10_5.
+constexpr Alias kVersionPrefixes[] = {
+    {"__MAC_", Platform::MacOS},
+    {"__IPHONE_", Platform::IOS},
+    {"__TVOS_", Platform::TvOS},
+    {"__WATCHOS_", Platform::WatchOS},
+};
+
+enum class MacroKind { Available, Deprecated, Obsoleted, Unavailable, None };
+
+bool contains(std::string_view s, std::string_view part) { return s.find(part) != std::string_view::npos; }
+
+MacroKind classify(std::string_view name) {
+    if (contains(name, "SWIFT") || contains(name, "EXTENSION") || name == "API_TO_BE_DEPRECATED" ||
+        (name.size() > 4 && name.substr(name.size() - 4) == "_END"))
+        return MacroKind::None;
+    if (contains(name, "UNAVAILABLE") || contains(name, "PROHIBITED"))
+        return MacroKind::Unavailable;
+    if (contains(name, "DEPRECATED"))
+        return MacroKind::Deprecated;
+    if (contains(name, "OBSOLETED"))
+        return MacroKind::Obsoleted;
+    if (contains(name, "AVAILABLE"))
+        return MacroKind::Available;
+    return MacroKind::None;
+}
+
+// Platform named by one of the '_'-separated words of a macro name, as in
+// NS_AVAILABLE_IOS or __TVOS_PROHIBITED.
+bool name_platform(std::string_view name, Platform& p) {
+    std::size_t i = 0;
+    while (i <= name.size()) {
+        std::size_t j = name.find('_', i);
+        if (j == std::string_view::npos)
+            j = name.size();
+        std::string_view word = name.substr(i, j - i);
+        if (word == "IOS" || word == "IPHONE") {
+            p = Platform::IOS;
+            return true;
+        }
+        if (word == "MAC" || word == "OSX" || word == "MACOS") {
+            p = Platform::MacOS;
+            return true;
+        }
+        if (word == "TVOS") {
+            p = Platform::TvOS;
+            return true;
+        }
+        if (word == "WATCHOS") {
+            p = Platform::WatchOS;
+            return true;
+        }
+        if (word == "MACCATALYST" || word == "UIKITFORMAC") {
+            p = Platform::MacCatalyst;
+            return true;
+        }
+        i = j + 1;
+    }
+    return false;
+}
+
+// Applies a sequence of versions (introduced, deprecated, obsoleted) for one
+// platform. "NA" as the introduced version marks the platform unavailable.
+void apply(PlatformAvailability& pa, MacroKind kind, const std::vector<std::string_view>& versions) {
+    if (kind == MacroKind::Unavailable) {
+        pa.unavailable = true;
+        return;
+    }
+    if (versions.empty())
+        return;
+    if (versions[0] == "NA") {
+        pa.unavailable = true;
+        return;
+    }
+    if (std::uint32_t v = parse_version(versions[0]))
+        pa.introduced = v;
+    if (kind == MacroKind::Available)
+        return;
+    if (versions.size() > 1 && versions[1] != "NA") {
+        std::uint32_t v = parse_version(versions[1]);
+        if (kind == MacroKind::Deprecated)
+            pa.deprecated = v;
+        else
+            pa.obsoleted = v;
+    }
+    if (versions.size() > 2 && versions[2] != "NA")
+        pa.obsoleted = parse_version(versions[2]);
+}
+
+class MacroParser {
+public:
+    MacroParser(std::string_view text) : text_(text), toks_(tokenize(text)) {}
+
+    void run(Availability& out) {
+        for (std::size_t i = 0; i < toks_.size(); ++i) {
+            if (is_punct(text_, toks_[i], '{')) {
+                i = skip_group(i) - 1;
+                continue;
+            }
+            if (toks_[i].kind != Tok::Ident)
+                continue;
+            std::string_view name = str(i);
+            MacroKind kind = classify(name);
+            if (kind == MacroKind::None)
+                continue;
+            if (i + 1 < toks_.size() && is_punct(text_, toks_[i + 1], '(')) {
+                std::size_t end = skip_group(i + 1);
+                macro(name, kind, i + 2, end - 1, out);
+                i = end - 1;
+            } else if (kind == MacroKind::Unavailable) {
+                Platform p;
+                if (name_platform(name, p)) {
+                    out[p].unavailable = true;
+                } else {
+                    for (auto& pa : out.platforms)
+                        pa.unavailable = true;  // NS_UNAVAILABLE: nowhere
+                }
+            }
+        }
+    }
+
+private:
+    std::string_view str(std::size_t i) const { return token_text(text_, toks_[i]); }
+
+    std::size_t skip_group(std::size_t i) const { return moby::skip_group(text_, toks_, i, toks_.size()); }
+
+    // Macro arguments are tokens [begin, end).
+    void macro(std::string_view name, MacroKind kind, std::size_t begin, std::size_t end, Availability& out) {
+        std::vector<std::string_view> positional;
+        std::vector<std::string_view> prefixed[kPlatformCount];
+        bool any_prefixed = false;
+
+        std::size_t i = begin;
+        while (i < end) {
+            std::size_t arg_end = i;
+            while (arg_end < end && !is_punct(text_, toks_[arg_end], ',')) {
+                if (is_punct(text_, toks_[arg_end], '('))
+                    arg_end = skip_group(arg_end);
+                else
+                    ++arg_end;
+            }
+            argument(kind, i, arg_end, out, positional, prefixed, any_prefixed);
+            i = arg_end + 1;
+        }
+
+        if (any_prefixed) {
+            for (int p = 0; p < kPlatformCount; ++p)
+                if (!prefixed[p].empty())
+                    apply(out.platforms[p], kind == MacroKind::Unavailable ? MacroKind::Available : kind,
+                          prefixed[p]);
+            return;
+        }
+        if (positional.empty())
+            return;
+
+        Platform p;
+        if (name_platform(name, p)) {
+            apply(out[p], kind, positional);
+            return;
+        }
+        // Generic positional forms: (mac, ios) or (mac_intro, mac_dep, ios_intro, ios_dep).
+        std::size_t per = kind == MacroKind::Available || positional.size() < 4 ? 1 : 2;
+        if (kind != MacroKind::Available && positional.size() == 2)
+            per = 2;
+        std::vector<std::string_view> mac(positional.begin(), positional.begin() + std::min(per, positional.size()));
+        apply(out[Platform::MacOS], kind, mac);
+        if (positional.size() >= 2 * per) {
+            std::vector<std::string_view> ios(positional.begin() + per, positional.begin() + 2 * per);
+            apply(out[Platform::IOS], kind, ios);
+        }
+    }
+
+    void argument(MacroKind kind, std::size_t i, std::size_t end, Availability& out,
+                  std::vector<std::string_view>& positional, std::vector<std::string_view>* prefixed,
+                  bool& any_prefixed) {
+        if (i >= end || toks_[i].kind == Tok::String)
+            return;
+        std::string_view first = str(i);
+        Platform p;
+
+        // Platform call: ios(11.0) or macos(10.4, 10.13).
+        if (toks_[i].kind == Tok::Ident && i + 1 < end && is_punct(text_, toks_[i + 1], '(')) {
+            if (!parse_platform(first, p))
+                return;
+            std::vector<std::string_view> versions;
+            for (std::size_t j = i + 2; j + 1 < end; ++j)
+                if (toks_[j].kind == Tok::Number || toks_[j].kind == Tok::Ident)
+                    versions.push_back(str(j));
+            apply(out[p], kind, versions);
+            return;
+        }
+        // Bare platform: API_UNAVAILABLE(ios, watchos).
+        if (toks_[i].kind == Tok::Ident && i + 1 == end && parse_platform(first, p)) {
+            if (kind == MacroKind::Unavailable)
+                out[p].unavailable = true;
+            return;
+        }
+        // Version constants: __MAC_10_5, __IPHONE_NA.
+        for (const Alias& prefix : kVersionPrefixes) {
+            if (first.size() > prefix.name.size() && first.substr(0, prefix.name.size()) == prefix.name) {
+                prefixed[static_cast<int>(prefix.platform)].push_back(first.substr(prefix.name.size()));
+                any_prefixed = true;
+                return;
+            }
+        }
+        positional.push_back(first);
+    }
+
+    std::string_view text_;
+    std::vector<Token> toks_;
+};
+
+struct MatrixLayout {
+    std::uint64_t symbol_count;
+    std::uint64_t word_count;
+    std::uint64_t introduced[kPlatformCount];
+    std::uint64_t deprecated[kPlatformCount];
+    std::uint64_t obsoleted[kPlatformCount];
+    std::uint64_t unavailable[kPlatformCount];
+    std::uint64_t annotated[kPlatformCount];
+};
+
+bool is_container(SymbolKind k) {
+    return k == SymbolKind::Interface || k == SymbolKind::Category || k == SymbolKind::Protocol ||
+           k == SymbolKind::Enum || k == SymbolKind::Struct || k == SymbolKind::Union;
+}
+
+} // namespace
+
+const char* platform_name(Platform p) { return kPlatformNames[static_cast<int>(p)]; }
+
+bool parse_platform(std::string_view name, Platform& p) {
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    for (const Alias& a : kAliases) {
+        if (lower == a.name) {
+            p = a.platform;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::uint32_t parse_version(std::string_view text) {
+    if (text == "API_TO_BE_DEPRECATED")
+        return kVersionFuture;
+    std::uint32_t parts[3] = {0, 0, 0};
+    int n = 0;
+    bool digits = false;
+    for (char c : text) {
+        if (c >= '0' && c <= '9') {
+            parts[n] = parts[n] * 10 + static_cast<std::uint32_t>(c - '0');
+            digits = true;
+        } else if ((c == '.' || c == '_') && digits && n < 2) {
+            ++n;
+            digits = false;
+        } else {
+            return 0;
+        }
+    }
+    if (!digits && n == 0)
+        return 0;
+    return std::min<std::uint32_t>(parts[0], 0xFF) << 16 | std::min<std::uint32_t>(parts[1], 0xFF) << 8 |
+           std::min<std::uint32_t>(parts[2], 0xFF);
+}
+
+std::string format_version(std::uint32_t v) {
+    if (v == kVersionFuture)
+        return "future";
+    std::string s = std::to_string(v >> 16) + "." + std::to_string(v >> 8 & 0xFF);
+    if (v & 0xFF)
+        s += "." + std::to_string(v & 0xFF);
+    return s;
+}
+
+void Availability::inherit(const Availability& outer) {
+    for (int p = 0; p < kPlatformCount; ++p)
+        if (!platforms[p].annotated())
+            platforms[p] = outer.platforms[p];
+}
+
+void parse_availability(std::string_view decl, Availability& out) { MacroParser(decl).run(out); }
+
+std::string_view annotation_text(SymbolKind kind, std::string_view decl) {
+    if (kind != SymbolKind::Interface && kind != SymbolKind::Category && kind != SymbolKind::Protocol)
+        return decl;
+    std::size_t at = decl.find(kind == SymbolKind::Protocol ? "@protocol" : "@interface");
+    if (at == std::string_view::npos)
+        return decl;
+    std::size_t eol = decl.find('\n', at);
+    return eol == std::string_view::npos ? decl : decl.substr(0, eol);
+}
+
+std::string AvailabilityMatrix::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "availability.mat").string();
+}
+
+void section_availability(const Section& section, const std::vector<Symbol>& symbols, std::vector<Availability>& out) {
+    std::size_t first = out.size();
+    out.resize(first + symbols.size());
+    Availability* avail = out.data() + first;
+    std::string_view file = std::string_view(section.text.data() - section.offset, section.offset + section.text.size());
+    std::vector<std::uint32_t> ids(symbols.size());
+    for (std::uint32_t i = 0; i < symbols.size(); ++i) {
+        const Symbol& s = symbols[i];
+        parse_availability(annotation_text(s.kind, file.substr(s.offset, s.length)), avail[i]);
+        ids[i] = i;
+    }
+
+    // Inheritance: API_AVAILABLE_BEGIN(...) / API_AVAILABLE_END regions, then
+    // the innermost enclosing class, protocol, enum or struct.
+    std::sort(ids.begin(), ids.end(), [&](std::uint32_t a, std::uint32_t b) {
+        const Symbol &sa = symbols[a], &sb = symbols[b];
+        return sa.offset != sb.offset ? sa.offset < sb.offset : sa.length > sb.length;
+    });
+
+    struct Region {
+        std::uint64_t begin, end;
+        Availability avail;
+    };
+    std::vector<Region> regions;
+    constexpr std::string_view kBegin = "API_AVAILABLE_BEGIN", kEnd = "API_AVAILABLE_END";
+    std::vector<Token> toks;
+    if (section.text.find(kBegin) != std::string_view::npos)
+        toks = tokenize(section.text);
+    for (std::size_t i = 0; i + 1 < toks.size(); ++i) {
+        if (token_text(section.text, toks[i]) != kBegin || !is_punct(section.text, toks[i + 1], '('))
+            continue;
+        std::size_t after = skip_group(section.text, toks, i + 1, toks.size());
+        if (after == toks.size() && !is_punct(section.text, toks.back(), ')'))
+            break;
+        std::size_t end = after;
+        while (end < toks.size() && token_text(section.text, toks[end]) != kEnd)
+            ++end;
+        std::size_t at = toks[i].offset;
+        Region region{section.offset + at,
+                      section.offset + (end == toks.size() ? section.text.size() : toks[end].offset), {}};
+        parse_availability(section.text.substr(at, toks[after - 1].offset + 1 - at), region.avail);
+        regions.push_back(region);
+    }
+
+    std::vector<std::uint32_t> stack;
+    for (std::uint32_t id : ids) {
+        const Symbol& s = symbols[id];
+        for (const Region& region : regions)
+            if (s.offset >= region.begin && s.offset < region.end)
+                avail[id].inherit(region.avail);
+        while (!stack.empty() && symbols[stack.back()].offset + symbols[stack.back()].length <= s.offset)
+            stack.pop_back();
+        if (!stack.empty())
+            avail[id].inherit(avail[stack.back()]);
+        if (is_container(s.kind))
+            stack.push_back(id);
+    }
+}
+
+void AvailabilityMatrix::build(const Corpus& corpus, const SymbolDb& db, const std::string& path) {
+    // Per section, the declaration spans of its symbols; names are not needed.
+    std::vector<std::vector<Symbol>> spans(corpus.sections().size());
+    std::vector<std::vector<std::uint32_t>> ids(corpus.sections().size());
+    for (std::uint32_t id = 0; id < db.size(); ++id) {
+        const SymbolRecord& r = db.at(id);
+        spans[r.section].push_back({{}, {}, r.kind, r.section, r.offset, r.length});
+        ids[r.section].push_back(id);
+    }
+    std::vector<Availability> avail(db.size());
+    std::vector<Availability> part;
+    for (std::size_t s = 0; s < spans.size(); ++s) {
+        part.clear();
+        section_availability(corpus.sections()[s], spans[s], part);
+        for (std::size_t i = 0; i < part.size(); ++i)
+            avail[ids[s][i]] = part[i];
+    }
+    write(db.corpus_hash(), avail, path);
+}
+
+void AvailabilityMatrix::write(std::uint64_t corpus_hash, const std::vector<Availability>& avail,
+                               const std::string& path) {
+    std::size_t n = avail.size();
+    std::size_t words = (n + 63) / 64;
+    BlobWriter w(kMagic, kVersion, corpus_hash);
+    std::size_t layout_at = w.put(MatrixLayout{});
+    MatrixLayout layout{};
+    layout.symbol_count = n;
+    layout.word_count = words;
+    for (int p = 0; p < kPlatformCount; ++p) {
+        std::vector<std::uint32_t> introduced(n), deprecated(n), obsoleted(n);
+        std::vector<std::uint64_t> unavailable(words), annotated(words);
+        for (std::size_t id = 0; id < n; ++id) {
+            const PlatformAvailability& pa = avail[id].platforms[p];
+            introduced[id] = pa.introduced;
+            deprecated[id] = pa.deprecated;
+            obsoleted[id] = pa.obsoleted;
+            if (pa.unavailable)
+                unavailable[id >> 6] |= std::uint64_t(1) << (id & 63);
+            if (pa.annotated())
+                annotated[id >> 6] |= std::uint64_t(1) << (id & 63);
+        }
+        layout.introduced[p] = w.put_array(introduced);
+        layout.deprecated[p] = w.put_array(deprecated);
+        layout.obsoleted[p] = w.put_array(obsoleted);
+        layout.unavailable[p] = w.put_array(unavailable);
+        layout.annotated[p] = w.put_array(annotated);
+    }
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+}
+
+AvailabilityMatrix::AvailabilityMatrix(const std::string& path) : reader_(path, kMagic, kVersion) {
+    const MatrixLayout& l = *reader_.array<MatrixLayout>(sizeof(BlobHeader), 1);
+    size_ = l.symbol_count;
+    for (int p = 0; p < kPlatformCount; ++p) {
+        columns_[p].introduced = reader_.array<std::uint32_t>(l.introduced[p], size_);
+        columns_[p].deprecated = reader_.array<std::uint32_t>(l.deprecated[p], size_);
+        columns_[p].obsoleted = reader_.array<std::uint32_t>(l.obsoleted[p], size_);
+        columns_[p].unavailable = reader_.array<std::uint64_t>(l.unavailable[p], l.word_count);
+        columns_[p].annotated = reader_.array<std::uint64_t>(l.annotated[p], l.word_count);
+    }
+}
+
+PlatformAvailability AvailabilityMatrix::get(std::size_t id, Platform p) const {
+    const Columns& c = columns_[static_cast<int>(p)];
+    PlatformAvailability pa;
+    pa.introduced = c.introduced[id];
+    pa.deprecated = c.deprecated[id];
+    pa.obsoleted = c.obsoleted[id];
+    pa.unavailable = c.unavailable[id >> 6] >> (id & 63) & 1;
+    return pa;
+}
+
+namespace {
+
+// Bitset of ids whose column value v satisfies 0 < v <= version, built 64
+// rows at a time so the comparison loop vectorizes.
+Bitset column_at_most(const std::uint32_t* column, std::size_t n, std::uint32_t version) {
+    Bitset out(n);
+    std::uint64_t* words = out.words();
+    std::size_t full = n / 64;
+    for (std::size_t w = 0; w < full; ++w) {
+        const std::uint32_t* v = column + w * 64;
+        std::uint64_t bits = 0;
+        for (int b = 0; b < 64; ++b)
+            bits |= static_cast<std::uint64_t>((v[b] - 1u) < version) << b;
+        words[w] = bits;
+    }
+    for (std::size_t i = full * 64; i < n; ++i)
+        if (column[i] - 1u < version)
+            out.set(i);
+    return out;
+}
+
+} // namespace
+
+Bitset AvailabilityMatrix::available(Platform p, std::uint32_t version) const {
+    const Columns& c = columns_[static_cast<int>(p)];
+    Bitset out = column_at_most(c.introduced, size_, version);
+    return out.subtract(Bitset(c.unavailable, size_));
+}
+
+Bitset AvailabilityMatrix::unavailable(Platform p) const {
+    return Bitset(columns_[static_cast<int>(p)].unavailable, size_);
+}
+
+Bitset AvailabilityMatrix::deprecated(Platform p, std::uint32_t version) const {
+    return column_at_most(columns_[static_cast<int>(p)].deprecated, size_, version);
+}
+
+Bitset AvailabilityMatrix::annotated(Platform p) const {
+    return Bitset(columns_[static_cast<int>(p)].annotated, size_);
+}
+
+} // namespace moby
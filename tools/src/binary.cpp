@@ -0,0 +1,102 @@
+#include "moby/binary.h"
+
+#include "moby/hash.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+
+namespace moby {
+
+BlobWriter::BlobWriter(std::string_view magic, std::uint32_t version, std::uint64_t corpus_hash) {
+    BlobHeader header{};
+    std::memcpy(header.magic, magic.data(), std::min<std::size_t>(magic.size(), sizeof header.magic));
+    header.version = version;
+    header.corpus_hash = corpus_hash;
+    put(header);
+}
+
+std::size_t BlobWriter::put_bytes(const void* data, std::size_t n) {
+    std::size_t offset = buf_.size();
+    buf_.append(static_cast<const char*>(data), n);
+    return offset;
+}
+
+void BlobWriter::align(std::size_t n) {
+    buf_.resize((buf_.size() + n - 1) / n * n, '\0');
+}
+
+std::string BlobWriter::finish() {
+    align(8);
+    patch(offsetof(BlobHeader, size), static_cast<std::uint64_t>(buf_.size()));
+    return std::move(buf_);
+}
+
+void BlobWriter::write_file(const std::string& path) {
+    std::string data = finish();
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw Error("cannot create " + tmp);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out)
+            throw Error("cannot write " + tmp);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0)
+        throw Error("cannot rename " + tmp + " to " + path);
+}
+
+namespace {
+
+constexpr std::uint32_t kEmptySlot = 0xFFFFFFFF;
+
+} // namespace
+
+StrRef StringPool::add(std::string_view s) {
+    if ((used_ + 1) * 2 > slots_.size())
+        grow();
+    std::uint64_t h = hash64(s);
+    std::size_t mask = slots_.size() - 1;
+    for (std::size_t i = h & mask;; i = (i + 1) & mask) {
+        Slot& slot = slots_[i];
+        if (slot.ref.length == kEmptySlot) {
+            slot = {h, {static_cast<std::uint32_t>(data_.size()), static_cast<std::uint32_t>(s.size())}};
+            data_.append(s);
+            ++used_;
+            return slot.ref;
+        }
+        if (slot.hash == h && std::string_view(data_).substr(slot.ref.offset, slot.ref.length) == s)
+            return slot.ref;
+    }
+}
+
+void StringPool::grow() {
+    std::vector<Slot> old = std::move(slots_);
+    slots_.assign(old.empty() ? 1024 : old.size() * 2, Slot{0, {0, kEmptySlot}});
+    std::size_t mask = slots_.size() - 1;
+    for (const Slot& slot : old) {
+        if (slot.ref.length == kEmptySlot)
+            continue;
+        std::size_t i = slot.hash & mask;
+        while (slots_[i].ref.length != kEmptySlot)
+            i = (i + 1) & mask;
+        slots_[i] = slot;
+    }
+}
+
+BlobReader::BlobReader(const std::string& path, std::string_view magic, std::uint32_t version)
+    : map_(path) {
+    if (map_.size() < sizeof(BlobHeader))
+        throw Error(path + ": file too small");
+    const BlobHeader& h = header();
+    if (std::string_view(h.magic, std::min(magic.size(), sizeof h.magic)) != magic)
+        throw Error(path + ": not a " + std::string(magic) + " file");
+    if (h.version != version)
+        throw Error(path + ": unsupported version " + std::to_string(h.version));
+    if (h.size != map_.size())
+        throw Error(path + ": truncated");
+}
+
+} // namespace moby
@@ -0,0 +1,510 @@
+#include "moby/class_graph.h"
+
+#include "moby/hash.h"
+#include "moby/lexer.h"
+#include "moby/perfect_hash.h"
+#include "moby/section_index.h"
+#include "moby/work_pool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <numeric>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+namespace {
+
+struct GraphLayout {
+    std::uint64_t node_count;
+    std::uint64_t unit_count;
+    std::uint64_t method_count;
+    std::uint64_t selector_count;
+    std::uint64_t adopted_count;
+    std::uint64_t conformance_count;
+    std::uint64_t responder_count;
+    std::uint64_t node_buckets, node_slot_count;
+    std::uint64_t selector_buckets, selector_slot_count;
+    std::uint64_t nodes;
+    std::uint64_t units;
+    std::uint64_t methods;
+    std::uint64_t selectors;
+    std::uint64_t adopted;
+    std::uint64_t conformances;
+    std::uint64_t responders;
+    std::uint64_t responder_keys;
+    std::uint64_t declarers;
+    std::uint64_t node_displacements, node_slots;
+    std::uint64_t selector_displacements, selector_slots;
+    std::uint64_t strings;
+    std::uint64_t strings_size;
+};
+
+std::uint64_t node_hash(std::string_view name, std::uint8_t kind) { return hash64(name, kind); }
+
+std::uint32_t responder_key(std::uint32_t selector, SymbolKind kind) {
+    return selector << 1 | (kind == SymbolKind::ClassMethod);
+}
+
+struct PendingMethod {
+    std::string selector;
+    SymbolKind kind;
+    std::uint8_t flags;
+    std::uint64_t offset;
+    std::uint32_t length;
+};
+
+// An @interface, category or @protocol and the symbols declared inside it.
+struct PendingUnit {
+    const Symbol* symbol;
+    std::vector<std::uint32_t> members;  // into the symbol list
+    std::vector<std::string> adopted;
+    std::vector<PendingMethod> methods;
+    std::uint32_t node = 0;
+};
+
+// Reads the parts of a unit's text the symbol extractor does not keep: the
+// adopted protocol list, @optional sections and @property attributes.
+class UnitReader {
+public:
+    UnitReader(std::string_view text, std::uint64_t base) : text_(text), base_(base), toks_(tokenize(text)) {}
+
+    void read(PendingUnit& unit, const std::vector<Symbol>& symbols);
+
+private:
+    std::size_t size() const { return toks_.size(); }
+    std::string_view str(std::size_t i) const { return i < size() ? token_text(text_, toks_[i]) : std::string_view(); }
+    bool punct(std::size_t i, char c) const { return i < size() && is_punct(text_, toks_[i], c); }
+    bool ident(std::size_t i) const { return i < size() && toks_[i].kind == Tok::Ident; }
+
+    std::size_t token_at(std::uint64_t offset) const { return moby::token_at(toks_, offset - base_); }
+    void add_property(PendingUnit& unit, const Symbol& sym);
+
+    std::string_view text_;
+    std::uint64_t base_;
+    std::vector<Token> toks_;
+};
+
+// Getter and, unless readonly, setter of @property `sym`, honouring class,
+// getter= and setter= attributes.
+void UnitReader::add_property(PendingUnit& unit, const Symbol& sym) {
+    std::size_t i = token_at(sym.offset);
+    bool readonly = false, class_side = false;
+    std::string getter = sym.name;
+    std::string setter = "set" + sym.name + ":";
+    setter[3] = static_cast<char>(std::toupper(static_cast<unsigned char>(setter[3])));
+    if (str(i) == "@property" && punct(i + 1, '(')) {
+        for (i += 2; i < size() && !punct(i, ')'); ++i) {
+            std::string_view s = str(i);
+            if (s == "readonly")
+                readonly = true;
+            else if (s == "class")
+                class_side = true;
+            else if ((s == "getter" || s == "setter") && punct(i + 1, '=') && ident(i + 2)) {
+                std::string& accessor = s == "getter" ? getter : setter;
+                accessor = std::string(str(i + 2));
+                if (s == "setter")
+                    accessor.push_back(':');
+                i += 2 + (s == "setter" && punct(i + 3, ':'));
+            }
+        }
+    }
+    SymbolKind kind = class_side ? SymbolKind::ClassMethod : SymbolKind::InstanceMethod;
+    unit.methods.push_back({getter, kind, MethodRecord::kProperty, sym.offset, sym.length});
+    if (!readonly)
+        unit.methods.push_back({setter, kind, MethodRecord::kProperty, sym.offset, sym.length});
+}
+
+void UnitReader::read(PendingUnit& unit, const std::vector<Symbol>& symbols) {
+    UnitHeader header = read_unit_header(text_, toks_, token_at(unit.symbol->offset), size());
+    for (std::string& n : header.protocols)
+        if (std::find(unit.adopted.begin(), unit.adopted.end(), n) == unit.adopted.end())
+            unit.adopted.push_back(std::move(n));
+    // Offsets at which @optional or @required switch protocol sections.
+    std::vector<std::pair<std::uint64_t, bool>> sections;
+    if (unit.symbol->kind == SymbolKind::Protocol)
+        for (const Token& t : toks_) {
+            std::string_view s = token_text(text_, t);
+            if (s == "@optional" || s == "@required")
+                sections.emplace_back(base_ + t.offset, s == "@optional");
+        }
+    for (std::uint32_t k : unit.members) {
+        const Symbol& sym = symbols[k];
+        std::size_t before = unit.methods.size();
+        if (sym.kind == SymbolKind::Property)
+            add_property(unit, sym);
+        else
+            unit.methods.push_back({sym.name, sym.kind, 0, sym.offset, sym.length});
+        auto it = std::upper_bound(sections.begin(), sections.end(), std::make_pair(sym.offset, true));
+        if (it != sections.begin() && std::prev(it)->second)
+            for (std::size_t m = before; m < unit.methods.size(); ++m)
+                unit.methods[m].flags |= MethodRecord::kOptional;
+    }
+    // Both arms of an #if may declare the same method; keep the first.
+    std::vector<PendingMethod> kept;
+    for (PendingMethod& m : unit.methods)
+        if (std::none_of(kept.begin(), kept.end(), [&](const PendingMethod& k) {
+                return k.kind == m.kind && k.selector == m.selector;
+            }))
+            kept.push_back(std::move(m));
+    unit.methods.swap(kept);
+}
+
+bool is_unit(SymbolKind k) {
+    return k == SymbolKind::Interface || k == SymbolKind::Category || k == SymbolKind::Protocol;
+}
+
+bool is_member(SymbolKind k) {
+    return k == SymbolKind::InstanceMethod || k == SymbolKind::ClassMethod || k == SymbolKind::Property;
+}
+
+struct PendingNode {
+    std::string name;
+    std::uint8_t flags;
+    std::string super;
+    std::vector<std::uint32_t> units;
+};
+
+// Flattened conformances and responder tables, computed once per node.
+class Flattener {
+public:
+    Flattener(const std::vector<PendingNode>& nodes, const std::vector<std::vector<std::uint32_t>>& adopted,
+              const std::vector<std::uint32_t>& supers, const std::vector<std::vector<std::uint32_t>>& own,
+              const std::vector<std::uint32_t>& keys)
+        : adopted_(adopted), supers_(supers), own_(own), keys_(keys), state_(nodes.size()),
+          protocols_(nodes.size()), responders_(nodes.size()), depth_(nodes.size()) {}
+
+    void visit(std::uint32_t n);
+
+    const std::vector<std::uint32_t>& protocols(std::uint32_t n) const { return protocols_[n]; }
+    const std::vector<std::uint32_t>& responders(std::uint32_t n) const { return responders_[n]; }
+    std::uint8_t depth(std::uint32_t n) const { return depth_[n]; }
+
+private:
+    const std::vector<std::vector<std::uint32_t>>& adopted_;  // protocols a node's units list
+    const std::vector<std::uint32_t>& supers_;
+    const std::vector<std::vector<std::uint32_t>>& own_;      // methods a node's units declare
+    const std::vector<std::uint32_t>& keys_;                  // responder key per method
+    std::vector<std::uint8_t> state_;                         // 0 new, 1 in progress, 2 done
+    std::vector<std::vector<std::uint32_t>> protocols_;
+    std::vector<std::vector<std::uint32_t>> responders_;
+    std::vector<std::uint8_t> depth_;
+};
+
+// Nearest declaration wins: the node's own units, then its protocols in the
+// order they are listed, then the superclass. A cycle (which valid headers
+// cannot form) is cut where it closes.
+void Flattener::visit(std::uint32_t n) {
+    if (state_[n])
+        return;
+    state_[n] = 1;
+    std::vector<std::uint32_t> candidates = own_[n];
+    std::vector<std::uint32_t> protocols = adopted_[n];
+    auto inherit = [&](std::uint32_t from) {
+        visit(from);
+        candidates.insert(candidates.end(), responders_[from].begin(), responders_[from].end());
+        protocols.insert(protocols.end(), protocols_[from].begin(), protocols_[from].end());
+    };
+    for (std::uint32_t p : adopted_[n])
+        inherit(p);
+    if (supers_[n] != ClassNode::kNone) {
+        inherit(supers_[n]);
+        depth_[n] = static_cast<std::uint8_t>(std::min(depth_[supers_[n]] + 1, 255));
+    }
+
+    std::sort(protocols.begin(), protocols.end());
+    protocols.erase(std::unique(protocols.begin(), protocols.end()), protocols.end());
+    protocols_[n] = std::move(protocols);
+
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return keys_[a] < keys_[b]; });
+    std::vector<std::uint32_t>& out = responders_[n];
+    for (std::uint32_t m : candidates)
+        if (out.empty() || keys_[out.back()] != keys_[m])
+            out.push_back(m);
+    state_[n] = 2;
+}
+
+} // namespace
+
+std::string ClassGraph::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "classes.graph").string();
+}
+
+ClassGraphStats ClassGraph::build(const Corpus& corpus, const std::vector<Symbol>& symbols, const std::string& path,
+                                  unsigned threads) {
+    // Units and the members inside their extent. The extractor emits a unit
+    // before its members and extends its length through @end.
+    std::vector<PendingUnit> units;
+    for (std::size_t k = 0; k < symbols.size(); ++k) {
+        const Symbol& sym = symbols[k];
+        if (is_unit(sym.kind)) {
+            units.push_back({&sym, {}, {}, {}});
+        } else if (is_member(sym.kind) && !units.empty()) {
+            PendingUnit& u = units.back();
+            if (sym.section == u.symbol->section && sym.offset < u.symbol->offset + u.symbol->length)
+                u.members.push_back(static_cast<std::uint32_t>(k));
+        }
+    }
+
+    std::vector<std::uint32_t> tasks(units.size());
+    std::iota(tasks.begin(), tasks.end(), 0);
+    std::stable_sort(tasks.begin(), tasks.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return units[a].symbol->length > units[b].symbol->length; });
+    run_stealing(tasks, threads, [&](std::uint32_t i) {
+        const Symbol& sym = *units[i].symbol;
+        const CorpusFile& file = corpus.files()[corpus.sections()[sym.section].file];
+        UnitReader(std::string_view(file.map.data() + sym.offset, sym.length), sym.offset).read(units[i], symbols);
+    });
+
+    // Nodes: every class and protocol declared or named. A class seen only
+    // through categories or as a superclass is external.
+    std::vector<PendingNode> nodes;
+    std::unordered_map<std::string, std::uint32_t> ids[2];
+    auto node = [&](const std::string& name, std::uint8_t kind) {
+        auto [it, added] = ids[kind].emplace(name, static_cast<std::uint32_t>(nodes.size()));
+        if (added)
+            nodes.push_back({name, static_cast<std::uint8_t>(kind | ClassNode::kExternal), {}, {}});
+        return it->second;
+    };
+    for (std::uint32_t i = 0; i < units.size(); ++i) {
+        const Symbol& sym = *units[i].symbol;
+        bool protocol = sym.kind == SymbolKind::Protocol;
+        std::uint32_t n = node(sym.kind == SymbolKind::Category ? sym.parent : sym.name, protocol);
+        units[i].node = n;
+        nodes[n].units.push_back(i);
+        if (sym.kind != SymbolKind::Category)
+            nodes[n].flags &= ~ClassNode::kExternal;
+        if (sym.kind == SymbolKind::Interface && nodes[n].super.empty())
+            nodes[n].super = sym.parent;
+    }
+    for (std::uint32_t i = 0; i < units.size(); ++i)
+        for (const std::string& p : units[i].adopted)
+            node(p, ClassNode::kProtocol);
+    for (std::uint32_t n = 0; n < nodes.size(); ++n)
+        if (!nodes[n].super.empty())
+            node(nodes[n].super, 0);
+
+    // Final order: nodes by name, units by node then corpus order, methods by
+    // unit; selectors by name.
+    std::vector<std::uint32_t> node_order(nodes.size()), node_id(nodes.size());
+    std::iota(node_order.begin(), node_order.end(), 0);
+    std::sort(node_order.begin(), node_order.end(), [&](std::uint32_t a, std::uint32_t b) {
+        return nodes[a].name != nodes[b].name ? nodes[a].name < nodes[b].name : nodes[a].flags < nodes[b].flags;
+    });
+    for (std::uint32_t i = 0; i < node_order.size(); ++i)
+        node_id[node_order[i]] = i;
+
+    std::vector<std::string_view> selector_names;
+    for (const PendingUnit& u : units)
+        for (const PendingMethod& m : u.methods)
+            selector_names.push_back(m.selector);
+    std::sort(selector_names.begin(), selector_names.end());
+    selector_names.erase(std::unique(selector_names.begin(), selector_names.end()), selector_names.end());
+    auto selector_id = [&](std::string_view s) {
+        return static_cast<std::uint32_t>(std::lower_bound(selector_names.begin(), selector_names.end(), s) -
+                                          selector_names.begin());
+    };
+
+    ClassGraphStats stats;
+    StringPool strings;
+    std::vector<ClassNode> node_records(nodes.size());
+    std::vector<UnitRecord> unit_records;
+    std::vector<MethodRecord> methods;
+    std::vector<std::uint32_t> adopted_ids, keys;
+    std::vector<std::uint32_t> supers(nodes.size(), ClassNode::kNone);
+    std::vector<std::vector<std::uint32_t>> node_adopted(nodes.size()), own(nodes.size());
+    for (std::uint32_t id = 0; id < nodes.size(); ++id) {
+        const PendingNode& pn = nodes[node_order[id]];
+        ClassNode& r = node_records[id];
+        r.name = strings.add(pn.name);
+        r.flags = pn.flags;
+        r.first_unit = static_cast<std::uint32_t>(unit_records.size());
+        r.unit_count = static_cast<std::uint32_t>(pn.units.size());
+        if (!pn.super.empty())
+            supers[id] = node_id[ids[0].at(pn.super)];
+        if (pn.flags & ClassNode::kExternal)
+            ++stats.external;
+        else if (pn.flags & ClassNode::kProtocol)
+            ++stats.protocols;
+        else
+            ++stats.classes;
+        for (std::uint32_t ui : pn.units) {
+            const PendingUnit& u = units[ui];
+            UnitRecord ur{};
+            ur.name = strings.add(u.symbol->name);
+            ur.node = id;
+            ur.section = u.symbol->section;
+            ur.first_method = static_cast<std::uint32_t>(methods.size());
+            ur.method_count = static_cast<std::uint32_t>(u.methods.size());
+            ur.first_adopted = static_cast<std::uint32_t>(adopted_ids.size());
+            ur.adopted_count = static_cast<std::uint32_t>(u.adopted.size());
+            for (const std::string& p : u.adopted) {
+                std::uint32_t pid = node_id[ids[1].at(p)];
+                adopted_ids.push_back(pid);
+                if (std::find(node_adopted[id].begin(), node_adopted[id].end(), pid) == node_adopted[id].end())
+                    node_adopted[id].push_back(pid);
+            }
+            for (const PendingMethod& m : u.methods) {
+                MethodRecord mr{};
+                mr.selector = selector_id(m.selector);
+                mr.unit = static_cast<std::uint32_t>(unit_records.size());
+                mr.offset = m.offset;
+                mr.length = m.length;
+                mr.kind = m.kind;
+                mr.flags = m.flags;
+                own[id].push_back(static_cast<std::uint32_t>(methods.size()));
+                keys.push_back(responder_key(mr.selector, mr.kind));
+                stats.accessors += (m.flags & MethodRecord::kProperty) != 0;
+                methods.push_back(mr);
+            }
+            stats.categories += u.symbol->kind == SymbolKind::Category;
+            unit_records.push_back(ur);
+        }
+    }
+    stats.methods = methods.size();
+    stats.selectors = selector_names.size();
+
+    Flattener flat(nodes, node_adopted, supers, own, keys);
+    std::vector<std::uint32_t> conformances, responders, responder_keys;
+    for (std::uint32_t id = 0; id < nodes.size(); ++id) {
+        flat.visit(id);
+        ClassNode& r = node_records[id];
+        r.super = supers[id];
+        r.depth = flat.depth(id);
+        r.first_protocol = static_cast<std::uint32_t>(conformances.size());
+        r.protocol_count = static_cast<std::uint32_t>(flat.protocols(id).size());
+        conformances.insert(conformances.end(), flat.protocols(id).begin(), flat.protocols(id).end());
+        r.first_responder = static_cast<std::uint32_t>(responders.size());
+        r.responder_count = static_cast<std::uint32_t>(flat.responders(id).size());
+        for (std::uint32_t m : flat.responders(id)) {
+            responders.push_back(m);
+            responder_keys.push_back(keys[m]);
+        }
+    }
+    stats.responders = responders.size();
+
+    std::vector<SelectorRecord> selectors(selector_names.size());
+    std::vector<std::uint64_t> selector_hashes;
+    for (std::uint32_t s = 0; s < selector_names.size(); ++s) {
+        selectors[s].name = strings.add(selector_names[s]);
+        selector_hashes.push_back(hash64(selector_names[s]));
+    }
+    std::vector<std::uint32_t> declarers(methods.size());
+    std::iota(declarers.begin(), declarers.end(), 0);
+    std::stable_sort(declarers.begin(), declarers.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return methods[a].selector < methods[b].selector; });
+    for (std::uint32_t i = 0; i < declarers.size(); ++i) {
+        SelectorRecord& s = selectors[methods[declarers[i]].selector];
+        if (s.count++ == 0)
+            s.first = i;
+    }
+
+    std::vector<std::uint64_t> node_hashes;
+    for (std::uint32_t id = 0; id < nodes.size(); ++id)
+        node_hashes.push_back(node_hash(nodes[node_order[id]].name, nodes[node_order[id]].flags & ClassNode::kProtocol));
+    PerfectHash node_ph = PerfectHash::build(node_hashes);
+    PerfectHash selector_ph = PerfectHash::build(selector_hashes);
+
+    BlobWriter w(kMagic, kVersion, moby::corpus_hash(corpus));
+    std::size_t layout_at = w.put(GraphLayout{});
+    GraphLayout layout{};
+    layout.node_count = node_records.size();
+    layout.unit_count = unit_records.size();
+    layout.method_count = methods.size();
+    layout.selector_count = selectors.size();
+    layout.adopted_count = adopted_ids.size();
+    layout.conformance_count = conformances.size();
+    layout.responder_count = responders.size();
+    layout.node_buckets = node_ph.displacements.size();
+    layout.node_slot_count = node_ph.slots.size();
+    layout.selector_buckets = selector_ph.displacements.size();
+    layout.selector_slot_count = selector_ph.slots.size();
+    layout.nodes = w.put_array(node_records);
+    layout.units = w.put_array(unit_records);
+    layout.methods = w.put_array(methods);
+    layout.selectors = w.put_array(selectors);
+    layout.adopted = w.put_array(adopted_ids);
+    layout.conformances = w.put_array(conformances);
+    layout.responders = w.put_array(responders);
+    layout.responder_keys = w.put_array(responder_keys);
+    layout.declarers = w.put_array(declarers);
+    layout.node_displacements = w.put_array(node_ph.displacements);
+    layout.node_slots = w.put_array(node_ph.slots);
+    layout.selector_displacements = w.put_array(selector_ph.displacements);
+    layout.selector_slots = w.put_array(selector_ph.slots);
+    layout.strings = w.put_bytes(strings.data().data(), strings.data().size());
+    layout.strings_size = strings.data().size();
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+    return stats;
+}
+
+ClassGraph::ClassGraph(const std::string& path) : reader_(path, kMagic, kVersion) {
+    const GraphLayout& l = *reader_.array<GraphLayout>(sizeof(BlobHeader), 1);
+    node_count_ = l.node_count;
+    unit_count_ = l.unit_count;
+    method_count_ = l.method_count;
+    selector_count_ = l.selector_count;
+    node_buckets_ = l.node_buckets;
+    node_slot_count_ = l.node_slot_count;
+    selector_buckets_ = l.selector_buckets;
+    selector_slot_count_ = l.selector_slot_count;
+    nodes_ = reader_.array<ClassNode>(l.nodes, l.node_count);
+    units_ = reader_.array<UnitRecord>(l.units, l.unit_count);
+    methods_ = reader_.array<MethodRecord>(l.methods, l.method_count);
+    selectors_ = reader_.array<SelectorRecord>(l.selectors, l.selector_count);
+    adopted_ = reader_.array<std::uint32_t>(l.adopted, l.adopted_count);
+    conformances_ = reader_.array<std::uint32_t>(l.conformances, l.conformance_count);
+    responders_ = reader_.array<std::uint32_t>(l.responders, l.responder_count);
+    responder_keys_ = reader_.array<std::uint32_t>(l.responder_keys, l.responder_count);
+    declarers_ = reader_.array<std::uint32_t>(l.declarers, l.method_count);
+    node_displacements_ = reader_.array<std::uint32_t>(l.node_displacements, l.node_buckets);
+    node_slots_ = reader_.array<std::uint32_t>(l.node_slots, l.node_slot_count);
+    selector_displacements_ = reader_.array<std::uint32_t>(l.selector_displacements, l.selector_buckets);
+    selector_slots_ = reader_.array<std::uint32_t>(l.selector_slots, l.selector_slot_count);
+    reader_.bytes(l.strings, l.strings_size);
+    strings_ = l.strings;
+}
+
+const ClassNode* ClassGraph::find_node(std::string_view name, std::uint8_t kind) const {
+    std::uint32_t i = perfect_hash_lookup(node_hash(name, kind), node_displacements_, node_buckets_, node_slots_,
+                                          node_slot_count_);
+    if (i == 0)
+        return nullptr;
+    const ClassNode& n = nodes_[i - 1];
+    return (n.flags & ClassNode::kProtocol) == kind && this->name(n.name) == name ? &n : nullptr;
+}
+
+const ClassNode* ClassGraph::find_class(std::string_view name) const { return find_node(name, 0); }
+
+const ClassNode* ClassGraph::find_protocol(std::string_view name) const {
+    return find_node(name, ClassNode::kProtocol);
+}
+
+std::uint32_t ClassGraph::find_selector(std::string_view name) const {
+    std::uint32_t i = perfect_hash_lookup(hash64(name), selector_displacements_, selector_buckets_, selector_slots_,
+                                          selector_slot_count_);
+    return i != 0 && this->name(selectors_[i - 1].name) == name ? i - 1 : ClassNode::kNone;
+}
+
+const MethodRecord* ClassGraph::responds(const ClassNode& n, std::uint32_t sel, bool class_side) const {
+    if (sel >= selector_count_)
+        return nullptr;
+    std::uint32_t key = sel << 1 | class_side;
+    const std::uint32_t* first = responder_keys_ + n.first_responder;
+    const std::uint32_t* last = first + n.responder_count;
+    const std::uint32_t* it = std::lower_bound(first, last, key);
+    return it != last && *it == key ? &methods_[responders_[it - responder_keys_]] : nullptr;
+}
+
+bool ClassGraph::conforms(const ClassNode& n, const ClassNode& protocol) const {
+    Ids ids = protocols(n);
+    return std::binary_search(ids.begin(), ids.end(), index_of(protocol));
+}
+
+} // namespace moby
@@ -0,0 +1,652 @@
+#include "moby/conditionals.h"
+
+#include "moby/const_expr.h"
+#include "moby/include_graph.h"
+#include "moby/lexer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <optional>
+
+namespace moby {
+namespace {
+
+constexpr const char* kLanguageNames[] = {"c", "objc", "c++", "objc++"};
+
+// Deeper expansion than this is taken to be a recursive definition.
+constexpr int kMaxExpansionDepth = 32;
+
+// Apple's numeric spelling of a version: 13.0 is 130000, 10.15 is 101500,
+// and macOS 10.0 through 10.9 keep their old four-digit form (10.9 is 1090).
+std::int64_t apple_version(Platform p, unsigned major, unsigned minor, unsigned patch) {
+    if (p == Platform::MacOS && major == 10 && minor < 10)
+        return 1000 + minor * 10 + std::min(patch, 9u);
+    return major * 10000 + minor * 100 + patch;
+}
+
+// __MAC_10_15, __IPHONE_13_0, __TVOS_12_1, __WATCHOS_6_0_1, and the
+// __*_NA placeholders for "not available".
+std::optional<std::int64_t> version_constant(std::string_view name) {
+    struct Prefix {
+        std::string_view text;
+        Platform platform;
+        std::int64_t na;
+    };
+    static constexpr Prefix kPrefixes[] = {
+        {"__MAC_", Platform::MacOS, 9999},
+        {"__IPHONE_", Platform::IOS, 99999},
+        {"__TVOS_", Platform::TvOS, 99999},
+        {"__WATCHOS_", Platform::WatchOS, 99999},
+    };
+    for (const Prefix& prefix : kPrefixes) {
+        if (name.substr(0, prefix.text.size()) != prefix.text)
+            continue;
+        std::string_view rest = name.substr(prefix.text.size());
+        if (rest == "NA")
+            return prefix.na;
+        unsigned parts[3] = {0, 0, 0};
+        int n = 0;
+        bool digits = false;
+        for (char c : rest) {
+            if (c >= '0' && c <= '9') {
+                parts[n] = parts[n] * 10 + static_cast<unsigned>(c - '0');
+                digits = true;
+            } else if (c == '_' && digits && n < 2) {
+                ++n;
+                digits = false;
+            } else {
+                return std::nullopt;
+            }
+        }
+        if (!digits || n == 0)
+            return std::nullopt;
+        return apple_version(prefix.platform, parts[0], parts[1], parts[2]);
+    }
+    return std::nullopt;
+}
+
+using MacroMap = std::map<std::string, std::string, std::less<>>;
+
+MacroMap predefined_macros(const TargetConfig& c) {
+    MacroMap m;
+    auto flag = [&](const char* name, bool on) { m[name] = on ? "1" : "0"; };
+    Platform p = c.platform;
+    bool mac = p == Platform::MacOS, catalyst = p == Platform::MacCatalyst;
+    bool iphone = !mac;
+    bool lp64 = c.pointer_bits == 64;
+    bool intel = mac || catalyst;
+    bool objc = c.language == Language::ObjC || c.language == Language::ObjCxx;
+    bool cxx = c.language == Language::Cxx || c.language == Language::ObjCxx;
+
+    flag("TARGET_OS_MAC", true);
+    flag("TARGET_OS_OSX", mac);
+    flag("TARGET_OS_IPHONE", iphone);
+    flag("TARGET_OS_IOS", p == Platform::IOS || catalyst);
+    flag("TARGET_OS_TV", p == Platform::TvOS);
+    flag("TARGET_OS_WATCH", p == Platform::WatchOS);
+    flag("TARGET_OS_NANO", p == Platform::WatchOS);
+    flag("TARGET_OS_MACCATALYST", catalyst);
+    flag("TARGET_OS_UIKITFORMAC", catalyst);
+    flag("TARGET_OS_EMBEDDED", iphone && !catalyst);
+    for (const char* name : {"TARGET_OS_SIMULATOR", "TARGET_IPHONE_SIMULATOR", "TARGET_OS_BRIDGE",
+                             "TARGET_OS_DRIVERKIT", "TARGET_OS_WIN32", "TARGET_OS_UNIX", "TARGET_OS_LINUX",
+                             "TARGET_OS_WINDOWS", "TARGET_CPU_PPC", "TARGET_CPU_PPC64", "TARGET_CPU_68K",
+                             "TARGET_CPU_MIPS", "TARGET_CPU_SPARC", "TARGET_CPU_ALPHA", "TARGET_RT_BIG_ENDIAN",
+                             "TARGET_RT_MAC_CFM"})
+        flag(name, false);
+    flag("TARGET_CPU_X86", intel && !lp64);
+    flag("TARGET_CPU_X86_64", intel && lp64);
+    flag("TARGET_CPU_ARM", !intel && !lp64);
+    flag("TARGET_CPU_ARM64", !intel && lp64);
+    flag("TARGET_RT_LITTLE_ENDIAN", true);
+    flag("TARGET_RT_64_BIT", lp64);
+    flag("TARGET_RT_MAC_MACHO", true);
+
+    for (const char* name : {"__APPLE__", "__MACH__", "__clang__", "__BLOCKS__", "__LITTLE_ENDIAN__", "__STDC__"})
+        flag(name, true);
+    m["__GNUC__"] = "4";
+    m["__clang_major__"] = "11";
+    if (lp64) {
+        flag("__LP64__", true);
+        flag("_LP64", true);
+    }
+    if (intel) {
+        flag(lp64 ? "__x86_64__" : "__i386__", true);
+        flag("__SSE2__", true);
+        flag("__SSE3__", true);
+    } else {
+        flag(lp64 ? "__arm64__" : "__arm__", true);
+        if (lp64)
+            flag("__aarch64__", true);
+        flag("__ARM_NEON__", true);
+        flag("__ARM_NEON", true);
+    }
+    if (objc) {
+        flag("__OBJC__", true);
+        if (lp64 || !mac)
+            flag("__OBJC2__", true);
+    }
+    if (cxx)
+        m["__cplusplus"] = "201703L";
+    else
+        m["__STDC_VERSION__"] = "201112L";
+
+    std::int64_t min = c.min_version ? apple_version(p, c.min_version >> 16, c.min_version >> 8 & 0xFF,
+                                                     c.min_version & 0xFF)
+                                     : 0;
+    auto versions = [&](const char* min_name, const char* max_name, const char* env_name) {
+        m[min_name] = std::to_string(min);
+        m[max_name] = "999999";
+        m[env_name] = std::to_string(min);
+    };
+    switch (p) {
+    case Platform::MacOS:
+        versions("__MAC_OS_X_VERSION_MIN_REQUIRED", "__MAC_OS_X_VERSION_MAX_ALLOWED",
+                 "__ENVIRONMENT_MAC_OS_X_VERSION_MIN_REQUIRED__");
+        break;
+    case Platform::IOS:
+    case Platform::MacCatalyst:
+        versions("__IPHONE_OS_VERSION_MIN_REQUIRED", "__IPHONE_OS_VERSION_MAX_ALLOWED",
+                 "__ENVIRONMENT_IPHONE_OS_VERSION_MIN_REQUIRED__");
+        break;
+    case Platform::TvOS:
+        versions("__TV_OS_VERSION_MIN_REQUIRED", "__TV_OS_VERSION_MAX_ALLOWED",
+                 "__ENVIRONMENT_TV_OS_VERSION_MIN_REQUIRED__");
+        break;
+    case Platform::WatchOS:
+        versions("__WATCH_OS_VERSION_MIN_REQUIRED", "__WATCH_OS_VERSION_MAX_ALLOWED",
+                 "__ENVIRONMENT_WATCH_OS_VERSION_MIN_REQUIRED__");
+        break;
+    }
+
+    for (const auto& [name, value] : c.defines)
+        m[name] = value;
+    return m;
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front())))
+        s.remove_prefix(1);
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back())))
+        s.remove_suffix(1);
+    return s;
+}
+
+// Leading identifier of `s`, after whitespace.
+std::string_view leading_ident(std::string_view s) {
+    s = trim(s);
+    std::size_t n = 0;
+    while (n < s.size() && is_ident_char(s[n]))
+        ++n;
+    return s.substr(0, n);
+}
+
+} // namespace
+
+const char* language_name(Language l) { return kLanguageNames[static_cast<int>(l)]; }
+
+bool parse_language(std::string_view name, Language& l) {
+    if (name == "c")
+        l = Language::C;
+    else if (name == "objc")
+        l = Language::ObjC;
+    else if (name == "c++" || name == "cxx")
+        l = Language::Cxx;
+    else if (name == "objc++" || name == "objcxx")
+        l = Language::ObjCxx;
+    else
+        return false;
+    return true;
+}
+
+std::string TargetConfig::name() const {
+    std::string out = platform_name(platform);
+    out += "-" + std::to_string(pointer_bits) + "-" + language_name(language);
+    if (min_version)
+        out += "-" + format_version(min_version);
+    if (!arc)
+        out += "-noarc";
+    std::vector<std::pair<std::string, std::string>> sorted = defines;
+    std::sort(sorted.begin(), sorted.end());
+    for (const auto& [name, value] : sorted)
+        out += " -D" + name + "=" + value;
+    return out;
+}
+
+// A preprocessor line of a section, with comments removed and continuation
+// lines joined in `arg`.
+struct ConditionalViews::Directive {
+    enum Kind : std::uint8_t { If, Ifdef, Ifndef, Elif, Else, Endif, Define, Undef };
+    Kind kind;
+    std::uint32_t begin;  // line start
+    std::uint32_t end;    // after the terminating newline
+    std::string arg;      // text after the directive name
+};
+
+struct ConditionalViews::Skeleton {
+    std::vector<Directive> directives;
+    std::size_t conditionals = 0;
+};
+
+namespace {
+
+// Scans `text` for preprocessor lines outside comments and string literals.
+template <class Fn>
+void scan_directives(std::string_view text, Fn&& fn) {
+    std::size_t pos = 0, n = text.size();
+    bool in_comment = false;
+    while (pos < n) {
+        std::size_t line = pos;
+        if (!in_comment) {
+            while (pos < n && (text[pos] == ' ' || text[pos] == '\t'))
+                ++pos;
+            if (pos < n && text[pos] == '#') {
+                // Logical line: continuations and block comments may span lines.
+                std::string body;
+                ++pos;
+                while (pos < n && text[pos] != '\n') {
+                    if (text[pos] == '\\' && pos + 1 < n && text[pos + 1] == '\n') {
+                        pos += 2;
+                        body += ' ';
+                    } else if (text.compare(pos, 2, "/*") == 0) {
+                        std::size_t close = text.find("*/", pos + 2);
+                        pos = close == std::string_view::npos ? n : close + 2;
+                        body += ' ';
+                    } else if (text.compare(pos, 2, "//") == 0) {
+                        while (pos < n && text[pos] != '\n')
+                            ++pos;
+                    } else {
+                        body += text[pos++];
+                    }
+                }
+                if (pos < n)
+                    ++pos;
+                fn(line, pos, std::string_view(body));
+                continue;
+            }
+        }
+        while (pos < n && text[pos] != '\n') {
+            char c = text[pos];
+            if (in_comment) {
+                if (c == '*' && pos + 1 < n && text[pos + 1] == '/') {
+                    in_comment = false;
+                    ++pos;
+                }
+            } else if (c == '/' && pos + 1 < n && text[pos + 1] == '*') {
+                in_comment = true;
+                ++pos;
+            } else if (c == '/' && pos + 1 < n && text[pos + 1] == '/') {
+                while (pos < n && text[pos] != '\n')
+                    ++pos;
+                break;
+            } else if (c == '"' || c == '\'') {
+                for (++pos; pos < n && text[pos] != c && text[pos] != '\n'; ++pos)
+                    if (text[pos] == '\\')
+                        ++pos;
+            }
+            ++pos;
+        }
+        if (pos < n)
+            ++pos;
+    }
+}
+
+struct LocalMacro {
+    bool defined;
+    bool function_like;
+    std::string value;
+};
+
+// Macros visible at one point of a section: the configuration's, overlaid
+// with the section's own #define and #undef so far.
+struct MacroScope {
+    const MacroMap& predefined;
+    std::map<std::string, LocalMacro, std::less<>> local;
+
+    // Value of an object-like macro, or null.
+    const std::string* object(std::string_view name) const {
+        auto it = local.find(name);
+        if (it != local.end())
+            return it->second.defined && !it->second.function_like ? &it->second.value : nullptr;
+        auto p = predefined.find(name);
+        return p != predefined.end() ? &p->second : nullptr;
+    }
+    bool defined(std::string_view name) const {
+        auto it = local.find(name);
+        if (it != local.end())
+            return it->second.defined;
+        return predefined.count(name) != 0;
+    }
+};
+
+bool is_builtin(std::string_view name) {
+    static constexpr std::string_view kBuiltins[] = {
+        "__has_feature",   "__has_extension",         "__has_attribute",  "__has_cpp_attribute",
+        "__has_c_attribute", "__has_declspec_attribute", "__has_builtin", "__has_warning",
+        "__has_include",   "__has_include_next",      "__is_target_os",   "__is_target_arch",
+        "__is_target_environment", "__is_target_vendor", "__building_module",
+    };
+    return std::find(std::begin(kBuiltins), std::end(kBuiltins), name) != std::end(kBuiltins);
+}
+
+// Integer constant expression of an #if. Identifiers that are not macros
+// are 0; an invocation of an unknown function-like macro is 0 as well, rather
+// than an error, since the headers only reach for those behind a defined()
+// check.
+class ExprEval : public ConstExpr {
+public:
+    using Include = std::function<bool(std::string_view)>;
+
+    static bool evaluate(std::string_view text, const MacroScope& scope, const TargetConfig& config,
+                         const Include& include, int depth, ConstValue& out);
+
+private:
+    ExprEval(std::string_view text, const std::vector<Token>& toks, const MacroScope& scope,
+             const TargetConfig& config, const Include& include, int depth)
+        : ConstExpr(text, toks, 0, toks.size()), scope_(scope), config_(config), include_(include),
+          depth_(depth) {}
+
+    // Text inside the parenthesized argument list at toks[i_], which it
+    // consumes; false when there is none.
+    bool arguments(std::string_view& out) {
+        if (!punct("("))
+            return false;
+        std::size_t open = i_;
+        i_ = skip_group(text_, toks_, i_, last_);
+        if (!is_punct(text_, toks_[i_ - 1], ')') || i_ - 1 == open)
+            return false;
+        std::size_t begin = toks_[open].offset + 1;
+        out = trim(text_.substr(begin, toks_[i_ - 1].offset - begin));
+        return true;
+    }
+
+    bool identifier(ConstValue& out) override {
+        std::string_view name = str(i_++);
+        if (name == "defined") {
+            bool paren = accept("(");
+            if (i_ >= last_ || toks_[i_].kind != Tok::Ident)
+                return false;
+            std::string_view target = str(i_++);
+            if (paren && !accept(")"))
+                return false;
+            out = ConstValue::of(scope_.defined(target) || is_builtin(target));
+            return true;
+        }
+        if (is_builtin(name)) {
+            std::string_view arg;
+            if (!arguments(arg))
+                return false;
+            out = ConstValue::of(builtin(name, arg));
+            return true;
+        }
+        if (name == "true" || name == "false") {
+            out = ConstValue::of(name == "true");
+            return true;
+        }
+        if (const std::string* value = scope_.object(name)) {
+            out = {};
+            return trim(*value).empty() || evaluate(*value, scope_, config_, include_, depth_ + 1, out);
+        }
+        if (auto v = version_constant(name)) {
+            out = ConstValue::of(*v);
+            return true;
+        }
+        if (punct("("))
+            i_ = skip_group(text_, toks_, i_, last_);
+        out = {};
+        return true;
+    }
+
+    std::int64_t builtin(std::string_view name, std::string_view arg) {
+        bool objc = config_.language == Language::ObjC || config_.language == Language::ObjCxx;
+        bool cxx = config_.language == Language::Cxx || config_.language == Language::ObjCxx;
+        if (name == "__has_feature" || name == "__has_extension") {
+            if (arg == "objc_arc" || arg == "objc_arc_weak")
+                return objc && config_.arc;
+            if (arg == "modules" || arg.find("sanitizer") != std::string_view::npos)
+                return 0;
+            if (arg.substr(0, 4) == "cxx_")
+                return cxx;
+            if (arg.substr(0, 5) == "objc_")
+                return objc;
+            return 1;
+        }
+        if (name == "__has_include" || name == "__has_include_next") {
+            if (arg.size() >= 2 && (arg.front() == '<' || arg.front() == '"'))
+                arg = arg.substr(1, arg.size() - 2);
+            return include_(arg);
+        }
+        if (name == "__is_target_os") {
+            Platform p;
+            if (arg == "ios")
+                return config_.platform == Platform::IOS || config_.platform == Platform::MacCatalyst;
+            return parse_platform(arg, p) && p == config_.platform;
+        }
+        if (name == "__is_target_environment")
+            return arg == "macabi" && config_.platform == Platform::MacCatalyst;
+        if (name == "__is_target_arch") {
+            bool intel = config_.platform == Platform::MacOS || config_.platform == Platform::MacCatalyst;
+            std::string_view arch = intel ? (config_.pointer_bits == 64 ? "x86_64" : "i386")
+                                          : (config_.pointer_bits == 64 ? "arm64" : "arm");
+            return arg == arch;
+        }
+        if (name == "__is_target_vendor")
+            return arg == "apple";
+        if (name == "__building_module")
+            return 0;
+        return 1;  // attributes, builtins and warnings a current clang has
+    }
+
+    const MacroScope& scope_;
+    const TargetConfig& config_;
+    const Include& include_;
+    int depth_;
+};
+
+bool ExprEval::evaluate(std::string_view text, const MacroScope& scope, const TargetConfig& config,
+                        const Include& include, int depth, ConstValue& out) {
+    if (depth > kMaxExpansionDepth)
+        return false;
+    std::vector<Token> toks = tokenize(text);
+    return ExprEval(text, toks, scope, config, include, depth).evaluate_all(out);
+}
+
+} // namespace
+
+ConditionalViews::ConditionalViews(const Corpus& corpus) : corpus_(corpus), skeletons_(corpus.sections().size()) {}
+
+ConditionalViews::~ConditionalViews() = default;
+
+const ConditionalViews::Skeleton& ConditionalViews::skeleton(std::uint32_t section) const {
+    auto& slot = skeletons_[section];
+    if (slot)
+        return *slot;
+    slot = std::make_unique<Skeleton>();
+    scan_directives(corpus_.sections()[section].text, [&](std::size_t begin, std::size_t end, std::string_view body) {
+        body = trim(body);
+        std::string_view name = leading_ident(body);
+        static constexpr std::pair<std::string_view, ConditionalViews::Directive::Kind> kKinds[] = {
+            {"if", Directive::If},       {"ifdef", Directive::Ifdef}, {"ifndef", Directive::Ifndef},
+            {"elif", Directive::Elif},   {"else", Directive::Else},   {"endif", Directive::Endif},
+            {"define", Directive::Define}, {"undef", Directive::Undef},
+        };
+        for (const auto& [text, kind] : kKinds) {
+            if (name != text)
+                continue;
+            std::size_t at = body.find(name);
+            slot->directives.push_back({kind, static_cast<std::uint32_t>(begin), static_cast<std::uint32_t>(end),
+                                        std::string(trim(body.substr(at + name.size())))});
+            if (kind == Directive::If || kind == Directive::Ifdef || kind == Directive::Ifndef)
+                ++slot->conditionals;
+            break;
+        }
+    });
+    return *slot;
+}
+
+std::size_t ConditionalViews::conditional_count() const {
+    std::size_t n = 0;
+    for (std::uint32_t i = 0; i < corpus_.sections().size(); ++i)
+        n += skeleton(i).conditionals;
+    return n;
+}
+
+bool ConditionalViews::has_include(std::string_view header) const {
+    if (headers_.empty()) {
+        for (const Section& s : corpus_.sections())
+            headers_.push_back(include_name(s.path));
+        std::sort(headers_.begin(), headers_.end());
+    }
+    return std::binary_search(headers_.begin(), headers_.end(), header);
+}
+
+const TargetView& ConditionalViews::view(const TargetConfig& config) {
+    std::string key = config.name();
+    auto it = views_.find(key);
+    if (it == views_.end())
+        it = views_.emplace(std::move(key), std::unique_ptr<TargetView>(new TargetView(*this, config))).first;
+    return *it->second;
+}
+
+TargetView::TargetView(const ConditionalViews& owner, TargetConfig config)
+    : owner_(owner), config_(std::move(config)), macros_(predefined_macros(config_)),
+      sections_(owner.corpus().sections().size()) {}
+
+const TargetView::Evaluated& TargetView::evaluate(std::uint32_t section) const {
+    auto& slot = sections_[section];
+    if (slot)
+        return *slot;
+    slot = std::make_unique<Evaluated>();
+    using Directive = ConditionalViews::Directive;
+    const auto& directives = owner_.skeleton(section).directives;
+    std::uint32_t size = static_cast<std::uint32_t>(owner_.corpus().sections()[section].text.size());
+
+    MacroScope scope{macros_, {}};
+    ExprEval::Include include = [&](std::string_view header) { return owner_.has_include(header); };
+    auto test = [&](std::string_view expr) {
+        ConstValue v;
+        if (ExprEval::evaluate(expr, scope, config_, include, 0, v))
+            return v.bits != 0;
+        ++stats_.errors;
+        return false;
+    };
+
+    struct Frame {
+        bool outer;  // the enclosing region is live
+        bool taken;  // an earlier branch of this conditional was live
+        bool live;
+    };
+    std::vector<Frame> stack;
+    bool live = true;
+    std::uint32_t cursor = 0;
+    auto emit = [&](std::uint32_t end) {
+        if (live && end > cursor) {
+            if (!slot->live.empty() && slot->live.back().end == cursor)
+                slot->live.back().end = end;
+            else
+                slot->live.push_back({cursor, end});
+        }
+    };
+
+    for (const Directive& d : directives) {
+        if (d.kind == Directive::Define || d.kind == Directive::Undef) {
+            if (!live)
+                continue;
+            std::string_view name = leading_ident(d.arg);
+            if (name.empty())
+                continue;
+            LocalMacro& m = scope.local[std::string(name)];
+            m.defined = d.kind == Directive::Define;
+            std::string_view rest = std::string_view(d.arg).substr(name.size());
+            m.function_like = m.defined && !rest.empty() && rest[0] == '(';
+            m.value = m.defined && !m.function_like ? std::string(trim(rest)) : std::string();
+            continue;
+        }
+        emit(d.begin);
+        cursor = d.end;
+        switch (d.kind) {
+        case Directive::If:
+        case Directive::Ifdef:
+        case Directive::Ifndef: {
+            ++stats_.conditionals;
+            bool cond = false;
+            if (live) {
+                std::string_view name = leading_ident(d.arg);
+                if (d.kind == Directive::If)
+                    cond = test(d.arg);
+                else
+                    cond = (scope.defined(name) || is_builtin(name)) == (d.kind == Directive::Ifdef);
+            }
+            stack.push_back({live, cond, cond});
+            live = live && cond;
+            break;
+        }
+        case Directive::Elif:
+            if (stack.empty()) {
+                ++stats_.errors;
+                break;
+            }
+            if (stack.back().outer && !stack.back().taken && test(d.arg)) {
+                stack.back().taken = true;
+                live = true;
+            } else {
+                live = false;
+            }
+            break;
+        case Directive::Else:
+            if (stack.empty()) {
+                ++stats_.errors;
+                break;
+            }
+            live = stack.back().outer && !stack.back().taken;
+            stack.back().taken = true;
+            break;
+        case Directive::Endif:
+            if (stack.empty()) {
+                ++stats_.errors;
+                break;
+            }
+            live = stack.back().outer;
+            stack.pop_back();
+            break;
+        default:
+            break;
+        }
+    }
+    emit(size);
+    return *slot;
+}
+
+const std::vector<LiveRange>& TargetView::live(std::uint32_t section) const { return evaluate(section).live; }
+
+std::size_t TargetView::live_bytes(std::uint32_t section) const {
+    std::size_t n = 0;
+    for (const LiveRange& r : live(section))
+        n += r.end - r.begin;
+    return n;
+}
+
+std::string_view TargetView::text(std::uint32_t section) const {
+    evaluate(section);
+    Evaluated& e = *sections_[section];
+    if (!e.text) {
+        std::string_view original = owner_.corpus().sections()[section].text;
+        auto text = std::make_unique<std::string>(original);
+        std::uint32_t cursor = 0;
+        auto blank = [&](std::uint32_t begin, std::uint32_t end) {
+            for (std::uint32_t i = begin; i < end; ++i)
+                if ((*text)[i] != '\n')
+                    (*text)[i] = ' ';
+        };
+        for (const LiveRange& r : e.live) {
+            blank(cursor, r.begin);
+            cursor = r.end;
+        }
+        blank(cursor, static_cast<std::uint32_t>(text->size()));
+        e.text = std::move(text);
+    }
+    return *e.text;
+}
+
+} // namespace moby
@@ -0,0 +1,181 @@
+#include "moby/const_expr.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace moby {
+namespace {
+
+int precedence(std::string_view op) {
+    static constexpr std::pair<std::string_view, int> kOps[] = {
+        {"||", 1}, {"&&", 2}, {"|", 3}, {"^", 4}, {"&", 5}, {"==", 6}, {"!=", 6}, {"<", 7}, {">", 7},
+        {"<=", 7}, {">=", 7}, {"<<", 8}, {">>", 8}, {"+", 9}, {"-", 9}, {"*", 10}, {"/", 10}, {"%", 10},
+    };
+    for (const auto& [text, prec] : kOps)
+        if (text == op)
+            return prec;
+    return 0;
+}
+
+} // namespace
+
+bool parse_integer(std::string_view literal, ConstValue& out) {
+    std::string digits(literal);
+    bool is_unsigned = false;
+    while (!digits.empty() && std::strchr("uUlL", digits.back())) {
+        is_unsigned |= digits.back() == 'u' || digits.back() == 'U';
+        digits.pop_back();
+    }
+    char* end = nullptr;
+    std::uint64_t v = std::strtoull(digits.c_str(), &end, 0);
+    if (digits.empty() || *end)
+        return false;
+    out = {v, is_unsigned || v > static_cast<std::uint64_t>(INT64_MAX)};
+    return true;
+}
+
+ConstValue parse_char_constant(std::string_view literal) {
+    std::int64_t v = 0;
+    for (std::size_t k = 1; k + 1 < literal.size(); ++k) {
+        unsigned char c = static_cast<unsigned char>(literal[k]);
+        if (c == '\\' && k + 2 < literal.size()) {
+            c = static_cast<unsigned char>(literal[++k]);
+            c = c == 'n' ? '\n' : c == 't' ? '\t' : c == 'r' ? '\r' : c == '0' ? '\0' : c;
+        }
+        v = static_cast<std::int64_t>(static_cast<std::uint64_t>(v) << 8 | c);
+    }
+    return ConstValue::of(v);
+}
+
+ConstValue convert_value(ConstValue v, unsigned width, bool is_signed) {
+    if (width == 0)
+        return v;
+    if (width >= 64)
+        return {v.bits, !is_signed};
+    std::uint64_t mask = (std::uint64_t(1) << width) - 1;
+    std::uint64_t bits = v.bits & mask;
+    if (is_signed && (bits >> (width - 1)) & 1)
+        bits |= ~mask;
+    return {bits, false};
+}
+
+bool ConstExpr::evaluate(ConstValue& out) {
+    if (i_ >= last_)
+        return false;
+    out = conditional();
+    return ok_;
+}
+
+bool ConstExpr::cast(unsigned&, bool&) { return false; }
+
+bool ConstExpr::accept(std::string_view op) {
+    if (!punct(op))
+        return false;
+    ++i_;
+    return true;
+}
+
+ConstValue ConstExpr::fail() {
+    ok_ = false;
+    i_ = last_;
+    return {};
+}
+
+ConstValue ConstExpr::conditional() {
+    ConstValue c = binary(1);
+    if (!accept("?"))
+        return c;
+    ConstValue a = conditional();
+    if (!accept(":"))
+        return fail();
+    ConstValue b = conditional();
+    ConstValue v = c.bits ? a : b;
+    v.is_unsigned = a.is_unsigned || b.is_unsigned;
+    return v;
+}
+
+ConstValue ConstExpr::binary(int min_prec) {
+    ConstValue lhs = unary();
+    while (ok_ && i_ < last_ && toks_[i_].kind == Tok::Punct) {
+        std::string_view t = str(i_);
+        int prec = precedence(t);
+        if (prec == 0 || prec < min_prec)
+            break;
+        ++i_;
+        ConstValue rhs = binary(prec + 1);
+        bool u = lhs.is_unsigned || rhs.is_unsigned;
+        std::uint64_t a = lhs.bits, b = rhs.bits;
+        std::int64_t sa = lhs.as_signed(), sb = rhs.as_signed();
+        bool shift_ok = rhs.is_unsigned ? b < 64 : sb >= 0 && sb < 64;
+        if (t == "||") lhs = ConstValue::of(a || b);
+        else if (t == "&&") lhs = ConstValue::of(a && b);
+        else if (t == "|") lhs = {a | b, u};
+        else if (t == "^") lhs = {a ^ b, u};
+        else if (t == "&") lhs = {a & b, u};
+        else if (t == "==") lhs = ConstValue::of(a == b);
+        else if (t == "!=") lhs = ConstValue::of(a != b);
+        else if (t == "<=") lhs = ConstValue::of(u ? a <= b : sa <= sb);
+        else if (t == ">=") lhs = ConstValue::of(u ? a >= b : sa >= sb);
+        else if (t == "<") lhs = ConstValue::of(u ? a < b : sa < sb);
+        else if (t == ">") lhs = ConstValue::of(u ? a > b : sa > sb);
+        else if (t == "<<") lhs.bits = shift_ok ? a << b : 0;
+        else if (t == ">>") lhs.bits = !shift_ok ? 0 : lhs.is_unsigned ? a >> b : static_cast<std::uint64_t>(sa >> b);
+        else if (t == "+") lhs = {a + b, u};
+        else if (t == "-") lhs = {a - b, u};
+        else if (t == "*") lhs = {a * b, u};
+        else if (b == 0) return fail();
+        else if (u) lhs = {t == "/" ? a / b : a % b, true};
+        else if (sa == INT64_MIN && sb == -1) lhs = ConstValue::of(t == "/" ? sa : 0);
+        else lhs = ConstValue::of(t == "/" ? sa / sb : sa % sb);
+    }
+    return lhs;
+}
+
+ConstValue ConstExpr::unary() {
+    if (accept("!"))
+        return ConstValue::of(!unary().bits);
+    if (accept("~")) {
+        ConstValue v = unary();
+        return {~v.bits, v.is_unsigned};
+    }
+    if (accept("-")) {
+        ConstValue v = unary();
+        return {0 - v.bits, v.is_unsigned};
+    }
+    if (accept("+"))
+        return unary();
+    unsigned width;
+    bool is_signed;
+    if (cast(width, is_signed))
+        return convert_value(unary(), width, is_signed);
+    return primary();
+}
+
+ConstValue ConstExpr::primary() {
+    if (i_ >= last_)
+        return fail();
+    if (accept("(")) {
+        ConstValue v = conditional();
+        return accept(")") ? v : fail();
+    }
+    std::string_view s = str(i_);
+    switch (toks_[i_].kind) {
+    case Tok::Number: {
+        ++i_;
+        ConstValue v;
+        return parse_integer(s, v) ? v : fail();
+    }
+    case Tok::Char:
+        ++i_;
+        return parse_char_constant(s);
+    case Tok::Ident: {
+        ConstValue v;
+        return identifier(v) ? v : fail();
+    }
+    default:
+        return fail();
+    }
+}
+
+} // namespace moby
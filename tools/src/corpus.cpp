@@ -0,0 +1,85 @@
+#include "moby/corpus.h"
+
+#include "moby/error.h"
+#include "moby/lexer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+namespace {
+
+constexpr std::string_view kFileSuffix = ".framework.h";
+
+} // namespace
+
+void split_sections(std::string_view text, const std::function<void(const SectionSpan&)>& fn) {
+    std::size_t pos = text.find(kSeparator);
+    while (pos != std::string_view::npos) {
+        std::size_t path_begin = pos + kSeparator.size();
+        std::size_t eol = text.find('\n', path_begin);
+        std::size_t content = eol == std::string_view::npos ? text.size() : eol + 1;
+        std::size_t path_end = eol == std::string_view::npos ? text.size() : eol;
+        while (path_end > path_begin && (text[path_end - 1] == '\r' || text[path_end - 1] == ' '))
+            --path_end;
+
+        std::size_t next = text.find(kSeparator, content);
+        std::size_t end = next == std::string_view::npos ? text.size() : next;
+
+        SectionSpan span;
+        span.marker = pos;
+        span.offset = content;
+        span.length = end - content;
+        span.path = text.substr(path_begin, path_end - path_begin);
+        fn(span);
+        pos = next;
+    }
+}
+
+std::vector<std::string> list_corpus_files(const std::string& dir) {
+    std::vector<std::string> names;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        std::string name = entry.path().filename().string();
+        if (ends_with(name, kFileSuffix) && entry.is_regular_file())
+            names.push_back(std::move(name));
+    }
+    if (ec)
+        throw Error("cannot list " + dir + ": " + ec.message());
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+std::string default_corpus_dir() {
+    const char* env = std::getenv("MOBY_CORPUS");
+    return env && *env ? env : ".";
+}
+
+Corpus::Corpus(const std::string& dir) : dir_(dir) {
+    std::vector<std::string> names = list_corpus_files(dir);
+    if (names.empty())
+        throw Error("no *.framework.h files in " + dir);
+
+    files_.reserve(names.size());
+    for (auto& name : names) {
+        CorpusFile file;
+        file.framework = name.substr(0, name.size() - kFileSuffix.size());
+        file.map = MappedFile((fs::path(dir) / name).string());
+        file.name = std::move(name);
+        total_bytes_ += file.map.size();
+        files_.push_back(std::move(file));
+    }
+
+    for (std::uint32_t i = 0; i < files_.size(); ++i) {
+        std::string_view text = files_[i].map.view();
+        split_sections(text, [&](const SectionSpan& span) {
+            sections_.push_back({i, span.marker, span.offset, span.length, span.path,
+                                 text.substr(span.offset, span.length)});
+        });
+    }
+}
+
+} // namespace moby
@@ -0,0 +1,731 @@
+#include "moby/decl_cache.h"
+
+#include "moby/lexer.h"
+#include "moby/section_cache.h"
+#include "moby/section_index.h"
+#include "moby/work_pool.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <map>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+
+struct DeclCache::FileStamp {
+    StrRef name;
+    std::uint64_t size;
+    std::int64_t mtime_ns;
+};
+
+namespace {
+
+struct DeclLayout {
+    std::uint64_t decl_count;
+    std::uint64_t part_count;
+    std::uint64_t availability_count;
+    std::uint64_t section_count;
+    std::uint64_t stamp_count;
+    std::uint64_t decls;
+    std::uint64_t parts;
+    std::uint64_t availability;
+    std::uint64_t by_name;
+    std::uint64_t section_paths;
+    std::uint64_t stamps;
+    std::uint64_t strings;
+    std::uint64_t strings_size;
+};
+
+using Clock = std::chrono::steady_clock;
+
+struct PendingPart {
+    std::string label, type, name;
+};
+
+struct PendingDecl {
+    std::string name, type;
+    std::uint32_t parent = kNoDecl;  // within the section
+    std::uint32_t end = 0;
+    std::uint32_t first_part = 0;    // within the section
+    std::uint32_t part_count = 0;
+    std::uint32_t symbol = 0;        // into SectionResult::symbols
+    std::uint8_t flags = 0;
+};
+
+struct SectionDecls {
+    SectionResult result;
+    std::vector<PendingDecl> decls;
+    std::vector<PendingPart> parts;
+};
+
+bool is_container(SymbolKind k) {
+    return k == SymbolKind::Interface || k == SymbolKind::Category || k == SymbolKind::Protocol ||
+           k == SymbolKind::Enum;
+}
+
+// Words that belong to the declaration rather than to a type.
+bool is_storage(std::string_view s) {
+    return s == "extern" || s == "static" || s == "inline" || s == "typedef";
+}
+
+// Words that end a parameter or field without naming it.
+bool is_type_word(std::string_view s) {
+    constexpr std::string_view kWords[] = {
+        "void", "const", "volatile", "restrict", "int", "char", "unsigned", "signed", "long", "short",
+        "float", "double", "struct", "union", "enum", "_Nullable", "_Nonnull", "_Null_unspecified",
+        "nullable", "nonnull", "null_unspecified", "__kindof", "_Bool", "bool", "id", "instancetype",
+    };
+    return std::find(std::begin(kWords), std::end(kWords), s) != std::end(kWords);
+}
+
+// Reads the signatures of the symbols extracted from one section.
+class DeclReader {
+public:
+    explicit DeclReader(const Section& section) : text_(section.text), base_(section.offset) {
+        for (const Token& t : tokenize(text_))
+            if (t.kind != Tok::Directive)
+                toks_.push_back(t);
+    }
+
+    void read(const Symbol& sym, PendingDecl& d, std::vector<PendingPart>& parts);
+
+private:
+    std::size_t size() const { return toks_.size(); }
+    std::string_view str(std::size_t i) const { return i < size() ? token_text(text_, toks_[i]) : std::string_view(); }
+    bool punct(std::size_t i, char c) const { return i < size() && is_punct(text_, toks_[i], c); }
+    bool ident(std::size_t i) const { return i < size() && toks_[i].kind == Tok::Ident; }
+    bool macro(std::size_t i) const { return ident(i) && is_macro_name(str(i)) && str(i) != "__kindof"; }
+
+    std::size_t token_at(std::uint64_t offset) const { return moby::token_at(toks_, offset - base_); }
+    std::size_t skip_group(std::size_t i, std::size_t last) const { return moby::skip_group(text_, toks_, i, last); }
+    std::size_t find_top(std::size_t i, std::size_t last, char c) const;
+    std::size_t name_index(std::size_t first, std::size_t last, std::string_view name) const;
+    std::size_t declarator_index(std::size_t first, std::size_t last) const;
+    std::string render(std::size_t first, std::size_t last, std::size_t skip = ~std::size_t(0)) const;
+
+    void read_unit(const Symbol& sym, std::size_t first, std::size_t last, PendingDecl& d,
+                   std::vector<PendingPart>& parts) const;
+    void read_method(std::size_t first, std::size_t last, PendingDecl& d, std::vector<PendingPart>& parts) const;
+    void read_property(const Symbol& sym, std::size_t first, std::size_t last, PendingDecl& d,
+                       std::vector<PendingPart>& parts) const;
+    void read_function(const Symbol& sym, std::size_t first, std::size_t last, PendingDecl& d,
+                       std::vector<PendingPart>& parts) const;
+    void read_enum(std::size_t first, std::size_t last, PendingDecl& d) const;
+    void read_record(std::size_t first, std::size_t last, std::vector<PendingPart>& parts) const;
+
+    std::string_view text_;
+    std::uint64_t base_;
+    std::vector<Token> toks_;
+};
+
+// First `c` in [i, last) outside bracket groups, or `last`.
+std::size_t DeclReader::find_top(std::size_t i, std::size_t last, char c) const {
+    while (i < last && !punct(i, c))
+        i = punct(i, '(') || punct(i, '[') || punct(i, '{') ? skip_group(i, last) : i + 1;
+    return i;
+}
+
+// Last `name` in [first, last) outside macro calls and bracket groups other
+// than a (*name) or (^name) declarator, or `last`.
+std::size_t DeclReader::name_index(std::size_t first, std::size_t last, std::string_view name) const {
+    std::size_t found = last;
+    for (std::size_t i = first; i < last;) {
+        if (macro(i)) {
+            i = punct(i + 1, '(') ? skip_group(i + 1, last) : i + 1;
+        } else if (punct(i, '(') && (punct(i + 1, '*') || punct(i + 1, '^'))) {
+            std::size_t j = i + 1;
+            while (j < last && (punct(j, '*') || punct(j, '^') || (ident(j) && is_type_word(str(j)))))
+                ++j;
+            if (str(j) == name)
+                return j;
+            i = skip_group(i, last);
+        } else if (punct(i, '(') || punct(i, '[') || punct(i, '{')) {
+            i = skip_group(i, last);
+        } else {
+            if (str(i) == name)
+                found = i;
+            ++i;
+        }
+    }
+    return found;
+}
+
+// The name a parameter or field declares in [first, last), or `last` when it
+// has none, as in "NSString *" or "unsigned long".
+std::size_t DeclReader::declarator_index(std::size_t first, std::size_t last) const {
+    std::size_t end = std::min(find_top(first, last, '['), find_top(first, last, ':'));
+    std::size_t types = 0;
+    for (std::size_t i = first; i < end;) {
+        if (macro(i)) {
+            i = punct(i + 1, '(') ? skip_group(i + 1, end) : i + 1;
+        } else if (punct(i, '(') && (punct(i + 1, '*') || punct(i + 1, '^'))) {
+            std::size_t j = i + 1;
+            while (j < end && (punct(j, '*') || punct(j, '^') || (ident(j) && is_type_word(str(j)))))
+                ++j;
+            return ident(j) ? j : last;
+        } else if (punct(i, '(') || punct(i, '{')) {
+            i = skip_group(i, end);
+            ++types;
+        } else {
+            if (ident(i) && !is_type_word(str(i)) && types > 0) {
+                std::size_t next = i + 1;
+                while (next < end && macro(next))
+                    next = punct(next + 1, '(') ? skip_group(next + 1, end) : next + 1;
+                if (next == end)
+                    return i;
+            }
+            if (ident(i) || punct(i, '*') || punct(i, '^'))
+                ++types;
+            ++i;
+        }
+    }
+    return last;
+}
+
+// Tokens [first, last) without macros, storage words and token `skip`. Two
+// tokens are separated by a space where the header had whitespace between
+// them; brace groups are shortened to "{...}".
+std::string DeclReader::render(std::size_t first, std::size_t last, std::size_t skip) const {
+    std::string out;
+    std::size_t prev_end = 0;
+    auto append = [&](std::string_view s, std::size_t begin, std::size_t end) {
+        if (!out.empty()) {
+            std::string_view gap = text_.substr(prev_end, begin > prev_end ? begin - prev_end : 0);
+            if (gap.find_first_of(" \t\r\n") != std::string_view::npos || gap.find("/*") != std::string_view::npos)
+                out.push_back(' ');
+        }
+        out.append(s);
+        prev_end = end;
+    };
+    for (std::size_t i = first; i < last;) {
+        if (i == skip) {
+            ++i;
+            continue;
+        }
+        if (macro(i) || (ident(i) && is_storage(str(i)))) {
+            i = macro(i) && punct(i + 1, '(') ? skip_group(i + 1, last) : i + 1;
+            continue;
+        }
+        if (punct(i, '{')) {
+            std::size_t after = skip_group(i, last);
+            append("{...}", toks_[i].offset, toks_[after - 1].offset + toks_[after - 1].length);
+            i = after;
+            continue;
+        }
+        append(str(i), toks_[i].offset, toks_[i].offset + toks_[i].length);
+        ++i;
+    }
+    return out;
+}
+
+// @interface Name<Params> : Super<Args> <Protocols>, @interface Class
+// (Category) <Protocols> or @protocol Name <Protocols>.
+void DeclReader::read_unit(const Symbol& sym, std::size_t first, std::size_t last, PendingDecl& d,
+                           std::vector<PendingPart>& parts) const {
+    UnitHeader header = read_unit_header(text_, toks_, first, last);
+    d.type = sym.kind == SymbolKind::Category ? sym.parent : std::move(header.super);
+    for (std::string& n : header.protocols)
+        parts.push_back({std::move(n), {}, {}});
+}
+
+// - (Type)label:(Type)name label:(Type)name, ...
+void DeclReader::read_method(std::size_t first, std::size_t last, PendingDecl& d,
+                             std::vector<PendingPart>& parts) const {
+    std::size_t i = first + 1;
+    if (punct(i, '(')) {
+        std::size_t after = skip_group(i, last);
+        d.type = render(i + 1, after - 1);
+        i = after;
+    }
+    if (ident(i) && !punct(i + 1, ':'))
+        return;
+    while (i < last) {
+        PendingPart part;
+        if (ident(i) && punct(i + 1, ':')) {
+            part.label = std::string(str(i)) + ":";
+            i += 2;
+        } else if (punct(i, ':')) {
+            part.label = ":";
+            ++i;
+        } else {
+            break;
+        }
+        if (punct(i, '(')) {
+            std::size_t after = skip_group(i, last);
+            part.type = render(i + 1, after - 1);
+            i = after;
+        }
+        if (ident(i) && !punct(i + 1, ':') && !macro(i))
+            part.name = std::string(str(i++));
+        parts.push_back(std::move(part));
+    }
+    if (punct(i, ',') && str(i + 1) == "...")
+        d.flags |= DeclRecord::kVariadic;
+}
+
+// @property (attributes) Type name;
+void DeclReader::read_property(const Symbol& sym, std::size_t first, std::size_t last, PendingDecl& d,
+                               std::vector<PendingPart>& parts) const {
+    std::size_t i = first + 1;
+    if (punct(i, '(')) {
+        std::size_t close = skip_group(i, last) - 1;
+        std::string attribute;
+        for (++i; i <= close; ++i) {
+            if (i == close || punct(i, ',')) {
+                if (!attribute.empty())
+                    parts.push_back({std::move(attribute), {}, {}});
+                attribute.clear();
+            } else {
+                attribute.append(str(i));
+            }
+        }
+    }
+    std::size_t end = find_top(i, last, ';');
+    d.type = render(i, end, name_index(i, end, sym.name));
+}
+
+// Type name(Type param, ...)
+void DeclReader::read_function(const Symbol& sym, std::size_t first, std::size_t last, PendingDecl& d,
+                               std::vector<PendingPart>& parts) const {
+    std::size_t at = first;
+    while (at < last && !(str(at) == sym.name && punct(at + 1, '(')))
+        at = macro(at) && punct(at + 1, '(') ? skip_group(at + 1, last) : at + 1;
+    if (at == last)
+        return;
+    d.type = render(first, at);
+    std::size_t close = skip_group(at + 1, last) - 1;
+    for (std::size_t i = at + 2; i < close;) {
+        std::size_t end = find_top(i, close, ',');
+        if (str(i) == "..." && end == i + 1) {
+            d.flags |= DeclRecord::kVariadic;
+        } else if (!(str(i) == "void" && end == i + 1)) {
+            std::size_t name = declarator_index(i, end);
+            parts.push_back({{}, render(i, end, name), name < end ? std::string(str(name)) : std::string()});
+        }
+        i = end + 1;
+    }
+}
+
+// NS_ENUM(Type, Name) or enum Name : Type.
+void DeclReader::read_enum(std::size_t first, std::size_t last, PendingDecl& d) const {
+    for (std::size_t i = first; i < last && !punct(i, '{'); ++i) {
+        std::string_view s = str(i);
+        if (macro(i) && (ends_with(s, "_ENUM") || ends_with(s, "_OPTIONS")) && punct(i + 1, '(')) {
+            std::size_t close = skip_group(i + 1, last) - 1;
+            std::size_t comma = find_top(i + 2, close, ',');
+            if (comma < close)
+                d.type = render(i + 2, comma);
+            return;
+        }
+        if (s == "enum") {
+            std::size_t brace = find_top(i, last, '{');
+            std::size_t colon = find_top(i, brace, ':');
+            if (colon < brace)
+                d.type = render(colon + 1, brace);
+            return;
+        }
+    }
+}
+
+// The fields of the first brace group: struct { Type name; Type a, *b; }.
+void DeclReader::read_record(std::size_t first, std::size_t last, std::vector<PendingPart>& parts) const {
+    std::size_t open = find_top(first, last, '{');
+    if (open == last)
+        return;
+    std::size_t close = skip_group(open, last) - 1;
+    for (std::size_t i = open + 1; i < close;) {
+        std::size_t end = find_top(i, close, ';');
+        std::size_t comma = find_top(i, end, ',');
+        std::size_t name = declarator_index(i, comma);
+        if (i < end)
+            parts.push_back({{}, render(i, comma, name), name < comma ? std::string(str(name)) : std::string()});
+        // Further declarators share the base type: everything before the
+        // first one's name, less its pointers.
+        std::size_t base_end = name < comma ? name : comma;
+        while (base_end > i && (punct(base_end - 1, '*') || punct(base_end - 1, '^')))
+            --base_end;
+        std::string base = render(i, base_end);
+        for (std::size_t k = comma; k < end;) {
+            std::size_t next = find_top(k + 1, end, ',');
+            std::size_t n = declarator_index(k + 1, next);
+            if (n == next && ident(next - 1))
+                n = next - 1;
+            std::string rest = render(k + 1, next, n);
+            parts.push_back({{}, rest.empty() ? base : base + " " + rest, n < next ? std::string(str(n)) : std::string()});
+            k = next;
+        }
+        i = end + 1;
+    }
+}
+
+void DeclReader::read(const Symbol& sym, PendingDecl& d, std::vector<PendingPart>& parts) {
+    std::size_t first = token_at(sym.offset);
+    std::size_t last = std::min(token_at(sym.offset + sym.length), size());
+    d.name = sym.name;
+    switch (sym.kind) {
+    case SymbolKind::Interface:
+    case SymbolKind::Category:
+    case SymbolKind::Protocol:
+        read_unit(sym, first, last, d, parts);
+        break;
+    case SymbolKind::ClassMethod:
+    case SymbolKind::InstanceMethod:
+        read_method(first, last, d, parts);
+        break;
+    case SymbolKind::Property:
+        read_property(sym, first, last, d, parts);
+        break;
+    case SymbolKind::Function:
+        read_function(sym, first, last, d, parts);
+        break;
+    case SymbolKind::Enum:
+        read_enum(first, last, d);
+        break;
+    case SymbolKind::EnumConstant: {
+        std::size_t eq = find_top(first, last, '=');
+        if (eq < last)
+            d.type = render(eq + 1, last);
+        break;
+    }
+    case SymbolKind::Struct:
+    case SymbolKind::Union:
+        read_record(first, last, parts);
+        break;
+    case SymbolKind::Typedef:
+    case SymbolKind::Variable: {
+        std::size_t end = std::min(find_top(first, last, ';'), find_top(first, last, '='));
+        std::size_t name = name_index(first, end, sym.name);
+        // typedef struct {...} *Ref: the struct is its own record.
+        d.type = render(first, end, name);
+        break;
+    }
+    }
+}
+
+// Symbols of one section in the order they start, each container ahead of
+// its members, with parents and subtree ends set.
+void read_section(const Section& section, SectionDecls& out) {
+    const std::vector<Symbol>& symbols = out.result.symbols;
+    std::vector<std::uint32_t> order(symbols.size());
+    for (std::uint32_t k = 0; k < order.size(); ++k)
+        order[k] = k;
+    std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+        if (symbols[a].offset != symbols[b].offset)
+            return symbols[a].offset < symbols[b].offset;
+        return symbols[a].length > symbols[b].length;
+    });
+    DeclReader reader(section);
+    std::vector<std::uint32_t> open;  // enclosing containers, innermost last
+    for (std::uint32_t k : order) {
+        const Symbol& sym = symbols[k];
+        auto inside = [&](std::uint32_t c) {
+            const Symbol& outer = symbols[out.decls[c].symbol];
+            return sym.offset >= outer.offset && sym.offset + sym.length <= outer.offset + outer.length;
+        };
+        while (!open.empty() && !inside(open.back())) {
+            out.decls[open.back()].end = static_cast<std::uint32_t>(out.decls.size());
+            open.pop_back();
+        }
+        PendingDecl d;
+        d.symbol = k;
+        if (!open.empty())
+            d.parent = open.back();
+        d.first_part = static_cast<std::uint32_t>(out.parts.size());
+        reader.read(sym, d, out.parts);
+        d.part_count = static_cast<std::uint32_t>(out.parts.size()) - d.first_part;
+        d.end = static_cast<std::uint32_t>(out.decls.size()) + 1;
+        out.decls.push_back(std::move(d));
+        if (is_container(sym.kind))
+            open.push_back(static_cast<std::uint32_t>(out.decls.size()) - 1);
+    }
+    for (std::uint32_t c : open)
+        out.decls[c].end = static_cast<std::uint32_t>(out.decls.size());
+}
+
+std::int64_t mtime_ns(const struct stat& st) {
+    return static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+// Declaration text laid out as in a header: "NSString *name", "void (^name)(id)".
+std::string declare(std::string_view type, std::string_view name) {
+    if (name.empty())
+        return std::string(type);
+    std::string out(type);
+    for (std::string_view hole : {"(^)", "(*)", "(^ _Nullable)", "(^ _Nonnull)"}) {
+        std::size_t at = out.find(hole);
+        if (at != std::string::npos) {
+            std::size_t insert = at + hole.size() - 1;
+            out.insert(insert, std::string(hole.size() > 3 ? " " : "").append(name));
+            return out;
+        }
+    }
+    std::size_t bracket = out.find('[');
+    std::size_t at = bracket == std::string::npos ? out.size() : bracket;
+    while (at > 0 && out[at - 1] == ' ')
+        --at;
+    std::string insert = at > 0 && out[at - 1] != '*' && out[at - 1] != '^' ? " " : "";
+    insert.append(name);
+    out.insert(at, insert);
+    return out;
+}
+
+} // namespace
+
+std::string DeclCache::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "decls.cache").string();
+}
+
+DeclCacheStats DeclCache::build(const Corpus& corpus, const std::string& path, unsigned threads) {
+    auto start = Clock::now();
+    const auto& sections = corpus.sections();
+    std::vector<SectionDecls> per_section(sections.size());
+    std::vector<std::uint32_t> tasks(sections.size());
+    for (std::uint32_t i = 0; i < tasks.size(); ++i)
+        tasks[i] = i;
+    std::stable_sort(tasks.begin(), tasks.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return sections[a].length > sections[b].length; });
+    run_stealing(tasks, threads, [&](std::uint32_t i) {
+        analyze_section(sections[i], i, per_section[i].result);
+        read_section(sections[i], per_section[i]);
+    });
+    DeclCacheStats stats;
+    stats.parse_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    StringPool strings;
+    std::vector<DeclRecord> decls;
+    std::vector<DeclPart> parts;
+    std::vector<Availability> availability;
+    std::map<std::array<std::uint32_t, 4 * kPlatformCount>, std::uint32_t> availability_ids;
+    for (std::size_t s = 0; s < sections.size(); ++s) {
+        const SectionDecls& sd = per_section[s];
+        auto base = static_cast<std::uint32_t>(decls.size());
+        for (const PendingDecl& p : sd.decls) {
+            const Symbol& sym = sd.result.symbols[p.symbol];
+            const Availability& a = sd.result.availability[p.symbol];
+            std::array<std::uint32_t, 4 * kPlatformCount> key;
+            for (int k = 0; k < kPlatformCount; ++k) {
+                const PlatformAvailability& pa = a.platforms[k];
+                key[4 * k] = pa.introduced;
+                key[4 * k + 1] = pa.deprecated;
+                key[4 * k + 2] = pa.obsoleted;
+                key[4 * k + 3] = pa.unavailable;
+            }
+            auto [it, added] = availability_ids.emplace(key, static_cast<std::uint32_t>(availability.size()));
+            if (added) {
+                // Field by field onto zeroed storage, so padding is zero too.
+                availability.emplace_back();
+                std::memset(static_cast<void*>(&availability.back()), 0, sizeof(Availability));
+                for (int k = 0; k < kPlatformCount; ++k) {
+                    PlatformAvailability& to = availability.back().platforms[k];
+                    to.introduced = a.platforms[k].introduced;
+                    to.deprecated = a.platforms[k].deprecated;
+                    to.obsoleted = a.platforms[k].obsoleted;
+                    to.unavailable = a.platforms[k].unavailable;
+                }
+            }
+            DeclRecord r{};
+            r.name = strings.add(p.name);
+            r.type = strings.add(p.type);
+            r.parent = p.parent == kNoDecl ? kNoDecl : base + p.parent;
+            r.end = base + p.end;
+            r.first_part = static_cast<std::uint32_t>(parts.size());
+            r.part_count = p.part_count;
+            r.availability = it->second;
+            r.section = static_cast<std::uint32_t>(s);
+            r.offset = sym.offset;
+            r.length = sym.length;
+            r.kind = sym.kind;
+            r.flags = p.flags;
+            for (std::uint32_t k = 0; k < p.part_count; ++k) {
+                const PendingPart& part = sd.parts[p.first_part + k];
+                parts.push_back({strings.add(part.label), strings.add(part.type), strings.add(part.name)});
+            }
+            decls.push_back(r);
+        }
+    }
+
+    std::vector<std::string_view> names(decls.size());
+    for (std::size_t k = 0; k < decls.size(); ++k)
+        names[k] = std::string_view(strings.data()).substr(decls[k].name.offset, decls[k].name.length);
+    std::vector<std::uint32_t> by_name(decls.size());
+    for (std::uint32_t k = 0; k < by_name.size(); ++k)
+        by_name[k] = k;
+    std::stable_sort(by_name.begin(), by_name.end(), [&](std::uint32_t a, std::uint32_t b) { return names[a] < names[b]; });
+
+    std::vector<StrRef> section_paths;
+    for (const Section& s : sections)
+        section_paths.push_back(strings.add(s.path));
+    std::vector<FileStamp> stamps;
+    for (const CorpusFile& f : corpus.files()) {
+        struct stat st {};
+        std::string file = (fs::path(corpus.dir()) / f.name).string();
+        if (::stat(file.c_str(), &st) != 0)
+            throw Error("cannot stat " + file);
+        stamps.push_back({strings.add(f.name), static_cast<std::uint64_t>(st.st_size), mtime_ns(st)});
+    }
+
+    BlobWriter w(kMagic, kVersion, moby::corpus_hash(corpus));
+    std::size_t layout_at = w.put(DeclLayout{});
+    DeclLayout layout{};
+    layout.decl_count = decls.size();
+    layout.part_count = parts.size();
+    layout.availability_count = availability.size();
+    layout.section_count = section_paths.size();
+    layout.stamp_count = stamps.size();
+    w.align(64);
+    layout.decls = w.put_array(decls);
+    layout.parts = w.put_array(parts);
+    layout.availability = w.put_array(availability);
+    layout.by_name = w.put_array(by_name);
+    layout.section_paths = w.put_array(section_paths);
+    layout.stamps = w.put_array(stamps);
+    layout.strings = w.put_bytes(strings.data().data(), strings.data().size());
+    layout.strings_size = strings.data().size();
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+
+    stats.decls = decls.size();
+    stats.parts = parts.size();
+    stats.availabilities = availability.size();
+    stats.bytes = fs::file_size(path);
+    return stats;
+}
+
+DeclCache::DeclCache(const std::string& path) : reader_(path, kMagic, kVersion) {
+    const DeclLayout& l = *reader_.array<DeclLayout>(sizeof(BlobHeader), 1);
+    decl_count_ = l.decl_count;
+    stamp_count_ = l.stamp_count;
+    decls_ = reader_.array<DeclRecord>(l.decls, l.decl_count);
+    parts_ = reader_.array<DeclPart>(l.parts, l.part_count);
+    availability_ = reader_.array<Availability>(l.availability, l.availability_count);
+    by_name_ = reader_.array<std::uint32_t>(l.by_name, l.decl_count);
+    section_paths_ = reader_.array<StrRef>(l.section_paths, l.section_count);
+    stamps_ = reader_.array<FileStamp>(l.stamps, l.stamp_count);
+    reader_.bytes(l.strings, l.strings_size);
+    strings_ = l.strings;
+    for (std::uint64_t k = 0; k < decl_count_; ++k) {
+        const DeclRecord& d = decls_[k];
+        if (d.end > decl_count_ || d.end <= k || d.first_part > l.part_count ||
+            d.part_count > l.part_count - d.first_part || d.availability >= l.availability_count ||
+            d.section >= l.section_count || by_name_[k] >= decl_count_)
+            throw Error(path + ": malformed declaration cache");
+    }
+}
+
+bool DeclCache::is_current(const std::string& corpus_dir) const {
+    std::vector<std::string> files = list_corpus_files(corpus_dir);
+    if (files.size() != stamp_count_)
+        return false;
+    for (std::size_t k = 0; k < files.size(); ++k) {
+        const FileStamp& stamp = stamps_[k];
+        struct stat st {};
+        if (files[k] != str(stamp.name) || ::stat((fs::path(corpus_dir) / files[k]).c_str(), &st) != 0 ||
+            static_cast<std::uint64_t>(st.st_size) != stamp.size || mtime_ns(st) != stamp.mtime_ns)
+            return false;
+    }
+    return true;
+}
+
+DeclCache::Ids DeclCache::find(std::string_view name) const {
+    auto below = [&](std::uint32_t id, std::string_view n) { return str(decls_[id].name) < n; };
+    auto above = [&](std::string_view n, std::uint32_t id) { return n < str(decls_[id].name); };
+    const std::uint32_t* lo = std::lower_bound(by_name_, by_name_ + decl_count_, name, below);
+    const std::uint32_t* hi = std::upper_bound(lo, by_name_ + decl_count_, name, above);
+    return {lo, static_cast<std::size_t>(hi - lo)};
+}
+
+std::string DeclCache::signature(const DeclRecord& d) const {
+    std::string out;
+    std::string_view name = str(d.name), type = str(d.type);
+    auto protocols = [&] {
+        if (d.part_count == 0)
+            return;
+        out.append(" <");
+        for (const DeclPart& p : parts(d))
+            out.append(&p == parts_ + d.first_part ? "" : ", ").append(str(p.label));
+        out.push_back('>');
+    };
+    switch (d.kind) {
+    case SymbolKind::Interface:
+        out.append("@interface ").append(name);
+        if (!type.empty())
+            out.append(" : ").append(type);
+        protocols();
+        break;
+    case SymbolKind::Category:
+    case SymbolKind::Protocol:
+        out.append(d.kind == SymbolKind::Protocol ? "@protocol " : "@interface ").append(name);
+        protocols();
+        break;
+    case SymbolKind::ClassMethod:
+    case SymbolKind::InstanceMethod:
+        out.append(d.kind == SymbolKind::ClassMethod ? "+ (" : "- (").append(type).append(")");
+        if (d.part_count == 0)
+            out.append(name);
+        for (const DeclPart& p : parts(d)) {
+            if (&p != parts_ + d.first_part)
+                out.push_back(' ');
+            out.append(str(p.label)).append("(").append(str(p.type)).append(")").append(str(p.name));
+        }
+        if (d.flags & DeclRecord::kVariadic)
+            out.append(", ...");
+        break;
+    case SymbolKind::Property:
+        out.append("@property ");
+        if (d.part_count) {
+            out.push_back('(');
+            for (const DeclPart& p : parts(d))
+                out.append(&p == parts_ + d.first_part ? "" : ", ").append(str(p.label));
+            out.append(") ");
+        }
+        out.append(declare(type, name));
+        break;
+    case SymbolKind::Function:
+        out.append(declare(type, name)).push_back('(');
+        for (const DeclPart& p : parts(d))
+            out.append(&p == parts_ + d.first_part ? "" : ", ").append(declare(str(p.type), str(p.name)));
+        if (d.flags & DeclRecord::kVariadic)
+            out.append(d.part_count ? ", ..." : "...");
+        else if (d.part_count == 0)
+            out.append("void");
+        out.push_back(')');
+        break;
+    case SymbolKind::Enum:
+        out.append("enum ").append(name);
+        if (!type.empty())
+            out.append(" : ").append(type);
+        break;
+    case SymbolKind::EnumConstant:
+        out.append(name);
+        if (!type.empty())
+            out.append(" = ").append(type);
+        break;
+    case SymbolKind::Struct:
+    case SymbolKind::Union:
+        out.append(d.kind == SymbolKind::Struct ? "struct " : "union ").append(name);
+        if (d.part_count) {
+            out.append(" {");
+            for (const DeclPart& p : parts(d))
+                out.append(" ").append(declare(str(p.type), str(p.name))).push_back(';');
+            out.append(" }");
+        }
+        break;
+    case SymbolKind::Typedef:
+        out.append("typedef ").append(declare(type, name));
+        break;
+    case SymbolKind::Variable:
+        out.append(declare(type, name));
+        break;
+    }
+    return out;
+}
+
+} // namespace moby
@@ -0,0 +1,600 @@
+#include "moby/deprecations.h"
+
+#include "moby/lexer.h"
+#include "moby/section_index.h"
+#include "moby/work_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <filesystem>
+#include <map>
+#include <numeric>
+#include <set>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+namespace {
+
+struct DeprecationLayout {
+    std::uint64_t record_count;
+    std::uint64_t pattern_count;
+    std::uint64_t pattern_record_count;
+    std::uint64_t slot_count;
+    std::uint64_t records;
+    std::uint64_t patterns;
+    std::uint64_t pattern_records;
+    std::uint64_t base;
+    std::uint64_t check;
+    std::uint64_t terminal;
+    std::uint64_t strings;
+    std::uint64_t strings_size;
+};
+
+constexpr const char* kSourceNames[] = {"none", "macro", "message", "inferred"};
+
+// Input byte -> automaton symbol: 1..63 for identifier characters, kColon
+// for ':', 0 for a boundary.
+constexpr std::uint8_t kColon = 64;
+constexpr int kSymbols = 65;
+
+constexpr std::array<std::uint8_t, 256> make_codes() {
+    std::array<std::uint8_t, 256> codes{};
+    std::uint8_t next = 1;
+    for (int c = '0'; c <= '9'; ++c)
+        codes[c] = next++;
+    for (int c = 'A'; c <= 'Z'; ++c)
+        codes[c] = next++;
+    for (int c = 'a'; c <= 'z'; ++c)
+        codes[c] = next++;
+    codes['_'] = next++;
+    codes[':'] = kColon;
+    return codes;
+}
+constexpr std::array<std::uint8_t, 256> kCodes = make_codes();
+
+bool deprecation_macro(std::string_view name) {
+    return (name.find("DEPRECATED") != std::string_view::npos && name != "API_TO_BE_DEPRECATED" &&
+            name.substr(name.size() >= 6 ? name.size() - 6 : 0) != "_BEGIN" &&
+            name.substr(name.size() >= 4 ? name.size() - 4 : 0) != "_END") ||
+           name == "deprecated" || name == "__deprecated" || name == "__deprecated_msg";
+}
+
+// What a declaration's own annotations say about its deprecation.
+struct Annotation {
+    bool deprecated = false;
+    std::string replacement;
+    std::string message;
+};
+
+std::string unquote(std::string_view s) {
+    if (s.size() >= 2 && s.front() == '"')
+        s = s.substr(1, s.size() - 2);
+    std::string out;
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '\\' && i + 1 < s.size())
+            ++i;
+        out += s[i];
+    }
+    return out;
+}
+
+Annotation read_annotation(std::string_view text) {
+    Annotation a;
+    std::vector<Token> toks = tokenize(text);
+    for (std::size_t i = 0; i < toks.size(); ++i) {
+        if (toks[i].kind != Tok::Ident || !deprecation_macro(token_text(text, toks[i])))
+            continue;
+        a.deprecated = true;
+        std::string_view name = token_text(text, toks[i]);
+        if (i + 2 < toks.size() && is_punct(text, toks[i + 1], '(') && toks[i + 2].kind == Tok::String) {
+            std::string arg = unquote(token_text(text, toks[i + 2]));
+            // Adjacent literals continue the message.
+            for (std::size_t j = i + 3; j < toks.size() && toks[j].kind == Tok::String; ++j)
+                arg += unquote(token_text(text, toks[j]));
+            if (name.find("REPLACEMENT") != std::string_view::npos)
+                a.replacement = arg;
+            else if (a.message.empty())
+                a.message = arg;
+        }
+    }
+    return a;
+}
+
+// "Use AVCaptureConnection's videoOrientation instead." -> the name after
+// the first trigger phrase, or empty.
+std::string replacement_from_message(std::string_view message) {
+    static constexpr std::string_view kTriggers[] = {"use ",         "Use ",        "replaced by ",
+                                                     "renamed to ",  "superseded by ", "in favor of "};
+    std::size_t at = std::string_view::npos;
+    std::string_view trigger;
+    for (std::string_view t : kTriggers) {
+        std::size_t p = message.find(t);
+        if (p != std::string_view::npos && (at == std::string_view::npos || p < at)) {
+            at = p;
+            trigger = t;
+        }
+    }
+    if (at == std::string_view::npos)
+        return {};
+    auto word_at = [&](std::size_t p) {
+        while (p < message.size() && (message[p] == ' ' || message[p] == '-' || message[p] == '+' ||
+                                      message[p] == '[' || message[p] == '`'))
+            ++p;
+        std::size_t e = p;
+        while (e < message.size() && (kCodes[static_cast<unsigned char>(message[e])] || message[e] == '.' ||
+                                      message[e] == '\''))
+            ++e;
+        std::string_view w = message.substr(p, e - p);
+        while (!w.empty() && (w.back() == '.' || w.back() == '\''))
+            w.remove_suffix(1);
+        return std::pair<std::string_view, std::size_t>(w, e);
+    };
+    auto [word, end] = word_at(at + trigger.size());
+    if (word.empty() || (!std::isalpha(static_cast<unsigned char>(word[0])) && word[0] != '_'))
+        return {};
+    std::string out(word);
+    if (word.size() > 2 && word.substr(word.size() - 2) == "'s") {
+        auto [member, _] = word_at(end);
+        out = std::string(word.substr(0, word.size() - 2));
+        if (!member.empty())
+            out += "." + std::string(member);
+    } else if (std::isupper(static_cast<unsigned char>(word[0]))) {
+        // "AVCapturePhotoOutput capturePhotoWithSettings:delegate:"
+        auto [member, _] = word_at(end);
+        if (member.find(':') != std::string_view::npos)
+            out += " " + std::string(member);
+    }
+    // Common words after "use" that are not names.
+    static constexpr std::string_view kNotNames[] = {"the", "a", "an", "of", "this", "that", "it", "with", "instead"};
+    for (std::string_view w : kNotNames)
+        if (out == w)
+            return {};
+    return out;
+}
+
+// The *_WITH_REPLACEMENT argument without the method sign, and the name out
+// of the few that are written as a sentence ("Use protocolConfiguration").
+std::string macro_replacement(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '-' || text.front() == '+'))
+        text.remove_prefix(1);
+    while (!text.empty() && text.back() == ' ')
+        text.remove_suffix(1);
+    if (text.find(' ') != std::string_view::npos) {
+        std::string name = replacement_from_message(text);
+        if (!name.empty())
+            return name;
+    }
+    return std::string(text);
+}
+
+bool is_method(SymbolKind k) {
+    return k == SymbolKind::InstanceMethod || k == SymbolKind::ClassMethod || k == SymbolKind::Property;
+}
+
+// The scanner spelling of a name: "initWithFoo:bar:" -> "initWithFoo:".
+std::string_view pattern_text(std::string_view name) {
+    std::size_t colon = name.find(':');
+    return colon == std::string_view::npos ? name : name.substr(0, colon + 1);
+}
+
+bool valid_pattern(std::string_view p) {
+    if (p.empty() || std::isdigit(static_cast<unsigned char>(p[0])))
+        return false;
+    for (std::size_t i = 0; i < p.size(); ++i)
+        if (!kCodes[static_cast<unsigned char>(p[i])] || (p[i] == ':' && i + 1 != p.size()))
+            return false;
+    return true;
+}
+
+// Double-array trie over the patterns: slot base[s] + symbol is the child of
+// s on that symbol when check[] of it is s.
+struct DoubleArray {
+    std::vector<std::int32_t> base, check;
+    std::vector<std::uint32_t> terminal;
+    std::size_t states = 0;
+
+    void build(const std::vector<std::string>& patterns) {
+        // Pointer trie first: children as (symbol, node), sorted.
+        std::vector<std::vector<std::pair<std::uint8_t, std::uint32_t>>> children(1);
+        std::vector<std::uint32_t> ends(1, 0);
+        for (std::uint32_t p = 0; p < patterns.size(); ++p) {
+            std::uint32_t node = 0;
+            for (char c : patterns[p]) {
+                std::uint8_t sym = kCodes[static_cast<unsigned char>(c)];
+                auto& kids = children[node];
+                auto it = std::lower_bound(kids.begin(), kids.end(), std::pair<std::uint8_t, std::uint32_t>(sym, 0));
+                if (it != kids.end() && it->first == sym) {
+                    node = it->second;
+                    continue;
+                }
+                auto child = static_cast<std::uint32_t>(children.size());
+                kids.insert(it, {sym, child});
+                children.emplace_back();
+                ends.push_back(0);
+                node = child;
+            }
+            ends[node] = p + 1;
+        }
+        states = children.size();
+
+        // Then place each node's children, breadth first, at the lowest base
+        // where all their slots are free.
+        auto grow = [&](std::size_t n) {
+            if (check.size() < n) {
+                base.resize(n, 0);
+                check.resize(n, -1);
+                terminal.resize(n, 0);
+            }
+        };
+        grow(kSymbols * 4);
+        check[0] = -2;  // the root
+        std::size_t first_free = 1;
+        std::vector<std::pair<std::uint32_t, std::int32_t>> queue{{0, 0}};  // node, slot
+        for (std::size_t q = 0; q < queue.size(); ++q) {
+            auto [node, slot] = queue[q];
+            terminal[slot] = ends[node];
+            const auto& kids = children[node];
+            if (kids.empty())
+                continue;
+            while (first_free < check.size() && check[first_free] != -1)
+                ++first_free;
+            std::int32_t b = std::max<std::int32_t>(1, static_cast<std::int32_t>(first_free) - kids[0].first);
+            for (;; ++b) {
+                grow(b + kSymbols + 1);
+                bool fits = true;
+                for (const auto& [sym, _] : kids)
+                    if (check[b + sym] != -1) {
+                        fits = false;
+                        break;
+                    }
+                if (fits)
+                    break;
+            }
+            base[slot] = b;
+            for (const auto& [sym, child] : kids) {
+                check[b + sym] = slot;
+                queue.push_back({child, b + sym});
+            }
+        }
+        std::size_t used = check.size();
+        while (used > 1 && check[used - 1] == -1)
+            --used;
+        used += kSymbols;  // base + symbol of any slot stays in bounds
+        base.resize(used, 0);
+        check.resize(used, -1);
+        terminal.resize(used, 0);
+    }
+};
+
+// Class a message's receiver names when it ends just before `end`: NSFoo in
+// "[NSFoo " and in "[[NSFoo alloc] " or "[[NSFoo new] ", else empty.
+std::string_view receiver_class(std::string_view text, std::uint64_t end) {
+    auto ident_start = [&](std::uint64_t e) {
+        while (e > 0 && is_ident_char(text[e - 1]))
+            --e;
+        return e;
+    };
+    auto space_start = [&](std::uint64_t e) {
+        while (e > 0 && std::isspace(static_cast<unsigned char>(text[e - 1])))
+            --e;
+        return e;
+    };
+    if (end > 0 && text[end - 1] == ']') {
+        std::uint64_t e = space_start(end - 1);
+        std::uint64_t b = ident_start(e);
+        std::string_view sel = text.substr(b, e - b);
+        if (sel != "alloc" && sel != "new")
+            return {};
+        end = space_start(b);
+    }
+    std::uint64_t b = ident_start(end);
+    if (b == end || !std::isupper(static_cast<unsigned char>(text[b])))
+        return {};
+    std::uint64_t open = space_start(b);
+    if (open == 0 || text[open - 1] != '[')
+        return {};
+    return text.substr(b, end - b);
+}
+
+// Comments and string or character literals hold no uses: returns the last
+// byte of the one starting at `i`, or `i` when none does.
+std::uint64_t skip_inert(std::string_view text, std::uint64_t i) {
+    char c = text[i];
+    if (c == '/' && i + 1 < text.size() && text[i + 1] == '/') {
+        std::size_t end = text.find('\n', i);
+        return end == std::string_view::npos ? text.size() - 1 : end - 1;
+    }
+    if (c == '/' && i + 1 < text.size() && text[i + 1] == '*') {
+        std::size_t end = text.find("*/", i + 2);
+        return end == std::string_view::npos ? text.size() - 1 : end + 1;
+    }
+    if (c == '"' || c == '\'') {
+        std::uint64_t j = i + 1;
+        for (; j < text.size() && text[j] != c && text[j] != '\n'; ++j)
+            if (text[j] == '\\')
+                ++j;
+        return std::min<std::uint64_t>(j, text.size() - 1);
+    }
+    return i;
+}
+
+} // namespace
+
+const char* replacement_source_name(ReplacementSource s) { return kSourceNames[static_cast<int>(s)]; }
+
+std::string DeprecationTable::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "deprecations.tbl").string();
+}
+
+DeprecationStats DeprecationTable::build(const Corpus& corpus, const SymbolDb& db, const std::string& path) {
+    const auto& sections = corpus.sections();
+    auto decl_text = [&](const SymbolRecord& r) {
+        const Section& s = sections[r.section];
+        return std::string_view(s.text.data() - s.offset + r.offset, r.length);
+    };
+
+    // Own annotations of every symbol, in parallel over ID ranges.
+    std::vector<Annotation> notes(db.size());
+    std::vector<Availability> avail(db.size());
+    constexpr std::uint32_t kChunk = 1024;
+    std::vector<std::uint32_t> chunks((db.size() + kChunk - 1) / kChunk);
+    std::iota(chunks.begin(), chunks.end(), 0);
+    run_stealing(chunks, 0, [&](std::uint32_t c) {
+        for (std::size_t id = std::size_t(c) * kChunk; id < std::min<std::size_t>(db.size(), (c + 1) * kChunk); ++id) {
+            const SymbolRecord& r = db.at(id);
+            std::string_view text = annotation_text(r.kind, decl_text(r));
+            notes[id] = read_annotation(text);
+            if (notes[id].deprecated)
+                parse_availability(text, avail[id]);
+        }
+    });
+
+    // Members by parent, for inferring replacements.
+    std::map<std::string_view, std::vector<std::uint32_t>> members;
+    for (std::uint32_t id = 0; id < db.size(); ++id)
+        if (is_method(db.at(id).kind))
+            members[db.parent(db.at(id))].push_back(id);
+
+    DeprecationStats stats;
+    StringPool strings;
+    std::vector<DeprecationRecord> records;
+    for (std::uint32_t id = 0; id < db.size(); ++id) {
+        const Annotation& a = notes[id];
+        if (!a.deprecated)
+            continue;
+        const SymbolRecord& r = db.at(id);
+        DeprecationRecord rec{};
+        rec.name = strings.add(db.name(r));
+        bool container = r.kind == SymbolKind::Interface || r.kind == SymbolKind::Category ||
+                         r.kind == SymbolKind::Protocol;
+        rec.parent = strings.add(container ? std::string_view() : db.parent(r));
+        rec.message = strings.add(a.message);
+        rec.symbol = id;
+        rec.kind = r.kind;
+        for (int p = 0; p < kPlatformCount; ++p)
+            rec.deprecated[p] = avail[id].platforms[p].deprecated;
+        std::string replacement;
+        if (!a.replacement.empty()) {
+            replacement = macro_replacement(a.replacement);
+            rec.source = ReplacementSource::Macro;
+        } else if (!(replacement = replacement_from_message(a.message)).empty()) {
+            rec.source = ReplacementSource::Message;
+        } else if (is_method(r.kind)) {
+            std::string_view name = db.name(r);
+            std::string_view stem = name.substr(0, name.find(':'));
+            std::string_view best;
+            for (std::uint32_t other : members[db.parent(r)]) {
+                std::string_view candidate = db.name(db.at(other));
+                if (notes[other].deprecated || candidate.size() <= stem.size() ||
+                    candidate.substr(0, stem.size()) != stem || !std::isupper(static_cast<unsigned char>(candidate[stem.size()])) ||
+                    (!best.empty() && candidate.size() >= best.size()))
+                    continue;
+                best = candidate;
+            }
+            if (!best.empty()) {
+                replacement = std::string(best);
+                rec.source = ReplacementSource::Inferred;
+            }
+        }
+        rec.replacement = strings.add(replacement);
+        stats.by_macro += rec.source == ReplacementSource::Macro;
+        stats.by_message += rec.source == ReplacementSource::Message;
+        stats.inferred += rec.source == ReplacementSource::Inferred;
+        records.push_back(rec);
+    }
+    stats.deprecated = records.size();
+
+    // Selectors some member declares without deprecating them. Whole
+    // selectors, not patterns: openURL:options:completionHandler: replacing
+    // openURL: does not make every openURL: send ambiguous.
+    std::set<std::string> live_members;
+    for (std::uint32_t id = 0; id < db.size(); ++id) {
+        const SymbolRecord& r = db.at(id);
+        if (!is_method(r.kind) || notes[id].deprecated)
+            continue;
+        std::string_view name = db.name(r);
+        live_members.emplace(name);
+        if (r.kind == SymbolKind::Property && !name.empty()) {
+            std::string setter = "set" + std::string(name) + ":";
+            setter[3] = static_cast<char>(std::toupper(static_cast<unsigned char>(setter[3])));
+            live_members.insert(std::move(setter));
+        }
+    }
+
+    // Patterns: name spellings, sorted, each with its records. A pattern is
+    // shared when one of its selectors is also declared live.
+    std::map<std::string, std::vector<std::uint32_t>> by_pattern;
+    std::set<std::string> shared;
+    for (std::uint32_t i = 0; i < records.size(); ++i) {
+        const SymbolRecord& r = db.at(records[i].symbol);
+        std::string_view name = db.name(r);
+        std::string_view p = pattern_text(name);
+        if (valid_pattern(p)) {
+            by_pattern[std::string(p)].push_back(i);
+            if (live_members.count(std::string(name)))
+                shared.emplace(p);
+        }
+        if (r.kind == SymbolKind::Property && !name.empty()) {
+            std::string setter = "set" + std::string(name) + ":";
+            setter[3] = static_cast<char>(std::toupper(static_cast<unsigned char>(setter[3])));
+            if (valid_pattern(setter)) {
+                by_pattern[setter].push_back(i);
+                if (live_members.count(setter))
+                    shared.insert(setter);
+            }
+        }
+    }
+    std::vector<std::string> texts;
+    std::vector<DeprecationPattern> patterns;
+    std::vector<std::uint32_t> pattern_records;
+    for (auto& [text, ids] : by_pattern) {
+        bool methods = true;
+        for (std::uint32_t i : ids)
+            methods &= is_method(records[i].kind);
+        std::uint32_t flags = 0;
+        if (methods && text.back() != ':')
+            flags |= DeprecationPattern::kMember;
+        if (methods && shared.count(text))
+            flags |= DeprecationPattern::kShared;
+        stats.shared += (flags & DeprecationPattern::kShared) != 0;
+        patterns.push_back({strings.add(text), static_cast<std::uint32_t>(pattern_records.size()),
+                            static_cast<std::uint32_t>(ids.size()), flags, 0});
+        pattern_records.insert(pattern_records.end(), ids.begin(), ids.end());
+        texts.push_back(text);
+    }
+    DoubleArray da;
+    da.build(texts);
+    stats.patterns = patterns.size();
+    stats.states = da.states;
+    stats.slots = da.check.size();
+
+    BlobWriter w(kMagic, kVersion, moby::corpus_hash(corpus));
+    std::size_t layout_at = w.put(DeprecationLayout{});
+    DeprecationLayout layout{};
+    layout.record_count = records.size();
+    layout.pattern_count = patterns.size();
+    layout.pattern_record_count = pattern_records.size();
+    layout.slot_count = da.check.size();
+    layout.records = w.put_array(records);
+    layout.patterns = w.put_array(patterns);
+    layout.pattern_records = w.put_array(pattern_records);
+    layout.base = w.put_array(da.base);
+    layout.check = w.put_array(da.check);
+    layout.terminal = w.put_array(da.terminal);
+    layout.strings = w.put_bytes(strings.data().data(), strings.data().size());
+    layout.strings_size = strings.data().size();
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+    return stats;
+}
+
+DeprecationTable::DeprecationTable(const std::string& path) : reader_(path, kMagic, kVersion) {
+    const DeprecationLayout& l = *reader_.array<DeprecationLayout>(sizeof(BlobHeader), 1);
+    record_count_ = l.record_count;
+    pattern_count_ = l.pattern_count;
+    slot_count_ = l.slot_count;
+    records_ = reader_.array<DeprecationRecord>(l.records, l.record_count);
+    patterns_ = reader_.array<DeprecationPattern>(l.patterns, l.pattern_count);
+    pattern_records_ = reader_.array<std::uint32_t>(l.pattern_records, l.pattern_record_count);
+    base_ = reader_.array<std::int32_t>(l.base, l.slot_count);
+    check_ = reader_.array<std::int32_t>(l.check, l.slot_count);
+    terminal_ = reader_.array<std::uint32_t>(l.terminal, l.slot_count);
+    reader_.bytes(l.strings, l.strings_size);
+    strings_ = l.strings;
+    for (std::uint64_t s = 0; s < slot_count_; ++s)
+        if (check_[s] >= 0 && static_cast<std::uint64_t>(base_[s]) + kSymbols > slot_count_)
+            throw Error(path + ": automaton out of bounds");
+}
+
+std::vector<std::uint32_t> DeprecationTable::find(std::string_view name) const {
+    const DeprecationRecord* last = records_ + record_count_;
+    auto [lo, hi] = std::equal_range(records_, last, name, [&](const auto& a, const auto& b) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(a)>, DeprecationRecord>)
+            return str(a.name) < b;
+        else
+            return a < str(b.name);
+    });
+    std::vector<std::uint32_t> out;
+    for (const DeprecationRecord* r = lo; r != hi; ++r)
+        out.push_back(static_cast<std::uint32_t>(r - records_));
+    return out;
+}
+
+bool DeprecationTable::declares(std::size_t p, std::string_view parent) const {
+    for (std::uint32_t id : records(p))
+        if (str(records_[id].parent) == parent)
+            return true;
+    return false;
+}
+
+void DeprecationTable::scan(std::string_view text, std::vector<DeprecationHit>& out) const {
+    constexpr std::int32_t kDead = -1;
+    std::int32_t state = 0;
+    std::uint64_t start = 0;
+    const auto* p = reinterpret_cast<const unsigned char*>(text.data());
+    auto emit = [&](std::int32_t s, std::uint64_t end) {
+        std::uint32_t t = terminal_[s];
+        if (!t)
+            return;
+        std::uint32_t flags = patterns_[t - 1].flags;
+        DeprecationHit hit{start, t - 1, static_cast<std::uint32_t>(end - start)};
+        if (flags) {
+            std::uint64_t i = start;
+            while (i > 0 && (p[i - 1] == ' ' || p[i - 1] == '\t' || p[i - 1] == '\n' || p[i - 1] == '\r'))
+                --i;
+            if (i == 0)
+                return;
+            if (flags & DeprecationPattern::kMember) {
+                // After "." or "->", or after a receiver ending in an
+                // identifier, ']' or ')' as in a message send.
+                unsigned char prev = p[i - 1];
+                bool receiver = prev == '.' || (prev == '>' && i > 1 && p[i - 2] == '-') || prev == ']' ||
+                                prev == ')' || (kCodes[prev] && prev != ':' && i < start);
+                if (!receiver)
+                    return;
+            }
+            if (flags & DeprecationPattern::kShared) {
+                std::string_view cls = receiver_class(text, i);
+                if (cls.empty() || !declares(t - 1, cls))
+                    return;
+                hit.receiver = static_cast<std::uint64_t>(cls.data() - text.data());
+                hit.receiver_length = static_cast<std::uint32_t>(cls.size());
+            }
+        }
+        out.push_back(hit);
+    };
+    for (std::uint64_t i = 0; i < text.size(); ++i) {
+        std::uint8_t sym = kCodes[p[i]];
+        if (sym == 0) {
+            // Boundary: a pattern without a colon ends here.
+            if (state > 0)
+                emit(state, i);
+            state = 0;
+            i = skip_inert(text, i);
+            continue;
+        }
+        if (state == kDead)
+            continue;
+        if (state == 0) {
+            // An identifier starts only after a boundary or a colon; the
+            // digits of a number never reach the trie, which has no pattern
+            // starting with one.
+            start = i;
+        }
+        std::int32_t next = base_[state] + sym;
+        state = check_[next] == state ? next : kDead;
+        if (sym == kColon) {
+            if (state != kDead)
+                emit(state, i + 1);
+            state = 0;
+        }
+    }
+    if (state > 0)
+        emit(state, text.size());
+}
+
+} // namespace moby
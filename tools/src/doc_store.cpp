@@ -0,0 +1,814 @@
+#include "moby/doc_store.h"
+
+#include "moby/lexer.h"
+#include "moby/section_index.h"
+#include "moby/symbols.h"
+#include "moby/work_pool.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <filesystem>
+#include <iterator>
+#include <numeric>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+namespace {
+
+constexpr std::uint32_t kNoDoc = ~0u;
+
+struct DocLayout {
+    std::uint64_t symbol_count;
+    std::uint64_t entry_count;
+    std::uint64_t block_count;
+    std::uint64_t entries;
+    std::uint64_t blocks;
+    std::uint64_t dictionary;
+    std::uint64_t dictionary_size;
+};
+
+// Raw deflate, as in the corpus archive: blocks are small and their length is
+// checked on the way out. Blocks use the fixed Huffman codes: on a block of a
+// kilobyte, building dynamic code tables takes about as long as decoding it,
+// which lookups notice more than the few percent of space the codes save.
+constexpr int kWindowBits = -15;
+
+// Phrases shorter than this cost about as much to reference as to spell out.
+constexpr std::size_t kMinPhrase = 8;
+
+// True when the comment at `i`, running to `end`, is documentation: "/*!" or
+// "/**", but not the empty "/**/" or a "/*****" banner.
+bool is_doc_comment(std::string_view text, std::size_t i, std::size_t end) {
+    if (end - i < 5)
+        return false;
+    return text[i + 2] == '!' || (text[i + 2] == '*' && text[i + 3] != '*' && text[i + 3] != '/');
+}
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && is_space(s.front()))
+        s.remove_prefix(1);
+    while (!s.empty() && is_space(s.back()))
+        s.remove_suffix(1);
+    return s;
+}
+
+// Tags whose first word names what they describe.
+bool is_named_tag(std::string_view tag) {
+    for (std::string_view t : {"param", "constant", "field", "var", "callback", "throws", "exception", "tparam",
+                               "templatefield", "method", "function", "property", "typedef", "enum", "struct",
+                               "union", "class", "protocol", "category", "interface", "define", "defined", "group",
+                               "functiongroup", "name"})
+        if (tag == t)
+            return true;
+    return false;
+}
+
+// Inline markup that may start a line without starting a tag, and the ends
+// of code blocks opened within a line.
+bool is_inline_tag(std::string_view tag) {
+    for (std::string_view t : {"c", "p", "a", "b", "i", "em", "link", "/link", "ref", "/code", "endcode", "/textblock",
+                               "endtextblock"})
+        if (tag == t)
+            return true;
+    return false;
+}
+
+// Comments about the file or a group of declarations rather than the one
+// that follows.
+bool is_file_tag(std::string_view tag) {
+    for (std::string_view t : {"header", "framework", "file", "copyright", "group", "functiongroup", "name",
+                               "indexgroup", "methodgroup", "define", "defined", "updated"})
+        if (tag == t)
+            return true;
+    return false;
+}
+
+std::string_view canonical_tag(std::string_view tag) {
+    if (tag == "brief")
+        return "abstract";
+    if (tag == "return" || tag == "returns")
+        return "result";
+    if (tag == "const")
+        return "constant";
+    if (tag == "seealso")
+        return "see";
+    return tag;
+}
+
+bool is_list_item(std::string_view line) {
+    if (line.size() > 1 && (line[0] == '-' || line[0] == '*' || line[0] == '+') && line[1] == ' ')
+        return true;
+    if (line.substr(0, 3) == "\xE2\x80\xA2")  // U+2022 bullet
+        return true;
+    std::size_t digits = 0;
+    while (digits < line.size() && std::isdigit(static_cast<unsigned char>(line[digits])))
+        ++digits;
+    return digits > 0 && digits + 1 < line.size() && (line[digits] == '.' || line[digits] == ')') &&
+           line[digits + 1] == ' ';
+}
+
+// Lines of a tag's text joined into paragraphs.
+class TextBuilder {
+public:
+    explicit TextBuilder(std::string& out) : out_(out) {}
+
+    void line(std::string_view l) {
+        l = trim(l);
+        if (l.empty()) {
+            if (!out_.empty())
+                brk_ = std::max(brk_, 2);
+            return;
+        }
+        if (is_list_item(l))
+            brk_ = std::max(brk_, 1);
+        append(l);
+    }
+
+    // Code keeps its lines and their indentation beyond `indent` columns.
+    void code(const std::vector<std::string_view>& lines) {
+        std::size_t indent = std::string_view::npos;
+        for (std::string_view l : lines) {
+            std::size_t at = l.find_first_not_of(" \t");
+            if (at != std::string_view::npos)
+                indent = std::min(indent, at);
+        }
+        for (std::string_view l : lines) {
+            while (!l.empty() && is_space(l.back()))
+                l.remove_suffix(1);
+            brk_ = std::max(brk_, 1);
+            append(l.size() > indent ? l.substr(indent) : std::string_view());
+        }
+        brk_ = std::max(brk_, 1);
+    }
+
+private:
+    void append(std::string_view l) {
+        if (!out_.empty())
+            out_.append(brk_ == 2 ? "\n\n" : brk_ == 1 ? "\n" : " ");
+        out_.append(l);
+        brk_ = 0;
+    }
+
+    std::string& out_;
+    int brk_ = 0;  // break owed before the next text: 0 a space, 1 a line, 2 a paragraph
+};
+
+// Only whitespace, ordinary comments, preprocessor conditionals, attribute or
+// export macros, forward @class and @protocol declarations and markers such
+// as @optional, so that a comment before `gap` documents what follows it.
+// With `enum_head`, `gap` must instead be the head of an enum up to its
+// brace: "enum : UInt32", "CF_ENUM(UInt32)".
+bool plain_gap(std::string_view gap, bool enum_head = false) {
+    std::size_t i = 0, n = gap.size();
+    bool saw_enum = false;
+    auto skip_parens = [&] {
+        while (i < n && is_space(gap[i]))
+            ++i;
+        if (i == n || gap[i] != '(')
+            return;
+        int depth = 0;
+        for (; i < n; ++i) {
+            if (gap[i] == '(')
+                ++depth;
+            else if (gap[i] == ')' && --depth == 0) {
+                ++i;
+                return;
+            }
+        }
+    };
+    while (i < n) {
+        char c = gap[i];
+        if (is_space(c)) {
+            ++i;
+        } else if (gap.substr(i, 2) == "//") {
+            std::size_t nl = gap.find('\n', i);
+            i = nl == std::string_view::npos ? n : nl + 1;
+        } else if (gap.substr(i, 2) == "/*") {
+            std::size_t close = gap.find("*/", i + 2);
+            std::size_t end = close == std::string_view::npos ? n : close + 2;
+            if (is_doc_comment(gap, i, end))
+                return false;  // the later comment is the one that documents it
+            i = end;
+        } else if (c == '#') {
+            std::size_t at = i + 1;
+            while (at < n && (gap[at] == ' ' || gap[at] == '\t'))
+                ++at;
+            std::size_t word = at;
+            while (at < n && is_ident_char(gap[at]))
+                ++at;
+            std::string_view directive = gap.substr(word, at - word);
+            if (directive == "define" || directive == "undef" || directive == "error")
+                return false;
+            for (;;) {  // to the end of the line, through continuations
+                std::size_t nl = gap.find('\n', at);
+                if (nl == std::string_view::npos) {
+                    i = n;
+                    break;
+                }
+                if (nl > 0 && gap[nl - 1] == '\\') {
+                    at = nl + 1;
+                    continue;
+                }
+                i = nl + 1;
+                break;
+            }
+        } else if (c == '@' && !enum_head) {
+            std::size_t at = i + 1;
+            while (at < n && is_ident_char(gap[at]))
+                ++at;
+            std::string_view word = gap.substr(i + 1, at - i - 1);
+            if (word == "class" || word == "protocol") {
+                std::size_t semi = gap.find(';', at);
+                if (semi == std::string_view::npos || gap.substr(at, semi - at).find_first_of("<{") != std::string_view::npos)
+                    return false;
+                i = semi + 1;
+            } else if (word == "optional" || word == "required" || word == "public" || word == "protected" ||
+                       word == "private" || word == "package") {
+                i = at;
+            } else {
+                return false;
+            }
+        } else if (is_ident_char(c)) {
+            std::size_t start = i;
+            while (i < n && is_ident_char(gap[i]))
+                ++i;
+            std::string_view ident = gap.substr(start, i - start);
+            bool macro = is_macro_name(ident);
+            if (enum_head) {
+                saw_enum = saw_enum || ident == "enum" ||
+                           (ident.size() > 5 && ident.substr(ident.size() - 5) == "_ENUM") ||
+                           (ident.size() > 8 && ident.substr(ident.size() - 8) == "_OPTIONS");
+            } else if (!macro && ident != "extern" && ident != "static" && ident != "inline") {
+                return false;
+            }
+            if (macro)
+                skip_parens();
+        } else if (c == ':' && enum_head) {
+            ++i;
+        } else {
+            return false;
+        }
+    }
+    return !enum_head || saw_enum;
+}
+
+void put_string(std::string& out, std::string_view s) {
+    put_varint(out, s.size());
+    out.append(s);
+}
+
+std::string serialize(const DocComment& doc) {
+    std::string out;
+    put_varint(out, doc.tags.size());
+    for (const DocTag& t : doc.tags) {
+        put_string(out, t.tag);
+        put_string(out, t.name);
+        put_string(out, t.text);
+    }
+    return out;
+}
+
+bool read_string(const unsigned char*& p, const unsigned char* end, std::string& out) {
+    if (p >= end)
+        return false;
+    std::uint64_t n = get_varint(p);
+    if (p > end || n > static_cast<std::uint64_t>(end - p))
+        return false;
+    out.assign(reinterpret_cast<const char*>(p), n);
+    p += n;
+    return true;
+}
+
+bool deserialize(std::string_view record, DocComment& out) {
+    out.tags.clear();
+    const auto* p = reinterpret_cast<const unsigned char*>(record.data());
+    const unsigned char* end = p + record.size();
+    if (p == end)
+        return false;
+    std::uint64_t count = get_varint(p);
+    if (p > end || count > record.size())
+        return false;
+    out.tags.resize(count);
+    for (DocTag& t : out.tags)
+        if (!read_string(p, end, t.tag) || !read_string(p, end, t.name) || !read_string(p, end, t.text))
+            return false;
+    return p == end;
+}
+
+std::string deflate_block(std::string_view raw, std::string_view dictionary, int level) {
+    z_stream z{};
+    if (deflateInit2(&z, level, Z_DEFLATED, kWindowBits, 9, Z_FIXED) != Z_OK)
+        throw Error("deflateInit2 failed");
+    if (!dictionary.empty())
+        deflateSetDictionary(&z, reinterpret_cast<const Bytef*>(dictionary.data()),
+                             static_cast<uInt>(dictionary.size()));
+    std::string out(deflateBound(&z, static_cast<uLong>(raw.size())), '\0');
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(raw.data()));
+    z.avail_in = static_cast<uInt>(raw.size());
+    z.next_out = reinterpret_cast<Bytef*>(out.data());
+    z.avail_out = static_cast<uInt>(out.size());
+    int rc = deflate(&z, Z_FINISH);
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    if (rc != Z_STREAM_END)
+        throw Error("deflate failed");
+    return out;
+}
+
+// Sentences and lines of the documentation, scored like the archive's
+// dictionary lines: (comments containing it - 1) x length. "Specifies whether
+// ..." and the stock parameter descriptions repeat across frameworks; what
+// only one comment says is left to its block's window.
+std::string train_dictionary(const std::vector<DocComment>& docs, std::size_t size) {
+    struct Phrase {
+        std::uint32_t docs = 0;
+        std::uint32_t last = ~0u;
+    };
+    std::unordered_map<std::string_view, Phrase> phrases;
+    for (std::uint32_t d = 0; d < docs.size(); ++d) {
+        for (const DocTag& t : docs[d].tags) {
+            std::string_view text = t.text;
+            for (std::size_t begin = 0; begin < text.size();) {
+                std::size_t end = text.find_first_of(".\n", begin);
+                end = end == std::string_view::npos ? text.size() : end + 1;
+                std::string_view phrase = text.substr(begin, end - begin);
+                begin = end;
+                if (phrase.size() < kMinPhrase)
+                    continue;
+                Phrase& p = phrases[phrase];
+                if (p.last != d) {
+                    p.last = d;
+                    ++p.docs;
+                }
+            }
+        }
+    }
+
+    std::vector<std::pair<std::uint64_t, std::string_view>> scored;
+    for (const auto& [phrase, p] : phrases)
+        if (p.docs > 1)
+            scored.emplace_back(std::uint64_t(p.docs - 1) * phrase.size(), phrase);
+    std::sort(scored.begin(), scored.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    std::vector<std::string_view> chosen;
+    std::size_t total = 0;
+    for (const auto& [score, phrase] : scored) {
+        if (total + phrase.size() > size)
+            continue;
+        chosen.push_back(phrase);
+        total += phrase.size();
+    }
+    std::string dictionary;
+    dictionary.reserve(total);
+    for (auto it = chosen.rbegin(); it != chosen.rend(); ++it)
+        dictionary.append(*it);
+    return dictionary;
+}
+
+} // namespace
+
+const DocTag* DocComment::find(std::string_view tag) const {
+    for (const DocTag& t : tags)
+        if (t.tag == tag)
+            return &t;
+    return nullptr;
+}
+
+void parse_doc_comment(std::string_view comment, DocComment& out) {
+    out.tags.clear();
+    comment.remove_prefix(std::min<std::size_t>(3, comment.size()));
+    if (comment.size() >= 2 && comment.substr(comment.size() - 2) == "*/")
+        comment.remove_suffix(2);
+    if (!comment.empty() && comment[0] == '<')  // trailing "/*!<"
+        comment.remove_prefix(1);
+
+    std::vector<std::string_view> lines;
+    for (std::size_t begin = 0; begin <= comment.size();) {
+        std::size_t end = comment.find('\n', begin);
+        if (end == std::string_view::npos)
+            end = comment.size();
+        lines.push_back(comment.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    // " * " decoration, when every line after the first carries it.
+    bool decorated = lines.size() > 1;
+    for (std::size_t i = 1; i < lines.size() && decorated; ++i) {
+        std::string_view l = trim(lines[i]);
+        decorated = l.empty() || l[0] == '*';
+    }
+    if (decorated) {
+        for (std::size_t i = 1; i < lines.size(); ++i) {
+            std::size_t star = lines[i].find('*');
+            if (star == std::string_view::npos)
+                continue;
+            lines[i].remove_prefix(star + 1);
+            if (!lines[i].empty() && lines[i][0] == ' ')
+                lines[i].remove_prefix(1);
+        }
+    }
+
+    std::unique_ptr<TextBuilder> text;
+    std::vector<std::string_view> code;
+    bool in_code = false;
+    auto start_tag = [&](std::string_view tag) {
+        out.tags.push_back({std::string(tag), {}, {}});
+        text = std::make_unique<TextBuilder>(out.tags.back().text);
+    };
+    for (std::string_view raw : lines) {
+        std::string_view l = trim(raw);
+        if (in_code) {
+            if (l == "@endcode" || l == "@/textblock" || l == "@endtextblock") {
+                text->code(code);
+                code.clear();
+                in_code = false;
+            } else {
+                code.push_back(raw);
+            }
+            continue;
+        }
+        std::string_view word;
+        if (l.size() > 1 && l[0] == '@') {
+            std::size_t end = 1;
+            while (end < l.size() && (is_ident_char(l[end]) || l[end] == '/'))
+                ++end;
+            word = l.substr(1, end - 1);
+        }
+        if (word == "code" || word == "textblock") {
+            if (!text)
+                start_tag("discussion");
+            std::string_view rest = trim(l.substr(word.size() + 1));
+            if (!rest.empty())
+                code.push_back(rest);
+            in_code = true;
+            continue;
+        }
+        if (word.empty() || is_inline_tag(word)) {
+            if (!l.empty() && !text)
+                start_tag("discussion");
+            if (text)
+                text->line(l);
+            continue;
+        }
+        std::string_view tag = canonical_tag(word);
+        start_tag(tag);
+        std::string_view rest = trim(l.substr(word.size() + 1));
+        if (is_named_tag(tag)) {
+            std::size_t space = rest.find_first_of(" \t");
+            out.tags.back().name = std::string(rest.substr(0, space));
+            rest = space == std::string_view::npos ? std::string_view() : trim(rest.substr(space));
+        }
+        text->line(rest);
+    }
+    if (in_code)
+        text->code(code);
+}
+
+void for_each_doc_comment(std::string_view text, const std::function<void(std::size_t, std::size_t)>& fn) {
+    std::size_t i = 0, n = text.size();
+    while (i < n) {
+        char c = text[i];
+        if (c == '/' && i + 1 < n && text[i + 1] == '/') {
+            std::size_t nl = text.find('\n', i);
+            i = nl == std::string_view::npos ? n : nl + 1;
+        } else if (c == '/' && i + 1 < n && text[i + 1] == '*') {
+            std::size_t close = text.find("*/", i + 2);
+            std::size_t end = close == std::string_view::npos ? n : close + 2;
+            if (is_doc_comment(text, i, end))
+                fn(i, end);
+            i = end;
+        } else if (c == '"' || c == '\'') {
+            // Literals end at their quote or, left open, at the end of the line.
+            for (++i; i < n && text[i] != c && text[i] != '\n'; ++i)
+                if (text[i] == '\\')
+                    ++i;
+            ++i;
+        } else {
+            ++i;
+        }
+    }
+}
+
+std::string DocStore::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "docs.store").string();
+}
+
+DocStoreStats DocStore::build(const Corpus& corpus, const SymbolDb& symbols, const std::string& path,
+                              const DocStoreOptions& options) {
+    const auto& sections = corpus.sections();
+    if (symbols.section_count() != sections.size())
+        throw Error("symbols.db does not match the corpus");
+    std::vector<std::vector<std::uint32_t>> by_section(sections.size());
+    for (std::uint32_t id = 0; id < symbols.size(); ++id)
+        by_section[symbols.at(id).section].push_back(id);
+
+    DocStoreStats stats;
+    std::vector<DocComment> docs;  // in corpus order
+    std::vector<std::uint32_t> doc_of(symbols.size(), kNoDoc);
+    for (std::size_t s = 0; s < sections.size(); ++s) {
+        std::vector<std::uint32_t>& ids = by_section[s];
+        std::stable_sort(ids.begin(), ids.end(), [&](std::uint32_t a, std::uint32_t b) {
+            const SymbolRecord& ra = symbols.at(a);
+            const SymbolRecord& rb = symbols.at(b);
+            return ra.offset != rb.offset ? ra.offset < rb.offset : ra.length > rb.length;
+        });
+        std::string_view text = sections[s].text;
+        std::uint64_t base = sections[s].offset;
+
+        // A comment goes to the declaration after it, and to every symbol
+        // starting there. One following code on its line (or opening with
+        // "/*!<") describes what precedes it instead: a parameter, field or
+        // enum constant, or the variable it interrupts. So does one inside a
+        // declaration that nothing follows closely: `@param` lines written
+        // between a function's parameters. Those add their tags to the
+        // declaration's documentation.
+        std::size_t next = 0;
+        std::deque<std::pair<std::pair<std::uint64_t, std::uint64_t>, DocComment>> enum_docs;
+        auto attach = [&](std::size_t k, DocComment& doc) {
+            std::uint64_t at = symbols.at(ids[k]).offset;
+            while (k > 0 && symbols.at(ids[k - 1]).offset == at)
+                --k;
+            std::uint32_t d = doc_of[ids[k]];
+            if (d != kNoDoc) {
+                std::move(doc.tags.begin(), doc.tags.end(), std::back_inserter(docs[d].tags));
+                return;
+            }
+            for (; k < ids.size() && symbols.at(ids[k]).offset == at; ++k)
+                doc_of[ids[k]] = static_cast<std::uint32_t>(docs.size());
+            docs.push_back(std::move(doc));
+        };
+        auto contains = [&](std::size_t k, std::size_t begin, std::size_t end) {
+            const SymbolRecord& r = symbols.at(ids[k]);
+            return r.offset <= base + begin && base + end <= r.offset + r.length;
+        };
+        for_each_doc_comment(text, [&](std::size_t begin, std::size_t end) {
+            ++stats.comments;
+            while (next < ids.size() && symbols.at(ids[next]).offset < base + end)
+                ++next;
+            std::size_t line = text.rfind('\n', begin);
+            line = line == std::string_view::npos ? 0 : line + 1;
+            bool trailing = text[begin + 3] == '<' || !trim(text.substr(line, begin - line)).empty();
+
+            std::size_t target = ids.size();
+            if (trailing && next > 0) {
+                const SymbolRecord& r = symbols.at(ids[next - 1]);
+                std::uint64_t r_end = r.offset + r.length - base;
+                if (contains(next - 1, begin, end) ||
+                    (r_end <= begin && text.substr(r_end, begin - r_end).find('\n') == std::string_view::npos))
+                    target = next - 1;
+            } else if (next < ids.size() && plain_gap(text.substr(end, symbols.at(ids[next]).offset - base - end))) {
+                target = next;
+            }
+            if (target == ids.size()) {
+                for (std::size_t k = next; k-- > 0;) {
+                    if (!contains(k, begin, end))
+                        continue;
+                    // Inside a container only its head counts: the comment
+                    // after MPS_CLASS_AVAILABLE(...) and before @interface.
+                    SymbolKind kind = symbols.at(ids[k]).kind;
+                    if (kind != SymbolKind::Interface && kind != SymbolKind::Category &&
+                        kind != SymbolKind::Protocol) {
+                        target = k;
+                    } else {
+                        std::size_t at = text.find('@', end);
+                        if (at != std::string_view::npos &&
+                            (text.substr(at, 10) == "@interface" || text.substr(at, 9) == "@protocol") &&
+                            plain_gap(text.substr(end, at - end)))
+                            target = k;
+                    }
+                    break;
+                }
+            }
+            std::size_t brace = text.find('{', end);
+            bool enum_scope = target == ids.size() && next < ids.size() && brace != std::string_view::npos &&
+                              base + brace < symbols.at(ids[next]).offset &&
+                              plain_gap(text.substr(end, brace - end), true);
+            if (enum_scope) {
+                std::size_t close = text.find('}', brace);
+                close = close == std::string_view::npos ? text.size() : close + 1;
+                DocComment doc;
+                parse_doc_comment(text.substr(begin, end - begin), doc);
+                ++stats.attached;
+                enum_docs.push_back({{base + brace, base + close}, std::move(doc)});
+                return;
+            }
+            if (target == ids.size())
+                return;
+            DocComment doc;
+            parse_doc_comment(text.substr(begin, end - begin), doc);
+            if (doc.tags.empty() || is_file_tag(doc.tags[0].tag))
+                return;
+            ++stats.attached;
+            attach(target, doc);
+        });
+
+        // Members take their line from the innermost documented scope that
+        // names them: a documented symbol, or the braces of an anonymous enum
+        // whose comment lists its constants.
+        struct Scope {
+            std::uint64_t begin, end;
+            const DocComment* doc;
+        };
+        std::vector<Scope> scopes;
+        for (std::uint32_t id : ids)
+            if (doc_of[id] != kNoDoc)
+                scopes.push_back({symbols.at(id).offset, symbols.at(id).offset + symbols.at(id).length,
+                                  &docs[doc_of[id]]});
+        for (const auto& [span, doc] : enum_docs)
+            scopes.push_back({span.first, span.second, &doc});
+        std::stable_sort(scopes.begin(), scopes.end(), [](const Scope& a, const Scope& b) {
+            return a.begin != b.begin ? a.begin < b.begin : a.end > b.end;
+        });
+        std::vector<const Scope*> open;
+        std::vector<std::pair<std::uint32_t, DocComment>> inherited;
+        std::size_t next_scope = 0;
+        for (std::uint32_t id : ids) {
+            const SymbolRecord& r = symbols.at(id);
+            for (; next_scope < scopes.size() && scopes[next_scope].begin <= r.offset; ++next_scope) {
+                while (!open.empty() && open.back()->end <= scopes[next_scope].begin)
+                    open.pop_back();
+                open.push_back(&scopes[next_scope]);
+            }
+            while (!open.empty() && open.back()->end < r.offset + r.length)
+                open.pop_back();
+            if (doc_of[id] != kNoDoc)
+                continue;
+            std::string_view name = symbols.name(r);
+            const DocTag* found = nullptr;
+            for (auto it = open.rbegin(); it != open.rend() && !found; ++it)
+                for (const DocTag& t : (*it)->doc->tags)
+                    if ((t.tag == "constant" || t.tag == "field" || t.tag == "var") && t.name == name) {
+                        found = &t;
+                        break;
+                    }
+            if (found)
+                inherited.push_back({id, DocComment{{*found}}});
+        }
+        for (auto& [id, doc] : inherited) {
+            doc_of[id] = static_cast<std::uint32_t>(docs.size());
+            docs.push_back(std::move(doc));
+        }
+        stats.inherited += inherited.size();
+    }
+
+    std::string dictionary = options.dictionary_size ? train_dictionary(docs, options.dictionary_size)
+                                                     : std::string();
+
+    // Records in corpus order, cut into blocks of about block_size bytes.
+    std::vector<std::string> raw_blocks(1);
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> placed(docs.size());  // block, offset
+    std::vector<std::uint32_t> lengths(docs.size());
+    for (std::size_t d = 0; d < docs.size(); ++d) {
+        if (raw_blocks.back().size() >= options.block_size)
+            raw_blocks.emplace_back();
+        std::string record = serialize(docs[d]);
+        placed[d] = {static_cast<std::uint32_t>(raw_blocks.size() - 1),
+                     static_cast<std::uint32_t>(raw_blocks.back().size())};
+        lengths[d] = static_cast<std::uint32_t>(record.size());
+        raw_blocks.back().append(record);
+    }
+
+    std::vector<DocEntry> entries;
+    for (std::uint32_t id = 0; id < doc_of.size(); ++id)
+        if (doc_of[id] != kNoDoc)
+            entries.push_back({id, placed[doc_of[id]].first, placed[doc_of[id]].second, lengths[doc_of[id]]});
+
+    BlobWriter w(kMagic, kVersion, symbols.corpus_hash());
+    std::size_t layout_at = w.put(DocLayout{});
+    DocLayout layout{};
+    layout.symbol_count = symbols.size();
+    layout.entry_count = entries.size();
+    layout.block_count = raw_blocks.size();
+    layout.entries = w.put_array(entries);
+    std::vector<DocBlock> blocks(raw_blocks.size());
+    layout.blocks = w.put_array(blocks);
+    layout.dictionary = w.put_bytes(dictionary.data(), dictionary.size());
+    layout.dictionary_size = dictionary.size();
+    std::vector<std::string> stored(raw_blocks.size());
+    std::vector<std::uint32_t> tasks(raw_blocks.size());
+    std::iota(tasks.begin(), tasks.end(), 0);
+    run_stealing(tasks, options.threads, [&](std::uint32_t b) {
+        stored[b] = deflate_block(raw_blocks[b], dictionary, options.level);
+        if (stored[b].size() >= raw_blocks[b].size())
+            stored[b] = raw_blocks[b];
+    });
+    for (std::size_t b = 0; b < raw_blocks.size(); ++b) {
+        blocks[b].length = static_cast<std::uint32_t>(raw_blocks[b].size());
+        blocks[b].stored = static_cast<std::uint32_t>(stored[b].size());
+        blocks[b].offset = w.put_bytes(stored[b].data(), stored[b].size());
+        w.patch(layout.blocks + b * sizeof(DocBlock), blocks[b]);
+        stats.raw_bytes += blocks[b].length;
+        stats.stored_bytes += blocks[b].stored;
+    }
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+
+    stats.documented = entries.size();
+    stats.blocks = raw_blocks.size();
+    stats.bytes = fs::file_size(path);
+    return stats;
+}
+
+struct DocStore::Inflater {
+    z_stream z{};
+
+    Inflater() {
+        if (inflateInit2(&z, kWindowBits) != Z_OK)
+            throw Error("inflateInit2 failed");
+    }
+    ~Inflater() { inflateEnd(&z); }
+};
+
+DocStore::DocStore(const std::string& path) : reader_(path, kMagic, kVersion) {
+    const DocLayout& l = *reader_.array<DocLayout>(sizeof(BlobHeader), 1);
+    symbol_count_ = l.symbol_count;
+    entry_count_ = l.entry_count;
+    block_count_ = l.block_count;
+    entries_ = reader_.array<DocEntry>(l.entries, l.entry_count);
+    blocks_ = reader_.array<DocBlock>(l.blocks, l.block_count);
+    dictionary_ = reader_.bytes(l.dictionary, l.dictionary_size);
+    for (std::uint64_t b = 0; b < block_count_; ++b) {
+        reader_.bytes(blocks_[b].offset, blocks_[b].stored);
+        if (blocks_[b].stored > blocks_[b].length)
+            throw Error(path + ": malformed doc block");
+    }
+    for (std::uint64_t i = 0; i < entry_count_; ++i) {
+        const DocEntry& e = entries_[i];
+        if (e.symbol >= symbol_count_ || (i > 0 && e.symbol <= entries_[i - 1].symbol) || e.block >= block_count_ ||
+            e.offset > blocks_[e.block].length || e.length > blocks_[e.block].length - e.offset)
+            throw Error(path + ": malformed doc entry");
+    }
+}
+
+DocStore::~DocStore() = default;
+DocStore::DocStore(DocStore&&) noexcept = default;
+DocStore& DocStore::operator=(DocStore&&) noexcept = default;
+
+const DocEntry* DocStore::find(std::uint32_t symbol) const {
+    const DocEntry* it = std::lower_bound(entries_, entries_ + entry_count_, symbol,
+                                          [](const DocEntry& e, std::uint32_t s) { return e.symbol < s; });
+    return it != entries_ + entry_count_ && it->symbol == symbol ? it : nullptr;
+}
+
+bool DocStore::read(std::uint32_t symbol, DocComment& out) const {
+    const DocEntry* e = find(symbol);
+    if (!e) {
+        out.tags.clear();
+        return false;
+    }
+    read(*e, out);
+    return true;
+}
+
+// Raw blocks are parsed in place. A compressed one is inflated only as far as
+// the record ends; reading further into the same block resumes the stream.
+void DocStore::read(const DocEntry& e, DocComment& out) const {
+    const DocBlock& b = blocks_[e.block];
+    std::string_view stored = reader_.bytes(b.offset, b.stored);
+    std::string_view record;
+    if (b.stored == b.length) {
+        record = stored.substr(e.offset, e.length);
+    } else {
+        if (!inflater_)
+            inflater_ = std::make_unique<Inflater>();
+        z_stream& z = inflater_->z;
+        if (block_id_ != e.block) {
+            block_id_ = ~0u;
+            inflateReset(&z);
+            if (!dictionary_.empty())
+                inflateSetDictionary(&z, reinterpret_cast<const Bytef*>(dictionary_.data()),
+                                     static_cast<uInt>(dictionary_.size()));
+            block_text_.resize(b.length);
+            z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(stored.data()));
+            z.avail_in = b.stored;
+            block_ready_ = 0;
+            block_id_ = e.block;
+        }
+        if (block_ready_ < e.offset + e.length) {
+            z.next_out = reinterpret_cast<Bytef*>(block_text_.data() + block_ready_);
+            z.avail_out = e.offset + e.length - block_ready_;
+            int rc = inflate(&z, Z_SYNC_FLUSH);
+            block_ready_ = e.offset + e.length - z.avail_out;
+            if ((rc != Z_OK && rc != Z_STREAM_END) || z.avail_out != 0) {
+                block_id_ = ~0u;
+                throw Error("corrupt doc block " + std::to_string(e.block));
+            }
+        }
+        record = std::string_view(block_text_).substr(e.offset, e.length);
+    }
+    if (!deserialize(record, out))
+        throw Error("corrupt doc record for symbol " + std::to_string(e.symbol));
+}
+
+} // namespace moby
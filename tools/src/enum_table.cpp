@@ -0,0 +1,706 @@
+#include "moby/enum_table.h"
+
+#include "moby/const_expr.h"
+#include "moby/hash.h"
+#include "moby/lexer.h"
+#include "moby/perfect_hash.h"
+#include "moby/section_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+
+struct EnumTable::Run {
+    std::uint64_t key;    // the value, for value runs; unused for name runs
+    StrRef name;          // the name, for name runs
+    std::uint32_t first;  // into by_name_ / by_value_
+    std::uint32_t count;
+};
+
+namespace {
+
+struct EnumLayout {
+    std::uint64_t enum_count;
+    std::uint64_t named_enum_count;
+    std::uint64_t constant_count;
+    std::uint64_t name_run_count;
+    std::uint64_t value_run_count;
+    std::uint64_t resolved_count;
+    std::uint64_t name_buckets, name_slot_count;
+    std::uint64_t value_buckets, value_slot_count;
+    std::uint64_t enums;
+    std::uint64_t constants;
+    std::uint64_t enums_by_name;
+    std::uint64_t by_name;
+    std::uint64_t by_value;
+    std::uint64_t name_runs;
+    std::uint64_t value_runs;
+    std::uint64_t name_displacements, name_slots;
+    std::uint64_t value_displacements, value_slots;
+    std::uint64_t strings;
+    std::uint64_t strings_size;
+    StrRef target;
+};
+
+// Forward references settle in one extra pass per link of the chain.
+constexpr int kMaxPasses = 8;
+
+struct TypeInfo {
+    std::string_view name;
+    std::uint8_t width;  // 0: as wide as a pointer
+    bool is_signed;
+};
+
+// Underlying types of the corpus's enums.
+constexpr TypeInfo kTypes[] = {
+    {"NSInteger", 0, true},      {"NSUInteger", 0, false},    {"CFIndex", 0, true},
+    {"CFOptionFlags", 0, false}, {"long", 0, true},           {"unsigned long", 0, false},
+    {"long long", 64, true},     {"unsigned long long", 64, false}, {"size_t", 0, false},
+    {"int64_t", 64, true},       {"uint64_t", 64, false},     {"SInt64", 64, true},
+    {"UInt64", 64, false},       {"intptr_t", 0, true},       {"uintptr_t", 0, false},
+    {"int", 32, true},           {"unsigned int", 32, false}, {"unsigned", 32, false},
+    {"int32_t", 32, true},       {"uint32_t", 32, false},     {"SInt32", 32, true},
+    {"UInt32", 32, false},       {"OSStatus", 32, true},      {"OSType", 32, false},
+    {"FourCharCode", 32, false}, {"CFStringEncoding", 32, false}, {"GLenum", 32, false},
+    {"short", 16, true},         {"unsigned short", 16, false}, {"int16_t", 16, true},
+    {"uint16_t", 16, false},     {"SInt16", 16, true},        {"UInt16", 16, false},
+    {"OSErr", 16, true},         {"char", 8, true},           {"signed char", 8, true},
+    {"unsigned char", 8, false}, {"int8_t", 8, true},         {"uint8_t", 8, false},
+    {"SInt8", 8, true},          {"UInt8", 8, false},         {"BOOL", 8, true},
+    {"bool", 8, false},
+};
+
+std::optional<TypeInfo> type_info(std::string_view type, unsigned pointer_bits) {
+    for (TypeInfo t : kTypes) {
+        if (t.name != type)
+            continue;
+        if (t.width == 0)
+            t.width = static_cast<std::uint8_t>(pointer_bits);
+        return t;
+    }
+    return std::nullopt;
+}
+
+// Limits and constants the initializers use that are macros, not enumerators.
+std::optional<ConstValue> builtin_constant(std::string_view name, unsigned pointer_bits) {
+    static const std::unordered_map<std::string_view, ConstValue> kFixed = {
+        {"kCFNotFound", ConstValue::of(-1)},       {"INT_MAX", ConstValue::of(INT32_MAX)},
+        {"INT_MIN", ConstValue::of(INT32_MIN)},    {"UINT_MAX", ConstValue::of(UINT32_MAX)},
+        {"INT8_MAX", ConstValue::of(INT8_MAX)},    {"INT16_MAX", ConstValue::of(INT16_MAX)},
+        {"INT32_MAX", ConstValue::of(INT32_MAX)},  {"INT32_MIN", ConstValue::of(INT32_MIN)},
+        {"INT64_MAX", ConstValue::of(INT64_MAX)},  {"INT64_MIN", ConstValue::of(INT64_MIN)},
+        {"UINT8_MAX", ConstValue::of(UINT8_MAX)},  {"UINT16_MAX", ConstValue::of(UINT16_MAX)},
+        {"UINT32_MAX", ConstValue::of(UINT32_MAX)}, {"UINT64_MAX", {UINT64_MAX, true}},
+        {"SHRT_MAX", ConstValue::of(INT16_MAX)},   {"USHRT_MAX", ConstValue::of(UINT16_MAX)},
+        {"CHAR_BIT", ConstValue::of(8)},           {"true", ConstValue::of(1)},
+        {"false", ConstValue::of(0)},              {"YES", ConstValue::of(1)},
+        {"NO", ConstValue::of(0)},
+    };
+    if (auto it = kFixed.find(name); it != kFixed.end())
+        return it->second;
+    // NSInteger and long are as wide as a pointer.
+    std::uint64_t max = (std::uint64_t(1) << (pointer_bits - 1)) - 1;
+    if (name == "NSIntegerMax" || name == "NSNotFound" || name == "LONG_MAX")
+        return ConstValue::of(static_cast<std::int64_t>(max));
+    if (name == "NSIntegerMin" || name == "LONG_MIN")
+        return ConstValue::of(-static_cast<std::int64_t>(max) - 1);
+    if (name == "NSUIntegerMax" || name == "ULONG_MAX")
+        return convert_value({UINT64_MAX, true}, pointer_bits, false);
+    return std::nullopt;
+}
+
+// Function-like macros that only pass their argument through.
+bool is_value_macro(std::string_view s) {
+    return s == "FOUR_CHAR_CODE" || s == "UINT64_C" || s == "INT64_C" || s == "UINT32_C" || s == "INT32_C" ||
+           s == "UINT16_C" || s == "INT16_C" || s == "UINT8_C" || s == "INT8_C";
+}
+
+bool is_type_word(std::string_view s) {
+    return type_info(s, 64) || s == "signed" || s == "unsigned" || s == "long" || s == "const" || s == "enum";
+}
+
+using Names = std::unordered_map<std::string_view, ConstValue>;
+
+// Constant expression over the tokens of one initializer.
+class Folder : public ConstExpr {
+public:
+    Folder(std::string_view text, const std::vector<Token>& toks, const Names& local, const Names& global,
+           unsigned pointer_bits)
+        : ConstExpr(text, toks, 0, toks.size()), local_(local), global_(global), pointer_bits_(pointer_bits) {}
+
+    std::optional<ConstValue> run() {
+        ConstValue v;
+        if (!evaluate(v))
+            return std::nullopt;
+        // Trailing attribute macros: NS_SWIFT_NAME(...), NS_REFINED_FOR_SWIFT.
+        while (i_ < last_) {
+            if (toks_[i_].kind != Tok::Ident || !is_macro_name(str(i_)))
+                return std::nullopt;
+            ++i_;
+            if (punct("("))
+                i_ = skip_group(text_, toks_, i_, last_);
+        }
+        return v;
+    }
+
+protected:
+    // "(type)" ahead of an operand.
+    bool cast(unsigned& width, bool& is_signed) override {
+        if (!punct("("))
+            return false;
+        std::size_t j = i_ + 1;
+        std::string type;
+        while (j < last_ && toks_[j].kind == Tok::Ident && is_type_word(str(j))) {
+            if (!type.empty())
+                type += ' ';
+            type += str(j++);
+        }
+        // A lone identifier is a typedef name when an operand follows:
+        // (AUEventSampleTime)0xffffffff00000000LL.
+        if (type.empty() && j < last_ && toks_[j].kind == Tok::Ident && j + 2 < last_ && str(j + 1) == ")" &&
+            (toks_[j + 2].kind != Tok::Punct || str(j + 2) == "("))
+            type = str(j++);
+        if (type.empty() || j >= last_ || str(j) != ")")
+            return false;
+        i_ = j + 1;
+        std::optional<TypeInfo> t = type_info(type, pointer_bits_);
+        width = t ? t->width : 0;
+        is_signed = t ? t->is_signed : true;
+        return true;
+    }
+
+    bool identifier(ConstValue& out) override {
+        std::string_view s = str(i_++);
+        if (is_value_macro(s) && accept("(")) {
+            out = conditional();
+            return accept(")");
+        }
+        if (auto it = local_.find(s); it != local_.end())
+            out = it->second;
+        else if (auto it = global_.find(s); it != global_.end())
+            out = it->second;
+        else if (auto v = builtin_constant(s, pointer_bits_))
+            out = *v;
+        else
+            return false;  // sizeof, unknown names
+        return true;
+    }
+
+private:
+    const Names& local_;
+    const Names& global_;
+    unsigned pointer_bits_;
+};
+
+struct PendingConstant {
+    std::string_view name;
+    std::string_view text;       // the declaration, from the name through its initializer
+    std::vector<Token> initializer;
+    bool has_initializer = false;
+    bool shifted = false;        // initializer uses <<
+    bool active = true;          // compiled for the target
+    std::optional<ConstValue> value;
+};
+
+// An object-like #define, which initializers use for shifts and codes shared
+// with C (kLAPolicyDeviceOwnerAuthentication, GL_TEXTURE_2D, ...).
+struct PendingDefine {
+    std::string_view name;
+    std::string_view body;
+    std::vector<Token> tokens;
+    std::optional<ConstValue> value;
+};
+
+std::vector<PendingDefine> collect_defines(const Corpus& corpus, const TargetView& view) {
+    std::vector<PendingDefine> defines;
+    for (std::uint32_t s = 0; s < corpus.sections().size(); ++s) {
+        std::string_view text = view.text(s);
+        for (std::size_t pos = 0; pos < text.size();) {
+            std::size_t eol = text.find('\n', pos);
+            if (eol == std::string_view::npos)
+                eol = text.size();
+            std::string_view line = text.substr(pos, eol - pos);
+            pos = eol + 1;
+            std::size_t i = line.find_first_not_of(" \t");
+            if (i == std::string_view::npos || line[i] != '#')
+                continue;
+            i = line.find_first_not_of(" \t", i + 1);
+            if (i == std::string_view::npos || line.compare(i, 6, "define") != 0)
+                continue;
+            i = line.find_first_not_of(" \t", i + 6);
+            std::size_t end = i;
+            while (end < line.size() && (std::isalnum(static_cast<unsigned char>(line[end])) || line[end] == '_'))
+                ++end;
+            // Function-like macros and continued lines are not values.
+            if (end == i || end == line.size() || line[end] == '(' || line.back() == '\\')
+                continue;
+            PendingDefine d;
+            d.name = line.substr(i, end - i);
+            d.body = line.substr(end);
+            d.tokens = tokenize(d.body);
+            if (!d.tokens.empty())
+                defines.push_back(std::move(d));
+        }
+    }
+    return defines;
+}
+
+struct PendingEnum {
+    std::string_view name;
+    std::string type;
+    std::uint32_t section;
+    bool options = false;
+    std::vector<PendingConstant> constants;
+};
+
+// Underlying type and kind of an enum from its declaration text.
+void parse_enum_head(std::string_view decl, PendingEnum& e) {
+    std::vector<Token> toks = tokenize(decl);
+    for (std::size_t i = 0; i < toks.size(); ++i) {
+        std::string_view s = token_text(decl, toks[i]);
+        if (is_punct(decl, toks[i], '{'))
+            break;
+        bool macro = s == "NS_ENUM" || s == "NS_OPTIONS" || s == "NS_CLOSED_ENUM" || s == "CF_ENUM" ||
+                     s == "CF_OPTIONS" || s == "CF_CLOSED_ENUM";
+        if (macro && i + 1 < toks.size() && is_punct(decl, toks[i + 1], '(')) {
+            e.options = s == "NS_OPTIONS" || s == "CF_OPTIONS";
+            for (std::size_t j = i + 2; j < toks.size() && !is_punct(decl, toks[j], ',') &&
+                                        !is_punct(decl, toks[j], ')');
+                 ++j)
+                e.type += (e.type.empty() ? "" : " ") + std::string(token_text(decl, toks[j]));
+            return;
+        }
+        if (s == "NS_ERROR_ENUM") {
+            e.type = "NSInteger";
+            return;
+        }
+        if (s == "enum") {
+            // enum Name : Type {
+            std::size_t j = i + 1;
+            while (j < toks.size() && !is_punct(decl, toks[j], '{') && !is_punct(decl, toks[j], ':'))
+                ++j;
+            if (j < toks.size() && is_punct(decl, toks[j], ':'))
+                for (++j; j < toks.size() && !is_punct(decl, toks[j], '{'); ++j)
+                    e.type += (e.type.empty() ? "" : " ") + std::string(token_text(decl, toks[j]));
+            if (e.type.empty())
+                e.type = "int";
+            return;
+        }
+    }
+    e.type = "int";
+}
+
+// Splits "Name API_AVAILABLE(...) = expr NS_SWIFT_NAME(...)" at its '='.
+void parse_constant(std::string_view decl, PendingConstant& c) {
+    c.text = decl;
+    std::vector<Token> toks = tokenize(decl);
+    std::size_t i = 0;
+    int depth = 0;
+    for (; i < toks.size(); ++i) {
+        if (is_punct(decl, toks[i], '('))
+            ++depth;
+        else if (is_punct(decl, toks[i], ')'))
+            --depth;
+        else if (depth == 0 && is_punct(decl, toks[i], '='))
+            break;
+    }
+    if (i == toks.size())
+        return;
+    c.has_initializer = true;
+    for (std::size_t j = i + 1; j < toks.size(); ++j) {
+        if (toks[j].kind == Tok::Directive)
+            continue;
+        // Attribute macros with arguments go; value macros such as
+        // FOUR_CHAR_CODE stay.
+        std::string_view s = token_text(decl, toks[j]);
+        if (toks[j].kind == Tok::Ident && is_macro_name(s) && !is_value_macro(s) && j + 1 < toks.size() &&
+            is_punct(decl, toks[j + 1], '(')) {
+            int d = 0;
+            for (++j; j < toks.size(); ++j) {
+                if (is_punct(decl, toks[j], '('))
+                    ++d;
+                else if (is_punct(decl, toks[j], ')') && --d == 0)
+                    break;
+            }
+            continue;
+        }
+        if (toks[j].kind == Tok::Punct && s == "<<")
+            c.shifted = true;
+        Token t = toks[j];
+        c.initializer.push_back(t);
+    }
+}
+
+bool is_live(const std::vector<LiveRange>& ranges, std::uint64_t at) {
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), at,
+                               [](std::uint64_t v, const LiveRange& r) { return v < r.begin; });
+    return it != ranges.begin() && at < std::prev(it)->end;
+}
+
+bool is_power_of_two(std::uint64_t v) {
+    return v && !(v & (v - 1));
+}
+
+} // namespace
+
+std::string EnumTable::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "enums.tbl").string();
+}
+
+EnumBuildStats EnumTable::build(const Corpus& corpus, const std::vector<Symbol>& symbols, const std::string& path,
+                                const TargetConfig& target) {
+    ConditionalViews views(corpus);
+    const TargetView& view = views.view(target);
+
+    // Group constants under the enum declaration that contains them. The
+    // extractor emits no symbol for an anonymous enum, only its constants
+    // (with an empty parent); a '}' between two of them starts a new one.
+    // Heads of live enums are read from the live text, so only the arm the
+    // target compiles picks the underlying type.
+    std::vector<PendingEnum> enums;
+    std::uint64_t enum_end = 0;
+    std::uint32_t enum_section = ~0u;
+    for (const Symbol& s : symbols) {
+        const Section& section = corpus.sections()[s.section];
+        std::string_view file = corpus.files()[section.file].map.view();
+        std::string_view decl = file.substr(s.offset, s.length);
+        std::uint64_t at = s.offset - section.offset;
+        bool live = is_live(view.live(s.section), at);
+        std::string_view text = live ? view.text(s.section) : section.text;
+        if (s.kind == SymbolKind::Enum) {
+            PendingEnum e;
+            e.name = s.name;
+            e.section = s.section;
+            parse_enum_head(text.substr(at, s.length), e);
+            enums.push_back(std::move(e));
+            enum_end = s.offset + s.length;
+            enum_section = s.section;
+            continue;
+        }
+        if (s.kind != SymbolKind::EnumConstant)
+            continue;
+        bool inside = !enums.empty() && s.section == enum_section && s.offset < enum_end;
+        if (!inside && s.parent.empty()) {
+            bool same = !enums.empty() && enums.back().name.empty() && s.section == enum_section &&
+                        file.substr(enum_end, s.offset - enum_end).find('}') == std::string_view::npos;
+            if (!same) {
+                PendingEnum e;
+                e.section = s.section;
+                std::size_t brace = text.rfind('{', at);
+                std::size_t head = brace == std::string_view::npos ? brace : text.rfind("enum", brace);
+                if (head != std::string_view::npos)
+                    parse_enum_head(text.substr(head, brace + 1 - head), e);
+                else
+                    e.type = "int";
+                enums.push_back(std::move(e));
+                enum_section = s.section;
+            }
+            enum_end = s.offset + s.length;
+            inside = true;
+        }
+        if (inside) {
+            PendingConstant c;
+            c.name = s.name;
+            c.active = live;
+            parse_constant(decl, c);
+            enums.back().constants.push_back(std::move(c));
+        }
+    }
+
+    // Evaluate in declaration order, repeating while forward references
+    // (to enumerators declared later in the corpus) keep resolving. Only
+    // active enumerators stand for their names in `global`, and in `local`
+    // for the active ones that follow; an inactive one also sees the earlier
+    // enumerators of its own arm, through `arm`, and counts on from the
+    // previous enumerator whatever its arm.
+    EnumBuildStats stats;
+    std::vector<PendingDefine> defines = collect_defines(corpus, view);
+    Names global, none;
+    for (int pass = 0; pass < kMaxPasses; ++pass) {
+        ++stats.passes;
+        bool progress = false;
+        for (PendingDefine& d : defines) {
+            if (d.value || !(d.value = Folder(d.body, d.tokens, none, global, target.pointer_bits).run()))
+                continue;
+            global.emplace(d.name, *d.value);
+            progress = true;
+        }
+        for (PendingEnum& e : enums) {
+            std::optional<TypeInfo> type = type_info(e.type, target.pointer_bits);
+            Names local, arm;
+            std::optional<ConstValue> previous = ConstValue::of(-1), previous_active = ConstValue::of(-1);
+            for (PendingConstant& c : e.constants) {
+                if (!c.value) {
+                    const std::optional<ConstValue>& before = c.active ? previous_active : previous;
+                    const Names& scope = c.active ? local : arm;
+                    if (c.has_initializer)
+                        c.value = Folder(c.text, c.initializer, scope, global, target.pointer_bits).run();
+                    else if (before)
+                        c.value = ConstValue{before->bits + 1, before->is_unsigned};
+                    if (c.value) {
+                        if (type)
+                            c.value = convert_value(*c.value, type->width, type->is_signed);
+                        progress = true;
+                    }
+                }
+                previous = c.value;
+                if (c.active)
+                    previous_active = c.value;
+                if (!c.value)
+                    continue;
+                arm[c.name] = *c.value;
+                if (c.active) {
+                    local.emplace(c.name, *c.value);
+                    global.emplace(c.name, *c.value);
+                }
+            }
+        }
+        if (!progress)
+            break;
+    }
+
+    StringPool strings;
+    std::vector<EnumRecord> enum_records;
+    std::vector<ConstantRecord> constants;
+    for (const PendingEnum& e : enums) {
+        std::optional<TypeInfo> type = type_info(e.type, target.pointer_bits);
+        EnumRecord r{};
+        r.name = strings.add(e.name);
+        r.type = strings.add(e.type);
+        r.first = static_cast<std::uint32_t>(constants.size());
+        r.count = static_cast<std::uint32_t>(e.constants.size());
+        r.section = e.section;
+        r.width = type ? type->width : 0;
+        r.is_signed = type ? type->is_signed : 1;
+        // A plain enum counts as an option set when its initializers shift
+        // bits and every nonzero value is a single bit. Only the active arms
+        // count, unless the whole enum is inactive.
+        bool options = e.options;
+        if (!options && !e.constants.empty()) {
+            bool shifted = false, bits = true;
+            bool any_active = std::any_of(e.constants.begin(), e.constants.end(),
+                                          [](const PendingConstant& c) { return c.active; });
+            for (const PendingConstant& c : e.constants) {
+                if (any_active && !c.active)
+                    continue;
+                shifted |= c.shifted;
+                bits &= c.value && (c.value->bits == 0 || is_power_of_two(c.value->bits));
+            }
+            options = shifted && bits;
+        }
+        r.flags = options ? EnumRecord::kOptions : 0;
+        stats.options += options;
+        for (const PendingConstant& c : e.constants) {
+            ConstantRecord k{};
+            k.name = strings.add(c.name);
+            k.enum_index = static_cast<std::uint32_t>(enum_records.size());
+            k.flags = (c.value ? ConstantRecord::kResolved : 0) | (c.has_initializer ? 0 : ConstantRecord::kImplicit) |
+                      (c.active ? 0 : ConstantRecord::kInactive);
+            k.value = c.value ? c.value->as_signed() : 0;
+            stats.resolved += c.value.has_value();
+            stats.inactive += !c.active;
+            constants.push_back(k);
+        }
+        enum_records.push_back(r);
+    }
+    stats.enums = enum_records.size();
+    stats.constants = constants.size();
+
+    std::vector<std::uint32_t> enums_by_name;
+    for (std::uint32_t i = 0; i < enums.size(); ++i)
+        if (!enums[i].name.empty())
+            enums_by_name.push_back(i);
+    std::stable_sort(enums_by_name.begin(), enums_by_name.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return enums[a].name < enums[b].name; });
+
+    // Name and value runs over sorted constant IDs, each reached through a
+    // perfect hash.
+    std::vector<std::string_view> constant_names;
+    for (const PendingEnum& e : enums)
+        for (const PendingConstant& c : e.constants)
+            constant_names.push_back(c.name);
+    std::vector<std::uint32_t> by_name(constants.size());
+    for (std::uint32_t i = 0; i < by_name.size(); ++i)
+        by_name[i] = i;
+    std::stable_sort(by_name.begin(), by_name.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return constant_names[a] < constant_names[b]; });
+    std::vector<Run> name_runs;
+    std::vector<std::uint64_t> name_hashes;
+    for (std::uint32_t i = 0; i < by_name.size(); ++i) {
+        std::string_view name = constant_names[by_name[i]];
+        if (name_runs.empty() || constant_names[by_name[name_runs.back().first]] != name) {
+            name_runs.push_back({0, constants[by_name[i]].name, i, 0});
+            name_hashes.push_back(hash64(name));
+        }
+        ++name_runs.back().count;
+    }
+
+    std::vector<std::uint32_t> by_value;
+    for (std::uint32_t i = 0; i < constants.size(); ++i)
+        if ((constants[i].flags & (ConstantRecord::kResolved | ConstantRecord::kInactive)) == ConstantRecord::kResolved)
+            by_value.push_back(i);
+    std::stable_sort(by_value.begin(), by_value.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return constants[a].value < constants[b].value; });
+    std::vector<Run> value_runs;
+    std::vector<std::uint64_t> value_hashes;
+    for (std::uint32_t i = 0; i < by_value.size(); ++i) {
+        std::uint64_t v = static_cast<std::uint64_t>(constants[by_value[i]].value);
+        if (value_runs.empty() || value_runs.back().key != v) {
+            value_runs.push_back({v, {}, i, 0});
+            value_hashes.push_back(mix64(v));  // a bijection, so distinct values never collide
+        }
+        ++value_runs.back().count;
+    }
+    PerfectHash name_hash = PerfectHash::build(name_hashes);
+    PerfectHash value_hash = PerfectHash::build(value_hashes);
+
+    BlobWriter w(kMagic, kVersion, moby::corpus_hash(corpus));
+    std::size_t layout_at = w.put(EnumLayout{});
+    EnumLayout layout{};
+    layout.enum_count = enum_records.size();
+    layout.named_enum_count = enums_by_name.size();
+    layout.constant_count = constants.size();
+    layout.name_run_count = name_runs.size();
+    layout.value_run_count = value_runs.size();
+    layout.resolved_count = by_value.size();
+    layout.name_buckets = name_hash.displacements.size();
+    layout.name_slot_count = name_hash.slots.size();
+    layout.value_buckets = value_hash.displacements.size();
+    layout.value_slot_count = value_hash.slots.size();
+    layout.enums = w.put_array(enum_records);
+    layout.constants = w.put_array(constants);
+    layout.enums_by_name = w.put_array(enums_by_name);
+    layout.by_name = w.put_array(by_name);
+    layout.by_value = w.put_array(by_value);
+    layout.name_runs = w.put_array(name_runs);
+    layout.value_runs = w.put_array(value_runs);
+    layout.name_displacements = w.put_array(name_hash.displacements);
+    layout.name_slots = w.put_array(name_hash.slots);
+    layout.value_displacements = w.put_array(value_hash.displacements);
+    layout.value_slots = w.put_array(value_hash.slots);
+    layout.target = strings.add(target.name());
+    layout.strings = w.put_bytes(strings.data().data(), strings.data().size());
+    layout.strings_size = strings.data().size();
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+    return stats;
+}
+
+EnumTable::EnumTable(const std::string& path) : reader_(path, kMagic, kVersion) {
+    const EnumLayout& l = *reader_.array<EnumLayout>(sizeof(BlobHeader), 1);
+    enum_count_ = l.enum_count;
+    named_enum_count_ = l.named_enum_count;
+    constant_count_ = l.constant_count;
+    name_buckets_ = l.name_buckets;
+    name_slot_count_ = l.name_slot_count;
+    value_buckets_ = l.value_buckets;
+    value_slot_count_ = l.value_slot_count;
+    enums_ = reader_.array<EnumRecord>(l.enums, l.enum_count);
+    constants_ = reader_.array<ConstantRecord>(l.constants, l.constant_count);
+    enums_by_name_ = reader_.array<std::uint32_t>(l.enums_by_name, l.named_enum_count);
+    by_name_ = reader_.array<std::uint32_t>(l.by_name, l.constant_count);
+    by_value_ = reader_.array<std::uint32_t>(l.by_value, l.resolved_count);
+    name_runs_ = reader_.array<Run>(l.name_runs, l.name_run_count);
+    value_runs_ = reader_.array<Run>(l.value_runs, l.value_run_count);
+    name_displacements_ = reader_.array<std::uint32_t>(l.name_displacements, l.name_buckets);
+    name_slots_ = reader_.array<std::uint32_t>(l.name_slots, l.name_slot_count);
+    value_displacements_ = reader_.array<std::uint32_t>(l.value_displacements, l.value_buckets);
+    value_slots_ = reader_.array<std::uint32_t>(l.value_slots, l.value_slot_count);
+    reader_.bytes(l.strings, l.strings_size);
+    strings_ = l.strings;
+    target_ = l.target;
+}
+
+EnumTable::Ids EnumTable::find(std::string_view name) const {
+    std::uint32_t run = perfect_hash_lookup(hash64(name), name_displacements_, name_buckets_, name_slots_,
+                                            name_slot_count_);
+    if (run == 0 || this->name(name_runs_[run - 1].name) != name)
+        return {by_name_, 0};
+    return {by_name_ + name_runs_[run - 1].first, name_runs_[run - 1].count};
+}
+
+EnumTable::Ids EnumTable::with_value(std::int64_t value) const {
+    std::uint64_t v = static_cast<std::uint64_t>(value);
+    std::uint32_t run = perfect_hash_lookup(mix64(v), value_displacements_, value_buckets_, value_slots_,
+                                            value_slot_count_);
+    if (run == 0 || value_runs_[run - 1].key != v)
+        return {by_value_, 0};
+    return {by_value_ + value_runs_[run - 1].first, value_runs_[run - 1].count};
+}
+
+const EnumRecord* EnumTable::find_enum(std::string_view name) const {
+    const std::uint32_t* end = enums_by_name_ + named_enum_count_;
+    const std::uint32_t* it = std::lower_bound(enums_by_name_, end, name, [&](std::uint32_t i, std::string_view n) {
+        return this->name(enums_[i].name) < n;
+    });
+    return it != end && this->name(enums_[*it].name) == name ? &enums_[*it] : nullptr;
+}
+
+std::string EnumTable::decode(const EnumRecord& e, std::int64_t value) const {
+    value = convert_value(ConstValue::of(value), e.width, e.is_signed).as_signed();
+    auto active = [](const ConstantRecord* c) {
+        return (c->flags & (ConstantRecord::kResolved | ConstantRecord::kInactive)) == ConstantRecord::kResolved;
+    };
+    std::string out;
+    auto append = [&](std::string_view s) {
+        if (!out.empty())
+            out += " | ";
+        out += s;
+    };
+    const ConstantRecord* first = constants_ + e.first;
+    const ConstantRecord* last = first + e.count;
+    if (!(e.flags & EnumRecord::kOptions)) {
+        std::unordered_set<std::string_view> seen;
+        for (const ConstantRecord* c = first; c != last; ++c)
+            if (active(c) && c->value == value && seen.insert(name(c->name)).second)
+                append(name(c->name));
+        if (out.empty()) {
+            char buf[32];
+            std::snprintf(buf, sizeof buf, "%lld", static_cast<long long>(value));
+            out = buf;
+        }
+        return out;
+    }
+
+    // Largest masks first, so a combined constant wins over its parts.
+    std::vector<const ConstantRecord*> masks;
+    for (const ConstantRecord* c = first; c != last; ++c)
+        if (active(c) && c->value != 0)
+            masks.push_back(c);
+    std::stable_sort(masks.begin(), masks.end(), [](const ConstantRecord* a, const ConstantRecord* b) {
+        return __builtin_popcountll(static_cast<std::uint64_t>(a->value)) >
+               __builtin_popcountll(static_cast<std::uint64_t>(b->value));
+    });
+    std::uint64_t rest = static_cast<std::uint64_t>(value);
+    for (const ConstantRecord* c : masks) {
+        std::uint64_t m = static_cast<std::uint64_t>(c->value);
+        if ((rest & m) == m) {
+            append(name(c->name));
+            rest &= ~m;
+        }
+    }
+    if (rest || out.empty()) {
+        if (!rest) {
+            for (const ConstantRecord* c = first; c != last; ++c)
+                if (active(c) && c->value == 0)
+                    return std::string(name(c->name));
+            return "0";
+        }
+        char buf[32];
+        std::snprintf(buf, sizeof buf, "0x%llx", static_cast<unsigned long long>(rest));
+        append(buf);
+    }
+    return out;
+}
+
+} // namespace moby
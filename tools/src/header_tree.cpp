@@ -0,0 +1,196 @@
+#include "moby/header_tree.h"
+
+#include "moby/error.h"
+#include "moby/work_pool.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+namespace {
+
+// Section paths come from the corpus text: refuse any that would leave the
+// destination.
+void check_path(std::string_view path) {
+    bool ok = !path.empty() && path.front() != '/';
+    for (std::size_t p = 0; ok && p <= path.size();) {
+        std::size_t slash = std::min(path.find('/', p), path.size());
+        std::string_view part = path.substr(p, slash - p);
+        ok = !part.empty() && part != "." && part != "..";
+        p = slash + 1;
+    }
+    if (!ok)
+        throw Error("refusing to extract section path '" + std::string(path) + "'");
+}
+
+std::vector<const Section*> selected(const Corpus& corpus, const HeaderTreeOptions& options) {
+    std::string prefix = options.framework.empty() ? std::string() : options.framework + ".framework/";
+    std::vector<const Section*> out;
+    for (const Section& s : corpus.sections())
+        if (s.path.substr(0, prefix.size()) == prefix) {
+            check_path(s.path);
+            out.push_back(&s);
+        }
+    return out;
+}
+
+HeaderTreeStats extract_naive(const std::vector<const Section*>& sections, const std::string& dest) {
+    HeaderTreeStats stats;
+    for (const Section* s : sections) {
+        fs::path path = fs::path(dest) / std::string(s->path);
+        fs::create_directories(path.parent_path());
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(s->text.data(), static_cast<std::streamsize>(s->text.size()));
+        if (!out)
+            throw Error("cannot write " + path.string());
+        ++stats.files;
+        ++stats.written;
+        stats.bytes += s->text.size();
+    }
+    return stats;
+}
+
+class Fd {
+public:
+    explicit Fd(int fd = -1) : fd_(fd) {}
+    ~Fd() {
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+    Fd(Fd&& o) noexcept : fd_(o.fd_) { o.fd_ = -1; }
+    Fd(const Fd&) = delete;
+    Fd& operator=(const Fd&) = delete;
+    int get() const { return fd_; }
+
+private:
+    int fd_;
+};
+
+std::string errno_text(const std::string& what, std::string_view path) {
+    return what + " " + std::string(path) + ": " + std::strerror(errno);
+}
+
+// Writes data[from, n) at the same file offsets.
+void write_all(int fd, const char* data, std::size_t from, std::size_t n, std::string_view path) {
+    for (std::uint64_t done = from; done < n;) {
+        ssize_t k = ::pwrite(fd, data + done, n - done, static_cast<off_t>(done));
+        if (k < 0 && errno == EINTR)
+            continue;
+        if (k <= 0)
+            throw Error(errno_text("cannot write", path));
+        done += static_cast<std::uint64_t>(k);
+    }
+}
+
+} // namespace
+
+HeaderTreeStats extract_header_tree(const Corpus& corpus, const std::string& dest, const HeaderTreeOptions& options) {
+    std::vector<const Section*> sections = selected(corpus, options);
+    if (options.naive)
+        return extract_naive(sections, dest);
+
+    // Every directory, parents before children: a path sorts before all
+    // paths it prefixes.
+    std::set<std::string_view> directories;
+    for (const Section* s : sections)
+        for (std::size_t slash = s->path.find('/'); slash != std::string_view::npos; slash = s->path.find('/', slash + 1))
+            directories.insert(s->path.substr(0, slash));
+
+    fs::create_directories(dest);
+    Fd root(::open(dest.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (root.get() < 0)
+        throw Error(errno_text("cannot open", dest));
+    HeaderTreeStats stats;
+    for (std::string_view dir : directories) {
+        std::string rel(dir);
+        if (::mkdirat(root.get(), rel.c_str(), 0755) == 0)
+            ++stats.directories;
+        else if (errno != EEXIST)
+            throw Error(errno_text("cannot create", (fs::path(dest) / rel).string()));
+    }
+
+    // The corpus files the sections come from, opened once.
+    std::vector<Fd> sources;
+    for (const CorpusFile& f : corpus.files()) {
+        std::string path = (fs::path(corpus.dir()) / f.name).string();
+        sources.emplace_back(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+        if (sources.back().get() < 0)
+            throw Error(errno_text("cannot open", path));
+    }
+
+    // One task per framework (the first path component), largest first.
+    std::map<std::string_view, std::vector<const Section*>> by_framework;
+    for (const Section* s : sections)
+        by_framework[s->path.substr(0, s->path.find('/'))].push_back(s);
+    std::vector<const std::vector<const Section*>*> groups;
+    std::vector<std::uint64_t> group_bytes;
+    for (const auto& [_, list] : by_framework) {
+        groups.push_back(&list);
+        std::uint64_t bytes = 0;
+        for (const Section* s : list)
+            bytes += s->text.size();
+        group_bytes.push_back(bytes);
+    }
+    std::vector<std::uint32_t> tasks(groups.size());
+    for (std::uint32_t i = 0; i < tasks.size(); ++i)
+        tasks[i] = i;
+    std::sort(tasks.begin(), tasks.end(), [&](std::uint32_t a, std::uint32_t b) { return group_bytes[a] > group_bytes[b]; });
+
+    std::atomic<bool> copy_range{true};
+    std::atomic<std::size_t> copied{0}, written{0};
+    run_stealing(tasks, options.threads, [&](std::uint32_t g) {
+        for (const Section* s : *groups[g]) {
+            std::string rel(s->path);
+            Fd out(::openat(root.get(), rel.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+            if (out.get() < 0)
+                throw Error(errno_text("cannot create", (fs::path(dest) / rel).string()));
+            std::uint64_t done = 0;
+#ifdef __linux__
+            if (copy_range.load(std::memory_order_relaxed)) {
+                loff_t in = static_cast<loff_t>(s->offset);
+                while (done < s->length) {
+                    ssize_t k = ::copy_file_range(sources[s->file].get(), &in, out.get(), nullptr, s->length - done, 0);
+                    if (k < 0 && errno == EINTR)
+                        continue;
+                    if (k > 0) {
+                        done += static_cast<std::uint64_t>(k);
+                        continue;
+                    }
+                    if (k == 0 || errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP) {
+                        // Not supported here: write this and every later file.
+                        copy_range.store(false, std::memory_order_relaxed);
+                        break;
+                    }
+                    throw Error(errno_text("cannot copy to", (fs::path(dest) / rel).string()));
+                }
+            }
+#endif
+            if (done == s->length && done != 0) {
+                ++copied;
+                continue;
+            }
+            write_all(out.get(), s->text.data(), done, s->text.size(), rel);
+            ++written;
+        }
+    });
+    stats.files = sections.size();
+    for (const Section* s : sections)
+        stats.bytes += s->text.size();
+    stats.copied = copied;
+    stats.written = written;
+    return stats;
+}
+
+} // namespace moby
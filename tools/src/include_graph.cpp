@@ -0,0 +1,407 @@
+#include "moby/include_graph.h"
+
+#include "moby/hash.h"
+#include "moby/perfect_hash.h"
+#include "moby/scanner.h"
+#include "moby/section_index.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+namespace {
+
+struct GraphLayout {
+    std::uint64_t node_count;
+    std::uint64_t edge_count;
+    std::uint64_t row_words;
+    std::uint64_t bucket_count;
+    std::uint64_t slot_count;
+    std::uint64_t nodes;
+    std::uint64_t out_offsets;
+    std::uint64_t out_edges;
+    std::uint64_t in_offsets;
+    std::uint64_t in_edges;
+    std::uint64_t order;
+    std::uint64_t closure;
+    std::uint64_t reverse;
+    std::uint64_t displacements;
+    std::uint64_t slots;
+    std::uint64_t strings;
+    std::uint64_t strings_size;
+};
+
+constexpr std::string_view kHeadersDir = ".framework/Headers/";
+
+// Lexically joins a quoted include onto the including header's directory.
+std::string join_relative(std::string_view from_path, std::string_view spelled) {
+    std::vector<std::string_view> parts;
+    auto push = [&](std::string_view s) {
+        std::size_t begin = 0;
+        while (begin <= s.size()) {
+            std::size_t slash = s.find('/', begin);
+            if (slash == std::string_view::npos)
+                slash = s.size();
+            std::string_view part = s.substr(begin, slash - begin);
+            if (part == "..") {
+                if (!parts.empty())
+                    parts.pop_back();
+            } else if (!part.empty() && part != ".") {
+                parts.push_back(part);
+            }
+            begin = slash + 1;
+        }
+    };
+    std::size_t dir = from_path.rfind('/');
+    push(from_path.substr(0, dir == std::string_view::npos ? 0 : dir));
+    push(spelled);
+    std::string out;
+    for (std::string_view part : parts) {
+        if (!out.empty())
+            out += '/';
+        out += part;
+    }
+    return out;
+}
+
+// The <...> or "..." operand of a directive that starts its line.
+bool directive_target(std::string_view text, const ScanHit& hit, std::string_view& spelled, bool& quoted) {
+    std::size_t p = hit.offset;
+    while (p > 0 && (text[p - 1] == ' ' || text[p - 1] == '\t'))
+        --p;
+    if (p > 0 && text[p - 1] != '\n')
+        return false;
+    p = hit.offset + (hit.kind == ScanKind::Import ? 7 : 8);
+    while (p < text.size() && (text[p] == ' ' || text[p] == '\t'))
+        ++p;
+    if (p >= text.size() || (text[p] != '<' && text[p] != '"'))
+        return false;
+    quoted = text[p] == '"';
+    std::size_t close = text.find(quoted ? '"' : '>', p + 1);
+    std::size_t eol = text.find('\n', p);
+    if (close == std::string_view::npos || close > eol || close == p + 1)
+        return false;
+    spelled = text.substr(p + 1, close - p - 1);
+    return true;
+}
+
+class GraphBuilder {
+public:
+    explicit GraphBuilder(const Corpus& corpus) : corpus_(corpus) {
+        for (const Section& s : corpus.sections()) {
+            std::uint32_t id = static_cast<std::uint32_t>(names_.size());
+            names_.push_back(include_name(s.path));
+            by_name_.emplace(names_.back(), id);
+            by_path_.emplace(s.path, id);
+        }
+        edges_.resize(names_.size());
+    }
+
+    void add_section(std::uint32_t id, const std::vector<IncludeDirective>& directives) {
+        const Section& s = corpus_.sections()[id];
+        for (const IncludeDirective& d : directives) {
+            std::uint32_t to = resolve(s, d.target, d.quoted);
+            if (to != id)
+                edges_[id].push_back(to);
+        }
+        std::sort(edges_[id].begin(), edges_[id].end());
+        edges_[id].erase(std::unique(edges_[id].begin(), edges_[id].end()), edges_[id].end());
+    }
+
+    const std::vector<std::string>& names() const { return names_; }
+    const std::vector<std::vector<std::uint32_t>>& edges() const { return edges_; }
+
+private:
+    std::uint32_t resolve(const Section& from, std::string_view spelled, bool quoted) {
+        if (quoted) {
+            auto it = by_path_.find(join_relative(from.path, spelled));
+            if (it != by_path_.end())
+                return it->second;
+            // A quoted name also finds headers of the includer's framework.
+            std::string name = include_name(from.path);
+            name.resize(name.rfind('/') + 1);
+            name.append(spelled);
+            if (auto named = by_name_.find(name); named != by_name_.end())
+                return named->second;
+        }
+        auto it = by_name_.find(std::string(spelled));
+        if (it != by_name_.end())
+            return it->second;
+        std::uint32_t id = static_cast<std::uint32_t>(names_.size());
+        names_.emplace_back(spelled);
+        by_name_.emplace(names_.back(), id);
+        edges_.emplace_back();
+        return id;
+    }
+
+    const Corpus& corpus_;
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, std::uint32_t> by_name_;
+    std::unordered_map<std::string, std::uint32_t> by_path_;
+    std::vector<std::vector<std::uint32_t>> edges_;
+};
+
+// Tarjan's algorithm without recursion. Components come out sinks first,
+// which is the dependencies-first order the closure pass needs.
+std::vector<std::uint32_t> strongly_connected(const std::vector<std::vector<std::uint32_t>>& edges,
+                                              std::uint32_t& component_count) {
+    constexpr std::uint32_t kUnvisited = 0xFFFFFFFF;
+    std::size_t n = edges.size();
+    std::vector<std::uint32_t> index(n, kUnvisited), low(n), component(n, kUnvisited);
+    std::vector<std::uint32_t> stack;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> frames;  // node, next edge
+    std::uint32_t next_index = 0;
+    component_count = 0;
+
+    for (std::uint32_t root = 0; root < n; ++root) {
+        if (index[root] != kUnvisited)
+            continue;
+        frames.push_back({root, 0});
+        index[root] = low[root] = next_index++;
+        stack.push_back(root);
+        while (!frames.empty()) {
+            auto& [v, e] = frames.back();
+            if (e < edges[v].size()) {
+                std::uint32_t w = edges[v][e++];
+                if (index[w] == kUnvisited) {
+                    index[w] = low[w] = next_index++;
+                    stack.push_back(w);
+                    frames.push_back({w, 0});
+                } else if (component[w] == kUnvisited) {
+                    low[v] = std::min(low[v], index[w]);
+                }
+                continue;
+            }
+            std::uint32_t done = v;
+            frames.pop_back();
+            if (!frames.empty())
+                low[frames.back().first] = std::min(low[frames.back().first], low[done]);
+            if (low[done] != index[done])
+                continue;
+            std::uint32_t w;
+            do {
+                w = stack.back();
+                stack.pop_back();
+                component[w] = component_count;
+            } while (w != done);
+            ++component_count;
+        }
+    }
+    return component;
+}
+
+} // namespace
+
+std::string include_name(std::string_view section_path) {
+    std::size_t headers = section_path.rfind(kHeadersDir);
+    if (headers == std::string_view::npos)
+        return std::string(section_path);
+    std::size_t fw = section_path.rfind('/', headers);
+    fw = fw == std::string_view::npos ? 0 : fw + 1;
+    std::string name(section_path.substr(fw, headers - fw));
+    name += '/';
+    name.append(section_path.substr(headers + kHeadersDir.size()));
+    return name;
+}
+
+std::string IncludeGraph::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "includes.graph").string();
+}
+
+void section_includes(std::string_view text, std::vector<IncludeDirective>& out) {
+    std::vector<ScanHit> hits;
+    scan(text, hits);
+    for (const ScanHit& hit : hits) {
+        if (hit.kind != ScanKind::Import && hit.kind != ScanKind::Include)
+            continue;
+        std::string_view target;
+        bool quoted;
+        if (directive_target(text, hit, target, quoted))
+            out.push_back({std::string(target), quoted});
+    }
+}
+
+void IncludeGraph::build(const Corpus& corpus, const std::string& path) {
+    std::vector<std::vector<IncludeDirective>> includes(corpus.sections().size());
+    for (std::size_t i = 0; i < includes.size(); ++i)
+        section_includes(corpus.sections()[i].text, includes[i]);
+    build(corpus, includes, path);
+}
+
+void IncludeGraph::build(const Corpus& corpus, const std::vector<std::vector<IncludeDirective>>& includes,
+                         const std::string& path) {
+    GraphBuilder builder(corpus);
+    for (std::uint32_t i = 0; i < corpus.sections().size(); ++i)
+        builder.add_section(i, includes[i]);
+    const auto& edges = builder.edges();
+    const auto& names = builder.names();
+    std::size_t n = names.size();
+
+    std::uint32_t component_count;
+    std::vector<std::uint32_t> component = strongly_connected(edges, component_count);
+    std::vector<std::uint32_t> order(n);
+    for (std::uint32_t i = 0; i < n; ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return component[a] < component[b]; });
+
+    // Forward closure, one component at a time in dependency order: a
+    // component reaches its edges' targets and everything they reach.
+    std::uint64_t row_words = (n + 63) / 64;
+    std::vector<std::uint64_t> closure(n * row_words, 0);
+    for (std::size_t begin = 0; begin < n;) {
+        std::size_t end = begin;
+        while (end < n && component[order[end]] == component[order[begin]])
+            ++end;
+        std::vector<std::uint64_t> row(row_words, 0);
+        for (std::size_t k = begin; k < end; ++k) {
+            for (std::uint32_t to : edges[order[k]]) {
+                row[to >> 6] |= std::uint64_t(1) << (to & 63);
+                if (component[to] != component[order[begin]]) {
+                    const std::uint64_t* other = &closure[to * row_words];
+                    for (std::uint64_t w = 0; w < row_words; ++w)
+                        row[w] |= other[w];
+                }
+            }
+        }
+        for (std::size_t k = begin; k < end; ++k)
+            std::copy(row.begin(), row.end(), closure.begin() + order[k] * row_words);
+        begin = end;
+    }
+    std::vector<std::uint64_t> reverse(n * row_words, 0);
+    for (std::uint32_t from = 0; from < n; ++from)
+        Bitset(&closure[from * row_words], n).for_each([&](std::size_t to) {
+            reverse[to * row_words + (from >> 6)] |= std::uint64_t(1) << (from & 63);
+        });
+
+    std::vector<std::uint32_t> out_offsets{0}, out_edges, in_offsets{0}, in_edges;
+    std::vector<std::vector<std::uint32_t>> incoming(n);
+    for (std::uint32_t from = 0; from < n; ++from) {
+        for (std::uint32_t to : edges[from]) {
+            out_edges.push_back(to);
+            incoming[to].push_back(from);
+        }
+        out_offsets.push_back(static_cast<std::uint32_t>(out_edges.size()));
+    }
+    for (const auto& in : incoming) {
+        in_edges.insert(in_edges.end(), in.begin(), in.end());
+        in_offsets.push_back(static_cast<std::uint32_t>(in_edges.size()));
+    }
+
+    // A header path that occurs twice keeps a node per section, but only the
+    // first is found by name, as in the section index.
+    StringPool strings;
+    std::vector<HeaderNode> nodes(n);
+    std::vector<std::uint64_t> hashes;
+    std::vector<std::uint32_t> keyed;
+    std::unordered_set<std::string_view> seen;
+    for (std::uint32_t i = 0; i < n; ++i) {
+        bool in_corpus = i < corpus.sections().size();
+        nodes[i].name = strings.add(names[i]);
+        nodes[i].path = in_corpus ? strings.add(corpus.sections()[i].path) : StrRef{};
+        nodes[i].section = in_corpus ? i : kExternalHeader;
+        nodes[i].scc = component[i];
+        if (seen.insert(names[i]).second) {
+            hashes.push_back(hash64(names[i]));
+            keyed.push_back(i);
+        }
+    }
+    PerfectHash ph = PerfectHash::build(hashes);
+    for (std::uint32_t& slot : ph.slots)
+        if (slot != 0)
+            slot = keyed[slot - 1] + 1;
+
+    BlobWriter w(kMagic, kVersion, moby::corpus_hash(corpus));
+    std::size_t layout_at = w.put(GraphLayout{});
+    GraphLayout layout{};
+    layout.node_count = n;
+    layout.edge_count = out_edges.size();
+    layout.row_words = row_words;
+    layout.bucket_count = ph.displacements.size();
+    layout.slot_count = ph.slots.size();
+    layout.nodes = w.put_array(nodes);
+    layout.out_offsets = w.put_array(out_offsets);
+    layout.out_edges = w.put_array(out_edges);
+    layout.in_offsets = w.put_array(in_offsets);
+    layout.in_edges = w.put_array(in_edges);
+    layout.order = w.put_array(order);
+    layout.closure = w.put_array(closure);
+    layout.reverse = w.put_array(reverse);
+    layout.displacements = w.put_array(ph.displacements);
+    layout.slots = w.put_array(ph.slots);
+    layout.strings = w.put_bytes(strings.data().data(), strings.data().size());
+    layout.strings_size = strings.data().size();
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+}
+
+IncludeGraph::IncludeGraph(const std::string& path) : reader_(path, kMagic, kVersion) {
+    const GraphLayout& l = *reader_.array<GraphLayout>(sizeof(BlobHeader), 1);
+    node_count_ = l.node_count;
+    row_words_ = l.row_words;
+    if (row_words_ != (node_count_ + 63) / 64)
+        throw Error(path + ": bad row width");
+    bucket_count_ = l.bucket_count;
+    slot_count_ = l.slot_count;
+    nodes_ = reader_.array<HeaderNode>(l.nodes, l.node_count);
+    out_offsets_ = reader_.array<std::uint32_t>(l.out_offsets, l.node_count + 1);
+    out_edges_ = reader_.array<std::uint32_t>(l.out_edges, l.edge_count);
+    in_offsets_ = reader_.array<std::uint32_t>(l.in_offsets, l.node_count + 1);
+    in_edges_ = reader_.array<std::uint32_t>(l.in_edges, l.edge_count);
+    order_ = reader_.array<std::uint32_t>(l.order, l.node_count);
+    closure_ = reader_.array<std::uint64_t>(l.closure, l.node_count * l.row_words);
+    reverse_ = reader_.array<std::uint64_t>(l.reverse, l.node_count * l.row_words);
+    displacements_ = reader_.array<std::uint32_t>(l.displacements, l.bucket_count);
+    slots_ = reader_.array<std::uint32_t>(l.slots, l.slot_count);
+    reader_.bytes(l.strings, l.strings_size);
+    strings_ = l.strings;
+}
+
+bool IncludeGraph::find(std::string_view name, std::uint32_t& id) const {
+    std::string key;
+    if (name.find(kHeadersDir) != std::string_view::npos) {
+        key = include_name(name);
+        name = key;
+    }
+    std::uint32_t entry = perfect_hash_lookup(hash64(name), displacements_, bucket_count_, slots_, slot_count_);
+    if (entry == 0 || this->name(entry - 1) != name)
+        return false;
+    id = entry - 1;
+    return true;
+}
+
+IncludeGraph::Range IncludeGraph::includes(std::uint32_t id) const {
+    return {out_edges_ + out_offsets_[id], out_offsets_[id + 1] - out_offsets_[id]};
+}
+
+IncludeGraph::Range IncludeGraph::included_by(std::uint32_t id) const {
+    return {in_edges_ + in_offsets_[id], in_offsets_[id + 1] - in_offsets_[id]};
+}
+
+std::size_t IncludeGraph::row_count(const std::uint64_t* words) const {
+    std::size_t n = 0;
+    for (std::uint64_t w = 0; w < row_words_; ++w)
+        n += static_cast<std::size_t>(__builtin_popcountll(words[w]));
+    return n;
+}
+
+std::vector<std::vector<std::uint32_t>> IncludeGraph::cycles() const {
+    std::vector<std::vector<std::uint32_t>> out;
+    for (std::uint64_t begin = 0; begin < node_count_;) {
+        std::uint64_t end = begin + 1;
+        while (end < node_count_ && nodes_[order_[end]].scc == nodes_[order_[begin]].scc)
+            ++end;
+        if (end - begin > 1)
+            out.emplace_back(order_ + begin, order_ + end);
+        begin = end;
+    }
+    return out;
+}
+
+} // namespace moby
@@ -0,0 +1,271 @@
+#include "moby/json.h"
+
+#include "moby/error.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+
+namespace moby {
+namespace {
+
+class Parser {
+public:
+    explicit Parser(std::string_view text) : text_(text) {}
+
+    Json document() {
+        Json v = value(0);
+        skip_space();
+        if (pos_ != text_.size())
+            fail("trailing characters");
+        return v;
+    }
+
+private:
+    static constexpr int kMaxDepth = 256;
+
+    [[noreturn]] void fail(const char* what) const {
+        throw Error("json: " + std::string(what) + " at offset " + std::to_string(pos_));
+    }
+
+    void skip_space() {
+        while (pos_ < text_.size() &&
+               (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r'))
+            ++pos_;
+    }
+
+    bool consume(std::string_view word) {
+        if (text_.substr(pos_, word.size()) != word)
+            return false;
+        pos_ += word.size();
+        return true;
+    }
+
+    Json value(int depth) {
+        if (depth > kMaxDepth)
+            fail("nesting too deep");
+        skip_space();
+        if (pos_ == text_.size())
+            fail("unexpected end");
+        Json v;
+        char c = text_[pos_];
+        if (c == '{') {
+            v.type = Json::Type::Object;
+            ++pos_;
+            skip_space();
+            if (pos_ < text_.size() && text_[pos_] == '}') {
+                ++pos_;
+                return v;
+            }
+            for (;;) {
+                skip_space();
+                if (pos_ == text_.size() || text_[pos_] != '"')
+                    fail("expected member name");
+                std::string key = string();
+                skip_space();
+                if (!consume(":"))
+                    fail("expected ':'");
+                v.members.emplace_back(std::move(key), value(depth + 1));
+                skip_space();
+                if (consume("}"))
+                    return v;
+                if (!consume(","))
+                    fail("expected ',' or '}'");
+            }
+        }
+        if (c == '[') {
+            v.type = Json::Type::Array;
+            ++pos_;
+            skip_space();
+            if (consume("]"))
+                return v;
+            for (;;) {
+                v.items.push_back(value(depth + 1));
+                skip_space();
+                if (consume("]"))
+                    return v;
+                if (!consume(","))
+                    fail("expected ',' or ']'");
+            }
+        }
+        if (c == '"') {
+            v.type = Json::Type::String;
+            v.string = string();
+            return v;
+        }
+        if (consume("true") || consume("false")) {
+            v.type = Json::Type::Bool;
+            v.boolean = c == 't';
+            return v;
+        }
+        if (consume("null"))
+            return v;
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            std::size_t start = pos_;
+            while (pos_ < text_.size() && (std::isdigit(static_cast<unsigned char>(text_[pos_])) ||
+                                           text_[pos_] == '-' || text_[pos_] == '+' || text_[pos_] == '.' ||
+                                           text_[pos_] == 'e' || text_[pos_] == 'E'))
+                ++pos_;
+            std::string digits(text_.substr(start, pos_ - start));
+            char* end = nullptr;
+            v.type = Json::Type::Number;
+            v.number = std::strtod(digits.c_str(), &end);
+            if (end != digits.c_str() + digits.size())
+                fail("bad number");
+            return v;
+        }
+        fail("unexpected character");
+    }
+
+    unsigned hex4() {
+        if (pos_ + 4 > text_.size())
+            fail("short \\u escape");
+        unsigned v = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = text_[pos_++];
+            v <<= 4;
+            if (c >= '0' && c <= '9')
+                v |= c - '0';
+            else if (c >= 'a' && c <= 'f')
+                v |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                v |= c - 'A' + 10;
+            else
+                fail("bad \\u escape");
+        }
+        return v;
+    }
+
+    static void append_utf8(std::string& out, unsigned cp) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xc0 | cp >> 6);
+            out += static_cast<char>(0x80 | (cp & 0x3f));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xe0 | cp >> 12);
+            out += static_cast<char>(0x80 | (cp >> 6 & 0x3f));
+            out += static_cast<char>(0x80 | (cp & 0x3f));
+        } else {
+            out += static_cast<char>(0xf0 | cp >> 18);
+            out += static_cast<char>(0x80 | (cp >> 12 & 0x3f));
+            out += static_cast<char>(0x80 | (cp >> 6 & 0x3f));
+            out += static_cast<char>(0x80 | (cp & 0x3f));
+        }
+    }
+
+    std::string string() {
+        ++pos_;  // opening quote
+        std::string out;
+        for (;;) {
+            if (pos_ == text_.size())
+                fail("unterminated string");
+            char c = text_[pos_++];
+            if (c == '"')
+                return out;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos_ == text_.size())
+                fail("unterminated string");
+            switch (char e = text_[pos_++]) {
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                unsigned cp = hex4();
+                if (cp >= 0xd800 && cp < 0xdc00 && consume("\\u")) {
+                    unsigned low = hex4();
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                }
+                append_utf8(out, cp);
+                break;
+            }
+            default:
+                out += e;  // '"', '\\' and '/'
+            }
+        }
+    }
+
+    std::string_view text_;
+    std::size_t pos_ = 0;
+};
+
+} // namespace
+
+const Json& Json::operator[](std::string_view key) const {
+    static const Json null;
+    for (const auto& [name, value] : members)
+        if (name == key)
+            return value;
+    return null;
+}
+
+Json parse_json(std::string_view text) { return Parser(text).document(); }
+
+void append_json_string(std::string& out, std::string_view s) {
+    out += '"';
+    for (char c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof buf, "\\u%04x", c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+void append_json(std::string& out, const Json& v) {
+    switch (v.type) {
+    case Json::Type::Null:
+        out += "null";
+        break;
+    case Json::Type::Bool:
+        out += v.boolean ? "true" : "false";
+        break;
+    case Json::Type::Number: {
+        char buf[32];
+        std::snprintf(buf, sizeof buf, "%.17g", v.number);
+        out += buf;
+        break;
+    }
+    case Json::Type::String:
+        append_json_string(out, v.string);
+        break;
+    case Json::Type::Array:
+        out += '[';
+        for (std::size_t i = 0; i < v.items.size(); ++i) {
+            if (i)
+                out += ',';
+            append_json(out, v.items[i]);
+        }
+        out += ']';
+        break;
+    case Json::Type::Object:
+        out += '{';
+        for (std::size_t i = 0; i < v.members.size(); ++i) {
+            if (i)
+                out += ',';
+            append_json_string(out, v.members[i].first);
+            out += ':';
+            append_json(out, v.members[i].second);
+        }
+        out += '}';
+        break;
+    }
+}
+
+} // namespace moby
@@ -0,0 +1,185 @@
+#include "moby/lexer.h"
+
+#include <algorithm>
+
+namespace moby {
+namespace {
+
+// clang accepts '$' in identifiers as an extension.
+inline bool is_word_start(char c) { return is_ident_start(c) || c == '$'; }
+inline bool is_word_char(char c) { return is_ident_char(c) || c == '$'; }
+
+inline bool is_digit(unsigned char c) { return c >= '0' && c <= '9'; }
+
+constexpr std::string_view kThreeCharOps[] = {"...", "<<=", ">>="};
+constexpr std::string_view kTwoCharOps[] = {"<<", ">>", "<=", ">=", "==", "!=", "&&", "||", "::",
+                                            "->", "++", "--", "+=", "-=", "*=", "/=", "|=", "&=",
+                                            "^=", "%="};
+
+// Offset just past the quoted literal starting at `i`.
+std::size_t skip_quoted(std::string_view s, std::size_t i) {
+    char quote = s[i++];
+    while (i < s.size() && s[i] != quote && s[i] != '\n') {
+        if (s[i] == '\\' && i + 1 < s.size())
+            ++i;
+        ++i;
+    }
+    return i < s.size() && s[i] == quote ? i + 1 : i;
+}
+
+} // namespace
+
+std::vector<Token> tokenize(std::string_view s, bool keep_comments) {
+    std::vector<Token> out;
+    out.reserve(s.size() / 6);
+    std::size_t i = 0;
+    bool line_start = true;
+    auto emit = [&](Tok kind, std::size_t begin, std::size_t end) {
+        out.push_back({kind, static_cast<std::uint32_t>(begin), static_cast<std::uint32_t>(end - begin)});
+    };
+
+    while (i < s.size()) {
+        unsigned char c = s[i];
+        if (c == '\n') {
+            line_start = true;
+            ++i;
+            continue;
+        }
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v') {
+            ++i;
+            continue;
+        }
+        if (c == '\\' && i + 1 < s.size() && (s[i + 1] == '\n' || s[i + 1] == '\r')) {
+            i += 2;
+            continue;
+        }
+        std::size_t begin = i;
+
+        if (c == '/' && i + 1 < s.size() && (s[i + 1] == '/' || s[i + 1] == '*')) {
+            if (s[i + 1] == '/') {
+                std::size_t eol = s.find('\n', i);
+                i = eol == std::string_view::npos ? s.size() : eol;
+            } else {
+                std::size_t close = s.find("*/", i + 2);
+                i = close == std::string_view::npos ? s.size() : close + 2;
+            }
+            if (keep_comments)
+                emit(Tok::Comment, begin, i);
+            continue;
+        }
+
+        if (c == '#' && line_start) {
+            // A directive runs to the first newline that is neither escaped
+            // nor inside a block comment.
+            while (i < s.size() && s[i] != '\n') {
+                if (s[i] == '\\' && i + 1 < s.size() && s[i + 1] == '\n') {
+                    i += 2;
+                } else if (s[i] == '/' && i + 1 < s.size() && s[i + 1] == '*') {
+                    std::size_t close = s.find("*/", i + 2);
+                    i = close == std::string_view::npos ? s.size() : close + 2;
+                } else if (s[i] == '/' && i + 1 < s.size() && s[i + 1] == '/') {
+                    std::size_t eol = s.find('\n', i);
+                    i = eol == std::string_view::npos ? s.size() : eol;
+                } else {
+                    ++i;
+                }
+            }
+            std::size_t end = i;
+            while (end > begin && (s[end - 1] == ' ' || s[end - 1] == '\t' || s[end - 1] == '\r'))
+                --end;
+            emit(Tok::Directive, begin, end);
+            continue;
+        }
+        line_start = false;
+
+        if (is_word_start(c) || (c == '@' && i + 1 < s.size() && is_word_start(s[i + 1]))) {
+            ++i;
+            while (i < s.size() && is_word_char(s[i]))
+                ++i;
+            emit(Tok::Ident, begin, i);
+        } else if (is_digit(c) || (c == '.' && i + 1 < s.size() && is_digit(s[i + 1]))) {
+            bool hex = c == '0' && i + 1 < s.size() && (s[i + 1] == 'x' || s[i + 1] == 'X');
+            ++i;
+            while (i < s.size()) {
+                unsigned char d = s[i];
+                unsigned char prev = s[i - 1];
+                bool exponent_sign = (d == '+' || d == '-') &&
+                                     ((!hex && (prev == 'e' || prev == 'E')) || prev == 'p' || prev == 'P');
+                if (is_word_char(d) || d == '.' || exponent_sign)
+                    ++i;
+                else
+                    break;
+            }
+            emit(Tok::Number, begin, i);
+        } else if (c == '"' || (c == '@' && i + 1 < s.size() && s[i + 1] == '"')) {
+            i = skip_quoted(s, c == '@' ? i + 1 : i);
+            emit(Tok::String, begin, i);
+        } else if (c == '\'') {
+            i = skip_quoted(s, i);
+            emit(Tok::Char, begin, i);
+        } else {
+            std::string_view rest = s.substr(i, 3);
+            std::size_t len = 1;
+            for (std::string_view op : kThreeCharOps)
+                if (rest == op)
+                    len = 3;
+            if (len == 1)
+                for (std::string_view op : kTwoCharOps)
+                    if (rest.substr(0, 2) == op)
+                        len = 2;
+            i += len;
+            emit(Tok::Punct, begin, i);
+        }
+    }
+    return out;
+}
+
+std::string_view directive_name(std::string_view d) {
+    std::size_t i = 1;
+    while (i < d.size() && (d[i] == ' ' || d[i] == '\t'))
+        ++i;
+    std::size_t begin = i;
+    while (i < d.size() && is_ident_char(d[i]))
+        ++i;
+    return d.substr(begin, i - begin);
+}
+
+std::size_t skip_group(std::string_view text, const std::vector<Token>& toks, std::size_t i, std::size_t last) {
+    int depth = 0;
+    for (; i < last; ++i) {
+        if (toks[i].kind != Tok::Punct || toks[i].length != 1)
+            continue;
+        char c = text[toks[i].offset];
+        if (c == '(' || c == '[' || c == '{')
+            ++depth;
+        else if ((c == ')' || c == ']' || c == '}') && --depth == 0)
+            return i + 1;
+    }
+    return last;
+}
+
+std::size_t skip_angles(std::string_view text, const std::vector<Token>& toks, std::size_t i, std::size_t last) {
+    int depth = 0;
+    for (; i < last; ++i) {
+        std::string_view s = token_text(text, toks[i]);
+        if (s == "<")
+            ++depth;
+        else if (s == ">")
+            depth -= 1;
+        else if (s == ">>")
+            depth -= 2;
+        else if (s == ";" || s == "{" || (toks[i].kind == Tok::Ident && s[0] == '@'))
+            return i;
+        if (depth <= 0)
+            return i + 1;
+    }
+    return last;
+}
+
+std::size_t token_at(const std::vector<Token>& toks, std::uint64_t offset) {
+    auto it = std::lower_bound(toks.begin(), toks.end(), offset,
+                               [](const Token& t, std::uint64_t off) { return t.offset < off; });
+    return static_cast<std::size_t>(it - toks.begin());
+}
+
+} // namespace moby
@@ -0,0 +1,443 @@
+#include "moby/lsp.h"
+
+#include "moby/availability.h"
+#include "moby/doc_store.h"
+#include "moby/lexer.h"
+#include "moby/section_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+namespace {
+
+constexpr std::size_t kMaxResults = 100;  // definitions and workspace symbols
+constexpr std::size_t kMaxHovers = 5;     // declarations shown in one hover
+constexpr std::size_t kMaxHoverLines = 30;
+
+// JSON-RPC and LSP error codes.
+constexpr int kParseError = -32700;
+constexpr int kInvalidRequest = -32600;
+constexpr int kMethodNotFound = -32601;
+constexpr int kInternalError = -32603;
+
+// LSP SymbolKind for a corpus symbol; typedefs show as classes, as in clangd.
+int lsp_kind(SymbolKind k) {
+    switch (k) {
+    case SymbolKind::Protocol:
+        return 11;  // Interface
+    case SymbolKind::ClassMethod:
+    case SymbolKind::InstanceMethod:
+        return 6;   // Method
+    case SymbolKind::Property:
+        return 7;
+    case SymbolKind::Function:
+        return 12;
+    case SymbolKind::Enum:
+        return 10;
+    case SymbolKind::EnumConstant:
+        return 22;
+    case SymbolKind::Struct:
+    case SymbolKind::Union:
+        return 23;
+    case SymbolKind::Variable:
+        return 13;
+    default:
+        return 5;   // Class: interfaces, categories, typedefs
+    }
+}
+
+// "file:///a%20b/c.h" -> "/a b/c.h"; empty for other schemes.
+std::string uri_path(std::string_view uri) {
+    constexpr std::string_view kScheme = "file://";
+    if (uri.substr(0, kScheme.size()) != kScheme)
+        return {};
+    std::string out;
+    for (std::size_t i = kScheme.size(); i < uri.size(); ++i) {
+        if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(uri[i + 2]))) {
+            out += static_cast<char>(std::stoi(std::string(uri.substr(i + 1, 2)), nullptr, 16));
+            i += 2;
+        } else {
+            out += uri[i];
+        }
+    }
+    return out;
+}
+
+std::vector<std::uint64_t> line_starts(std::string_view text) {
+    std::vector<std::uint64_t> lines{0};
+    const char* p = text.data();
+    const char* end = p + text.size();
+    while (const void* nl = std::memchr(p, '\n', end - p)) {
+        p = static_cast<const char*>(nl) + 1;
+        lines.push_back(p - text.data());
+    }
+    return lines;
+}
+
+void append_position(std::string& out, const std::vector<std::uint64_t>& lines, std::uint64_t offset) {
+    auto line = std::upper_bound(lines.begin(), lines.end(), offset) - lines.begin() - 1;
+    out += "{\"line\":" + std::to_string(line) + ",\"character\":" + std::to_string(offset - lines[line]) + "}";
+}
+
+// Availability as a hover line: "iOS 7.0, macOS 10.9, deprecated: watchOS 6.0".
+std::string availability_line(const AvailabilityMatrix& matrix, std::size_t id) {
+    std::string introduced, deprecated, unavailable;
+    for (int p = 0; p < kPlatformCount; ++p) {
+        PlatformAvailability pa = matrix.get(id, static_cast<Platform>(p));
+        const char* name = platform_name(static_cast<Platform>(p));
+        auto add = [&](std::string& list, const std::string& item) { list += (list.empty() ? "" : ", ") + item; };
+        if (pa.unavailable)
+            add(unavailable, name);
+        else if (pa.introduced)
+            add(introduced, std::string(name) + " " + format_version(pa.introduced));
+        if (pa.deprecated)
+            add(deprecated, std::string(name) + " " + format_version(pa.deprecated));
+    }
+    std::string out = introduced;
+    if (!deprecated.empty())
+        out += (out.empty() ? "" : "; ") + std::string("deprecated: ") + deprecated;
+    if (!unavailable.empty())
+        out += (out.empty() ? "" : "; ") + std::string("unavailable: ") + unavailable;
+    return out;
+}
+
+// The declaration as hover shows it: containers up to their @interface or
+// @protocol line, anything else up to kMaxHoverLines lines.
+std::string_view hover_text(const SymbolRecord& r, std::string_view decl) {
+    if (r.kind == SymbolKind::Interface || r.kind == SymbolKind::Category || r.kind == SymbolKind::Protocol) {
+        std::size_t at = decl.find('@');
+        std::size_t nl = decl.find('\n', at == std::string_view::npos ? 0 : at);
+        return decl.substr(0, nl);
+    }
+    std::size_t end = 0;
+    for (std::size_t n = 0; n < kMaxHoverLines && end != std::string_view::npos; ++n)
+        end = decl.find('\n', end + (n != 0));
+    return decl.substr(0, end);
+}
+
+// HeaderDoc of symbol `name` as hover markdown: abstract and discussion, then
+// parameters, constants or fields, the result and notes. A constant's line
+// taken from its enum's comment is its description.
+std::string doc_markdown(const DocComment& doc, std::string_view name) {
+    std::string text, params, members, result, notes;
+    for (const DocTag& t : doc.tags) {
+        if (t.text.empty())
+            continue;
+        auto item = [&](std::string& list) {
+            list.append("- `").append(t.name).append("` ").append(t.text).append("\n");
+        };
+        if (t.tag == "abstract" || t.tag == "discussion")
+            text.append("\n").append(t.text).append("\n");
+        else if (t.tag == "param" && !t.name.empty())
+            item(params);
+        else if ((t.tag == "constant" || t.tag == "field" || t.tag == "var") && t.name == name)
+            text.append("\n").append(t.text).append("\n");
+        else if ((t.tag == "constant" || t.tag == "field") && !t.name.empty())
+            item(members);
+        else if (t.tag == "result")
+            result.append("\n**Returns** ").append(t.text).append("\n");
+        else if (t.tag == "note" || t.tag == "warning" || t.tag == "important" || t.tag == "deprecated")
+            notes.append("\n**").append(t.tag).append("** ").append(t.text).append("\n");
+    }
+    if (!params.empty())
+        text.append("\n**Parameters**\n").append(params);
+    if (!members.empty())
+        text.append("\n**Members**\n").append(members);
+    return text + result + notes;
+}
+
+} // namespace
+
+LspServer::LspServer(const std::string& corpus_dir)
+    : corpus_(corpus_dir), db_(SymbolDb::default_path(corpus_dir)), root_(fs::absolute(corpus_dir).lexically_normal()) {
+    if (db_.corpus_hash() != corpus_hash(corpus_))
+        throw Error("symbols.db is out of date; run 'moby symbols build'");
+    std::string matrix = AvailabilityMatrix::default_path(corpus_dir);
+    if (fs::exists(matrix)) {
+        availability_ = std::make_unique<AvailabilityMatrix>(matrix);
+        if (availability_->corpus_hash() != db_.corpus_hash() || availability_->size() != db_.size())
+            availability_.reset();
+    }
+    std::string docs = DocStore::default_path(corpus_dir);
+    if (fs::exists(docs)) {
+        docs_ = std::make_unique<DocStore>(docs);
+        if (docs_->corpus_hash() != db_.corpus_hash() || docs_->symbol_count() != db_.size())
+            docs_.reset();
+    }
+    if (!root_.empty() && root_.back() == '/')
+        root_.pop_back();
+    for (std::uint32_t f = 0; f < corpus_.files().size(); ++f)
+        paths_[root_ + "/" + corpus_.files()[f].name] = f;
+    file_lines_.reserve(corpus_.files().size());
+    for (const CorpusFile& f : corpus_.files())
+        file_lines_.push_back(line_starts(f.map.view()));
+}
+
+LspServer::~LspServer() = default;
+
+std::string LspServer::file_uri(std::uint32_t file) const {
+    std::string out = "file://";
+    for (char c : root_ + "/" + corpus_.files()[file].name) {
+        if (is_ident_char(c) || c == '/' || c == '.' || c == '-' || c == '~') {
+            out += c;
+        } else {
+            char buf[4];
+            std::snprintf(buf, sizeof buf, "%%%02X", static_cast<unsigned char>(c));
+            out += buf;
+        }
+    }
+    return out;
+}
+
+bool LspServer::text_of(const std::string& uri, Text& out) {
+    auto doc = documents_.find(uri);
+    if (doc != documents_.end()) {
+        out = {doc->second.text, &doc->second.lines};
+        return true;
+    }
+    auto file = paths_.find(uri_path(uri));
+    if (file == paths_.end())
+        return false;
+    out = {corpus_.files()[file->second].map.view(), &file_lines_[file->second]};
+    return true;
+}
+
+std::string LspServer::result(const Json& id, std::string_view value) const {
+    std::string out = "{\"jsonrpc\":\"2.0\",\"id\":";
+    append_json(out, id);
+    out += ",\"result\":";
+    out += value;
+    out += '}';
+    return out;
+}
+
+std::string LspServer::error(const Json& id, int code, std::string_view message) const {
+    std::string out = "{\"jsonrpc\":\"2.0\",\"id\":";
+    append_json(out, id);
+    out += ",\"error\":{\"code\":" + std::to_string(code) + ",\"message\":";
+    append_json_string(out, message);
+    out += "}}";
+    return out;
+}
+
+std::string LspServer::handle(std::string_view message) {
+    Json msg;
+    try {
+        msg = parse_json(message);
+    } catch (const Error& e) {
+        return error(Json(), kParseError, e.what());
+    }
+    const std::string& method = msg["method"].string;
+    const Json& id = msg["id"];
+    const Json& params = msg["params"];
+    bool request = !id.is_null();
+
+    if (method == "exit") {
+        exit_ = true;
+        return {};
+    }
+    if (!request) {
+        if (method == "textDocument/didOpen") {
+            Document& doc = documents_[params["textDocument"]["uri"].string];
+            doc.text = params["textDocument"]["text"].string;
+            doc.lines = line_starts(doc.text);
+        } else if (method == "textDocument/didChange") {
+            auto doc = documents_.find(params["textDocument"]["uri"].string);
+            const Json& changes = params["contentChanges"];
+            if (doc != documents_.end() && !changes.items.empty()) {
+                doc->second.text = changes.items.back()["text"].string;  // full sync
+                doc->second.lines = line_starts(doc->second.text);
+            }
+        } else if (method == "textDocument/didClose") {
+            documents_.erase(params["textDocument"]["uri"].string);
+        }
+        return {};
+    }
+    if (shutdown_)
+        return error(id, kInvalidRequest, "server is shut down");
+    try {
+        if (method == "initialize")
+            return result(id, "{\"capabilities\":{\"textDocumentSync\":1,\"hoverProvider\":true,"
+                              "\"definitionProvider\":true,\"workspaceSymbolProvider\":true},"
+                              "\"serverInfo\":{\"name\":\"moby\"}}");
+        if (method == "shutdown") {
+            shutdown_ = true;
+            return result(id, "null");
+        }
+        if (method == "textDocument/hover")
+            return result(id, hover(params));
+        if (method == "textDocument/definition")
+            return result(id, definition(params));
+        if (method == "workspace/symbol")
+            return result(id, workspace_symbol(params));
+    } catch (const std::exception& e) {
+        return error(id, kInternalError, e.what());
+    }
+    return error(id, kMethodNotFound, "unsupported method " + method);
+}
+
+// The declarations the identifier under the cursor may mean. A selector piece
+// also matches the selectors it starts; a declaration the cursor is inside
+// wins, and `[Class piece` or `-[Class piece` narrows to that class.
+std::vector<const SymbolRecord*> LspServer::resolve(const Json& params) {
+    std::vector<const SymbolRecord*> out;
+    const std::string& uri = params["textDocument"]["uri"].string;
+    Text doc;
+    if (!text_of(uri, doc))
+        return out;
+    auto line = static_cast<std::size_t>(params["position"]["line"].number);
+    if (line >= doc.lines->size())
+        return out;
+    std::uint64_t line_end = line + 1 < doc.lines->size() ? (*doc.lines)[line + 1] : doc.text.size();
+    std::uint64_t offset =
+        std::min<std::uint64_t>((*doc.lines)[line] + static_cast<std::uint64_t>(params["position"]["character"].number),
+                                line_end);
+    std::uint64_t begin = offset, end = offset;
+    while (begin > 0 && is_ident_char(doc.text[begin - 1]))
+        --begin;
+    while (end < doc.text.size() && is_ident_char(doc.text[end]))
+        ++end;
+    if (begin == end)
+        return out;
+    std::string word(doc.text.substr(begin, end - begin));
+
+    SymbolDb::Range range = db_.find(word);
+    if (range.count == 0)
+        range = db_.find(word + ":");
+    if (range.count == 0)
+        range = db_.with_prefix(word + ":");
+    for (const SymbolRecord& r : range) {
+        if (out.size() == kMaxResults)
+            break;
+        out.push_back(&r);
+    }
+
+    auto file = paths_.find(uri_path(uri));
+    if (file != paths_.end() && documents_.find(uri) == documents_.end()) {
+        for (const SymbolRecord* r : out)
+            if (db_.section(*r).file == file->second && r->offset <= offset && offset < r->offset + r->length)
+                return {r};
+    }
+    std::size_t at = begin;
+    while (at > 0 && (doc.text[at - 1] == ' ' || doc.text[at - 1] == '\t'))
+        --at;
+    std::size_t receiver = at;
+    while (receiver > 0 && is_ident_char(doc.text[receiver - 1]))
+        --receiver;
+    if (receiver < at && receiver > 0 && doc.text[receiver - 1] == '[') {
+        std::string_view cls = doc.text.substr(receiver, at - receiver);
+        std::vector<const SymbolRecord*> narrowed;
+        for (const SymbolRecord* r : out)
+            if (db_.parent(*r) == cls)
+                narrowed.push_back(r);
+        if (!narrowed.empty())
+            return narrowed;
+    }
+    return out;
+}
+
+// The range is the declared name (a selector's first piece), where editors
+// put the cursor, or the whole declaration when the name is not spelled in it.
+void LspServer::append_location(std::string& out, const SymbolRecord& r) {
+    std::uint32_t file = db_.section(r).file;
+    const std::vector<std::uint64_t>& lines = file_lines_[file];
+    std::string_view name = db_.name(r);
+    name = name.substr(0, name.find(':'));
+    std::string_view decl(corpus_.files()[file].map.data() + r.offset, r.length);
+    std::uint64_t begin = r.offset, end = r.offset + r.length;
+    for (std::size_t at = decl.find(name); !name.empty() && at != std::string_view::npos;
+         at = decl.find(name, at + 1)) {
+        bool whole = (at == 0 || !is_ident_char(decl[at - 1])) &&
+                     (at + name.size() == decl.size() || !is_ident_char(decl[at + name.size()]));
+        if (whole) {
+            begin = r.offset + at;
+            end = begin + name.size();
+            break;
+        }
+    }
+    out += "{\"uri\":";
+    append_json_string(out, file_uri(file));
+    out += ",\"range\":{\"start\":";
+    append_position(out, lines, begin);
+    out += ",\"end\":";
+    append_position(out, lines, end);
+    out += "}}";
+}
+
+std::string LspServer::hover(const Json& params) {
+    std::vector<const SymbolRecord*> found = resolve(params);
+    if (found.empty())
+        return "null";
+    std::string text;
+    for (std::size_t i = 0; i < found.size() && i < kMaxHovers; ++i) {
+        const SymbolRecord& r = *found[i];
+        std::string_view decl(corpus_.files()[db_.section(r).file].map.data() + r.offset, r.length);
+        if (i)
+            text += "\n---\n";
+        text += "```objc\n";
+        text += hover_text(r, decl);
+        text += "\n```\n";
+        text += kind_name(r.kind);
+        if (!db_.parent(r).empty() && r.kind != SymbolKind::Interface)
+            text.append(" in `").append(db_.parent(r)).append("`");
+        text.append(" — ").append(db_.section_path(r)).append("\n");
+        if (availability_) {
+            std::string line = availability_line(*availability_, db_.id_of(r));
+            if (!line.empty())
+                text.append("\nAvailable: ").append(line).append("\n");
+        }
+        DocComment doc;
+        if (docs_ && docs_->read(static_cast<std::uint32_t>(db_.id_of(r)), doc))
+            text += doc_markdown(doc, db_.name(r));
+    }
+    if (found.size() > kMaxHovers)
+        text += "\n---\n" + std::to_string(found.size() - kMaxHovers) + " more declarations\n";
+    std::string out = "{\"contents\":{\"kind\":\"markdown\",\"value\":";
+    append_json_string(out, text);
+    out += "}}";
+    return out;
+}
+
+std::string LspServer::definition(const Json& params) {
+    std::string out = "[";
+    for (const SymbolRecord* r : resolve(params)) {
+        if (out.size() > 1)
+            out += ',';
+        append_location(out, *r);
+    }
+    return out + "]";
+}
+
+std::string LspServer::workspace_symbol(const Json& params) {
+    const std::string& query = params["query"].string;
+    std::string out = "[";
+    if (query.empty())
+        return out + "]";
+    std::size_t n = 0;
+    for (const SymbolRecord& r : db_.with_prefix(query)) {
+        if (n++ == kMaxResults)
+            break;
+        if (n > 1)
+            out += ',';
+        out += "{\"name\":";
+        append_json_string(out, db_.name(r));
+        out += ",\"kind\":" + std::to_string(lsp_kind(r.kind));
+        if (!db_.parent(r).empty() && r.kind != SymbolKind::Interface) {
+            out += ",\"containerName\":";
+            append_json_string(out, db_.parent(r));
+        }
+        out += ",\"location\":";
+        append_location(out, r);
+        out += '}';
+    }
+    return out + "]";
+}
+
+} // namespace moby
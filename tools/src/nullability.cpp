@@ -0,0 +1,511 @@
+#include "moby/nullability.h"
+
+#include "moby/lexer.h"
+#include "moby/section_index.h"
+#include "moby/symbols.h"
+#include "moby/work_pool.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+namespace {
+
+struct NullabilityLayout {
+    std::uint64_t region_count;
+    std::uint64_t symbol_count;
+    std::uint64_t slot_count;
+    std::uint64_t regions;
+    std::uint64_t firsts;
+    std::uint64_t slots;
+};
+
+constexpr const char* kNames[] = {"-", "unspecified", "nonnull", "nullable", "null_resettable"};
+
+// Pointer typedefs the corpus uses but declares elsewhere (objc.h, dispatch,
+// xpc, os_log).
+constexpr std::string_view kPointerNames[] = {
+    "id",               "instancetype",    "Class",           "SEL",
+    "IMP",              "dispatch_queue_t", "dispatch_block_t", "dispatch_data_t",
+    "dispatch_group_t", "dispatch_semaphore_t", "dispatch_source_t", "dispatch_io_t",
+    "dispatch_object_t", "dispatch_workloop_t", "xpc_object_t",  "xpc_connection_t",
+    "os_log_t",
+};
+
+Nullability annotation(std::string_view s) {
+    if (s == "nullable" || s == "_Nullable" || s == "__nullable")
+        return Nullability::Nullable;
+    if (s == "nonnull" || s == "_Nonnull" || s == "__nonnull")
+        return Nullability::Nonnull;
+    if (s == "null_unspecified" || s == "_Null_unspecified" || s == "__null_unspecified")
+        return Nullability::Unspecified;
+    if (s == "null_resettable")
+        return Nullability::NullResettable;
+    return Nullability::None;
+}
+
+// Tokens of one declaration, with bracket matching.
+class Decl {
+public:
+    explicit Decl(std::string_view text) : text_(text) {
+        for (const Token& t : tokenize(text))
+            if (t.kind != Tok::Directive)
+                toks_.push_back(t);
+    }
+
+    std::size_t size() const { return toks_.size(); }
+    std::string_view str(std::size_t i) const { return i < size() ? token_text(text_, toks_[i]) : std::string_view(); }
+    bool punct(std::size_t i, char c) const { return i < size() && is_punct(text_, toks_[i], c); }
+    bool ident(std::size_t i) const { return i < size() && toks_[i].kind == Tok::Ident; }
+
+    std::size_t skip_group(std::size_t i) const { return moby::skip_group(text_, toks_, i, size()); }
+    std::size_t skip_angles(std::size_t i) const { return moby::skip_angles(text_, toks_, i, size()); }
+
+private:
+    std::string_view text_;
+    std::vector<Token> toks_;
+};
+
+// Which identifiers name pointer types, and which macros stand for a
+// nullability annotation (#define CM_NULLABLE __nullable).
+class TypeNames {
+public:
+    TypeNames() {
+        for (std::string_view s : kPointerNames)
+            pointers_.emplace(s);
+    }
+    bool is_pointer(std::string_view s) const { return pointers_.count(std::string(s)) != 0; }
+    bool add_pointer(std::string_view s) { return pointers_.emplace(s).second; }
+
+    Nullability annotation(std::string_view s) const {
+        Nullability n = moby::annotation(s);
+        if (n != Nullability::None || macros_.empty())
+            return n;
+        auto it = macros_.find(std::string(s));
+        return it != macros_.end() ? it->second : Nullability::None;
+    }
+    bool add_annotation(std::string_view macro, Nullability n) { return macros_.emplace(macro, n).second; }
+
+private:
+    std::unordered_set<std::string> pointers_;
+    std::unordered_map<std::string, Nullability> macros_;
+};
+
+// The nullability of the outermost pointer of the type in tokens [i, last).
+// Generic arguments and protocol lists are skipped; a (^name) or (*name)
+// group makes it a block or function pointer and ends the type.
+NullabilitySlot type_slot(const Decl& d, std::size_t i, std::size_t last, const TypeNames& names,
+                          bool in_region) {
+    int levels = 0;
+    bool named_pointer = false, error_base = false;
+    Nullability written = Nullability::None;
+    bool after_pointer = false;  // an annotation after the last '*' binds to the outermost pointer
+    auto note = [&](std::string_view s) {
+        Nullability a = names.annotation(s);
+        if (a != Nullability::None && (after_pointer || written == Nullability::None)) {
+            written = a;
+            return true;
+        }
+        return a != Nullability::None;
+    };
+    while (i < last) {
+        std::string_view s = d.str(i);
+        if (d.punct(i, '*') || d.punct(i, '^')) {
+            ++levels;
+            after_pointer = true;
+            if (written != Nullability::None && levels > 1)
+                written = Nullability::None;  // an inner pointer's annotation
+            ++i;
+        } else if (s == "<") {
+            i = d.skip_angles(i);
+        } else if (d.punct(i, '(')) {
+            std::size_t close = d.skip_group(i);
+            std::size_t first = i + 1;
+            while (first < close && d.ident(first) && is_macro_name(d.str(first)))
+                ++first;  // a calling-convention macro, as in (AL_APIENTRY *LPALENABLE)
+            if (d.punct(first, '^') || d.punct(first, '*')) {
+                for (std::size_t j = first; j + 1 < close; ++j) {
+                    if (d.punct(j, '*') || d.punct(j, '^')) {
+                        ++levels;
+                        after_pointer = true;
+                    } else if (d.ident(j)) {
+                        note(d.str(j));
+                    }
+                }
+                break;
+            }
+            i = close;
+        } else if (d.punct(i, '[')) {
+            i = d.skip_group(i);
+        } else if (d.ident(i)) {
+            if (!note(s)) {
+                if (s == "NSError" || s == "CFErrorRef")
+                    error_base = true;
+                if (levels == 0 && names.is_pointer(s))
+                    named_pointer = true;
+            }
+            ++i;
+        } else {
+            ++i;
+        }
+    }
+    levels += named_pointer;
+    if (levels == 0)
+        return {static_cast<std::uint8_t>(Nullability::None)};
+    if (written != Nullability::None)
+        return {static_cast<std::uint8_t>(written)};
+    if (levels == 2 && error_base && in_region)
+        return {static_cast<std::uint8_t>(static_cast<std::uint8_t>(Nullability::Nullable) | NullabilitySlot::kInferred)};
+    if (levels == 1 && in_region)
+        return {static_cast<std::uint8_t>(static_cast<std::uint8_t>(Nullability::Nonnull) | NullabilitySlot::kInferred)};
+    return {static_cast<std::uint8_t>(static_cast<std::uint8_t>(Nullability::Unspecified) | NullabilitySlot::kInferred)};
+}
+
+// - (Ret)part:(Type)name part:(Type)name ...;  A missing type is `id`.
+void method_slots(const Decl& d, const TypeNames& names, bool in_region, std::vector<NullabilitySlot>& out) {
+    static const Decl kId("id");
+    std::size_t i = 1;
+    if (d.punct(i, '(')) {
+        std::size_t close = d.skip_group(i);
+        out.push_back(type_slot(d, i + 1, close - 1, names, in_region));
+        i = close;
+    } else {
+        out.push_back(type_slot(kId, 0, 1, names, in_region));
+    }
+    for (; i < d.size() && !d.punct(i, ';'); ++i) {
+        if (d.punct(i, '(')) {
+            i = d.skip_group(i) - 1;  // a trailing macro such as NS_SWIFT_NAME(fetch(with:))
+            continue;
+        }
+        if (!d.punct(i, ':'))
+            continue;
+        if (d.punct(i + 1, '(')) {
+            std::size_t close = d.skip_group(i + 1);
+            out.push_back(type_slot(d, i + 2, close - 1, names, in_region));
+            i = close - 1;
+        } else {
+            out.push_back(type_slot(kId, 0, 1, names, in_region));
+        }
+    }
+}
+
+// @property (attributes) Type name;  Nullability may be an attribute.
+void property_slot(const Decl& d, const TypeNames& names, bool in_region, std::vector<NullabilitySlot>& out) {
+    std::size_t i = 1;
+    Nullability attribute = Nullability::None;
+    if (d.punct(i, '(')) {
+        std::size_t close = d.skip_group(i);
+        for (std::size_t j = i + 1; j + 1 < close; ++j)
+            if (d.ident(j) && names.annotation(d.str(j)) != Nullability::None)
+                attribute = names.annotation(d.str(j));
+        i = close;
+    }
+    std::size_t end = i;
+    while (end < d.size() && !d.punct(end, ';'))
+        ++end;
+    NullabilitySlot slot = type_slot(d, i, end, names, in_region);
+    if (attribute != Nullability::None && slot.value() != Nullability::None)
+        slot.bits = static_cast<std::uint8_t>(attribute);
+    out.push_back(slot);
+}
+
+// Ret name(Type a, Type b);  The return type is what precedes the name.
+void function_slots(const Decl& d, std::string_view name, const TypeNames& names, bool in_region,
+                    std::vector<NullabilitySlot>& out) {
+    std::size_t at = 0;
+    while (at < d.size() && !(d.str(at) == name && d.punct(at + 1, '('))) {
+        if (d.punct(at, '{'))
+            return;
+        at = d.punct(at, '(') ? d.skip_group(at) : at + 1;
+    }
+    if (at == d.size())
+        return;
+    out.push_back(type_slot(d, 0, at, names, in_region));
+    std::size_t close = d.skip_group(at + 1);
+    if (close == at + 3 && d.str(at + 2) == "void")
+        return;
+    std::size_t start = at + 2;
+    for (std::size_t j = start; j < close; ++j) {
+        if (d.punct(j, '(') || d.punct(j, '[')) {
+            j = d.skip_group(j) - 1;
+        } else if (d.str(j) == "<") {
+            j = d.skip_angles(j) - 1;
+        } else if (d.punct(j, ',') || j + 1 == close) {
+            if (j > start && d.str(start) != "..." && d.str(start) != ".")
+                out.push_back(type_slot(d, start, j, names, in_region));
+            start = j + 1;
+        }
+    }
+}
+
+// extern Type const name ...;
+void variable_slot(const Decl& d, std::string_view name, const TypeNames& names, bool in_region,
+                   std::vector<NullabilitySlot>& out) {
+    std::size_t at = 0;
+    while (at < d.size() && d.str(at) != name)
+        at = d.punct(at, '(') && !(d.punct(at + 1, '^') || d.punct(at + 1, '*')) ? d.skip_group(at) : at + 1;
+    out.push_back(type_slot(d, 0, at == d.size() ? at : at + 1, names, in_region));
+}
+
+// The region of [first, last), sorted by file and start, containing `offset`.
+const NullabilityRegion* find_region(const NullabilityRegion* first, const NullabilityRegion* last,
+                                     std::uint32_t file, std::uint64_t offset) {
+    const NullabilityRegion* it =
+        std::upper_bound(first, last, std::make_pair(file, offset),
+                         [](const std::pair<std::uint32_t, std::uint64_t>& key, const NullabilityRegion& r) {
+                             return key.first != r.file ? key.first < r.file : key.second < r.begin;
+                         });
+    if (it == first)
+        return nullptr;
+    --it;
+    return it->file == file && offset < it->end ? it : nullptr;
+}
+
+bool has_slots(SymbolKind k) {
+    return k == SymbolKind::InstanceMethod || k == SymbolKind::ClassMethod || k == SymbolKind::Property ||
+           k == SymbolKind::Function || k == SymbolKind::Variable;
+}
+
+// Regions, OS_OBJECT_DECL-style pointer types and one-word #defines
+// (#define CM_NULLABLE __nullable) of one section.
+struct SectionScan {
+    std::vector<NullabilityRegion> regions;
+    std::vector<std::string> object_types;
+    std::vector<std::pair<std::string, std::string>> aliases;
+};
+
+void scan_section(const Section& section, std::uint32_t ordinal, SectionScan& out) {
+    std::string_view text = section.text;
+    std::vector<Token> toks = tokenize(text);
+    std::uint64_t open = 0;
+    bool inside = false;
+    auto mark = [&](bool begin, std::size_t offset) {
+        if (begin && !inside) {
+            open = section.offset + offset;
+            inside = true;
+        } else if (!begin && inside) {
+            out.regions.push_back({open, section.offset + offset, section.file, ordinal});
+            inside = false;
+        }
+    };
+    for (std::size_t i = 0; i < toks.size(); ++i) {
+        const Token& t = toks[i];
+        std::string_view s = token_text(text, t);
+        if (t.kind == Tok::Directive) {
+            std::string_view name = directive_name(s);
+            if (name == "pragma" && s.find("assume_nonnull") != std::string_view::npos) {
+                mark(s.find("begin") != std::string_view::npos, t.offset);
+            } else if (name == "define") {
+                std::string_view body = s.substr(s.find("define") + 6);
+                std::vector<Token> words = tokenize(body);
+                if (words.size() == 2 && words[0].kind == Tok::Ident && words[1].kind == Tok::Ident)
+                    out.aliases.emplace_back(token_text(body, words[0]), token_text(body, words[1]));
+            }
+        } else if (t.kind == Tok::Ident) {
+            if (ends_with(s, "_ASSUME_NONNULL_BEGIN") || ends_with(s, "_ASSUME_NONNULL_END")) {
+                mark(ends_with(s, "_BEGIN"), t.offset);
+            } else if (s == "_Pragma" && i + 2 < toks.size() && toks[i + 2].kind == Tok::String) {
+                std::string_view arg = token_text(text, toks[i + 2]);
+                if (arg.find("assume_nonnull") != std::string_view::npos)
+                    mark(arg.find("begin") != std::string_view::npos, t.offset);
+            } else if (ends_with(s, "OBJECT_DECL") && i + 2 < toks.size() && is_punct(text, toks[i + 1], '(') &&
+                       toks[i + 2].kind == Tok::Ident) {
+                out.object_types.push_back(std::string(token_text(text, toks[i + 2])) + "_t");
+            }
+        }
+    }
+    if (inside)
+        out.regions.push_back({open, section.offset + text.size(), section.file, ordinal});
+}
+
+} // namespace
+
+const char* nullability_name(Nullability n) { return kNames[static_cast<int>(n)]; }
+
+std::string NullabilityIndex::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "nullability.idx").string();
+}
+
+NullabilityStats NullabilityIndex::build(const Corpus& corpus, const SymbolDb& db, const std::string& path) {
+    const auto& sections = corpus.sections();
+    std::vector<std::uint32_t> tasks(sections.size());
+    std::iota(tasks.begin(), tasks.end(), 0);
+    std::stable_sort(tasks.begin(), tasks.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return sections[a].length > sections[b].length; });
+    std::vector<SectionScan> scans(sections.size());
+    run_stealing(tasks, 0, [&](std::uint32_t i) { scan_section(sections[i], i, scans[i]); });
+
+    std::vector<NullabilityRegion> regions;
+    for (const SectionScan& s : scans)
+        regions.insert(regions.end(), s.regions.begin(), s.regions.end());
+    std::sort(regions.begin(), regions.end(), [](const NullabilityRegion& a, const NullabilityRegion& b) {
+        return a.file != b.file ? a.file < b.file : a.begin < b.begin;
+    });
+
+    // Pointer typedefs: the OS object types, then typedefs whose declarator
+    // or aliased type is a pointer, repeated until chains such as
+    // CFPropertyListRef -> CFTypeRef settle. Names the corpus declares as
+    // something else never count, and neither do class names: `NSString *`
+    // carries its own '*'. A protocol may share its name with a real pointer
+    // typedef (typedef id<NSFileProviderItem> NSFileProviderItem).
+    auto decl_text = [&](const SymbolRecord& r) {
+        const Section& s = sections[r.section];
+        return std::string_view(s.text.data() - s.offset + r.offset, r.length);
+    };
+    TypeNames names;
+    std::unordered_set<std::string_view> declared;
+    for (std::size_t id = 0; id < db.size(); ++id)
+        if (db.at(id).kind == SymbolKind::Typedef || db.at(id).kind == SymbolKind::Struct ||
+            db.at(id).kind == SymbolKind::Enum)
+            declared.insert(db.name(db.at(id)));
+    // Annotation macros, through chains of one-word #defines. A macro the
+    // target defines empty is still taken for its annotation.
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (const SectionScan& s : scans)
+            for (const auto& [macro, body] : s.aliases)
+                if (Nullability n = names.annotation(body); n != Nullability::None)
+                    changed |= names.add_annotation(macro, n);
+    }
+    std::unordered_set<std::string_view> classes;
+    for (std::size_t id = 0; id < db.size(); ++id)
+        if (db.at(id).kind == SymbolKind::Interface)
+            classes.insert(db.name(db.at(id)));
+    for (const SectionScan& s : scans)
+        for (const std::string& t : s.object_types)
+            if (!declared.count(t))
+                names.add_pointer(t);
+    std::vector<std::uint32_t> typedefs;
+    for (std::uint32_t id = 0; id < db.size(); ++id)
+        if (db.at(id).kind == SymbolKind::Typedef)
+            typedefs.push_back(id);
+    std::vector<Decl> typedef_decls;
+    typedef_decls.reserve(typedefs.size());
+    for (std::uint32_t id : typedefs)
+        typedef_decls.emplace_back(decl_text(db.at(id)));
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (std::size_t k = 0; k < typedefs.size(); ++k) {
+            std::string_view name = db.name(db.at(typedefs[k]));
+            if (names.is_pointer(name) || classes.count(name))
+                continue;
+            const Decl& d = typedef_decls[k];
+            std::size_t i = 0;
+            while (i < d.size() && d.str(i) != "typedef")
+                ++i;
+            // Skip the body of typedef struct {...} *Name.
+            for (std::size_t j = i; j < d.size(); ++j)
+                if (d.punct(j, '{')) {
+                    i = d.skip_group(j) - 1;
+                    break;
+                }
+            std::size_t end = d.size();
+            while (end > i && !d.punct(end - 1, ';'))
+                --end;
+            if (type_slot(d, i + 1, end ? end - 1 : end, names, false).value() != Nullability::None)
+                changed |= names.add_pointer(name);
+        }
+    }
+
+    std::vector<std::vector<NullabilitySlot>> parts(sections.size());
+    std::vector<std::vector<std::uint32_t>> part_ids(sections.size());
+    for (std::uint32_t id = 0; id < db.size(); ++id)
+        if (has_slots(db.at(id).kind))
+            part_ids[db.at(id).section].push_back(id);
+    std::vector<std::vector<std::uint32_t>> counts(sections.size());
+    const NullabilityRegion* regions_end = regions.data() + regions.size();
+    run_stealing(tasks, 0, [&](std::uint32_t s) {
+        for (std::uint32_t id : part_ids[s]) {
+            const SymbolRecord& r = db.at(id);
+            bool in_region = find_region(regions.data(), regions_end, sections[s].file, r.offset) != nullptr;
+            Decl d(decl_text(r));
+            std::size_t before = parts[s].size();
+            switch (r.kind) {
+            case SymbolKind::InstanceMethod:
+            case SymbolKind::ClassMethod:
+                method_slots(d, names, in_region, parts[s]);
+                break;
+            case SymbolKind::Property:
+                property_slot(d, names, in_region, parts[s]);
+                break;
+            case SymbolKind::Function:
+                function_slots(d, db.name(r), names, in_region, parts[s]);
+                break;
+            default:
+                variable_slot(d, db.name(r), names, in_region, parts[s]);
+                break;
+            }
+            counts[s].push_back(static_cast<std::uint32_t>(parts[s].size() - before));
+        }
+    });
+
+    NullabilityStats stats;
+    stats.regions = regions.size();
+    std::vector<std::uint32_t> slot_count(db.size() + 1, 0);
+    for (std::size_t s = 0; s < sections.size(); ++s)
+        for (std::size_t k = 0; k < part_ids[s].size(); ++k)
+            slot_count[part_ids[s][k]] = counts[s][k];
+    std::vector<std::uint32_t> firsts(db.size() + 1, 0);
+    for (std::size_t id = 0; id < db.size(); ++id)
+        firsts[id + 1] = firsts[id] + slot_count[id];
+    std::vector<NullabilitySlot> slots(firsts.back());
+    for (std::size_t s = 0; s < sections.size(); ++s) {
+        std::size_t at = 0;
+        for (std::size_t k = 0; k < part_ids[s].size(); ++k) {
+            std::uint32_t id = part_ids[s][k];
+            bool pointer = false;
+            for (std::uint32_t j = 0; j < counts[s][k]; ++j) {
+                NullabilitySlot slot = parts[s][at++];
+                slots[firsts[id] + j] = slot;
+                if (slot.value() == Nullability::None)
+                    continue;
+                pointer = true;
+                ++stats.slots;
+                if (!slot.inferred())
+                    ++stats.explicit_slots;
+                else if (slot.value() == Nullability::Unspecified)
+                    ++stats.unspecified;
+                else
+                    ++stats.inferred_slots;
+            }
+            stats.declarations += pointer;
+        }
+    }
+
+    BlobWriter w(kMagic, kVersion, moby::corpus_hash(corpus));
+    std::size_t layout_at = w.put(NullabilityLayout{});
+    NullabilityLayout layout{};
+    layout.region_count = regions.size();
+    layout.symbol_count = db.size();
+    layout.slot_count = slots.size();
+    layout.regions = w.put_array(regions);
+    layout.firsts = w.put_array(firsts);
+    layout.slots = w.put_array(slots);
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+    return stats;
+}
+
+NullabilityIndex::NullabilityIndex(const std::string& path) : reader_(path, kMagic, kVersion) {
+    const NullabilityLayout& l = *reader_.array<NullabilityLayout>(sizeof(BlobHeader), 1);
+    region_count_ = l.region_count;
+    symbol_count_ = l.symbol_count;
+    regions_ = reader_.array<NullabilityRegion>(l.regions, l.region_count);
+    firsts_ = reader_.array<std::uint32_t>(l.firsts, l.symbol_count + 1);
+    slots_ = reader_.array<NullabilitySlot>(l.slots, l.slot_count);
+    if (firsts_[symbol_count_] != l.slot_count)
+        throw Error(path + ": slot table out of bounds");
+}
+
+const NullabilityRegion* NullabilityIndex::region_at(std::uint32_t file, std::uint64_t offset) const {
+    return find_region(regions_, regions_ + region_count_, file, offset);
+}
+
+} // namespace moby
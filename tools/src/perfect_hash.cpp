@@ -0,0 +1,63 @@
+#include "moby/perfect_hash.h"
+
+#include "moby/error.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace moby {
+
+PerfectHash PerfectHash::build(const std::vector<std::uint64_t>& hashes) {
+    PerfectHash ph;
+    if (hashes.empty())
+        return ph;
+
+    std::uint64_t bucket_count = (hashes.size() + 3) / 4;
+    std::uint64_t slot_count = hashes.size() + hashes.size() / 4 + 1;
+    ph.displacements.assign(bucket_count, 0);
+    ph.slots.assign(slot_count, 0);
+
+    std::vector<std::vector<std::uint32_t>> buckets(bucket_count);
+    for (std::uint32_t i = 0; i < hashes.size(); ++i)
+        buckets[hashes[i] % bucket_count].push_back(i);
+
+    std::vector<std::uint32_t> order(bucket_count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    std::vector<std::uint64_t> taken;
+    for (std::uint32_t b : order) {
+        const auto& keys = buckets[b];
+        if (keys.empty())
+            break;
+        for (std::size_t i = 1; i < keys.size(); ++i)
+            for (std::size_t j = 0; j < i; ++j)
+                if (hashes[keys[i]] == hashes[keys[j]])
+                    throw Error("perfect hash: duplicate key hash");
+
+        for (std::uint32_t d = 0;; ++d) {
+            if (d == UINT32_MAX)
+                throw Error("perfect hash: no displacement found");
+            taken.clear();
+            bool ok = true;
+            for (std::uint32_t k : keys) {
+                std::uint64_t slot = perfect_hash_slot(hashes[k], d, slot_count);
+                if (ph.slots[slot] != 0 || std::find(taken.begin(), taken.end(), slot) != taken.end()) {
+                    ok = false;
+                    break;
+                }
+                taken.push_back(slot);
+            }
+            if (!ok)
+                continue;
+            for (std::size_t i = 0; i < keys.size(); ++i)
+                ph.slots[taken[i]] = keys[i] + 1;
+            ph.displacements[b] = d;
+            break;
+        }
+    }
+    return ph;
+}
+
+} // namespace moby
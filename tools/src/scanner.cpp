@@ -0,0 +1,269 @@
+#include "moby/scanner.h"
+
+#include "moby/lexer.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MOBY_X86 1
+#endif
+
+namespace moby {
+namespace {
+
+constexpr const char* kKindNames[kScanKindCount] = {
+    "separator", "@interface", "@protocol", "@end",  "typedef", "#import",       "#include",
+    "#if",       "#ifdef",     "#ifndef",   "#elif", "#else",   "#endif",        "API_AVAILABLE",
+    "API_UNAVAILABLE", "API_DEPRECATED",
+};
+
+struct Pattern {
+    std::string_view text;
+    ScanKind kind;
+    bool word;  // must not touch identifier characters on either side
+};
+
+// Longer spellings come before their prefixes.
+constexpr Pattern kPatterns[] = {
+    {"// ==========  ", ScanKind::Separator, false},
+    {"@interface", ScanKind::Interface, true},
+    {"@protocol", ScanKind::Protocol, true},
+    {"@end", ScanKind::End, true},
+    {"typedef", ScanKind::Typedef, true},
+    {"#import", ScanKind::Import, true},
+    {"#include", ScanKind::Include, true},
+    {"#ifndef", ScanKind::Ifndef, true},
+    {"#ifdef", ScanKind::Ifdef, true},
+    {"#if", ScanKind::If, true},
+    {"#elif", ScanKind::Elif, true},
+    {"#else", ScanKind::Else, true},
+    {"#endif", ScanKind::Endif, true},
+    {"API_AVAILABLE", ScanKind::ApiAvailable, true},
+    {"API_UNAVAILABLE", ScanKind::ApiUnavailable, true},
+    {"API_DEPRECATED_WITH_REPLACEMENT", ScanKind::ApiDeprecated, true},
+    {"API_DEPRECATED", ScanKind::ApiDeprecated, true},
+};
+
+// Anchor bytes of some pattern at `p`: its first two bytes, and for the
+// spellings that share them with common text a third at offset 3 or 4 that
+// tells them apart: "// =" but not every comment, "@pr?t" but not
+// @property, "ty??d" but not type, "AP?_". The SIMD paths test exactly these.
+inline bool is_candidate(const char* p, const char* end) {
+    std::size_t avail = static_cast<std::size_t>(end - p);
+    if (avail < 2)
+        return false;
+    char b = p[1];
+    switch (p[0]) {
+    case '/': return b == '/' && avail > 3 && p[3] == '=';
+    case '@': return b == 'i' || b == 'e' || (b == 'p' && avail > 4 && p[4] == 't');
+    case '#': return b == 'i' || b == 'e';
+    case 't': return b == 'y' && avail > 4 && p[4] == 'd';
+    case 'A': return b == 'P' && avail > 3 && p[3] == '_';
+    default: return false;
+    }
+}
+
+// Patterns grouped by first byte, with their first eight bytes preloaded so
+// a candidate is usually rejected by a single 64-bit compare.
+struct PatternTable {
+    struct Entry {
+        std::uint64_t head;
+        std::uint64_t mask;
+        const Pattern* pattern;
+    };
+    Entry entries[sizeof kPatterns / sizeof kPatterns[0]];
+    std::uint8_t first[256] = {};
+    std::uint8_t count[256] = {};
+
+    PatternTable() {
+        std::size_t n = 0;
+        for (int c = 0; c < 256; ++c) {
+            first[c] = static_cast<std::uint8_t>(n);
+            for (const Pattern& pat : kPatterns) {
+                if (static_cast<unsigned char>(pat.text[0]) != c)
+                    continue;
+                Entry& e = entries[n++];
+                std::size_t len = pat.text.size() < 8 ? pat.text.size() : 8;
+                e.head = 0;
+                std::memcpy(&e.head, pat.text.data(), len);
+                e.mask = len == 8 ? ~std::uint64_t(0) : (std::uint64_t(1) << (len * 8)) - 1;
+                e.pattern = &pat;
+            }
+            count[c] = static_cast<std::uint8_t>(n - first[c]);
+        }
+    }
+};
+
+const PatternTable kTable;
+
+// Verifies a candidate at `p`; returns the match length, or 0.
+inline std::size_t verify(const char* begin, const char* end, const char* p, ScanKind& kind) {
+    unsigned char c = static_cast<unsigned char>(*p);
+    std::size_t avail = static_cast<std::size_t>(end - p);
+    std::uint64_t head = 0;
+    std::memcpy(&head, p, avail < 8 ? avail : 8);
+    const PatternTable::Entry* e = kTable.entries + kTable.first[c];
+    for (const PatternTable::Entry* last = e + kTable.count[c]; e != last; ++e) {
+        const Pattern& pat = *e->pattern;
+        if ((head & e->mask) != e->head || avail < pat.text.size())
+            continue;
+        if (pat.text.size() > 8 && std::memcmp(p + 8, pat.text.data() + 8, pat.text.size() - 8) != 0)
+            continue;
+        if (pat.word) {
+            if (p > begin && is_ident_char(p[-1]))
+                return 0;
+            const char* after = p + pat.text.size();
+            if (after < end && is_ident_char(*after))
+                continue;
+        }
+        kind = pat.kind;
+        return pat.text.size();
+    }
+    return 0;
+}
+
+struct Emitter {
+    const char* begin;
+    const char* end;
+    std::vector<ScanHit>& out;
+    std::uint64_t base;
+    const char* resume;  // candidates inside the previous hit are ignored
+
+    inline void candidate(const char* p) {
+        if (p < resume)
+            return;
+        ScanKind kind;
+        if (std::size_t len = verify(begin, end, p, kind)) {
+            out.push_back({base + static_cast<std::uint64_t>(p - begin), kind});
+            resume = p + len;
+        }
+    }
+};
+
+void scan_scalar(Emitter& e, const char* p) {
+    for (; p + 1 < e.end; ++p)
+        if (is_candidate(p, e.end))
+            e.candidate(p);
+}
+
+#ifdef MOBY_X86
+
+__attribute__((target("sse4.2"))) void scan_sse42(Emitter& e) {
+    const __m128i slash = _mm_set1_epi8('/'), at = _mm_set1_epi8('@'), hash = _mm_set1_epi8('#');
+    const __m128i t = _mm_set1_epi8('t'), a_upper = _mm_set1_epi8('A');
+    const __m128i i = _mm_set1_epi8('i'), pl = _mm_set1_epi8('p'), el = _mm_set1_epi8('e');
+    const __m128i y = _mm_set1_epi8('y'), p_upper = _mm_set1_epi8('P');
+    const __m128i eq = _mm_set1_epi8('='), dl = _mm_set1_epi8('d');
+    const __m128i under = _mm_set1_epi8('_');
+
+    const char* p = e.begin;
+    for (; p + 20 <= e.end; p += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 3));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 4));
+        __m128i bi = _mm_cmpeq_epi8(b, i), be = _mm_cmpeq_epi8(b, el);
+        __m128i bp = _mm_and_si128(_mm_cmpeq_epi8(b, pl), _mm_cmpeq_epi8(d, t));
+        __m128i m = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(a, slash), _mm_cmpeq_epi8(b, slash)),
+                                  _mm_cmpeq_epi8(c, eq));
+        m = _mm_or_si128(m, _mm_and_si128(_mm_cmpeq_epi8(a, at), _mm_or_si128(_mm_or_si128(bi, be), bp)));
+        m = _mm_or_si128(m, _mm_and_si128(_mm_cmpeq_epi8(a, hash), _mm_or_si128(bi, be)));
+        m = _mm_or_si128(m, _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(a, t), _mm_cmpeq_epi8(b, y)),
+                                          _mm_cmpeq_epi8(d, dl)));
+        m = _mm_or_si128(m, _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(a, a_upper), _mm_cmpeq_epi8(b, p_upper)),
+                                          _mm_cmpeq_epi8(c, under)));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(m));
+        while (mask) {
+            e.candidate(p + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+    scan_scalar(e, p);
+}
+
+__attribute__((target("avx2"))) void scan_avx2(Emitter& e) {
+    const __m256i slash = _mm256_set1_epi8('/'), at = _mm256_set1_epi8('@'), hash = _mm256_set1_epi8('#');
+    const __m256i t = _mm256_set1_epi8('t'), a_upper = _mm256_set1_epi8('A');
+    const __m256i i = _mm256_set1_epi8('i'), pl = _mm256_set1_epi8('p'), el = _mm256_set1_epi8('e');
+    const __m256i y = _mm256_set1_epi8('y'), p_upper = _mm256_set1_epi8('P');
+    const __m256i eq = _mm256_set1_epi8('='), dl = _mm256_set1_epi8('d');
+    const __m256i under = _mm256_set1_epi8('_');
+
+    const char* p = e.begin;
+    for (; p + 36 <= e.end; p += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 3));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 4));
+        __m256i bi = _mm256_cmpeq_epi8(b, i), be = _mm256_cmpeq_epi8(b, el);
+        __m256i bp = _mm256_and_si256(_mm256_cmpeq_epi8(b, pl), _mm256_cmpeq_epi8(d, t));
+        __m256i m = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(a, slash), _mm256_cmpeq_epi8(b, slash)),
+                                     _mm256_cmpeq_epi8(c, eq));
+        m = _mm256_or_si256(m, _mm256_and_si256(_mm256_cmpeq_epi8(a, at), _mm256_or_si256(_mm256_or_si256(bi, be), bp)));
+        m = _mm256_or_si256(m, _mm256_and_si256(_mm256_cmpeq_epi8(a, hash), _mm256_or_si256(bi, be)));
+        m = _mm256_or_si256(m, _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(a, t), _mm256_cmpeq_epi8(b, y)),
+                                                _mm256_cmpeq_epi8(d, dl)));
+        m = _mm256_or_si256(m, _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(a, a_upper),
+                                                                 _mm256_cmpeq_epi8(b, p_upper)),
+                                                _mm256_cmpeq_epi8(c, under)));
+        std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(m));
+        while (mask) {
+            e.candidate(p + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+    scan_scalar(e, p);
+}
+
+#endif
+
+} // namespace
+
+const char* scan_kind_name(ScanKind kind) { return kKindNames[static_cast<int>(kind)]; }
+
+const char* isa_name(Isa isa) {
+    switch (isa) {
+    case Isa::Avx2: return "avx2";
+    case Isa::Sse42: return "sse4.2";
+    default: return "scalar";
+    }
+}
+
+bool isa_supported(Isa isa) {
+#ifdef MOBY_X86
+    switch (isa) {
+    case Isa::Avx2: return __builtin_cpu_supports("avx2");
+    case Isa::Sse42: return __builtin_cpu_supports("sse4.2");
+    default: return true;
+    }
+#else
+    return isa == Isa::Scalar;
+#endif
+}
+
+Isa best_isa() {
+    static const Isa best = isa_supported(Isa::Avx2) ? Isa::Avx2 : isa_supported(Isa::Sse42) ? Isa::Sse42 : Isa::Scalar;
+    return best;
+}
+
+void scan(std::string_view text, std::vector<ScanHit>& out, std::uint64_t base) {
+    scan(text, out, base, best_isa());
+}
+
+void scan(std::string_view text, std::vector<ScanHit>& out, std::uint64_t base, Isa isa) {
+    Emitter e{text.data(), text.data() + text.size(), out, base, text.data()};
+#ifdef MOBY_X86
+    if (isa == Isa::Avx2 && isa_supported(Isa::Avx2)) {
+        scan_avx2(e);
+        return;
+    }
+    if (isa == Isa::Sse42 && isa_supported(Isa::Sse42)) {
+        scan_sse42(e);
+        return;
+    }
+#endif
+    scan_scalar(e, e.begin);
+}
+
+} // namespace moby
@@ -0,0 +1,198 @@
+#include "moby/sdk_diff.h"
+
+#include "moby/hash.h"
+#include "moby/lexer.h"
+#include "moby/symbol_db.h"
+#include "moby/work_pool.h"
+
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+namespace moby {
+namespace {
+
+// Symbols fingerprinted per task.
+constexpr std::uint32_t kBlockSize = 2048;
+
+std::uint64_t hash_availability(const Availability& a) {
+    std::uint64_t h = 0;
+    for (const PlatformAvailability& p : a.platforms) {
+        std::uint32_t fields[4] = {p.introduced, p.deprecated, p.obsoleted, p.unavailable};
+        h = hash64(fields, sizeof fields, h);
+    }
+    return h;
+}
+
+std::string_view symbol_text(const Corpus& corpus, const Symbol& s) {
+    const Section& section = corpus.sections()[s.section];
+    return corpus.files()[section.file].map.view().substr(s.offset, s.length);
+}
+
+std::uint64_t identity_of(std::string_view framework, const Symbol& s) {
+    std::uint64_t h = hash64(framework);
+    h = hash64(&s.kind, sizeof s.kind, h);
+    h = hash64(s.parent, h);
+    return hash64(s.name, h);
+}
+
+// Display order within a framework.
+auto display_key(const ApiSnapshot& snap, const ApiFingerprint& api) {
+    const Symbol& s = snap.symbols()[api.symbol];
+    return std::make_tuple(snap.framework(api), static_cast<int>(s.kind), std::string_view(s.parent),
+                           std::string_view(s.name));
+}
+
+} // namespace
+
+bool is_availability_macro(std::string_view ident) {
+    if (!is_macro_name(ident))
+        return false;
+    for (std::string_view word : {"AVAILABLE", "DEPRECATED", "PROHIBITED", "OBSOLETED"})
+        if (ident.find(word) != std::string_view::npos)
+            return true;
+    return false;
+}
+
+std::string normalized_declaration(SymbolKind kind, std::string_view decl) {
+    decl = annotation_text(kind, decl);
+    std::vector<Token> toks = tokenize(decl);
+    std::string out;
+    out.reserve(decl.size());
+    for (std::size_t i = 0; i < toks.size();) {
+        const Token& t = toks[i];
+        if (t.kind == Tok::Directive) {
+            ++i;
+            continue;
+        }
+        std::string_view s = token_text(decl, t);
+        if (t.kind == Tok::Ident && is_availability_macro(s)) {
+            ++i;
+            if (i < toks.size() && is_punct(decl, toks[i], '('))
+                i = skip_group(decl, toks, i, toks.size());
+            continue;
+        }
+        if (kind == SymbolKind::Enum && is_punct(decl, t, '{')) {
+            i = skip_group(decl, toks, i, toks.size());
+            continue;
+        }
+        if (!out.empty())
+            out += ' ';
+        out.append(s);
+        ++i;
+    }
+    return out;
+}
+
+std::string describe_availability(const Availability& a) {
+    std::string out;
+    for (int p = 0; p < kPlatformCount; ++p) {
+        const PlatformAvailability& pa = a.platforms[p];
+        if (!pa.annotated())
+            continue;
+        if (!out.empty())
+            out += ", ";
+        out += platform_name(static_cast<Platform>(p));
+        if (pa.unavailable)
+            out += " unavailable";
+        if (pa.introduced)
+            out += " " + format_version(pa.introduced);
+        if (pa.deprecated)
+            out += " deprecated " + format_version(pa.deprecated);
+        if (pa.obsoleted)
+            out += " obsoleted " + format_version(pa.obsoleted);
+    }
+    return out.empty() ? "none" : out;
+}
+
+ApiSnapshot::ApiSnapshot(const std::string& dir, unsigned threads)
+    : corpus_(std::make_unique<Corpus>(dir)), symbols_(extract_corpus_symbols(*corpus_, threads)) {
+    struct Occurrence {
+        std::uint64_t identity, declaration, availability;
+        std::uint32_t symbol;
+    };
+    std::vector<Occurrence> occurrences(symbols_.size());
+    std::vector<std::uint32_t> blocks((symbols_.size() + kBlockSize - 1) / kBlockSize);
+    std::iota(blocks.begin(), blocks.end(), 0);
+    run_stealing(blocks, threads, [&](std::uint32_t block) {
+        std::uint32_t end = std::min<std::uint32_t>((block + 1) * kBlockSize, symbols_.size());
+        for (std::uint32_t i = block * kBlockSize; i < end; ++i) {
+            const Symbol& s = symbols_[i];
+            std::string_view decl = symbol_text(*corpus_, s);
+            Availability avail;
+            parse_availability(annotation_text(s.kind, decl), avail);
+            std::string norm = normalized_declaration(s.kind, decl);
+            occurrences[i] = {identity_of(corpus_->files()[corpus_->sections()[s.section].file].framework, s),
+                              norm.empty() ? 0 : hash64(norm), hash_availability(avail), i};
+        }
+    });
+
+    // Occurrences sharing an identity (an API declared in both arms of an
+    // #if, or in two headers) become one API whose fingerprints cover all of
+    // them, independent of their order in the corpus.
+    std::sort(occurrences.begin(), occurrences.end(), [](const Occurrence& a, const Occurrence& b) {
+        return std::tie(a.identity, a.declaration, a.availability, a.symbol) <
+               std::tie(b.identity, b.declaration, b.availability, b.symbol);
+    });
+    for (std::size_t i = 0; i < occurrences.size();) {
+        std::size_t j = i;
+        ApiFingerprint api{occurrences[i].identity, 0, 0, occurrences[i].symbol, 0};
+        for (; j < occurrences.size() && occurrences[j].identity == api.identity; ++j) {
+            api.declaration = api.count ? hash64(&occurrences[j].declaration, 8, api.declaration)
+                                        : occurrences[j].declaration;
+            api.availability = api.count ? hash64(&occurrences[j].availability, 8, api.availability)
+                                         : occurrences[j].availability;
+            api.symbol = std::min(api.symbol, occurrences[j].symbol);
+            ++api.count;
+        }
+        apis_.push_back(api);
+        i = j;
+    }
+}
+
+std::string_view ApiSnapshot::framework(const ApiFingerprint& api) const {
+    return corpus_->files()[corpus_->sections()[symbols_[api.symbol].section].file].framework;
+}
+
+std::string_view ApiSnapshot::declaration_text(const ApiFingerprint& api) const {
+    return symbol_text(*corpus_, symbols_[api.symbol]);
+}
+
+Availability ApiSnapshot::availability(const ApiFingerprint& api) const {
+    const Symbol& s = symbols_[api.symbol];
+    Availability avail;
+    parse_availability(annotation_text(s.kind, symbol_text(*corpus_, s)), avail);
+    return avail;
+}
+
+std::vector<ApiDiff> diff_apis(const ApiSnapshot& before, const ApiSnapshot& after) {
+    const auto& a = before.apis();
+    const auto& b = after.apis();
+    std::vector<ApiDiff> out;
+    std::size_t i = 0, j = 0;
+    while (i < a.size() || j < b.size()) {
+        if (j == b.size() || (i < a.size() && a[i].identity < b[j].identity)) {
+            out.push_back({&a[i++], nullptr, kApiRemoved});
+        } else if (i == a.size() || b[j].identity < a[i].identity) {
+            out.push_back({nullptr, &b[j++], kApiAdded});
+        } else {
+            std::uint8_t changes = 0;
+            if (a[i].declaration != b[j].declaration)
+                changes |= kApiDeclarationChanged;
+            if (a[i].availability != b[j].availability)
+                changes |= kApiAvailabilityChanged;
+            if (changes)
+                out.push_back({&a[i], &b[j], changes});
+            ++i;
+            ++j;
+        }
+    }
+    std::sort(out.begin(), out.end(), [&](const ApiDiff& x, const ApiDiff& y) {
+        auto kx = x.after ? display_key(after, *x.after) : display_key(before, *x.before);
+        auto ky = y.after ? display_key(after, *y.after) : display_key(before, *y.before);
+        return kx < ky;
+    });
+    return out;
+}
+
+} // namespace moby
@@ -0,0 +1,155 @@
+#include "moby/search.h"
+
+#include <algorithm>
+#include <cstring>
+#include <regex>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace moby {
+namespace {
+
+bool equal_at(const char* p, std::string_view needle, bool fold) {
+    if (!fold)
+        return std::memcmp(p, needle.data(), needle.size()) == 0;
+    for (std::size_t k = 0; k < needle.size(); ++k)
+        if (fold_ascii(static_cast<unsigned char>(p[k])) != static_cast<unsigned char>(needle[k]))
+            return false;
+    return true;
+}
+
+// Next occurrence of `needle` (already folded when `fold`) at or after `pos`.
+// Blocks of 16 positions are screened by comparing the needle's first and
+// last bytes at once; with `fold`, bit 0x20 is ignored in that screen, which
+// admits both cases of a letter and is settled by the exact compare.
+std::size_t find_in(std::string_view text, std::string_view needle, std::size_t pos, bool fold) {
+    if (needle.empty())
+        return pos <= text.size() ? pos : std::string_view::npos;
+    if (pos > text.size() || needle.size() > text.size() - pos)
+        return std::string_view::npos;
+    std::size_t last = text.size() - needle.size();  // last possible start
+    std::size_t span = needle.size() - 1;
+    const char* data = text.data();
+#ifdef __SSE2__
+    const char case_bit = fold ? 0x20 : 0;
+    const __m128i mask = _mm_set1_epi8(case_bit);
+    const __m128i first = _mm_set1_epi8(static_cast<char>(needle[0] | case_bit));
+    const __m128i final = _mm_set1_epi8(static_cast<char>(needle[span] | case_bit));
+    for (; pos + 16 <= last + 1; pos += 16) {
+        __m128i a = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)), mask);
+        __m128i b = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + span)), mask);
+        unsigned bits = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, final))));
+        while (bits) {
+            std::size_t at = pos + static_cast<std::size_t>(__builtin_ctz(bits));
+            if (equal_at(data + at, needle, fold))
+                return at;
+            bits &= bits - 1;
+        }
+    }
+#endif
+    for (; pos <= last; ++pos)
+        if (equal_at(data + pos, needle, fold))
+            return pos;
+    return std::string_view::npos;
+}
+
+std::string folded(std::string_view s) {
+    std::string out(s);
+    for (char& c : out)
+        c = static_cast<char>(fold_ascii(static_cast<unsigned char>(c)));
+    return out;
+}
+
+} // namespace
+
+Searcher::Searcher(const std::string& corpus_dir)
+    : sections_(SectionIndex::default_path(corpus_dir), corpus_dir),
+      trigrams_(TrigramIndex::default_path(corpus_dir)) {
+    if (sections_.corpus_hash() != trigrams_.corpus_hash() || sections_.size() != trigrams_.section_count())
+        throw Error("trigrams.idx and sections.idx were built from different corpora; rebuild them");
+}
+
+SearchStats Searcher::search(std::string_view pattern, const SearchOptions& options,
+                             const std::function<void(const SearchHit&)>& fn) const {
+    RegexAnalysis analysis = analyze_regex(pattern, options.fixed);
+    std::regex re;
+    if (!analysis.literal) {
+        auto flags = std::regex::ECMAScript | std::regex::optimize;
+        if (options.ignore_case)
+            flags |= std::regex::icase;
+        try {
+            re.assign(pattern.begin(), pattern.end(), flags);
+        } catch (const std::regex_error& e) {
+            throw Error("bad pattern: " + std::string(e.what()));
+        }
+    }
+    // The longest required literal is looked for with a plain substring
+    // search; a line containing it must also contain the others before the
+    // regex runs on it. For a literal pattern that is the whole pattern.
+    std::vector<std::string> literals = std::move(analysis.required);
+    if (options.ignore_case)
+        for (std::string& l : literals)
+            l = folded(l);
+    std::string needle = literals.empty() ? std::string() : literals[0];
+
+    SearchStats stats;
+    Bitset candidates = trigrams_.candidates(analysis.query);
+    std::string prefix = options.framework.empty() ? std::string() : options.framework + ".framework/";
+    candidates.for_each([&](std::size_t id) {
+        if (stats.hits >= options.max_hits)
+            return;
+        const SectionRecord& record = sections_.at(id);
+        if (!prefix.empty() && sections_.path(record).substr(0, prefix.size()) != prefix)
+            return;
+        ++stats.candidates;
+        std::string_view text = sections_.text(record);
+        stats.scanned += text.size();
+
+        std::uint32_t line = 1;
+        std::size_t counted = 0;  // newlines before this offset are in `line`
+        auto report = [&](std::size_t begin, std::size_t end) {
+            line += static_cast<std::uint32_t>(std::count(text.begin() + counted, text.begin() + begin, '\n'));
+            counted = begin;
+            ++stats.hits;
+            fn({&record, line, text.substr(begin, end - begin)});
+        };
+        auto line_matches = [&](std::size_t begin, std::size_t end) {
+            if (analysis.literal)
+                return true;
+            std::string_view line_text = text.substr(begin, end - begin);
+            for (std::size_t i = 1; i < literals.size(); ++i)
+                if (find_in(line_text, literals[i], 0, options.ignore_case) == std::string_view::npos)
+                    return false;
+            return std::regex_search(line_text.begin(), line_text.end(), re);
+        };
+
+        if (needle.empty()) {
+            for (std::size_t begin = 0; begin < text.size() && stats.hits < options.max_hits;) {
+                std::size_t end = text.find('\n', begin);
+                if (end == std::string_view::npos)
+                    end = text.size();
+                if (line_matches(begin, end))
+                    report(begin, end);
+                begin = end + 1;
+            }
+            return;
+        }
+        for (std::size_t at = find_in(text, needle, 0, options.ignore_case);
+             at != std::string_view::npos && stats.hits < options.max_hits;) {
+            std::size_t begin = text.rfind('\n', at);
+            begin = begin == std::string_view::npos ? 0 : begin + 1;
+            std::size_t end = text.find('\n', at);
+            if (end == std::string_view::npos)
+                end = text.size();
+            if (line_matches(begin, end))
+                report(begin, end);
+            at = end < text.size() ? find_in(text, needle, end + 1, options.ignore_case) : std::string_view::npos;
+        }
+    });
+    return stats;
+}
+
+} // namespace moby
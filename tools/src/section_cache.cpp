@@ -0,0 +1,257 @@
+#include "moby/section_cache.h"
+
+#include "moby/hash.h"
+#include "moby/section_index.h"
+#include "moby/symbol_db.h"
+#include "moby/work_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <numeric>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+
+struct SectionCache::Entry {
+    std::uint64_t content_hash;
+    std::uint64_t length;
+    std::uint32_t first_symbol;
+    std::uint32_t symbol_count;
+    std::uint32_t first_include;
+    std::uint32_t include_count;
+};
+
+struct SectionCache::CachedSymbol {
+    StrRef name;
+    StrRef parent;
+    std::uint32_t offset;  // relative to the section content
+    std::uint32_t length;
+    SymbolKind kind;
+    std::uint8_t reserved[7];
+};
+
+struct SectionCache::CachedAvailability {
+    std::uint32_t introduced[kPlatformCount];
+    std::uint32_t deprecated[kPlatformCount];
+    std::uint32_t obsoleted[kPlatformCount];
+    std::uint32_t unavailable;  // bit per platform
+};
+
+struct SectionCache::CachedInclude {
+    StrRef target;
+    std::uint32_t quoted;
+    std::uint32_t reserved;
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct CacheLayout {
+    std::uint64_t entry_count;
+    std::uint64_t symbol_count;
+    std::uint64_t include_count;
+    std::uint64_t entries;
+    std::uint64_t symbols;
+    std::uint64_t availability;
+    std::uint64_t includes;
+    std::uint64_t strings;
+    std::uint64_t strings_size;
+};
+
+double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+} // namespace
+
+void analyze_section(const Section& section, std::uint32_t ordinal, SectionResult& out) {
+    extract_symbols(section.text, section.offset, ordinal, out.symbols);
+    section_availability(section, out.symbols, out.availability);
+    section_includes(section.text, out.includes);
+}
+
+std::string SectionCache::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "sections.cache").string();
+}
+
+void SectionCache::write(const Corpus& corpus, const std::vector<std::uint64_t>& hashes,
+                         const std::vector<SectionResult>& results, const std::string& path) {
+    const auto& sections = corpus.sections();
+    std::vector<std::uint32_t> order(sections.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) { return hashes[a] < hashes[b]; });
+
+    StringPool strings;
+    std::vector<Entry> entries;
+    std::vector<CachedSymbol> symbols;
+    std::vector<CachedAvailability> availability;
+    std::vector<CachedInclude> includes;
+    for (std::uint32_t i : order) {
+        // Identical sections share one entry.
+        if (!entries.empty() && entries.back().content_hash == hashes[i] && entries.back().length == sections[i].length)
+            continue;
+        const SectionResult& r = results[i];
+        Entry e{hashes[i], sections[i].length, static_cast<std::uint32_t>(symbols.size()),
+                static_cast<std::uint32_t>(r.symbols.size()), static_cast<std::uint32_t>(includes.size()),
+                static_cast<std::uint32_t>(r.includes.size())};
+        entries.push_back(e);
+        for (std::size_t k = 0; k < r.symbols.size(); ++k) {
+            const Symbol& s = r.symbols[k];
+            CachedSymbol cs{};
+            cs.name = strings.add(s.name);
+            cs.parent = strings.add(s.parent);
+            cs.offset = static_cast<std::uint32_t>(s.offset - sections[i].offset);
+            cs.length = s.length;
+            cs.kind = s.kind;
+            symbols.push_back(cs);
+            CachedAvailability ca{};
+            for (int p = 0; p < kPlatformCount; ++p) {
+                const PlatformAvailability& pa = r.availability[k].platforms[p];
+                ca.introduced[p] = pa.introduced;
+                ca.deprecated[p] = pa.deprecated;
+                ca.obsoleted[p] = pa.obsoleted;
+                ca.unavailable |= static_cast<std::uint32_t>(pa.unavailable) << p;
+            }
+            availability.push_back(ca);
+        }
+        for (const IncludeDirective& d : r.includes)
+            includes.push_back({strings.add(d.target), d.quoted, 0});
+    }
+
+    BlobWriter w(kMagic, kVersion, moby::corpus_hash(corpus));
+    std::size_t layout_at = w.put(CacheLayout{});
+    CacheLayout layout{};
+    layout.entry_count = entries.size();
+    layout.symbol_count = symbols.size();
+    layout.include_count = includes.size();
+    layout.entries = w.put_array(entries);
+    layout.symbols = w.put_array(symbols);
+    layout.availability = w.put_array(availability);
+    layout.includes = w.put_array(includes);
+    layout.strings = w.put_bytes(strings.data().data(), strings.data().size());
+    layout.strings_size = strings.data().size();
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+}
+
+SectionCache::SectionCache(const std::string& path) : reader_(path, kMagic, kVersion) {
+    const CacheLayout& l = *reader_.array<CacheLayout>(sizeof(BlobHeader), 1);
+    entry_count_ = l.entry_count;
+    entries_ = reader_.array<Entry>(l.entries, l.entry_count);
+    symbols_ = reader_.array<CachedSymbol>(l.symbols, l.symbol_count);
+    availability_ = reader_.array<CachedAvailability>(l.availability, l.symbol_count);
+    includes_ = reader_.array<CachedInclude>(l.includes, l.include_count);
+    reader_.bytes(l.strings, l.strings_size);
+    strings_ = l.strings;
+    for (std::uint64_t i = 0; i < entry_count_; ++i) {
+        const Entry& e = entries_[i];
+        if (std::uint64_t(e.first_symbol) + e.symbol_count > l.symbol_count ||
+            std::uint64_t(e.first_include) + e.include_count > l.include_count)
+            throw Error(path + ": entry out of bounds");
+    }
+}
+
+bool SectionCache::load(const Corpus& corpus, std::uint32_t ordinal, std::uint64_t content_hash,
+                        SectionResult& out) const {
+    const Section& section = corpus.sections()[ordinal];
+    const Entry* e = std::lower_bound(entries_, entries_ + entry_count_, content_hash,
+                                      [](const Entry& entry, std::uint64_t h) { return entry.content_hash < h; });
+    for (; e != entries_ + entry_count_ && e->content_hash == content_hash; ++e)
+        if (e->length == section.length)
+            break;
+    if (e == entries_ + entry_count_ || e->content_hash != content_hash)
+        return false;
+
+    out.symbols.reserve(out.symbols.size() + e->symbol_count);
+    for (std::uint32_t k = e->first_symbol; k < e->first_symbol + e->symbol_count; ++k) {
+        const CachedSymbol& cs = symbols_[k];
+        out.symbols.push_back({std::string(reader_.str(strings_, cs.name)), std::string(reader_.str(strings_, cs.parent)),
+                               cs.kind, ordinal, section.offset + cs.offset, cs.length});
+        const CachedAvailability& ca = availability_[k];
+        Availability a;
+        for (int p = 0; p < kPlatformCount; ++p)
+            a.platforms[p] = {ca.introduced[p], ca.deprecated[p], ca.obsoleted[p], (ca.unavailable >> p & 1) != 0};
+        out.availability.push_back(a);
+    }
+    for (std::uint32_t k = e->first_include; k < e->first_include + e->include_count; ++k)
+        out.includes.push_back({std::string(reader_.str(strings_, includes_[k].target)), includes_[k].quoted != 0});
+    return true;
+}
+
+RebuildStats rebuild_indexes(const Corpus& corpus, unsigned threads, bool full) {
+    const auto& sections = corpus.sections();
+    const std::string& dir = corpus.dir();
+    RebuildStats stats;
+    stats.sections = sections.size();
+
+    auto start = Clock::now();
+    std::vector<std::uint64_t> hashes(sections.size());
+    for (std::size_t i = 0; i < sections.size(); ++i)
+        hashes[i] = hash64(sections[i].text);
+    stats.hash_ms = ms_since(start);
+
+    start = Clock::now();
+    std::unique_ptr<SectionCache> cache;
+    if (!full && fs::exists(SectionCache::default_path(dir))) {
+        try {
+            cache = std::make_unique<SectionCache>(SectionCache::default_path(dir));
+        } catch (const Error&) {
+            // Stale format or damaged file: parse everything.
+        }
+    }
+    std::vector<SectionResult> results(sections.size());
+    std::vector<std::uint32_t> tasks;
+    for (std::uint32_t i = 0; i < sections.size(); ++i)
+        if (!cache || !cache->load(corpus, i, hashes[i], results[i]))
+            tasks.push_back(i);
+    std::stable_sort(tasks.begin(), tasks.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return sections[a].length > sections[b].length; });
+    run_stealing(tasks, threads, [&](std::uint32_t i) { analyze_section(sections[i], i, results[i]); });
+    stats.parsed = tasks.size();
+    stats.reused = sections.size() - tasks.size();
+    stats.parse_ms = ms_since(start);
+
+    // The output files are independent of each other; write them side by side.
+    start = Clock::now();
+    run_stealing({0, 1, 2, 3}, threads, [&](std::uint32_t task) {
+        switch (task) {
+        case 0: {
+            std::vector<Symbol> symbols;
+            std::vector<Availability> availability;
+            for (const SectionResult& r : results) {
+                symbols.insert(symbols.end(), r.symbols.begin(), r.symbols.end());
+                availability.insert(availability.end(), r.availability.begin(), r.availability.end());
+            }
+            std::vector<std::uint32_t> ids = SymbolDb::build(corpus, symbols, SymbolDb::default_path(dir));
+            std::vector<Availability> by_id(availability.size());
+            for (std::size_t k = 0; k < availability.size(); ++k)
+                by_id[ids[k]] = availability[k];
+            AvailabilityMatrix::write(moby::corpus_hash(corpus), by_id, AvailabilityMatrix::default_path(dir));
+            break;
+        }
+        case 1: {
+            std::vector<std::vector<IncludeDirective>> includes(sections.size());
+            for (std::size_t i = 0; i < sections.size(); ++i)
+                includes[i] = results[i].includes;
+            IncludeGraph::build(corpus, includes, IncludeGraph::default_path(dir));
+            break;
+        }
+        case 2:
+            SectionCache::write(corpus, hashes, results, SectionCache::default_path(dir));
+            break;
+        case 3:
+            SectionIndex::build(corpus, SectionIndex::default_path(dir));
+            break;
+        }
+    });
+    stats.write_ms = ms_since(start);
+    return stats;
+}
+
+} // namespace moby
@@ -0,0 +1,140 @@
+#include "moby/section_index.h"
+
+#include "moby/hash.h"
+
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+namespace {
+
+struct IndexLayout {
+    std::uint64_t file_count;
+    std::uint64_t section_count;
+    std::uint64_t slot_count;
+    std::uint64_t files;
+    std::uint64_t sections;
+    std::uint64_t slots;
+    std::uint64_t strings;
+    std::uint64_t strings_size;
+};
+
+std::uint64_t slot_count_for(std::size_t n) {
+    std::uint64_t slots = 16;
+    while (slots < n * 2)
+        slots <<= 1;
+    return slots;
+}
+
+} // namespace
+
+std::uint64_t corpus_hash(const Corpus& corpus) {
+    std::uint64_t h = 0;
+    for (const Section& s : corpus.sections()) {
+        h = hash64(s.path, h);
+        h = hash64(s.text, h);
+    }
+    return h;
+}
+
+std::string SectionIndex::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "sections.idx").string();
+}
+
+void SectionIndex::build(const Corpus& corpus, const std::string& path) {
+    StringPool strings;
+    std::vector<FileRecord> files;
+    for (const CorpusFile& f : corpus.files())
+        files.push_back({strings.add(f.name), f.map.size()});
+
+    std::vector<SectionRecord> sections;
+    sections.reserve(corpus.sections().size());
+    for (const Section& s : corpus.sections()) {
+        SectionRecord r{};
+        r.path_hash = hash64(s.path);
+        r.content_hash = hash64(s.text);
+        r.marker = s.marker;
+        r.offset = s.offset;
+        r.length = s.length;
+        r.file = s.file;
+        r.path = strings.add(s.path);
+        sections.push_back(r);
+    }
+
+    // Linear probing on the path hash. A duplicate path keeps its first
+    // occurrence, matching what a linear scan of the corpus would find.
+    std::uint64_t slot_count = slot_count_for(sections.size());
+    std::vector<std::uint32_t> slots(slot_count, 0);
+    for (std::uint32_t i = 0; i < sections.size(); ++i) {
+        std::uint64_t slot = sections[i].path_hash & (slot_count - 1);
+        bool duplicate = false;
+        while (slots[slot] != 0) {
+            const SectionRecord& other = sections[slots[slot] - 1];
+            if (other.path_hash == sections[i].path_hash &&
+                corpus.sections()[slots[slot] - 1].path == corpus.sections()[i].path) {
+                duplicate = true;
+                break;
+            }
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        if (!duplicate)
+            slots[slot] = i + 1;
+    }
+
+    BlobWriter w(kMagic, kVersion, moby::corpus_hash(corpus));
+    std::size_t layout_at = w.put(IndexLayout{});
+    IndexLayout layout{};
+    layout.file_count = files.size();
+    layout.section_count = sections.size();
+    layout.slot_count = slot_count;
+    layout.files = w.put_array(files);
+    layout.sections = w.put_array(sections);
+    layout.slots = w.put_array(slots);
+    layout.strings = w.put_bytes(strings.data().data(), strings.data().size());
+    layout.strings_size = strings.data().size();
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+}
+
+SectionIndex::SectionIndex(const std::string& index_path, const std::string& corpus_dir)
+    : reader_(index_path, kMagic, kVersion), corpus_dir_(corpus_dir) {
+    const IndexLayout& layout = *reader_.array<IndexLayout>(sizeof(BlobHeader), 1);
+    file_count_ = layout.file_count;
+    section_count_ = layout.section_count;
+    slot_mask_ = layout.slot_count - 1;
+    files_ = reader_.array<FileRecord>(layout.files, layout.file_count);
+    sections_ = reader_.array<SectionRecord>(layout.sections, layout.section_count);
+    slots_ = reader_.array<std::uint32_t>(layout.slots, layout.slot_count);
+    reader_.bytes(layout.strings, layout.strings_size);
+    strings_ = layout.strings;
+    maps_.resize(file_count_);
+}
+
+SectionIndex::~SectionIndex() = default;
+
+const SectionRecord* SectionIndex::find(std::string_view path) const {
+    std::uint64_t h = hash64(path);
+    for (std::uint64_t slot = h & slot_mask_;; slot = (slot + 1) & slot_mask_) {
+        std::uint32_t entry = slots_[slot];
+        if (entry == 0)
+            return nullptr;
+        const SectionRecord& r = sections_[entry - 1];
+        if (r.path_hash == h && this->path(r) == path)
+            return &r;
+    }
+}
+
+std::string_view SectionIndex::text(const SectionRecord& r) const {
+    auto& map = maps_[r.file];
+    if (!map) {
+        map = std::make_unique<MappedFile>((fs::path(corpus_dir_) / std::string(file_name(r.file))).string());
+        if (map->size() != files_[r.file].size)
+            throw Error(map->path() + ": changed since the index was built; rebuild it");
+    }
+    return map->view().substr(r.offset, r.length);
+}
+
+} // namespace moby
@@ -0,0 +1,415 @@
+#include "moby/section_stream.h"
+
+#include "moby/corpus.h"
+#include "moby/error.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+namespace moby {
+namespace {
+
+std::string sys_error(const char* what) { return std::string("stream: ") + what + ": " + std::strerror(errno); }
+
+// Reads the descriptor, inflating gzip input (including concatenated
+// members) when the first bytes carry the gzip magic.
+class Input {
+public:
+    explicit Input(int fd) : fd_(fd), raw_(64 << 10) {
+        while (end_ < 2 && refill_raw(end_) != 0) {
+        }
+        gzip_ = end_ >= 2 && static_cast<unsigned char>(raw_[0]) == 0x1f &&
+                static_cast<unsigned char>(raw_[1]) == 0x8b;
+        if (gzip_) {
+            std::memset(&z_, 0, sizeof z_);
+            if (inflateInit2(&z_, 16 + MAX_WBITS) != Z_OK)
+                throw Error("stream: cannot initialize zlib");
+            z_.next_in = reinterpret_cast<Bytef*>(raw_.data());
+            z_.avail_in = static_cast<uInt>(end_);
+        }
+    }
+    ~Input() {
+        if (gzip_)
+            inflateEnd(&z_);
+    }
+    Input(const Input&) = delete;
+    Input& operator=(const Input&) = delete;
+
+    std::uint64_t raw_bytes() const { return raw_bytes_; }
+
+    // Up to `n` bytes into `out`; 0 only at the end of the input.
+    std::size_t read(char* out, std::size_t n) {
+        if (!gzip_) {
+            if (pos_ < end_) {
+                std::size_t k = std::min(n, end_ - pos_);
+                std::memcpy(out, raw_.data() + pos_, k);
+                pos_ += k;
+                return k;
+            }
+            return read_fd(out, n);
+        }
+        z_.next_out = reinterpret_cast<Bytef*>(out);
+        z_.avail_out = static_cast<uInt>(std::min<std::size_t>(n, 1u << 30));
+        while (z_.next_out == reinterpret_cast<Bytef*>(out)) {
+            if (z_.avail_in == 0) {
+                std::size_t k = refill_raw(0);
+                if (k == 0) {
+                    if (!finished_)
+                        throw Error("stream: truncated gzip input");
+                    return 0;
+                }
+                z_.next_in = reinterpret_cast<Bytef*>(raw_.data());
+                z_.avail_in = static_cast<uInt>(k);
+            }
+            if (finished_) {
+                // Another gzip member follows the one that ended.
+                inflateReset(&z_);
+                finished_ = false;
+            }
+            int rc = inflate(&z_, Z_NO_FLUSH);
+            if (rc == Z_STREAM_END)
+                finished_ = true;
+            else if (rc != Z_OK && rc != Z_BUF_ERROR)
+                throw Error(std::string("stream: corrupt gzip input: ") + (z_.msg ? z_.msg : "inflate failed"));
+        }
+        return static_cast<std::size_t>(reinterpret_cast<char*>(z_.next_out) - out);
+    }
+
+    // Exactly `n` bytes, or fewer only at the end of the input.
+    std::size_t read_full(char* out, std::size_t n) {
+        std::size_t done = 0;
+        while (done < n) {
+            std::size_t k = read(out + done, n - done);
+            if (k == 0)
+                break;
+            done += k;
+        }
+        return done;
+    }
+
+private:
+    std::size_t read_fd(char* out, std::size_t n) {
+        for (;;) {
+            ssize_t k = ::read(fd_, out, n);
+            if (k >= 0) {
+                raw_bytes_ += static_cast<std::uint64_t>(k);
+                return static_cast<std::size_t>(k);
+            }
+            if (errno != EINTR)
+                throw Error(sys_error("read"));
+        }
+    }
+
+    // Reads into raw_ at `at` and returns the bytes read; resets pos_/end_.
+    std::size_t refill_raw(std::size_t at) {
+        std::size_t k = read_fd(raw_.data() + at, raw_.size() - at);
+        pos_ = 0;
+        end_ = at + k;
+        return k;
+    }
+
+    int fd_;
+    std::vector<char> raw_;
+    std::size_t pos_ = 0, end_ = 0;
+    std::uint64_t raw_bytes_ = 0;
+    bool gzip_ = false;
+    bool finished_ = false;
+    z_stream z_;
+};
+
+// Ring storage mapped twice in a row: bytes [p, p + capacity) are contiguous
+// for any p inside the first mapping.
+class Ring {
+public:
+    explicit Ring(std::size_t capacity) {
+        std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        capacity_ = (std::max<std::size_t>(capacity, page) + page - 1) / page * page;
+#ifdef __linux__
+        int fd = ::memfd_create("moby-ring", MFD_CLOEXEC);
+#else
+        static std::atomic<unsigned> counter{0};
+        std::string name = "/moby-ring-" + std::to_string(::getpid()) + "-" + std::to_string(counter++);
+        int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0)
+            ::shm_unlink(name.c_str());
+#endif
+        if (fd < 0)
+            throw Error(sys_error("cannot create ring buffer"));
+        if (::ftruncate(fd, static_cast<off_t>(capacity_)) != 0) {
+            ::close(fd);
+            throw Error(sys_error("cannot size ring buffer"));
+        }
+        void* area = ::mmap(nullptr, 2 * capacity_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        bool mapped = area != MAP_FAILED;
+        for (int half = 0; mapped && half < 2; ++half)
+            mapped = ::mmap(static_cast<char*>(area) + half * capacity_, capacity_, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED;
+        int err = errno;
+        ::close(fd);
+        if (!mapped) {
+            if (area != MAP_FAILED)
+                ::munmap(area, 2 * capacity_);
+            errno = err;
+            throw Error(sys_error("cannot map ring buffer"));
+        }
+        base_ = static_cast<char*>(area);
+    }
+    ~Ring() { ::munmap(base_, 2 * capacity_); }
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    std::size_t capacity() const { return capacity_; }
+    char* at(std::uint64_t pos) const { return base_ + pos % capacity_; }
+
+private:
+    char* base_ = nullptr;
+    std::size_t capacity_ = 0;
+};
+
+constexpr std::size_t kTarBlock = 512;
+
+std::uint64_t tar_number(const char* field, std::size_t size) {
+    if (static_cast<unsigned char>(field[0]) & 0x80) {
+        // GNU base-256 for sizes of 8 GiB and up.
+        std::uint64_t v = static_cast<unsigned char>(field[0]) & 0x7f;
+        for (std::size_t i = 1; i < size; ++i)
+            v = v << 8 | static_cast<unsigned char>(field[i]);
+        return v;
+    }
+    std::uint64_t v = 0;
+    for (std::size_t i = 0; i < size && field[i]; ++i)
+        if (field[i] >= '0' && field[i] <= '7')
+            v = v * 8 + (field[i] - '0');
+    return v;
+}
+
+std::string tar_string(const char* field, std::size_t size) { return std::string(field, strnlen(field, size)); }
+
+bool is_tar_header(const char* block) {
+    return std::memcmp(block + 257, "ustar", 5) == 0;
+}
+
+} // namespace
+
+struct SectionStream::State {
+    explicit State(int fd, std::size_t capacity) : input(fd), ring(std::make_unique<Ring>(capacity)) {}
+
+    Input input;
+    std::unique_ptr<Ring> ring;
+    SectionStreamStats stats;
+
+    // Live bytes are [head, tail), as absolute stream positions; the source
+    // (tar member, or the whole stream) started at `base`.
+    std::uint64_t head = 0, tail = 0, base = 0;
+    std::uint64_t scanned = 0;  // no separator starts before this
+    std::uint64_t release = 0;  // bytes of the section last handed out
+
+    bool in_section = false;
+    std::uint64_t marker = 0, content = 0;
+    std::string path;
+
+    bool tar = false;
+    bool source_end = false;
+    std::uint64_t member_left = 0;  // tar: data bytes of the member not yet read
+    std::uint64_t member_pad = 0;   // tar: padding after the member's data
+    std::string member;
+
+    std::string_view view(std::uint64_t from, std::uint64_t to) const {
+        return {ring->at(from), static_cast<std::size_t>(to - from)};
+    }
+
+    void grow() {
+        auto bigger = std::make_unique<Ring>(ring->capacity() * 2);
+        std::memcpy(bigger->at(head), ring->at(head), tail - head);
+        ring = std::move(bigger);
+        stats.capacity = ring->capacity();
+    }
+
+    // Reads more of the current source; false once it is exhausted.
+    bool fill() {
+        if (source_end)
+            return false;
+        if (tail - head == ring->capacity())
+            grow();
+        std::size_t space = ring->capacity() - (tail - head);
+        if (tar)
+            space = static_cast<std::size_t>(std::min<std::uint64_t>(space, member_left));
+        std::size_t n = space ? input.read(ring->at(tail), space) : 0;
+        if (n == 0) {
+            if (tar && member_left)
+                throw Error("stream: tar member " + member + " is truncated");
+            source_end = true;
+            return false;
+        }
+        tail += n;
+        member_left -= tar ? n : 0;
+        stats.bytes += n;
+        return true;
+    }
+
+    void skip(std::uint64_t n) {
+        char scratch[4096];
+        while (n) {
+            std::size_t k = input.read_full(scratch, static_cast<std::size_t>(std::min<std::uint64_t>(n, sizeof scratch)));
+            if (k == 0)
+                throw Error("stream: tar archive is truncated");
+            n -= k;
+        }
+    }
+
+    // Positions the input at the data of the next *.h tar member. The first
+    // header may already have been read into `block`.
+    bool next_member(const char* first = nullptr) {
+        skip(member_pad);
+        member_pad = 0;
+        std::string long_name;
+        char block[kTarBlock];
+        for (;;) {
+            if (first) {
+                std::memcpy(block, first, kTarBlock);
+                first = nullptr;
+            } else if (input.read_full(block, kTarBlock) < kTarBlock) {
+                return false;  // archives may stop without the two zero blocks
+            }
+            if (std::all_of(block, block + kTarBlock, [](char c) { return c == 0; }))
+                return false;
+            std::uint64_t size = tar_number(block + 124, 12);
+            std::uint64_t pad = (kTarBlock - size % kTarBlock) % kTarBlock;
+            char type = block[156];
+            if (type == 'L' || type == 'x') {
+                // GNU long name, or a pax header that may carry "path=".
+                std::string data(size, '\0');
+                if (input.read_full(data.data(), size) < size)
+                    throw Error("stream: tar archive is truncated");
+                skip(pad);
+                if (type == 'L') {
+                    long_name = data.c_str();
+                } else {
+                    for (std::size_t p = 0; p < data.size();) {
+                        std::size_t space = data.find(' ', p), nl = data.find('\n', p);
+                        if (space == std::string::npos || nl == std::string::npos)
+                            break;
+                        std::string_view record(data.data() + space + 1, nl - space - 1);
+                        if (record.substr(0, 5) == "path=")
+                            long_name = std::string(record.substr(5));
+                        p = nl + 1;
+                    }
+                }
+                continue;
+            }
+            std::string name = long_name;
+            if (name.empty()) {
+                name = tar_string(block, 100);
+                std::string prefix = tar_string(block + 345, 155);
+                if (!prefix.empty())
+                    name = prefix + "/" + name;
+            }
+            long_name.clear();
+            if ((type == '0' || type == '\0') && name.size() >= 2 && name.compare(name.size() - 2, 2, ".h") == 0) {
+                member = std::move(name);
+                member_left = size;
+                member_pad = pad;
+                ++stats.members;
+                return true;
+            }
+            skip(size + pad);
+        }
+    }
+};
+
+SectionStream::SectionStream(int fd, std::size_t capacity) : state_(std::make_unique<State>(fd, capacity)) {
+    State& s = *state_;
+    s.stats.capacity = s.ring->capacity();
+    // A tar archive starts with a ustar header block; anything else is the
+    // corpus text itself.
+    char block[kTarBlock];
+    std::size_t n = s.input.read_full(block, kTarBlock);
+    if (n == kTarBlock && is_tar_header(block)) {
+        s.tar = true;
+        if (!s.next_member(block))
+            s.source_end = true;
+    } else {
+        std::memcpy(s.ring->at(0), block, n);
+        s.tail = n;
+        s.stats.bytes = n;
+    }
+}
+
+SectionStream::~SectionStream() = default;
+
+const SectionStreamStats& SectionStream::stats() const {
+    state_->stats.input_bytes = state_->input.raw_bytes();
+    return state_->stats;
+}
+
+bool SectionStream::next(StreamSection& out) {
+    State& s = *state_;
+    s.head = std::max(s.head, s.release);
+    for (;;) {
+        if (!s.in_section) {
+            std::uint64_t from = std::max(s.scanned, s.head);
+            std::size_t hit = s.view(from, s.tail).find(kSeparator);
+            if (hit == std::string_view::npos) {
+                // Text ahead of a separator is dropped, except what could be
+                // the start of one.
+                s.head = std::max(s.head, s.tail - std::min<std::uint64_t>(s.tail - s.head, kSeparator.size() - 1));
+                s.scanned = s.head;
+                if (s.fill())
+                    continue;
+                if (s.tar && s.next_member()) {
+                    s.head = s.scanned = s.base = s.tail;
+                    s.source_end = false;
+                    continue;
+                }
+                return false;
+            }
+            std::uint64_t pos = from + hit;
+            s.head = s.scanned = pos;
+            std::uint64_t path_begin = pos + kSeparator.size();
+            std::size_t eol = s.view(path_begin, s.tail).find('\n');
+            if (eol == std::string_view::npos && s.fill())
+                continue;
+            std::uint64_t path_end = eol == std::string_view::npos ? s.tail : path_begin + eol;
+            s.content = eol == std::string_view::npos ? s.tail : path_end + 1;
+            while (path_end > path_begin && (*s.ring->at(path_end - 1) == '\r' || *s.ring->at(path_end - 1) == ' '))
+                --path_end;
+            s.path.assign(s.view(path_begin, path_end));
+            s.marker = pos;
+            s.head = s.scanned = s.content;
+            s.in_section = true;
+            continue;
+        }
+
+        std::uint64_t from = std::max(s.scanned, s.content);
+        std::size_t hit = s.view(from, s.tail).find(kSeparator);
+        std::uint64_t end;
+        if (hit != std::string_view::npos) {
+            end = from + hit;
+        } else {
+            s.scanned = std::max(s.content, s.tail - std::min<std::uint64_t>(s.tail - s.content, kSeparator.size() - 1));
+            if (s.fill())
+                continue;
+            end = s.tail;
+        }
+        out.source = s.tar ? std::string_view(s.member) : std::string_view();
+        out.path = s.path;
+        out.text = s.view(s.content, end);
+        out.marker = s.marker - s.base;
+        out.offset = s.content - s.base;
+        s.in_section = false;
+        s.release = s.scanned = end;
+        ++s.stats.sections;
+        s.stats.peak_section = std::max<std::size_t>(s.stats.peak_section, out.text.size());
+        return true;
+    }
+}
+
+} // namespace moby
@@ -0,0 +1,1271 @@
+#include "moby/struct_layout.h"
+
+#include "moby/conditionals.h"
+#include "moby/const_expr.h"
+#include "moby/enum_table.h"
+#include "moby/hash.h"
+#include "moby/lexer.h"
+#include "moby/perfect_hash.h"
+#include "moby/section_index.h"
+#include "moby/symbols.h"
+#include "moby/work_pool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <set>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+
+struct StructLayouts::Name {
+    StrRef name;
+    std::uint32_t target;
+    std::uint32_t record;
+};
+
+namespace {
+
+struct LayoutFileLayout {
+    std::uint64_t record_count;
+    std::uint64_t field_count;
+    std::uint64_t name_count;
+    std::uint64_t bucket_count;
+    std::uint64_t slot_count;
+    std::uint64_t records;
+    std::uint64_t fields;
+    std::uint64_t names;
+    std::uint64_t displacements;
+    std::uint64_t slots;
+    std::uint64_t strings;
+    std::uint64_t strings_size;
+};
+
+constexpr std::uint32_t kNone = ~0u;
+
+// Deeper typedef or #define chains than this are taken to be circular.
+constexpr int kMaxDepth = 32;
+
+struct Abi {
+    std::uint32_t pointer;
+    std::uint32_t long_size;
+    std::uint32_t wide_align;  // alignment of 8-byte scalars
+    std::uint32_t max_vector_align;
+};
+
+// arm64 and armv7 as Apple defines them; armv7 aligns long long and double
+// to 4 inside structs.
+constexpr Abi kAbis[kLayoutTargetCount] = {{8, 8, 8, 16}, {4, 4, 4, 16}};
+
+struct Type {
+    std::uint32_t size = 0;    // per element
+    std::uint32_t align = 1;
+    std::uint32_t count = 1;   // array elements
+    std::uint32_t record = kNone;
+    FieldKind kind = FieldKind::Int;
+    bool is_signed = false;
+    bool ok = false;
+};
+
+enum class Base : std::uint8_t { I8, U8, I16, U16, I32, U32, I64, U64, Long, ULong, Ptr, F16, F32, F64, LongDouble, Bool, I128 };
+
+Type base_type(Base b, const Abi& abi) {
+    Type t;
+    t.ok = true;
+    auto set = [&](std::uint32_t size, FieldKind kind, bool is_signed) {
+        t.size = size;
+        t.align = size == 8 ? abi.wide_align : size;
+        t.kind = kind;
+        t.is_signed = is_signed;
+    };
+    switch (b) {
+    case Base::I8: set(1, FieldKind::Int, true); break;
+    case Base::U8: set(1, FieldKind::Int, false); break;
+    case Base::Bool: set(1, FieldKind::Int, false); break;
+    case Base::I16: set(2, FieldKind::Int, true); break;
+    case Base::U16: set(2, FieldKind::Int, false); break;
+    case Base::I32: set(4, FieldKind::Int, true); break;
+    case Base::U32: set(4, FieldKind::Int, false); break;
+    case Base::I64: set(8, FieldKind::Int, true); break;
+    case Base::U64: set(8, FieldKind::Int, false); break;
+    case Base::Long: set(abi.long_size, FieldKind::Int, true); break;
+    case Base::ULong: set(abi.long_size, FieldKind::Int, false); break;
+    case Base::Ptr: set(abi.pointer, FieldKind::Pointer, false); break;
+    case Base::F16: set(2, FieldKind::Float, true); break;
+    case Base::F32: set(4, FieldKind::Float, true); break;
+    case Base::F64: set(8, FieldKind::Float, true); break;
+    case Base::LongDouble: set(8, FieldKind::Float, true); break;  // double on Apple ARM
+    case Base::I128:
+        set(16, FieldKind::Int, true);
+        t.align = 16;
+        break;
+    }
+    return t;
+}
+
+// Types the corpus uses but does not define: they come from the C library,
+// the kernel and the Objective-C runtime headers.
+struct NamedBase {
+    std::string_view name;
+    Base lp64, ilp32;
+};
+
+constexpr NamedBase kNamedBases[] = {
+    {"int8_t", Base::I8, Base::I8},           {"uint8_t", Base::U8, Base::U8},
+    {"int16_t", Base::I16, Base::I16},        {"uint16_t", Base::U16, Base::U16},
+    {"int32_t", Base::I32, Base::I32},        {"uint32_t", Base::U32, Base::U32},
+    {"int64_t", Base::I64, Base::I64},        {"uint64_t", Base::U64, Base::U64},
+    {"u_int8_t", Base::U8, Base::U8},         {"u_int16_t", Base::U16, Base::U16},
+    {"u_int32_t", Base::U32, Base::U32},      {"u_int64_t", Base::U64, Base::U64},
+    {"intptr_t", Base::Long, Base::Long},     {"uintptr_t", Base::ULong, Base::ULong},
+    {"intmax_t", Base::I64, Base::I64},       {"uintmax_t", Base::U64, Base::U64},
+    {"size_t", Base::ULong, Base::ULong},     {"ssize_t", Base::Long, Base::Long},
+    {"ptrdiff_t", Base::Long, Base::Long},    {"off_t", Base::I64, Base::I64},
+    {"time_t", Base::Long, Base::Long},       {"suseconds_t", Base::I32, Base::I32},
+    {"useconds_t", Base::U32, Base::U32},     {"pid_t", Base::I32, Base::I32},
+    {"uid_t", Base::U32, Base::U32},          {"gid_t", Base::U32, Base::U32},
+    {"mode_t", Base::U16, Base::U16},         {"dev_t", Base::I32, Base::I32},
+    {"ino_t", Base::U64, Base::U64},          {"wchar_t", Base::I32, Base::I32},
+    {"char16_t", Base::U16, Base::U16},       {"char32_t", Base::U32, Base::U32},
+    {"sa_family_t", Base::U8, Base::U8},      {"socklen_t", Base::U32, Base::U32},
+    {"in_port_t", Base::U16, Base::U16},      {"in_addr_t", Base::U32, Base::U32},
+    {"mach_port_t", Base::U32, Base::U32},    {"kern_return_t", Base::I32, Base::I32},
+    {"natural_t", Base::U32, Base::U32},      {"integer_t", Base::I32, Base::I32},
+    {"vm_size_t", Base::ULong, Base::ULong},  {"mach_vm_size_t", Base::U64, Base::U64},
+    {"vm_address_t", Base::ULong, Base::ULong}, {"mach_vm_address_t", Base::U64, Base::U64},
+    {"dispatch_time_t", Base::U64, Base::U64}, {"os_unfair_lock", Base::U32, Base::U32},
+    {"float_t", Base::F32, Base::F32},        {"double_t", Base::F64, Base::F64},
+    {"_Float16", Base::F16, Base::F16},       {"__fp16", Base::F16, Base::F16},
+    {"BOOL", Base::Bool, Base::I8},           {"__int128_t", Base::I128, Base::I128},
+    {"id", Base::Ptr, Base::Ptr},             {"Class", Base::Ptr, Base::Ptr},
+    {"SEL", Base::Ptr, Base::Ptr},            {"IMP", Base::Ptr, Base::Ptr},
+    {"va_list", Base::Ptr, Base::Ptr},        {"__builtin_va_list", Base::Ptr, Base::Ptr},
+    {"__darwin_va_list", Base::Ptr, Base::Ptr}, {"instancetype", Base::Ptr, Base::Ptr},
+    {"NSInteger", Base::Long, Base::Long},    {"NSUInteger", Base::ULong, Base::ULong},
+    {"Fixed", Base::I32, Base::I32},          {"Fract", Base::I32, Base::I32},
+    {"UnsignedFixed", Base::U32, Base::U32},  {"ShortFixed", Base::I16, Base::I16},
+};
+
+// <simd/simd.h> vectors and matrices: simd_float4, vector_uint2,
+// matrix_float4x4, simd_double3x3, ...
+bool simd_type(std::string_view name, const Abi& abi, Type& t) {
+    std::string_view rest;
+    if (name.substr(0, 5) == "simd_")
+        rest = name.substr(5);
+    else if (name.substr(0, 7) == "vector_" || name.substr(0, 7) == "matrix_")
+        rest = name.substr(7);
+    else
+        return false;
+    static constexpr std::pair<std::string_view, Base> kElements[] = {
+        {"char", Base::I8},   {"uchar", Base::U8},   {"short", Base::I16}, {"ushort", Base::U16},
+        {"int", Base::I32},   {"uint", Base::U32},   {"long", Base::Long}, {"ulong", Base::ULong},
+        {"half", Base::F16},  {"float", Base::F32},  {"double", Base::F64},
+    };
+    for (const auto& [element, base] : kElements) {
+        if (rest.substr(0, element.size()) != element)
+            continue;
+        std::string_view shape = rest.substr(element.size());
+        unsigned columns = 1, rows = 0;
+        if (shape.size() == 1 && shape[0] >= '2' && shape[0] <= '4') {
+            rows = static_cast<unsigned>(shape[0] - '0');
+        } else if (shape == "8" || shape == "16") {
+            rows = shape == "8" ? 8 : 16;
+        } else if (shape.size() == 3 && shape[1] == 'x' && shape[0] >= '2' && shape[0] <= '4' && shape[2] >= '2' &&
+                   shape[2] <= '4') {
+            columns = static_cast<unsigned>(shape[0] - '0');
+            rows = static_cast<unsigned>(shape[2] - '0');
+        } else {
+            continue;
+        }
+        Type e = base_type(base, abi);
+        std::uint32_t size = 1;
+        while (size < e.size * rows)
+            size <<= 1;
+        t = e;
+        t.kind = columns == 1 ? FieldKind::Vector : FieldKind::Record;
+        t.align = std::min(size, abi.max_vector_align);
+        t.size = size * columns;
+        return true;
+    }
+    return false;
+}
+
+bool is_qualifier(std::string_view s) {
+    static constexpr std::string_view kQualifiers[] = {
+        "const", "volatile", "restrict", "__restrict", "__restrict__", "_Nullable", "_Nonnull",
+        "_Null_unspecified", "__nullable", "__nonnull", "__null_unspecified", "__unsafe_unretained",
+        "__strong", "__weak", "__autoreleasing", "__kindof", "__block", "static", "extern", "inline",
+        "register", "__unused", "__covariant", "__contravariant", "_Atomic", "__extension__",
+    };
+    return std::find(std::begin(kQualifiers), std::end(kQualifiers), s) != std::end(kQualifiers);
+}
+
+bool is_type_word(std::string_view s) {
+    return s == "unsigned" || s == "signed" || s == "char" || s == "short" || s == "int" || s == "long" ||
+           s == "float" || s == "double" || s == "_Bool" || s == "bool" || s == "void" || s == "__int128" ||
+           s == "_Complex";
+}
+
+bool is_enum_macro(std::string_view s) {
+    return s == "NS_ENUM" || s == "NS_OPTIONS" || s == "NS_CLOSED_ENUM" || s == "NS_ERROR_ENUM" || s == "CF_ENUM" ||
+           s == "CF_OPTIONS" || s == "CF_CLOSED_ENUM";
+}
+
+std::uint64_t align_up(std::uint64_t v, std::uint64_t a) {
+    return a ? (v + a - 1) / a * a : v;
+}
+
+// Token text with the matching bracket of every ( [ {, so groups can be
+// skipped in one step.
+struct Source {
+    std::string_view text;
+    std::vector<Token> toks;
+    std::vector<std::uint32_t> match;
+
+    explicit Source(std::string_view t) : text(t), toks(tokenize(t)), match(toks.size(), kNone) {
+        std::vector<std::uint32_t> open;
+        for (std::uint32_t i = 0; i < toks.size(); ++i) {
+            if (toks[i].kind != Tok::Punct || toks[i].length != 1)
+                continue;
+            char c = text[toks[i].offset];
+            if (c == '(' || c == '[' || c == '{') {
+                open.push_back(i);
+            } else if ((c == ')' || c == ']' || c == '}') && !open.empty()) {
+                match[open.back()] = i;
+                match[i] = open.back();
+                open.pop_back();
+            }
+        }
+    }
+
+    std::size_t size() const { return toks.size(); }
+    std::string_view str(std::size_t i) const { return token_text(text, toks[i]); }
+    bool ident(std::size_t i) const { return i < toks.size() && toks[i].kind == Tok::Ident; }
+    bool punct(std::size_t i, char c) const { return i < toks.size() && is_punct(text, toks[i], c); }
+    // Index past the group opened at `i`.
+    std::size_t skip(std::size_t i) const { return match[i] == kNone ? toks.size() : match[i] + 1; }
+};
+
+struct Attrs {
+    bool packed = false;
+    std::uint32_t aligned = 0;
+    std::uint32_t vector = 0;        // ext_vector_type(N) elements
+    std::uint32_t vector_bytes = 0;  // vector_size(N)
+};
+
+// Skips an attribute at `i` (__attribute__((...)), an attribute macro with
+// or without arguments), noting the attributes that change layout. Returns
+// `i` when there is none.
+std::size_t skip_attribute(const Source& src, std::size_t i, Attrs& attrs) {
+    if (!src.ident(i))
+        return i;
+    std::string_view s = src.str(i);
+    bool group = src.punct(i + 1, '(');
+    if (s == "__attribute__" && group) {
+        std::size_t end = src.skip(i + 1);
+        for (std::size_t j = i + 2; j < end; ++j) {
+            std::string_view a = src.str(j);
+            auto argument = [&]() -> std::uint32_t {
+                if (!src.punct(j + 1, '(') || src.toks[j + 2].kind != Tok::Number)
+                    return 0;
+                return static_cast<std::uint32_t>(std::strtoul(std::string(src.str(j + 2)).c_str(), nullptr, 0));
+            };
+            if (a == "packed" || a == "__packed__")
+                attrs.packed = true;
+            else if (a == "aligned" || a == "__aligned__")
+                attrs.aligned = std::max(attrs.aligned, argument());
+            else if (a == "ext_vector_type" || a == "__ext_vector_type__")
+                attrs.vector = argument();
+            else if (a == "vector_size" || a == "__vector_size__")
+                attrs.vector_bytes = argument();
+        }
+        return end;
+    }
+    if (s == "_Alignas" && group)
+        return src.skip(i + 1);
+    if (is_macro_name(s) && group && !is_enum_macro(s) && !is_qualifier(s))
+        return src.skip(i + 1);
+    return i;
+}
+
+// The tag after struct/union/enum at `kw`, past attributes on either side
+// (struct CG_BOXABLE CGPoint). A bare all-caps name followed by another name
+// is an attribute; otherwise it is the tag.
+std::string_view record_tag(const Source& src, std::size_t kw, std::size_t& i, Attrs& attrs) {
+    std::string_view tag;
+    i = kw + 1;
+    for (;;) {
+        std::size_t next = skip_attribute(src, i, attrs);
+        if (next != i) {
+            i = next;
+        } else if (src.ident(i) && (is_qualifier(src.str(i)) ||
+                                    (is_macro_name(src.str(i)) && src.ident(i + 1)))) {
+            ++i;
+        } else if (src.ident(i) && tag.empty()) {
+            tag = src.str(i++);
+        } else {
+            return tag;
+        }
+    }
+}
+
+struct Spec {
+    std::uint32_t record = kNone;     // struct or union
+    std::string_view tag;             // of a struct, union or enum without a body
+    bool is_record_tag = false;
+    bool is_enum = false;
+    std::size_t enum_type_begin = 0, enum_type_end = 0;  // enum X : T
+    bool unsigned_ = false, signed_ = false, char_ = false, short_ = false, float_ = false, double_ = false;
+    bool bool_ = false, void_ = false, int128 = false, complex = false, words = false;
+    int longs = 0;
+    std::string_view name;            // a typedef name
+    std::string text;                 // for FieldRecord::type
+    Attrs attrs;
+    std::size_t end = 0;              // first declarator token
+};
+
+struct Declarator {
+    std::string_view name;
+    bool pointer = false;
+    bool function = false;            // a function, not a field
+    bool bitfield = false;
+    std::size_t bits_begin = 0, bits_end = 0;
+    std::vector<std::pair<std::size_t, std::size_t>> dims;  // token ranges inside [ ]
+    Attrs attrs;
+};
+
+struct FieldOut {
+    std::string name;
+    std::string type;
+    std::uint64_t bit_offset;
+    std::uint32_t size;
+    std::uint32_t count;
+    std::uint32_t record;
+    std::uint16_t bit_width;
+    FieldKind kind;
+    std::uint8_t flags;
+};
+
+struct RecordDef {
+    const Source* src;
+    std::uint32_t section;
+    std::size_t open, close;
+    std::string_view tag;
+    bool is_union;
+    std::uint8_t pack;
+    Attrs attrs;
+    std::vector<std::string_view> names;  // typedef names
+    int state = 0;                        // 0 new, 1 in progress, 2 done
+    Type type;
+    bool bitfields = false;
+    std::vector<FieldOut> fields;
+};
+
+struct Alias {
+    const Source* src;
+    Spec spec;
+    Declarator decl;
+    bool spec_only = false;  // NS_ENUM(T, Name): the spec is the whole type
+    int state = 0;
+    Type type;
+};
+
+struct Define {
+    std::string_view body;
+    std::unique_ptr<Source> src;  // tokenized on first use
+    int state = 0;
+    Type type;
+};
+
+// One target's view of the corpus: its live text, the records, typedefs,
+// enum tags and #defines declared in it, and the layouts computed on demand.
+class Resolver {
+public:
+    Resolver(const Corpus& corpus, LayoutTarget target, const EnumTable* enums, unsigned threads)
+        : views_(corpus), target_(target), abi_(kAbis[static_cast<int>(target)]), enums_(enums) {
+        const TargetView& view = views_.view(layout_target_config(target));
+        std::size_t n = corpus.sections().size();
+        std::vector<std::string_view> texts(n);
+        for (std::uint32_t s = 0; s < n; ++s)
+            texts[s] = view.text(s);
+        sections_.resize(n);
+        std::vector<std::uint32_t> tasks(n);
+        std::iota(tasks.begin(), tasks.end(), 0);
+        const auto& sections = corpus.sections();
+        std::stable_sort(tasks.begin(), tasks.end(),
+                         [&](std::uint32_t a, std::uint32_t b) { return sections[a].length > sections[b].length; });
+        run_stealing(tasks, threads, [&](std::uint32_t s) { sections_[s] = std::make_unique<Source>(texts[s]); });
+        for (std::uint32_t s = 0; s < n; ++s)
+            scan(s);
+        for (std::uint32_t id = 0; id < records_.size(); ++id)
+            record_type(id, 0);
+        for (std::string_view name : alias_order_) {
+            Type t = alias_type(aliases_.at(name), 0);
+            if (t.ok && t.kind == FieldKind::Record && t.count == 1)
+                records_[t.record].names.push_back(name);
+        }
+    }
+
+    std::vector<RecordDef>& records() { return records_; }
+    const std::set<std::string>& unknown() const { return unknown_; }
+
+private:
+    void scan(std::uint32_t s) {
+        const Source& src = *sections_[s];
+        std::vector<std::uint8_t> stack;
+        std::uint8_t pack = 0;
+        for (std::size_t i = 0; i < src.size(); ++i) {
+            const Token& t = src.toks[i];
+            if (t.kind == Tok::Directive) {
+                directive(src.str(i), pack, stack);
+                continue;
+            }
+            if (t.kind != Tok::Ident)
+                continue;
+            std::string_view w = src.str(i);
+            if (w == "typedef") {
+                typedef_statement(src, s, i + 1, pack);
+            } else if (w == "struct" || w == "union") {
+                define_record(src, s, i, pack);
+            } else if (w == "enum") {
+                enum_tag(src, i);
+            } else if (is_enum_macro(w) && src.punct(i + 1, '(')) {
+                enum_macro(src, i);
+            } else if ((w == "SPARSE_ENUM" || w == "SPARSE_CLOSED_ENUM") && src.punct(i + 1, '(')) {
+                sparse_enum(src, i);
+            }
+        }
+    }
+
+    void directive(std::string_view d, std::uint8_t& pack, std::vector<std::uint8_t>& stack) {
+        std::string_view name = directive_name(d);
+        if (name == "define") {
+            std::size_t i = d.find("define") + 6;
+            while (i < d.size() && (d[i] == ' ' || d[i] == '\t'))
+                ++i;
+            std::size_t end = i;
+            while (end < d.size() && (std::isalnum(static_cast<unsigned char>(d[end])) || d[end] == '_'))
+                ++end;
+            // Function-like macros and continued lines are not types or values.
+            if (end == i || end == d.size() || d[end] == '(' || d.find('\\', end) != std::string_view::npos)
+                return;
+            std::string_view body = d.substr(end);
+            std::size_t comment = std::min(body.find("//"), body.find("/*"));
+            body = body.substr(0, comment);
+            if (body.find_first_not_of(" \t\r\n") == std::string_view::npos)
+                return;
+            if (defines_.find(d.substr(i, end - i)) == defines_.end())
+                defines_[d.substr(i, end - i)].body = body;
+            return;
+        }
+        if (name != "pragma")
+            return;
+        std::size_t p = d.find("pack");
+        if (p == std::string_view::npos)
+            return;
+        std::size_t open = d.find('(', p), close = d.find(')', p);
+        if (open == std::string_view::npos || close == std::string_view::npos || close < open)
+            return;
+        std::string_view args = d.substr(open + 1, close - open - 1);
+        bool any = false;
+        while (!args.empty()) {
+            std::size_t comma = args.find(',');
+            std::string_view a = args.substr(0, comma);
+            args = comma == std::string_view::npos ? std::string_view() : args.substr(comma + 1);
+            a.remove_prefix(std::min(a.find_first_not_of(" \t"), a.size()));
+            a = a.substr(0, a.find_last_not_of(" \t") + 1);
+            if (a.empty())
+                continue;
+            any = true;
+            if (a == "push") {
+                stack.push_back(pack);
+            } else if (a == "pop") {
+                pack = stack.empty() ? 0 : stack.back();
+                if (!stack.empty())
+                    stack.pop_back();
+            } else if (std::isdigit(static_cast<unsigned char>(a[0]))) {
+                pack = static_cast<std::uint8_t>(std::strtoul(std::string(a).c_str(), nullptr, 10));
+            }
+        }
+        if (!any)
+            pack = 0;  // #pragma pack()
+    }
+
+    // struct/union [attrs] [tag] [attrs] { ... } [attrs] at `kw`: the record's
+    // ID, or kNone for a reference without a body.
+    std::uint32_t define_record(const Source& src, std::uint32_t s, std::size_t kw, std::uint8_t pack) {
+        auto key = std::make_pair(&src, kw);
+        if (auto it = record_at_.find(key); it != record_at_.end())
+            return it->second;
+        RecordDef r;
+        r.src = &src;
+        r.section = s;
+        r.is_union = src.str(kw) == "union";
+        r.pack = pack;
+        std::size_t i;
+        r.tag = record_tag(src, kw, i, r.attrs);
+        if (!src.punct(i, '{') || src.match[i] == kNone)
+            return kNone;
+        r.open = i;
+        r.close = src.match[i];
+        for (std::size_t j = r.close + 1, next; (next = skip_attribute(src, j, r.attrs)) != j;)
+            j = next;
+        std::uint32_t id = static_cast<std::uint32_t>(records_.size());
+        if (!r.tag.empty())
+            tags_.emplace(r.tag, id);
+        records_.push_back(std::move(r));
+        record_at_.emplace(key, id);
+        return id;
+    }
+
+    // enum X : T {  and  enum X {
+    void enum_tag(const Source& src, std::size_t kw) {
+        std::size_t i = kw + 1;
+        if (!src.ident(i) || is_macro_name(src.str(i)))
+            return;
+        std::string_view tag = src.str(i++);
+        if (src.punct(i, ':')) {
+            std::size_t end = i + 1;
+            while (end < src.size() && !src.punct(end, '{') && !src.punct(end, ';'))
+                ++end;
+            Alias a;
+            a.src = &src;
+            a.spec = parse_spec(src, i + 1, end, 0, 0);
+            a.spec_only = true;
+            enum_tags_.emplace(tag, std::move(a));
+        } else if (src.punct(i, '{')) {
+            Alias a;
+            a.src = &src;
+            a.spec.words = true;  // int
+            a.spec_only = true;
+            enum_tags_.emplace(tag, std::move(a));
+        }
+    }
+
+    // NS_ENUM(Type, Name); NS_ERROR_ENUM(Domain, Name) is an NSInteger.
+    void enum_macro(const Source& src, std::size_t i) {
+        std::size_t open = i + 1, close = src.match[open];
+        if (close == kNone)
+            return;
+        std::size_t comma = open + 1;
+        while (comma < close && !src.punct(comma, ','))
+            ++comma;
+        if (comma == close || !src.ident(close - 1))
+            return;
+        std::string_view name = src.str(close - 1);
+        Alias a;
+        a.src = &src;
+        a.spec_only = true;
+        if (src.str(i) == "NS_ERROR_ENUM") {
+            a.spec.name = "NSInteger";
+            a.spec.text = "NSInteger";
+        } else {
+            a.spec = parse_spec(src, open + 1, comma, 0, 0);
+        }
+        add_alias(name, std::move(a));
+    }
+
+    // SPARSE_ENUM(Name, Type, ...) declares Name_t.
+    void sparse_enum(const Source& src, std::size_t i) {
+        std::size_t open = i + 1, close = src.match[open];
+        if (close == kNone || !src.ident(open + 1) || !src.punct(open + 2, ','))
+            return;
+        std::size_t end = open + 3;
+        while (end < close && !src.punct(end, ','))
+            ++end;
+        Alias a;
+        a.src = &src;
+        a.spec_only = true;
+        a.spec = parse_spec(src, open + 3, end, 0, 0);
+        sparse_names_.push_back(std::string(src.str(open + 1)) + "_t");
+        add_alias(sparse_names_.back(), std::move(a));
+    }
+
+    void add_alias(std::string_view name, Alias a) {
+        if (aliases_.emplace(name, std::move(a)).second)
+            alias_order_.push_back(name);
+    }
+
+    void typedef_statement(const Source& src, std::uint32_t s, std::size_t i, std::uint8_t pack) {
+        std::size_t end = i;
+        while (end < src.size() && !src.punct(end, ';'))
+            end = src.punct(end, '{') || src.punct(end, '(') || src.punct(end, '[') ? src.skip(end) : end + 1;
+        Attrs ignored;
+        std::size_t first = i;
+        for (std::size_t next; (next = skip_attribute(src, first, ignored)) != first;)
+            first = next;
+        if (src.ident(first) && is_enum_macro(src.str(first)))
+            return;  // scan() reads the macro
+        Spec spec = parse_spec(src, i, end, s, pack);
+        for (Declarator& d : parse_declarators(src, spec.end, end)) {
+            if (d.name.empty() || d.function)
+                continue;
+            Alias a;
+            a.src = &src;
+            a.spec = spec;
+            a.decl = std::move(d);
+            add_alias(a.decl.name, std::move(a));
+        }
+    }
+
+    Spec parse_spec(const Source& src, std::size_t i, std::size_t end, std::uint32_t s, std::uint8_t pack) {
+        Spec spec;
+        auto add_text = [&](std::string_view w) {
+            if (!spec.text.empty())
+                spec.text += ' ';
+            spec.text += w;
+        };
+        bool has_type = false;
+        while (i < end) {
+            std::size_t next = skip_attribute(src, i, spec.attrs);
+            if (next != i) {
+                i = next;
+                continue;
+            }
+            if (!src.ident(i))
+                break;
+            std::string_view w = src.str(i);
+            if (is_qualifier(w) || (is_macro_name(w) && !is_type_macro(w))) {
+                ++i;
+                continue;
+            }
+            if (has_type)
+                break;
+            if (w == "struct" || w == "union") {
+                has_type = true;
+                std::uint32_t id = define_record(src, s, i, pack);
+                std::size_t j;
+                Attrs a;
+                std::string_view tag = record_tag(src, i, j, a);
+                add_text(w);
+                if (!tag.empty())
+                    add_text(tag);
+                if (id != kNone) {
+                    spec.record = id;
+                    i = records_[id].close + 1;
+                } else {
+                    spec.tag = tag;
+                    spec.is_record_tag = true;
+                    i = j;
+                }
+                continue;
+            }
+            if (w == "enum") {
+                has_type = true;
+                spec.is_enum = true;
+                add_text(w);
+                std::size_t j = i + 1;
+                if (src.ident(j) && !is_macro_name(src.str(j))) {
+                    spec.tag = src.str(j++);
+                    add_text(spec.tag);
+                }
+                if (src.punct(j, ':')) {
+                    spec.enum_type_begin = j + 1;
+                    while (j < end && !src.punct(j, '{'))
+                        ++j;
+                    spec.enum_type_end = j;
+                }
+                i = src.punct(j, '{') ? src.skip(j) : j;
+                continue;
+            }
+            if (is_type_word(w)) {
+                spec.words = true;
+                spec.unsigned_ |= w == "unsigned";
+                spec.signed_ |= w == "signed";
+                spec.char_ |= w == "char";
+                spec.short_ |= w == "short";
+                spec.float_ |= w == "float";
+                spec.double_ |= w == "double";
+                spec.bool_ |= w == "_Bool" || w == "bool";
+                spec.void_ |= w == "void";
+                spec.int128 |= w == "__int128";
+                spec.complex |= w == "_Complex";
+                spec.longs += w == "long";
+                add_text(w);
+                ++i;
+                continue;
+            }
+            if (spec.words)
+                break;
+            spec.name = w;
+            add_text(w);
+            has_type = true;
+            ++i;
+            // Protocol qualifiers and generic arguments: id<NSCopying>, NSArray<NSString *>.
+            if (i < end && src.toks[i].kind == Tok::Punct && src.str(i) == "<") {
+                int depth = 0;
+                for (; i < end; ++i) {
+                    std::string_view p = src.str(i);
+                    depth += p == "<" ? 1 : p == ">" ? -1 : p == ">>" ? -2 : 0;
+                    if (depth <= 0) {
+                        ++i;
+                        break;
+                    }
+                }
+            }
+        }
+        spec.end = i;
+        return spec;
+    }
+
+    // CGFLOAT_TYPE and similar: an all-caps #define that names a type, not a
+    // qualifier or attribute such as CM_NULLABLE.
+    bool is_type_macro(std::string_view w) const {
+        auto it = defines_.find(w);
+        if (it == defines_.end())
+            return false;
+        std::string_view body = it->second.body;
+        body.remove_prefix(std::min(body.find_first_not_of(" \t"), body.size()));
+        std::size_t n = 0;
+        while (n < body.size() && (std::isalnum(static_cast<unsigned char>(body[n])) || body[n] == '_'))
+            ++n;
+        std::string_view first = body.substr(0, n);
+        return !first.empty() && !std::isdigit(static_cast<unsigned char>(first[0])) && !is_qualifier(first) &&
+               !is_macro_name(first) && first != "__attribute__" && first.substr(0, 2) != "__" &&
+               first[0] != '_';
+    }
+
+    std::vector<Declarator> parse_declarators(const Source& src, std::size_t i, std::size_t end) {
+        std::vector<Declarator> out;
+        Declarator d;
+        bool any = false, grouped = false;
+        auto finish = [&] {
+            if (any)
+                out.push_back(std::move(d));
+            d = Declarator();
+            any = grouped = false;
+        };
+        while (i < end) {
+            std::size_t next = skip_attribute(src, i, d.attrs);
+            if (next != i) {
+                i = next;
+                continue;
+            }
+            const Token& t = src.toks[i];
+            std::string_view w = src.str(i);
+            if (t.kind == Tok::Ident) {
+                if (!is_qualifier(w) && !is_macro_name(w) && d.name.empty()) {
+                    d.name = w;
+                    any = true;
+                }
+                ++i;
+            } else if (w == "*" || w == "^") {
+                d.pointer = any = true;
+                ++i;
+            } else if (w == "(") {
+                // (*name)(...), (^name)(...), (*name[4])(...); a group after
+                // the name makes a function.
+                std::size_t close = src.skip(i);
+                if (d.name.empty() && !grouped) {
+                    Declarator inner;
+                    std::vector<Declarator> nested = parse_declarators(src, i + 1, close - 1);
+                    if (!nested.empty())
+                        inner = std::move(nested.front());
+                    d.name = inner.name;
+                    d.pointer = inner.pointer;
+                    d.dims = std::move(inner.dims);
+                    d.function = !inner.pointer;
+                    any = grouped = true;
+                } else if (!grouped) {
+                    d.function = true;
+                }
+                i = close;
+            } else if (w == "[") {
+                std::size_t close = src.skip(i);
+                d.dims.emplace_back(i + 1, close - 1);
+                any = true;
+                i = close;
+            } else if (w == ":") {
+                d.bitfield = any = true;
+                d.bits_begin = ++i;
+                while (i < end && !src.punct(i, ',') && skip_attribute(src, i, d.attrs) == i)
+                    ++i;
+                d.bits_end = i;
+            } else if (w == ",") {
+                finish();
+                ++i;
+            } else if (w == "{" || w == "=") {
+                break;  // an initializer or function body
+            } else {
+                ++i;
+            }
+        }
+        finish();
+        return out;
+    }
+
+    Type spec_type(const Source& src, const Spec& spec, int depth) {
+        if (depth > kMaxDepth)
+            return Type();
+        if (spec.record != kNone)
+            return record_type(spec.record, depth + 1);
+        if (spec.is_record_tag) {
+            auto it = tags_.find(spec.tag);
+            return it == tags_.end() ? Type() : record_type(it->second, depth + 1);
+        }
+        if (spec.is_enum) {
+            if (spec.enum_type_end > spec.enum_type_begin)
+                return spec_type(src, parse_spec(src, spec.enum_type_begin, spec.enum_type_end, 0, 0), depth + 1);
+            if (!spec.tag.empty())
+                if (auto it = enum_tags_.find(spec.tag); it != enum_tags_.end())
+                    return alias_type(it->second, depth + 1);
+            return base_type(Base::I32, abi_);
+        }
+        if (spec.words) {
+            Base b;
+            if (spec.void_)
+                return Type();
+            if (spec.int128)
+                b = Base::I128;
+            else if (spec.bool_)
+                b = Base::Bool;
+            else if (spec.char_)
+                b = spec.unsigned_ ? Base::U8 : Base::I8;  // char is signed on Apple ARM
+            else if (spec.short_)
+                b = spec.unsigned_ ? Base::U16 : Base::I16;
+            else if (spec.float_)
+                b = Base::F32;
+            else if (spec.double_)
+                b = spec.longs ? Base::LongDouble : Base::F64;
+            else if (spec.longs >= 2)
+                b = spec.unsigned_ ? Base::U64 : Base::I64;
+            else if (spec.longs == 1)
+                b = spec.unsigned_ ? Base::ULong : Base::Long;
+            else
+                b = spec.unsigned_ ? Base::U32 : Base::I32;
+            Type t = base_type(b, abi_);
+            if (spec.complex)
+                t.size *= 2;  // real and imaginary parts, aligned as one part
+            return apply_vector(t, spec.attrs);
+        }
+        if (spec.name.empty())
+            return Type();
+        return apply_vector(named_type(spec.name, depth + 1), spec.attrs);
+    }
+
+    Type named_type(std::string_view name, int depth) {
+        if (auto it = aliases_.find(name); it != aliases_.end())
+            return alias_type(it->second, depth);
+        for (const NamedBase& b : kNamedBases)
+            if (b.name == name)
+                return base_type(target_ == LayoutTarget::LP64 ? b.lp64 : b.ilp32, abi_);
+        if (Type t; simd_type(name, abi_, t))
+            return t;
+        if (auto it = defines_.find(name); it != defines_.end() && depth <= kMaxDepth) {
+            Define& d = it->second;
+            if (d.state == 1)
+                return Type();
+            if (d.state == 0) {
+                d.state = 1;
+                d.src = std::make_unique<Source>(d.body);
+                Spec spec = parse_spec(*d.src, 0, d.src->size(), 0, 0);
+                d.type = spec.end == d.src->size() ? spec_type(*d.src, spec, depth + 1) : Type();
+                d.state = 2;
+            }
+            if (d.type.ok)
+                return d.type;
+        }
+        // Struct tags double as names in C++ and in the corpus's own usage.
+        if (auto it = tags_.find(name); it != tags_.end())
+            return record_type(it->second, depth);
+        return Type();
+    }
+
+    Type alias_type(Alias& a, int depth) {
+        if (a.state == 2)
+            return a.type;
+        if (a.state == 1 || depth > kMaxDepth)
+            return Type();
+        a.state = 1;
+        a.type = a.spec_only ? spec_type(*a.src, a.spec, depth + 1) : declared_type(*a.src, a.spec, a.decl, depth + 1);
+        a.state = 2;
+        return a.type;
+    }
+
+    Type pointer_type() { return base_type(Base::Ptr, abi_); }
+
+    Type apply_vector(Type t, const Attrs& attrs) {
+        if (!t.ok || (!attrs.vector && !attrs.vector_bytes))
+            return t;
+        std::uint32_t total = attrs.vector_bytes ? attrs.vector_bytes : t.size * attrs.vector;
+        // ext_vector_type(3) is stored as 4, and vectors round up to a power of two.
+        std::uint32_t size = 1;
+        while (size < total)
+            size <<= 1;
+        t.size = size;
+        t.align = std::min(size, abi_.max_vector_align);
+        t.kind = FieldKind::Vector;
+        return t;
+    }
+
+    Type declared_type(const Source& src, const Spec& spec, const Declarator& d, int depth) {
+        Type t = d.pointer ? pointer_type() : spec_type(src, spec, depth);
+        if (!t.ok)
+            return t;
+        t = apply_vector(t, d.attrs);
+        for (auto [begin, end] : d.dims) {
+            if (begin == end) {
+                t.count = 0;  // flexible array member
+                continue;
+            }
+            std::optional<std::int64_t> n = Evaluator(*this, src, begin, end, depth).run();
+            if (!n || *n < 0)
+                return Type();
+            t.count *= static_cast<std::uint32_t>(*n);
+        }
+        return t;
+    }
+
+    // Array bounds and bitfield widths: integer constant expressions over
+    // literals, enumerators, #defines and sizeof.
+    class Evaluator : public ConstExpr {
+    public:
+        Evaluator(Resolver& r, const Source& src, std::size_t begin, std::size_t end, int depth)
+            : ConstExpr(src.text, src.toks, begin, end), r_(r), src_(src), depth_(depth) {}
+
+        std::optional<std::int64_t> run() {
+            ConstValue v;
+            return evaluate_all(v) ? std::optional<std::int64_t>(v.as_signed()) : std::nullopt;
+        }
+
+    protected:
+        bool identifier(ConstValue& out) override {
+            std::string_view w = str(i_++);
+            if (w == "sizeof" && punct("(")) {
+                std::size_t close = src_.skip(i_) - 1;
+                Spec spec = r_.parse_spec(src_, i_ + 1, close, 0, 0);
+                std::vector<Declarator> ds = r_.parse_declarators(src_, spec.end, close);
+                Type type = ds.empty() ? r_.spec_type(src_, spec, depth_ + 1)
+                                       : r_.declared_type(src_, spec, ds.front(), depth_ + 1);
+                i_ = close + 1;
+                out = {std::uint64_t(type.size) * type.count, true};  // a size_t
+                return type.ok;
+            }
+            // The enumerator the table's target compiles, else any arm's.
+            if (r_.enums_) {
+                const ConstantRecord* found = nullptr;
+                for (std::uint32_t id : r_.enums_->find(w)) {
+                    const ConstantRecord& c = r_.enums_->constant(id);
+                    if ((c.flags & ConstantRecord::kResolved) && (!found || (found->flags & ConstantRecord::kInactive)))
+                        found = &c;
+                }
+                if (found) {
+                    const EnumRecord& e = r_.enums_->enum_of(*found);
+                    out = convert_value(ConstValue::of(found->value), e.width, e.is_signed);
+                    return true;
+                }
+            }
+            if (auto it = r_.defines_.find(w); it != r_.defines_.end() && depth_ < kMaxDepth) {
+                Define& d = it->second;
+                if (!d.src)
+                    d.src = std::make_unique<Source>(d.body);
+                return Evaluator(r_, *d.src, 0, d.src->size(), depth_ + 1).evaluate_all(out);
+            }
+            return false;
+        }
+
+    private:
+        Resolver& r_;
+        const Source& src_;
+        int depth_;
+    };
+
+    Type record_type(std::uint32_t id, int depth) {
+        RecordDef& r = records_[id];
+        if (r.state == 2)
+            return r.type;
+        if (r.state == 1 || depth > kMaxDepth)
+            return Type();
+        r.state = 1;
+        const Source& src = *r.src;
+        std::vector<FieldOut> fields;
+        std::uint64_t bits = 0, size_bits = 0;
+        std::uint32_t align = 1;
+        bool ok = true, bitfields = false;
+        for (std::size_t i = r.open + 1; i < r.close && ok;) {
+            if (src.punct(i, ';') || src.toks[i].kind == Tok::Directive ||
+                (src.ident(i) && src.str(i)[0] == '@')) {  // @public, @private, ...
+                ++i;
+                continue;
+            }
+            std::size_t end = i;
+            while (end < r.close && !src.punct(end, ';'))
+                end = src.punct(end, '{') || src.punct(end, '(') || src.punct(end, '[') ? src.skip(end) : end + 1;
+            Spec spec = parse_spec(src, i, end, r.section, r.pack);
+            std::vector<Declarator> decls = parse_declarators(src, spec.end, end);
+            if (decls.empty() && spec.record != kNone)
+                decls.emplace_back();  // anonymous struct or union member
+            for (const Declarator& d : decls) {
+                if (d.function)
+                    continue;
+                Type t = declared_type(src, spec, d, depth);
+                if (!t.ok) {
+                    if (target_ == LayoutTarget::LP64)
+                        unknown_.emplace(spec.text.empty() ? "?" : spec.text);
+                    ok = false;
+                    break;
+                }
+                std::uint32_t a = t.align;
+                if (r.attrs.packed || d.attrs.packed)
+                    a = 1;
+                else if (r.pack && a > r.pack)
+                    a = r.pack;
+                if (d.attrs.aligned)
+                    a = std::max(a, d.attrs.aligned);
+                FieldOut f{std::string(d.name), spec.text + (d.pointer ? " *" : ""), 0, t.size, t.count, t.record,
+                           0, t.kind, static_cast<std::uint8_t>(t.is_signed ? FieldRecord::kSigned : 0)};
+                if (d.bitfield) {
+                    std::optional<std::int64_t> w = Evaluator(*this, src, d.bits_begin, d.bits_end, depth).run();
+                    if (!w || *w < 0 || *w > 64 || t.count != 1) {
+                        ok = false;
+                        break;
+                    }
+                    bitfields = true;
+                    std::uint64_t width = static_cast<std::uint64_t>(*w), unit = std::uint64_t(t.size) * 8;
+                    std::uint64_t at = r.is_union ? 0 : bits;
+                    if (width == 0) {
+                        bits = align_up(bits, std::uint64_t(a) * 8);
+                        continue;
+                    }
+                    // A bitfield never straddles a storage unit of its type,
+                    // unless the record is packed.
+                    if (!r.attrs.packed && unit && at / unit != (at + width - 1) / unit)
+                        at = align_up(at, std::uint64_t(a) * 8);
+                    f.bit_offset = at;
+                    f.bit_width = static_cast<std::uint16_t>(width);
+                    f.flags |= FieldRecord::kBitfield;
+                    if (!d.name.empty())
+                        align = std::max(align, a);
+                    if (!r.is_union)
+                        bits = at + width;
+                    size_bits = std::max(size_bits, at + width);
+                } else {
+                    std::uint64_t at = r.is_union ? 0 : align_up(bits, std::uint64_t(a) * 8);
+                    f.bit_offset = at;
+                    std::uint64_t end_bits = at + std::uint64_t(t.size) * t.count * 8;
+                    if (!r.is_union)
+                        bits = end_bits;
+                    size_bits = std::max(size_bits, end_bits);
+                    align = std::max(align, a);
+                }
+                fields.push_back(std::move(f));
+            }
+            i = end + 1;
+        }
+        r.state = 2;
+        if (!ok) {
+            r.type = Type();
+            return r.type;
+        }
+        if (r.attrs.aligned)
+            align = std::max(align, r.attrs.aligned);
+        Type t;
+        t.ok = true;
+        t.kind = FieldKind::Record;
+        t.record = id;
+        t.align = align;
+        t.size = static_cast<std::uint32_t>(align_up((size_bits + 7) / 8, align));
+        r.type = t;
+        r.fields = std::move(fields);
+        r.bitfields = bitfields;
+        return t;
+    }
+
+    ConditionalViews views_;  // owns the live text the records point into
+    LayoutTarget target_;
+    Abi abi_;
+    const EnumTable* enums_;
+    std::vector<std::unique_ptr<Source>> sections_;
+    std::vector<RecordDef> records_;
+    std::map<std::pair<const Source*, std::size_t>, std::uint32_t> record_at_;
+    std::unordered_map<std::string_view, std::uint32_t> tags_;
+    std::unordered_map<std::string_view, Alias> enum_tags_;
+    std::unordered_map<std::string_view, Alias> aliases_;
+    std::vector<std::string_view> alias_order_;
+    std::unordered_map<std::string_view, Define> defines_;
+    std::set<std::string> unknown_;
+    std::deque<std::string> sparse_names_;  // stable storage for the alias keys
+};
+
+} // namespace
+
+const char* layout_target_name(LayoutTarget t) {
+    return t == LayoutTarget::LP64 ? "lp64" : "ilp32";
+}
+
+TargetConfig layout_target_config(LayoutTarget t) {
+    TargetConfig config;
+    config.pointer_bits = t == LayoutTarget::LP64 ? 64 : 32;
+    return config;
+}
+
+bool parse_layout_target(std::string_view name, LayoutTarget& t) {
+    if (name == "lp64" || name == "arm64" || name == "64")
+        t = LayoutTarget::LP64;
+    else if (name == "ilp32" || name == "armv7" || name == "32")
+        t = LayoutTarget::ILP32;
+    else
+        return false;
+    return true;
+}
+
+const char* field_kind_name(FieldKind k) {
+    static constexpr const char* kNames[] = {"int", "float", "pointer", "record", "vector"};
+    return kNames[static_cast<int>(k)];
+}
+
+std::uint64_t read_field(const FieldRecord& f, const void* record, std::uint32_t index) {
+    const auto* p = static_cast<const unsigned char*>(record);
+    std::uint64_t v = 0;
+    unsigned width;
+    if (f.flags & FieldRecord::kBitfield) {
+        std::uint64_t first = f.bit_offset / 8;
+        int shift = static_cast<int>(f.bit_offset % 8);
+        width = f.bit_width;
+        for (unsigned k = 0; k * 8 < shift + width; ++k) {
+            int pos = static_cast<int>(k * 8) - shift;
+            std::uint64_t byte = p[first + k];
+            if (pos < 0)
+                v |= byte >> -pos;
+            else if (pos < 64)
+                v |= byte << pos;
+        }
+    } else {
+        std::uint32_t n = std::min<std::uint32_t>(f.size, 8);
+        const unsigned char* at = p + f.bit_offset / 8 + std::uint64_t(index) * f.size;
+        for (std::uint32_t k = 0; k < n; ++k)
+            v |= std::uint64_t(at[k]) << (8 * k);
+        width = n * 8;
+    }
+    if (width < 64) {
+        v &= (std::uint64_t(1) << width) - 1;
+        if ((f.flags & FieldRecord::kSigned) && width && (v >> (width - 1)) & 1)
+            v |= ~((std::uint64_t(1) << width) - 1);
+    }
+    return v;
+}
+
+std::string StructLayouts::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "layouts.tbl").string();
+}
+
+LayoutBuildStats StructLayouts::build(const Corpus& corpus, const LayoutEnums& enums, const std::string& path,
+                                      unsigned threads) {
+    LayoutBuildStats stats;
+    StringPool strings;
+    std::vector<StructRecord> records;
+    std::vector<FieldRecord> fields;
+    std::vector<Name> names;
+    std::vector<std::uint64_t> hashes;
+    for (int ti = 0; ti < kLayoutTargetCount; ++ti) {
+        LayoutTarget target = static_cast<LayoutTarget>(ti);
+        Resolver resolver(corpus, target, enums[ti], threads);
+        if (target == LayoutTarget::LP64)
+            stats.unknown_types.assign(resolver.unknown().begin(), resolver.unknown().end());
+        std::uint32_t base = static_cast<std::uint32_t>(records.size());
+        std::set<std::string_view> seen;
+        auto add_name = [&](std::string_view name, std::uint32_t record) {
+            if (name.empty() || !seen.insert(name).second)
+                return;
+            names.push_back({strings.add(name), static_cast<std::uint32_t>(ti), record});
+            hashes.push_back(hash64(name, static_cast<std::uint64_t>(ti)));
+        };
+        for (const RecordDef& r : resolver.records()) {
+            StructRecord out{};
+            std::string_view name = r.names.empty() ? r.tag : r.names.front();
+            out.name = strings.add(name);
+            out.tag = strings.add(r.tag);
+            out.first_field = static_cast<std::uint32_t>(fields.size());
+            out.field_count = static_cast<std::uint32_t>(r.fields.size());
+            out.size = r.type.size;
+            out.align = r.type.align;
+            out.section = r.section;
+            out.target = target;
+            out.flags = static_cast<std::uint8_t>((r.is_union ? StructRecord::kUnion : 0) |
+                                                  (r.type.ok ? StructRecord::kResolved : 0) |
+                                                  (r.attrs.packed ? StructRecord::kPacked : 0) |
+                                                  (r.bitfields ? StructRecord::kBitfields : 0));
+            out.pack = r.pack;
+            for (const FieldOut& f : r.fields) {
+                FieldRecord fr{};
+                fr.name = strings.add(f.name);
+                fr.type = strings.add(f.type);
+                fr.bit_offset = f.bit_offset;
+                fr.size = f.size;
+                fr.count = f.count;
+                fr.record = f.record == kNone ? FieldRecord::kNoRecord : base + f.record;
+                fr.bit_width = f.bit_width;
+                fr.kind = f.kind;
+                fr.flags = f.flags;
+                fields.push_back(fr);
+                stats.bitfields[ti] += (f.flags & FieldRecord::kBitfield) != 0;
+            }
+            std::uint32_t id = static_cast<std::uint32_t>(records.size());
+            for (std::string_view n : r.names)
+                add_name(n, id);
+            add_name(r.tag, id);
+            stats.resolved[ti] += r.type.ok;
+            stats.fields[ti] += r.fields.size();
+            records.push_back(out);
+        }
+        stats.records[ti] = records.size() - base;
+    }
+    PerfectHash ph = PerfectHash::build(hashes);
+
+    BlobWriter w(kMagic, kVersion, moby::corpus_hash(corpus));
+    std::size_t layout_at = w.put(LayoutFileLayout{});
+    LayoutFileLayout layout{};
+    layout.record_count = records.size();
+    layout.field_count = fields.size();
+    layout.name_count = names.size();
+    layout.bucket_count = ph.displacements.size();
+    layout.slot_count = ph.slots.size();
+    layout.records = w.put_array(records);
+    layout.fields = w.put_array(fields);
+    layout.names = w.put_array(names);
+    layout.displacements = w.put_array(ph.displacements);
+    layout.slots = w.put_array(ph.slots);
+    layout.strings = w.put_bytes(strings.data().data(), strings.data().size());
+    layout.strings_size = strings.data().size();
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+    return stats;
+}
+
+StructLayouts::StructLayouts(const std::string& path) : reader_(path, kMagic, kVersion) {
+    const LayoutFileLayout& l = *reader_.array<LayoutFileLayout>(sizeof(BlobHeader), 1);
+    record_count_ = l.record_count;
+    bucket_count_ = l.bucket_count;
+    slot_count_ = l.slot_count;
+    records_ = reader_.array<StructRecord>(l.records, l.record_count);
+    fields_ = reader_.array<FieldRecord>(l.fields, l.field_count);
+    names_ = reader_.array<Name>(l.names, l.name_count);
+    displacements_ = reader_.array<std::uint32_t>(l.displacements, l.bucket_count);
+    slots_ = reader_.array<std::uint32_t>(l.slots, l.slot_count);
+    reader_.bytes(l.strings, l.strings_size);
+    strings_ = l.strings;
+}
+
+const StructRecord* StructLayouts::find(std::string_view name, LayoutTarget target) const {
+    std::uint32_t entry = perfect_hash_lookup(hash64(name, static_cast<std::uint64_t>(target)), displacements_,
+                                              bucket_count_, slots_, slot_count_);
+    if (entry == 0)
+        return nullptr;
+    const Name& n = names_[entry - 1];
+    if (n.target != static_cast<std::uint32_t>(target) || this->name(n.name) != name)
+        return nullptr;
+    return &records_[n.record];
+}
+
+} // namespace moby
@@ -0,0 +1,287 @@
+#include "moby/swift_names.h"
+
+#include "moby/lexer.h"
+#include "moby/section_index.h"
+#include "moby/work_pool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <numeric>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+namespace {
+
+struct SwiftNameLayout {
+    std::uint64_t record_count;
+    std::uint64_t key_count;
+    std::uint64_t records;
+    std::uint64_t keys;
+    std::uint64_t strings;
+    std::uint64_t strings_size;
+};
+
+// One annotation site, relative to the corpus file.
+struct Site {
+    std::uint64_t offset;
+    std::uint64_t end;
+    std::string swift;  // empty for NS_REFINED_FOR_SWIFT
+};
+
+// The argument of NS_SWIFT_NAME(...) without whitespace; the quotes of
+// swift_name("...") are dropped.
+std::string swift_argument(std::string_view text, const std::vector<Token>& toks, std::size_t open,
+                           std::size_t& close) {
+    std::string out;
+    int depth = 0;
+    for (close = open; close < toks.size(); ++close) {
+        std::string_view s = token_text(text, toks[close]);
+        if (is_punct(text, toks[close], '('))
+            ++depth;
+        else if (is_punct(text, toks[close], ')') && --depth == 0)
+            break;
+        if (close == open)
+            continue;
+        if (toks[close].kind == Tok::String && s.size() >= 2 && s.front() == '"')
+            s = s.substr(1, s.size() - 2);
+        out += s;
+    }
+    return out;
+}
+
+void scan_section(const Section& section, std::vector<Site>& out) {
+    std::string_view text = section.text;
+    std::vector<Token> toks = tokenize(text);
+    for (std::size_t i = 0; i < toks.size(); ++i) {
+        if (toks[i].kind != Tok::Ident)
+            continue;
+        std::string_view s = token_text(text, toks[i]);
+        std::uint64_t at = section.offset + toks[i].offset;
+        bool call = i + 1 < toks.size() && is_punct(text, toks[i + 1], '(');
+        if ((ends_with(s, "_SWIFT_NAME") || s == "swift_name") && call) {
+            std::size_t close = 0;
+            std::string swift = swift_argument(text, toks, i + 1, close);
+            if (close == toks.size() || swift.empty())
+                continue;
+            out.push_back({at, section.offset + toks[close].offset + 1, std::move(swift)});
+            i = close;
+        } else if (ends_with(s, "REFINED_FOR_SWIFT") || s == "swift_private") {
+            out.push_back({at, at + s.size(), {}});
+        }
+    }
+}
+
+bool is_container(SymbolKind k) {
+    return k == SymbolKind::Interface || k == SymbolKind::Category || k == SymbolKind::Protocol;
+}
+
+// The declaration a site annotates, or ~0u. `ids` are the section's symbols
+// ordered by offset.
+std::uint32_t attach(const SymbolDb& db, const Section& section, const std::vector<std::uint32_t>& ids,
+                     const Site& site) {
+    std::uint32_t inner = ~0u, container = ~0u, before = ~0u;
+    std::uint64_t inner_length = ~0ull, before_end = 0;
+    for (std::uint32_t id : ids) {
+        const SymbolRecord& r = db.at(id);
+        if (r.offset > site.offset)
+            break;
+        std::uint64_t end = r.offset + r.length;
+        if (end > site.offset) {
+            if (is_container(r.kind)) {
+                container = id;
+            } else if (r.length < inner_length) {
+                inner = id;
+                inner_length = r.length;
+            }
+        } else if (end > before_end || (end == before_end && r.kind != SymbolKind::Typedef)) {
+            before = id;
+            before_end = end;
+        }
+    }
+    if (inner != ~0u)
+        return inner;
+    // Between a class's leading attributes and its @interface, before any of
+    // its members.
+    if (container != ~0u && (before == ~0u || db.at(before).offset < db.at(container).offset))
+        return container;
+    // `} NS_SWIFT_NAME(...);` names the enum or struct it follows; after a ';'
+    // or @end the annotation belongs to the next declaration.
+    if (before != ~0u) {
+        std::string_view gap(section.text.data() - section.offset + before_end, site.offset - before_end);
+        std::string_view last(section.text.data() - section.offset + before_end - 1, 1);
+        if (last == "}" && gap.find(';') == std::string_view::npos)
+            return before;
+    }
+    auto next = std::find_if(ids.begin(), ids.end(), [&](std::uint32_t id) { return db.at(id).offset >= site.end; });
+    return next == ids.end() ? ~0u : *next;
+}
+
+// The name a refined declaration without NS_SWIFT_NAME gets, before the `__`:
+// "foo:bar:" -> "foo(_:bar:)", "initWithCoordinate:" -> "init(coordinate:)".
+std::string imported_name(const SymbolRecord& r, std::string_view name) {
+    if (r.kind != SymbolKind::InstanceMethod && r.kind != SymbolKind::ClassMethod)
+        return std::string(name);
+    if (name.find(':') == std::string_view::npos)
+        return std::string(name) + "()";
+    std::string out;
+    std::size_t colon = name.find(':');
+    std::string_view first = name.substr(0, colon);
+    std::string label = "_";
+    if (first.size() > 4 && first.substr(0, 4) == "init" && std::isupper(static_cast<unsigned char>(first[4]))) {
+        std::string_view rest = first.substr(4);
+        if (rest.size() > 4 && rest.substr(0, 4) == "With")
+            rest = rest.substr(4);
+        label = std::string(rest);
+        label[0] = static_cast<char>(std::tolower(static_cast<unsigned char>(label[0])));
+        first = "init";
+    }
+    out.append(first).append("(").append(label).append(":");
+    for (std::size_t at = colon + 1; at < name.size();) {
+        std::size_t next = name.find(':', at);
+        if (next == std::string_view::npos)
+            break;
+        out.append(next == at ? "_" : name.substr(at, next - at)).append(":");
+        at = next + 1;
+    }
+    return out + ")";
+}
+
+} // namespace
+
+std::string SwiftNameTable::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "swift_names.idx").string();
+}
+
+SwiftNameStats SwiftNameTable::build(const Corpus& corpus, const SymbolDb& db, const std::string& path) {
+    const auto& sections = corpus.sections();
+    std::vector<std::uint32_t> tasks(sections.size());
+    std::iota(tasks.begin(), tasks.end(), 0);
+    std::stable_sort(tasks.begin(), tasks.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return sections[a].length > sections[b].length; });
+    std::vector<std::vector<std::uint32_t>> section_ids(sections.size());
+    for (std::uint32_t id = 0; id < db.size(); ++id)
+        section_ids[db.at(id).section].push_back(id);
+
+    // Site -> symbol, per section in parallel.
+    std::vector<std::vector<Site>> sites(sections.size());
+    std::vector<std::vector<std::uint32_t>> owners(sections.size());
+    run_stealing(tasks, 0, [&](std::uint32_t s) {
+        scan_section(sections[s], sites[s]);
+        if (sites[s].empty())
+            return;
+        std::vector<std::uint32_t>& ids = section_ids[s];
+        std::stable_sort(ids.begin(), ids.end(),
+                         [&](std::uint32_t a, std::uint32_t b) { return db.at(a).offset < db.at(b).offset; });
+        for (const Site& site : sites[s])
+            owners[s].push_back(attach(db, sections[s], ids, site));
+    });
+
+    SwiftNameStats stats;
+    std::vector<std::uint32_t> order;  // annotated symbols, by ID once sorted
+    std::unordered_map<std::uint32_t, std::pair<std::string, std::uint8_t>> annotated;
+    for (std::size_t s = 0; s < sections.size(); ++s) {
+        for (std::size_t k = 0; k < sites[s].size(); ++k) {
+            ++stats.annotations;
+            std::uint32_t id = owners[s][k];
+            if (id == ~0u) {
+                ++stats.unattached;
+                continue;
+            }
+            auto [it, fresh] = annotated.try_emplace(id);
+            if (fresh)
+                order.push_back(id);
+            if (sites[s][k].swift.empty()) {
+                it->second.second |= SwiftNameRecord::kRefined;
+            } else {
+                it->second.first = sites[s][k].swift;
+                it->second.second |= SwiftNameRecord::kRenamed;
+            }
+        }
+    }
+    std::sort(order.begin(), order.end());
+
+    StringPool strings;
+    std::vector<SwiftNameRecord> records;
+    std::vector<SwiftNameKey> keys;
+    records.reserve(order.size());
+    for (std::uint32_t id : order) {
+        const SymbolRecord& r = db.at(id);
+        const auto& [written, flags] = annotated[id];
+        std::string swift = flags & SwiftNameRecord::kRenamed ? written : "__" + imported_name(r, db.name(r));
+        SwiftNameRecord rec{};
+        rec.name = strings.add(db.name(r));
+        rec.swift = strings.add(swift);
+        rec.parent = strings.add(is_container(r.kind) ? std::string_view() : db.parent(r));
+        rec.symbol = id;
+        rec.kind = r.kind;
+        rec.flags = flags;
+        auto index = static_cast<std::uint32_t>(records.size());
+        keys.push_back({rec.name, index, SwiftKeySide::ObjC});
+        keys.push_back({rec.swift, index, SwiftKeySide::Swift});
+        std::size_t dot = swift.rfind('.', swift.find('('));
+        if (dot != std::string::npos && dot + 1 < swift.size())
+            keys.push_back({strings.add(std::string_view(swift).substr(dot + 1)), index, SwiftKeySide::Member});
+        stats.renamed += (flags & SwiftNameRecord::kRenamed) != 0;
+        stats.refined += (flags & SwiftNameRecord::kRefined) != 0;
+        records.push_back(rec);
+    }
+    const std::string& pool = strings.data();
+    auto text = [&](const SwiftNameKey& k) { return std::string_view(pool).substr(k.text.offset, k.text.length); };
+    std::sort(keys.begin(), keys.end(), [&](const SwiftNameKey& a, const SwiftNameKey& b) {
+        if (int c = text(a).compare(text(b)))
+            return c < 0;
+        return a.side != b.side ? a.side < b.side : a.record < b.record;
+    });
+    stats.records = records.size();
+    stats.keys = keys.size();
+
+    BlobWriter w(kMagic, kVersion, moby::corpus_hash(corpus));
+    std::size_t layout_at = w.put(SwiftNameLayout{});
+    SwiftNameLayout layout{};
+    layout.record_count = records.size();
+    layout.key_count = keys.size();
+    layout.records = w.put_array(records);
+    layout.keys = w.put_array(keys);
+    layout.strings = w.put_bytes(pool.data(), pool.size());
+    layout.strings_size = pool.size();
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+    return stats;
+}
+
+SwiftNameTable::SwiftNameTable(const std::string& path) : reader_(path, kMagic, kVersion) {
+    const SwiftNameLayout& l = *reader_.array<SwiftNameLayout>(sizeof(BlobHeader), 1);
+    record_count_ = l.record_count;
+    key_count_ = l.key_count;
+    records_ = reader_.array<SwiftNameRecord>(l.records, l.record_count);
+    keys_ = reader_.array<SwiftNameKey>(l.keys, l.key_count);
+    reader_.bytes(l.strings, l.strings_size);
+    strings_ = l.strings;
+}
+
+SwiftNameTable::Keys SwiftNameTable::find(std::string_view text) const {
+    const SwiftNameKey* last = keys_ + key_count_;
+    auto range = std::equal_range(keys_, last, text, [&](const auto& a, const auto& b) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(a)>, SwiftNameKey>)
+            return str(a.text) < b;
+        else
+            return a < str(b.text);
+    });
+    return {range.first, static_cast<std::size_t>(range.second - range.first)};
+}
+
+SwiftNameTable::Keys SwiftNameTable::complete(std::string_view prefix) const {
+    const SwiftNameKey* last = keys_ + key_count_;
+    const SwiftNameKey* lo = std::lower_bound(
+        keys_, last, prefix, [&](const SwiftNameKey& k, std::string_view p) { return str(k.text) < p; });
+    const SwiftNameKey* hi = std::partition_point(
+        lo, last, [&](const SwiftNameKey& k) { return str(k.text).substr(0, prefix.size()) == prefix; });
+    return {lo, static_cast<std::size_t>(hi - lo)};
+}
+
+} // namespace moby
@@ -0,0 +1,166 @@
+#include "moby/symbol_db.h"
+
+#include "moby/hash.h"
+#include "moby/perfect_hash.h"
+#include "moby/section_index.h"
+#include "moby/work_pool.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iterator>
+#include <numeric>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+namespace {
+
+struct SymbolDbLayout {
+    std::uint64_t symbol_count;
+    std::uint64_t name_count;
+    std::uint64_t bucket_count;
+    std::uint64_t slot_count;
+    std::uint64_t section_count;
+    std::uint64_t file_count;
+    std::uint64_t symbols;
+    std::uint64_t names;
+    std::uint64_t displacements;
+    std::uint64_t slots;
+    std::uint64_t sections;
+    std::uint64_t files;
+    std::uint64_t strings;
+    std::uint64_t strings_size;
+};
+
+} // namespace
+
+std::vector<Symbol> extract_corpus_symbols(const Corpus& corpus, unsigned threads) {
+    const auto& sections = corpus.sections();
+    // One task per section, largest first; each writes only its own slot.
+    std::vector<std::uint32_t> tasks(sections.size());
+    std::iota(tasks.begin(), tasks.end(), 0);
+    std::stable_sort(tasks.begin(), tasks.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return sections[a].length > sections[b].length; });
+    std::vector<std::vector<Symbol>> parts(sections.size());
+    run_stealing(tasks, threads, [&](std::uint32_t i) {
+        extract_symbols(sections[i].text, sections[i].offset, i, parts[i]);
+    });
+
+    std::size_t total = 0;
+    for (const auto& part : parts)
+        total += part.size();
+    std::vector<Symbol> symbols;
+    symbols.reserve(total);
+    for (auto& part : parts)
+        std::move(part.begin(), part.end(), std::back_inserter(symbols));
+    return symbols;
+}
+
+std::string SymbolDb::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "symbols.db").string();
+}
+
+std::vector<std::uint32_t> SymbolDb::build(const Corpus& corpus, const std::vector<Symbol>& symbols,
+                                           const std::string& path) {
+    // Name order, ties in input order. Sorting (name, index) pairs keeps the
+    // comparisons on contiguous memory.
+    std::vector<std::pair<std::string_view, std::uint32_t>> sorted(symbols.size());
+    for (std::uint32_t i = 0; i < symbols.size(); ++i)
+        sorted[i] = {symbols[i].name, i};
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<std::uint32_t> order(symbols.size());
+    for (std::size_t i = 0; i < sorted.size(); ++i)
+        order[i] = sorted[i].second;
+
+    StringPool strings;
+    std::vector<SymbolRecord> records;
+    std::vector<SymbolName> names;
+    std::vector<std::uint64_t> hashes;
+    std::vector<std::uint32_t> ids(symbols.size());
+    records.reserve(symbols.size());
+    for (std::uint32_t idx : order) {
+        const Symbol& s = symbols[idx];
+        ids[idx] = static_cast<std::uint32_t>(records.size());
+        SymbolRecord r{};
+        r.name = strings.add(s.name);
+        r.parent = strings.add(s.parent);
+        r.offset = s.offset;
+        r.length = s.length;
+        r.section = s.section;
+        r.kind = s.kind;
+        if (names.empty() || symbols[order[names.back().first]].name != s.name) {
+            names.push_back({r.name, static_cast<std::uint32_t>(records.size()), 0});
+            hashes.push_back(hash64(s.name));
+        }
+        ++names.back().count;
+        records.push_back(r);
+    }
+    PerfectHash ph = PerfectHash::build(hashes);
+
+    std::vector<StrRef> files;
+    for (const CorpusFile& f : corpus.files())
+        files.push_back(strings.add(f.name));
+    std::vector<SymbolSection> sections;
+    for (const Section& s : corpus.sections())
+        sections.push_back({strings.add(s.path), s.file, 0, s.offset});
+
+    BlobWriter w(kMagic, kVersion, moby::corpus_hash(corpus));
+    std::size_t layout_at = w.put(SymbolDbLayout{});
+    SymbolDbLayout layout{};
+    layout.symbol_count = records.size();
+    layout.name_count = names.size();
+    layout.bucket_count = ph.displacements.size();
+    layout.slot_count = ph.slots.size();
+    layout.section_count = sections.size();
+    layout.file_count = files.size();
+    layout.symbols = w.put_array(records);
+    layout.names = w.put_array(names);
+    layout.displacements = w.put_array(ph.displacements);
+    layout.slots = w.put_array(ph.slots);
+    layout.sections = w.put_array(sections);
+    layout.files = w.put_array(files);
+    layout.strings = w.put_bytes(strings.data().data(), strings.data().size());
+    layout.strings_size = strings.data().size();
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+    return ids;
+}
+
+SymbolDb::SymbolDb(const std::string& path) : reader_(path, kMagic, kVersion) {
+    const SymbolDbLayout& l = *reader_.array<SymbolDbLayout>(sizeof(BlobHeader), 1);
+    symbol_count_ = l.symbol_count;
+    bucket_count_ = l.bucket_count;
+    slot_count_ = l.slot_count;
+    section_count_ = l.section_count;
+    symbols_ = reader_.array<SymbolRecord>(l.symbols, l.symbol_count);
+    names_ = reader_.array<SymbolName>(l.names, l.name_count);
+    displacements_ = reader_.array<std::uint32_t>(l.displacements, l.bucket_count);
+    slots_ = reader_.array<std::uint32_t>(l.slots, l.slot_count);
+    sections_ = reader_.array<SymbolSection>(l.sections, l.section_count);
+    files_ = reader_.array<StrRef>(l.files, l.file_count);
+    reader_.bytes(l.strings, l.strings_size);
+    strings_ = l.strings;
+}
+
+SymbolDb::Range SymbolDb::find(std::string_view name) const {
+    std::uint32_t entry = perfect_hash_lookup(hash64(name), displacements_, bucket_count_, slots_, slot_count_);
+    if (entry == 0)
+        return {symbols_, 0};
+    const SymbolName& n = names_[entry - 1];
+    if (reader_.str(strings_, n.name) != name)
+        return {symbols_, 0};
+    return {symbols_ + n.first, n.count};
+}
+
+SymbolDb::Range SymbolDb::with_prefix(std::string_view prefix) const {
+    const SymbolRecord* last = symbols_ + symbol_count_;
+    const SymbolRecord* lo = std::lower_bound(
+        symbols_, last, prefix, [&](const SymbolRecord& r, std::string_view p) { return name(r) < p; });
+    const SymbolRecord* hi = std::partition_point(
+        lo, last, [&](const SymbolRecord& r) { return name(r).substr(0, prefix.size()) == prefix; });
+    return {lo, static_cast<std::size_t>(hi - lo)};
+}
+
+} // namespace moby
@@ -0,0 +1,584 @@
+#include "moby/symbols.h"
+
+#include "moby/lexer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace moby {
+namespace {
+
+constexpr const char* kKindNames[kSymbolKindCount] = {
+    "interface", "category", "protocol", "class-method", "instance-method", "property", "function",
+    "enum",      "enum-constant", "struct", "union", "typedef", "variable",
+};
+
+// Enum macros whose last argument names the type: NS_ENUM(NSInteger, Name).
+constexpr std::string_view kEnumMacros[] = {
+    "NS_ENUM", "NS_OPTIONS", "NS_CLOSED_ENUM", "NS_ERROR_ENUM", "CF_ENUM", "CF_OPTIONS", "CF_CLOSED_ENUM",
+};
+
+bool is_enum_macro(std::string_view s) {
+    return std::find(std::begin(kEnumMacros), std::end(kEnumMacros), s) != std::end(kEnumMacros);
+}
+
+constexpr std::string_view kCompilerKeywords[] = {
+    "__kindof", "__nullable", "__nonnull", "__null_unspecified", "__unsafe_unretained", "__strong",
+    "__weak", "__autoreleasing", "__restrict", "__covariant", "__contravariant", "__asm", "__unused",
+    "__inline", "__deprecated", "__block",
+};
+
+// Words that can end a declaration without naming anything.
+constexpr std::string_view kCKeywords[] = {
+    "void", "extern", "const", "static", "inline", "int", "char", "unsigned", "signed", "long", "short",
+    "float", "double", "struct", "union", "enum", "volatile", "return", "typedef", "register", "restrict",
+};
+
+bool is_c_keyword(std::string_view s) {
+    return std::find(std::begin(kCKeywords), std::end(kCKeywords), s) != std::end(kCKeywords);
+}
+
+// Macros that decorate a declaration rather than name one.
+bool is_attribute_macro(std::string_view s) {
+    return (s.size() > 1 && s[0] == '_' && s[1] == '_') || s.find("AVAILABLE") != std::string_view::npos ||
+           s.find("DEPRECATED") != std::string_view::npos || s.find("SWIFT") != std::string_view::npos ||
+           s.find("ATTRIBUTE") != std::string_view::npos || s.find("_API") != std::string_view::npos;
+}
+
+// Macros that stand alone without a terminating ';', such as
+// NS_ASSUME_NONNULL_BEGIN or __BEGIN_DECLS.
+bool is_bracketing_macro(std::string_view s) {
+    return is_macro_name(s) && (ends_with(s, "_BEGIN") || ends_with(s, "_END") || ends_with(s, "_DECLS") ||
+                                ends_with(s, "_ENABLED") || ends_with(s, "_DISABLED") ||
+                                ends_with(s, "_PUSH") || ends_with(s, "_POP"));
+}
+
+bool is_export_macro(std::string_view s) {
+    return s == "extern" || (is_macro_name(s) && (s.find("EXPORT") != std::string_view::npos ||
+                                                  s.find("EXTERN") != std::string_view::npos));
+}
+
+class Parser {
+public:
+    Parser(std::string_view text, std::uint64_t base, std::uint32_t section, std::vector<Symbol>& out)
+        : text_(text), base_(base), section_(section), out_(out) {
+        for (const Token& t : tokenize(text))
+            if (t.kind != Tok::Directive)
+                toks_.push_back(t);
+    }
+
+    void run();
+
+private:
+    std::size_t size() const { return toks_.size(); }
+    std::string_view str(std::size_t i) const { return i < size() ? token_text(text_, toks_[i]) : std::string_view(); }
+    bool punct(std::size_t i, char c) const { return i < size() && is_punct(text_, toks_[i], c); }
+    bool ident(std::size_t i) const { return i < size() && toks_[i].kind == Tok::Ident; }
+    bool at_keyword(std::size_t i) const { return ident(i) && text_[toks_[i].offset] == '@'; }
+
+    std::size_t skip_group(std::size_t i) const { return moby::skip_group(text_, toks_, i, size()); }
+    std::size_t skip_angles(std::size_t i) const { return moby::skip_angles(text_, toks_, i, size()); }
+    std::size_t statement_end(std::size_t i) const;
+
+    void emit(std::string name, std::string parent, SymbolKind kind, std::size_t first, std::size_t last);
+    std::size_t end_of(std::size_t last) const { return toks_[last].offset + toks_[last].length; }
+
+    std::size_t parse_interface(std::size_t i, std::size_t start);
+    std::size_t parse_protocol(std::size_t i, std::size_t start);
+    std::size_t parse_method(std::size_t i);
+    std::size_t parse_property(std::size_t i);
+    void parse_statement(std::size_t first, std::size_t last);
+    void parse_typedef(std::size_t first, std::size_t i, std::size_t last);
+    void parse_enum_body(std::size_t open, const std::string& parent);
+    std::string declarator_name(std::size_t i, std::size_t last) const;
+
+    std::string_view text_;
+    std::uint64_t base_;
+    std::uint32_t section_;
+    std::vector<Symbol>& out_;
+    std::vector<Token> toks_;
+
+    std::string container_;        // class or protocol between @interface/@protocol and @end
+    std::size_t container_sym_ = 0; // its index in out_, +1; 0 when none
+};
+
+// Index of the token ending the C statement that starts at `i`: its ';', the
+// '}' of a function body, or an Objective-C keyword that interrupts it. A '{'
+// outside typedefs, aggregates and initializers opens a function body.
+std::size_t Parser::statement_end(std::size_t i) const {
+    bool aggregate = false;
+    for (; i < size(); ++i) {
+        if (at_keyword(i))
+            return i;
+        std::string_view s = str(i);
+        if (s == ";")
+            return i;
+        if (s == "typedef" || s == "struct" || s == "union" || s == "enum" || is_enum_macro(s))
+            aggregate = true;
+        if (s == "(" || s == "[") {
+            i = skip_group(i) - 1;
+        } else if (s == "{") {
+            std::size_t close = skip_group(i);
+            if (!aggregate && !punct(i - 1, '='))
+                return close - 1;
+            i = close - 1;
+        } else if (s == "}") {
+            return i;
+        }
+    }
+    return size();
+}
+
+void Parser::emit(std::string name, std::string parent, SymbolKind kind, std::size_t first, std::size_t last) {
+    if (name.empty())
+        return;
+    Symbol sym;
+    sym.name = std::move(name);
+    sym.parent = std::move(parent);
+    sym.kind = kind;
+    sym.section = section_;
+    std::size_t begin = toks_[first].offset;
+    std::size_t end = end_of(std::min(last, size() - 1));
+    sym.offset = base_ + begin;
+    sym.length = static_cast<std::uint32_t>(end - begin);
+    out_.push_back(std::move(sym));
+}
+
+void Parser::run() {
+    std::size_t i = 0;
+    std::size_t pending = size();  // first token of attributes preceding an @keyword
+    while (i < size()) {
+        std::string_view s = str(i);
+        std::size_t start = pending < i ? pending : i;
+        pending = size();
+
+        if (s == "@interface") {
+            i = parse_interface(i, start);
+        } else if (s == "@protocol") {
+            i = parse_protocol(i, start);
+        } else if (s == "@end") {
+            if (container_sym_) {
+                Symbol& sym = out_[container_sym_ - 1];
+                sym.length = static_cast<std::uint32_t>(base_ + end_of(i) - sym.offset);
+            }
+            container_.clear();
+            container_sym_ = 0;
+            ++i;
+        } else if (s == "@property") {
+            i = parse_property(i);
+        } else if (s == "@class" || s == "@compatibility_alias") {
+            while (i < size() && !punct(i, ';'))
+                ++i;
+            ++i;
+        } else if (at_keyword(i)) {
+            ++i;  // @optional, @required, @public, ...
+        } else if (!container_.empty() && (punct(i, '-') || punct(i, '+'))) {
+            i = parse_method(i);
+        } else if (!container_.empty() && is_macro_name(s) && (punct(i + 1, '-') || punct(i + 1, '+'))) {
+            ++i;  // a declaration macro without ';', such as AV_INIT_UNAVAILABLE
+        } else if (punct(i, ';') || punct(i, '}')) {
+            ++i;
+        } else if (punct(i, '{')) {
+            i = skip_group(i);  // instance variables
+        } else if (s == "extern" && i + 2 < size() && toks_[i + 1].kind == Tok::String && punct(i + 2, '{')) {
+            i += 3;  // extern "C" {
+        } else if (s == "namespace" && ident(i + 1) && punct(i + 2, '{')) {
+            i += 3;
+        } else if (is_bracketing_macro(s)) {
+            i = punct(i + 1, '(') ? skip_group(i + 1) : i + 1;
+        } else {
+            std::size_t end = statement_end(i);
+            if (end < size() && at_keyword(end)) {
+                pending = i;  // attributes of the @interface/@protocol that follows
+                i = end;
+                continue;
+            }
+            parse_statement(i, std::min(end, size() - 1));
+            i = end + 1;
+        }
+    }
+}
+
+std::size_t Parser::parse_interface(std::size_t i, std::size_t start) {
+    std::size_t at = i++;
+    if (!ident(i))
+        return i;
+    std::string name(str(i++));
+    if (str(i) == "<")
+        i = skip_angles(i);
+
+    std::string parent;
+    SymbolKind kind = SymbolKind::Interface;
+    std::string symbol = name;
+    if (punct(i, ':') && ident(i + 1)) {
+        parent = std::string(str(i + 1));
+        i += 2;
+        if (str(i) == "<")
+            i = skip_angles(i);
+    } else if (punct(i, '(')) {
+        kind = SymbolKind::Category;
+        std::string category = ident(i + 1) ? std::string(str(i + 1)) : std::string();
+        symbol = name + "(" + category + ")";
+        parent = name;
+        i = skip_group(i);
+    }
+    if (str(i) == "<")
+        i = skip_angles(i);
+
+    emit(symbol, parent, kind, start, i > at ? i - 1 : at);
+    container_ = name;
+    container_sym_ = out_.size();
+    return i;
+}
+
+std::size_t Parser::parse_protocol(std::size_t i, std::size_t start) {
+    std::size_t at = i++;
+    if (!ident(i))
+        return i;
+    // Forward declarations: @protocol A, B;
+    if (punct(i + 1, ';') || punct(i + 1, ',')) {
+        while (i < size() && !punct(i, ';'))
+            ++i;
+        return i + 1;
+    }
+    std::string name(str(i++));
+    if (str(i) == "<")
+        i = skip_angles(i);
+    emit(name, {}, SymbolKind::Protocol, start, i > at ? i - 1 : at);
+    container_ = name;
+    container_sym_ = out_.size();
+    return i;
+}
+
+std::size_t Parser::parse_method(std::size_t i) {
+    std::size_t first = i;
+    SymbolKind kind = punct(i, '+') ? SymbolKind::ClassMethod : SymbolKind::InstanceMethod;
+    std::size_t end = statement_end(i);
+    ++i;
+    if (punct(i, '('))
+        i = skip_group(i);
+
+    std::string selector;
+    if (ident(i) && !punct(i + 1, ':')) {
+        selector = std::string(str(i));
+    } else {
+        while (i < end) {
+            if (ident(i) && punct(i + 1, ':')) {
+                selector.append(str(i)).push_back(':');
+                i += 2;
+            } else if (punct(i, ':')) {
+                selector.push_back(':');
+                ++i;
+            } else {
+                break;
+            }
+            if (punct(i, '('))
+                i = skip_group(i);
+            if (ident(i) && !punct(i + 1, ':'))
+                ++i;
+        }
+    }
+    emit(selector, container_, kind, first, std::min(end, size() - 1));
+    return end < size() && at_keyword(end) ? end : end + 1;
+}
+
+std::size_t Parser::parse_property(std::size_t i) {
+    std::size_t first = i++;
+    if (punct(i, '('))
+        i = skip_group(i);
+    std::size_t end = statement_end(i);
+    emit(declarator_name(i, end), container_, SymbolKind::Property, first, std::min(end, size() - 1));
+    return end < size() && at_keyword(end) ? end : end + 1;
+}
+
+// Pointer qualifiers that may sit between a declarator's '*' or '^' and its
+// name: (^ _Nullable handler), (* const __nonnull fn).
+bool is_pointer_qualifier(std::string_view s) {
+    return s == "const" || s == "volatile" || s == "restrict" || s == "_Nullable" || s == "_Nonnull" ||
+           s == "_Null_unspecified" || is_macro_name(s);
+}
+
+// Name declared by the declarator tokens [i, last): X in a parenthesized
+// (*X) or (^X) declarator, including (AL_APIENTRY *X); else the last
+// identifier that is not an attribute macro or inside a macro call or array
+// bound. An identifier followed by a parameter list names a function type
+// (typedef void NSUncaughtExceptionHandler(NSException *)).
+std::string Parser::declarator_name(std::size_t i, std::size_t last) const {
+    std::string name;
+    while (i < last) {
+        if (punct(i, '(')) {
+            std::size_t j = i + 1;
+            while (j < last && ident(j) && is_macro_name(str(j)))
+                ++j;
+            if (punct(j, '*') || punct(j, '^')) {
+                while (j < last && (punct(j, '*') || punct(j, '^') || (ident(j) && is_pointer_qualifier(str(j)))))
+                    ++j;
+                if (ident(j) && punct(j + 1, ')'))
+                    return std::string(str(j));
+            }
+            i = skip_group(i);
+        } else if (punct(i, '[')) {
+            i = skip_group(i);
+        } else if (ident(i) && !is_macro_name(str(i)) && !is_c_keyword(str(i))) {
+            name = std::string(str(i++));
+        } else {
+            ++i;
+        }
+    }
+    return name;
+}
+
+void Parser::parse_enum_body(std::size_t open, const std::string& parent) {
+    std::size_t close = skip_group(open) - 1;
+    std::size_t i = open + 1;
+    while (i < close) {
+        std::size_t item = i;
+        while (i < close && !punct(i, ',')) {
+            if (punct(i, '(') || punct(i, '{') || punct(i, '['))
+                i = skip_group(i);
+            else
+                ++i;
+        }
+        if (ident(item) && !is_macro_name(str(item)))
+            emit(std::string(str(item)), parent, SymbolKind::EnumConstant, item, i - 1);
+        ++i;
+    }
+}
+
+void Parser::parse_typedef(std::size_t first, std::size_t i, std::size_t last) {
+    std::string_view s = str(i);
+
+    if (is_enum_macro(s) && punct(i + 1, '(')) {
+        std::size_t args_end = skip_group(i + 1);
+        std::string name;
+        std::size_t idents = 0;
+        for (std::size_t j = i + 2; j + 1 < args_end; ++j)
+            if (ident(j)) {
+                name = std::string(str(j));
+                ++idents;
+            }
+        std::size_t j = args_end;
+        while (j < last && !punct(j, '{'))
+            ++j;
+        if (idents < 2 || name.empty())
+            name = declarator_name(j < last ? skip_group(j) : args_end, last);
+        emit(name, {}, SymbolKind::Enum, first, last);
+        if (j < last)
+            parse_enum_body(j, name);
+        return;
+    }
+
+    if (s == "enum" || s == "struct" || s == "union") {
+        std::size_t j = i + 1;
+        std::string tag = ident(j) ? std::string(str(j)) : std::string();
+        while (j < last && !punct(j, '{') && !punct(j, ';'))
+            ++j;
+        if (punct(j, '{')) {
+            std::size_t after = skip_group(j);
+            std::string name = declarator_name(after, last);
+            bool pointer = punct(after, '*');
+            if (s == "enum") {
+                std::string enum_name = pointer || name.empty() ? tag : name;
+                emit(enum_name, {}, SymbolKind::Enum, first, last);
+                parse_enum_body(j, enum_name);
+            } else {
+                SymbolKind kind = s == "struct" ? SymbolKind::Struct : SymbolKind::Union;
+                if (pointer) {
+                    emit(tag, {}, kind, first, last);
+                    emit(name, {}, SymbolKind::Typedef, first, last);
+                } else {
+                    emit(name.empty() ? tag : name, {}, kind, first, last);
+                }
+            }
+            return;
+        }
+    }
+
+    emit(declarator_name(i, last), {}, SymbolKind::Typedef, first, last);
+}
+
+void Parser::parse_statement(std::size_t first, std::size_t last) {
+    // Skip leading attribute macros such as API_AVAILABLE(...) and CF_INLINE.
+    std::size_t i = first;
+    while (i < last && ident(i) && is_macro_name(str(i)) && !is_enum_macro(str(i)) && !is_export_macro(str(i)))
+        i = punct(i + 1, '(') ? skip_group(i + 1) : i + 1;
+    if (i >= last && !punct(last, '}'))
+        return;
+
+    std::string_view s = str(i);
+    if (s == "typedef") {
+        parse_typedef(first, i + 1, last);
+        return;
+    }
+    if (s == "template" || s == "using" || s == "static_assert" || s == "_Static_assert")
+        return;
+
+    // Tagged definitions: enum X {...}; struct X {...}; NS_ENUM(T, X) {...};
+    if (is_enum_macro(s) || s == "enum" || s == "struct" || s == "union") {
+        std::size_t open = i + 1;
+        while (open < last && !punct(open, '{') && !punct(open, ';'))
+            ++open;
+        if (punct(open, '{')) {
+            if (is_enum_macro(s)) {
+                parse_typedef(first, i, last);
+                return;
+            }
+            std::string tag = ident(i + 1) ? std::string(str(i + 1)) : std::string();
+            if (s == "enum") {
+                emit(tag, {}, SymbolKind::Enum, first, last);
+                parse_enum_body(open, tag);
+            } else {
+                emit(tag, {}, s == "struct" ? SymbolKind::Struct : SymbolKind::Union, first, last);
+            }
+            return;
+        }
+    }
+
+    // Functions: the first call-like group whose name is not a macro, unless it
+    // is a parenthesized declarator such as (*callback) or (^block). A name
+    // built by a macro, as in _SPARSE_VARIANT(_SparseSolveOpaque)(...), is
+    // taken from the macro argument; an all-caps name such as
+    // UI_USER_INTERFACE_IDIOM() is accepted for definitions when nothing else
+    // qualifies.
+    bool exported = false;
+    std::size_t fallback = 0;
+    for (std::size_t j = i; j < last && !punct(j, '{'); ++j) {
+        if (str(j) == "operator")
+            return;
+        if (ident(j) && is_export_macro(str(j)))
+            exported = true;
+        if (!punct(j, '('))
+            continue;
+        if (j > i && ident(j - 1) && !is_macro_name(str(j - 1)) && !punct(j + 1, '*') && !punct(j + 1, '^')) {
+            emit(std::string(str(j - 1)), {}, SymbolKind::Function, first, last);
+            return;
+        }
+        if (punct(j + 1, '*') || punct(j + 1, '^'))
+            break;
+        std::size_t after = skip_group(j);
+        if (j > i && ident(j - 1) && !is_attribute_macro(str(j - 1))) {
+            if (punct(after, '(') && after == j + 3 && ident(j + 1)) {
+                emit(std::string(str(j + 1)), {}, SymbolKind::Function, first, last);
+                return;
+            }
+            if (!fallback)
+                fallback = j - 1;
+        }
+        j = after - 1;
+    }
+    if (fallback && punct(last, '}')) {
+        emit(std::string(str(fallback)), {}, SymbolKind::Function, first, last);
+        return;
+    }
+
+    if (exported) {
+        std::string name = declarator_name(i, last);
+        if (!is_c_keyword(name))
+            emit(std::move(name), {}, SymbolKind::Variable, first, last);
+    }
+}
+
+} // namespace
+
+const char* kind_name(SymbolKind kind) { return kKindNames[static_cast<int>(kind)]; }
+
+bool parse_kind(std::string_view name, SymbolKind& kind) {
+    for (int k = 0; k < kSymbolKindCount; ++k) {
+        if (name == kKindNames[k]) {
+            kind = static_cast<SymbolKind>(k);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool is_macro_name(std::string_view s) {
+    if (s.size() < 2)
+        return false;
+    if (s == "_Pragma")
+        return true;
+    // Compiler keywords (__attribute__, __kindof, __nullable, ...) count as
+    // attributes; other reserved names such as __gss_c_nt_user_name_oid_desc
+    // are ordinary identifiers.
+    if (s[0] == '_' && s[1] == '_' &&
+        (ends_with(s, "__") || std::find(std::begin(kCompilerKeywords), std::end(kCompilerKeywords), s) !=
+                                   std::end(kCompilerKeywords)))
+        return true;
+    bool underscore = false;
+    for (char c : s) {
+        if (c >= 'a' && c <= 'z')
+            return false;
+        underscore |= c == '_';
+    }
+    return underscore;
+}
+
+namespace {
+
+// Identifiers of the <...> group at toks[i], and whether it holds types rather
+// than bare names (a '*' or a nested group). Returns the index past it.
+std::size_t angle_names(std::string_view text, const std::vector<Token>& toks, std::size_t i, std::size_t last,
+                        std::vector<std::string>& names, bool& typed) {
+    std::size_t end = skip_angles(text, toks, i, last);
+    typed = false;
+    for (++i; i < end; ++i) {
+        std::string_view s = token_text(text, toks[i]);
+        if (s == "<" || s == "*")
+            typed = true;
+        else if (toks[i].kind == Tok::Ident && s != "__covariant" && s != "__contravariant" && !is_macro_name(s))
+            names.emplace_back(s);
+    }
+    return end;
+}
+
+} // namespace
+
+UnitHeader read_unit_header(std::string_view text, const std::vector<Token>& toks, std::size_t i, std::size_t last) {
+    auto str = [&](std::size_t k) { return k < last ? token_text(text, toks[k]) : std::string_view(); };
+    auto punct = [&](std::size_t k, char c) { return k < last && is_punct(text, toks[k], c); };
+    while (i < last && str(i) != "@interface" && str(i) != "@protocol")
+        ++i;
+    bool protocol = str(i) == "@protocol";
+    i += 2;
+    UnitHeader header;
+    std::vector<std::string> params, names;
+    bool typed = false;
+    if (!protocol && str(i) == "<") {
+        std::size_t after = angle_names(text, toks, i, last, params, typed);
+        if (punct(after, ':') || punct(after, '('))
+            i = after;
+        else
+            params.clear();
+    }
+    if (!protocol && punct(i, ':') && i + 1 < last && toks[i + 1].kind == Tok::Ident) {
+        header.super = std::string(str(i + 1));
+        i += 2;
+        // Superclass type arguments, told from a protocol list by a '*', a
+        // generic parameter or a protocol list following them.
+        if (str(i) == "<") {
+            std::vector<std::string> args;
+            std::size_t after = angle_names(text, toks, i, last, args, typed);
+            bool type_args = typed || str(after) == "<" ||
+                             std::any_of(args.begin(), args.end(), [&](const std::string& a) {
+                                 return std::find(params.begin(), params.end(), a) != params.end();
+                             });
+            if (type_args)
+                i = after;
+        }
+    } else if (!protocol && punct(i, '(')) {
+        i = skip_group(text, toks, i, last);
+    }
+    if (str(i) == "<")
+        angle_names(text, toks, i, last, names, typed);
+    for (std::string& n : names)
+        if (std::find(header.protocols.begin(), header.protocols.end(), n) == header.protocols.end())
+            header.protocols.push_back(std::move(n));
+    return header;
+}
+
+void extract_symbols(std::string_view text, std::uint64_t base, std::uint32_t section,
+                     std::vector<Symbol>& out) {
+    Parser(text, base, section, out).run();
+}
+
+} // namespace moby
@@ -0,0 +1,451 @@
+#include "moby/trigram_index.h"
+
+#include "moby/section_index.h"
+#include "moby/work_pool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <numeric>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+namespace {
+
+struct TrigramLayout {
+    std::uint64_t section_count;
+    std::uint64_t trigram_count;
+    std::uint64_t entries;
+    std::uint64_t postings;
+    std::uint64_t posting_bytes;
+};
+
+// Distinct trigram keys of `text`, in order of first occurrence. Duplicates
+// are dropped with a per-thread bitmap over all 2^24 keys, cleared again bit
+// by bit afterwards, which is cheaper than sorting every section's keys.
+void section_trigrams(std::string_view text, std::vector<std::uint32_t>& out) {
+    thread_local std::vector<std::uint64_t> seen(std::size_t(1) << 18);
+    out.clear();
+    if (text.size() < 3)
+        return;
+    const auto* p = reinterpret_cast<const unsigned char*>(text.data());
+    std::uint32_t key = trigram_key(0, p[0], p[1]);
+    for (std::size_t i = 2; i < text.size(); ++i) {
+        key = (key << 8 | fold_ascii(p[i])) & 0xFFFFFF;
+        // Trigrams spanning a line break can never be part of a match.
+        if ((key & 0xFF00) == 0x0A00 || (key & 0xFF) == 0x0A)
+            continue;
+        std::uint64_t bit = std::uint64_t(1) << (key & 63);
+        if (seen[key >> 6] & bit)
+            continue;
+        seen[key >> 6] |= bit;
+        out.push_back(key);
+    }
+    for (std::uint32_t k : out)
+        seen[k >> 6] = 0;
+}
+
+// Stable LSD radix sort of (key << 32 | section) pairs on the 24-bit key, one
+// byte per pass; pairs arrive in section order, so each posting list comes
+// out ascending without comparing sections.
+void radix_sort_by_key(std::vector<std::uint64_t>& pairs) {
+    std::vector<std::uint64_t> scratch(pairs.size());
+    for (unsigned shift = 32; shift < 56; shift += 8) {
+        std::size_t offsets[256] = {};
+        for (std::uint64_t pair : pairs)
+            ++offsets[pair >> shift & 0xFF];
+        std::size_t sum = 0;
+        for (std::size_t& o : offsets)
+            sum += std::exchange(o, sum);
+        for (std::uint64_t pair : pairs)
+            scratch[offsets[pair >> shift & 0xFF]++] = pair;
+        pairs.swap(scratch);
+    }
+}
+
+TrigramQuery and_of(std::vector<TrigramQuery> children) {
+    TrigramQuery q;
+    q.op = TrigramQuery::Op::And;
+    for (TrigramQuery& c : children) {
+        if (c.op == TrigramQuery::Op::All)
+            continue;
+        if (c.op == TrigramQuery::Op::And) {
+            q.trigrams.insert(q.trigrams.end(), c.trigrams.begin(), c.trigrams.end());
+            for (TrigramQuery& grandchild : c.children)
+                q.children.push_back(std::move(grandchild));
+        } else {
+            q.children.push_back(std::move(c));
+        }
+    }
+    if (q.trigrams.empty() && q.children.empty())
+        return {};
+    if (q.trigrams.empty() && q.children.size() == 1)
+        return std::move(q.children[0]);
+    std::sort(q.trigrams.begin(), q.trigrams.end());
+    q.trigrams.erase(std::unique(q.trigrams.begin(), q.trigrams.end()), q.trigrams.end());
+    return q;
+}
+
+TrigramQuery or_of(std::vector<TrigramQuery> children) {
+    TrigramQuery q;
+    q.op = TrigramQuery::Op::Or;
+    for (TrigramQuery& c : children) {
+        // One unconstrained branch makes the whole alternation unconstrained.
+        if (c.op == TrigramQuery::Op::All)
+            return {};
+        q.children.push_back(std::move(c));
+    }
+    if (q.children.size() == 1)
+        return std::move(q.children[0]);
+    return q;
+}
+
+TrigramQuery literal_query(std::string_view s) {
+    TrigramQuery q;
+    if (s.size() < 3)
+        return q;
+    q.op = TrigramQuery::Op::And;
+    for (std::size_t i = 0; i + 3 <= s.size(); ++i)
+        q.trigrams.push_back(trigram_key(s[i], s[i + 1], s[i + 2]));
+    return and_of({std::move(q)});
+}
+
+// Recursive descent over the ECMAScript syntax std::regex accepts. Each
+// concatenation collects runs of plain characters; a run of three or more
+// bytes contributes its trigrams, and outside groups and alternations every
+// run, however short, is a literal each match contains. Anything that is not a plain character
+// (classes, '.', escapes such as \w, anchors, groups) ends the current run,
+// and an atom that may repeat zero times contributes nothing.
+class RegexAnalyzer {
+public:
+    explicit RegexAnalyzer(std::string_view pattern) : p_(pattern) {}
+
+    RegexAnalysis run() {
+        RegexAnalysis out;
+        out.query = alternation(0);
+        out.literal = literal_ && pos_ == p_.size();
+        if (!top_alternation_) {
+            std::stable_sort(runs_.begin(), runs_.end(),
+                             [](const std::string& a, const std::string& b) { return a.size() > b.size(); });
+            out.required = std::move(runs_);
+        }
+        return out;
+    }
+
+private:
+    struct Atom {
+        bool is_char = false;
+        char c = 0;
+        TrigramQuery query;
+    };
+
+    bool at_end() const { return pos_ >= p_.size(); }
+    char peek() const { return p_[pos_]; }
+
+    TrigramQuery alternation(int depth) {
+        std::vector<TrigramQuery> branches;
+        branches.push_back(concatenation(depth));
+        while (!at_end() && peek() == '|') {
+            ++pos_;
+            literal_ = false;
+            if (depth == 0)
+                top_alternation_ = true;
+            branches.push_back(concatenation(depth));
+        }
+        return or_of(std::move(branches));
+    }
+
+    TrigramQuery concatenation(int depth) {
+        std::vector<TrigramQuery> parts;
+        std::string run;
+        auto flush = [&] {
+            if (depth == 0 && !run.empty())
+                runs_.push_back(run);
+            parts.push_back(literal_query(run));
+            run.clear();
+        };
+        while (!at_end() && peek() != '|' && peek() != ')') {
+            Atom a = atom(depth);
+            std::size_t min_repeat = 1;
+            if (quantifier(min_repeat)) {
+                literal_ = false;
+                if (a.is_char && min_repeat > 0)
+                    run += a.c;
+                flush();
+                if (!a.is_char && min_repeat > 0)
+                    parts.push_back(std::move(a.query));
+                continue;
+            }
+            if (a.is_char) {
+                run += a.c;
+                continue;
+            }
+            flush();
+            parts.push_back(std::move(a.query));
+        }
+        flush();
+        return and_of(std::move(parts));
+    }
+
+    // Consumes a quantifier, if any, and reports its minimum count.
+    bool quantifier(std::size_t& min_repeat) {
+        if (at_end())
+            return false;
+        char c = peek();
+        if (c == '*' || c == '?') {
+            min_repeat = 0;
+        } else if (c == '+') {
+            min_repeat = 1;
+        } else if (c == '{' && pos_ + 1 < p_.size() && std::isdigit(static_cast<unsigned char>(p_[pos_ + 1]))) {
+            std::size_t close = p_.find('}', pos_);
+            if (close == std::string_view::npos)
+                return false;
+            min_repeat = std::strtoul(std::string(p_.substr(pos_ + 1, close - pos_ - 1)).c_str(), nullptr, 10);
+            pos_ = close;
+        } else {
+            return false;
+        }
+        ++pos_;
+        if (!at_end() && peek() == '?')  // lazy
+            ++pos_;
+        return true;
+    }
+
+    Atom atom(int depth) {
+        Atom a;
+        char c = p_[pos_++];
+        switch (c) {
+        case '(': {
+            literal_ = false;
+            bool lookahead = p_.substr(pos_, 2) == "?=" || p_.substr(pos_, 2) == "?!";
+            if (lookahead || p_.substr(pos_, 2) == "?:")
+                pos_ += 2;
+            TrigramQuery inner = alternation(depth + 1);
+            if (!at_end() && peek() == ')')
+                ++pos_;
+            // A lookahead consumes nothing and may be negative; it never constrains.
+            if (!lookahead)
+                a.query = std::move(inner);
+            return a;
+        }
+        case '[':
+            literal_ = false;
+            if (!at_end() && peek() == '^')
+                ++pos_;
+            if (!at_end() && peek() == ']')
+                ++pos_;
+            while (!at_end() && peek() != ']')
+                pos_ += peek() == '\\' ? 2 : 1;
+            if (!at_end())
+                ++pos_;
+            return a;
+        case '.':
+        case '^':
+        case '$':
+            literal_ = false;
+            return a;
+        case '\\':
+            if (at_end())
+                return a;
+            c = p_[pos_++];
+            if (std::isalnum(static_cast<unsigned char>(c))) {
+                literal_ = false;
+                // No indexed trigram spans a line break, so a newline stays unknown.
+                int value = escape_value(c);
+                if (value >= 0 && value != '\n') {
+                    a.is_char = true;
+                    a.c = static_cast<char>(value);
+                }
+                return a;
+            }
+            literal_ = false;
+            a.is_char = true;
+            a.c = c;
+            return a;
+        default:
+            a.is_char = true;
+            a.c = c;
+            return a;
+        }
+    }
+
+    // Character an alphanumeric escape `\c` stands for, consuming its operand
+    // (\xHH, \uHHHH, \cX, the digits of \12); -1 for a class such as \d, a
+    // backreference, an assertion such as \b, or a character outside ASCII.
+    int escape_value(char c) {
+        switch (c) {
+        case 't': return '\t';
+        case 'n': return '\n';
+        case 'r': return '\r';
+        case 'f': return '\f';
+        case 'v': return '\v';
+        case 'x':
+        case 'u': {
+            std::size_t digits = c == 'x' ? 2 : 4;
+            if (p_.size() - pos_ < digits)
+                return -1;
+            int value = 0;
+            for (std::size_t i = 0; i < digits; ++i) {
+                unsigned char h = static_cast<unsigned char>(p_[pos_ + i]);
+                if (!std::isxdigit(h))
+                    return -1;
+                value = value * 16 + (std::isdigit(h) ? h - '0' : (h | 0x20) - 'a' + 10);
+            }
+            pos_ += digits;
+            return value < 0x80 ? value : -1;
+        }
+        case 'c':
+            if (at_end() || !std::isalpha(static_cast<unsigned char>(peek())))
+                return -1;
+            return p_[pos_++] % 32;
+        default:
+            while (std::isdigit(static_cast<unsigned char>(c)) && !at_end() &&
+                   std::isdigit(static_cast<unsigned char>(peek())))
+                ++pos_;
+            return -1;
+        }
+    }
+
+    std::string_view p_;
+    std::size_t pos_ = 0;
+    std::vector<std::string> runs_;
+    bool literal_ = true;
+    bool top_alternation_ = false;
+};
+
+} // namespace
+
+RegexAnalysis analyze_regex(std::string_view pattern, bool fixed) {
+    if (fixed) {
+        RegexAnalysis out;
+        out.query = literal_query(pattern);
+        if (!pattern.empty())
+            out.required.emplace_back(pattern);
+        out.literal = true;
+        return out;
+    }
+    return RegexAnalyzer(pattern).run();
+}
+
+std::string TrigramIndex::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "trigrams.idx").string();
+}
+
+void TrigramIndex::build(const Corpus& corpus, const std::string& path, unsigned threads) {
+    const auto& sections = corpus.sections();
+    std::vector<std::vector<std::uint32_t>> keys(sections.size());
+    std::vector<std::uint32_t> tasks(sections.size());
+    std::iota(tasks.begin(), tasks.end(), 0);
+    std::stable_sort(tasks.begin(), tasks.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return sections[a].length > sections[b].length; });
+    run_stealing(tasks, threads, [&](std::uint32_t i) { section_trigrams(sections[i].text, keys[i]); });
+
+    // (key, section) pairs in section order.
+    std::vector<std::uint64_t> pairs;
+    std::size_t total = 0;
+    for (const auto& k : keys)
+        total += k.size();
+    pairs.reserve(total);
+    for (std::uint32_t s = 0; s < keys.size(); ++s)
+        for (std::uint32_t key : keys[s])
+            pairs.push_back(std::uint64_t(key) << 32 | s);
+    radix_sort_by_key(pairs);
+
+    std::vector<Entry> entries;
+    std::string postings;
+    std::uint32_t previous = 0;
+    for (std::uint64_t pair : pairs) {
+        std::uint32_t key = static_cast<std::uint32_t>(pair >> 32), section = static_cast<std::uint32_t>(pair);
+        if (entries.empty() || entries.back().key != key) {
+            entries.push_back({key, 0, postings.size()});
+            previous = 0;
+        }
+        put_varint(postings, section - previous);
+        previous = section;
+        ++entries.back().count;
+    }
+
+    BlobWriter w(kMagic, kVersion, moby::corpus_hash(corpus));
+    std::size_t layout_at = w.put(TrigramLayout{});
+    TrigramLayout layout{};
+    layout.section_count = sections.size();
+    layout.trigram_count = entries.size();
+    layout.entries = w.put_array(entries);
+    layout.postings = w.put_bytes(postings.data(), postings.size());
+    layout.posting_bytes = postings.size();
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+}
+
+TrigramIndex::TrigramIndex(const std::string& path) : reader_(path, kMagic, kVersion) {
+    const TrigramLayout& l = *reader_.array<TrigramLayout>(sizeof(BlobHeader), 1);
+    trigram_count_ = l.trigram_count;
+    section_count_ = l.section_count;
+    posting_bytes_ = l.posting_bytes;
+    entries_ = reader_.array<Entry>(l.entries, l.trigram_count);
+    postings_ = reinterpret_cast<const unsigned char*>(reader_.bytes(l.postings, l.posting_bytes).data());
+    for (std::uint64_t i = 0; i < trigram_count_; ++i)
+        if (entries_[i].offset + entries_[i].count > posting_bytes_)
+            throw Error(path + ": posting list out of bounds");
+}
+
+const TrigramIndex::Entry* TrigramIndex::lookup(std::uint32_t key) const {
+    const Entry* e = std::lower_bound(entries_, entries_ + trigram_count_, key,
+                                      [](const Entry& entry, std::uint32_t k) { return entry.key < k; });
+    return e != entries_ + trigram_count_ && e->key == key ? e : nullptr;
+}
+
+std::size_t TrigramIndex::posting_count(std::uint32_t key) const {
+    const Entry* e = lookup(key);
+    return e ? e->count : 0;
+}
+
+Bitset TrigramIndex::postings(std::uint32_t key) const {
+    Bitset out(section_count_);
+    const Entry* e = lookup(key);
+    if (!e)
+        return out;
+    const unsigned char* p = postings_ + e->offset;
+    std::uint64_t section = 0;
+    for (std::uint32_t i = 0; i < e->count; ++i) {
+        section += get_varint(p);
+        out.set(section);
+    }
+    return out;
+}
+
+Bitset TrigramIndex::candidates(const TrigramQuery& query) const {
+    switch (query.op) {
+    case TrigramQuery::Op::All:
+        return Bitset(section_count_, true);
+    case TrigramQuery::Op::And: {
+        // Rarest trigram first, so the set shrinks early and often empties.
+        std::vector<std::uint32_t> keys = query.trigrams;
+        std::sort(keys.begin(), keys.end(),
+                  [&](std::uint32_t a, std::uint32_t b) { return posting_count(a) < posting_count(b); });
+        Bitset out(section_count_, true);
+        for (std::uint32_t key : keys) {
+            out &= postings(key);
+            if (out.count() == 0)
+                return out;
+        }
+        for (const TrigramQuery& child : query.children)
+            out &= candidates(child);
+        return out;
+    }
+    case TrigramQuery::Op::Or: {
+        Bitset out(section_count_);
+        for (const TrigramQuery& child : query.children)
+            out |= candidates(child);
+        return out;
+    }
+    }
+    return Bitset(section_count_, true);
+}
+
+} // namespace moby
@@ -0,0 +1,436 @@
+#include "moby/type_graph.h"
+
+#include "moby/hash.h"
+#include "moby/lexer.h"
+#include "moby/perfect_hash.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace moby {
+namespace {
+
+struct TypeGraphLayout {
+    std::uint64_t type_count;
+    std::uint64_t decl_count;
+    std::uint64_t framework_count;
+    std::uint64_t buckets, slot_count;
+    std::uint64_t reverse_bytes;
+    std::uint64_t forward_bytes;
+    std::uint64_t types;
+    std::uint64_t decl_offsets;
+    std::uint64_t frameworks;
+    std::uint64_t framework_names;
+    std::uint64_t displacements, slots;
+    std::uint64_t reverse;
+    std::uint64_t forward;
+    std::uint64_t strings;
+    std::uint64_t strings_size;
+};
+
+// How a type is written when passed by value: an Objective-C class behind
+// one '*', a protocol, CF "Ref" or other pointer typedef bare, anything else
+// (structs, enums, scalars) bare with no pointer at all.
+enum class Shape : std::uint8_t { Plain, Object, Reference };
+
+struct TypeInfo {
+    std::uint32_t id;
+    Shape shape;
+};
+
+bool is_qualifier(std::string_view w) {
+    return w == "const" || w == "volatile" || w == "_Nullable" || w == "_Nonnull" || w == "_Null_unspecified" ||
+           w == "nullable" || w == "nonnull" || w == "__kindof" || w == "restrict";
+}
+
+// C keywords a misread declaration can leave as a typedef name.
+bool is_keyword(std::string_view w) {
+    constexpr std::string_view kWords[] = {"void", "int", "char", "short", "long", "float", "double",
+                                           "signed", "unsigned", "const", "struct", "union", "enum"};
+    return std::find(std::begin(kWords), std::end(kWords), w) != std::end(kWords);
+}
+
+std::uint8_t swap_roles(std::uint8_t r) {
+    return static_cast<std::uint8_t>((r & TypeUse::kConsumes) << 1 | (r & TypeUse::kProduces) >> 1);
+}
+
+class UseCollector {
+public:
+    UseCollector(const std::unordered_map<std::string_view, TypeInfo>& types) : types_(types) {}
+
+    // Adds the types named in `type` with `base` roles, flipped inside block
+    // and function pointer parameter lists. `self` stands in for instancetype.
+    void add(std::string_view type, std::uint8_t base, std::string_view self, std::map<std::uint32_t, std::uint8_t>& out) const;
+
+private:
+    const std::unordered_map<std::string_view, TypeInfo>& types_;
+};
+
+void UseCollector::add(std::string_view s, std::uint8_t base, std::string_view self,
+                       std::map<std::uint32_t, std::uint8_t>& out) const {
+    // Open parentheses: declarators "(^" and "(*", and the parameter lists
+    // that follow them.
+    struct Frame {
+        bool declarator;
+        bool params;
+    };
+    std::vector<Frame> open;
+    bool after_declarator = false, is_const = false;
+    int flips = 0, angles = 0;
+    for (std::size_t i = 0; i < s.size();) {
+        char c = s[i];
+        if (c == '(') {
+            std::size_t j = i + 1;
+            while (j < s.size() && s[j] == ' ')
+                ++j;
+            bool declarator = j < s.size() && (s[j] == '^' || s[j] == '*');
+            bool params = !declarator && after_declarator;
+            open.push_back({declarator, params});
+            flips += params;
+            after_declarator = false;
+            ++i;
+            continue;
+        }
+        if (c == ')') {
+            after_declarator = !open.empty() && open.back().declarator;
+            if (!open.empty()) {
+                flips -= open.back().params;
+                open.pop_back();
+            }
+            ++i;
+            continue;
+        }
+        if (!is_ident_start(c)) {
+            angles += (c == '<') - (c == '>');
+            if (c != ' ')
+                after_declarator = false;
+            ++i;
+            continue;
+        }
+        std::size_t start = i;
+        while (i < s.size() && is_ident_char(s[i]))
+            ++i;
+        std::string_view word = s.substr(start, i - start);
+        after_declarator = false;
+        if (word == "const")
+            is_const = true;
+        if (word == "instancetype")
+            word = self;
+        auto it = types_.find(word);
+        if (it == types_.end())
+            continue;
+        std::uint8_t roles = flips % 2 ? swap_roles(base) : base;
+        // Pointers beyond the way the type is passed by value make an
+        // out-parameter.
+        if (flips == 0 && angles == 0 && base == TypeUse::kConsumes) {
+            int stars = 0;
+            for (std::size_t j = i; j < s.size();) {
+                if (s[j] == '*') {
+                    ++stars;
+                    ++j;
+                } else if (s[j] == ' ') {
+                    ++j;
+                } else if (is_ident_start(s[j])) {
+                    std::size_t k = j;
+                    while (k < s.size() && is_ident_char(s[k]))
+                        ++k;
+                    if (!is_qualifier(s.substr(j, k - j)))
+                        break;
+                    j = k;
+                } else {
+                    break;
+                }
+            }
+            int extra = stars - (it->second.shape == Shape::Object);
+            if (extra > 0 && it->second.shape != Shape::Plain)
+                roles = TypeUse::kProduces;
+            else if (extra > 0 && !is_const)
+                roles = TypeUse::kConsumes | TypeUse::kProduces;
+        }
+        out[it->second.id] |= roles;
+    }
+}
+
+std::string_view framework_of(std::string_view section_path) {
+    return section_path.substr(0, section_path.find(".framework"));
+}
+
+// Appends (id - previous) << 2 | roles for every use.
+void put_uses(std::string& out, const std::vector<TypeUse>& uses) {
+    std::uint32_t previous = 0;
+    for (const TypeUse& u : uses) {
+        put_varint(out, std::uint64_t(u.id - previous) << 2 | u.roles);
+        previous = u.id;
+    }
+}
+
+void get_uses(const unsigned char* p, std::uint64_t count, std::vector<TypeUse>& out) {
+    std::uint32_t id = 0;
+    for (std::uint64_t k = 0; k < count; ++k) {
+        std::uint64_t v = get_varint(p);
+        id += static_cast<std::uint32_t>(v >> 2);
+        out.push_back({id, static_cast<std::uint8_t>(v & 3)});
+    }
+}
+
+} // namespace
+
+std::string TypeGraph::default_path(const std::string& corpus_dir) {
+    return (fs::path(corpus_dir) / ".moby" / "types.graph").string();
+}
+
+TypeGraphStats TypeGraph::build(const DeclCache& decls, const std::string& path) {
+    // Type nodes: every declared type name, in name order.
+    std::map<std::string_view, Shape> shapes;
+    for (std::size_t id = 0; id < decls.size(); ++id) {
+        const DeclRecord& d = decls.at(id);
+        std::string_view name = decls.str(d.name);
+        Shape shape;
+        switch (d.kind) {
+        case SymbolKind::Interface:
+            shape = Shape::Object;
+            break;
+        case SymbolKind::Protocol:
+            shape = Shape::Reference;
+            break;
+        case SymbolKind::Typedef: {
+            std::string_view type = decls.str(d.type);
+            bool pointer = (!type.empty() && type.back() == '*') || type.find("(^") != std::string_view::npos ||
+                           type.find("(*") != std::string_view::npos;
+            shape = pointer || (name.size() > 3 && name.substr(name.size() - 3) == "Ref") ? Shape::Reference
+                                                                                            : Shape::Plain;
+            break;
+        }
+        case SymbolKind::Struct:
+        case SymbolKind::Union:
+        case SymbolKind::Enum:
+            shape = Shape::Plain;
+            break;
+        default:
+            continue;
+        }
+        if (name.empty() || is_keyword(name))
+            continue;
+        // A class also declared as a typedef or protocol keeps its class shape.
+        auto [it, added] = shapes.emplace(name, shape);
+        if (!added && shape == Shape::Object)
+            it->second = shape;
+    }
+    std::unordered_map<std::string_view, TypeInfo> types;
+    std::vector<std::string_view> type_names;
+    for (const auto& [name, shape] : shapes) {
+        types.emplace(name, TypeInfo{static_cast<std::uint32_t>(type_names.size()), shape});
+        type_names.push_back(name);
+    }
+
+    // Forward lists, one declaration at a time.
+    UseCollector collect(types);
+    std::vector<std::vector<TypeUse>> forward(decls.size());
+    std::map<std::uint32_t, std::uint8_t> uses;
+    for (std::uint32_t id = 0; id < decls.size(); ++id) {
+        const DeclRecord& d = decls.at(id);
+        std::string_view self;
+        if (d.parent != kNoDecl) {
+            const DeclRecord& p = decls.at(d.parent);
+            if (p.kind == SymbolKind::Interface)
+                self = decls.str(p.name);
+            else if (p.kind == SymbolKind::Category)
+                self = decls.str(p.type);
+        }
+        uses.clear();
+        switch (d.kind) {
+        case SymbolKind::ClassMethod:
+        case SymbolKind::InstanceMethod:
+        case SymbolKind::Function:
+            collect.add(decls.str(d.type), TypeUse::kProduces, self, uses);
+            for (const DeclPart& part : decls.parts(d))
+                collect.add(decls.str(part.type), TypeUse::kConsumes, self, uses);
+            break;
+        case SymbolKind::Property: {
+            bool readonly = false;
+            for (const DeclPart& part : decls.parts(d))
+                readonly |= decls.str(part.label) == "readonly";
+            std::uint8_t roles = TypeUse::kProduces | (readonly ? 0 : TypeUse::kConsumes);
+            collect.add(decls.str(d.type), roles, self, uses);
+            break;
+        }
+        case SymbolKind::Variable:
+            collect.add(decls.str(d.type), TypeUse::kProduces, self, uses);
+            break;
+        default:
+            break;
+        }
+        for (const auto& [type, roles] : uses)
+            forward[id].push_back({type, roles});
+    }
+
+    // Reverse lists by counting sort on the type.
+    std::vector<std::uint32_t> first(type_names.size() + 1, 0);
+    for (const auto& list : forward)
+        for (const TypeUse& u : list)
+            ++first[u.id + 1];
+    for (std::size_t t = 0; t < type_names.size(); ++t)
+        first[t + 1] += first[t];
+    std::vector<TypeUse> reverse_uses(first.back());
+    std::vector<std::uint32_t> fill(first.begin(), first.end() - 1);
+    for (std::uint32_t id = 0; id < forward.size(); ++id)
+        for (const TypeUse& u : forward[id])
+            reverse_uses[fill[u.id]++] = {id, u.roles};
+
+    StringPool strings;
+    std::vector<TypeNode> nodes(type_names.size());
+    for (TypeNode& n : nodes)
+        n.alias = kNone;
+    for (std::size_t id = 0; id < decls.size(); ++id) {
+        const DeclRecord& d = decls.at(id);
+        if (d.kind != SymbolKind::Typedef)
+            continue;
+        auto from = types.find(decls.str(d.name)), to = types.find(decls.str(d.type));
+        if (from != types.end() && to != types.end() && from != to && nodes[from->second.id].alias == kNone)
+            nodes[from->second.id].alias = to->second.id;
+    }
+    std::string reverse;
+    std::vector<TypeUse> list;
+    for (std::uint32_t t = 0; t < type_names.size(); ++t) {
+        TypeNode& n = nodes[t];
+        n.name = strings.add(type_names[t]);
+        n.offset = reverse.size();
+        n.count = first[t + 1] - first[t];
+        list.assign(reverse_uses.begin() + first[t], reverse_uses.begin() + first[t + 1]);
+        for (const TypeUse& u : list) {
+            n.consumers += (u.roles & TypeUse::kConsumes) != 0;
+            n.producers += (u.roles & TypeUse::kProduces) != 0;
+        }
+        put_uses(reverse, list);
+    }
+    std::string forward_bytes;
+    std::vector<std::uint32_t> decl_offsets;
+    for (const auto& uses_of : forward) {
+        decl_offsets.push_back(static_cast<std::uint32_t>(forward_bytes.size()));
+        put_uses(forward_bytes, uses_of);
+    }
+    decl_offsets.push_back(static_cast<std::uint32_t>(forward_bytes.size()));
+
+    std::map<std::string_view, std::uint16_t> framework_ids;
+    std::vector<std::uint16_t> frameworks(decls.size());
+    for (std::uint32_t id = 0; id < decls.size(); ++id)
+        framework_ids.emplace(framework_of(decls.section_path(decls.at(id))), 0);
+    std::vector<StrRef> framework_names;
+    for (auto& [name, f] : framework_ids) {
+        f = static_cast<std::uint16_t>(framework_names.size());
+        framework_names.push_back(strings.add(name));
+    }
+    for (std::uint32_t id = 0; id < decls.size(); ++id)
+        frameworks[id] = framework_ids[framework_of(decls.section_path(decls.at(id)))];
+
+    std::vector<std::uint64_t> hashes;
+    for (std::string_view name : type_names)
+        hashes.push_back(hash64(name));
+    PerfectHash ph = PerfectHash::build(hashes);
+
+    BlobWriter w(kMagic, kVersion, decls.corpus_hash());
+    std::size_t layout_at = w.put(TypeGraphLayout{});
+    TypeGraphLayout layout{};
+    layout.type_count = nodes.size();
+    layout.decl_count = decls.size();
+    layout.framework_count = framework_names.size();
+    layout.buckets = ph.displacements.size();
+    layout.slot_count = ph.slots.size();
+    layout.reverse_bytes = reverse.size();
+    layout.forward_bytes = forward_bytes.size();
+    layout.types = w.put_array(nodes);
+    layout.decl_offsets = w.put_array(decl_offsets);
+    layout.frameworks = w.put_array(frameworks);
+    layout.framework_names = w.put_array(framework_names);
+    layout.displacements = w.put_array(ph.displacements);
+    layout.slots = w.put_array(ph.slots);
+    // Varint decoding may read a little past the last list.
+    reverse.append(8, '\0');
+    forward_bytes.append(8, '\0');
+    layout.reverse = w.put_bytes(reverse.data(), reverse.size());
+    layout.forward = w.put_bytes(forward_bytes.data(), forward_bytes.size());
+    layout.strings = w.put_bytes(strings.data().data(), strings.data().size());
+    layout.strings_size = strings.data().size();
+    w.patch(layout_at, layout);
+
+    fs::create_directories(fs::path(path).parent_path());
+    w.write_file(path);
+
+    TypeGraphStats stats;
+    for (const TypeNode& n : nodes)
+        stats.types += n.count != 0;
+    for (const auto& uses_of : forward)
+        stats.declarations += !uses_of.empty();
+    stats.edges = reverse_uses.size();
+    stats.list_bytes = layout.reverse_bytes + layout.forward_bytes;
+    stats.raw_bytes = 2 * stats.edges * 5;
+    return stats;
+}
+
+TypeGraph::TypeGraph(const std::string& path) : reader_(path, kMagic, kVersion) {
+    const TypeGraphLayout& l = *reader_.array<TypeGraphLayout>(sizeof(BlobHeader), 1);
+    type_count_ = l.type_count;
+    decl_count_ = l.decl_count;
+    framework_count_ = l.framework_count;
+    buckets_ = l.buckets;
+    slot_count_ = l.slot_count;
+    types_ = reader_.array<TypeNode>(l.types, l.type_count);
+    decl_offsets_ = reader_.array<std::uint32_t>(l.decl_offsets, l.decl_count + 1);
+    frameworks_ = reader_.array<std::uint16_t>(l.frameworks, l.decl_count);
+    framework_names_ = reader_.array<StrRef>(l.framework_names, l.framework_count);
+    displacements_ = reader_.array<std::uint32_t>(l.displacements, l.buckets);
+    slots_ = reader_.array<std::uint32_t>(l.slots, l.slot_count);
+    reverse_ = reinterpret_cast<const unsigned char*>(reader_.bytes(l.reverse, l.reverse_bytes + 8).data());
+    forward_ = reinterpret_cast<const unsigned char*>(reader_.bytes(l.forward, l.forward_bytes + 8).data());
+    reader_.bytes(l.strings, l.strings_size);
+    strings_ = l.strings;
+    for (std::uint64_t t = 0; t < type_count_; ++t)
+        if (types_[t].offset > l.reverse_bytes || (types_[t].alias != kNone && types_[t].alias >= type_count_))
+            throw Error(path + ": adjacency list out of bounds");
+    for (std::uint64_t d = 0; d < decl_count_; ++d)
+        if (decl_offsets_[d] > decl_offsets_[d + 1] || decl_offsets_[d + 1] > l.forward_bytes ||
+            frameworks_[d] >= framework_count_)
+            throw Error(path + ": adjacency list out of bounds");
+}
+
+std::uint32_t TypeGraph::find_type(std::string_view name) const {
+    std::uint32_t i = perfect_hash_lookup(hash64(name), displacements_, buckets_, slots_, slot_count_);
+    return i != 0 && this->name(types_[i - 1].name) == name ? i - 1 : kNone;
+}
+
+void TypeGraph::aliases(std::uint32_t t, std::vector<std::uint32_t>& out) const {
+    // Typedef chains are short; a cycle (from both arms of an #if) is cut
+    // after type_count_ steps.
+    out.push_back(t);
+    for (std::uint32_t x = types_[t].alias, steps = 0; x != kNone && x != t && steps < type_count_;
+         x = types_[x].alias, ++steps)
+        out.push_back(x);
+    for (std::uint32_t x = 0; x < type_count_; ++x) {
+        std::uint32_t y = types_[x].alias;
+        for (std::uint64_t steps = 0; y != kNone && y != t && y != x && steps < type_count_; ++steps)
+            y = types_[y].alias;
+        if (y == t && x != t)
+            out.push_back(x);
+    }
+}
+
+void TypeGraph::users(std::uint32_t t, std::vector<TypeUse>& out) const {
+    get_uses(reverse_ + types_[t].offset, types_[t].count, out);
+}
+
+void TypeGraph::types_of(std::uint32_t decl, std::vector<TypeUse>& out) const {
+    const unsigned char* p = forward_ + decl_offsets_[decl];
+    const unsigned char* end = forward_ + decl_offsets_[decl + 1];
+    std::uint32_t id = 0;
+    while (p < end) {
+        std::uint64_t v = get_varint(p);
+        id += static_cast<std::uint32_t>(v >> 2);
+        out.push_back({id, static_cast<std::uint8_t>(v & 3)});
+    }
+}
+
+} // namespace moby
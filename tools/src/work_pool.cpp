@@ -0,0 +1,101 @@
+#include "moby/work_pool.h"
+
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace moby {
+namespace {
+
+class TaskDeque {
+public:
+    void push(std::uint32_t task) { tasks_.push_back(task); }
+
+    bool pop_front(std::uint32_t& task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tasks_.empty())
+            return false;
+        task = tasks_.front();
+        tasks_.pop_front();
+        return true;
+    }
+
+    bool steal_back(std::uint32_t& task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tasks_.empty())
+            return false;
+        task = tasks_.back();
+        tasks_.pop_back();
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<std::uint32_t> tasks_;
+};
+
+} // namespace
+
+unsigned default_thread_count() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+void run_stealing(const std::vector<std::uint32_t>& tasks, unsigned threads,
+                  const std::function<void(std::uint32_t)>& fn) {
+    if (threads == 0)
+        threads = default_thread_count();
+    if (threads > tasks.size())
+        threads = static_cast<unsigned>(tasks.size());
+    if (threads <= 1) {
+        for (std::uint32_t task : tasks)
+            fn(task);
+        return;
+    }
+
+    std::unique_ptr<TaskDeque[]> deques(new TaskDeque[threads]);
+    for (std::size_t i = 0; i < tasks.size(); ++i)
+        deques[i % threads].push(tasks[i]);
+
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto worker = [&](unsigned self) {
+        std::uint32_t task;
+        for (;;) {
+            if (failed.load(std::memory_order_relaxed))
+                return;
+            bool found = deques[self].pop_front(task);
+            // No task is ever added after the start, so one empty sweep
+            // over every deque means the batch is drained.
+            for (unsigned k = 1; !found && k < threads; ++k)
+                found = deques[(self + k) % threads].steal_back(task);
+            if (!found)
+                return;
+            try {
+                fn(task);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned t = 1; t < threads; ++t)
+        pool.emplace_back(worker, t);
+    worker(0);
+    for (std::thread& t : pool)
+        t.join();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+} // namespace moby
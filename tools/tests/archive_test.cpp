@@ -0,0 +1,95 @@
+#include "moby/archive.h"
+
+#include "test_corpus.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace moby {
+namespace {
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream out;
+    out << in.rdbuf();
+    return out.str();
+}
+
+// Headers long enough to compress, sharing boilerplate for the dictionary.
+std::string header(const std::string& name) {
+    std::string text = "#import <Foundation/Foundation.h>\n\nNS_ASSUME_NONNULL_BEGIN\n\n";
+    for (int i = 0; i < 20; ++i)
+        text += "- (void)" + name + "Method" + std::to_string(i) + ":(NSString *)value API_AVAILABLE(ios(13.0));\n";
+    return text + "\nNS_ASSUME_NONNULL_END\n";
+}
+
+class Archives : public ::testing::TestWithParam<std::size_t> {
+protected:
+    void SetUp() override {
+        files_ = std::make_unique<test::TestCorpus>(std::vector<std::pair<std::string, std::string>>{
+            {"Test.framework/Headers/B.h", header("beta")},
+            {"Test.framework/Headers/A.h", header("alpha")},
+            {"Test.framework/Headers/Tiny.h", "x"}});
+        // A preamble ahead of the first separator is a frame of its own.
+        std::string corpus_file = files_->path("Test.framework.h");
+        std::string text = "// preamble\n" + read_file(corpus_file);
+        std::ofstream(corpus_file, std::ios::binary) << text;
+
+        Corpus corpus(files_->dir());
+        ArchiveOptions options;
+        options.dictionary_size = GetParam();
+        options.threads = 2;
+        CorpusArchive::build(corpus, files_->path("corpus.arch"), options);
+        archive_ = std::make_unique<CorpusArchive>(files_->path("corpus.arch"));
+        original_ = text;
+    }
+
+    std::unique_ptr<test::TestCorpus> files_;
+    std::unique_ptr<CorpusArchive> archive_;
+    std::string original_;
+};
+
+TEST_P(Archives, RestoresFilesByteForByte) {
+    ASSERT_EQ(archive_->file_count(), 1u);
+    EXPECT_EQ(archive_->file_name(0), "Test.framework.h");
+    const ArchiveFile& f = archive_->file(0);
+    EXPECT_EQ(f.size, original_.size());
+    EXPECT_EQ(f.frame_count, 4u);
+    EXPECT_EQ(archive_->original_bytes(), original_.size());
+    EXPECT_EQ(archive_->dictionary().empty(), GetParam() == 0);
+
+    std::string restored, frame;
+    for (std::uint32_t i = f.first_frame; i < f.first_frame + f.frame_count; ++i) {
+        archive_->read(archive_->frame(i), frame);
+        restored += frame;
+    }
+    EXPECT_EQ(restored, original_);
+    EXPECT_LT(archive_->archive_bytes(), original_.size());
+}
+
+TEST_P(Archives, FindsSectionsByPath) {
+    std::string text;
+    const ArchiveFrame* a = archive_->find("Test.framework/Headers/A.h");
+    ASSERT_NE(a, nullptr);
+    archive_->read_text(*a, text);
+    EXPECT_EQ(text, header("alpha"));
+    // Frames read in any order share the one inflate state.
+    archive_->read_text(*archive_->find("Test.framework/Headers/Tiny.h"), text);
+    EXPECT_EQ(text, "x");
+    archive_->read_text(*archive_->find("Test.framework/Headers/B.h"), text);
+    EXPECT_EQ(text, header("beta"));
+    archive_->read(*archive_->find("Test.framework/Headers/Tiny.h"), text);
+    EXPECT_EQ(text, std::string(kSeparator) + "Test.framework/Headers/Tiny.h\nx");
+    EXPECT_EQ(archive_->find("Test.framework/Headers/C.h"), nullptr);
+    EXPECT_EQ(archive_->find(""), nullptr);
+}
+
+INSTANTIATE_TEST_SUITE_P(Dictionary, Archives, ::testing::Values(std::size_t(0), std::size_t(32) << 10));
+
+} // namespace
+} // namespace moby
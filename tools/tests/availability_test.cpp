@@ -0,0 +1,89 @@
+#include "moby/availability.h"
+
+#include "test_corpus.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace moby {
+namespace {
+
+TEST(Availability, Macros) {
+    Availability a;
+    parse_availability("- (void)f API_AVAILABLE(macos(10.15), ios(13.0)) API_UNAVAILABLE(watchos);", a);
+    EXPECT_EQ(a[Platform::MacOS].introduced, parse_version("10.15"));
+    EXPECT_EQ(a[Platform::IOS].introduced, parse_version("13.0"));
+    EXPECT_TRUE(a[Platform::WatchOS].unavailable);
+    EXPECT_FALSE(a[Platform::TvOS].annotated());
+
+    Availability d;
+    parse_availability("NS_DEPRECATED(10_5, 10_11, 2_0, 9_0)", d);
+    EXPECT_EQ(d[Platform::MacOS].deprecated, parse_version("10.11"));
+    EXPECT_EQ(d[Platform::IOS].introduced, parse_version("2.0"));
+}
+
+constexpr const char* kHeader = R"(
+API_AVAILABLE_BEGIN(macos(10.15), ios(13), tvos(13))
+
+typedef NS_ENUM(NSInteger, PHPhotosError) {
+    PHPhotosErrorInvalid = -1,
+    PHPhotosErrorUserCancelled API_AVAILABLE(macos(10.16), ios(14)) = 3072,
+};
+
+API_AVAILABLE_END
+
+/* API_AVAILABLE_BEGIN(watchos(1)) in a comment opens nothing */
+API_AVAILABLE(ios(8))
+@interface PHAsset : NSObject
+@property (nonatomic, readonly) NSUInteger pixelWidth;
+- (void)refresh API_AVAILABLE(ios(9));
+@end
+)";
+
+class Availabilities : public ::testing::Test {
+protected:
+    void SetUp() override {
+        files_ = std::make_unique<test::TestCorpus>(
+            std::vector<std::pair<std::string, std::string>>{{"Test.framework/Headers/T.h", kHeader}});
+        Corpus corpus(files_->dir());
+        SymbolDb::build(corpus, extract_corpus_symbols(corpus, 1), files_->path("symbols.db"));
+        db_ = std::make_unique<SymbolDb>(files_->path("symbols.db"));
+        AvailabilityMatrix::build(corpus, *db_, files_->path("availability.mat"));
+        matrix_ = std::make_unique<AvailabilityMatrix>(files_->path("availability.mat"));
+    }
+
+    // Introduced version of `name` on `p`, as text; "" when none.
+    std::string introduced(std::string_view name, Platform p) const {
+        SymbolDb::Range r = db_->find(name);
+        EXPECT_EQ(r.count, 1u) << name;
+        std::uint32_t v = r.count ? matrix_->get(db_->id_of(*r.begin()), p).introduced : 0;
+        return v ? format_version(v) : "";
+    }
+
+    std::unique_ptr<test::TestCorpus> files_;
+    std::unique_ptr<SymbolDb> db_;
+    std::unique_ptr<AvailabilityMatrix> matrix_;
+};
+
+// Every platform of a region reaches the declarations inside it.
+TEST_F(Availabilities, Regions) {
+    EXPECT_EQ(introduced("PHPhotosErrorInvalid", Platform::MacOS), "10.15");
+    EXPECT_EQ(introduced("PHPhotosErrorInvalid", Platform::IOS), "13.0");
+    EXPECT_EQ(introduced("PHPhotosErrorInvalid", Platform::TvOS), "13.0");
+    EXPECT_EQ(introduced("PHPhotosErrorUserCancelled", Platform::IOS), "14.0");
+    EXPECT_EQ(introduced("PHPhotosErrorUserCancelled", Platform::TvOS), "13.0");
+    EXPECT_EQ(introduced("PHAsset", Platform::MacOS), "");
+    EXPECT_EQ(introduced("PHAsset", Platform::WatchOS), "");
+}
+
+TEST_F(Availabilities, Containers) {
+    EXPECT_EQ(introduced("PHAsset", Platform::IOS), "8.0");
+    EXPECT_EQ(introduced("pixelWidth", Platform::IOS), "8.0");
+    EXPECT_EQ(introduced("refresh", Platform::IOS), "9.0");
+}
+
+} // namespace
+} // namespace moby
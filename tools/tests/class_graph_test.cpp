@@ -0,0 +1,176 @@
+#include "moby/class_graph.h"
+
+#include "moby/symbol_db.h"
+#include "test_corpus.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace moby {
+namespace {
+
+constexpr const char* kHeader = R"(
+@protocol NSObject
+- (BOOL)isEqual:(id)object;
+@end
+
+@interface NSObject <NSObject>
++ (instancetype)new;
+- (instancetype)init;
+@end
+
+@protocol NSCopying
+- (id)copyWithZone:(nullable NSZone *)zone;
+@end
+
+@protocol MDLNamed <NSObject>
+@property (nonatomic, copy) NSString *name;
+@optional
+- (void)rename;
+@required
+- (void)forget;
+@end
+
+@interface MDLObject<__covariant ObjectType> : NSObject <MDLNamed, NSCopying>
+@property (nonatomic, readonly) NSUInteger count;
+@property (class, getter=isShared, setter=makeShared:) BOOL shared;
+- (instancetype)init;
+@end
+
+@interface MDLObject<ObjectType> (Extras) <NSSecureCoding>
+- (void)extra;
+@end
+
+@interface MDLMesh : MDLObject<NSString *>
+- (void)rename;
+@end
+
+@interface MDLLight : MDLObject <NSFastEnumeration>
+@end
+)";
+
+class ClassGraphs : public ::testing::Test {
+protected:
+    void SetUp() override {
+        files_ = std::make_unique<test::TestCorpus>(
+            std::vector<std::pair<std::string, std::string>>{{"Test.framework/Headers/T.h", kHeader}});
+        Corpus corpus(files_->dir());
+        stats_ = ClassGraph::build(corpus, extract_corpus_symbols(corpus, 1), files_->path("classes.graph"), 2);
+        graph_ = std::make_unique<ClassGraph>(files_->path("classes.graph"));
+    }
+
+    const ClassNode& cls(std::string_view name) const {
+        const ClassNode* n = graph_->find_class(name);
+        EXPECT_NE(n, nullptr) << name;
+        return *n;
+    }
+
+    // Name of the unit declaring what `n` responds to for `selector`, or "".
+    std::string responder(const ClassNode& n, std::string_view selector, bool class_side = false) const {
+        const MethodRecord* m = graph_->responds(n, graph_->find_selector(selector), class_side);
+        return m ? std::string(graph_->name(graph_->unit(m->unit).name)) : std::string();
+    }
+
+    std::vector<std::string> adopted(std::string_view unit) const {
+        std::vector<std::string> out;
+        for (std::size_t i = 0; i < graph_->unit_count(); ++i)
+            if (graph_->name(graph_->unit(i).name) == unit)
+                for (std::uint32_t p : graph_->adopted(graph_->unit(i)))
+                    out.emplace_back(graph_->name(graph_->node(p).name));
+        return out;
+    }
+
+    std::unique_ptr<test::TestCorpus> files_;
+    std::unique_ptr<ClassGraph> graph_;
+    ClassGraphStats stats_;
+};
+
+using Names = std::vector<std::string>;
+
+TEST_F(ClassGraphs, Nodes) {
+    EXPECT_EQ(stats_.classes, 4u);
+    EXPECT_EQ(stats_.protocols, 3u);
+    EXPECT_EQ(stats_.categories, 1u);
+    // NSSecureCoding and NSFastEnumeration are adopted but not declared.
+    EXPECT_EQ(stats_.external, 2u);
+    const ClassNode& mesh = cls("MDLMesh");
+    ASSERT_NE(mesh.super, ClassNode::kNone);
+    EXPECT_EQ(graph_->name(graph_->node(mesh.super).name), "MDLObject");
+    EXPECT_EQ(mesh.depth, 2);
+    EXPECT_EQ(cls("NSObject").super, ClassNode::kNone);
+    EXPECT_EQ(graph_->find_class("MDLNamed"), nullptr);
+    ASSERT_NE(graph_->find_protocol("MDLNamed"), nullptr);
+    EXPECT_TRUE(graph_->find_protocol("NSSecureCoding")->flags & ClassNode::kExternal);
+}
+
+// Generic parameters and type arguments are not protocols; a root class's
+// <...> is.
+TEST_F(ClassGraphs, AdoptedProtocols) {
+    EXPECT_EQ(adopted("NSObject"), (Names{"NSObject"}));
+    EXPECT_EQ(adopted("MDLObject"), (Names{"MDLNamed", "NSCopying"}));
+    EXPECT_EQ(adopted("MDLObject(Extras)"), (Names{"NSSecureCoding"}));
+    EXPECT_EQ(adopted("MDLMesh"), Names{});
+    EXPECT_EQ(adopted("MDLLight"), (Names{"NSFastEnumeration"}));
+    EXPECT_EQ(adopted("MDLNamed"), (Names{"NSObject"}));
+}
+
+TEST_F(ClassGraphs, Conformance) {
+    const ClassNode& named = *graph_->find_protocol("MDLNamed");
+    const ClassNode& nsobject = *graph_->find_protocol("NSObject");
+    EXPECT_TRUE(graph_->conforms(cls("MDLMesh"), named));
+    EXPECT_TRUE(graph_->conforms(cls("MDLMesh"), nsobject));
+    EXPECT_TRUE(graph_->conforms(cls("MDLObject"), *graph_->find_protocol("NSSecureCoding")));
+    EXPECT_FALSE(graph_->conforms(cls("NSObject"), named));
+    EXPECT_TRUE(graph_->conforms(named, nsobject));
+}
+
+TEST_F(ClassGraphs, Responders) {
+    const ClassNode& mesh = cls("MDLMesh");
+    // Nearest declaration: own unit, then protocols, then superclasses.
+    EXPECT_EQ(responder(mesh, "rename"), "MDLMesh");
+    EXPECT_EQ(responder(mesh, "forget"), "MDLNamed");
+    EXPECT_EQ(responder(mesh, "init"), "MDLObject");
+    EXPECT_EQ(responder(mesh, "extra"), "MDLObject(Extras)");
+    EXPECT_EQ(responder(mesh, "isEqual:"), "NSObject");
+    EXPECT_EQ(responder(mesh, "copyWithZone:"), "NSCopying");
+    EXPECT_EQ(responder(mesh, "new", true), "NSObject");
+    EXPECT_EQ(responder(mesh, "new"), "");
+    EXPECT_EQ(responder(mesh, "missing"), "");
+    EXPECT_EQ(responder(cls("NSObject"), "rename"), "");
+}
+
+TEST_F(ClassGraphs, Properties) {
+    const ClassNode& object = cls("MDLObject");
+    EXPECT_EQ(responder(object, "count"), "MDLObject");
+    EXPECT_EQ(responder(object, "setCount:"), "");
+    EXPECT_EQ(responder(object, "isShared", true), "MDLObject");
+    EXPECT_EQ(responder(object, "makeShared:", true), "MDLObject");
+    EXPECT_EQ(responder(object, "shared", true), "");
+    EXPECT_EQ(responder(object, "setName:"), "MDLNamed");
+
+    const MethodRecord* name = graph_->responds(object, graph_->find_selector("name"));
+    ASSERT_NE(name, nullptr);
+    EXPECT_EQ(name->flags, MethodRecord::kProperty);
+    const MethodRecord* rename = graph_->responds(object, graph_->find_selector("rename"));
+    ASSERT_NE(rename, nullptr);
+    EXPECT_EQ(rename->flags, MethodRecord::kOptional);
+    EXPECT_EQ(graph_->responds(object, graph_->find_selector("forget"))->flags, 0);
+}
+
+TEST_F(ClassGraphs, Declarers) {
+    std::uint32_t rename = graph_->find_selector("rename");
+    ASSERT_NE(rename, ClassNode::kNone);
+    Names units;
+    for (std::uint32_t m : graph_->declarers(rename))
+        units.emplace_back(graph_->name(graph_->unit(graph_->method(m).unit).name));
+    // Units are ordered by node name.
+    EXPECT_EQ(units, (Names{"MDLMesh", "MDLNamed"}));
+    EXPECT_EQ(graph_->find_selector("missing"), ClassNode::kNone);
+}
+
+} // namespace
+} // namespace moby
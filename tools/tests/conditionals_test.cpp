@@ -0,0 +1,96 @@
+#include "moby/conditionals.h"
+
+#include "test_corpus.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace moby {
+namespace {
+
+// Whether `marker` survives in the live text of the only section for `config`.
+class Conditionals : public ::testing::Test {
+protected:
+    bool live(const std::string& body, const TargetConfig& config, std::string_view marker) {
+        test::TestCorpus files({{"Test.framework/Headers/T.h", body}});
+        Corpus corpus(files.dir());
+        ConditionalViews views(corpus);
+        return views.view(config).text(0).find(marker) != std::string_view::npos;
+    }
+
+    bool live(const std::string& body, std::string_view marker) { return live(body, TargetConfig{}, marker); }
+
+    // Whether `expr` is true as an #if condition.
+    bool holds(const std::string& expr) { return live("#if " + expr + "\nYES\n#else\nNO\n#endif\n", "YES"); }
+};
+
+TEST_F(Conditionals, Targets) {
+    std::string body = "#if TARGET_OS_IPHONE\nIPHONE\n#elif TARGET_OS_OSX\nMAC\n#endif\n"
+                       "#if __LP64__\nLP64\n#else\nILP32\n#endif\n";
+    TargetConfig ios;
+    EXPECT_TRUE(live(body, ios, "IPHONE"));
+    EXPECT_FALSE(live(body, ios, "MAC"));
+    TargetConfig mac;
+    mac.platform = Platform::MacOS;
+    EXPECT_TRUE(live(body, mac, "MAC"));
+    EXPECT_FALSE(live(body, mac, "IPHONE"));
+    TargetConfig armv7;
+    armv7.pointer_bits = 32;
+    EXPECT_TRUE(live(body, armv7, "ILP32"));
+    EXPECT_FALSE(live(body, armv7, "LP64\n"));
+}
+
+TEST_F(Conditionals, DefinesInSection) {
+    EXPECT_TRUE(live("#define USE_X 1\n#ifdef USE_X\nLIVE\n#endif\n", "LIVE"));
+    EXPECT_FALSE(live("#define USE_X 1\n#undef USE_X\n#ifdef USE_X\nLIVE\n#endif\n", "LIVE"));
+    EXPECT_TRUE(live("#ifndef GUARD_H\n#define GUARD_H\nBODY\n#endif\n", "BODY"));
+    EXPECT_TRUE(live("#define LEVEL 3\n#if LEVEL > 2 && defined(LEVEL)\nHIGH\n#endif\n", "HIGH"));
+}
+
+TEST_F(Conditionals, Versions) {
+    std::string body = "#if __IPHONE_OS_VERSION_MIN_REQUIRED >= 130000\nNEW\n#else\nOLD\n#endif\n";
+    TargetConfig old_target;
+    old_target.min_version = parse_version("12.0");
+    EXPECT_TRUE(live(body, old_target, "OLD"));
+    TargetConfig new_target;
+    new_target.min_version = parse_version("13.1");
+    EXPECT_TRUE(live(body, new_target, "NEW"));
+}
+
+TEST_F(Conditionals, Arithmetic) {
+    EXPECT_TRUE(holds("1 + 2 * 3 == 7"));
+    EXPECT_TRUE(holds("(1 << 4) == 16 && 7 % 4 == 3"));
+    EXPECT_TRUE(holds("0x10 == 16 && 010 == 8"));
+    EXPECT_TRUE(holds("1 ? 2 : 0"));
+    EXPECT_FALSE(holds("UNDEFINED_NAME"));
+    EXPECT_TRUE(holds("!defined(UNDEFINED_NAME)"));
+    EXPECT_TRUE(holds("-1 < 0"));
+    EXPECT_TRUE(holds("-7 / 2 == -3 && -7 % 2 == -1"));
+}
+
+TEST_F(Conditionals, UnsignedArithmetic) {
+    // Either operand unsigned makes the comparison, division or remainder unsigned.
+    EXPECT_FALSE(holds("-1 < 0u"));
+    EXPECT_TRUE(holds("-1 > 0U"));
+    EXPECT_TRUE(holds("-1 / 2u == 0x7FFFFFFFFFFFFFFF"));
+    EXPECT_TRUE(holds("-1 % 10u == 5"));
+    EXPECT_TRUE(holds("(1 ? -1 : 0u) > 0"));
+    // A shift takes the type of its left operand only.
+    EXPECT_TRUE(holds("(-1u >> 63) == 1"));
+    EXPECT_TRUE(holds("(-2 >> 1u) == -1"));
+    // Literals too large for intmax_t are unsigned.
+    EXPECT_TRUE(holds("0xFFFFFFFFFFFFFFFF > 0"));
+    EXPECT_TRUE(holds("-1 == 0xFFFFFFFFFFFFFFFF"));
+    // Signedness survives macro expansion.
+    EXPECT_TRUE(live("#define MINUS_ONE_U (-1u)\n#if MINUS_ONE_U > 0\nYES\n#endif\n", "YES"));
+}
+
+TEST_F(Conditionals, NestedSkippedArms) {
+    std::string body = "#if 0\n#if 1\nINNER\n#else\nINNER_ELSE\n#endif\n#else\nOUTER\n#endif\n";
+    EXPECT_FALSE(live(body, "INNER"));
+    EXPECT_TRUE(live(body, "OUTER"));
+}
+
+} // namespace
+} // namespace moby
@@ -0,0 +1,98 @@
+#include "moby/const_expr.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <optional>
+#include <string>
+
+namespace moby {
+namespace {
+
+// Names from a map; anything else has no value.
+class MapExpr : public ConstExpr {
+public:
+    MapExpr(std::string_view text, const std::vector<Token>& toks, const std::map<std::string, ConstValue>& names)
+        : ConstExpr(text, toks, 0, toks.size()), names_(names) {}
+
+protected:
+    bool identifier(ConstValue& out) override {
+        auto it = names_.find(std::string(str(i_++)));
+        if (it == names_.end())
+            return false;
+        out = it->second;
+        return true;
+    }
+
+private:
+    const std::map<std::string, ConstValue>& names_;
+};
+
+std::optional<ConstValue> eval(std::string_view text) {
+    static const std::map<std::string, ConstValue> kNames = {
+        {"UMAX", {UINT64_MAX, true}}, {"SMIN", ConstValue::of(INT64_MIN)}, {"TEN", ConstValue::of(10)}};
+    std::vector<Token> toks = tokenize(text);
+    ConstValue v;
+    if (!MapExpr(text, toks, kNames).evaluate_all(v))
+        return std::nullopt;
+    return v;
+}
+
+std::int64_t value(std::string_view text) {
+    std::optional<ConstValue> v = eval(text);
+    EXPECT_TRUE(v) << text;
+    return v ? v->as_signed() : 0;
+}
+
+TEST(ConstExpr, Precedence) {
+    EXPECT_EQ(value("1 + 2 * 3"), 7);
+    EXPECT_EQ(value("(1 + 2) * 3"), 9);
+    EXPECT_EQ(value("1 << 2 + 1"), 8);
+    EXPECT_EQ(value("TEN > 5 && TEN < 20 ? TEN : -1"), 10);
+    EXPECT_EQ(value("1 | 2 ^ 3 & 4"), 3);
+    EXPECT_EQ(value("!0 + ~0"), 0);
+    EXPECT_EQ(value("'wav '"), 0x77617620);
+}
+
+TEST(ConstExpr, Signedness) {
+    EXPECT_TRUE(eval("1u")->is_unsigned);
+    EXPECT_TRUE(eval("0xFFFFFFFFFFFFFFFF")->is_unsigned);
+    EXPECT_FALSE(eval("0x7FFFFFFFFFFFFFFF")->is_unsigned);
+    EXPECT_EQ(value("-1 < 0u"), 0);
+    EXPECT_EQ(value("-1 < 0"), 1);
+    EXPECT_EQ(value("UMAX >> 63"), 1);
+    EXPECT_EQ(value("-8 >> 1"), -4);
+    EXPECT_EQ(value("UMAX / 2"), INT64_MAX);
+    EXPECT_EQ(value("-1 / 2"), 0);
+    // Either arm being unsigned makes the result unsigned.
+    EXPECT_TRUE(eval("1 ? -1 : 0u")->is_unsigned);
+}
+
+TEST(ConstExpr, Wrapping) {
+    EXPECT_EQ(value("SMIN / -1"), INT64_MIN);
+    EXPECT_EQ(value("SMIN % -1"), 0);
+    EXPECT_EQ(value("SMIN - 1"), INT64_MAX);
+    EXPECT_EQ(value("1 << 64"), 0);
+    EXPECT_FALSE(eval("1 / 0"));
+    EXPECT_FALSE(eval("1 % (TEN - 10)"));
+}
+
+TEST(ConstExpr, Malformed) {
+    EXPECT_FALSE(eval(""));
+    EXPECT_FALSE(eval("1 +"));
+    EXPECT_FALSE(eval("(1"));
+    EXPECT_FALSE(eval("1 2"));
+    EXPECT_FALSE(eval("UNKNOWN"));
+    EXPECT_FALSE(eval("1.5"));
+}
+
+TEST(ConstExpr, Convert) {
+    EXPECT_EQ(convert_value(ConstValue::of(0x1FF), 8, false).as_signed(), 0xFF);
+    EXPECT_EQ(convert_value(ConstValue::of(0xFF), 8, true).as_signed(), -1);
+    EXPECT_TRUE(convert_value(ConstValue::of(-1), 64, false).is_unsigned);
+    EXPECT_FALSE(convert_value(ConstValue::of(-1), 32, false).is_unsigned);
+    EXPECT_EQ(convert_value(ConstValue::of(-1), 0, false).as_signed(), -1);
+}
+
+} // namespace
+} // namespace moby
@@ -0,0 +1,82 @@
+#include "moby/deprecations.h"
+
+#include "test_corpus.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+namespace moby {
+namespace {
+
+constexpr const char* kHeader = R"(
+@interface MDLMesh : NSObject
+- (void)makeVerticesUnique API_DEPRECATED("", ios(9.0, 11.0));
+- (BOOL)makeVerticesUniqueAndReturnError:(NSError **)error;
+@end
+
+@interface MDLSession : NSObject
+- (instancetype)init API_DEPRECATED_WITH_REPLACEMENT("sharedSession", ios(8.0, 10.0));
+@property (weak) id delegate API_DEPRECATED("", ios(8.0, 10.0));
++ (MDLSession *)sharedSession;
+@end
+
+@interface MDLView : NSObject
+- (instancetype)init;
+@property (weak) id delegate;
+@end
+)";
+
+class Deprecations : public ::testing::Test {
+protected:
+    void SetUp() override {
+        files_ = std::make_unique<test::TestCorpus>(
+            std::vector<std::pair<std::string, std::string>>{{"Test.framework/Headers/T.h", kHeader}});
+        Corpus corpus(files_->dir());
+        SymbolDb::build(corpus, extract_corpus_symbols(corpus, 1), files_->path("symbols.db"));
+        SymbolDb db(files_->path("symbols.db"));
+        DeprecationTable::build(corpus, db, files_->path("deprecations.tbl"));
+        table_ = std::make_unique<DeprecationTable>(files_->path("deprecations.tbl"));
+    }
+
+    // "name" or "name@Class" for every use in `text`.
+    std::vector<std::string> scan(std::string_view text) {
+        std::vector<DeprecationHit> hits;
+        table_->scan(text, hits);
+        std::vector<std::string> out;
+        for (const DeprecationHit& h : hits) {
+            std::string s(text.substr(h.offset, h.length));
+            if (h.receiver_length)
+                s += "@" + std::string(text.substr(h.receiver, h.receiver_length));
+            out.push_back(s);
+        }
+        return out;
+    }
+
+    std::unique_ptr<test::TestCorpus> files_;
+    std::unique_ptr<DeprecationTable> table_;
+};
+
+TEST_F(Deprecations, Replacements) {
+    std::vector<std::uint32_t> ids = table_->find("makeVerticesUnique");
+    ASSERT_EQ(ids.size(), 1u);
+    EXPECT_EQ(table_->str(table_->record(ids[0]).replacement), "makeVerticesUniqueAndReturnError:");
+    ids = table_->find("init");
+    ASSERT_EQ(ids.size(), 1u);
+    EXPECT_EQ(table_->str(table_->record(ids[0]).replacement), "sharedSession");
+}
+
+TEST_F(Deprecations, MembersNeedReceiver) {
+    EXPECT_EQ(scan("[mesh makeVerticesUnique]; makeVerticesUnique(x);"),
+              (std::vector<std::string>{"makeVerticesUnique"}));
+}
+
+TEST_F(Deprecations, SharedSelectorsNeedClass) {
+    // Another class declares init and delegate without deprecating them.
+    EXPECT_TRUE(scan("[[MDLView alloc] init]; [b delegate]; [b setDelegate:x]; [super init]; x.delegate;").empty());
+    EXPECT_EQ(scan("[[MDLSession alloc] init]; [MDLSession new]; [[MDLSession new] init]; [MDLSession delegate];"),
+              (std::vector<std::string>{"init@MDLSession", "init@MDLSession", "delegate@MDLSession"}));
+}
+
+} // namespace
+} // namespace moby
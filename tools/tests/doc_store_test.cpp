@@ -0,0 +1,153 @@
+#include "moby/doc_store.h"
+
+#include "test_corpus.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace moby {
+namespace {
+
+TEST(DocComments, Tags) {
+    DocComment doc;
+    parse_doc_comment("/*!\n"
+                      " * @brief Adds a mesh.\n"
+                      " * @param mesh The mesh\n"
+                      " *        to add.\n"
+                      " * @return YES on success.\n"
+                      " * @code\n"
+                      " *   [asset addMesh:m];\n"
+                      " * @endcode\n"
+                      " */",
+                      doc);
+    ASSERT_EQ(doc.tags.size(), 3u);
+    EXPECT_EQ(doc.tags[0].tag, "abstract");
+    EXPECT_EQ(doc.tags[0].text, "Adds a mesh.");
+    EXPECT_EQ(doc.tags[1].tag, "param");
+    EXPECT_EQ(doc.tags[1].name, "mesh");
+    EXPECT_EQ(doc.tags[1].text, "The mesh to add.");
+    ASSERT_NE(doc.find("result"), nullptr);
+    EXPECT_EQ(doc.find("result")->text.rfind("YES on success.", 0), 0u);
+    EXPECT_NE(doc.find("result")->text.find("[asset addMesh:m];"), std::string::npos);
+    EXPECT_EQ(doc.find("see"), nullptr);
+
+    parse_doc_comment("/*!< Trailing note. */", doc);
+    ASSERT_EQ(doc.tags.size(), 1u);
+    EXPECT_EQ(doc.tags[0].tag, "discussion");
+    EXPECT_EQ(doc.tags[0].text, "Trailing note.");
+}
+
+TEST(DocComments, Scan) {
+    std::string text = "/* plain */ /*! doc */ \"/*! string */\" // /*! line\n/** also */";
+    std::vector<std::string> found;
+    for_each_doc_comment(text, [&](std::size_t b, std::size_t e) { found.push_back(text.substr(b, e - b)); });
+    EXPECT_EQ(found, (std::vector<std::string>{"/*! doc */", "/** also */"}));
+}
+
+constexpr const char* kHeader = R"(
+/*!
+ @abstract A light.
+ */
+@interface MDLLight : NSObject
+/*! @abstract Turns the light on.
+    @param level How bright. */
+- (void)turnOnAtLevel:(float)level;
+- (void)undocumented;
+@end
+
+/*!
+ @enum MDLLightType
+ @constant MDLLightTypeSpot A cone of light.
+ @constant MDLLightTypePoint Light from a point.
+ */
+typedef NS_ENUM(NSUInteger, MDLLightType) {
+    MDLLightTypeSpot,
+    MDLLightTypePoint,
+    MDLLightTypeArea,
+};
+
+/*! @abstract Not followed by a declaration. */
+
+// A plain comment between keeps the attachment.
+/*! @abstract Makes a light. */
+API_AVAILABLE(ios(9.0))
+MDLLight *MDLLightMake(void);
+)";
+
+class DocStores : public ::testing::TestWithParam<std::size_t> {
+protected:
+    void SetUp() override {
+        files_ = std::make_unique<test::TestCorpus>(
+            std::vector<std::pair<std::string, std::string>>{{"Test.framework/Headers/T.h", kHeader}});
+        Corpus corpus(files_->dir());
+        SymbolDb::build(corpus, extract_corpus_symbols(corpus, 1), files_->path("symbols.db"));
+        symbols_ = std::make_unique<SymbolDb>(files_->path("symbols.db"));
+        DocStoreOptions options;
+        options.block_size = GetParam();
+        options.threads = 2;
+        stats_ = DocStore::build(corpus, *symbols_, files_->path("docs.store"), options);
+        docs_ = std::make_unique<DocStore>(files_->path("docs.store"));
+    }
+
+    // Text of `tag` in the documentation of the first symbol called `name`.
+    std::string doc(std::string_view name, std::string_view tag = "abstract") const {
+        SymbolDb::Range r = symbols_->find(name);
+        EXPECT_EQ(r.count, 1u) << name;
+        DocComment out;
+        if (r.count == 0 || !docs_->read(static_cast<std::uint32_t>(symbols_->id_of(*r.begin())), out))
+            return "<none>";
+        const DocTag* t = out.find(tag);
+        return t ? t->text : "<no " + std::string(tag) + ">";
+    }
+
+    std::unique_ptr<test::TestCorpus> files_;
+    std::unique_ptr<SymbolDb> symbols_;
+    std::unique_ptr<DocStore> docs_;
+    DocStoreStats stats_;
+};
+
+TEST_P(DocStores, Attachment) {
+    EXPECT_EQ(stats_.comments, 5u);
+    EXPECT_EQ(stats_.attached, 4u);
+    EXPECT_EQ(docs_->symbol_count(), symbols_->size());
+    EXPECT_EQ(doc("MDLLight"), "A light.");
+    EXPECT_EQ(doc("turnOnAtLevel:"), "Turns the light on.");
+    EXPECT_EQ(doc("turnOnAtLevel:", "param"), "How bright.");
+    EXPECT_EQ(doc("MDLLightMake"), "Makes a light.");
+    EXPECT_EQ(doc("undocumented"), "<none>");
+}
+
+TEST_P(DocStores, MembersInheritTags) {
+    EXPECT_EQ(doc("MDLLightTypePoint", "constant"), "Light from a point.");
+    EXPECT_EQ(doc("MDLLightTypeSpot", "constant"), "A cone of light.");
+    EXPECT_EQ(doc("MDLLightTypeArea"), "<none>");
+    EXPECT_EQ(stats_.inherited, 2u);
+}
+
+// Records read out of order, across blocks or within one, are the same.
+TEST_P(DocStores, ReadsInAnyOrder) {
+    std::vector<std::string> forward, backward;
+    DocComment out;
+    for (std::size_t i = 0; i < docs_->size(); ++i) {
+        docs_->read(docs_->entry(i), out);
+        forward.push_back(out.tags.empty() ? "" : out.tags[0].text);
+    }
+    for (std::size_t i = docs_->size(); i-- > 0;) {
+        docs_->read(docs_->entry(i), out);
+        backward.insert(backward.begin(), out.tags.empty() ? "" : out.tags[0].text);
+    }
+    EXPECT_EQ(forward, backward);
+    EXPECT_EQ(docs_->size(), stats_.documented);
+    EXPECT_EQ(docs_->block_count(), stats_.blocks);
+    if (GetParam() < 64) {
+        EXPECT_GT(docs_->block_count(), 1u);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(BlockSize, DocStores, ::testing::Values(std::size_t(1), std::size_t(1024)));
+
+} // namespace
+} // namespace moby
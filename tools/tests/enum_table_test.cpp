@@ -0,0 +1,183 @@
+#include "moby/enum_table.h"
+
+#include "moby/symbol_db.h"
+#include "test_corpus.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+
+namespace moby {
+namespace {
+
+constexpr const char* kHeader = R"(
+typedef NS_ENUM(NSInteger, MDLGeometryType) {
+    MDLGeometryTypePoints = 0,
+    MDLGeometryTypeLines,
+    MDLGeometryTypeTriangles = MDLGeometryTypeLines + 1,
+    MDLGeometryTypeNegative = -2,
+};
+
+typedef NS_OPTIONS(NSUInteger, MDLOptions) {
+    MDLOptionA = 1 << 0,
+    MDLOptionB = 1 << 1,
+    MDLOptionC = 1 << 3,
+    MDLOptionAB = MDLOptionA | MDLOptionB,
+};
+
+typedef NS_ENUM(NSInteger, EKind) {
+    EKindFooBar = 1,
+    EKindFoo = 1,
+};
+
+typedef NS_ENUM(uint8_t, MDLSmall) {
+    MDLSmallWrap = 0x1FF,
+};
+
+enum {
+    kAudioFileWAVEType = 'WAVE',
+    kAfterForward = kBeforeLater + 1,
+    kBeforeLater = MDLGeometryTypeTriangles * 10,
+};
+
+enum {
+    kFormatFlagIsFloat = (1U << 0),
+    kFormatFlagIsBigEndian = (1U << 4),
+    kFormatFlagIsPacked = (1U << 5),
+#if TARGET_RT_BIG_ENDIAN
+    kFormatFlagsNativeEndian = kFormatFlagIsBigEndian,
+#else
+    kFormatFlagsNativeEndian = 0,
+#endif
+    kFormatFlagsNativeFloatPacked = kFormatFlagIsFloat | kFormatFlagsNativeEndian | kFormatFlagIsPacked,
+};
+
+typedef NS_ENUM(NSUInteger, MDLUnsigned) {
+    MDLUnsignedHalf = NSUIntegerMax >> 1,
+    MDLUnsignedQuotient = 0xFFFFFFFFFFFFFFFF / 2,
+    MDLUnsignedCompare = (-1 < 0u) ? 5 : 6,
+    MDLUnsignedNarrow = (uint32_t)-1 >> 1,
+};
+
+typedef NS_ENUM(int64_t, MDLOverflow) {
+    MDLOverflowQuotient = INT64_MIN / -1,
+    MDLOverflowRemainder = INT64_MIN % -1,
+};
+)";
+
+class EnumTables : public ::testing::Test {
+protected:
+    void SetUp() override {
+        files_ = std::make_unique<test::TestCorpus>(
+            std::vector<std::pair<std::string, std::string>>{{"Test.framework/Headers/T.h", kHeader}});
+        Corpus corpus(files_->dir());
+        EnumTable::build(corpus, extract_corpus_symbols(corpus, 1), files_->path("enums.tbl"));
+        table_ = std::make_unique<EnumTable>(files_->path("enums.tbl"));
+    }
+
+    // Value of the only enumerator called `name`.
+    std::int64_t value(std::string_view name) {
+        EnumTable::Ids ids = table_->find(name);
+        EXPECT_EQ(ids.count, 1u) << name;
+        if (ids.empty())
+            return 0;
+        const ConstantRecord& c = table_->constant(*ids.begin());
+        EXPECT_TRUE(c.flags & ConstantRecord::kResolved) << name;
+        EXPECT_FALSE(c.flags & ConstantRecord::kInactive) << name;
+        return c.value;
+    }
+
+    std::unique_ptr<test::TestCorpus> files_;
+    std::unique_ptr<EnumTable> table_;
+};
+
+TEST_F(EnumTables, Values) {
+    EXPECT_EQ(value("MDLGeometryTypePoints"), 0);
+    EXPECT_EQ(value("MDLGeometryTypeLines"), 1);
+    EXPECT_EQ(value("MDLGeometryTypeTriangles"), 2);
+    EXPECT_EQ(value("MDLGeometryTypeNegative"), -2);
+    EXPECT_EQ(value("kAudioFileWAVEType"), 0x57415645);
+}
+
+TEST_F(EnumTables, ReferencesAcrossEnums) {
+    EXPECT_EQ(value("kBeforeLater"), 20);
+    EXPECT_EQ(value("kAfterForward"), 21);
+}
+
+TEST_F(EnumTables, UnderlyingWidth) {
+    EXPECT_EQ(value("MDLSmallWrap"), 0xFF);
+}
+
+// An unsigned operand makes the whole operation unsigned, as in C.
+TEST_F(EnumTables, Signedness) {
+    EXPECT_EQ(value("MDLUnsignedHalf"), INT64_MAX);
+    EXPECT_EQ(value("MDLUnsignedQuotient"), INT64_MAX);
+    EXPECT_EQ(value("MDLUnsignedCompare"), 6);
+    EXPECT_EQ(value("MDLUnsignedNarrow"), 0x7FFFFFFF);
+    // Wraps instead of trapping.
+    EXPECT_EQ(value("MDLOverflowQuotient"), INT64_MIN);
+    EXPECT_EQ(value("MDLOverflowRemainder"), 0);
+}
+
+// NSInteger and NSUInteger follow the target's pointer width.
+TEST_F(EnumTables, PointerWidth) {
+    TargetConfig ilp32;
+    ilp32.pointer_bits = 32;
+    Corpus corpus(files_->dir());
+    EnumTable::build(corpus, extract_corpus_symbols(corpus, 1), files_->path("enums32.tbl"), ilp32);
+    EnumTable table(files_->path("enums32.tbl"));
+    auto value32 = [&](std::string_view name) {
+        EnumTable::Ids ids = table.find(name);
+        return ids.count == 1 ? table.constant(*ids.begin()).value : -1;
+    };
+    EXPECT_EQ(value32("MDLUnsignedHalf"), 0x7FFFFFFF);
+    EXPECT_EQ(value32("MDLUnsignedQuotient"), 0xFFFFFFFF);
+    EXPECT_EQ(value32("MDLGeometryTypeNegative"), -2);
+    EXPECT_EQ(value32("MDLOverflowQuotient"), INT64_MIN);
+    EXPECT_EQ(table.find_enum("MDLOptions")->width, 32u);
+}
+
+TEST_F(EnumTables, Options) {
+    EXPECT_EQ(value("MDLOptionAB"), 3);
+    const EnumRecord* e = table_->find_enum("MDLOptions");
+    ASSERT_NE(e, nullptr);
+    EXPECT_TRUE(e->flags & EnumRecord::kOptions);
+    EXPECT_EQ(table_->decode(*e, 0x9), "MDLOptionA | MDLOptionC");
+    // Masks with more bits win.
+    EXPECT_EQ(table_->decode(*e, 0x13), "MDLOptionAB | 0x10");
+}
+
+// Every enumerator with the value, even when one name contains another.
+TEST_F(EnumTables, DecodeAliases) {
+    const EnumRecord* e = table_->find_enum("EKind");
+    ASSERT_NE(e, nullptr);
+    EXPECT_EQ(table_->decode(*e, 1), "EKindFooBar | EKindFoo");
+    EXPECT_EQ(table_->decode(*e, 2), "2");
+}
+
+TEST_F(EnumTables, InactiveArms) {
+    EXPECT_EQ(value("kFormatFlagsNativeFloatPacked"), 0x21);
+    EnumTable::Ids ids = table_->find("kFormatFlagsNativeEndian");
+    ASSERT_EQ(ids.count, 2u);
+    const ConstantRecord& big = table_->constant(ids.begin()[0]);
+    const ConstantRecord& little = table_->constant(ids.begin()[1]);
+    EXPECT_TRUE(big.flags & ConstantRecord::kInactive);
+    EXPECT_EQ(big.value, 0x10);
+    EXPECT_FALSE(little.flags & ConstantRecord::kInactive);
+    EXPECT_EQ(little.value, 0);
+    // Reverse lookups see only the arm the target compiles.
+    ASSERT_EQ(table_->with_value(0x10).count, 1u);
+    EXPECT_EQ(table_->name(table_->constant(*table_->with_value(0x10).begin()).name), "kFormatFlagIsBigEndian");
+}
+
+TEST_F(EnumTables, ReverseLookup) {
+    std::vector<std::string> names;
+    for (std::uint32_t id : table_->with_value(2))
+        names.emplace_back(table_->name(table_->constant(id).name));
+    std::sort(names.begin(), names.end());
+    EXPECT_EQ(names, (std::vector<std::string>{"MDLGeometryTypeTriangles", "MDLOptionB"}));
+}
+
+} // namespace
+} // namespace moby
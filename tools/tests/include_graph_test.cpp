@@ -0,0 +1,69 @@
+#include "moby/include_graph.h"
+
+#include "test_corpus.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace moby {
+namespace {
+
+TEST(IncludeGraph, Edges) {
+    std::string umbrella = "#import <Test/A.h>\n#import \"B.h\"\n";
+    std::string a = "#include <stdint.h>\n#import <Test/B.h>\n";
+    std::string b = "  #import <Test/A.h>\n// #import <Test/C.h>\n";
+    test::TestCorpus files({{"Test.framework/Headers/Test.h", umbrella},
+                            {"Test.framework/Headers/A.h", a},
+                            {"Test.framework/Headers/B.h", b}});
+    Corpus corpus(files.dir());
+    IncludeGraph::build(corpus, files.path("includes.graph"));
+    IncludeGraph graph(files.path("includes.graph"));
+
+    ASSERT_EQ(graph.size(), 4u);
+    std::uint32_t test, ia, ib, stdint;
+    ASSERT_TRUE(graph.find("Test/Test.h", test));
+    ASSERT_TRUE(graph.find("Test.framework/Headers/A.h", ia));
+    ASSERT_TRUE(graph.find("Test/B.h", ib));
+    ASSERT_TRUE(graph.find("stdint.h", stdint));
+    EXPECT_FALSE(graph.find("Test/C.h", ia));
+    EXPECT_EQ(test, 0u);
+    EXPECT_TRUE(graph.external(stdint));
+    EXPECT_EQ(graph.includes(test).size(), 2u);
+    EXPECT_EQ(graph.included_by(ia).size(), 2u);
+
+    // A and B include each other.
+    EXPECT_TRUE(graph.depends_on(test, stdint));
+    EXPECT_TRUE(graph.depends_on(ia, ia));
+    EXPECT_FALSE(graph.depends_on(test, test));
+    EXPECT_EQ(graph.dependency_count(test), 3u);
+    EXPECT_EQ(graph.dependent_count(stdint), 3u);
+    ASSERT_EQ(graph.cycles().size(), 1u);
+    EXPECT_EQ(graph.cycles()[0].size(), 2u);
+}
+
+// A header path that occurs twice keeps both sections as nodes; the name
+// finds the first, as in the section index.
+TEST(IncludeGraph, DuplicatePaths) {
+    std::string first = "#import <Test/B.h>\n";
+    std::string second = "#include <stdint.h>\n";
+    test::TestCorpus files({{"Test.framework/Headers/A.h", first},
+                            {"Test.framework/Headers/B.h", std::string()},
+                            {"Test.framework/Headers/A.h", second}});
+    Corpus corpus(files.dir());
+    IncludeGraph::build(corpus, files.path("includes.graph"));
+    IncludeGraph graph(files.path("includes.graph"));
+
+    ASSERT_EQ(graph.size(), 4u);
+    std::uint32_t id;
+    ASSERT_TRUE(graph.find("Test/A.h", id));
+    EXPECT_EQ(id, 0u);
+    ASSERT_TRUE(graph.find("Test.framework/Headers/A.h", id));
+    EXPECT_EQ(id, 0u);
+    EXPECT_EQ(graph.at(2).section, 2u);
+    EXPECT_EQ(graph.includes(2).size(), 1u);
+}
+
+} // namespace
+} // namespace moby
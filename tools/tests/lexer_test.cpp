@@ -0,0 +1,77 @@
+#include "moby/lexer.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace moby {
+namespace {
+
+std::vector<std::string> texts(std::string_view text) {
+    std::vector<std::string> out;
+    for (const Token& t : tokenize(text))
+        out.emplace_back(token_text(text, t));
+    return out;
+}
+
+std::size_t index_of(std::string_view text, const std::vector<Token>& toks, std::string_view s, std::size_t from = 0) {
+    for (std::size_t i = from; i < toks.size(); ++i)
+        if (token_text(text, toks[i]) == s)
+            return i;
+    return toks.size();
+}
+
+TEST(Lexer, TokenKinds) {
+    std::string_view text = "#import <Foundation/Foundation.h>\n"
+                            "@interface A : NSObject // note\n"
+                            "- (int)x:(id)y; x <<= 0x1Fu; 'wav ' @\"s\" 1.5e-3\n";
+    std::vector<Token> toks = tokenize(text);
+    ASSERT_FALSE(toks.empty());
+    EXPECT_EQ(toks[0].kind, Tok::Directive);
+    EXPECT_EQ(directive_name(token_text(text, toks[0])), "import");
+    EXPECT_EQ(texts(text), (std::vector<std::string>{
+                               "#import <Foundation/Foundation.h>", "@interface", "A", ":", "NSObject", "-", "(",
+                               "int", ")", "x", ":", "(", "id", ")", "y", ";", "x", "<<=", "0x1Fu", ";", "'wav '",
+                               "@\"s\"", "1.5e-3"}));
+    std::vector<Token> with_comments = tokenize(text, true);
+    EXPECT_EQ(with_comments.size(), toks.size() + 1);
+}
+
+TEST(Lexer, DirectiveContinuation) {
+    std::string_view text = "#define A(x) \\\n  ((x) + 1)\nint b;";
+    EXPECT_EQ(texts(text), (std::vector<std::string>{"#define A(x) \\\n  ((x) + 1)", "int", "b", ";"}));
+}
+
+TEST(Lexer, IdentChars) {
+    EXPECT_TRUE(is_ident_start('_'));
+    EXPECT_TRUE(is_ident_start('z'));
+    EXPECT_FALSE(is_ident_start('9'));
+    EXPECT_TRUE(is_ident_char('9'));
+    EXPECT_FALSE(is_ident_char('$'));
+    EXPECT_FALSE(is_ident_char(static_cast<char>(0xC3)));
+    EXPECT_TRUE(ends_with("CF_EXPORT", "_EXPORT"));
+    EXPECT_FALSE(ends_with("EXPORT", "_EXPORT"));
+}
+
+TEST(Lexer, SkipGroup) {
+    std::string_view text = "f(a, (b)[c], {d}) e";
+    std::vector<Token> toks = tokenize(text);
+    std::size_t open = index_of(text, toks, "(");
+    EXPECT_EQ(token_text(text, toks[skip_group(text, toks, open, toks.size())]), "e");
+    // Unclosed before `last`.
+    EXPECT_EQ(skip_group(text, toks, open, open + 3), open + 3);
+}
+
+TEST(Lexer, SkipAngles) {
+    std::string_view text = "NSArray<NSDictionary<NSString *, id>> *a; x < y; z";
+    std::vector<Token> toks = tokenize(text);
+    std::size_t open = index_of(text, toks, "<");
+    EXPECT_EQ(token_text(text, toks[skip_angles(text, toks, open, toks.size())]), "*");
+    // A comparison runs into the ';' and stops there.
+    std::size_t less = index_of(text, toks, "<", index_of(text, toks, "x"));
+    EXPECT_EQ(token_text(text, toks[skip_angles(text, toks, less, toks.size())]), ";");
+}
+
+} // namespace
+} // namespace moby
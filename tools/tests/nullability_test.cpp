@@ -0,0 +1,85 @@
+#include "moby/nullability.h"
+
+#include "test_corpus.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace moby {
+namespace {
+
+constexpr const char* kHeader = R"(
+#if __has_feature(nullability)
+#define CM_NULLABLE __nullable
+#define CM_NONNULL __nonnull
+#else
+#define CM_NULLABLE
+#define CM_NONNULL
+#endif
+#define MT_NULLABLE CM_NULLABLE
+#define LA_NONNULL OS_NONNULL_ALL
+
+typedef struct OpaqueCMBlockBuffer *CMBlockBufferRef;
+typedef struct opaqueCMSampleBuffer *CMSampleBufferRef;
+
+OSStatus CMSampleBufferCreateReady(CMBlockBufferRef CM_NULLABLE dataBuffer,
+                                   CMSampleBufferRef CM_NULLABLE * CM_NONNULL sampleBufferOut);
+CMBlockBufferRef MT_NULLABLE MTCopyBuffer(CMBlockBufferRef buffer) LA_NONNULL;
+
+NS_ASSUME_NONNULL_BEGIN
+@interface MDLAsset : NSObject
+- (nullable NSString *)nameForKey:(NSString *)key error:(NSError **)error;
+@property (nonatomic, copy, null_resettable) NSString *title;
+@end
+NS_ASSUME_NONNULL_END
+)";
+
+class Nullabilities : public ::testing::Test {
+protected:
+    void SetUp() override {
+        files_ = std::make_unique<test::TestCorpus>(
+            std::vector<std::pair<std::string, std::string>>{{"Test.framework/Headers/T.h", kHeader}});
+        Corpus corpus(files_->dir());
+        SymbolDb::build(corpus, extract_corpus_symbols(corpus, 1), files_->path("symbols.db"));
+        db_ = std::make_unique<SymbolDb>(files_->path("symbols.db"));
+        NullabilityIndex::build(corpus, *db_, files_->path("nullability.idx"));
+        index_ = std::make_unique<NullabilityIndex>(files_->path("nullability.idx"));
+    }
+
+    // Slots of the only symbol called `name`, as "nonnull", "nullable*" (inferred), "-", ...
+    std::vector<std::string> slots(std::string_view name) const {
+        SymbolDb::Range r = db_->find(name);
+        EXPECT_EQ(r.count, 1u) << name;
+        std::vector<std::string> out;
+        if (!r.count)
+            return out;
+        for (const NullabilitySlot& s : index_->slots(db_->id_of(*r.begin())))
+            out.push_back(std::string(nullability_name(s.value())) + (s.inferred() ? "*" : ""));
+        return out;
+    }
+
+    std::unique_ptr<test::TestCorpus> files_;
+    std::unique_ptr<SymbolDb> db_;
+    std::unique_ptr<NullabilityIndex> index_;
+};
+
+using Names = std::vector<std::string>;
+
+// Macros defined as an annotation count as that annotation; other macros,
+// such as a function attribute, do not.
+TEST_F(Nullabilities, AnnotationMacros) {
+    EXPECT_EQ(slots("CMSampleBufferCreateReady"), (Names{"-", "nullable", "nonnull"}));
+    EXPECT_EQ(slots("MTCopyBuffer"), (Names{"nullable", "unspecified*"}));
+}
+
+TEST_F(Nullabilities, Regions) {
+    EXPECT_EQ(index_->region_count(), 1u);
+    EXPECT_EQ(slots("nameForKey:error:"), (Names{"nullable", "nonnull*", "nullable*"}));
+    EXPECT_EQ(slots("title"), (Names{"null_resettable"}));
+}
+
+} // namespace
+} // namespace moby
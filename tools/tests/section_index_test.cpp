@@ -0,0 +1,62 @@
+#include "moby/section_index.h"
+
+#include "moby/error.h"
+#include "test_corpus.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+
+namespace moby {
+namespace {
+
+TEST(SectionIndex, FindsEverySection) {
+    test::TestCorpus files({{"Test.framework/Headers/A.h", "@interface A\n@end\n"},
+                            {"Test.framework/Headers/B.h", "void b(void);\n"},
+                            {"Test.framework/Headers/C.h", "// last\n"}});
+    Corpus corpus(files.dir());
+    SectionIndex::build(corpus, files.path("sections.idx"));
+    SectionIndex index(files.path("sections.idx"), files.dir());
+
+    ASSERT_EQ(index.size(), 3u);
+    EXPECT_EQ(index.corpus_hash(), corpus_hash(corpus));
+    const SectionRecord* b = index.find("Test.framework/Headers/B.h");
+    ASSERT_NE(b, nullptr);
+    EXPECT_EQ(index.path(*b), "Test.framework/Headers/B.h");
+    EXPECT_EQ(index.file_name(b->file), "Test.framework.h");
+    EXPECT_EQ(index.text(*b), "void b(void);\n");
+    EXPECT_EQ(index.text(*index.find("Test.framework/Headers/C.h")), "// last\n");
+    EXPECT_EQ(index.find("Test.framework/Headers/D.h"), nullptr);
+    EXPECT_EQ(index.find("Test.framework/Headers/B"), nullptr);
+}
+
+// A header without a trailing newline runs straight into the next marker.
+TEST(SectionIndex, MarkerMidLine) {
+    test::TestCorpus files({{"Test.framework/Headers/A.h", "#define A 1"},
+                            {"Test.framework/Headers/B.h", "#define B 2\n"}});
+    Corpus corpus(files.dir());
+    SectionIndex::build(corpus, files.path("sections.idx"));
+    SectionIndex index(files.path("sections.idx"), files.dir());
+
+    ASSERT_EQ(index.size(), 2u);
+    EXPECT_EQ(index.text(*index.find("Test.framework/Headers/A.h")), "#define A 1");
+    EXPECT_EQ(index.text(*index.find("Test.framework/Headers/B.h")), "#define B 2\n");
+}
+
+TEST(SectionIndex, HashFollowsText) {
+    std::string path = "Test.framework/Headers/A.h";
+    test::TestCorpus a({{path, "int a;\n"}});
+    test::TestCorpus b({{path, "int b;\n"}});
+    EXPECT_NE(corpus_hash(Corpus(a.dir())), corpus_hash(Corpus(b.dir())));
+}
+
+TEST(SectionIndex, RejectsOtherFiles) {
+    std::string path = "Test.framework/Headers/A.h";
+    test::TestCorpus files({{path, "int a;\n"}});
+    std::ofstream(files.path("sections.idx"), std::ios::binary) << "MOBYENUM and some more bytes to fill a header";
+    EXPECT_THROW(SectionIndex(files.path("sections.idx"), files.dir()), Error);
+}
+
+} // namespace
+} // namespace moby
@@ -0,0 +1,154 @@
+#include "moby/struct_layout.h"
+
+#include "moby/enum_table.h"
+#include "test_corpus.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+namespace moby {
+namespace {
+
+constexpr const char* kHeader = R"(
+#if defined(__LP64__) && __LP64__
+# define CGFLOAT_TYPE double
+#else
+# define CGFLOAT_TYPE float
+#endif
+typedef CGFLOAT_TYPE CGFloat;
+
+struct CGPoint { CGFloat x; CGFloat y; };
+typedef struct CGPoint CGPoint;
+
+typedef struct {
+    uint8_t tag;
+    int64_t value;
+    void *context;
+} Mixed;
+
+typedef struct {
+    unsigned int a : 3;
+    unsigned int b : 30;
+    uint16_t c;
+} Bits;
+
+#pragma pack(push, 2)
+typedef struct {
+    uint8_t a;
+    uint32_t b;
+} Packed2;
+#pragma pack(pop)
+
+typedef union {
+    uint16_t half;
+    double d;
+    char bytes[3];
+} Either;
+
+typedef struct {
+    CGPoint points[2];
+    Either tail;
+} Nested;
+)";
+
+class Layouts : public ::testing::Test {
+protected:
+    void SetUp() override {
+        files_ = std::make_unique<test::TestCorpus>(
+            std::vector<std::pair<std::string, std::string>>{{"Test.framework/Headers/T.h", kHeader}});
+        Corpus corpus(files_->dir());
+        StructLayouts::build(corpus, {}, files_->path("layouts.tbl"), 1);
+        layouts_ = std::make_unique<StructLayouts>(files_->path("layouts.tbl"));
+    }
+
+    const StructRecord& record(std::string_view name, LayoutTarget target) {
+        const StructRecord* r = layouts_->find(name, target);
+        EXPECT_NE(r, nullptr) << name;
+        EXPECT_TRUE(r && (r->flags & StructRecord::kResolved)) << name;
+        static const StructRecord kMissing{};
+        return r ? *r : kMissing;
+    }
+
+    std::uint64_t bit_offset(std::string_view name, std::size_t field, LayoutTarget target) {
+        const StructRecord& r = record(name, target);
+        return field < r.field_count ? layouts_->field(r.first_field + field).bit_offset : ~0ull;
+    }
+
+    std::unique_ptr<test::TestCorpus> files_;
+    std::unique_ptr<StructLayouts> layouts_;
+};
+
+TEST_F(Layouts, TargetDependentTypedefs) {
+    EXPECT_EQ(record("CGPoint", LayoutTarget::LP64).size, 16u);
+    EXPECT_EQ(record("CGPoint", LayoutTarget::ILP32).size, 8u);
+    EXPECT_EQ(bit_offset("CGPoint", 1, LayoutTarget::LP64), 64u);
+}
+
+TEST_F(Layouts, NaturalAlignment) {
+    const StructRecord& lp64 = record("Mixed", LayoutTarget::LP64);
+    EXPECT_EQ(lp64.size, 24u);
+    EXPECT_EQ(lp64.align, 8u);
+    EXPECT_EQ(bit_offset("Mixed", 1, LayoutTarget::LP64), 64u);
+    // 64-bit scalars are 4-aligned on ILP32.
+    const StructRecord& ilp32 = record("Mixed", LayoutTarget::ILP32);
+    EXPECT_EQ(ilp32.size, 16u);
+    EXPECT_EQ(ilp32.align, 4u);
+    EXPECT_EQ(bit_offset("Mixed", 1, LayoutTarget::ILP32), 32u);
+}
+
+TEST_F(Layouts, Bitfields) {
+    const StructRecord& r = record("Bits", LayoutTarget::LP64);
+    EXPECT_EQ(r.size, 12u);
+    EXPECT_EQ(bit_offset("Bits", 0, LayoutTarget::LP64), 0u);
+    // 30 bits do not fit after 3 in the same unsigned int.
+    EXPECT_EQ(bit_offset("Bits", 1, LayoutTarget::LP64), 32u);
+    EXPECT_EQ(bit_offset("Bits", 2, LayoutTarget::LP64), 64u);
+}
+
+TEST_F(Layouts, PragmaPack) {
+    const StructRecord& r = record("Packed2", LayoutTarget::LP64);
+    EXPECT_EQ(r.size, 6u);
+    EXPECT_EQ(r.pack, 2u);
+    EXPECT_EQ(bit_offset("Packed2", 1, LayoutTarget::LP64), 16u);
+}
+
+TEST_F(Layouts, UnionsAndNesting) {
+    const StructRecord& u = record("Either", LayoutTarget::LP64);
+    EXPECT_TRUE(u.flags & StructRecord::kUnion);
+    EXPECT_EQ(u.size, 8u);
+    EXPECT_EQ(record("Nested", LayoutTarget::LP64).size, 40u);
+    EXPECT_EQ(bit_offset("Nested", 1, LayoutTarget::LP64), 256u);
+}
+
+// Enumerator bounds come from the enum table folded for each target.
+TEST(LayoutEnums, PerTarget) {
+    std::string header = R"(
+typedef NS_ENUM(NSInteger, Words) {
+    kWordCount = NSIntegerMax > 0x7FFFFFFF ? 4 : 2,
+};
+typedef struct { uint32_t words[kWordCount]; } Buffer;
+)";
+    test::TestCorpus files({{"Test.framework/Headers/T.h", header}});
+    Corpus corpus(files.dir());
+    std::vector<Symbol> symbols = extract_corpus_symbols(corpus, 1);
+    std::unique_ptr<EnumTable> tables[kLayoutTargetCount];
+    LayoutEnums enums{};
+    for (int t = 0; t < kLayoutTargetCount; ++t) {
+        std::string path = files.path("enums" + std::to_string(t) + ".tbl");
+        EnumTable::build(corpus, symbols, path, layout_target_config(static_cast<LayoutTarget>(t)));
+        tables[t] = std::make_unique<EnumTable>(path);
+        enums[t] = tables[t].get();
+    }
+    StructLayouts::build(corpus, enums, files.path("layouts.tbl"), 1);
+    StructLayouts layouts(files.path("layouts.tbl"));
+    const StructRecord* lp64 = layouts.find("Buffer", LayoutTarget::LP64);
+    const StructRecord* ilp32 = layouts.find("Buffer", LayoutTarget::ILP32);
+    ASSERT_TRUE(lp64 && ilp32);
+    EXPECT_EQ(lp64->size, 16u);
+    EXPECT_EQ(ilp32->size, 8u);
+}
+
+} // namespace
+} // namespace moby
@@ -0,0 +1,68 @@
+#include "moby/symbol_db.h"
+
+#include "moby/section_index.h"
+#include "test_corpus.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace moby {
+namespace {
+
+TEST(SymbolDb, FindsRecordsByName) {
+    std::string a = "@interface MDLMesh : NSObject\n- (void)flip;\n@end\n";
+    std::string b = "@interface MDLLight : NSObject\n- (void)flip;\n@end\nvoid MDLReset(void);\n";
+    test::TestCorpus files({{"Test.framework/Headers/A.h", a}, {"Test.framework/Headers/B.h", b}});
+    Corpus corpus(files.dir());
+    std::vector<Symbol> symbols = extract_corpus_symbols(corpus, 1);
+    std::vector<std::uint32_t> ids = SymbolDb::build(corpus, symbols, files.path("symbols.db"));
+    SymbolDb db(files.path("symbols.db"));
+
+    ASSERT_EQ(db.size(), symbols.size());
+    ASSERT_EQ(ids.size(), symbols.size());
+    for (std::size_t i = 0; i < symbols.size(); ++i) {
+        EXPECT_EQ(db.name(db.at(ids[i])), symbols[i].name);
+        EXPECT_EQ(db.parent(db.at(ids[i])), symbols[i].parent);
+    }
+    EXPECT_EQ(db.corpus_hash(), corpus_hash(corpus));
+
+    SymbolDb::Range flip = db.find("flip");
+    ASSERT_EQ(flip.count, 2u);
+    std::vector<std::string> parents;
+    for (const SymbolRecord& r : flip)
+        parents.emplace_back(db.parent(r));
+    std::sort(parents.begin(), parents.end());
+    EXPECT_EQ(parents, (std::vector<std::string>{"MDLLight", "MDLMesh"}));
+
+    SymbolDb::Range reset = db.find("MDLReset");
+    ASSERT_EQ(reset.count, 1u);
+    const SymbolRecord& r = *reset.begin();
+    EXPECT_EQ(r.kind, SymbolKind::Function);
+    EXPECT_EQ(db.section_path(r), "Test.framework/Headers/B.h");
+    EXPECT_EQ(db.file_name(db.section(r).file), "Test.framework.h");
+    EXPECT_EQ(db.id_of(r), &r - &db.at(0));
+
+    EXPECT_EQ(db.find("MDLMissing").count, 0u);
+}
+
+TEST(SymbolDb, Prefix) {
+    std::string text = "void MDLA(void);\nvoid MDLB(void);\nvoid MDXC(void);\nvoid NSD(void);\n";
+    test::TestCorpus files({{"Test.framework/Headers/A.h", text}});
+    Corpus corpus(files.dir());
+    SymbolDb::build(corpus, extract_corpus_symbols(corpus, 1), files.path("symbols.db"));
+    SymbolDb db(files.path("symbols.db"));
+
+    std::vector<std::string> names;
+    for (const SymbolRecord& r : db.with_prefix("MD"))
+        names.emplace_back(db.name(r));
+    EXPECT_EQ(names, (std::vector<std::string>{"MDLA", "MDLB", "MDXC"}));
+    EXPECT_EQ(db.with_prefix("MDL").count, 2u);
+    EXPECT_EQ(db.with_prefix("Z").count, 0u);
+    EXPECT_EQ(db.with_prefix("").count, db.size());
+}
+
+} // namespace
+} // namespace moby
@@ -0,0 +1,114 @@
+#include "moby/symbols.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace moby {
+namespace {
+
+// "kind name" for every symbol in `text`, with " < parent" when it has one.
+std::vector<std::string> extract(std::string_view text) {
+    std::vector<Symbol> symbols;
+    extract_symbols(text, 0, 0, symbols);
+    std::vector<std::string> out;
+    for (const Symbol& s : symbols)
+        out.push_back(std::string(kind_name(s.kind)) + " " + s.name + (s.parent.empty() ? "" : " < " + s.parent));
+    return out;
+}
+
+using Names = std::vector<std::string>;
+
+TEST(Symbols, Interface) {
+    EXPECT_EQ(extract("API_AVAILABLE(ios(13.0))\n"
+                      "@interface MDLMesh : NSObject <MDLNamed>\n"
+                      "@property (nonatomic, readonly) NSUInteger vertexCount;\n"
+                      "+ (instancetype)meshWithName:(NSString *)name;\n"
+                      "- (void)addNormalsWithAttributeNamed:(nullable NSString *)name\n"
+                      "                     creaseThreshold:(float)t API_AVAILABLE(ios(10.0));\n"
+                      "@end\n"
+                      "@interface MDLMesh (Modifiers)\n- (void)flip;\n@end\n"
+                      "@protocol MDLNamed <NSObject>\n@optional\n@property (copy) NSString *name;\n@end\n"),
+              (Names{"interface MDLMesh < NSObject", "property vertexCount < MDLMesh",
+                     "class-method meshWithName: < MDLMesh",
+                     "instance-method addNormalsWithAttributeNamed:creaseThreshold: < MDLMesh",
+                     "category MDLMesh(Modifiers) < MDLMesh", "instance-method flip < MDLMesh",
+                     "protocol MDLNamed", "property name < MDLNamed"}));
+}
+
+TEST(Symbols, FunctionsAndVariables) {
+    EXPECT_EQ(extract("CM_EXPORT void CMSetAttachment(CMAttachmentBearerRef target, CFStringRef key)\n"
+                      "    API_AVAILABLE(macos(10.7));\n"
+                      "CF_INLINE CGPoint CGPointMake(CGFloat x, CGFloat y) { CGPoint p; return p; }\n"
+                      "CM_EXPORT const CMTimeRange kCMTimeRangeZero;\n"
+                      "extern NSString * const NSFoo API_AVAILABLE(ios(8.0));\n"),
+              (Names{"function CMSetAttachment", "function CGPointMake", "variable kCMTimeRangeZero",
+                     "variable NSFoo"}));
+}
+
+TEST(Symbols, Enums) {
+    EXPECT_EQ(extract("typedef NS_ENUM(NSInteger, MDLGeometryType) {\n"
+                      "    MDLGeometryTypePoints = 0,\n    MDLGeometryTypeLines,\n};\n"
+                      "typedef CF_OPTIONS(UInt32, AudioFormatFlags) { kFlagA = (1U << 0) };\n"
+                      "enum { kAnonymous = 'wav ' };\n"),
+              (Names{"enum MDLGeometryType", "enum-constant MDLGeometryTypePoints < MDLGeometryType",
+                     "enum-constant MDLGeometryTypeLines < MDLGeometryType", "enum AudioFormatFlags",
+                     "enum-constant kFlagA < AudioFormatFlags", "enum-constant kAnonymous"}));
+}
+
+// A struct defined in a typedef is named by the typedef and not recorded twice.
+TEST(Symbols, StructTypedefs) {
+    EXPECT_EQ(extract("struct CGPoint { CGFloat x; CGFloat y; };\n"
+                      "typedef struct CGPoint CGPoint;\n"
+                      "typedef struct { int a; } Anon;\n"
+                      "typedef union U { int i; float f; } U;\n"),
+              (Names{"struct CGPoint", "typedef CGPoint", "struct Anon", "union U"}));
+}
+
+TEST(Symbols, PlainTypedefs) {
+    EXPECT_EQ(extract("typedef uint32_t CMAttachmentMode API_AVAILABLE(macos(10.7));\n"
+                      "typedef const struct __CFString * CFStringRef;\n"
+                      "typedef NSString * NSNotificationName NS_TYPED_EXTENSIBLE_ENUM;\n"
+                      "typedef int Pair[2];\n"),
+              (Names{"typedef CMAttachmentMode", "typedef CFStringRef", "typedef NSNotificationName",
+                     "typedef Pair"}));
+}
+
+TEST(Symbols, FunctionPointerAndBlockTypedefs) {
+    EXPECT_EQ(extract("typedef void (*CFReleaseCallBack)(const void *value);\n"
+                      "typedef void (^MDLVoxelHandler)(NSUInteger i);\n"
+                      "typedef OSStatus (*AURenderCallback)(void *inRefCon, UInt32 inBusNumber);\n"),
+              (Names{"typedef CFReleaseCallBack", "typedef MDLVoxelHandler", "typedef AURenderCallback"}));
+}
+
+// Nullability qualifiers and macros ahead of the declarator are not its name.
+TEST(Symbols, QualifiedDeclaratorTypedefs) {
+    EXPECT_EQ(extract("typedef NSString *__nonnull (^AUImplementorStringFromValueCallback)(AUParameter *p);\n"
+                      "typedef AVAudioBuffer * __nullable (^AVAudioConverterInputBlock)(AVAudioPacketCount n);\n"
+                      "typedef const void * __nullable (*CGDataProviderGetBytePointerCallback)(void * __nullable info);\n"
+                      "typedef AudioComponentPlugInInterface * __nullable (*AudioComponentFactoryFunction)(\n"
+                      "    const AudioComponentDescription *inDesc);\n"
+                      "typedef MPSImage * __nonnull NS_RETURNS_RETAINED (^MPSCopyAllocator)(MPSKernel * __nonnull k);\n"
+                      "typedef void (^ _Nullable MDLOptionalHandler)(void);\n"),
+              (Names{"typedef AUImplementorStringFromValueCallback", "typedef AVAudioConverterInputBlock",
+                     "typedef CGDataProviderGetBytePointerCallback", "typedef AudioComponentFactoryFunction",
+                     "typedef MPSCopyAllocator", "typedef MDLOptionalHandler"}));
+}
+
+// Calling-convention macros inside the declarator's parentheses.
+TEST(Symbols, CallingConventionTypedefs) {
+    EXPECT_EQ(extract("typedef void (AL_APIENTRY *LPALENABLE)( ALenum capability );\n"
+                      "typedef ALCcontext * (ALC_APIENTRY *LPALCCREATECONTEXT) (ALCdevice *device, const ALCint *attrlist);\n"
+                      "typedef ALvoid (AL_APIENTRY *alBufferDataStaticProcPtr) (const ALint bid, ALenum format);\n"),
+              (Names{"typedef LPALENABLE", "typedef LPALCCREATECONTEXT", "typedef alBufferDataStaticProcPtr"}));
+}
+
+TEST(Symbols, FunctionTypedefs) {
+    EXPECT_EQ(extract("typedef void NSUncaughtExceptionHandler(NSException *exception);\n"
+                      "typedef OSStatus AudioFileCallback(void *inClientData) API_AVAILABLE(ios(2.0));\n"),
+              (Names{"typedef NSUncaughtExceptionHandler", "typedef AudioFileCallback"}));
+}
+
+} // namespace
+} // namespace moby
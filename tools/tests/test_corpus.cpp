@@ -0,0 +1,39 @@
+#include "test_corpus.h"
+
+#include "moby/corpus.h"
+#include "moby/error.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace moby::test {
+
+TestCorpus::TestCorpus(const std::vector<std::pair<std::string, std::string>>& sections) {
+    static std::atomic<unsigned> counter{0};
+    fs::path dir = fs::temp_directory_path() /
+                   ("moby-test-" + std::to_string(::getpid()) + "-" + std::to_string(counter++));
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    dir_ = dir.string();
+    std::ofstream out(dir / "Test.framework.h", std::ios::binary);
+    for (const auto& [path, text] : sections)
+        out << kSeparator << path << '\n' << text;
+    if (!out)
+        throw Error("cannot write test corpus in " + dir_);
+}
+
+TestCorpus::~TestCorpus() {
+    std::error_code ec;
+    fs::remove_all(dir_, ec);
+}
+
+std::string TestCorpus::path(const std::string& name) const {
+    return (fs::path(dir_) / name).string();
+}
+
+} // namespace moby::test
@@ -0,0 +1,27 @@
+// Corpus directories for tests: one Test.framework.h of the given sections,
+// written to a fresh temporary directory and removed afterwards.
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace moby::test {
+
+class TestCorpus {
+public:
+    // Header path ("Test.framework/Headers/T.h") and text of each section.
+    explicit TestCorpus(const std::vector<std::pair<std::string, std::string>>& sections);
+    ~TestCorpus();
+    TestCorpus(const TestCorpus&) = delete;
+    TestCorpus& operator=(const TestCorpus&) = delete;
+
+    const std::string& dir() const { return dir_; }
+    // A file in the directory, for build outputs.
+    std::string path(const std::string& name) const;
+
+private:
+    std::string dir_;
+};
+
+} // namespace moby::test
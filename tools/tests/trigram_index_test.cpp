@@ -0,0 +1,101 @@
+#include "moby/trigram_index.h"
+
+#include "test_corpus.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace moby {
+namespace {
+
+class TrigramIndexes : public ::testing::Test {
+protected:
+    void SetUp() override {
+        files_ = std::make_unique<test::TestCorpus>(std::vector<std::pair<std::string, std::string>>{
+            {"Test.framework/Headers/A.h", "@property BOOL allowEvaluation;\n"},
+            {"Test.framework/Headers/B.h", "- (void)evaluateWithObject:(id)object;\n"},
+            {"Test.framework/Headers/C.h", "#define ALLOWED 1\n"}});
+        Corpus corpus(files_->dir());
+        TrigramIndex::build(corpus, files_->path("trigrams.idx"), 2);
+        index_ = std::make_unique<TrigramIndex>(files_->path("trigrams.idx"));
+    }
+
+    // Candidate section numbers for `pattern`.
+    std::vector<std::size_t> candidates(std::string_view pattern, bool fixed = false) const {
+        Bitset set = index_->candidates(analyze_regex(pattern, fixed).query);
+        std::vector<std::size_t> out;
+        for (std::size_t i = 0; i < set.size(); ++i)
+            if (set.test(i))
+                out.push_back(i);
+        return out;
+    }
+
+    std::unique_ptr<test::TestCorpus> files_;
+    std::unique_ptr<TrigramIndex> index_;
+};
+
+using Sections = std::vector<std::size_t>;
+
+TEST_F(TrigramIndexes, Postings) {
+    EXPECT_EQ(index_->section_count(), 3u);
+    EXPECT_EQ(index_->posting_count(trigram_key('a', 'l', 'l')), 2u);
+    // Keys fold ASCII case.
+    EXPECT_EQ(trigram_key('A', 'L', 'L'), trigram_key('a', 'l', 'l'));
+    Bitset eva = index_->postings(trigram_key('e', 'v', 'a'));
+    EXPECT_TRUE(eva.test(0));
+    EXPECT_TRUE(eva.test(1));
+    EXPECT_FALSE(eva.test(2));
+    EXPECT_EQ(index_->posting_count(trigram_key('z', 'z', 'z')), 0u);
+    EXPECT_EQ(index_->postings(trigram_key('z', 'z', 'z')).count(), 0u);
+}
+
+TEST_F(TrigramIndexes, Candidates) {
+    EXPECT_EQ(candidates("allowEvaluation"), (Sections{0}));
+    EXPECT_EQ(candidates("allow"), (Sections{0, 2}));
+    EXPECT_EQ(candidates("evaluat(e|ion)"), (Sections{0, 1}));
+    EXPECT_EQ(candidates("allowed|object"), (Sections{1, 2}));
+    EXPECT_EQ(candidates("a.c"), (Sections{0, 1, 2}));
+    EXPECT_EQ(candidates("allow.*Object"), (Sections{}));
+    EXPECT_EQ(candidates("(id)", true), (Sections{1}));
+}
+
+// Escape operands are part of the escape, not literal text.
+TEST_F(TrigramIndexes, Escapes) {
+    EXPECT_EQ(candidates("allowEv\\x61luation"), (Sections{0}));
+    EXPECT_EQ(candidates("allowEv\\u0061luation"), (Sections{0}));
+    EXPECT_EQ(candidates("allowEvaluation;\\cJ"), (Sections{0}));
+    EXPECT_EQ(candidates("allowEvaluation;\\n"), (Sections{0}));
+    EXPECT_EQ(candidates("evaluate\\x57ithObject"), (Sections{1}));
+    // Outside ASCII, or malformed: unknown, so it only weakens the filter.
+    EXPECT_EQ(candidates("allow\\xE9d"), (Sections{0, 2}));
+    EXPECT_EQ(candidates("allow\\xZZ"), (Sections{0, 2}));
+
+    RegexAnalysis hex = analyze_regex("allowEv\\x61luation", false);
+    EXPECT_FALSE(hex.literal);
+    EXPECT_EQ(hex.required, (std::vector<std::string>{"allowEvaluation"}));
+}
+
+TEST(TrigramQueries, Analysis) {
+    RegexAnalysis plain = analyze_regex("allowEvaluation", false);
+    EXPECT_TRUE(plain.literal);
+    EXPECT_EQ(plain.required, (std::vector<std::string>{"allowEvaluation"}));
+
+    RegexAnalysis star = analyze_regex("NS[A-Z]+Error(Domain)?", false);
+    EXPECT_FALSE(star.literal);
+    EXPECT_EQ(star.required, (std::vector<std::string>{"Error", "NS"}));
+
+    // Alternatives share no literal, so nothing is required of a line.
+    EXPECT_TRUE(analyze_regex("foo|bar", false).required.empty());
+    // Too short to constrain anything.
+    EXPECT_EQ(analyze_regex("ab", false).query.op, TrigramQuery::Op::All);
+
+    RegexAnalysis fixed = analyze_regex("a.b(", true);
+    EXPECT_TRUE(fixed.literal);
+    EXPECT_EQ(fixed.required, (std::vector<std::string>{"a.b("}));
+}
+
+} // namespace
+} // namespace moby